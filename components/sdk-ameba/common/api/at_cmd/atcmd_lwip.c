@@ -1845,6 +1845,57 @@ exit:
 	return;
 }
 
+#if LWIP_STATS && LWIP_STATS_DUMP
+static void atcmd_lwip_stats_out(void *arg, const char *s)
+{
+	(void) arg;
+	at_printf("%s", s);
+}
+
+//ATPM[=<json|reset>]
+void fATPM(void *arg)
+{
+	int argc, error_no = 0;
+	char *argv[MAX_ARGC] = {0};
+	u8_t json = 0;
+
+	AT_DBG_MSG(AT_FLAG_LWIP, AT_DBG_ALWAYS,
+		"[ATPM]: _AT_TRANSPORT_LWIP_STATISTICS");
+
+	if(arg){
+		argc = parse_param(arg, argv);
+		if(argc != 2 || argv[1] == NULL){
+			AT_DBG_MSG(AT_FLAG_LWIP, AT_DBG_ERROR,
+				"\r\n[ATPM] Usage : ATPM[=<json|reset>]");
+			error_no = 1;
+			goto exit;
+		}
+		if(strcmp(argv[1], "json") == 0)
+			json = 1;
+		else if(strcmp(argv[1], "reset") == 0){
+			stats_reset();
+			goto exit;
+		}
+		else{
+			error_no = 2;
+			goto exit;
+		}
+	}
+
+	if(json)
+		at_printf("\r\n");
+	stats_dump(atcmd_lwip_stats_out, NULL, json);
+
+exit:
+	if(error_no == 0)
+		at_printf("\r\n[ATPM] OK");
+	else
+		at_printf("\r\n[ATPM] ERROR:%d",error_no);
+
+	return;
+}
+#endif
+
 extern void do_ping_call(char *ip, int loop, int count);
 extern int get_ping_report(int *ping_lost);
 void fATPP(void *arg){
@@ -2899,6 +2950,9 @@ log_item_t at_transport_items[ ] = {
 	{"ATPI", fATPI,},//printf connection status
 	{"ATPU", fATPU,}, //transparent transmission mode
 	{"ATPL", fATPL,}, //lwip auto reconnect setting
+#if LWIP_STATS && LWIP_STATS_DUMP
+	{"ATPM", fATPM,}, //lwip pool and protocol statistics
+#endif
 #endif	
 };
 
@@ -4836,6 +4890,57 @@ exit:
 	return;
 }
 
+#if LWIP_STATS && LWIP_STATS_DUMP
+static void atcmd_lwip_stats_out(void *arg, const char *s)
+{
+	(void) arg;
+	at_printf("%s", s);
+}
+
+//ATPM[=<json|reset>]
+void fATPM(void *arg)
+{
+	int argc, error_no = 0;
+	char *argv[MAX_ARGC] = {0};
+	u8_t json = 0;
+
+	AT_DBG_MSG(AT_FLAG_LWIP, AT_DBG_ALWAYS,
+		"[ATPM]: _AT_TRANSPORT_LWIP_STATISTICS");
+
+	if(arg){
+		argc = parse_param(arg, argv);
+		if(argc != 2 || argv[1] == NULL){
+			AT_DBG_MSG(AT_FLAG_LWIP, AT_DBG_ERROR,
+				"\r\n[ATPM] Usage : ATPM[=<json|reset>]");
+			error_no = 1;
+			goto exit;
+		}
+		if(strcmp(argv[1], "json") == 0)
+			json = 1;
+		else if(strcmp(argv[1], "reset") == 0){
+			stats_reset();
+			goto exit;
+		}
+		else{
+			error_no = 2;
+			goto exit;
+		}
+	}
+
+	if(json)
+		at_printf("\r\n");
+	stats_dump(atcmd_lwip_stats_out, NULL, json);
+
+exit:
+	if(error_no == 0)
+		at_printf("\r\n[ATPM] OK");
+	else
+		at_printf("\r\n[ATPM] ERROR:%d",error_no);
+
+	return;
+}
+#endif
+
 extern void do_ping_call(char *ip, int loop, int count);
 extern int get_ping_report(int *ping_lost);
 void fATPP(void *arg){
@@ -5926,6 +6031,9 @@ log_item_t at_transport_items[ ] = {
 	{"ATPI", fATPI,},//printf connection status
 	{"ATPU", fATPU,}, //transparent transmission mode
 	{"ATPL", fATPL,}, //lwip auto reconnect setting
+#if LWIP_STATS && LWIP_STATS_DUMP
+	{"ATPM", fATPM,}, //lwip pool and protocol statistics
+#endif
 #endif
 };
 
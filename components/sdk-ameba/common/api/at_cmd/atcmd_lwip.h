@@ -15,6 +15,7 @@
 #include "lwip/tcpip.h"
 #include "lwip/pbuf.h"
 #include "lwip/netdb.h"
+#include "lwip/stats.h"
 #include "lwip_netconf.h"
 
 #define	_AT_TRANSPORT_MODE_					"ATP1"
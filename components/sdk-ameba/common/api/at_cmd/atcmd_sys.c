@@ -587,6 +587,36 @@ void fATSS(void *arg)	// Show CPU stats
 }
 #endif
 
+#if defined(configUSE_TRACE_RING) && (configUSE_TRACE_RING == 1)
+void fATST(void *arg)	// Kernel trace ring
+{
+	int argc = 0;
+	char *argv[MAX_ARGC] = {0};
+	uint32_t enabled, events, lost;
+
+	AT_PRINTK("[ATST]: _AT_SYSTEM_TRACE_");
+	if(arg){
+		argc = parse_param(arg, argv);
+		if(argc == 2 && strcmp(argv[1], "start") == 0)
+			vTraceStart();
+		else if(argc == 2 && strcmp(argv[1], "stop") == 0)
+			vTraceStop();
+		else if(argc == 2 && strcmp(argv[1], "clear") == 0)
+			vTraceClear();
+		else if(argc == 2 && strcmp(argv[1], "dump") == 0){
+			vTraceDump();
+			return;
+		}
+		else{
+			AT_PRINTK("[ATST] Usage: ATST=[start|stop|clear|dump]");
+			return;
+		}
+	}
+	vTraceGetStatus(&enabled, &events, &lost);
+	AT_PRINTK("[ATST] %s, events = %d, lost = %d", enabled ? "on" : "off", events, lost);
+}
+#endif
+
 void fATSs(void *arg)
 {
 	int argc = 0;
@@ -1213,6 +1243,9 @@ log_item_t at_sys_items[] = {
 #if (configGENERATE_RUN_TIME_STATS == 1)
 	{"ATSS", fATSS,},	// Show CPU stats
 #endif
+#if defined(configUSE_TRACE_RING) && (configUSE_TRACE_RING == 1)
+	{"ATST", fATST,},	// Kernel trace ring
+#endif
 #if SUPPORT_CP_TEST
 	{"ATSM", fATSM,},	// Apple CP test
 #endif
@@ -181,6 +181,23 @@ void LwIP_Init(void)
 	lwip_init_done = 1;	 
 }
 
+/* Address to verify with INIT-REBOOT on the next DHCP_START, 0 for DISCOVER */
+static uint32_t dhcp_reboot_addr = 0;
+
+/**
+  * @brief  LwIP_DHCP_Reboot: like LwIP_DHCP(idx, DHCP_START), but asks the
+  *         server to confirm a previously leased address first (INIT-REBOOT).
+  *         Falls back to DISCOVER if the server NAKs or does not answer.
+  * @param  idx: interface index
+  * @param  addr: previously leased address in network byte order
+  * @retval DHCP state as returned by LwIP_DHCP
+  */
+uint8_t LwIP_DHCP_Reboot(uint8_t idx, uint32_t addr)
+{
+	dhcp_reboot_addr = addr;
+	return LwIP_DHCP(idx, DHCP_START);
+}
+
 /**
   * @brief  LwIP_DHCP_Process_Handle
   * @param  None
@@ -221,7 +238,13 @@ uint8_t LwIP_DHCP(uint8_t idx, uint8_t dhcp_state)
 #if CONFIG_WLAN
 				wifi_unreg_event_handler(WIFI_EVENT_BEACON_AFTER_DHCP, wifi_rx_beacon_hdl);
 #endif
-				dhcp_start(pnetif);
+				if(dhcp_reboot_addr != 0) {
+					ipaddr.addr = dhcp_reboot_addr;
+					dhcp_reboot_addr = 0;
+					dhcp_start_reboot(pnetif, &ipaddr);
+				}
+				else
+					dhcp_start(pnetif);
 				IPaddress = 0;
 				DHCP_state = DHCP_WAIT_ADDRESS;
 			}
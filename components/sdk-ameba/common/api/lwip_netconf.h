@@ -65,6 +65,7 @@ void wifi_rx_beacon_hdl( char* buf, int buf_len, int flags, void* userdata);
 /* Exported functions ------------------------------------------------------- */
 void LwIP_Init(void);
 uint8_t LwIP_DHCP(uint8_t idx, uint8_t dhcp_state);
+uint8_t LwIP_DHCP_Reboot(uint8_t idx, uint32_t addr);
 unsigned char* LwIP_GetMAC(struct netif *pnetif);
 unsigned char* LwIP_GetIP(struct netif *pnetif);
 unsigned char* LwIP_GetGW(struct netif *pnetif);
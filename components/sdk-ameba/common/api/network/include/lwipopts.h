@@ -35,9 +35,9 @@
  */
 #define SYS_LIGHTWEIGHT_PROT    1
 
-/* Define LWIP_COMPAT_MUTEX if the port has no mutexes and binary semaphores
- should be used instead */
-#define LWIP_COMPAT_MUTEX       1
+/* Use FreeRTOS mutexes (priority inheritance) for sys_mutex_t: the tcpip
+ core lock is taken by application tasks of any priority */
+#define LWIP_COMPAT_MUTEX       0
 
 #define ETHARP_TRUST_IP_MAC     0
 #define IP_REASSEMBLY           1
@@ -66,7 +66,7 @@ a lot of data that needs to be copied, this should be set high. */
     #define MEM_SIZE                (10*1024) //for ping 10k test
 #elif CONFIG_ETHERNET
 	#define MEM_SIZE				(6*1024)  //for iperf test
-#else
+#elif !defined(MEM_SIZE)
     #define MEM_SIZE                (5*1024)
 #endif
 
@@ -76,7 +76,9 @@ a lot of data that needs to be copied, this should be set high. */
 #define MEMP_NUM_PBUF           100
 /* MEMP_NUM_UDP_PCB: the number of UDP protocol control blocks. One
    per active UDP "connection". */
+#ifndef MEMP_NUM_UDP_PCB
 #define MEMP_NUM_UDP_PCB        6
+#endif
 /* MEMP_NUM_TCP_PCB: the number of simulatenously active TCP
    connections. */
 #define MEMP_NUM_TCP_PCB        10
@@ -85,17 +87,37 @@ a lot of data that needs to be copied, this should be set high. */
 #define MEMP_NUM_TCP_PCB_LISTEN 5
 /* MEMP_NUM_TCP_SEG: the number of simultaneously queued TCP
    segments. */
+#ifndef MEMP_NUM_TCP_SEG
 #define MEMP_NUM_TCP_SEG        20
+#endif
 /* MEMP_NUM_SYS_TIMEOUT: the number of simulateously active
    timeouts. */
+#ifndef MEMP_NUM_SYS_TIMEOUT
 #define MEMP_NUM_SYS_TIMEOUT    10
+#endif
+/* Keep the timeouts in a timing wheel (~1KB of slots) so adding and
+   cancelling one doesn't walk the whole list. */
+#ifndef LWIP_TIMERS_WHEEL
+#define LWIP_TIMERS_WHEEL       1
+#endif
+/* Let empty pools and a full heap borrow from the FreeRTOS heap, up to
+   MEMP_ELASTIC_RESERVE bytes in total; idle pools give it back after
+   MEMP_ELASTIC_TMR_INTERVAL. RX pbufs may borrow only half their pool so
+   that WLAN RX cannot take what TCP TX needs. */
+#ifndef MEMP_ELASTIC
+#define MEMP_ELASTIC            1
+#endif
+#define MEMP_ELASTIC_RESERVE    (12*1024)
+#define MEMP_ELASTIC_MAX(name, num) (MEMP_##name == MEMP_PBUF_POOL ? (num) / 2 : (num))
+#define MEMP_ELASTIC_ALLOC(size) pvPortMalloc(size)
+#define MEMP_ELASTIC_FREE(ptr)  vPortFree(ptr)
 
 
 /* ---------- Pbuf options ---------- */
 /* PBUF_POOL_SIZE: the number of buffers in the pbuf pool. */
 #if WIFI_LOGO_CERTIFICATION_CONFIG
     #define PBUF_POOL_SIZE          30 //for ping 10k test
-#else
+#elif !defined(PBUF_POOL_SIZE)
     #define PBUF_POOL_SIZE          20
 #endif
 
@@ -122,15 +144,36 @@ a lot of data that needs to be copied, this should be set high. */
 #define TCP_MSS                 (1500 - 40)	  /* TCP_MSS = (Ethernet MTU - IP header size - TCP header size) */
 
 /* TCP sender buffer space (bytes). */
+#ifndef TCP_SND_BUF
 #define TCP_SND_BUF             (5*TCP_MSS)
+#endif
 
 /*  TCP_SND_QUEUELEN: TCP sender buffer space (pbufs). This must be at least
   as much as (2 * TCP_SND_BUF/TCP_MSS) for things to work. */
 
 #define TCP_SND_QUEUELEN        (4* TCP_SND_BUF/TCP_MSS)
 
-/* TCP receive window. */
+/* TCP receive window. With 4 segments in flight a loss seldom gets the
+   three dupacks that start fast recovery and SACK; 8 make them work at
+   the cost of about 12.5KB more RAM with the pools and heap to hold them,
+   see the simulator's platform_opts.h. */
+#ifndef TCP_WND
 #define TCP_WND                 (4*TCP_MSS)
+#endif
+
+/* Negotiate window scaling. TCP_WND above 64K only needs TCP_RCV_SCALE
+   raised so that (TCP_WND >> TCP_RCV_SCALE) fits 16 bits; the window
+   here fits, only the peer's window is scaled. */
+#define LWIP_WND_SCALE          1
+#ifndef TCP_RCV_SCALE
+#define TCP_RCV_SCALE           0
+#endif
+
+/* Selective acknowledgements: report ooseq data to the peer and
+   retransmit only the holes it reports back. */
+#ifndef LWIP_TCP_SACK
+#define LWIP_TCP_SACK           1
+#endif
 
 
 /* ---------- ICMP options ---------- */
@@ -151,6 +194,8 @@ a lot of data that needs to be copied, this should be set high. */
 #define UDP_TTL                 255
 /* ---------- DNS options ---------- */
 #define LWIP_DNS                        1
+#define DNS_NEGATIVE_TTL                30
+#define DNS_PINNED_HOSTS                4
 
 /* ---------- UPNP options --------- */
 #define LWIP_UPNP		0
@@ -216,7 +261,15 @@ a lot of data that needs to be copied, this should be set high. */
 #endif
 
 /* ---------- Statistics options ---------- */
-#define LWIP_STATS 0
+/* Counters only, no display code. Queried with ATPM in atcmd_lwip.c */
+#ifndef LWIP_STATS
+#define LWIP_STATS 1
+#endif
+#if LWIP_STATS
+#define LWIP_STATS_LARGE 1
+#define LWIP_STATS_HIST 1
+#define LWIP_STATS_DUMP 1
+#endif
 #define LWIP_PROVIDE_ERRNO 1
 
 
@@ -264,6 +317,18 @@ The STM32F2x7 allows computing and verifying the IP, UDP, TCP and ICMP checksums
 #endif
 
 
+/* Software checksum: word-at-a-time sum (inet_chksum.c version #4) and
+   checksum computed while tcp_write/udp copy the data into pbufs */
+#ifndef LWIP_CHKSUM_ALGORITHM
+#define LWIP_CHKSUM_ALGORITHM           4
+#endif
+#ifndef LWIP_CHECKSUM_ON_COPY
+#define LWIP_CHECKSUM_ON_COPY           1
+#endif
+#if LWIP_CHECKSUM_ON_COPY
+#define LWIP_CHKSUM_COPY_ALGORITHM      2
+#endif
+
 /*
    ----------------------------------------------
    ---------- Sequential layer options ----------
@@ -284,6 +349,11 @@ The STM32F2x7 allows computing and verifying the IP, UDP, TCP and ICMP checksums
  */
 #define LWIP_SOCKET                     1	
 
+/**
+ * LWIP_SOCKET_POLL==1: Enable lwip_poll_create/ctl/wait readiness API
+ */
+#define LWIP_SOCKET_POLL                1
+
 /*
    -----------------------------------
    ---------- DEBUG options ----------
@@ -308,6 +378,19 @@ The STM32F2x7 allows computing and verifying the IP, UDP, TCP and ICMP checksums
 #define DEFAULT_THREAD_STACKSIZE        500
 #define TCPIP_THREAD_PRIO               (configMAX_PRIORITIES - 2)
 
+/* Run netconn/socket API calls in the calling task under the core lock
+   instead of posting them to the tcpip thread mailbox */
+#ifndef LWIP_TCPIP_CORE_LOCKING
+#define LWIP_TCPIP_CORE_LOCKING         1
+#endif
+
+/* Queue received frames for the tcpip thread and wake it once per burst;
+   the queue can hold every pbuf of the pool */
+#ifndef TCPIP_INPUT_BATCH
+#define TCPIP_INPUT_BATCH               1
+#endif
+#define MEMP_NUM_TCPIP_MSG_INPKT        PBUF_POOL_SIZE
+
 /* Added by Realtek */
 #ifndef DNS_IGNORE_REPLY_ERR
 #define DNS_IGNORE_REPLY_ERR   1
@@ -0,0 +1,234 @@
+#include "platform_opts.h"
+#include <platform/platform_stdlib.h>
+#include "g711_pcm.h"
+
+#if defined(CONFIG_PLATFORM_SIM) || defined(G711_PCM_NO_SIMD)
+// portable versions giving the same results as the Cortex-M4 instructions
+static inline u32 pcm_pkhbt(s32 lo, s32 hi)
+{
+	return ((u32)lo & 0xffff) | ((u32)hi << 16);
+}
+
+static inline s32 pcm_smlad(u32 x, u32 y, s32 acc)
+{
+	return acc + (s16)x*(s16)y + (s16)(x >> 16)*(s16)(y >> 16);
+}
+
+static inline s32 pcm_ssat16(s32 v)
+{
+	return v > 32767 ? 32767 : v < -32768 ? -32768 : v;
+}
+
+#define pcm_smuad(x, y)			pcm_smlad(x, y, 0)
+#else
+#include "ameba_soc.h"	// core_cm4_simd.h
+#define pcm_pkhbt(lo, hi)		__PKHBT(lo, hi, 16)
+#define pcm_smuad(x, y)			(s32)__SMUAD(x, y)
+#define pcm_smlad(x, y, acc)	(s32)__SMLAD(x, y, acc)
+#define pcm_ssat16(v)			__SSAT(v, 16)
+#endif
+
+#define PAIR(a, b)	(((u32)(a) & 0xffff) | ((u32)(b) << 16))
+
+/*
+ * Hann windowed sinc, cut off at 0.9 of the input Nyquist frequency, 8 taps
+ * per phase, each phase sums to 32768. Taps are for the newest input first.
+ */
+static const u32 fir2[2*G711_PCM_TAPS/2] = {
+	PAIR(-25, 840), PAIR(-3463, 10857), PAIR(26833, -2483), PAIR(146, 63),
+	PAIR(63, 146), PAIR(-2483, 26833), PAIR(10857, -3463), PAIR(840, -25),
+};
+
+static const u32 fir3[3*G711_PCM_TAPS/2] = {
+	PAIR(-11, 711), PAIR(-2866, 7937), PAIR(28294, -1125), PAIR(-327, 155),
+	PAIR(-51, 910), PAIR(-4280, 19804), PAIR(19806, -4280), PAIR(910, -51),
+	PAIR(155, -327), PAIR(-1125, 28294), PAIR(7937, -2866), PAIR(711, -11),
+};
+
+static const u32 fir4[4*G711_PCM_TAPS/2] = {
+	PAIR(-6, 638), PAIR(-2540, 6544), PAIR(28820, -298), PAIR(-601, 211),
+	PAIR(-45, 953), PAIR(-4110, 15393), PAIR(23732, -3786), PAIR(652, -21),
+	PAIR(-21, 652), PAIR(-3786, 23732), PAIR(15393, -4110), PAIR(953, -45),
+	PAIR(211, -601), PAIR(-298, 28820), PAIR(6544, -2540), PAIR(638, -6),
+};
+
+static const u32 fir6[6*G711_PCM_TAPS/2] = {
+	PAIR(-3, 563), PAIR(-2205, 5210), PAIR(29199, 627), PAIR(-896, 273),
+	PAIR(-25, 840), PAIR(-3463, 10857), PAIR(26833, -2483), PAIR(146, 63),
+	PAIR(-50, 959), PAIR(-4230, 16896), PAIR(22500, -4035), PAIR(765, -37),
+	PAIR(-37, 765), PAIR(-4035, 22500), PAIR(16896, -4230), PAIR(959, -50),
+	PAIR(63, 146), PAIR(-2483, 26833), PAIR(10857, -3463), PAIR(840, -25),
+	PAIR(273, -896), PAIR(627, 29199), PAIR(5210, -2205), PAIR(563, -3),
+};
+
+// decoded sample in both halves, built on first use
+static u32 ulaw_tab[256];
+static u32 alaw_tab[256];
+static u8 ulaw_ready = 0;
+static u8 alaw_ready = 0;
+
+// CCITT G.711, as G711_decoder() decodes it
+s16 g711_ulaw2linear(u8 u_val)
+{
+	int t;
+
+	u_val = ~u_val;
+	t = ((u_val & 0x0f) << 3) + 0x84;
+	t <<= (u_val & 0x70) >> 4;
+	return (u_val & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+s16 g711_alaw2linear(u8 a_val)
+{
+	int t, seg;
+
+	a_val ^= 0x55;
+	t = (a_val & 0x0f) << 4;
+	seg = (a_val & 0x70) >> 4;
+	if(seg == 0)
+		t += 8;
+	else{
+		t += 0x108;
+		t <<= seg - 1;
+	}
+	return (a_val & 0x80) ? t : -t;
+}
+
+int g711_pcm_init(g711_pcm_t* pcm, int law, u32 in_rate, u32 out_rate, int resample)
+{
+	int i;
+
+	memset(pcm, 0, sizeof(g711_pcm_t));
+
+	if(law == I2S_MODE_G711U){
+		if(!ulaw_ready){
+			for(i = 0; i < 256; i++)
+				ulaw_tab[i] = PAIR(g711_ulaw2linear(i), g711_ulaw2linear(i));
+			ulaw_ready = 1;
+		}
+		pcm->tab = ulaw_tab;
+	}else if(law == I2S_MODE_G711A){
+		if(!alaw_ready){
+			for(i = 0; i < 256; i++)
+				alaw_tab[i] = PAIR(g711_alaw2linear(i), g711_alaw2linear(i));
+			alaw_ready = 1;
+		}
+		pcm->tab = alaw_tab;
+	}else
+		return -1;
+
+	if(in_rate == 0 || out_rate == 0)
+		return -1;
+
+	if(in_rate == out_rate){
+		pcm->up = 1;
+		return 0;
+	}
+
+	if(resample == G711_PCM_POLYPHASE && out_rate%in_rate == 0){
+		switch(out_rate/in_rate){
+		case 2: pcm->fir = fir2; break;
+		case 3: pcm->fir = fir3; break;
+		case 4: pcm->fir = fir4; break;
+		case 6: pcm->fir = fir6; break;
+		}
+		if(pcm->fir){
+			pcm->up = out_rate/in_rate;
+			return 0;
+		}
+	}
+
+	pcm->up = 0;
+	pcm->step = (u32)(((u64)in_rate << 16)/out_rate);
+	return 0;
+}
+
+u32 g711_pcm_need(g711_pcm_t* pcm, u32 frames)
+{
+	if(frames == 0)
+		return 0;
+	if(pcm->up == 1)
+		return frames;
+	if(pcm->up == 0)
+		return (pcm->frac + (frames - 1)*pcm->step) >> 16;
+	return (pcm->phase + frames - 1)/pcm->up + (pcm->phase == 0);
+}
+
+u32 g711_pcm_decode(g711_pcm_t* pcm, const u8* src, u32 mask, u32 pos, u32* dst, u32 frames)
+{
+	const u32* tab = pcm->tab;
+	const u32* c;
+	u32 i, n = 0, w0, w1, w2, w3, phase;
+	s32 y;
+
+	if(pcm->up == 1){
+		for(i = 0; i + 4 <= frames; i += 4, pos += 4){
+			dst[i] = tab[src[pos&mask]];
+			dst[i+1] = tab[src[(pos+1)&mask]];
+			dst[i+2] = tab[src[(pos+2)&mask]];
+			dst[i+3] = tab[src[(pos+3)&mask]];
+		}
+		for(; i < frames; i++, pos++)
+			dst[i] = tab[src[pos&mask]];
+		return frames;
+	}
+
+	if(pcm->up == 0){
+		u32 frac = pcm->frac, step = pcm->step, w;
+		s32 s0 = pcm->s0, s1 = pcm->s1;
+
+		for(i = 0; i < frames; i++){
+			while(frac >= 0x10000){
+				s0 = s1;
+				s1 = (s16)tab[src[(pos+n)&mask]];
+				n++;
+				frac -= 0x10000;
+			}
+			// s0*(1-w) + s1*w, w in Q14
+			w = frac >> 2;
+			y = pcm_smuad(pcm_pkhbt(s0, s1), pcm_pkhbt(16384 - w, w)) >> 14;
+			dst[i] = pcm_pkhbt(y, y);
+			frac += step;
+		}
+
+		pcm->frac = frac;
+		pcm->s0 = s0;
+		pcm->s1 = s1;
+		return n;
+	}
+
+	// history and phase in registers, dst may alias pcm as far as the compiler knows
+	w0 = pcm->hist.w[0];
+	w1 = pcm->hist.w[1];
+	w2 = pcm->hist.w[2];
+	w3 = pcm->hist.w[3];
+	phase = pcm->phase;
+	for(i = 0; i < frames; i++){
+		if(phase == 0){
+			// shift the history by one sample, newest into the low half of w0
+			w3 = (w3 << 16) | (w2 >> 16);
+			w2 = (w2 << 16) | (w1 >> 16);
+			w1 = (w1 << 16) | (w0 >> 16);
+			w0 = (w0 << 16) | (tab[src[(pos+n)&mask]] & 0xffff);
+			n++;
+		}
+
+		c = pcm->fir + phase*(G711_PCM_TAPS/2);
+		y = pcm_smlad(w0, c[0], 1 << 14);
+		y = pcm_smlad(w1, c[1], y);
+		y = pcm_smlad(w2, c[2], y);
+		y = pcm_smlad(w3, c[3], y);
+		y = pcm_ssat16(y >> 15);
+		dst[i] = pcm_pkhbt(y, y);
+
+		if(++phase == pcm->up)
+			phase = 0;
+	}
+
+	pcm->hist.w[0] = w0;
+	pcm->hist.w[1] = w1;
+	pcm->hist.w[2] = w2;
+	pcm->hist.w[3] = w3;
+	pcm->phase = phase;
+	return n;
+}
@@ -0,0 +1,46 @@
+#ifndef _G711_PCM_H
+#define _G711_PCM_H
+#include "basic_types.h"
+#include "g711_codec.h"
+
+/*
+ * G.711 to 16 bit interleaved stereo in one pass: table decode, channel
+ * duplication and an optional resampler, written straight into the I2S DMA
+ * page. Replaces G711_decoder() + mono2stereo() + the page copy.
+ *
+ * The source is a byte ring read at (pos + i) & mask, pass mask 0xffffffff
+ * for a linear buffer.
+ */
+
+#define G711_PCM_LINEAR		0	// linear interpolation, any ratio
+#define G711_PCM_POLYPHASE	1	// 8 tap FIR for out/in = 2, 3, 4 or 6, else linear
+
+#define G711_PCM_TAPS		8
+
+typedef struct _g711_pcm{
+	const u32*	tab;		// code -> same sample in both halves
+	u32			up;			// polyphase ratio, 1 = no resampling, 0 = linear
+	u32			step;		// linear: input samples per output, 16.16
+	u32			frac;		// linear: position after s0, 16.16
+	s16			s0;
+	s16			s1;
+	u32			phase;		// polyphase: next output phase
+	const u32*	fir;		// polyphase: up x G711_PCM_TAPS/2 coefficient pairs
+	union{
+		s16		s[G711_PCM_TAPS];	// newest first
+		u32		w[G711_PCM_TAPS/2];
+	}hist;
+}g711_pcm_t;
+
+// one sample, as G711_decoder() decodes it
+s16 g711_ulaw2linear(u8 u_val);
+s16 g711_alaw2linear(u8 a_val);
+
+// law is I2S_MODE_G711U or I2S_MODE_G711A, rates in Hz; return 0 or -1
+int g711_pcm_init(g711_pcm_t* pcm, int law, u32 in_rate, u32 out_rate, int resample);
+// input bytes the next g711_pcm_decode(frames) reads
+u32 g711_pcm_need(g711_pcm_t* pcm, u32 frames);
+// write frames L/R words to dst, return the input bytes read
+u32 g711_pcm_decode(g711_pcm_t* pcm, const u8* src, u32 mask, u32 pos, u32* dst, u32 frames);
+
+#endif
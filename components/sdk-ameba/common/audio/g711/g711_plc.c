@@ -0,0 +1,235 @@
+#include <platform/platform_stdlib.h>
+#include "g711_pcm.h"
+#include "g711_plc.h"
+
+// CCITT G.711 encoders, the inverse of g711_ulaw2linear/g711_alaw2linear
+static const s16 seg_uend[8] = {0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff, 0x1fff};
+static const s16 seg_aend[8] = {0x1f, 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff};
+
+static int seg_search(int val, const s16* end)
+{
+	int i;
+
+	for(i = 0; i < 8; i++)
+		if(val <= end[i])
+			break;
+	return i;
+}
+
+static u8 linear2ulaw(int pcm)
+{
+	int mask, seg;
+
+	pcm >>= 2;
+	if(pcm < 0){
+		pcm = -pcm;
+		mask = 0x7f;
+	}else
+		mask = 0xff;
+	if(pcm > 8159)
+		pcm = 8159;
+	pcm += 0x84 >> 2;
+	seg = seg_search(pcm, seg_uend);
+	if(seg >= 8)
+		return 0x7f ^ mask;
+	return ((seg << 4) | ((pcm >> (seg + 1)) & 0x0f)) ^ mask;
+}
+
+static u8 linear2alaw(int pcm)
+{
+	int mask, seg, aval;
+
+	pcm >>= 3;
+	if(pcm >= 0)
+		mask = 0xd5;
+	else{
+		mask = 0x55;
+		pcm = -pcm - 1;
+	}
+	seg = seg_search(pcm, seg_aend);
+	if(seg >= 8)
+		return 0x7f ^ mask;
+	aval = seg << 4;
+	aval |= (pcm >> (seg < 2 ? 1 : seg)) & 0x0f;
+	return aval ^ mask;
+}
+
+static inline s16 plc_dec(g711_plc_t* plc, u8 c)
+{
+	return plc->law == I2S_MODE_G711A ? g711_alaw2linear(c) : g711_ulaw2linear(c);
+}
+
+static inline u8 plc_enc(g711_plc_t* plc, int pcm)
+{
+	if(pcm > 32767)
+		pcm = 32767;
+	else if(pcm < -32768)
+		pcm = -32768;
+	return plc->law == I2S_MODE_G711A ? linear2alaw(pcm) : linear2ulaw(pcm);
+}
+
+// signed level straight from the code, monotonic in the sample value
+static inline int plc_level(g711_plc_t* plc, u8 c)
+{
+	if(plc->law == I2S_MODE_G711A){
+		c ^= 0x55;
+		return (c & 0x80) ? (c & 0x7f) : -(c & 0x7f);
+	}
+	c = ~c;
+	return (c & 0x80) ? -(c & 0x7f) : (c & 0x7f);
+}
+
+static void plc_hist_put(g711_plc_t* plc, const u8* src, int len)
+{
+	u32 part;
+
+	if(len > G711_PLC_HIST){
+		src += len - G711_PLC_HIST;
+		len = G711_PLC_HIST;
+	}
+	part = G711_PLC_HIST - plc->hist_pos;
+	if(part > len)
+		part = len;
+	memcpy(plc->hist + plc->hist_pos, src, part);
+	memcpy(plc->hist, src + part, len - part);
+	plc->hist_pos = (plc->hist_pos + len) % G711_PLC_HIST;
+}
+
+// the lag that best predicts the last G711_PLC_CORR samples, maximizing
+// corr^2 / energy; samples are scaled down so the sums fit
+static int plc_pitch(const s16* x)
+{
+	const s16* w = x + G711_PLC_HIST - G711_PLC_CORR;
+	u64 score, best_score = 0;
+	s64 corr, energy;
+	int p, i, best = G711_PLC_PITCH_MIN;
+
+	for(p = G711_PLC_PITCH_MIN; p <= G711_PLC_PITCH_MAX; p++){
+		corr = 0;
+		energy = 1;
+		for(i = 0; i < G711_PLC_CORR; i++){
+			corr += (w[i] >> 3) * (w[i - p] >> 3);
+			energy += (w[i - p] >> 3) * (w[i - p] >> 3);
+		}
+		if(corr <= 0)
+			continue;
+		score = (u64)corr * corr / (u64)energy;
+		if(score > best_score){
+			best_score = score;
+			best = p;
+		}
+	}
+	return best;
+}
+
+static void plc_start(g711_plc_t* plc)
+{
+	int i;
+
+	for(i = 0; i < G711_PLC_HIST; i++)
+		plc->buf[i] = plc_dec(plc, plc->hist[(plc->hist_pos + i) % G711_PLC_HIST]);
+	plc->pitch = plc_pitch(plc->buf);
+	plc->periods = 1;
+	plc->pos = 0;
+}
+
+// next sample of the repeated periods, the last quarter period of them
+// faded into the samples before the first so the loop has no step
+static int plc_next(g711_plc_t* plc)
+{
+	int len = plc->periods * plc->pitch, q = plc->pitch >> 2, j, x, n = plc->erased;
+	const s16* p = plc->buf + G711_PLC_HIST - len;
+
+	// more periods after 10 and 20 ms, at the same place in the signal
+	if((n == G711_PLC_ATT_START || n == 2 * G711_PLC_ATT_START) && plc->periods < 3){
+		plc->periods++;
+		plc->pos += plc->pitch;
+		len += plc->pitch;
+		p -= plc->pitch;
+	}
+
+	x = p[plc->pos];
+	j = plc->pos - (len - q);
+	if(j >= 0)
+		x = (x * (q - j) + p[j - q] * j) / q;
+	if(++plc->pos == len)
+		plc->pos = 0;
+
+	if(n >= G711_PLC_ATT_START + G711_PLC_ATT_LEN)
+		x = 0;
+	else if(n > G711_PLC_ATT_START)
+		x = x * (s32)(G711_PLC_ATT_START + G711_PLC_ATT_LEN - n) / G711_PLC_ATT_LEN;
+	plc->erased++;
+	return x;
+}
+
+void g711_plc_init(g711_plc_t* plc, int law)
+{
+	memset(plc, 0, sizeof(g711_plc_t));
+	plc->law = law;
+	memset(plc->hist, plc_enc(plc, 0), G711_PLC_HIST);
+}
+
+void g711_plc_good(g711_plc_t* plc, u8* frame, int len)
+{
+	int ola, j, x;
+
+	if(plc->erased){
+		ola = G711_PLC_OLA_MIN + (plc->erased - 1) / G711_PLC_ATT_START * G711_PLC_OLA_MIN;
+		if(ola > G711_PLC_OLA_MAX)
+			ola = G711_PLC_OLA_MAX;
+		if(ola > len)
+			ola = len;
+		for(j = 0; j < ola; j++){
+			x = plc_next(plc);
+			x += (plc_dec(plc, frame[j]) - x) * (j + 1) / (ola + 1);
+			frame[j] = plc_enc(plc, x);
+		}
+		plc->erased = 0;
+	}
+	plc_hist_put(plc, frame, len);
+}
+
+void g711_plc_conceal(g711_plc_t* plc, u8* out, int len)
+{
+	int i;
+
+	if(plc->erased == 0)
+		plc_start(plc);
+	for(i = 0; i < len; i++)
+		out[i] = plc_enc(plc, plc_next(plc));
+	plc_hist_put(plc, out, len);
+}
+
+// where removing or repeating a sample changes the signal least: the
+// neighbours are closest
+static int plc_flat(g711_plc_t* plc, const u8* frame, int len)
+{
+	int i, d, best = 1, best_d = 0x7fffffff;
+
+	for(i = 1; i < len - 1; i++){
+		d = plc_level(plc, frame[i + 1]) - plc_level(plc, frame[i - 1]);
+		if(d < 0)
+			d = -d;
+		if(d < best_d){
+			best_d = d;
+			best = i;
+		}
+	}
+	return best;
+}
+
+int g711_plc_adjust(g711_plc_t* plc, u8* frame, int len, int delta)
+{
+	int i;
+
+	for(; delta < 0 && len > 2; delta++, len--){
+		i = plc_flat(plc, frame, len);
+		memmove(frame + i, frame + i + 1, len - i - 1);
+	}
+	for(; delta > 0 && len > 2; delta--, len++){
+		i = plc_flat(plc, frame, len);
+		memmove(frame + i + 1, frame + i, len - i);
+	}
+	return len;
+}
@@ -0,0 +1,45 @@
+#ifndef _G711_PLC_H
+#define _G711_PLC_H
+#include "basic_types.h"
+#include "g711_codec.h"
+
+/*
+ * Packet loss concealment for 8 kHz G.711, after ITU-T G.711 Appendix I. A
+ * lost frame repeats the last pitch period played, then two and three of
+ * them so it does not buzz, faded out from 10 ms to 60 ms into the loss,
+ * and the next good frame is cross-faded in.
+ *
+ * Frames that arrive are only copied into the coded history; decoding
+ * happens when a loss starts and over the cross-fade.
+ */
+
+#define G711_PLC_HIST		390		// 48.75 ms, three of the longest periods and a quarter
+#define G711_PLC_PITCH_MIN	40		// 200 Hz
+#define G711_PLC_PITCH_MAX	120		// 66.7 Hz
+#define G711_PLC_CORR		160		// samples compared for the pitch
+#define G711_PLC_ATT_START	80		// 10 ms before fading out
+#define G711_PLC_ATT_LEN	400		// silent 50 ms later
+#define G711_PLC_OLA_MIN	32		// 4 ms cross-fade into a good frame after a loss
+#define G711_PLC_OLA_MAX	80		// 10 ms after long ones
+
+typedef struct _g711_plc{
+	int			law;			// I2S_MODE_G711U or I2S_MODE_G711A
+	u8			hist[G711_PLC_HIST];	// samples played, coded, a ring
+	u32			hist_pos;		// next written
+	s16			buf[G711_PLC_HIST];		// the history decoded when a loss starts
+	int			pitch;
+	int			periods;		// repeated, 1 to 3
+	int			pos;			// in the periods repeated
+	u32			erased;			// samples concealed in this loss
+}g711_plc_t;
+
+void g711_plc_init(g711_plc_t* plc, int law);
+// a received frame about to play, cross-faded in after a loss
+void g711_plc_good(g711_plc_t* plc, u8* frame, int len);
+// len samples to play for a lost frame
+void g711_plc_conceal(g711_plc_t* plc, u8* out, int len);
+// play frame delta samples longer (> 0) or shorter where the signal changes
+// least, it has room for len + delta. Return the new length
+int g711_plc_adjust(g711_plc_t* plc, u8* frame, int len, int delta);
+
+#endif
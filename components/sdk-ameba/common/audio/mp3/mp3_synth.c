@@ -0,0 +1,406 @@
+#include "platform_opts.h"
+#include <platform/platform_stdlib.h>
+#include "mp3_synth.h"
+
+#if defined(CONFIG_PLATFORM_8711B) && CONFIG_PLATFORM_8711B && !defined(CONFIG_PLATFORM_SIM) && !defined(MP3_SYNTH_NO_DSP)
+#include "arm_math.h"	// Cortex-M4: SMMUL, SSAT
+static inline s32 mulshift32(s32 a, s32 b)
+{
+	q31_t r;
+
+	mult_32x32_keep32(r, a, b);
+	return r;
+}
+
+#define synth_sat16(v)			__SSAT(v, 16)
+#else
+// SMULL on the Cortex-M3, and what SMMUL gives
+static inline s32 mulshift32(s32 a, s32 b)
+{
+	return (s32)(((s64)a * b) >> 32);
+}
+
+static inline s32 synth_sat16(s32 v)
+{
+	return v > 32767 ? 32767 : v < -32768 ? -32768 : v;
+}
+#endif
+
+#define MUL31(a, b)			((s32)(((s64)(a) * (b)) >> 31))
+#define MUL27(a, b)			((s32)(((s64)(a) * (b)) >> 27))
+
+// the IMDCT and its window take 1/8, the subband samples are Q(FRAC - 3);
+// times the Q14 window they are 14 bits above the Q15 PCM
+#define SB_FRAC				(MP3_SYNTH_FRAC - 3)
+#define PCM_SHIFT			(SB_FRAC + 14 - 15)
+
+#define SIN_2PI_3			0x6ed9eba1
+#define COS_PI_4			0x5a82799a
+
+// alias reduction butterflies 1/sqrt(1 + c*c) and c/sqrt(1 + c*c), Q31
+static const s32 aa_cs[8] = {
+	0x6dc25404, 0x70dcebf9, 0x798d6e7c, 0x7ddd40a8,
+	0x7f6d20b7, 0x7fe47e40, 0x7ffcb263, 0x7fffc695,
+};
+
+static const s32 aa_ca[8] = {
+	-0x41daff36, -0x3c61b691, -0x281cc09f, -0x1748ee86,
+	-0x0c1b01d4, -0x053e5c37, -0x01d1423a, -0x00793da3,
+};
+
+// DCT-IV 18 through a 9 point FFT: cos, sin of pi (4n + 1) / 72 before,
+// of pi k / 18 after, Q31
+static const s32 imdct36_pre[9*2] = {
+	0x7fe0cfe7, 0x059551f1, 0x7cf7447f, 0x1bb44b14, 0x7641af3d, 0x30fbc54d,
+	0x6bf4403b, 0x44c63bcb, 0x5e5f1a91, 0x5679bd6c, 0x4debe4fe, 0x658c9a2d,
+	0x3b1a941c, 0x7189922c, 0x267d8713, 0x7a1365a5, 0x10b5150f, 0x7ee7aa4c,
+};
+
+static const s32 imdct36_post[9*2] = {
+	0x7fffffff, 0x00000000, 0x7e0e2e32, 0x163a1a7e, 0x7847d909, 0x2bc750e9,
+	0x6ed9eba1, 0x40000000, 0x620dbe8b, 0x5246dd49, 0x5246dd49, 0x620dbe8b,
+	0x40000000, 0x6ed9eba1, 0x2bc750e9, 0x7847d909, 0x163a1a7e, 0x7e0e2e32,
+};
+
+// cos, sin of 2 pi e / 9 for e = 1, 2, 4
+static const s32 fft9_tw[3*2] = {
+	0x620dbe8b, 0x5246dd49, 0x163a1a7e, 0x7e0e2e32, -0x7847d909, 0x2bc750e9,
+};
+
+// windows of block types 0, 1 and 3, and of a short block, Q31. Negated
+// where the IMDCT output is -u
+static const s32 imdct36_win[3][36] = {
+	{
+		0x059551f1, 0x10b5150f, 0x1bb44b14, 0x267d8713, 0x30fbc54d, 0x3b1a941c,
+		0x44c63bcb, 0x4debe4fe, 0x5679bd6c, -0x5e5f1a91, -0x658c9a2d, -0x6bf4403b,
+		-0x7189922c, -0x7641af3d, -0x7a1365a5, -0x7cf7447f, -0x7ee7aa4c, -0x7fe0cfe7,
+		-0x7fe0cfe7, -0x7ee7aa4c, -0x7cf7447f, -0x7a1365a5, -0x7641af3d, -0x7189922c,
+		-0x6bf4403b, -0x658c9a2d, -0x5e5f1a91, -0x5679bd6c, -0x4debe4fe, -0x44c63bcb,
+		-0x3b1a941c, -0x30fbc54d, -0x267d8713, -0x1bb44b14, -0x10b5150f, -0x059551f1,
+	},
+	{
+		0x059551f1, 0x10b5150f, 0x1bb44b14, 0x267d8713, 0x30fbc54d, 0x3b1a941c,
+		0x44c63bcb, 0x4debe4fe, 0x5679bd6c, -0x5e5f1a91, -0x658c9a2d, -0x6bf4403b,
+		-0x7189922c, -0x7641af3d, -0x7a1365a5, -0x7cf7447f, -0x7ee7aa4c, -0x7fe0cfe7,
+		-0x7fffffff, -0x7fffffff, -0x7fffffff, -0x7fffffff, -0x7fffffff, -0x7fffffff,
+		-0x7ee7aa4c, -0x7641af3d, -0x658c9a2d, -0x4debe4fe, -0x30fbc54d, -0x10b5150f,
+		0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+	},
+	{
+		0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+		0x10b5150f, 0x30fbc54d, 0x4debe4fe, -0x658c9a2d, -0x7641af3d, -0x7ee7aa4c,
+		-0x7fffffff, -0x7fffffff, -0x7fffffff, -0x7fffffff, -0x7fffffff, -0x7fffffff,
+		-0x7fe0cfe7, -0x7ee7aa4c, -0x7cf7447f, -0x7a1365a5, -0x7641af3d, -0x7189922c,
+		-0x6bf4403b, -0x658c9a2d, -0x5e5f1a91, -0x5679bd6c, -0x4debe4fe, -0x44c63bcb,
+		-0x3b1a941c, -0x30fbc54d, -0x267d8713, -0x1bb44b14, -0x10b5150f, -0x059551f1,
+	},
+};
+
+static const s32 imdct12_win[12] = {
+	0x10b5150f, 0x30fbc54d, 0x4debe4fe, -0x658c9a2d, -0x7641af3d, -0x7ee7aa4c,
+	-0x7ee7aa4c, -0x7641af3d, -0x658c9a2d, -0x4debe4fe, -0x30fbc54d, -0x10b5150f,
+};
+
+// DCT-IV 6, cos(pi (2q + 1)(2m + 1) / 24), Q31
+static const s32 dct4_6[6*6] = {
+	0x7ee7aa4c, 0x7641af3d, 0x658c9a2d, 0x4debe4fe, 0x30fbc54d, 0x10b5150f,
+	0x7641af3d, 0x30fbc54d, -0x30fbc54d, -0x7641af3d, -0x7641af3d, -0x30fbc54d,
+	0x658c9a2d, -0x30fbc54d, -0x7ee7aa4c, -0x10b5150f, 0x7641af3d, 0x4debe4fe,
+	0x4debe4fe, -0x7641af3d, -0x10b5150f, 0x7ee7aa4c, -0x30fbc54d, -0x658c9a2d,
+	0x30fbc54d, -0x7641af3d, 0x7641af3d, -0x30fbc54d, -0x30fbc54d, 0x7641af3d,
+	0x10b5150f, -0x30fbc54d, 0x4debe4fe, -0x658c9a2d, 0x7641af3d, -0x7ee7aa4c,
+};
+
+// Lee's DCT-II: 1/(2 cos(pi (2i + 1) / 2n)) for n = 32, 16, 8, 4, Q27
+static const s32 dct32_coef[16+8+4+2] = {
+	0x04013c25, 0x040b345c, 0x041fa2d7, 0x043f9342, 0x046cc1bc, 0x04a9d9cf,
+	0x04fae371, 0x056601ea, 0x05f4cf6f, 0x06b6fcf2, 0x07c7d1db, 0x095b0353,
+	0x0bdf91b3, 0x107655e4, 0x1b42c834, 0x518522fb, 0x0404f467, 0x042e13c1,
+	0x048919f4, 0x052cb0e6, 0x064e2403, 0x087c4495, 0x0dc79258, 0x28cf2702,
+	0x04140fb4, 0x04cf8de8, 0x073326bc, 0x1480d9d0, 0x04545e9f, 0x0a73d749,
+};
+
+const s16 mp3_synth_window[512] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1,
+	-1, -1, -2, -2, -2, -2, -2, -3, -3, -3, -4, -4, -5, -5, -6, -6,
+	-7, -8, -9, -9, -10, -11, -12, -13, -14, -16, -17, -18, -20, -21, -23, -24,
+	-26, -28, -29, -31, -33, -35, -37, -38, -40, -42, -44, -46, -47, -49, -50, -52,
+	53, 55, 56, 56, 57, 57, 57, 57, 56, 55, 54, 52, 50, 47, 44, 41,
+	37, 32, 27, 21, 14, 7, 0, -9, -18, -28, -38, -49, -61, -73, -87, -100,
+	-115, -130, -145, -161, -178, -195, -212, -230, -248, -266, -284, -302, -321, -339, -357, -374,
+	-392, -408, -424, -440, -454, -467, -480, -490, -500, -508, -514, -519, -521, -522, -520, -516,
+	509, 500, 488, 473, 456, 435, 411, 384, 354, 320, 283, 243, 199, 151, 101, 46,
+	-11, -72, -136, -203, -274, -347, -423, -501, -582, -666, -751, -838, -926, -1016, -1106, -1197,
+	-1288, -1379, -1470, -1559, -1647, -1734, -1818, -1899, -1977, -2052, -2123, -2189, -2249, -2305, -2354, -2396,
+	-2432, -2459, -2479, -2490, -2491, -2484, -2466, -2437, -2398, -2347, -2285, -2210, -2123, -2023, -1910, -1783,
+	1644, 1490, 1322, 1140, 944, 734, 509, 271, 18, -249, -530, -825, -1133, -1454, -1788, -2135,
+	-2494, -2864, -3245, -3637, -4039, -4450, -4869, -5297, -5732, -6173, -6620, -7072, -7528, -7987, -8448, -8910,
+	-9372, -9834, -10294, -10751, -11205, -11654, -12097, -12534, -12963, -13383, -13794, -14194, -14583, -14959, -15322, -15671,
+	-16005, -16322, -16623, -16907, -17173, -17420, -17647, -17855, -18042, -18209, -18354, -18477, -18578, -18657, -18714, -18748,
+	18760, 18748, 18714, 18657, 18578, 18477, 18354, 18209, 18042, 17855, 17647, 17420, 17173, 16907, 16623, 16322,
+	16005, 15671, 15322, 14959, 14583, 14194, 13794, 13383, 12963, 12534, 12097, 11654, 11205, 10751, 10294, 9834,
+	9372, 8910, 8448, 7987, 7528, 7072, 6620, 6173, 5732, 5297, 4869, 4450, 4039, 3637, 3245, 2864,
+	2494, 2135, 1788, 1454, 1133, 825, 530, 249, -18, -271, -509, -734, -944, -1140, -1322, -1490,
+	1644, 1783, 1910, 2023, 2123, 2210, 2285, 2347, 2398, 2437, 2466, 2484, 2491, 2490, 2479, 2459,
+	2432, 2396, 2354, 2305, 2249, 2189, 2123, 2052, 1977, 1899, 1818, 1734, 1647, 1559, 1470, 1379,
+	1288, 1197, 1106, 1016, 926, 838, 751, 666, 582, 501, 423, 347, 274, 203, 136, 72,
+	11, -46, -101, -151, -199, -243, -283, -320, -354, -384, -411, -435, -456, -473, -488, -500,
+	509, 516, 520, 522, 521, 519, 514, 508, 500, 490, 480, 467, 454, 440, 424, 408,
+	392, 374, 357, 339, 321, 302, 284, 266, 248, 230, 212, 195, 178, 161, 145, 130,
+	115, 100, 87, 73, 61, 49, 38, 28, 18, 9, 0, -7, -14, -21, -27, -32,
+	-37, -41, -44, -47, -50, -52, -54, -55, -56, -57, -57, -57, -57, -56, -56, -55,
+	53, 52, 50, 49, 47, 46, 44, 42, 40, 38, 37, 35, 33, 31, 29, 28,
+	26, 24, 23, 21, 20, 18, 17, 16, 14, 13, 12, 11, 10, 9, 9, 8,
+	7, 6, 6, 5, 5, 4, 4, 3, 3, 3, 2, 2, 2, 2, 2, 1,
+	1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static void antialias(s32* xr, int sblimit)
+{
+	s32* a;
+	s32* b;
+	s32 u, d;
+	int sb, i;
+
+	for(sb = 1; sb < sblimit; sb++){
+		a = xr + sb * 18 - 1;
+		b = xr + sb * 18;
+		for(i = 0; i < 8; i++){
+			u = a[-i];
+			d = b[i];
+			a[-i] = (s32)(((s64)u * aa_cs[i] - (s64)d * aa_ca[i]) >> 31);
+			b[i] = (s32)(((s64)d * aa_cs[i] + (s64)u * aa_ca[i]) >> 31);
+		}
+	}
+}
+
+// 3 point DFT of x[0], x[s], x[2s] to y[0], y[o], y[2o]
+static inline void dft3(const s32* xr, const s32* xi, int s, s32* yr, s32* yi, int o)
+{
+	s32 sr = xr[s] + xr[2*s], si = xi[s] + xi[2*s];
+	s32 dr = MUL31(xr[s] - xr[2*s], SIN_2PI_3), di = MUL31(xi[s] - xi[2*s], SIN_2PI_3);
+	s32 tr = xr[0] - (sr >> 1), ti = xi[0] - (si >> 1);
+
+	yr[0] = xr[0] + sr;
+	yi[0] = xi[0] + si;
+	yr[o] = tr + di;
+	yi[o] = ti - dr;
+	yr[2*o] = tr - di;
+	yi[2*o] = ti + dr;
+}
+
+static inline void twiddle(s32* r, s32* i, const s32* w)
+{
+	s32 t = (s32)(((s64)*r * w[0] + (s64)*i * w[1]) >> 31);
+
+	*i = (s32)(((s64)*i * w[0] - (s64)*r * w[1]) >> 31);
+	*r = t;
+}
+
+// 9 point FFT as 3 x 3: n = 3 n1 + n2, k = k1 + 3 k2
+static void fft9(s32* re, s32* im)
+{
+	s32 ar[9], ai[9];
+	int i;
+
+	for(i = 0; i < 3; i++)
+		dft3(re + i, im + i, 3, ar + 3*i, ai + 3*i, 1);
+	twiddle(&ar[4], &ai[4], fft9_tw);
+	twiddle(&ar[5], &ai[5], fft9_tw + 2);
+	twiddle(&ar[7], &ai[7], fft9_tw + 2);
+	twiddle(&ar[8], &ai[8], fft9_tw + 4);
+	for(i = 0; i < 3; i++)
+		dft3(ar + i, ai + i, 3, re + i, im + i, 3);
+}
+
+// 36 point IMDCT of x[18], windowed, added to the overlap into out[18]; its
+// second half is the next overlap. Output is 1/8 of the input scale
+static void imdct36(const s32* x, s32* out, s32* ov, const s32* win)
+{
+	s32 re[9], im[9], u[18], r, i;
+	int n;
+
+	// DCT-IV: u[k] = sum x[m] cos(pi (2k + 1)(2m + 1) / 72)
+	for(n = 0; n < 9; n++){
+		r = x[2*n];
+		i = x[17 - 2*n];
+		re[n] = mulshift32(r, imdct36_pre[2*n]) + mulshift32(i, imdct36_pre[2*n + 1]);
+		im[n] = mulshift32(i, imdct36_pre[2*n]) - mulshift32(r, imdct36_pre[2*n + 1]);
+	}
+	fft9(re, im);
+	for(n = 0; n < 9; n++){
+		u[2*n] = mulshift32(re[n], imdct36_post[2*n]) + mulshift32(im[n], imdct36_post[2*n + 1]);
+		u[17 - 2*n] = mulshift32(re[n], imdct36_post[2*n + 1]) - mulshift32(im[n], imdct36_post[2*n]);
+	}
+
+	// y[0..8] = u[9..17], y[9..26] = -u[17..0], y[27..35] = -u[0..8]
+	for(n = 0; n < 9; n++){
+		out[n] = ov[n] + mulshift32(u[9 + n], win[n]);
+		out[9 + n] = ov[9 + n] + mulshift32(u[17 - n], win[9 + n]);
+		ov[n] = mulshift32(u[8 - n], win[18 + n]);
+		ov[9 + n] = mulshift32(u[n], win[27 + n]);
+	}
+}
+
+// three 12 point IMDCTs at 6, 12 and 18 of the 36, the same scale
+static void imdct12(const s32* x, s32* out, s32* ov)
+{
+	s32 z[24], u[6];
+	s32* p;
+	s64 acc;
+	int w, q, m;
+
+	memset(z, 0, sizeof(z));
+	for(w = 0; w < 3; w++){
+		for(q = 0; q < 6; q++){
+			acc = 0;
+			for(m = 0; m < 6; m++)
+				acc += (s64)x[w + 3*m] * dct4_6[6*q + m];
+			u[q] = (s32)(acc >> 33);
+		}
+		// y[0..2] = u[3..5], y[3..8] = -u[5..0], y[9..11] = -u[0..2]
+		p = z + 6*w;
+		for(q = 0; q < 3; q++){
+			p[q] += mulshift32(u[3 + q], imdct12_win[q]);
+			p[3 + q] += mulshift32(u[5 - q], imdct12_win[3 + q]);
+			p[6 + q] += mulshift32(u[2 - q], imdct12_win[6 + q]);
+			p[9 + q] += mulshift32(u[q], imdct12_win[9 + q]);
+		}
+	}
+
+	for(q = 0; q < 6; q++)
+		out[q] = ov[q];
+	for(q = 6; q < 18; q++)
+		out[q] = ov[q] + z[q - 6];
+	for(q = 0; q < 12; q++)
+		ov[q] = z[12 + q];
+	for(q = 12; q < 18; q++)
+		ov[q] = 0;
+}
+
+void mp3_synth_init(mp3_synth_t* s)
+{
+	memset(s, 0, sizeof(mp3_synth_t));
+}
+
+void mp3_synth_hybrid(mp3_synth_t* s, int ch, s32* xr, int block_type, int mixed)
+{
+	mp3_synth_ch_t* c = &s->ch[ch];
+	s32 out[MP3_SYNTH_SSLIMIT];
+	s32* ov;
+	int sb, i, n, bt;
+
+	// subbands with coded lines; alias reduction spreads them one up
+	for(n = MP3_SYNTH_GRANULE; n > 0 && xr[n - 1] == 0; n--);
+	n = (n + 17) / 18;
+	if(n > 0 && block_type != 2){
+		n = n < MP3_SYNTH_SBLIMIT ? n + 1 : n;
+		antialias(xr, n);
+	}else if(n > 0 && mixed){
+		n = n < 2 ? 2 : n;
+		antialias(xr, 2);
+	}
+
+	for(sb = 0; sb < MP3_SYNTH_SBLIMIT; sb++){
+		ov = c->overlap[sb];
+		if(sb >= n){
+			for(i = 0; i < MP3_SYNTH_SSLIMIT; i++){
+				out[i] = ov[i];
+				ov[i] = 0;
+			}
+		}else{
+			bt = (mixed && sb < 2) ? 0 : block_type;
+			if(bt == 2)
+				imdct12(xr + sb * 18, out, ov);
+			else
+				imdct36(xr + sb * 18, out, ov, imdct36_win[bt == 0 ? 0 : bt == 1 ? 1 : 2]);
+		}
+		// frequency inversion of the odd subbands
+		for(i = 0; i < MP3_SYNTH_SSLIMIT; i++)
+			s->sb[i][sb] = (sb & i & 1) ? -out[i] : out[i];
+	}
+}
+
+// X[k] = sum x[i] cos(pi (2i + 1) k / 2n) in place, Lee's recursion
+static void dct32(s32* x, s32* tmp, int n, const s32* coef)
+{
+	int h = n >> 1, i;
+	s32 a, b;
+
+	if(n == 2){
+		a = x[0];
+		b = x[1];
+		x[0] = a + b;
+		x[1] = MUL31(a - b, COS_PI_4);
+		return;
+	}
+	for(i = 0; i < h; i++){
+		tmp[i] = x[i] + x[n - 1 - i];
+		tmp[h + i] = MUL27(x[i] - x[n - 1 - i], coef[i]);
+	}
+	dct32(tmp, x, h, coef + h);
+	dct32(tmp + h, x, h, coef + h);
+	for(i = 0; i < h - 1; i++){
+		x[2*i] = tmp[i];
+		x[2*i + 1] = tmp[h + i] + tmp[h + i + 1];
+	}
+	x[n - 2] = tmp[h - 1];
+	x[n - 1] = tmp[n - 1];
+}
+
+static inline s16 synth_pcm(s64 acc)
+{
+	return synth_sat16((s32)((acc + (1 << (PCM_SHIFT - 1))) >> PCM_SHIFT));
+}
+
+/*
+ * V[i] = X[16 + i] for i < 16, 0 at 16, -X[48 - i] up to 47 and -X[i - 48]
+ * above, with X the DCT-II of the slot. Output j takes V[j] of the even
+ * slots and V[32 + j] of the odd ones (U of the standard), so j and 32 - j
+ * both read X[16 + j] and X[16 - j].
+ */
+void mp3_synth_polyphase(mp3_synth_t* s, int ch, s16* pcm, int stride)
+{
+	mp3_synth_ch_t* c = &s->ch[ch];
+	const s32* v[16];
+	const s16* d;
+	s32 tmp[MP3_SYNTH_SBLIMIT], e, o;
+	s32* x;
+	s64 a0, a1;
+	int ts, t, j;
+
+	for(ts = 0; ts < MP3_SYNTH_SSLIMIT; ts++, pcm += MP3_SYNTH_SBLIMIT * stride){
+		c->v_head = (c->v_head - 1) & 15;
+		x = c->v[c->v_head];
+		memcpy(x, s->sb[ts], MP3_SYNTH_SBLIMIT * sizeof(s32));
+		dct32(x, tmp, MP3_SYNTH_SBLIMIT, dct32_coef);
+		for(t = 0; t < 16; t++)
+			v[t] = c->v[(c->v_head + t) & 15];
+
+		a0 = a1 = 0;
+		for(t = 0, d = mp3_synth_window; t < 8; t++, d += 64){
+			a0 += (s64)v[2*t][16] * d[0] - (s64)v[2*t + 1][16] * d[32];
+			a1 -= (s64)v[2*t + 1][0] * d[48];
+		}
+		pcm[0] = synth_pcm(a0);
+		pcm[16 * stride] = synth_pcm(a1);
+
+		for(j = 1; j < 16; j++){
+			a0 = a1 = 0;
+			for(t = 0, d = mp3_synth_window; t < 8; t++, d += 64){
+				e = v[2*t][16 + j];
+				o = v[2*t + 1][16 - j];
+				a0 += (s64)e * d[j] - (s64)o * d[32 + j];
+				a1 -= (s64)e * d[32 - j] + (s64)o * d[64 - j];
+			}
+			pcm[j * stride] = synth_pcm(a0);
+			pcm[(32 - j) * stride] = synth_pcm(a1);
+		}
+	}
+}
+
+void mp3_synth_granule(mp3_synth_t* s, int ch, s32* xr, int block_type, int mixed, s16* pcm, int stride)
+{
+	mp3_synth_hybrid(s, ch, xr, block_type, mixed);
+	mp3_synth_polyphase(s, ch, pcm, stride);
+}
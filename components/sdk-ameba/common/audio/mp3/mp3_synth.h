@@ -0,0 +1,50 @@
+#ifndef _MP3_SYNTH_H
+#define _MP3_SYNTH_H
+#include "basic_types.h"
+
+/*
+ * Layer III hybrid synthesis in fixed point, the part of an MP3 decoder that
+ * runs on every sample: alias reduction, IMDCT with overlap-add, and the 32
+ * band polyphase synthesis filterbank, from the requantized spectrum of one
+ * granule to 576 PCM samples. Only integer tables, no libm.
+ *
+ * The IMDCT computes its 18 point DCT-IV through a 9 point complex FFT, and
+ * the filterbank a 32 point DCT-II by Lee's recursion. The filterbank keeps
+ * that DCT's 32 outputs per time slot instead of the 64 of V, and folds the
+ * symmetries of V into the window: outputs j and 32 - j read the same
+ * values, so each slot is 504 multiply-accumulates into 64 bit.
+ *
+ * Short blocks are reordered as the standard does, line m of window w at
+ * 3 * m + w of its subband.
+ */
+
+#define MP3_SYNTH_FRAC			25		// xr: 1.0 is 1 << 25
+#define MP3_SYNTH_SBLIMIT		32
+#define MP3_SYNTH_SSLIMIT		18
+#define MP3_SYNTH_GRANULE		(MP3_SYNTH_SBLIMIT * MP3_SYNTH_SSLIMIT)
+
+typedef struct _mp3_synth_ch{
+	s32			overlap[MP3_SYNTH_SBLIMIT][MP3_SYNTH_SSLIMIT];
+	s32			v[16][32];		// DCT outputs of the last 16 slots, v_head newest
+	int			v_head;
+}mp3_synth_ch_t;
+
+typedef struct _mp3_synth{
+	mp3_synth_ch_t	ch[2];
+	s32			sb[MP3_SYNTH_SSLIMIT][MP3_SYNTH_SBLIMIT];	// subband samples of the granule
+}mp3_synth_t;
+
+// ISO 11172-3 synthesis window D[i] in Q14
+extern const s16 mp3_synth_window[512];
+
+void mp3_synth_init(mp3_synth_t* s);
+// xr (576 lines, MP3_SYNTH_FRAC) to the subband samples in s->sb; xr is
+// alias reduced in place. block_type is 0 to 3 as in the side info, mixed
+// for block type 2 with long blocks in subbands 0 and 1
+void mp3_synth_hybrid(mp3_synth_t* s, int ch, s32* xr, int block_type, int mixed);
+// s->sb to 576 samples at pcm[i * stride]
+void mp3_synth_polyphase(mp3_synth_t* s, int ch, s16* pcm, int stride);
+// both, for one granule of one channel
+void mp3_synth_granule(mp3_synth_t* s, int ch, s32* xr, int block_type, int mixed, s16* pcm, int stride);
+
+#endif
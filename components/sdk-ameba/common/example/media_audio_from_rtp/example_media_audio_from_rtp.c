@@ -4,11 +4,14 @@
 
 #include "mmf_source.h"
 #include "mmf_sink.h"
+#include "rtp_jitter.h"
 
 void example_media_audio_from_rtp_main(void* param)
 {
  
         int con = 1;
+        int ticks = 0;
+        rtp_jitter_stats_t jb;
 	msink_context *msink_ctx;
 	msrc_context *msrc_ctx;
 	
@@ -46,6 +49,10 @@ void example_media_audio_from_rtp_main(void* param)
         while(con)
         {
             vTaskDelay(100);
+            // jitter buffer every 10s
+            if(++ticks % 100 == 0 && mmf_source_ctrl(msrc_ctx, CMD_GET_JITTER_STATS, (int)&jb) == 0)
+                printf("\n\rrtp: delay %dms target %dms jitter %dms, lost %d late %d underflow %d dropped %d",
+                        jb.delay, jb.target, jb.jitter, jb.lost, jb.late, jb.underflow, jb.dropped);
         }
 	mmf_sink_ctrl(msink_ctx, CMD_SET_STREAMMING, OFF);
         mmf_source_ctrl(msrc_ctx, CMD_SET_PRIV_BUF, 0);        
@@ -1,4 +1,3 @@
-
 /*
 * uvc video capture example
 */
@@ -9,101 +8,137 @@
 #include <fatfs_ext/inc/ff_driver.h>
 #include "sdio_host.h"
 #include <disk_if/inc/sdcard.h>
+#include "tl_mux.h"
+
+#define TL_CAPTURE_MS    2000
+#define TL_SESSION_MAX   1000
+
+static FATFS tl_fs;
+static FIL tl_file;
+static FIL tl_index;
+static tl_mux_t tl_mux;
+
+/* frames are kept when 1% of the 16x16 cells moved by 8 levels of luma, and
+ * once a minute when nothing moves */
+static const tl_config_t tl_cfg = {
+  .width = 640,
+  .height = 480,
+  .cell_log2 = 1,
+  .level = 8,
+  .permille = 10,
+  .max_gap_ms = 60000,
+  .write_block = 32768,
+  .sync_ms = 10000,
+};
+
+static void tl_path(char* path, const char* drv, int n, const char* ext)
+{
+  sprintf(path, "%stl%03d.%s", drv, n, ext);
+}
+
+/* a session left by a power cut is cut back to the frames its index has */
+static void example_tl_recover(const char* drv, int n)
+{
+  char path[32];
+  int kept;
+
+  tl_path(path, drv, n, "mjp");
+  if(f_open(&tl_file, path, FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK)
+    return;
+  tl_path(path, drv, n, "idx");
+  if(f_open(&tl_index, path, FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK){
+    f_close(&tl_file);
+    return;
+  }
+  kept = tl_mux_recover(&tl_file, &tl_index);
+  if(kept < 0)
+    printf("\r\n tl%03d: no index\n", n);
+  else
+    printf("\r\n tl%03d: %d frames\n", n, kept);
+  f_close(&tl_index);
+  f_close(&tl_file);
+}
+
+/* the first free tl<n>.mjp and tl<n>.idx pair */
+static int example_tl_open(const char* drv)
+{
+  char path[32];
+  FILINFO fno;
+  int n;
+
+  memset(&fno, 0, sizeof(fno));
+  for(n = 0; n < TL_SESSION_MAX; n++){
+    tl_path(path, drv, n, "idx");
+    if(f_stat(path, &fno) != FR_OK)
+      break;
+  }
+  if(n == TL_SESSION_MAX)
+    return -1;
+  if(n > 0)
+    example_tl_recover(drv, n - 1);
+
+  tl_path(path, drv, n, "mjp");
+  if(f_open(&tl_file, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    return -1;
+  tl_path(path, drv, n, "idx");
+  if(f_open(&tl_index, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK){
+    f_close(&tl_file);
+    return -1;
+  }
+  printf("\r\n Recording to %s\n", path);
+  return n;
+}
+
+void example_media_tl_main(void *param)
+{
+  printf("\r\n Enter Timelapse Example\n");
+  int err = 0;
+  int drv_num = -1;
+  char logical_drv[4]; /* root diretor */
+  u8 *tl_buf = NULL;
+  u32 tl_buf_size = tl_mux_buf_size(&tl_cfg);
+  tl_stats_t st;
+  struct uvc_context *uvc_ctx;
+  int ret = 0;
+  struct uvc_buf_context buf;  /* Global, need to change*/
+  /*Creating AV Packet for conversion*/
+  AVFrame in_Frame;
 
-void example_tl_fatfs_thread(unsigned char* write_buf, const int write_buf_len, const int iter){
-  
-  u8 *tl_WRBuf;
-  const int sizeof_write_buf = ( write_buf_len*(sizeof(u8)) );
-  tl_WRBuf = (u8*)malloc(sizeof_write_buf);
-  int drv_num = 0;
-  int Fatfs_ok = 0;
-  FRESULT res; 
-  FATFS 	m_fs;
-  FIL		m_file;
-  char	  logical_drv[4]; /* root diretor */
- 
-  char f_num[15];
-  sprintf(f_num, "%d", iter);
-  char filename[64] = "img";
-  strcat(filename,f_num);
-  strcat(filename,".jpeg");
-  char path[64];
-  int bw;
-  int test_result = 1;
-  // Set sdio debug level
-  DBG_INFO_MSG_OFF(_DBG_SDIO_);  
+  /* SD card is mounted once, frames go to one file through tl_mux */
+  DBG_INFO_MSG_OFF(_DBG_SDIO_);
   DBG_WARN_MSG_OFF(_DBG_SDIO_);
   DBG_ERR_MSG_ON(_DBG_SDIO_);
   if(sdio_init_host()!=0){
     printf("SDIO host init fail.\n");
     exit(NULL);
   }
-  //1 register disk driver to fatfs
   drv_num = FATFS_RegisterDiskDriver(&SD_disk_Driver);
-  if(drv_num < 0)
+  if(drv_num < 0){
     printf("Rigester disk driver to FATFS fail.\n");
-  else{
-    Fatfs_ok = 1;
-    logical_drv[0] = drv_num + '0';
-    logical_drv[1] = ':';
-    logical_drv[2] = '/';
-    logical_drv[3] = 0;
+    goto fail_sd;
   }
-  //1 Fatfs write 
-  if(Fatfs_ok){
-    if(f_mount(&m_fs, logical_drv, 1)!= FR_OK){
-      printf("FATFS mount logical drive fail.\n");
-      goto fail;
-    }
-    // write and read test
-    strcpy(path, logical_drv);
-    sprintf(&path[strlen(path)],"%s",filename);
-    //Open source file
-    res = f_open(&m_file, path, FA_OPEN_ALWAYS | FA_READ | FA_WRITE);
-    if(res){
-      printf("open file (%s) fail.\n", filename);
-      goto fail;
-    }
-    printf("Test file name:%s\n\n",filename);
-    DWORD size;
-    size = (&m_file)->fsize;
-    res = f_lseek(&m_file,size);
-    if(res){
-        f_lseek(&m_file, 0); 
-        printf("file Seek error.\n");
-      }
-    // clean write and read buffer
-    memset(tl_WRBuf, 0x00, write_buf_len);
-    memcpy(tl_WRBuf, write_buf, write_buf_len);
-    do{
-      res = f_write(&m_file, tl_WRBuf, sizeof_write_buf, (u32*)&bw);
-      if(res){
-        f_lseek(&m_file, 0); 
-        printf("Write error.\n");
-      }
-      printf("Write %d bytes.\n", bw);
-    } while (bw < strlen(tl_WRBuf));
-    // close source file
-    res = f_close(&m_file);
-    if(res)
-      printf("close file (%s) fail.\n", filename);
-    if(f_mount(NULL, logical_drv, 1) != FR_OK)
-      printf("FATFS unmount logical drive fail.\n");
-    if(FATFS_UnRegisterDiskDriver(drv_num))	
-      printf("Unregister disk driver from FATFS fail.\n");
+  logical_drv[0] = drv_num + '0';
+  logical_drv[1] = ':';
+  logical_drv[2] = '/';
+  logical_drv[3] = 0;
+  if(f_mount(&tl_fs, logical_drv, 1)!= FR_OK){
+    printf("FATFS mount logical drive fail.\n");
+    goto fail_mount;
+  }
+  tl_buf = (u8*)malloc(tl_buf_size);
+  if(!tl_buf){
+    printf("\n Time-lapse buffer allocation failed \n");
+    goto fail_buf;
+  }
+  if(example_tl_open(logical_drv) < 0){
+    printf("\n Unable to open time-lapse files \n");
+    goto fail_open;
+  }
+  if(tl_mux_open(&tl_mux, &tl_file, &tl_index, &tl_cfg, tl_buf, tl_buf_size) != FR_OK){
+    printf("\n Unable to start time-lapse recording \n");
+    goto fail_mux;
   }
-fail:
-  sdio_deinit_host();
-  
-  free(tl_WRBuf);
-}
-
 
-void example_media_tl_main(void *param)
-{
-  printf("\r\n Enter Timelapse Example\n");
-  int err = 0;
-  
   /*init usb driver prior to init uvc driver*/
   _usb_init();
   if(wait_usb_ready() < 0){
@@ -115,16 +150,16 @@ void example_media_tl_main(void *param)
     printf("\n Unable to initialize UVC Stream \n");
     exit(NULL);
   }
-  struct uvc_context *uvc_ctx = malloc(sizeof(struct uvc_context)); //Creation of UVC Context
+  uvc_ctx = malloc(sizeof(struct uvc_context)); //Creation of UVC Context
   if(!uvc_ctx){
     printf("\n UVC Context Creation Failed \n");
     exit(NULL);
   }
   /* Set UVC Parameters */
   uvc_ctx->fmt_type = UVC_FORMAT_MJPEG;
-  uvc_ctx->width = 640;
-  uvc_ctx->height = 480;
-  uvc_ctx->frame_rate = 30;  
+  uvc_ctx->width = tl_cfg.width;
+  uvc_ctx->height = tl_cfg.height;
+  uvc_ctx->frame_rate = 30;
   uvc_ctx->compression_ratio = 50;
   if(uvc_set_param(uvc_ctx->fmt_type, &uvc_ctx->width, &uvc_ctx->height, &uvc_ctx->frame_rate, &uvc_ctx->compression_ratio) < 0){
     printf("\n UVC Set Parameters Failed \n");
@@ -135,16 +170,9 @@ void example_media_tl_main(void *param)
     exit(NULL);
   }
   err = -EAGAIN;
-  register int iter = 0;
-  int ret = 0;
-  struct uvc_buf_context buf;  /* Global, need to change*/
-  
-  /*Creating AV Packet for conversion*/
-  AVFrame in_Frame;
-  
-   
-    do{ 
-      ret = uvc_dqbuf(&buf); 
+
+    do{
+      ret = uvc_dqbuf(&buf);
       if(buf.index < 0){
         printf("\r\n dequeue fail\n");
         err = -EAGAIN;
@@ -154,23 +182,50 @@ void example_media_tl_main(void *param)
         uvc_stream_off();
         err = -EIO;	// should return error
       }
-      in_Frame.FrameData = (char*)buf.data;
-      in_Frame.FrameLength = buf.len;
-      mjpeg2jpeg(&in_Frame);
-      example_tl_fatfs_thread(in_Frame.FrameData, in_Frame.FrameLength, iter);
+      if(err == -EAGAIN){
+        in_Frame.FrameData = (char*)buf.data;
+        in_Frame.FrameLength = buf.len;
+        mjpeg2jpeg(&in_Frame);
+        /* unchanged frames are dropped here, before any SD write */
+        if(tl_mux_frame(&tl_mux, (u8*)in_Frame.FrameData, in_Frame.FrameLength, xTaskGetTickCount() * portTICK_RATE_MS) != FR_OK){
+          printf("\r\n SD write fail\n");
+          uvc_stream_off();
+          err = -EIO;
+        }else if(tl_mux.stored){
+          tl_mux_get_stats(&tl_mux, &st);
+          printf("\r\n frame %d stored, %d permille changed, %d stored %d skipped\n",
+            st.frames - 1, tl_mux.changed, st.stored, st.skipped);
+        }
+      }
       ret = uvc_qbuf(&buf);
-      
-      ++iter;
-      vTaskDelay(2000);
+
+      vTaskDelay(TL_CAPTURE_MS / portTICK_RATE_MS);
     }while( (err == -EAGAIN) );
-    
-  
+
+
   /*Close UVC Stream */
   uvc_stream_free();
   /* Free UVC Context */
   free((struct uvc_context *)uvc_ctx);
   /* De-initialize USB */
   _usb_deinit();
+
+  tl_mux_close(&tl_mux);
+  tl_mux_get_stats(&tl_mux, &st);
+  printf("\r\n %d frames, %d stored, %d KB\n", st.frames, st.stored, st.bytes / 1024);
+fail_mux:
+  f_close(&tl_index);
+  f_close(&tl_file);
+fail_open:
+  free(tl_buf);
+fail_buf:
+  if(f_mount(NULL, logical_drv, 1) != FR_OK)
+    printf("FATFS unmount logical drive fail.\n");
+fail_mount:
+  if(FATFS_UnRegisterDiskDriver(drv_num))
+    printf("Unregister disk driver from FATFS fail.\n");
+fail_sd:
+  sdio_deinit_host();
   /*Delete Task */
   vTaskDelete(NULL);
 }
@@ -181,7 +236,7 @@ void example_media_tl(void)
   /*user can start their own task here*/
   if(xTaskCreate(example_media_tl_main, ((const char*)"example_media_tl"), 512, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
     printf("\r\n example_media_tl_main: Create Task Error\n");
-  }	
+  }
 }
 
 
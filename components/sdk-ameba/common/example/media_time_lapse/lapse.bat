@@ -1,3 +1,2 @@
-c:\ffmpeg.exe -i img%%d.JPEG -f image2 final%%d.png
-c:\ffmpeg.exe -framerate 30 -i final%%d.png -vf fps=30 -pix_fmt yuv420p output.mp4
-del /s *.png
\ No newline at end of file
+rem usage: lapse tl000.mjp
+c:\ffmpeg.exe -f mjpeg -framerate 30 -i %1 -vf fps=30 -pix_fmt yuv420p output.mp4
@@ -46,7 +46,7 @@ int FATFS_getDrivernum(unsigned char* TAG)
 
 	for(index=0;index<disk.nbr;index++){
 		drv = disk.drv[index];
-		if(!strcmp(drv->TAG, TAG)){
+		if(!strcmp((const char *)drv->TAG, (const char *)TAG)){
 			return drv->drv_num;
 		}
 	}
@@ -39,6 +39,12 @@
 #define CMD_SET_FLAG                    0X51
 #define CMD_GET_STREAM_READY            0x52
 #define CMD_GET_STREAM_STATUS           0x53
+#define CMD_ADD_SUBSCRIBER		0x54	// arg: mmf_subscriber_t*, rtsp2 sends the channel to it too
+#define CMD_DEL_SUBSCRIBER		0x55	// arg: mmf_subscriber_t.id
+#define CMD_SET_RATE_CTRL		0x56	// arg: msrc_context* of the encoder or 0, rtsp2 sets its bitrate and
+										// frame rate from RTCP receiver reports, below CMD_SET_BITRATE/FRAMERATE
+#define CMD_GET_JITTER_STATS	0x57	// arg: rtp_jitter_stats_t*, the rtp source's jitter buffer statistics
+#define CMD_GET_DECODE_STATS	0x58	// arg: mp3_sink_stats_t*, what decoding cost the mp3 sink per frame
 
 #define STAT_INIT		0
 #define STAT_USED		1
@@ -56,12 +62,18 @@
 #define FMT_A_MP4A_LATM		0x12
 #define FMT_AV_UNKNOWN		0xFF
 
+/*what exch_buf_t.priv points to*/
+#define PRIV_NONE			0x00	// source private, or nothing
+#define PRIV_H264_AU		0x01	// h264_au_t indexing data, see h264_nal.h
+
 /*mp4 storage*/
 #define CMD_SET_ST_PERIOD               0X60
 #define CMD_SET_ST_TOTAL                0X61
 #define CMD_SET_ST_TYPE                 0X62
 #define CMD_SET_ST_FILENAME             0x63
 #define CMD_SET_ST_START                0x64
+#define CMD_SET_ST_FRAGMENT             0x65	// arg: ms per fragment, records fragmented MP4 (moof/mdat) when not 0
+#define CMD_SET_ST_RECOVER              0x66	// arg: file name, cut a fragmented MP4 left by a power cut after its last complete fragment
 /*mp4 storage*/
 #define STORAGE_ALL     0
 #define STORAGE_VIDEO   1
@@ -83,8 +95,16 @@ typedef struct _exch_buf{
 	
 	uint32_t	state;		
 	void* 		priv;			// private use
+	uint32_t	priv_type;		// PRIV_xx, sinks only look into priv when it says so
 }exch_buf_t;
 
+typedef struct _mmf_subscriber{
+	uint32_t	addr;		// network order, unicast or multicast group
+	uint16_t	port;
+	uint8_t		ttl;		// for a multicast group
+	int			id;			// set by CMD_ADD_SUBSCRIBER
+}mmf_subscriber_t;
+
 typedef int (*mmf_cb_t)(void*);
 
 /* common error code for MMF */
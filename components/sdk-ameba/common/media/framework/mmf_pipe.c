@@ -0,0 +1,248 @@
+#include "platform_opts.h"
+#include "mmf_pipe.h"
+
+#ifdef CONFIG_PLATFORM_SIM
+#define MMF_PIPE_BARRIER()	__sync_synchronize()
+#else
+#define MMF_PIPE_BARRIER()	__DMB()
+#endif
+
+// a stopping stage notices within this many ticks
+#define MMF_STAGE_POLL		100
+
+mmf_pipe_t* mmf_pipe_create(int depth, int policy)
+{
+	mmf_pipe_t* pipe;
+	uint32_t slots = 1;
+
+	while(slots < depth)
+		slots <<= 1;
+
+	pipe = malloc(sizeof(mmf_pipe_t));
+	if(!pipe)
+		return NULL;
+	memset(pipe, 0, sizeof(mmf_pipe_t));
+
+	pipe->slot = malloc(slots*sizeof(exch_buf_t));
+	pipe->stamp = malloc(slots*sizeof(uint32_t));
+	pipe->not_empty = xSemaphoreCreateBinary();
+	pipe->not_full = xSemaphoreCreateBinary();
+	if(!pipe->slot || !pipe->stamp || !pipe->not_empty || !pipe->not_full){
+		mmf_pipe_delete(pipe);
+		return NULL;
+	}
+
+	pipe->mask = slots - 1;
+	pipe->policy = policy;
+	return pipe;
+}
+
+void mmf_pipe_delete(mmf_pipe_t* pipe)
+{
+	if(!pipe)
+		return;
+	if(pipe->not_empty)
+		vSemaphoreDelete(pipe->not_empty);
+	if(pipe->not_full)
+		vSemaphoreDelete(pipe->not_full);
+	if(pipe->stamp)
+		free(pipe->stamp);
+	if(pipe->slot)
+		free(pipe->slot);
+	free(pipe);
+}
+
+int mmf_pipe_put(mmf_pipe_t* pipe, exch_buf_t* exbuf, uint32_t timeout)
+{
+	uint32_t tail = pipe->tail;
+	uint32_t depth;
+
+	while(tail - pipe->head > pipe->mask){
+		if(pipe->policy == MMF_PIPE_DROP || timeout == 0){
+			pipe->stats.drop++;
+			return -EAGAIN;
+		}
+
+		// announce the wait, then look again so a get in between is not missed
+		pipe->put_waiting = 1;
+		MMF_PIPE_BARRIER();
+		if(tail - pipe->head <= pipe->mask){
+			pipe->put_waiting = 0;
+			break;
+		}
+
+		pipe->stats.full_wait++;
+		if(xSemaphoreTake(pipe->not_full, timeout) != pdTRUE){
+			pipe->put_waiting = 0;
+			return -EAGAIN;
+		}
+		pipe->put_waiting = 0;
+	}
+
+	pipe->slot[tail&pipe->mask] = *exbuf;
+	pipe->stamp[tail&pipe->mask] = MMF_PIPE_CLOCK();
+	MMF_PIPE_BARRIER();
+	pipe->tail = tail + 1;
+	MMF_PIPE_BARRIER();
+
+	pipe->stats.put++;
+	depth = tail + 1 - pipe->head;
+	if(depth > pipe->stats.max_depth)
+		pipe->stats.max_depth = depth;
+
+	if(pipe->get_waiting)
+		xSemaphoreGive(pipe->not_empty);
+	return 0;
+}
+
+int mmf_pipe_get(mmf_pipe_t* pipe, exch_buf_t* exbuf, uint32_t timeout)
+{
+	uint32_t head = pipe->head;
+	uint32_t lat;
+
+	while(pipe->tail == head){
+		if(timeout == 0)
+			return -EAGAIN;
+
+		pipe->get_waiting = 1;
+		MMF_PIPE_BARRIER();
+		if(pipe->tail != head){
+			pipe->get_waiting = 0;
+			break;
+		}
+
+		pipe->stats.empty_wait++;
+		if(xSemaphoreTake(pipe->not_empty, timeout) != pdTRUE){
+			pipe->get_waiting = 0;
+			return -EAGAIN;
+		}
+		pipe->get_waiting = 0;
+	}
+
+	MMF_PIPE_BARRIER();
+	*exbuf = pipe->slot[head&pipe->mask];
+	lat = MMF_PIPE_CLOCK() - pipe->stamp[head&pipe->mask];
+	MMF_PIPE_BARRIER();
+	pipe->head = head + 1;
+	MMF_PIPE_BARRIER();
+
+	pipe->stats.get++;
+	pipe->stats.lat_total += lat;
+	if(lat > pipe->stats.lat_max)
+		pipe->stats.lat_max = lat;
+
+	if(pipe->put_waiting)
+		xSemaphoreGive(pipe->not_full);
+	return 0;
+}
+
+uint32_t mmf_pipe_count(mmf_pipe_t* pipe)
+{
+	return pipe->tail - pipe->head;
+}
+
+void mmf_pipe_get_stats(mmf_pipe_t* pipe, mmf_pipe_stats_t* stats)
+{
+	taskENTER_CRITICAL();
+	memcpy(stats, &pipe->stats, sizeof(mmf_pipe_stats_t));
+	taskEXIT_CRITICAL();
+}
+
+void mmf_pipe_reset_stats(mmf_pipe_t* pipe)
+{
+	taskENTER_CRITICAL();
+	memset(&pipe->stats, 0, sizeof(mmf_pipe_stats_t));
+	taskEXIT_CRITICAL();
+}
+
+static void mmf_stage_task(void* param)
+{
+	mmf_stage_t* stage = (mmf_stage_t*)param;
+	exch_buf_t exbuf;
+	uint32_t start, busy;
+	int ret;
+
+	while(stage->state == S_RUN){
+		if(mmf_pipe_get(stage->in, &exbuf, MMF_STAGE_POLL) < 0)
+			continue;
+
+		for(;;){
+			start = MMF_PIPE_CLOCK();
+			ret = stage->handle(stage->drv_priv, &exbuf);
+			busy = MMF_PIPE_CLOCK() - start;
+			stage->stats.busy_total += busy;
+			if(busy > stage->stats.busy_max)
+				stage->stats.busy_max = busy;
+
+			if(ret != -EAGAIN)
+				break;
+
+			// a sink passes a buffer it cannot use on, a source retries
+			stage->stats.again++;
+			if(stage->type == MMF_STAGE_SINK || stage->state != S_RUN)
+				break;
+			vTaskDelay(1);
+		}
+
+		if(ret == 0)
+			stage->stats.frames++;
+		else if(ret != -EAGAIN)
+			stage->stats.errors++;
+
+		// the buffer always travels on, it goes back to the source eventually
+		while(mmf_pipe_put(stage->out, &exbuf, MMF_STAGE_POLL) < 0){
+			if(stage->out->policy == MMF_PIPE_DROP || stage->state != S_RUN)
+				break;
+		}
+	}
+
+	xSemaphoreGive(stage->done);
+	vTaskDelete(NULL);
+}
+
+mmf_stage_t* mmf_stage_open(int type, int (*handle)(void*, void*), void* drv_priv, mmf_pipe_t* in, mmf_pipe_t* out,
+							const char* name, int stack_size, int priority)
+{
+	mmf_stage_t* stage = malloc(sizeof(mmf_stage_t));
+	if(!stage)
+		return NULL;
+	memset(stage, 0, sizeof(mmf_stage_t));
+
+	stage->type = type;
+	stage->handle = handle;
+	stage->drv_priv = drv_priv;
+	stage->in = in;
+	stage->out = out;
+	stage->state = S_RUN;
+	stage->done = xSemaphoreCreateBinary();
+	if(!stage->done)
+		goto fail;
+
+	if(xTaskCreate(mmf_stage_task, (const char*)name, stack_size, stage, priority, &stage->hdl_task) != pdPASS)
+		goto fail;
+	return stage;
+
+fail:
+	if(stage->done)
+		vSemaphoreDelete(stage->done);
+	free(stage);
+	return NULL;
+}
+
+void mmf_stage_close(mmf_stage_t* stage)
+{
+	if(!stage)
+		return;
+
+	stage->state = S_STOP;
+	xSemaphoreTake(stage->done, portMAX_DELAY);
+	vSemaphoreDelete(stage->done);
+	free(stage);
+}
+
+void mmf_stage_get_stats(mmf_stage_t* stage, mmf_stage_stats_t* stats)
+{
+	taskENTER_CRITICAL();
+	memcpy(stats, &stage->stats, sizeof(mmf_stage_stats_t));
+	taskEXIT_CRITICAL();
+}
@@ -0,0 +1,98 @@
+#ifndef _MMF_PIPE_H
+#define _MMF_PIPE_H
+#include "cmsis_os.h"
+#include "mmf_common.h"
+
+/*
+ * Bounded queue of exch_buf_t between two pipeline stages, and a stage task
+ * that moves buffers from an input pipe through a module handle to an
+ * output pipe.
+ *
+ * A pipe has exactly one producer task and one consumer task. Put and get
+ * do not lock; a side only touches the semaphore when the pipe is full or
+ * empty and the other side only gives it when somebody is waiting.
+ */
+
+/* policy when the pipe is full */
+#define MMF_PIPE_BLOCK		0	// producer waits for room (backpressure)
+#define MMF_PIPE_DROP		1	// new buffer is dropped and counted
+
+/* latency clock */
+#if configGENERATE_RUN_TIME_STATS
+#define MMF_PIPE_CLOCK()	portGET_RUN_TIME_COUNTER_VALUE()
+#define MMF_PIPE_CLOCK_HZ	32768
+#else
+#define MMF_PIPE_CLOCK()	xTaskGetTickCount()
+#define MMF_PIPE_CLOCK_HZ	configTICK_RATE_HZ
+#endif
+
+typedef struct _mmf_pipe_stats{
+	uint32_t	put;
+	uint32_t	get;
+	uint32_t	drop;		// full with MMF_PIPE_DROP or timeout 0
+	uint32_t	full_wait;	// producer had to block
+	uint32_t	empty_wait;	// consumer had to block
+	uint32_t	max_depth;
+	uint32_t	lat_total;	// put to get, MMF_PIPE_CLOCK_HZ units
+	uint32_t	lat_max;
+}mmf_pipe_stats_t;
+
+typedef struct _mmf_pipe{
+	exch_buf_t*	slot;
+	uint32_t*	stamp;			// put time of each slot
+	uint32_t	mask;			// slots - 1, slots is a power of 2
+	volatile uint32_t	head;	// written by the consumer only
+	volatile uint32_t	tail;	// written by the producer only
+	volatile uint8_t	get_waiting;
+	volatile uint8_t	put_waiting;
+	uint8_t		policy;
+	xSemaphoreHandle	not_empty;
+	xSemaphoreHandle	not_full;
+	mmf_pipe_stats_t	stats;
+}mmf_pipe_t;
+
+mmf_pipe_t*	mmf_pipe_create(int depth, int policy);
+void		mmf_pipe_delete(mmf_pipe_t* pipe);
+// timeout in ticks, 0 does not wait; return 0 or -EAGAIN
+int			mmf_pipe_put(mmf_pipe_t* pipe, exch_buf_t* exbuf, uint32_t timeout);
+int			mmf_pipe_get(mmf_pipe_t* pipe, exch_buf_t* exbuf, uint32_t timeout);
+uint32_t	mmf_pipe_count(mmf_pipe_t* pipe);
+void		mmf_pipe_get_stats(mmf_pipe_t* pipe, mmf_pipe_stats_t* stats);
+void		mmf_pipe_reset_stats(mmf_pipe_t* pipe);
+
+typedef struct _mmf_stage_stats{
+	uint32_t	frames;		// handle returned 0
+	uint32_t	again;		// handle returned -EAGAIN
+	uint32_t	errors;		// other errors, buffer passed on as it is
+	uint32_t	busy_total;	// time in handle, MMF_PIPE_CLOCK_HZ units
+	uint32_t	busy_max;
+}mmf_stage_stats_t;
+
+/*
+ * A stage takes a buffer from in, calls handle(drv_priv, &exbuf) and puts
+ * the buffer to out: source and sink modules both fit, a source fills the
+ * buffers a sink has returned. A source that returns -EAGAIN is called again
+ * a tick later, so sources should rather block inside handle until they
+ * have data.
+ */
+#define MMF_STAGE_SOURCE	0	// -EAGAIN: no data yet, retry with the same buffer
+#define MMF_STAGE_SINK		1	// -EAGAIN: buffer not ready, pass it on
+
+typedef struct _mmf_stage{
+	int			type;
+	int			(*handle)(void*, void*);
+	void*		drv_priv;
+	mmf_pipe_t*	in;
+	mmf_pipe_t*	out;
+	volatile int	state;		// S_RUN or S_STOP
+	xTaskHandle	hdl_task;
+	xSemaphoreHandle	done;
+	mmf_stage_stats_t	stats;
+}mmf_stage_t;
+
+mmf_stage_t*	mmf_stage_open(int type, int (*handle)(void*, void*), void* drv_priv, mmf_pipe_t* in, mmf_pipe_t* out,
+							   const char* name, int stack_size, int priority);
+void			mmf_stage_close(mmf_stage_t* stage);
+void			mmf_stage_get_stats(mmf_stage_t* stage, mmf_stage_stats_t* stats);
+
+#endif
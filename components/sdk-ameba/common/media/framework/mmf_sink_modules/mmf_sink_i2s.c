@@ -1,12 +1,21 @@
 #include "mmf_sink.h"
 #include "i2s_api.h"
-#include "g711/g711_codec.h"
+#include "g711/g711_pcm.h"
+#include "osdep_service.h"
 
-#define BUF_BLK 3 //MUST BE GREATER OR EQUAL TO 2
-static u8 i2s_dec_buf[320]; //store decoded data
-static u8 i2s_chl_buf[640*(BUF_BLK+1)]; //store mono2stereo data
 #define I2S_DMA_PAGE_NUM 2
 #define I2S_DMA_PAGE_SIZE (640) 
+#define I2S_DMA_PAGE_FRAMES (I2S_DMA_PAGE_SIZE/4)   // 16 bit stereo
+
+// G.711 bytes waiting to be played, the tx irq decodes them into the DMA page
+#define G711_RING_SIZE 512  //power of 2, 64ms at 8kHz
+#define G711_RATE 8000
+static u8 g711_ring[G711_RING_SIZE];
+static volatile u32 ring_head = 0;  // tx irq only
+static volatile u32 ring_tail = 0;  // handle only
+static g711_pcm_t g711_pcm;
+static int g711_law = I2S_MODE_G711U;
+static u32 i2s_rate = 8000;
 
 static u8 i2s_tx_buf[I2S_DMA_PAGE_SIZE*I2S_DMA_PAGE_NUM];
 static u8 i2s_rx_buf[I2S_DMA_PAGE_SIZE*I2S_DMA_PAGE_NUM];
@@ -15,30 +24,34 @@ static u8 i2s_rx_buf[I2S_DMA_PAGE_SIZE*I2S_DMA_PAGE_NUM];
 #define I2S_WS_PIN              PC_0
 #define I2S_SD_PIN              PC_2
 
-static u32 update_flag = 0;
-static u32 update_token = 0;
-static u32 prev_token = 0;
+// given by the tx irq when a page was played and the handle waits for room
+static _sema page_sema = NULL;
+static volatile u8 page_waiting = 0;
+#define PAGE_WAIT_TIMEOUT	100	// ms, I2S stopped
+
+static const struct{
+    u32 hz;
+    int rate;
+}i2s_rate_map[] = {
+    {8000, SR_8KHZ}, {16000, SR_16KHZ}, {24000, SR_24KHZ}, {32000, SR_32KHZ},
+    {48000, SR_48KHZ}, {96000, SR_96KHZ}, {7350, SR_7p35KHZ}, {14700, SR_14p7KHZ},
+    {22050, SR_22p05KHZ}, {29400, SR_29p4KHZ}, {44100, SR_44p1KHZ}, {88200, SR_88p2KHZ},
+};
 
-u8 *play_ptr = i2s_chl_buf;
 static void i2s_tx_complete(void *data, char* pbuf){
     i2s_t *obj = (i2s_t *)data;
     int *ptx_buf; 
+    u32 head = ring_head;
     ptx_buf = i2s_get_tx_page(obj);
-    if(update_token > prev_token)
-        update_flag = 1;
-    else
-        update_flag = 0;    
-    if(update_flag)
+    // play only whole pages, as before
+    if(ring_tail - head >= g711_pcm_need(&g711_pcm, I2S_DMA_PAGE_FRAMES))
     {
-        _memcpy((void*)ptx_buf, (void*)play_ptr, I2S_DMA_PAGE_SIZE);
-
-        play_ptr += I2S_DMA_PAGE_SIZE;
-        if(play_ptr >= i2s_chl_buf + BUF_BLK*I2S_DMA_PAGE_SIZE)
-        {
-
-            play_ptr = i2s_chl_buf;
-        }        
-        update_token--;
+        head += g711_pcm_decode(&g711_pcm, g711_ring, G711_RING_SIZE-1, head, (u32*)ptx_buf, I2S_DMA_PAGE_FRAMES);
+        ring_head = head;
+        if(page_waiting){
+            page_waiting = 0;
+            rtw_up_sema_from_isr(&page_sema);
+        }
     }
     else
         _memset((void*)ptx_buf, 0, I2S_DMA_PAGE_SIZE);
@@ -55,6 +68,8 @@ void i2s_sink_mod_close(void* ctx)
     i2s_t* i2s_obj = (i2s_t*) ctx;
     i2s_deinit(i2s_obj);
     free(i2s_obj);
+    if(page_sema != NULL)
+        rtw_free_sema(&page_sema);
 }
 
 void* i2s_sink_mod_open(void)
@@ -62,6 +77,9 @@ void* i2s_sink_mod_open(void)
     i2s_t* i2s_obj = malloc(sizeof(i2s_t));
     if(i2s_obj == NULL)
       return NULL;
+    rtw_init_sema(&page_sema, 0);
+    ring_head = ring_tail = 0;
+    g711_pcm_init(&g711_pcm, g711_law, G711_RATE, i2s_rate, G711_PCM_POLYPHASE);
     
     alc5651_init();
     alc5651_init_interface2();	// connect to ALC interface 2
@@ -82,7 +100,31 @@ void* i2s_sink_mod_open(void)
 int i2s_sink_mod_set_param(void* ctx, int cmd, int arg)
 {
     i2s_t* i2s_obj = (i2s_t*) ctx;
+    int i;
     switch(cmd){
+        case CMD_SET_CODEC:
+            // FMT_A_PCMU or FMT_A_PCMA, before streaming
+            if(arg != FMT_A_PCMU && arg != FMT_A_PCMA)
+                return -EINVAL;
+            g711_law = (arg == FMT_A_PCMA)? I2S_MODE_G711A : I2S_MODE_G711U;
+            taskENTER_CRITICAL();
+            g711_pcm_init(&g711_pcm, g711_law, G711_RATE, i2s_rate, G711_PCM_POLYPHASE);
+            taskEXIT_CRITICAL();
+            break;
+        case CMD_SET_SAMPLERATE:
+            // I2S rate in Hz, the 8kHz G.711 stream is resampled to it
+            for(i = 0; i < sizeof(i2s_rate_map)/sizeof(i2s_rate_map[0]); i++)
+                if(i2s_rate_map[i].hz == arg)
+                    break;
+            if(i == sizeof(i2s_rate_map)/sizeof(i2s_rate_map[0]))
+                return -EINVAL;
+            i2s_rate = arg;
+            i2s_obj->sampling_rate = i2s_rate_map[i].rate;
+            i2s_set_param(i2s_obj, i2s_obj->channel_num, i2s_obj->sampling_rate, i2s_obj->word_length);
+            taskENTER_CRITICAL();
+            g711_pcm_init(&g711_pcm, g711_law, G711_RATE, i2s_rate, G711_PCM_POLYPHASE);
+            taskEXIT_CRITICAL();
+            break;
         case CMD_SET_STREAMMING:
             if(arg == ON){
                 i2s_send_page(i2s_obj, (uint32_t*)i2s_get_tx_page(i2s_obj));
@@ -97,33 +139,33 @@ int i2s_sink_mod_set_param(void* ctx, int cmd, int arg)
 }
 
 //send audio data here
-static int cache_byte = 0;
-u8 *cache_ptr = i2s_chl_buf;
 int i2s_sink_mod_handle(void* ctx, void* b)
 {
     i2s_t* i2s_obj = (i2s_t*) ctx; 
     exch_buf_t *exbuf = (exch_buf_t*)b; 
+    u32 len, tail, part;
     if(exbuf->state != STAT_READY)
         return -EAGAIN;    
-    G711_decoder(exbuf->data, (short*)i2s_dec_buf, I2S_MODE_G711U, exbuf->len);
-    //mono2stereo(i2s_dec_buf, i2s_chl_buf, 320, 16);
-    mono2stereo(i2s_dec_buf, cache_ptr, exbuf->len*2, 16);
-    cache_byte += exbuf->len*4;
-    cache_ptr += exbuf->len*4;
-    if(cache_ptr >= i2s_chl_buf + BUF_BLK*I2S_DMA_PAGE_SIZE)
-    {
-        memcpy(i2s_chl_buf, i2s_chl_buf + BUF_BLK*I2S_DMA_PAGE_SIZE, cache_ptr - (i2s_chl_buf + BUF_BLK*I2S_DMA_PAGE_SIZE));
-        cache_ptr -= BUF_BLK*I2S_DMA_PAGE_SIZE;
-    }
-    if(cache_byte >= I2S_DMA_PAGE_SIZE)
+    len = exbuf->len;
+    if(len > G711_RING_SIZE)
+        len = G711_RING_SIZE;
+    tail = ring_tail;
+    while(G711_RING_SIZE - (tail - ring_head) < len)
     {
-        cache_byte %= I2S_DMA_PAGE_SIZE;
-        //printf("\n\rcache:%dB", cache_byte);
-    update_token++;
+        // sleep until the tx irq has played a page
+        page_waiting = 1;
+        if(G711_RING_SIZE - (tail - ring_head) >= len)
+            page_waiting = 0;
+        else
+            rtw_down_timeout_sema(&page_sema, PAGE_WAIT_TIMEOUT);
     }
-    //printf("\n\r%d", update_token);
-    while(update_token >= prev_token + BUF_BLK - 1)//MINUS 1 TO AVOID RING BUFFER OUT RACE
-        vTaskDelay(1);
+    // only the coded bytes are copied here, decoding happens in the tx irq
+    part = G711_RING_SIZE - (tail & (G711_RING_SIZE-1));
+    if(part > len)
+        part = len;
+    memcpy(g711_ring + (tail & (G711_RING_SIZE-1)), exbuf->data, part);
+    memcpy(g711_ring, exbuf->data + part, len - part);
+    ring_tail = tail + len;
     exbuf->state = STAT_USED;    
     return 0;
 }
@@ -19,6 +19,7 @@ mp3_decoder_t mp3;
 mp3_info_t info;
 int frame_size = 0;
 int *ptx_buf;
+static mp3_sink_stats_t mp3_stats;
 
 
 static void i2s_tx_complete(void *data, char *pbuf)
@@ -52,6 +53,7 @@ void* mp3_sink_mod_open(void)
 		I2S_DMA_PAGE_NUM, I2S_DMA_PAGE_SIZE);
 	i2s_tx_irq_handler(&i2s_obj, (i2s_irq_handler)i2s_tx_complete, (uint32_t)&i2s_obj);
 	i2s_rx_irq_handler(&i2s_obj, (i2s_irq_handler)i2s_rx_complete, (uint32_t)&i2s_obj);
+	memset(&mp3_stats, 0, sizeof(mp3_sink_stats_t));
 	mp3 = mp3_create();
 	if(!mp3)
 	{
@@ -71,6 +73,11 @@ void* mp3_sink_mod_open(void)
 
 int mp3_sink_mod_set_param(void* ctx, int cmd, int arg)
 {
+	switch(cmd){
+	case CMD_GET_DECODE_STATS:
+		memcpy((void*)arg, &mp3_stats, sizeof(mp3_sink_stats_t));
+		return 0;
+	}
   return 1;
 }
 
@@ -78,11 +85,22 @@ int mp3_sink_mod_set_param(void* ctx, int cmd, int arg)
 int mp3_sink_mod_handle(void* ctx, void* b)
 {
         exch_buf_t *exbuf = (exch_buf_t*)b;
+        u32 t;
 	if(exbuf->state != STAT_READY)
         return -EAGAIN;
 
         /* Read a block */
+        t = us_ticker_read();
         frame_size = mp3_decode(mp3, (exbuf->data), (exbuf->len), WAV_op, &info);
+        t = us_ticker_read() - t;
+        if((frame_size>0)&&(info.audio_bytes>0)&&(info.sample_rate>0)&&(info.channels>0))
+        {
+                mp3_stats.frames++;
+                mp3_stats.decode_us += t;
+                if(mp3_stats.decode_max_us < t)
+                        mp3_stats.decode_max_us = t;
+                mp3_stats.audio_us += (u64)info.audio_bytes / (2 * info.channels) * 1000000 / info.sample_rate;
+        }
         retry:
         ptx_buf = i2s_get_tx_page(&i2s_obj);
         if(ptx_buf){
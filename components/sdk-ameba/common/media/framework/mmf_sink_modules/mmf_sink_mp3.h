@@ -8,6 +8,7 @@
 #include "diag.h"
 #include "i2s_api.h"
 #include "analogin_api.h"
+#include "us_ticker_api.h"
 #include <stdlib.h>
 #include "section_config.h"
 #if CONFIG_EXAMPLE_MP3_STREAM_SGTL5000
@@ -16,4 +17,11 @@
 #include "alc5651.h"
 #endif
 
+typedef struct _mp3_sink_stats{
+	u32		frames;			// decoded
+	u32		decode_us;		// in mp3_decode, all frames
+	u32		decode_max_us;	// the slowest frame
+	u32		audio_us;		// of PCM decoded; decode_us / audio_us is the real-time factor
+}mp3_sink_stats_t;
+
 #endif /* MMF_SINK_MP3_FILE_H */
\ No newline at end of file
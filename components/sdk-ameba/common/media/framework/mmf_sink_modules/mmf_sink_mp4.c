@@ -18,6 +18,8 @@
 #include "sockets.h"
 #include "lwip/netif.h"
 #include "mp4_encap.h"
+#include "fmp4_mux.h"
+#include "h264/h264_nal.h"
 
 #define AUDIO_SIZE     1024*10
 #define VIDEO_SIZE     1024*10
@@ -30,6 +32,18 @@ SDRAM_DATA_SECTION int audio_buffer_index[AUDIO_SIZE];
 SDRAM_DATA_SECTION int audio_buffer_size[AUDIO_SIZE];
 SDRAM_DATA_SECTION unsigned char h264_buffer[H264_BUF_SIZE];
 
+#define FMP4_WRITE_BLOCK 1024*32//one f_write, sector aligned
+#define FMP4_PREALLOC    1024*1024*4
+#define FMP4_SYNC_MS     2000
+
+typedef struct _mp4_sink{
+        mp4_context mp4;//first, it is what the muxer library gets
+        int         fragment_ms;//0: the library records, moov written at the end
+        int         recording;
+        int         file_index;
+        fmp4_mux_t  fmp4;//h264_buffer holds its fragments
+}mp4_sink_t;
+
 int fatfs_init(void* ctx){
 	char path[64];
 	
@@ -89,9 +103,94 @@ int fatfs_close(void *ctx){
 	return 0;
 }
 
+static int fmp4_open_file(mp4_sink_t *sink)
+{
+        pmp4_context mp4_ctx = &sink->mp4;
+        fmp4_config_t cfg;
+        char path[64];
+        
+        snprintf(path, sizeof(path), "%s%s_%d.mp4", mp4_ctx->_drv, mp4_ctx->filename, sink->file_index);
+        if(f_open(&mp4_ctx->m_file, path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK){
+                printf("\r\nfmp4 open %s failed", path);
+                return -1;
+        }
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.width = mp4_ctx->width;
+        cfg.height = mp4_ctx->height;
+        cfg.frame_rate = mp4_ctx->frame_rate;
+        cfg.sample_rate = (mp4_ctx->type == STORAGE_VIDEO) ? 0 : mp4_ctx->sample_rate;
+        cfg.channels = mp4_ctx->channel_count;
+        cfg.fragment_ms = sink->fragment_ms;
+        cfg.write_block = FMP4_WRITE_BLOCK;
+        cfg.prealloc = FMP4_PREALLOC;
+        cfg.sync_ms = FMP4_SYNC_MS;
+        if(fmp4_mux_open(&sink->fmp4, &mp4_ctx->m_file, &cfg, h264_buffer, H264_BUF_SIZE) != FR_OK){
+                f_close(&mp4_ctx->m_file);
+                return -1;
+        }
+        printf("\r\nfmp4 record %s", path);
+        sink->recording = 1;
+        return 0;
+}
+
+static void fmp4_close_file(mp4_sink_t *sink)
+{
+        fmp4_stats_t st;
+        
+        if(fmp4_mux_close(&sink->fmp4) != FR_OK)
+                printf("\r\nfmp4 write failed");
+        f_close(&sink->mp4.m_file);
+        fmp4_mux_get_stats(&sink->fmp4, &st);
+        printf("\r\nfmp4 %d ms, %d fragments, %d bytes, %d writes, %d dropped",
+                st.duration_ms, st.fragments, st.bytes, st.writes, st.dropped);
+        sink->recording = 0;
+        sink->file_index++;
+}
+
+// fMP4 files of period_time each, file_total of them when it is set, cut at key frames
+static void fmp4_mod_handle(mp4_sink_t *sink, exch_buf_t *exbuf)
+{
+        pmp4_context mp4_ctx = &sink->mp4;
+        fmp4_stats_t st;
+        h264_au_t au;
+        
+        if(exbuf->codec_fmt == FMT_V_H264 || exbuf->codec_fmt == FMT_V_MP4V_ES){
+                if(mp4_ctx->period_time > 0){
+                        fmp4_mux_get_stats(&sink->fmp4, &st);
+                        if(st.duration_ms >= mp4_ctx->period_time && h264_au_index(exbuf->data, exbuf->data + exbuf->len, &au) && au.key){
+                                fmp4_close_file(sink);
+                                if((mp4_ctx->file_total > 0 && sink->file_index >= mp4_ctx->file_total) || fmp4_open_file(sink) < 0)
+                                        return;
+                        }
+                }
+                fmp4_mux_video(&sink->fmp4, exbuf->data, exbuf->len, exbuf->timestamp);
+        }else if(exbuf->codec_fmt == FMT_A_MP4A_LATM && mp4_ctx->type != STORAGE_VIDEO){
+                fmp4_mux_audio(&sink->fmp4, exbuf->data, exbuf->len);
+        }
+}
+
+// trim a file left by a power cut to its last complete fragment
+static int fmp4_recover_file(mp4_sink_t *sink, const char *name)
+{
+        pmp4_context mp4_ctx = &sink->mp4;
+        char path[64];
+        int ret;
+        
+        snprintf(path, sizeof(path), "%s%s", mp4_ctx->_drv, name);
+        if(f_open(&mp4_ctx->m_file, path, FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK)
+                return -ENOENT;
+        ret = fmp4_mux_recover(&mp4_ctx->m_file);
+        f_close(&mp4_ctx->m_file);
+        printf("\r\nfmp4 recover %s: %d fragments", path, ret);
+        return ret < 0 ? -EINVAL : 0;
+}
+
 void mp4_mod_close(void* ctx)
 {
 	pmp4_context mp4_ctx = (pmp4_context)ctx;
+        mp4_sink_t *sink = (mp4_sink_t *)ctx;
+        if(sink->recording)
+                fmp4_close_file(sink);
         mp4_muxer_close(mp4_ctx);
         fatfs_close(mp4_ctx);
 	free(mp4_ctx);
@@ -99,12 +198,12 @@ void mp4_mod_close(void* ctx)
 
 void* mp4_mod_open(void)
 {
-	pmp4_context mp4_ctx = (pmp4_context)malloc(sizeof(mp4_context));
+	pmp4_context mp4_ctx = (pmp4_context)malloc(sizeof(mp4_sink_t));
         if(!mp4_ctx){
           printf("malloc failed\r\n");
           return NULL;
         }
-        memset(mp4_ctx,0,sizeof(mp4_context));
+        memset(mp4_ctx,0,sizeof(mp4_sink_t));
         mp4_muxer_init(mp4_ctx);
         if(fatfs_init(mp4_ctx)<0){
           free(mp4_ctx);
@@ -122,6 +221,7 @@ int mp4_mod_set_param(void* ctx, int cmd, int arg)
 {
         int ret = 0;
         pmp4_context mp4_ctx = (pmp4_context)ctx;
+        mp4_sink_t *sink = (mp4_sink_t *)ctx;
 	
 	switch(cmd){
 	case CMD_SET_HEIGHT:
@@ -153,7 +253,22 @@ int mp4_mod_set_param(void* ctx, int cmd, int arg)
                 strcpy(mp4_ctx->filename,(char*)arg);
                 break;
         case CMD_SET_ST_START:
-                mp4_set_start_status(mp4_ctx);
+                if(sink->fragment_ms == 0)
+                        mp4_set_start_status(mp4_ctx);
+                else if(!sink->recording){
+                        sink->file_index = 0;
+                        if(fmp4_open_file(sink) < 0)
+                                ret = -EIO;
+                }
+                break;
+        case CMD_SET_ST_FRAGMENT:
+                if(sink->recording)
+                        ret = -EBUSY;
+                else
+                        sink->fragment_ms = arg;
+                break;
+        case CMD_SET_ST_RECOVER:
+                ret = fmp4_recover_file(sink, (char*)arg);
                 break;
 	default:
 		ret = EINVAL;
@@ -181,10 +296,17 @@ int mp4_mod_handle(void* ctx, void* b)
 int mp4_mod_handle(void* ctx, void* b)
 {
 	pmp4_context mp4_ctx = (pmp4_context)ctx;
+        mp4_sink_t *sink = (mp4_sink_t *)ctx;
 	exch_buf_t *exbuf = (exch_buf_t*)b;
         int status = 0;
         if((exbuf->state == STAT_INIT) || (exbuf->state == STAT_USED))
             return -EAGAIN;    
+        if(sink->fragment_ms){
+            if(sink->recording)
+                fmp4_mod_handle(sink, exbuf);
+            exbuf->state=STAT_USED;
+            return 0;
+        }
         if(exbuf->state == STAT_RESERVED){
             if(mp4_ctx->buffer_write_status == 0)
               exbuf->state=STAT_USED;
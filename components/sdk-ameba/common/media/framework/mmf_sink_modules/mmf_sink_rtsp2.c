@@ -1,9 +1,20 @@
 #include "mmf_sink.h"
+#include "mmf_source.h"
 
 //rtsp header files
 #include "rtsp/rtsp_api.h"
 #include "sockets.h"
 #include "lwip/netif.h"
+#include "rtp_pack.h"
+#include "rtp_fanout.h"
+#include "rtcp_rr.h"
+#include "rtp_rate.h"
+
+// H.264, MJPEG and AAC over UDP are packetized here and sent with
+// lwip_sendtov() straight from the frame, other streams use the rtsp library.
+// Each frame is packetized once for the RTSP client and the subscribers
+// added with CMD_ADD_SUBSCRIBER
+#define RTSP2_ZERO_COPY	1
 
 #define STREAM_FLOW_ID_BASE 0
 static u32 stream_flow_id_bitmap = 0;
@@ -16,8 +27,45 @@ static int channel_idx=0;
 static struct __internal_payload{
 	int codec_id;
 	struct rtp_object payload;
+	// the rtp task calls rtsp2_mod_rtp_send, which signals sent_sema after the real handler
+	// (not "send", lwIP defines send() as a macro)
+	int (*handler)(struct stream_context *stream_ctx, struct rtp_object *payload);
+	int (*lib_handler)(struct stream_context *stream_ctx, struct rtp_object *payload);
+#if RTSP2_ZERO_COPY
+	rtp_pack_t pack;
+	rtp_fanout_t fanout;
+	int session_client;			// fanout client of the RTSP session, -1 if none
+	u8 ttl;						// multicast TTL of the socket
+	int ttl_socket;				// socket the TTL is set on
+	const h264_au_t *frame_au;	// NAL table from the source, NULL to index here
+	h264_au_t au;
+	u32 bytes;					// datagram bytes packetized
+	// rate control, see CMD_SET_RATE_CTRL
+	msrc_context *rate_src;		// encoder to adapt, NULL if off
+	rtp_rate_t rate;
+	int rtcp_socket;			// receiver reports, -1 if not open
+	int rtcp_port;
+	u32 frames_dropped;			// non-reference frames not sent while congested
+#endif
+	_sema sent_sema;
+	u32 sent_fallback;	// woke before the object was back on the output queue
 }*rtpobj = NULL;
 
+// ms, the handle gives up waiting when the session is no longer playing
+#define RTSP2_SENT_TIMEOUT	100
+
+// rate control limits, from the bitrate and frame rate set for the stream
+#define RTSP2_RATE_MIN_DIV	16
+#define RTSP2_RATE_MIN_FPS	5
+#define RTSP2_RTCP_BUF		128
+
+#if RTSP2_ZERO_COPY
+// subscribers are changed by set_param while the rtp task sends
+static _mutex rtsp2_fanout_lock = NULL;
+
+static int rtsp2_mod_rtp_sendv(void *arg, const rtp_client_t *c, const rtp_iov_t *iov, int iovcnt);
+#endif
+
 //static u32 rtsp_tick_offset = 0;
 //static u32 rtsp_stream_num = 0;
 // codec map
@@ -34,10 +82,22 @@ void rtsp2_mod_close(void* ctx)
 			free(rtsp_ctx->stream_ctx[i].codec);
 		
 		rtp_object_deinit(&rtpobj[i].payload);
+		if(rtpobj[i].sent_sema != NULL)
+			rtw_free_sema(&rtpobj[i].sent_sema);
+#if RTSP2_ZERO_COPY
+		if(rtpobj[i].rtcp_socket >= 0)
+			close(rtpobj[i].rtcp_socket);
+#endif
 	}
 	
 	if(rtpobj)	
 		free(rtpobj);
+	rtpobj = NULL;
+#if RTSP2_ZERO_COPY
+	if(rtsp2_fanout_lock != NULL)
+		rtw_mutex_free(&rtsp2_fanout_lock);
+	rtsp2_fanout_lock = NULL;
+#endif
 
 	rtsp_close(rtsp_ctx);
 	rtsp_context_free(rtsp_ctx);
@@ -68,10 +128,21 @@ void* rtsp2_mod_open(void)
 	rtpobj = malloc(sizeof(struct __internal_payload)*rtsp_ctx->nb_streams);
 	if(!rtpobj)
 		goto rtsp2_mod_open_fail;
+#if RTSP2_ZERO_COPY
+	rtw_mutex_init(&rtsp2_fanout_lock);
+#endif
 	
 	// init payload object
+	memset(rtpobj, 0, sizeof(struct __internal_payload)*rtsp_ctx->nb_streams);
 	for(int i=0;i<rtsp_ctx->nb_streams;i++){
 		rtp_object_init(&rtpobj[i].payload);
+		rtw_init_sema(&rtpobj[i].sent_sema, 0);
+#if RTSP2_ZERO_COPY
+		rtp_fanout_init(&rtpobj[i].fanout, rtsp2_mod_rtp_sendv, &rtpobj[i]);
+		rtpobj[i].session_client = -1;
+		rtpobj[i].ttl_socket = -1;
+		rtpobj[i].rtcp_socket = -1;
+#endif
 		rtsp_ctx->stream_ctx[i].codec = malloc(sizeof(struct codec_info));
 		if(!rtsp_ctx->stream_ctx[i].codec)
 			goto rtsp2_mod_open_fail;
@@ -86,6 +157,179 @@ rtsp2_mod_open_fail:
 	return NULL;
 }
 
+#if RTSP2_ZERO_COPY
+static int rtsp2_mod_rtp_sendv(void *arg, const rtp_client_t *c, const rtp_iov_t *iov, int iovcnt)
+{
+	struct __internal_payload *obj = (struct __internal_payload *)arg;
+	struct lwip_iovec v[RTP_PACK_IOV_MAX];
+	struct sockaddr_in to;
+	
+	for(int i=0;i<iovcnt;i++){
+		v[i].iov_base = iov[i].base;
+		v[i].iov_len = iov[i].len;
+	}
+	memset(&to, 0, sizeof(struct sockaddr_in));
+	to.sin_family = AF_INET;
+	to.sin_port = c->port;
+	to.sin_addr.s_addr = c->addr;
+	if(lwip_sendtov(obj->payload.connect_ctx.socket_id, v, iovcnt, 0, (struct sockaddr *)&to, sizeof(struct sockaddr_in)) < 0)
+		return -1;
+	return 0;
+}
+
+// follow the RTSP session's client, its SSRC and sequence number
+static rtp_client_t *rtsp2_mod_session_client(struct __internal_payload *obj, struct stream_context *stream_ctx, struct rtp_object *payload)
+{
+	struct rtsp_context *rtsp_ctx = stream_ctx->parent;
+	rtp_fanout_t *fo = &obj->fanout;
+	rtp_client_t *c = (obj->session_client >= 0) ? &fo->client[obj->session_client] : NULL;
+	u32 addr = *(u32 *)payload->connect_ctx.remote_ip;
+	u16 port = htons(payload->connect_ctx.remote_port);
+	
+	if(c == NULL || c->state == RTP_CLIENT_FREE || c->addr != addr || c->port != port){
+		rtp_fanout_remove(fo, obj->session_client);
+		obj->session_client = rtp_fanout_add(fo, addr, port, 0, 0, 1);
+		if(obj->session_client < 0)
+			return NULL;
+		c = &fo->client[obj->session_client];
+	}
+	c->ssrc = rtsp_ctx->session.id;
+	c->seq = rtsp_ctx->rtpseq[stream_ctx->stream_id];
+	return c;
+}
+
+// reports come to the server port after the RTP one. If the rtsp library
+// serves RTCP itself the bind fails and the rate is left alone
+static void rtsp2_mod_rtcp_open(struct __internal_payload *obj, int port)
+{
+	struct sockaddr_in addr;
+	
+	if(port == obj->rtcp_port)
+		return;
+	if(obj->rtcp_socket >= 0)
+		close(obj->rtcp_socket);
+	obj->rtcp_port = port;
+	obj->rtcp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if(obj->rtcp_socket < 0)
+		return;
+	memset(&addr, 0, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = INADDR_ANY;
+	if(bind(obj->rtcp_socket, (struct sockaddr *)&addr, sizeof(struct sockaddr_in)) < 0){
+		printf("\n\rrtsp2: no RTCP on port %d, rate control off", port);
+		close(obj->rtcp_socket);
+		obj->rtcp_socket = -1;
+	}
+}
+
+// feed the reports about the session's SSRC to the controller and pass
+// what changed to the encoder; in multicast every receiver reports
+static void rtsp2_mod_rate_ctrl(struct __internal_payload *obj, struct stream_context *stream_ctx)
+{
+	struct rtsp_context *rtsp_ctx = stream_ctx->parent;
+	u8 buf[RTSP2_RTCP_BUF];
+	rtcp_report_t rb;
+	int len, changed = 0;
+	
+	rtsp2_mod_rtcp_open(obj, rtsp_ctx->transport[stream_ctx->stream_id].serverport_high);
+	if(obj->rtcp_socket < 0)
+		return;
+	while((len = recvfrom(obj->rtcp_socket, buf, sizeof(buf), MSG_DONTWAIT, NULL, NULL)) > 0){
+		if(rtcp_find_report(buf, len, rtsp_ctx->session.id, &rb) == 1)
+			changed |= rtp_rate_report(&obj->rate, &rb, rtsp_ctx->rtpseq[stream_ctx->stream_id], obj->bytes,
+				stream_ctx->codec->clock_rate, rtw_systime_to_ms(rtw_get_current_time()));
+	}
+	
+	if(changed & RTP_RATE_BITRATE)
+		mmf_source_ctrl(obj->rate_src, CMD_SET_BITRATE, obj->rate.bitrate);
+	if(changed & RTP_RATE_FPS)
+		mmf_source_ctrl(obj->rate_src, CMD_SET_FRAMERATE, obj->rate.fps);
+	if(changed)
+		mmf_source_ctrl(obj->rate_src, CMD_SET_APPLY, 0);
+}
+
+static int rtsp2_mod_rtp_pack(struct stream_context *stream_ctx, struct rtp_object *payload)
+{
+	struct __internal_payload *obj = container_of(payload, struct __internal_payload, payload);
+	struct rtsp_context *rtsp_ctx = stream_ctx->parent;
+	struct rtsp_transport *transport = &rtsp_ctx->transport[stream_ctx->stream_id];
+	const u8 *p = payload->data, *end = payload->data + payload->len;
+	const h264_au_t *au = NULL;
+	rtp_client_t *c;
+	int ret = 0, key = 1, socket = payload->connect_ctx.socket_id;
+	
+	// interleaved over the RTSP connection
+	if(transport->castMode != UNICAST_UDP_MODE && transport->castMode != MULTICAST_MODE)
+		return obj->lib_handler(stream_ctx, payload);
+	
+	if(obj->codec_id == AV_CODEC_ID_H264){
+		if(obj->frame_au && obj->frame_au->data == p && obj->frame_au->len == payload->len)
+			au = obj->frame_au;
+		else if(h264_au_index(p, end, &obj->au))
+			au = &obj->au;
+		key = au ? au->key : 0;
+	}
+	
+	if(obj->rate_src){
+		rtsp2_mod_rate_ctrl(obj, stream_ctx);
+		// while congested, frames nothing refers to are not sent
+		if(obj->rate.drop && au && !au->ref){
+			obj->frames_dropped++;
+			return 0;
+		}
+	}
+	
+	rtw_mutex_get(&rtsp2_fanout_lock);
+	c = rtsp2_mod_session_client(obj, stream_ctx, payload);
+	if(transport->castMode == MULTICAST_MODE && transport->ttl > obj->ttl)
+		obj->ttl = transport->ttl;
+	if(obj->ttl && obj->ttl_socket != socket){
+		setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL, &obj->ttl, sizeof(obj->ttl));
+		obj->ttl_socket = socket;
+	}
+	
+	rtp_pack_init(&obj->pack, stream_ctx->codec->pt, rtsp_ctx->session.id, 0, rtp_fanout_sendv, &obj->fanout);
+	if(rtp_fanout_begin(&obj->fanout, key) > 0){
+		switch(obj->codec_id){
+		case AV_CODEC_ID_H264:
+			while(ret >= 0 && au != NULL){
+				p = au->data + au->len;
+				ret = rtp_pack_h264(&obj->pack, au, payload->timestamp, p >= end);
+				au = h264_au_index(p, end, &obj->au) ? &obj->au : NULL;
+			}
+			break;
+		case AV_CODEC_ID_MJPEG:
+			ret = rtp_pack_jpeg(&obj->pack, p, payload->len, payload->timestamp);
+			break;
+		case AV_CODEC_ID_MP4A_LATM:
+			ret = rtp_pack_aac(&obj->pack, p, payload->len, payload->timestamp);
+			break;
+		}
+	}
+	rtp_fanout_end(&obj->fanout);
+	
+	if(c)
+		rtsp_ctx->rtpseq[stream_ctx->stream_id] = c->seq;
+	rtw_mutex_put(&rtsp2_fanout_lock);
+	
+	obj->bytes += obj->pack.bytes;
+	stream_ctx->statistics.sent_packet += obj->pack.packets;
+	if(ret < 0)
+		stream_ctx->statistics.drop_packet++;
+	return (ret < 0) ? -EIO : 0;
+}
+#endif
+
+static int rtsp2_mod_rtp_send(struct stream_context *stream_ctx, struct rtp_object *payload)
+{
+	struct __internal_payload *obj = container_of(payload, struct __internal_payload, payload);
+	int ret = obj->handler(stream_ctx, payload);
+	
+	rtw_up_sema(&obj->sent_sema);
+	return ret;
+}
+
 // to get stream id,
 // need mutex to protect this routine? i dont think it is necessary
 int rtsp2_mod_set_param(void* ctx, int cmd, int arg)
@@ -162,7 +406,52 @@ int rtsp2_mod_set_param(void* ctx, int cmd, int arg)
 		rtp_load_o_handler_by_codec_id(&rtpobj[channel_idx].payload, codec_map[arg&0xf]);
 		if(rtpobj[channel_idx].payload.rtp_object_handler == NULL)
 			return -EINVAL;
+		rtpobj[channel_idx].lib_handler = rtpobj[channel_idx].payload.rtp_object_handler;
+		rtpobj[channel_idx].handler = rtpobj[channel_idx].lib_handler;
+#if RTSP2_ZERO_COPY
+		switch(codec_map[arg&0xf]){
+		case AV_CODEC_ID_H264:
+		case AV_CODEC_ID_MJPEG:
+		case AV_CODEC_ID_MP4A_LATM:
+			rtpobj[channel_idx].handler = rtsp2_mod_rtp_pack;
+			break;
+		}
+#endif
+		rtpobj[channel_idx].payload.rtp_object_handler = rtsp2_mod_rtp_send;
 		break;		
+#if RTSP2_ZERO_COPY
+	case CMD_ADD_SUBSCRIBER:
+	{
+		mmf_subscriber_t *sub = (mmf_subscriber_t *)arg;
+		u32 ssrc;
+		
+		rtw_get_random_bytes(&ssrc, sizeof(ssrc));
+		rtw_mutex_get(&rtsp2_fanout_lock);
+		sub->id = rtp_fanout_add(&rtpobj[channel_idx].fanout, sub->addr, htons(sub->port), ssrc, (u16)ssrc, 0);
+		if(sub->id >= 0 && sub->ttl > rtpobj[channel_idx].ttl){
+			rtpobj[channel_idx].ttl = sub->ttl;
+			rtpobj[channel_idx].ttl_socket = -1;
+		}
+		rtw_mutex_put(&rtsp2_fanout_lock);
+		if(sub->id < 0)
+			return -ENOMEM;
+		break;
+	}
+	case CMD_DEL_SUBSCRIBER:
+		rtw_mutex_get(&rtsp2_fanout_lock);
+		if(arg != rtpobj[channel_idx].session_client)
+			rtp_fanout_remove(&rtpobj[channel_idx].fanout, arg);
+		rtw_mutex_put(&rtsp2_fanout_lock);
+		break;
+	case CMD_SET_RATE_CTRL:
+		if(arg && (stream_ctx->bitrate == 0 || stream_ctx->framerate == 0))
+			return -EINVAL;
+		if(arg)
+			rtp_rate_init(&rtpobj[channel_idx].rate, stream_ctx->bitrate / RTSP2_RATE_MIN_DIV, stream_ctx->bitrate,
+				RTSP2_RATE_MIN_FPS, stream_ctx->framerate);
+		rtpobj[channel_idx].rate_src = (msrc_context *)arg;
+		break;
+#endif
         case CMD_SET_FLAG:
                 if(arg == TIME_SYNC_DIS)
                   time_sync_disable();
@@ -176,9 +465,20 @@ int rtsp2_mod_set_param(void* ctx, int cmd, int arg)
 }
 
 // private function
-int rtsp2_mod_wait_complete(void)
+// wait for the rtp task to send the payload and put it back on the output queue
+int rtsp2_mod_wait_complete(struct rtsp_context *rtsp_ctx, struct stream_context *stream_ctx, struct __internal_payload *obj)
 {
-        return 1;
+	while(list_empty(&stream_ctx->output_queue)){
+		if(rtsp_ctx->state != RTSP_PLAYING)
+			return 0;
+		// sent_sema is given just before the rtp task requeues the object,
+		// a lower priority rtp task may not have got there yet
+		if(rtw_down_timeout_sema(&obj->sent_sema, RTSP2_SENT_TIMEOUT) && list_empty(&stream_ctx->output_queue)){
+			obj->sent_fallback++;
+			vTaskDelay(1);
+		}
+	}
+	return 1;
 }
 
 // private function
@@ -193,6 +493,7 @@ int rtsp2_mod_handle(void* ctx, void* b)
 	struct rtsp_context *rtsp_ctx = (struct rtsp_context *)ctx;
 	exch_buf_t *exbuf = (exch_buf_t*)b;	
 	struct stream_context *stream_ctx = NULL;
+	struct __internal_payload *obj = NULL;
 	struct rtp_object *payload = NULL;//&rtp_payload;
 
         if(exbuf->state != STAT_READY)
@@ -202,6 +503,7 @@ int rtsp2_mod_handle(void* ctx, void* b)
 	for(int i=0;i<rtsp_ctx->nb_streams;i++){
 		if(rtpobj[i].codec_id == codec_map[exbuf->codec_fmt&0xf]){
 			stream_ctx = &rtsp_ctx->stream_ctx[i];
+			obj = &rtpobj[i];
 			break;
 		}
 	}
@@ -215,10 +517,11 @@ int rtsp2_mod_handle(void* ctx, void* b)
             goto end;	
 	// wait output not empty and get one
 	// Get payload from rtsp module
-	do{
-		payload = rtp_object_out_stream_queue(stream_ctx);
-		if(payload==NULL)	vTaskDelay(1);
-	}while(payload == NULL);
+	if(!rtsp2_mod_wait_complete(rtsp_ctx, stream_ctx, obj))
+		goto end;
+	payload = rtp_object_out_stream_queue(stream_ctx);
+	if(payload == NULL)
+		goto end;
 	
 	// insert payload to rtsp_ctx stream
 	//printf("%d\n\r", xTaskGetTickCount());
@@ -228,6 +531,10 @@ int rtsp2_mod_handle(void* ctx, void* b)
 	payload->len = exbuf->len;
 	//payload->timestamp = (rtw_get_current_time()-rtsp_tick_offset)*90;
 	payload->timestamp = exbuf->timestamp;//rtsp_get_current_tick();
+#if RTSP2_ZERO_COPY
+	// only from sources that index the access unit, the others are scanned in rtsp2_mod_rtp_pack()
+	obj->frame_au = (exbuf->codec_fmt == FMT_V_H264 && exbuf->priv_type == PRIV_H264_AU) ? (const h264_au_t *)exbuf->priv : NULL;
+#endif
 	//printf("ts: %8x\n\r", payload->timestamp);
 	/* because we will fill&send a complete frame in single rtp object, set both fs & fe to 1 and fd to 0*/
 	rtp_object_set_fs(payload, 1);
@@ -236,13 +543,12 @@ int rtsp2_mod_handle(void* ctx, void* b)
 	/* set payload state to READY to enable rtp task process this rtp object;*/
 	payload->state = RTP_OBJECT_READY; 
 	
+	// forget completions of earlier sends, one is given for this payload
+	while(rtw_down_timeout_sema(&obj->sent_sema, 0));
 	rtp_object_in_stream_queue(payload, stream_ctx);
 	
-	// TODO: use inter task communication
 	// wait payload state to IDEL or USED
-	rtsp2_mod_wait_complete();
-	while(list_empty(&stream_ctx->output_queue))
-		vTaskDelay(1);
+	rtsp2_mod_wait_complete(rtsp_ctx, stream_ctx, obj);
 end:
         exbuf->state = STAT_USED;
 	return 0;
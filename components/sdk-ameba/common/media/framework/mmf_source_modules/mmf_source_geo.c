@@ -223,6 +223,7 @@ recap:
 		exbuf->index = buf.index;
 		exbuf->data = data_buf;
 		exbuf->len = data_size;
+		exbuf->priv_type = PRIV_NONE;	// not indexed, sinks scan the start codes
 		if(this_id == FMT_A_MP4A_LATM){
 			exbuf->timestamp = (u32)( ts*16/90);//ts*16000/1000/90
 		}
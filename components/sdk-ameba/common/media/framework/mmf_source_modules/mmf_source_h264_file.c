@@ -1,5 +1,5 @@
 #include "mmf_source.h"
-
+#include "h264/h264_nal.h"
 
 #include "sample_h264.h"
 
@@ -22,29 +22,17 @@ int h264f_mod_set_param(void* ctx, int cmd, int arg)
 	return 0;
 }
 
-static unsigned char* seek_to_next(unsigned char* ptr, unsigned char* ptr_end)
-{
-	ptr+=3;
-	
-	while( ptr < ptr_end ){
-		if(ptr[0]==0 && ptr[1]==0){
-			if(ptr[2]==0 && ptr[3]==1 )
-				return ptr;
-			else if(ptr[2]==1)
-				return ptr;
-		}
-		ptr++;
-	}
-	
-	return NULL;
-}
+// NAL tables of the frames handed out, more than the exchange buffers in flight
+#define H264F_AU_NUM	4
+static h264_au_t h264f_au[H264F_AU_NUM];
+static int h264f_au_idx = 0;
 
-static unsigned char *sample = (unsigned char*)h264_sample;
 static unsigned char *next_sample = (unsigned char *)h264_sample;
-u8 *ptr = NULL;
 int h264f_mod_handle(void* ctx, void* b)
 {
-	int ret = 0;
+	unsigned char *sample_end = (unsigned char*)h264_sample + h264_sample_len;
+	h264_au_t *au = &h264f_au[h264f_au_idx];
+	u32 len;
 	
 	(void)ctx;
 	
@@ -52,20 +40,23 @@ int h264f_mod_handle(void* ctx, void* b)
 	
 	/*get uvc buffer for new data*/
 	if(exbuf->state!=STAT_READY){	
-		sample = next_sample;
-		ptr = sample;        
-		next_sample = seek_to_next(sample, (unsigned char*)h264_sample+h264_sample_len);
-		if(next_sample == NULL)
-		{
+		// one access unit per buffer, indexed once
+		len = h264_au_index(next_sample, sample_end, au);
+		if(len == 0){
 			//replay
-			exbuf->len = h264_sample + h264_sample_len - sample;
-			next_sample = (unsigned char*)h264_sample; 
-		}else{
-			exbuf->len = next_sample - sample;
-		}               
+			next_sample = (unsigned char*)h264_sample;
+			len = h264_au_index(next_sample, sample_end, au);
+			if(len == 0)
+				return -EAGAIN;
+		}
+		next_sample += len;
+		h264f_au_idx = (h264f_au_idx + 1)%H264F_AU_NUM;
 		
 		exbuf->index = 0;
-		exbuf->data = sample;
+		exbuf->data = (unsigned char*)au->data;
+		exbuf->len = au->len;
+		exbuf->priv = au;
+		exbuf->priv_type = PRIV_H264_AU;
 		exbuf->timestamp = 0;
 		//vTaskDelay(500);
 		exbuf->state = STAT_READY;
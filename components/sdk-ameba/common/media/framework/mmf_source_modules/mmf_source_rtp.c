@@ -4,6 +4,8 @@
 #include "lwip/api.h" //netconn use
 #include <lwip/sockets.h>
 #include "rtsp/rtp_api.h"
+#include "rtp_jitter.h"
+#include "g711/g711_plc.h"
 
 #define MAX_SELECT_SOCKET       8
 #define DEFAULT_RTP_PORT        16384
@@ -11,33 +13,39 @@
 #if CONFIG_EXAMPLE_MP3_STREAM_RTP    
 #define G711_BLK_SIZE   (634)
 #define AUDIO_BUF_SIZE  (646) //160 BYTE DATA + 12 BYTE RTP HEADER
+#define RTP_CLOCK       (90000)
+#define RTP_FRAME_TS    (2351) //1152 samples at 44.1KHz
+#define RTP_JB_SLOTS    (8)
+#define RTP_G711        (0)
 #else
 #define G711_BLK_SIZE   (160)
 #define AUDIO_BUF_SIZE  (172) //160 BYTE DATA + 12 BYTE RTP HEADER
+#define RTP_CLOCK       (8000)
+#define RTP_FRAME_TS    (160)
+#define RTP_JB_SLOTS    (16) //320ms of 20ms frames
+#define RTP_G711        (1) //losses concealed, frames played a sample short or long
 #endif
 
-#define AUDIO_BUF_DEPTH   (4)
-
-typedef struct rtp_exbuf_type
-{
-    u8 buf[AUDIO_BUF_SIZE];
-    int len;
-}rtp_exbuf_t;
+// frames handed to the sink: the 3 the queue holds, the one it plays and the one being filled
+#define RTP_OUT_NUM     (5)
 
 typedef struct rtp_client_type
 {
     TaskHandle_t task_handle;
-    xQueueHandle cache_queue;
-    xQueueHandle done_queue;
     struct connect_context connect_ctx;
     _sema rtp_sema;
     u8 rtp_shutdown;
+    // packets in sequence order, filled by the client task and played by the handle
+    _mutex jb_lock;
+    rtp_jitter_t jb;
+    rtp_jb_slot_t jb_slot[RTP_JB_SLOTS];
+    u8 *jb_mem;
+    g711_plc_t plc;
+    u8 out[RTP_OUT_NUM][G711_BLK_SIZE + 2]; //room for a frame played two samples long
+    int out_order;
 }rtp_client_t;
 
-//static u8* priv_buf[AUDIO_BUF_DEPTH];
-
-static rtp_exbuf_t rtp_buf;
-static int q_depth = 0;
+static u8 rtp_buf[AUDIO_BUF_SIZE];
 
 static long listen_time_s = 0;
 static long listen_time_us = 20000; //20ms
@@ -47,15 +55,13 @@ int rtp_client_start(void *param)
     rtp_client_t *rtp_ctx = (rtp_client_t *)param;
     u32 start_time, current_time;
     int ret = 0;
-    int len, offset;
-    rtp_hdr_t rtp_header;
+    int len;
     struct sockaddr_in rtp_addr;                                      
     socklen_t addrlen = sizeof(struct sockaddr_in); 
     fd_set read_fds;
     struct timeval listen_timeout;
     int mode = 0;
     int opt = 1;
-    u16 last_seq = 0;
     start_time = rtw_get_current_time();
     wext_get_mode(WLAN0_NAME, &mode);
     printf("\n\rwlan mode:%d", mode);
@@ -122,22 +128,16 @@ int rtp_client_start(void *param)
         listen_timeout.tv_sec = listen_time_s;
         listen_timeout.tv_usec = listen_time_us;
         FD_SET(rtp_ctx->connect_ctx.socket_id, &read_fds);
-        if(select(MAX_SELECT_SOCKET, &read_fds, NULL, NULL, &listen_timeout))
+        if(select(MAX_SELECT_SOCKET, &read_fds, NULL, NULL, &listen_timeout) > 0)
         {
-            //q_depth = uxQueueSpacesAvailable(rtp_ctx->done_queue);
-            //if(q_depth > 0)
-            if(xQueueReceive(rtp_ctx->done_queue, (void *)&rtp_buf, 0xFFFFFFFF) != pdTRUE){
-                    continue;
-                    //insert silence here 
-            }          
-            //printf("\n\ro");         
-            memset(rtp_buf.buf, 0, AUDIO_BUF_SIZE);
-            len = recvfrom(rtp_ctx->connect_ctx.socket_id, rtp_buf.buf, AUDIO_BUF_SIZE, 0, (struct sockaddr *)&rtp_addr, &addrlen); 
-            rtp_buf.len = len;
-            xQueueSend(rtp_ctx->cache_queue, (void *)&rtp_buf, 0xFFFFFFFF);
-        }else{          
-            //printf("\n\r.");
-            //insert silence here
+            len = recvfrom(rtp_ctx->connect_ctx.socket_id, rtp_buf, AUDIO_BUF_SIZE, 0, (struct sockaddr *)&rtp_addr, &addrlen); 
+            if(len <= 0)
+                continue;
+            // never waits for the player, a late packet is only useful in the jitter buffer
+            rtw_mutex_get(&rtp_ctx->jb_lock);
+            if(rtp_ctx->jb_mem)
+                rtp_jitter_put(&rtp_ctx->jb, rtp_buf, len, rtw_systime_to_ms(rtw_get_current_time()));
+            rtw_mutex_put(&rtp_ctx->jb_lock);
         }
     }
 exit:
@@ -173,9 +173,11 @@ void* rtp_mod_open(void)
     /* set default port */
     rtp_ctx->connect_ctx.socket_id = -1;
     rtp_ctx->connect_ctx.server_port = DEFAULT_RTP_PORT;
+    rtw_mutex_init(&rtp_ctx->jb_lock);
 /* create a rtp client to receive audio data */
     if(xTaskCreate(rtp_client_init, ((const char*)"rtp_client_init"), 512, rtp_ctx, 2, &rtp_ctx->task_handle) != pdPASS) {
         //printf("\r\n geo_rtp_client_init: Create Task Error\n");
+        rtw_mutex_free(&rtp_ctx->jb_lock);
         free(rtp_ctx);
         return NULL;
     }    
@@ -187,6 +189,9 @@ void rtp_mod_close(void* ctx)
     rtp_client_t *rtp_ctx = (rtp_client_t *)ctx;
     if(!rtp_ctx->task_handle && xTaskGetCurrentTaskHandle()!=rtp_ctx->task_handle)
         vTaskDelete(rtp_ctx->task_handle);
+    if(rtp_ctx->jb_mem)
+        free(rtp_ctx->jb_mem);
+    rtw_mutex_free(&rtp_ctx->jb_lock);
     free(rtp_ctx);
 }
 
@@ -199,33 +204,45 @@ int rtp_mod_set_param(void* ctx, int cmd, int arg)
     switch(cmd)
     {
       case(CMD_SET_PRIV_BUF):
-          if(arg==1)//initially set queue
+          rtw_mutex_get(&rtp_ctx->jb_lock);
+          if(arg==1)//initially set jitter buffer
           {
-              rtp_ctx->cache_queue = xQueueCreate(AUDIO_BUF_DEPTH, sizeof(rtp_exbuf_t));
-              rtp_ctx->done_queue = xQueueCreate(AUDIO_BUF_DEPTH, sizeof(rtp_exbuf_t));          
-          }else if(arg==2)//reset queue
+              if(rtp_ctx->jb_mem == NULL)
+                  rtp_ctx->jb_mem = malloc(RTP_JB_SLOTS * AUDIO_BUF_SIZE);
+              if(rtp_ctx->jb_mem == NULL)
+                  ret = -EFAULT;
+              else
+                  rtp_jitter_init(&rtp_ctx->jb, rtp_ctx->jb_slot, rtp_ctx->jb_mem, RTP_JB_SLOTS, AUDIO_BUF_SIZE,
+                                  RTP_CLOCK, RTP_FRAME_TS, RTP_G711);
+              g711_plc_init(&rtp_ctx->plc, I2S_MODE_G711U);
+          }else if(arg==2)//reset jitter buffer
           {
-              xQueueReset(rtp_ctx->cache_queue);
-              xQueueReset(rtp_ctx->done_queue);              
-          }else if(arg==0)//delete queue
+              if(rtp_ctx->jb_mem)
+                  rtp_jitter_reset(&rtp_ctx->jb);
+              g711_plc_init(&rtp_ctx->plc, rtp_ctx->plc.law);
+          }else if(arg==0)//delete jitter buffer
           {
-              vQueueDelete(rtp_ctx->cache_queue);
-              vQueueDelete(rtp_ctx->done_queue);
-              break;
+              if(rtp_ctx->jb_mem)
+                  free(rtp_ctx->jb_mem);
+              rtp_ctx->jb_mem = NULL;
           }else{
               ret = -EINVAL;
-              break;
-          }
-          for(int i = 0; i < AUDIO_BUF_DEPTH; i++)
-          {
-              xQueueSend(rtp_ctx->done_queue, (void*)&rtp_buf, 0xFFFFFFFF);
           }
+          rtw_mutex_put(&rtp_ctx->jb_lock);
+          break;
+      case(CMD_GET_JITTER_STATS):
+          rtw_mutex_get(&rtp_ctx->jb_lock);
+          if(rtp_ctx->jb_mem)
+              rtp_jitter_get_stats(&rtp_ctx->jb, (rtp_jitter_stats_t*)arg);
+          else
+              ret = -EINVAL;
+          rtw_mutex_put(&rtp_ctx->jb_lock);
           break;
       case(CMD_SET_STREAMMING):
           if(arg == ON){	// stream on
                   rtw_up_sema(&rtp_ctx->rtp_sema);
           }else{			// stream off
-                  rtp_ctx->rtp_shutdown = 0;
+                  rtp_ctx->rtp_shutdown = 1;
           }	
           break;          
       default:
@@ -235,62 +252,66 @@ int rtp_mod_set_param(void* ctx, int cmd, int arg)
     return ret;
 }
 
-//give audio data here
+static int rtp_pt_g711(u8 pt)
+{
+    return (pt == RTP_PT_PCMU) || (pt == RTP_PT_PCMA);
+}
 
-rtp_exbuf_t tmp_exbuf[3];
-static int tmp_order = 0;
-static u16 last_seq = 0;
+//give audio data here, one frame per call at the rate the sink plays
 int rtp_mod_handle(void* ctx, void* b)
 {
-    int ret = 0;
-    int q_depth = 0;
     rtp_client_t *rtp_ctx = (rtp_client_t *)ctx;
     exch_buf_t *exbuf = (exch_buf_t*)b;   
-    rtp_hdr_t rtp_header;
-    int offset;
-    if(exbuf->state==STAT_USED){
-            xQueueSend(rtp_ctx->done_queue, (void *)&tmp_exbuf[exbuf->index], 0xFFFFFFFF);
+    rtp_jb_frame_t frame;
+    u8 *out = rtp_ctx->out[rtp_ctx->out_order];
+    int ret, len = 0;
+    if(exbuf->state==STAT_USED)
             exbuf->state = STAT_INIT;
-    }    
-    //decide if audio cache is enough for send
-    q_depth = uxQueueSpacesAvailable(rtp_ctx->cache_queue);
-    //printf("\n\rQ-%d", q_depth);
-    if(q_depth >= AUDIO_BUF_DEPTH/2)
-        return -EAGAIN;
-    if(xQueueReceive(rtp_ctx->cache_queue, (void *)&tmp_exbuf[tmp_order], 0xFFFFFFFF) != pdTRUE)
-        return -EAGAIN;
-    offset = rtp_parse_header(tmp_exbuf[tmp_order].buf, &rtp_header, 1);
-    //printf("\n\r%d-%dB", offset, tmp_exbuf[tmp_order].len);
-/* for data loss debugging */
-#if 1
-    if(last_seq == 0)
-        last_seq = ntohs(rtp_header.seq);
-    else
+    if(exbuf->state==STAT_READY)
+            return 0;
+    rtw_mutex_get(&rtp_ctx->jb_lock);
+    ret = rtp_ctx->jb_mem ? rtp_jitter_get(&rtp_ctx->jb, &frame, rtw_systime_to_ms(rtw_get_current_time())) : RTP_JB_NONE;
+    if(ret != RTP_JB_NONE)
+        len = frame.len;
+    if(ret == RTP_JB_PACKET)
     {
-        if((ntohs(rtp_header.seq) - last_seq)>1)
-            printf("\n\r(%d-%d)", last_seq, ntohs(rtp_header.seq));
-        last_seq = ntohs(rtp_header.seq); 
+        if(len > G711_BLK_SIZE)
+            len = G711_BLK_SIZE;
+        memcpy(out, frame.data, len);
     }
-#endif    
-    
+    rtw_mutex_put(&rtp_ctx->jb_lock);
+
+    if(ret == RTP_JB_PACKET)
+    {
 #if CONFIG_EXAMPLE_MP3_STREAM_RTP    
-    if((rtp_header.pt == RTP_PT_PCMU) || (rtp_header.pt == RTP_PT_DYN_BASE) || (rtp_header.pt == RTP_PT_MPA))
+        if((frame.pt != RTP_PT_PCMU) && (frame.pt != RTP_PT_DYN_BASE) && (frame.pt != RTP_PT_MPA))
 #else
-    if(rtp_header.pt == RTP_PT_PCMU)
+        if(!rtp_pt_g711(frame.pt))
 #endif
-    {
-        if(exbuf->state!=STAT_READY){
-            exbuf->index = tmp_order;
-            exbuf->data = tmp_exbuf[tmp_order].buf + offset;
-            exbuf->len = tmp_exbuf[tmp_order].len - offset;
-            //exbuf->timestamp = ?;
-            exbuf->state = STAT_READY;
-            tmp_order++;
-            if(tmp_order == 3)
-                tmp_order = 0;
+            return -EAGAIN;
+        if(rtp_pt_g711(frame.pt))
+        {
+            if((frame.pt == RTP_PT_PCMA) != (rtp_ctx->plc.law == I2S_MODE_G711A))
+                g711_plc_init(&rtp_ctx->plc, frame.pt == RTP_PT_PCMA ? I2S_MODE_G711A : I2S_MODE_G711U);
+            // drift and delay correction, then history for the concealment
+            len = g711_plc_adjust(&rtp_ctx->plc, out, len, frame.adjust);
+            g711_plc_good(&rtp_ctx->plc, out, len);
         }
-    }
-    return ret;
+    }else if(ret == RTP_JB_LOST && RTP_G711)
+    {
+        if(len > G711_BLK_SIZE)
+            len = G711_BLK_SIZE;
+        g711_plc_conceal(&rtp_ctx->plc, out, len);
+    }else
+        return -EAGAIN;
+
+    exbuf->index = rtp_ctx->out_order;
+    exbuf->data = out;
+    exbuf->len = len;
+    exbuf->state = STAT_READY;
+    if(++rtp_ctx->out_order == RTP_OUT_NUM)
+        rtp_ctx->out_order = 0;
+    return 0;
 }
 
 msrc_module_t rtp_src_module =
@@ -132,6 +132,7 @@ int uvc_mod_handle(void* ctx, void* b)
 		exbuf->index = buf.index;
 		exbuf->data = buf.data;
 		exbuf->len = buf.len;
+		exbuf->priv_type = PRIV_NONE;	// not indexed, sinks scan the start codes
 		exbuf->timestamp = 0;
 		//vTaskDelay(500);
 		exbuf->state = STAT_READY;
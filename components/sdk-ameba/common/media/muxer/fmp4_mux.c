@@ -0,0 +1,688 @@
+#include <platform/platform_stdlib.h>
+#include "fmp4_mux.h"
+#include "h264/h264_nal.h"
+
+#define AAC_FRAME				1024	// samples
+
+// trun sample flags
+#define SAMPLE_SYNC				0x02000000	// depends on no other
+#define SAMPLE_NON_SYNC			0x01010000	// depends on others, not a sync sample
+
+static inline void put16(u8* p, u32 v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static inline void put32(u8* p, u32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static inline u32 get32(const u8* p)
+{
+	return ((u32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static u8* w8(u8* p, u32 v)
+{
+	*p = v;
+	return p + 1;
+}
+
+static u8* w16(u8* p, u32 v)
+{
+	put16(p, v);
+	return p + 2;
+}
+
+static u8* w32(u8* p, u32 v)
+{
+	put32(p, v);
+	return p + 4;
+}
+
+static u8* w64(u8* p, u64 v)
+{
+	put32(p, v >> 32);
+	put32(p + 4, v);
+	return p + 8;
+}
+
+static u8* wzero(u8* p, int n)
+{
+	memset(p, 0, n);
+	return p + n;
+}
+
+// box header, its size is set by wend
+static u8* wbox(u8* p, const char* type)
+{
+	put32(p, 0);
+	memcpy(p + 4, type, 4);
+	return p + 8;
+}
+
+static u8* wfull(u8* p, const char* type, u32 version_flags)
+{
+	return w32(wbox(p, type), version_flags);
+}
+
+static u8* wend(u8* box, u8* p)
+{
+	put32(box, p - box);
+	return p;
+}
+
+static u8* wmatrix(u8* p)
+{
+	p = w32(p, 0x00010000);
+	p = wzero(p, 12);
+	p = w32(p, 0x00010000);
+	p = wzero(p, 12);
+	return w32(p, 0x40000000);
+}
+
+static int aac_rate_index(int rate)
+{
+	static const int rates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350};
+	int i;
+
+	for(i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+		if(rates[i] == rate)
+			return i;
+	return 8;
+}
+
+static u8* wtrak(fmp4_mux_t* m, u8* p, int track)
+{
+	u8 *trak, *mdia, *minf, *dinf, *dref, *stbl, *stsd, *entry, *box;
+	int video = track == FMP4_VIDEO_TRACK, asc;
+
+	trak = p;
+	p = wbox(p, "trak");
+
+	box = p;
+	p = wfull(p, "tkhd", 3);	// enabled, in movie
+	p = wzero(p, 8);
+	p = w32(p, track);
+	p = wzero(p, 4 + 4 + 8 + 2 + 2);
+	p = w16(p, video ? 0 : 0x0100);
+	p = wzero(p, 2);
+	p = wmatrix(p);
+	p = w32(p, video ? m->cfg.width << 16 : 0);
+	p = w32(p, video ? m->cfg.height << 16 : 0);
+	p = wend(box, p);
+
+	mdia = p;
+	p = wbox(p, "mdia");
+	box = p;
+	p = wfull(p, "mdhd", 0);
+	p = wzero(p, 8);
+	p = w32(p, video ? FMP4_VIDEO_CLOCK : m->cfg.sample_rate);
+	p = w32(p, 0);
+	p = w16(p, 0x55c4);		// und
+	p = w16(p, 0);
+	p = wend(box, p);
+	box = p;
+	p = wfull(p, "hdlr", 0);
+	p = w32(p, 0);
+	memcpy(p, video ? "vide" : "soun", 4);
+	p = wzero(p + 4, 12);
+	memcpy(p, video ? "VideoHandler" : "SoundHandler", 13);
+	p = wend(box, p + 13);
+
+	minf = p;
+	p = wbox(p, "minf");
+	box = p;
+	if(video){
+		p = wfull(p, "vmhd", 1);
+		p = wzero(p, 8);
+	}else{
+		p = wfull(p, "smhd", 0);
+		p = wzero(p, 4);
+	}
+	p = wend(box, p);
+	dinf = p;
+	p = wbox(p, "dinf");
+	dref = p;
+	p = wfull(p, "dref", 0);
+	p = w32(p, 1);
+	box = p;
+	p = wend(box, wfull(p, "url ", 1));	// in this file
+	p = wend(dref, p);
+	p = wend(dinf, p);
+
+	stbl = p;
+	p = wbox(p, "stbl");
+	stsd = p;
+	p = wfull(p, "stsd", 0);
+	p = w32(p, 1);
+	entry = p;
+	if(video){
+		p = wbox(p, "avc1");
+		p = wzero(p, 6);
+		p = w16(p, 1);		// data reference
+		p = wzero(p, 16);
+		p = w16(p, m->cfg.width);
+		p = w16(p, m->cfg.height);
+		p = w32(p, 0x00480000);
+		p = w32(p, 0x00480000);
+		p = w32(p, 0);
+		p = w16(p, 1);
+		p = wzero(p, 32);
+		p = w16(p, 0x0018);
+		p = w16(p, 0xffff);
+		box = p;
+		p = wbox(p, "avcC");
+		p = w8(p, 1);
+		p = w8(p, m->sps[1]);	// profile, compatibility, level
+		p = w8(p, m->sps[2]);
+		p = w8(p, m->sps[3]);
+		p = w8(p, 0xff);		// 4 byte NAL lengths
+		p = w8(p, 0xe1);		// one SPS
+		p = w16(p, m->sps_len);
+		memcpy(p, m->sps, m->sps_len);
+		p = w8(p + m->sps_len, 1);
+		p = w16(p, m->pps_len);
+		memcpy(p, m->pps, m->pps_len);
+		p = wend(box, p + m->pps_len);
+	}else{
+		p = wbox(p, "mp4a");
+		p = wzero(p, 6);
+		p = w16(p, 1);
+		p = wzero(p, 8);
+		p = w16(p, m->cfg.channels);
+		p = w16(p, 16);
+		p = wzero(p, 4);
+		p = w32(p, m->cfg.sample_rate << 16);
+		// AAC LC AudioSpecificConfig
+		asc = (2 << 11) | (aac_rate_index(m->cfg.sample_rate) << 7) | (m->cfg.channels << 3);
+		box = p;
+		p = wfull(p, "esds", 0);
+		p = w8(p, 0x03);		// ES_Descriptor
+		p = w8(p, 25);
+		p = w16(p, 0);
+		p = w8(p, 0);
+		p = w8(p, 0x04);		// DecoderConfigDescriptor
+		p = w8(p, 17);
+		p = w8(p, 0x40);		// MPEG-4 audio
+		p = w8(p, 0x15);		// audio stream
+		p = wzero(p, 3 + 4 + 4);
+		p = w8(p, 0x05);		// DecoderSpecificInfo
+		p = w8(p, 2);
+		p = w16(p, asc);
+		p = w8(p, 0x06);		// SLConfigDescriptor
+		p = w8(p, 1);
+		p = w8(p, 0x02);
+		p = wend(box, p);
+	}
+	p = wend(entry, p);
+	p = wend(stsd, p);
+	// no samples here, they are all in fragments
+	box = p;
+	p = wend(box, w32(wfull(p, "stts", 0), 0));
+	box = p;
+	p = wend(box, w32(wfull(p, "stsc", 0), 0));
+	box = p;
+	p = wend(box, w32(w32(wfull(p, "stsz", 0), 0), 0));
+	box = p;
+	p = wend(box, w32(wfull(p, "stco", 0), 0));
+	p = wend(stbl, p);
+	p = wend(minf, p);
+	p = wend(mdia, p);
+	return wend(trak, p);
+}
+
+// ftyp and moov at p, return the end
+static u8* fmp4_header(fmp4_mux_t* m, u8* p)
+{
+	u8 *moov, *mvex, *box;
+	int track;
+
+	box = p;
+	p = wbox(p, "ftyp");
+	memcpy(p, "iso5", 4);
+	p = w32(p + 4, 512);
+	memcpy(p, "iso5iso6avc1mp41", 16);
+	p = wend(box, p + 16);
+
+	moov = p;
+	p = wbox(p, "moov");
+	box = p;
+	p = wfull(p, "mvhd", 0);
+	p = wzero(p, 8);
+	p = w32(p, 1000);
+	p = w32(p, 0);
+	p = w32(p, 0x00010000);
+	p = w16(p, 0x0100);
+	p = wzero(p, 10);
+	p = wmatrix(p);
+	p = wzero(p, 24);
+	p = w32(p, m->cfg.sample_rate ? FMP4_AUDIO_TRACK + 1 : FMP4_VIDEO_TRACK + 1);
+	p = wend(box, p);
+	p = wtrak(m, p, FMP4_VIDEO_TRACK);
+	if(m->cfg.sample_rate)
+		p = wtrak(m, p, FMP4_AUDIO_TRACK);
+	mvex = p;
+	p = wbox(p, "mvex");
+	for(track = FMP4_VIDEO_TRACK; track <= (m->cfg.sample_rate ? FMP4_AUDIO_TRACK : FMP4_VIDEO_TRACK); track++){
+		box = p;
+		p = wfull(p, "trex", 0);
+		p = w32(p, track);
+		p = w32(p, 1);
+		p = wzero(p, 12);
+		p = wend(box, p);
+	}
+	p = wend(mvex, p);
+	return wend(moov, p);
+}
+
+// n bytes at the write position, growing the file a prealloc step first if
+// they do not fit. A failed write stops all later ones
+static void fmp4_write(fmp4_mux_t* m, const u8* p, u32 n)
+{
+	UINT bw;
+	FRESULT res;
+
+	if(n == 0 || m->err)
+		return;
+	if(m->cfg.prealloc && m->file_pos + n > m->file_alloc){
+		// the cluster chain is allocated in one go, and made to survive a power cut
+		// before any data goes into it
+		m->file_alloc += (m->file_pos + n - m->file_alloc + m->cfg.prealloc - 1) / m->cfg.prealloc * m->cfg.prealloc;
+		res = f_lseek(m->fp, m->file_alloc);
+		if(res == FR_OK)
+			res = f_lseek(m->fp, m->file_pos);
+		if(res == FR_OK)
+			res = f_sync(m->fp);
+		if(res != FR_OK){
+			m->err = res;
+			return;
+		}
+		m->file_alloc = f_size(m->fp);	// less when the disk is full
+		m->stats.extends++;
+		m->stats.syncs++;
+	}
+	res = f_write(m->fp, p, n, &bw);
+	m->stats.writes++;
+	m->file_pos += bw;
+	if(res == FR_OK && bw != n)
+		res = FR_DENIED;	// disk full
+	if(res != FR_OK)
+		m->err = res;
+}
+
+static u32 fmp4_moof_len(fmp4_mux_t* m)
+{
+	u32 len = 8 + 16;
+
+	if(m->vnum)
+		len += 8 + 16 + 20 + 20 + m->vnum * 12;
+	if(m->anum)
+		len += 8 + 24 + 20 + 20 + m->anum * 4;
+	return len;
+}
+
+// moof and mdat header in front of the samples, then every whole block of
+// the stream out
+static void fmp4_fragment(fmp4_mux_t* m)
+{
+	u32 moof_len, start, end, n;
+	u8 *p, *moof, *traf, *box;
+	int i;
+
+	if(m->vnum == 0 && m->anum == 0)
+		return;
+	memcpy(m->buf + m->data + m->vlen, m->abuf, m->alen);
+	moof_len = fmp4_moof_len(m);
+	put32(m->buf + m->data - 8, 8 + m->vlen + m->alen);
+	memcpy(m->buf + m->data - 4, "mdat", 4);
+
+	moof = p = m->buf + m->data - 8 - moof_len;
+	p = wbox(p, "moof");
+	box = p;
+	p = wend(box, w32(wfull(p, "mfhd", 0), ++m->seq));
+	if(m->vnum){
+		traf = p;
+		p = wbox(p, "traf");
+		box = p;
+		p = wend(box, w32(wfull(p, "tfhd", 0x020000), FMP4_VIDEO_TRACK));	// default base is moof
+		box = p;
+		p = wend(box, w64(wfull(p, "tfdt", 0x01000000), m->vtime));
+		box = p;
+		p = wfull(p, "trun", 0x000701);		// data offset, durations, sizes, flags
+		p = w32(p, m->vnum);
+		p = w32(p, moof_len + 8);
+		for(i = 0; i < m->vnum; i++){
+			p = w32(p, m->vdur[i]);
+			p = w32(p, m->vsize[i]);
+			p = w32(p, m->vkey[i] ? SAMPLE_SYNC : SAMPLE_NON_SYNC);
+		}
+		p = wend(box, p);
+		p = wend(traf, p);
+	}
+	if(m->anum){
+		traf = p;
+		p = wbox(p, "traf");
+		box = p;
+		p = wfull(p, "tfhd", 0x020028);		// default base is moof, duration, flags
+		p = w32(p, FMP4_AUDIO_TRACK);
+		p = w32(p, AAC_FRAME);
+		p = wend(box, w32(p, SAMPLE_SYNC));
+		box = p;
+		p = wend(box, w64(wfull(p, "tfdt", 0x01000000), m->atime));
+		box = p;
+		p = wfull(p, "trun", 0x000201);		// data offset, sizes
+		p = w32(p, m->anum);
+		p = w32(p, moof_len + 8 + m->vlen);
+		for(i = 0; i < m->anum; i++)
+			p = w32(p, m->asz[i]);
+		p = wend(box, p);
+		p = wend(traf, p);
+	}
+	wend(moof, p);
+
+	// the carry moves up to the moof; data starts carry bytes after a multiple
+	// of 4 and the moof is a multiple of 4 long, so start stays aligned
+	start = moof - m->buf - m->carry;
+	memmove(m->buf + start, m->buf, m->carry);
+	end = m->data + m->vlen + m->alen;
+	n = (end - start) / m->block * m->block;
+	fmp4_write(m, m->buf + start, n);
+	m->carry = end - start - n;
+	memmove(m->buf, m->buf + start + n, m->carry);
+
+	m->stats.fragments++;
+	m->stats.video += m->vnum;
+	m->stats.audio += m->anum;
+	m->vtime += m->frag_dur;
+	m->atime += m->anum * AAC_FRAME;
+	m->frag_dur = 0;
+	m->vnum = m->anum = 0;
+	m->vlen = m->alen = 0;
+	m->data = m->carry + FMP4_MOOF_MAX;
+	m->stats.duration_ms = m->vtime / (FMP4_VIDEO_CLOCK / 1000);
+
+	if(m->cfg.sync_ms && m->stats.duration_ms - m->last_sync >= m->cfg.sync_ms && !m->err){
+		m->err = f_sync(m->fp);
+		m->stats.syncs++;
+		m->last_sync = m->stats.duration_ms;
+	}
+}
+
+int fmp4_mux_open(fmp4_mux_t* m, FIL* fp, const fmp4_config_t* cfg, u8* buf, u32 size)
+{
+	memset(m, 0, sizeof(fmp4_mux_t));
+	m->cfg = *cfg;
+	m->fp = fp;
+	m->block = cfg->write_block ? cfg->write_block / 512 * 512 : 512;
+	if(cfg->frame_rate <= 0)
+		m->cfg.frame_rate = 30;
+	if(cfg->sample_rate){
+		m->asize = size / FMP4_AUDIO_SHARE & ~3;
+		size -= m->asize;
+		m->abuf = buf + size;
+	}
+	// a header or carried block, the moof room and a large frame
+	if(((uintptr_t)buf & 3) || size < m->block + FMP4_MOOF_MAX + 16 * 1024)
+		return FR_INVALID_PARAMETER;
+	m->buf = buf;
+	m->size = size;
+	m->data = FMP4_MOOF_MAX;
+	return FR_OK;
+}
+
+static int fmp4_start(fmp4_mux_t* m, const u8* au, const h264_au_t* idx)
+{
+	const h264_nal_t* nal;
+	int i;
+
+	for(i = 0; i < idx->num_nal; i++){
+		nal = &idx->nal[i];
+		if(nal->len > FMP4_PS_MAX)
+			continue;
+		if(nal->type == H264_NAL_SPS && nal->len >= 4){
+			memcpy(m->sps, au + nal->offset, nal->len);
+			m->sps_len = nal->len;
+		}else if(nal->type == H264_NAL_PPS){
+			memcpy(m->pps, au + nal->offset, nal->len);
+			m->pps_len = nal->len;
+		}
+	}
+	if(m->sps_len == 0 || m->pps_len == 0)
+		return -1;
+	m->carry = fmp4_header(m, m->buf) - m->buf;
+	m->data = m->carry + FMP4_MOOF_MAX;
+	m->started = 1;
+	return 0;
+}
+
+int fmp4_mux_video(fmp4_mux_t* m, const u8* au, u32 len, u32 ts)
+{
+	h264_au_t idx;
+	const h264_nal_t* nal;
+	u32 sample = 0, d, nominal;
+	u8* p;
+	int i;
+
+	if(m->err)
+		return m->err;
+	if(h264_au_index(au, au + len, &idx) == 0 || (!m->started && (!idx.key || fmp4_start(m, idx.data, &idx) < 0))){
+		m->stats.dropped++;
+		return 0;
+	}
+	// parameter sets are in avcC, delimiters are not needed
+	for(i = 0; i < idx.num_nal; i++)
+		if(idx.nal[i].type != H264_NAL_SPS && idx.nal[i].type != H264_NAL_PPS && idx.nal[i].type != H264_NAL_AUD)
+			sample += 4 + idx.nal[i].len;
+
+	// the previous sample lasts until this one
+	nominal = FMP4_VIDEO_CLOCK / m->cfg.frame_rate;
+	if(m->vnum){
+		d = ts - m->last_ts;
+		if(d == 0 || d > FMP4_VIDEO_CLOCK)
+			d = nominal;
+		m->frag_dur += d - m->vdur[m->vnum - 1];
+		m->vdur[m->vnum - 1] = d;
+	}
+	m->last_ts = ts;
+
+	if(m->vnum && ((idx.key && m->frag_dur >= m->cfg.fragment_ms * (FMP4_VIDEO_CLOCK / 1000)) ||
+			m->vnum == FMP4_VIDEO_MAX || m->data + m->vlen + m->alen + sample > m->size))
+		fmp4_fragment(m);
+	if(sample == 0 || m->data + m->vlen + m->alen + sample > m->size){
+		m->stats.dropped++;
+		return m->err;
+	}
+
+	p = m->buf + m->data + m->vlen;
+	for(i = 0; i < idx.num_nal; i++){
+		nal = &idx.nal[i];
+		if(nal->type == H264_NAL_SPS || nal->type == H264_NAL_PPS || nal->type == H264_NAL_AUD)
+			continue;
+		put32(p, nal->len);
+		memcpy(p + 4, idx.data + nal->offset, nal->len);
+		p += 4 + nal->len;
+	}
+	m->vsize[m->vnum] = sample;
+	m->vdur[m->vnum] = nominal;	// until the next one comes
+	m->vkey[m->vnum] = idx.key;
+	m->vnum++;
+	m->vlen += sample;
+	m->frag_dur += nominal;
+	return m->err;
+}
+
+int fmp4_mux_audio(fmp4_mux_t* m, const u8* frame, u32 len)
+{
+	u32 hdr;
+
+	if(m->err)
+		return m->err;
+	if(!m->started || m->cfg.sample_rate == 0){
+		m->stats.dropped++;
+		return 0;
+	}
+	// ADTS header, 9 bytes with a CRC
+	if(len >= 7 && frame[0] == 0xff && (frame[1] & 0xf0) == 0xf0){
+		hdr = (frame[1] & 1) ? 7 : 9;
+		frame += hdr;
+		len -= hdr;
+	}
+	if(m->anum == FMP4_AUDIO_MAX || m->alen + len > m->asize || m->data + m->vlen + m->alen + len > m->size)
+		fmp4_fragment(m);
+	if(len == 0 || len > 0xffff || m->alen + len > m->asize || m->data + m->vlen + m->alen + len > m->size){
+		m->stats.dropped++;
+		return m->err;
+	}
+	memcpy(m->abuf + m->alen, frame, len);
+	m->asz[m->anum++] = len;
+	m->alen += len;
+	return m->err;
+}
+
+int fmp4_mux_close(fmp4_mux_t* m)
+{
+	FRESULT res;
+
+	fmp4_fragment(m);
+	fmp4_write(m, m->buf, m->carry);
+	m->carry = 0;
+	if(m->err)
+		return m->err;
+	res = FR_OK;
+	if(f_size(m->fp) > m->file_pos)
+		res = f_truncate(m->fp);
+	if(res == FR_OK)
+		res = f_sync(m->fp);
+	m->stats.syncs++;
+	if(res != FR_OK)
+		m->err = res;
+	return res;
+}
+
+void fmp4_mux_get_stats(fmp4_mux_t* m, fmp4_stats_t* stats)
+{
+	*stats = m->stats;
+	stats->bytes = m->file_pos + m->carry;
+	stats->duration_ms = (m->vtime + m->frag_dur) / (FMP4_VIDEO_CLOCK / 1000);
+}
+
+static int fmp4_read(FIL* fp, u32 pos, u8* b, u32 n)
+{
+	UINT br;
+
+	if(f_lseek(fp, pos) != FR_OK || f_read(fp, b, n, &br) != FR_OK || br != n)
+		return -1;
+	return 0;
+}
+
+// the bytes of samples a moof at pos describes, and the furthest of them
+// from it, or -1 if it is not a valid one with number seq
+static int fmp4_check_moof(FIL* fp, u32 pos, u32 len, u32 seq, u32* total, u32* reach)
+{
+	u8 b[48];
+	u32 off = pos + 8, end = pos + len, box, traf_end, flags, count, data_off, entry, sum, i, j, k, n;
+
+	*total = 0;
+	*reach = 0;
+	if(fmp4_read(fp, off, b, 16) < 0 || memcmp(b + 4, "mfhd", 4) || get32(b + 12) != seq)
+		return -1;
+	off += get32(b);
+	while(off + 8 <= end){
+		if(fmp4_read(fp, off, b, 8) < 0 || (box = get32(b)) < 8 || off + box > end)
+			return -1;
+		if(memcmp(b + 4, "traf", 4)){
+			off += box;
+			continue;
+		}
+		traf_end = off + box;
+		for(off += 8; off + 8 <= traf_end; off += box){
+			if(fmp4_read(fp, off, b, 8) < 0 || (box = get32(b)) < 8 || off + box > traf_end)
+				return -1;
+			if(memcmp(b + 4, "trun", 4))
+				continue;
+			if(fmp4_read(fp, off + 8, b, 12) < 0)
+				return -1;
+			flags = get32(b) & 0xffffff;
+			count = get32(b + 4);
+			data_off = get32(b + 8);
+			// only what fmp4_fragment writes: a data offset and each sample's size
+			if((flags & 0x205) != 0x201)
+				return -1;
+			entry = ((flags >> 8) & 1) * 4 + 4 + ((flags >> 10) & 1) * 4 + ((flags >> 11) & 1) * 4;
+			k = ((flags >> 8) & 1) * 4;		// size after the duration
+			if(20 + count * entry > box)
+				return -1;
+			for(sum = 0, i = 0; i < count; i += n){
+				n = count - i < sizeof(b) / entry ? count - i : sizeof(b) / entry;
+				if(fmp4_read(fp, off + 20 + i * entry, b, n * entry) < 0)
+					return -1;
+				for(j = 0; j < n; j++)
+					sum += get32(b + j * entry + k);
+			}
+			if(data_off < len + 8)
+				return -1;
+			*total += sum;
+			if(*reach < data_off + sum)
+				*reach = data_off + sum;
+		}
+		off = traf_end;
+	}
+	return 0;
+}
+
+int fmp4_mux_recover(FIL* fp)
+{
+	u8 b[24];
+	u32 pos = 0, keep = 0, size = f_size(fp), box, seq = 1, total, reach, end;
+	int fragments = 0;
+
+	if(fmp4_read(fp, 0, b, 8) < 0 || memcmp(b + 4, "ftyp", 4))
+		return -1;
+	// ftyp, moov and anything else before the first moof
+	while(pos + 8 <= size){
+		if(fmp4_read(fp, pos, b, 8) < 0 || (box = get32(b)) < 8 || pos + box > size)
+			return -1;
+		if(memcmp(b + 4, "moof", 4) == 0)
+			break;
+		pos += box;
+		if(memcmp(b + 4, "moov", 4) == 0)
+			keep = pos;
+	}
+	if(keep == 0)
+		return -1;
+
+	// a fragment counts when its mdat is followed by the end of the file or by
+	// the next moof: only then was all of it written before the power went
+	while(pos + 8 <= size){
+		if(fmp4_read(fp, pos, b, 8) < 0 || memcmp(b + 4, "moof", 4) || (box = get32(b)) < 24 || pos + box + 8 > size)
+			break;
+		if(fmp4_check_moof(fp, pos, box, seq, &total, &reach) < 0)
+			break;
+		if(fmp4_read(fp, pos + box, b, 8) < 0 || memcmp(b + 4, "mdat", 4) || get32(b) != 8 + total ||
+				reach > box + 8 + total)
+			break;
+		end = pos + box + 8 + total;
+		if(end > size)
+			break;
+		if(end != size && (end + 24 > size || fmp4_read(fp, end, b, 24) < 0 || memcmp(b + 4, "moof", 4) ||
+				memcmp(b + 12, "mfhd", 4) || get32(b + 20) != seq + 1))
+			break;
+		keep = pos = end;
+		seq++;
+		fragments++;
+	}
+
+	if(keep < size){
+		if(f_lseek(fp, keep) != FR_OK || f_truncate(fp) != FR_OK)
+			return -1;
+	}
+	if(f_sync(fp) != FR_OK)
+		return -1;
+	return fragments;
+}
@@ -0,0 +1,112 @@
+#ifndef _FMP4_MUX_H
+#define _FMP4_MUX_H
+
+#include "basic_types.h"
+#include "ff.h"
+
+/*
+ * Fragmented MP4 recorder: H.264 and AAC written to a FatFs file as
+ * ftyp+moov, then a moof+mdat pair per fragment. Nothing about a sample is
+ * kept once its fragment is written, so the length of a recording is not
+ * bounded by RAM, and after a power cut the file plays up to its last
+ * complete fragment once fmp4_mux_recover has trimmed it.
+ *
+ * A fragment is built in the caller's buffer with room for its moof ahead of
+ * the samples; audio is kept in the last part of the buffer and moved behind
+ * the video when the fragment closes. Only whole write blocks go to f_write,
+ * the remainder waits for the next fragment, so the card sees long
+ * sequential writes from an aligned buffer. The file grows by a prealloc
+ * step at a time, with the cluster chain and size synced at once, and is
+ * synced every sync_ms of media time.
+ */
+
+#define FMP4_VIDEO_MAX			128		// samples per fragment
+#define FMP4_AUDIO_MAX			256
+#define FMP4_PS_MAX				128		// bytes of SPS or PPS
+#define FMP4_AUDIO_SHARE		8		// 1/8 of the buffer stages the audio
+// moof with full sample tables, and the mdat header
+#define FMP4_MOOF_MAX			(8 + 16 + 8 + 16 + 20 + 20 + FMP4_VIDEO_MAX * 12 + \
+								8 + 24 + 20 + 20 + FMP4_AUDIO_MAX * 4 + 8)
+
+#define FMP4_VIDEO_TRACK		1
+#define FMP4_AUDIO_TRACK		2
+#define FMP4_VIDEO_CLOCK		90000
+
+typedef struct _fmp4_config{
+	int			width;
+	int			height;
+	int			frame_rate;		// sample duration when timestamps do not tell
+	int			sample_rate;	// AAC, 0 for video only
+	int			channels;
+	u32			fragment_ms;	// cut at the next key frame after this long
+	u32			write_block;	// bytes per f_write, a multiple of 512
+	u32			prealloc;		// bytes the file grows by, 0 to let FatFs grow it
+	u32			sync_ms;		// media time between f_sync, 0 for none
+}fmp4_config_t;
+
+typedef struct _fmp4_stats{
+	u32			fragments;
+	u32			video;			// samples written
+	u32			audio;
+	u32			dropped;		// before the first key frame, or larger than the buffer
+	u32			writes;			// f_write calls
+	u32			syncs;
+	u32			extends;		// preallocation steps
+	u32			bytes;			// file length
+	u32			duration_ms;	// video written
+}fmp4_stats_t;
+
+typedef struct _fmp4_mux{
+	fmp4_config_t	cfg;
+	FIL*		fp;
+	int			err;			// FRESULT of the first failed write, then nothing is written
+	u8*			buf;
+	u32			size;			// video and moof part of buf
+	u8*			abuf;			// audio part, after it
+	u32			asize;
+	u32			block;
+	// the stream not yet written: carry bytes from the last fragment at buf,
+	// then this fragment's moof room and samples
+	u32			carry;
+	u32			data;			// first video byte
+	u32			vlen;
+	u32			alen;
+	u32			file_pos;		// written
+	u32			file_alloc;		// preallocated
+	int			started;		// the header is out, a key frame was seen
+	u32			seq;			// mfhd
+	u64			vtime;			// decode time of the fragment, video clock
+	u64			atime;			// and sample rate
+	u32			frag_dur;		// video clock
+	u32			last_ts;
+	u32			last_sync;		// ms of video at the last f_sync
+	int			vnum;
+	int			anum;
+	u32			vsize[FMP4_VIDEO_MAX];
+	u32			vdur[FMP4_VIDEO_MAX];
+	u8			vkey[FMP4_VIDEO_MAX];
+	u16			asz[FMP4_AUDIO_MAX];
+	u8			sps[FMP4_PS_MAX];
+	u8			pps[FMP4_PS_MAX];
+	u16			sps_len;
+	u16			pps_len;
+	fmp4_stats_t	stats;
+}fmp4_mux_t;
+
+// fp is open for writing at 0. buf is 4-byte aligned and should hold a
+// fragment; return 0 or a FRESULT
+int fmp4_mux_open(fmp4_mux_t* m, FIL* fp, const fmp4_config_t* cfg, u8* buf, u32 size);
+// one Annex B access unit, ts in the 90 kHz clock. Return 0, or a FRESULT
+// once writing failed
+int fmp4_mux_video(fmp4_mux_t* m, const u8* au, u32 len, u32 ts);
+// one AAC frame, with or without its ADTS header
+int fmp4_mux_audio(fmp4_mux_t* m, const u8* frame, u32 len);
+// write the last fragment, trim the preallocation and sync; the caller closes fp
+int fmp4_mux_close(fmp4_mux_t* m);
+void fmp4_mux_get_stats(fmp4_mux_t* m, fmp4_stats_t* stats);
+// cut a file left by a power cut after its last complete fragment. fp is
+// open for reading and writing; return the fragments kept, or -1 if it is
+// not one of ours
+int fmp4_mux_recover(FIL* fp);
+
+#endif
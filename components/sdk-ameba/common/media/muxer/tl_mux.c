@@ -0,0 +1,333 @@
+#include <platform/platform_stdlib.h>
+#include "tl_mux.h"
+
+static inline void put16(u8* p, u32 v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static inline void put32(u8* p, u32 v)
+{
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static inline u32 get16(const u8* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline u32 get32(const u8* p)
+{
+	return get16(p) | (get16(p + 2) << 16);
+}
+
+static u32 tl_cells(const tl_config_t* cfg)
+{
+	u32 cell = 8 << cfg->cell_log2;
+
+	return ((cfg->width + cell - 1) / cell) * ((cfg->height + cell - 1) / cell);
+}
+
+u32 tl_mux_buf_size(const tl_config_t* cfg)
+{
+	u32 block = cfg->write_block ? cfg->write_block / 512 * 512 : 512;
+
+	return block + 2 * ((tl_cells(cfg) * sizeof(s16) + 3) & ~3);
+}
+
+static void tl_write(tl_mux_t* m, const u8* p, u32 n)
+{
+	UINT bw;
+	FRESULT res;
+
+	if(n == 0 || m->err)
+		return;
+	res = f_write(m->fp, p, n, &bw);
+	m->stats.writes++;
+	m->file_pos += bw;
+	if(res == FR_OK && bw != n)
+		res = FR_DENIED;	// disk full
+	if(res != FR_OK)
+		m->err = res;
+}
+
+// through buf, a block at a time
+static void tl_append(tl_mux_t* m, const u8* p, u32 n)
+{
+	u32 k;
+
+	while(n && !m->err){
+		k = m->block - m->fill;
+		if(k > n)
+			k = n;
+		memcpy(m->buf + m->fill, p, k);
+		m->fill += k;
+		p += k;
+		n -= k;
+		if(m->fill == m->block){
+			tl_write(m, m->buf, m->block);
+			m->fill = 0;
+		}
+	}
+}
+
+static void tl_index_write(tl_mux_t* m, const tl_index_t* rec)
+{
+	u8 b[TL_INDEX_RECORD];
+	UINT bw;
+	FRESULT res;
+
+	if(m->err)
+		return;
+	put32(b, rec->offset);
+	put32(b + 4, rec->size);
+	put32(b + 8, rec->time_ms);
+	put32(b + 12, rec->frame);
+	// FatFs keeps the partial sector, the card sees a write per 32 records
+	res = f_write(m->ip, b, TL_INDEX_RECORD, &bw);
+	if(res == FR_OK && bw != TL_INDEX_RECORD)
+		res = FR_DENIED;
+	if(res != FR_OK)
+		m->err = res;
+}
+
+// records whose frames are all written, or all of them
+static void tl_index_flush(tl_mux_t* m, int all)
+{
+	int i;
+
+	for(i = 0; i < m->pending; i++){
+		if(!all && m->rec[i].offset + m->rec[i].size > m->file_pos)
+			break;
+		tl_index_write(m, &m->rec[i]);
+	}
+	m->pending -= i;
+	memmove(m->rec, m->rec + i, m->pending * sizeof(tl_index_t));
+}
+
+static void tl_sync(tl_mux_t* m)
+{
+	FRESULT res;
+
+	if(m->err)
+		return;
+	// the frames before the records that point to them
+	res = f_sync(m->fp);
+	if(res == FR_OK)
+		res = f_sync(m->ip);
+	m->stats.syncs++;
+	if(res != FR_OK)
+		m->err = res;
+}
+
+int tl_mux_open(tl_mux_t* m, FIL* fp, FIL* ip, const tl_config_t* cfg, u8* buf, u32 size)
+{
+	u8 b[TL_INDEX_HEADER];
+	UINT bw;
+	FRESULT res;
+
+	memset(m, 0, sizeof(tl_mux_t));
+	m->cfg = *cfg;
+	m->fp = fp;
+	m->ip = ip;
+	m->block = cfg->write_block ? cfg->write_block / 512 * 512 : 512;
+	if(cfg->width <= 0 || cfg->height <= 0 || cfg->cell_log2 < 0 || cfg->cell_log2 > MJPEG_DC_CELL_LOG2_MAX)
+		return FR_INVALID_PARAMETER;
+	if(((uintptr_t)buf & 3) || size < tl_mux_buf_size(cfg))
+		return FR_INVALID_PARAMETER;
+	if(m->cfg.level < 1)
+		m->cfg.level = 1;
+	m->buf = buf;
+	m->cells = tl_cells(cfg);
+	m->ref = (s16*)(buf + m->block);
+	m->cur = (s16*)(buf + m->block + ((m->cells * sizeof(s16) + 3) & ~3));
+	m->map.cell_log2 = cfg->cell_log2;
+	m->map.max = m->cells;
+
+	memcpy(b, "TLIX", 4);
+	put16(b + 4, TL_INDEX_VERSION);
+	put16(b + 6, TL_INDEX_RECORD);
+	put16(b + 8, cfg->width);
+	put16(b + 10, cfg->height);
+	put32(b + 12, 0);
+	res = f_write(ip, b, TL_INDEX_HEADER, &bw);
+	if(res == FR_OK && bw != TL_INDEX_HEADER)
+		res = FR_DENIED;
+	return res;
+}
+
+// permille of the cells that moved by more than level since the last
+// stored frame
+static int tl_changed(tl_mux_t* m)
+{
+	int i, n = m->map.cols * m->map.rows, d, limit, changed = 0;
+
+	limit = (m->cfg.level * 8) << (2 * m->cfg.cell_log2);
+	for(i = 0; i < n; i++){
+		d = m->cur[i] - m->ref[i];
+		if(d > limit || d < -limit)
+			changed++;
+	}
+	return changed * 1000 / n;
+}
+
+int tl_mux_frame(tl_mux_t* m, const u8* jpg, u32 len, u32 time_ms)
+{
+	tl_index_t* rec;
+	s16* t;
+
+	m->stats.frames++;
+	m->stats.in_bytes += len;
+	m->stored = 0;
+	if(m->err)
+		return m->err;
+
+	m->map.cell = m->cur;
+	if(mjpeg_dc_map(&m->dc, jpg, len, &m->map) < 0 || m->map.width != m->cfg.width || m->map.height != m->cfg.height){
+		// kept, as it cannot be judged; the next frame that can be is kept too
+		m->stats.unparsed++;
+		m->have_ref = 0;
+		m->changed = 1000;
+	}else{
+		m->changed = m->have_ref ? tl_changed(m) : 1000;
+		if(m->have_ref && m->changed < m->cfg.permille &&
+				(m->cfg.max_gap_ms == 0 || time_ms - m->last_time < m->cfg.max_gap_ms)){
+			m->stats.skipped++;
+			return 0;
+		}
+		t = m->ref;
+		m->ref = m->cur;
+		m->cur = t;
+		m->have_ref = 1;
+	}
+
+	if(m->pending == TL_PENDING_MAX){
+		// many small frames in one block: the oldest record goes ahead of its
+		// frame, tl_mux_recover drops it if the frame never made it
+		tl_index_write(m, &m->rec[0]);
+		m->pending--;
+		memmove(m->rec, m->rec + 1, m->pending * sizeof(tl_index_t));
+	}
+	rec = &m->rec[m->pending++];
+	rec->offset = m->file_pos + m->fill;
+	rec->size = len;
+	rec->time_ms = time_ms;
+	rec->frame = m->stats.frames - 1;
+	tl_append(m, jpg, len);
+	tl_index_flush(m, 0);
+
+	m->stored = 1;
+	m->stats.stored++;
+	m->last_time = time_ms;
+	if(m->cfg.sync_ms && time_ms - m->last_sync >= m->cfg.sync_ms){
+		tl_sync(m);
+		m->last_sync = time_ms;
+	}
+	return m->err;
+}
+
+int tl_mux_close(tl_mux_t* m)
+{
+	tl_write(m, m->buf, m->fill);
+	m->fill = 0;
+	tl_index_flush(m, 1);
+	tl_sync(m);
+	return m->err;
+}
+
+void tl_mux_get_stats(tl_mux_t* m, tl_stats_t* stats)
+{
+	*stats = m->stats;
+	stats->bytes = m->file_pos + m->fill;
+}
+
+static int tl_read(FIL* fp, u32 pos, u8* b, u32 n)
+{
+	UINT br;
+
+	if(f_lseek(fp, pos) != FR_OK || f_read(fp, b, n, &br) != FR_OK || br != n)
+		return -1;
+	return 0;
+}
+
+static int tl_read_index(FIL* ip, u32 n, tl_index_t* rec)
+{
+	u8 b[TL_INDEX_RECORD];
+
+	if(tl_read(ip, TL_INDEX_HEADER + n * TL_INDEX_RECORD, b, TL_INDEX_RECORD) < 0)
+		return -1;
+	rec->offset = get32(b);
+	rec->size = get32(b + 4);
+	rec->time_ms = get32(b + 8);
+	rec->frame = get32(b + 12);
+	return 0;
+}
+
+// records in ip, or -1 if it is not an index
+static int tl_index_count(FIL* ip)
+{
+	u8 b[TL_INDEX_HEADER];
+
+	if(tl_read(ip, 0, b, TL_INDEX_HEADER) < 0 || memcmp(b, "TLIX", 4) || get16(b + 6) != TL_INDEX_RECORD)
+		return -1;
+	return (f_size(ip) - TL_INDEX_HEADER) / TL_INDEX_RECORD;
+}
+
+int tl_index_seek(FIL* ip, u32 time_ms, tl_index_t* rec)
+{
+	int n = tl_index_count(ip), lo = 0, hi, mid;
+
+	if(n <= 0)
+		return -1;
+	// the last record at or before time_ms
+	hi = n - 1;
+	while(lo < hi){
+		mid = (lo + hi + 1) / 2;
+		if(tl_read_index(ip, mid, rec) < 0)
+			return -1;
+		if(rec->time_ms <= time_ms)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	if(tl_read_index(ip, lo, rec) < 0)
+		return -1;
+	return lo;
+}
+
+int tl_mux_recover(FIL* fp, FIL* ip)
+{
+	tl_index_t rec;
+	u8 b[2];
+	u32 size = f_size(fp), end = 0;
+	int n = tl_index_count(ip);
+
+	if(n < 0)
+		return -1;
+	// from the end, the first record whose frame is in the file and starts
+	// like one
+	while(n > 0){
+		if(tl_read_index(ip, n - 1, &rec) < 0)
+			return -1;
+		if(rec.size >= 2 && rec.offset + rec.size >= rec.offset && rec.offset + rec.size <= size &&
+				tl_read(fp, rec.offset, b, 2) == 0 && b[0] == 0xff && b[1] == 0xd8){
+			end = rec.offset + rec.size;
+			break;
+		}
+		n--;
+	}
+
+	if(f_size(ip) > TL_INDEX_HEADER + n * TL_INDEX_RECORD){
+		if(f_lseek(ip, TL_INDEX_HEADER + n * TL_INDEX_RECORD) != FR_OK || f_truncate(ip) != FR_OK)
+			return -1;
+	}
+	if(size > end){
+		if(f_lseek(fp, end) != FR_OK || f_truncate(fp) != FR_OK)
+			return -1;
+	}
+	if(f_sync(fp) != FR_OK || f_sync(ip) != FR_OK)
+		return -1;
+	return n;
+}
@@ -0,0 +1,104 @@
+#ifndef _TL_MUX_H
+#define _TL_MUX_H
+
+#include "basic_types.h"
+#include "ff.h"
+#include "mjpeg/mjpeg_dc.h"
+
+/*
+ * Time-lapse recorder: JPEG frames appended to one FatFs file, with an index
+ * file of a record per stored frame. A frame is only stored when the scene
+ * changed since the last stored one, judged on the luma DC map of the frame
+ * (mjpeg_dc) with no decoding: a cell counts as changed when its mean luma
+ * moved by more than level, and the frame is stored when permille of the
+ * cells changed, or max_gap_ms after the last one stored.
+ *
+ * The data file is a plain MJPEG stream that players and ffmpeg read as it
+ * is. Frames go through the caller's buffer and only whole write blocks go
+ * to f_write; an index record is written once all of its frame is in the
+ * file, and both files are synced every sync_ms. After a power cut
+ * tl_mux_recover cuts the index to frames that are in the data file.
+ *
+ * The index starts with a header, then records in time order, little endian:
+ *   header  "TLIX", u16 version, u16 record size, u16 width, u16 height, u32 0
+ *   record  u32 offset, size, time_ms, and frame number among all offered
+ */
+
+#define TL_INDEX_VERSION		1
+#define TL_INDEX_HEADER			16
+#define TL_INDEX_RECORD			16
+#define TL_PENDING_MAX			64		// records waiting for their frame's block
+
+typedef struct _tl_config{
+	int			width;			// the maps are sized for this
+	int			height;
+	int			cell_log2;		// cells of 8 << cell_log2 pixels
+	int			level;			// mean luma change of a changed cell, 1 to 255
+	int			permille;		// changed cells that store a frame, 0 to store all
+	u32			max_gap_ms;		// store one at least this often, 0 for no limit
+	u32			write_block;	// bytes per f_write, a multiple of 512
+	u32			sync_ms;		// time between f_sync, 0 for none
+}tl_config_t;
+
+typedef struct _tl_stats{
+	u32			frames;			// offered
+	u32			stored;
+	u32			skipped;
+	u32			unparsed;		// stored without a map
+	u32			in_bytes;		// of all frames offered
+	u32			bytes;			// data file length
+	u32			writes;			// f_write calls on the data file
+	u32			syncs;
+}tl_stats_t;
+
+typedef struct _tl_index{
+	u32			offset;
+	u32			size;
+	u32			time_ms;
+	u32			frame;
+}tl_index_t;
+
+typedef struct _tl_mux{
+	tl_config_t	cfg;
+	FIL*		fp;				// frames
+	FIL*		ip;				// index
+	int			err;			// FRESULT of the first failed write, then nothing is written
+	u8*			buf;
+	u32			block;
+	u32			fill;			// bytes in buf
+	u32			file_pos;		// written to fp
+	s16*		ref;			// map of the last stored frame
+	s16*		cur;
+	u32			cells;			// room in each map
+	int			have_ref;
+	int			changed;		// permille of cells changed in the last frame offered
+	int			stored;			// the last frame offered was stored
+	u32			last_time;		// of the last stored frame
+	u32			last_sync;
+	int			pending;
+	tl_index_t	rec[TL_PENDING_MAX];
+	mjpeg_dc_t	dc;
+	mjpeg_dc_map_t	map;
+	tl_stats_t	stats;
+}tl_mux_t;
+
+// bytes of buf tl_mux_open needs for cfg
+u32 tl_mux_buf_size(const tl_config_t* cfg);
+// fp and ip are open for writing at 0. buf is 4-byte aligned and holds
+// tl_mux_buf_size; return 0 or a FRESULT
+int tl_mux_open(tl_mux_t* m, FIL* fp, FIL* ip, const tl_config_t* cfg, u8* buf, u32 size);
+// one JPEG frame captured at time_ms; m->stored tells whether it was kept.
+// Return 0, or a FRESULT once writing failed
+int tl_mux_frame(tl_mux_t* m, const u8* jpg, u32 len, u32 time_ms);
+// write what is buffered and sync both files; the caller closes them
+int tl_mux_close(tl_mux_t* m);
+void tl_mux_get_stats(tl_mux_t* m, tl_stats_t* stats);
+// the last record at or before time_ms, or the first one; ip is open for
+// reading. Return its number or -1
+int tl_index_seek(FIL* ip, u32 time_ms, tl_index_t* rec);
+// cut files left by a power cut: records whose frame is not all in fp, and
+// data after the last record. Both are open for reading and writing; return
+// the records kept, or -1 if ip is not an index
+int tl_mux_recover(FIL* fp, FIL* ip);
+
+#endif
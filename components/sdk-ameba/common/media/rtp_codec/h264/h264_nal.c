@@ -0,0 +1,127 @@
+#include <platform/platform_stdlib.h>
+#include "h264_nal.h"
+#include "h264.h"
+
+// nonzero if one of the 4 bytes of w is 0
+#define HAS_ZERO_BYTE(w)	(((w) - 0x01010101UL) & ~(w) & 0x80808080UL)
+
+static const u8* start_code_at(const u8* p, const u8* base, int* start_code_len)
+{
+	if(p > base && p[-1] == 0){
+		*start_code_len = 4;
+		return p - 1;
+	}
+	*start_code_len = 3;
+	return p;
+}
+
+const u8* h264_find_start_code(const u8* ptr, const u8* end, int* start_code_len)
+{
+	const u8* p = ptr;
+	const u8* q;
+	u32 w;
+
+	if(end - ptr < 3)
+		return NULL;
+
+	// bytewise up to a word boundary
+	for(; ((uintptr_t)p & 3) && p + 3 <= end; p++){
+		if(p[0] == 0 && p[1] == 0 && p[2] == 1)
+			return start_code_at(p, ptr, start_code_len);
+	}
+
+	// a start code beginning at p..p+3 has a zero byte in the word at p; one
+	// beginning at p-1 was already found when the word before was looked at
+	for(; p + 4 <= end; p += 4){
+		w = *(const u32*)p;
+		if(!HAS_ZERO_BYTE(w))
+			continue;
+		for(q = p; q < p + 4 && q + 3 <= end; q++){
+			if(q[0] == 0 && q[1] == 0 && q[2] == 1)
+				return start_code_at(q, ptr, start_code_len);
+		}
+	}
+
+	for(; p + 3 <= end; p++){
+		if(p[0] == 0 && p[1] == 0 && p[2] == 1)
+			return start_code_at(p, ptr, start_code_len);
+	}
+	return NULL;
+}
+
+// NAL that begins a new access unit once a slice has been seen (7.4.1.2.3)
+static int starts_au(const u8* nal, const u8* end)
+{
+	u8 type = nal[0] & 0x1f;
+
+	if(type == H264_NAL_SLICE || type == H264_NAL_IDR)
+		return nal + 1 < end && (nal[1] & 0x80);	// first_mb_in_slice is 0
+	return type == H264_NAL_SEI || type == H264_NAL_SPS || type == H264_NAL_PPS ||
+		type == H264_NAL_AUD || (type >= 14 && type <= 18);
+}
+
+u32 h264_au_index(const u8* buf, const u8* end, h264_au_t* au)
+{
+	const u8 *p, *nal, *next;
+	int sc, next_sc, vcl = 0;
+	h264_nal_t* n;
+
+	au->num_nal = 0;
+	au->key = 0;
+	au->ref = 0;
+	au->len = 0;
+
+	p = h264_find_start_code(buf, end, &sc);
+	if(p == NULL)
+		return 0;
+	au->data = p;
+
+	while(p){
+		nal = p + sc;
+		if(nal >= end)
+			break;
+		if(vcl && starts_au(nal, end))
+			break;
+		if(au->num_nal == H264_NAL_MAX)
+			break;
+
+		next = h264_find_start_code(nal + 1, end, &next_sc);
+
+		n = &au->nal[au->num_nal++];
+		n->offset = nal - au->data;
+		n->len = (next ? next : end) - nal;
+		n->start_code_len = sc;
+		n->type = nal[0] & 0x1f;
+		if(n->type == H264_NAL_SLICE || n->type == H264_NAL_IDR){
+			vcl = 1;
+			if(nal[0] & 0x60)	// nal_ref_idc
+				au->ref = 1;
+		}
+		if(n->type == H264_NAL_IDR)
+			au->key = 1;
+
+		p = next;
+		sc = next_sc;
+	}
+
+	au->len = (p ? p : end) - au->data;
+	return au->data + au->len - buf;
+}
+
+void h264_au_to_rtp(const h264_au_t* au, struct rtp_h264_obj* obj)
+{
+	const h264_nal_t* n;
+	struct rtp_nal_obj* o;
+	int i;
+
+	memset(obj, 0, sizeof(struct rtp_h264_obj));
+	for(i = 0; i < au->num_nal && i < MAX_NUM_NAL_PER_FRM; i++){
+		n = &au->nal[i];
+		o = &obj->nal_obj[i];
+		o->start_code_len = n->start_code_len;
+		o->nal_header = au->data[n->offset];
+		o->must_not_drop = (n->type == H264_NAL_SPS || n->type == H264_NAL_PPS || n->type == H264_NAL_IDR);
+		o->offset = n->offset - n->start_code_len;
+	}
+	obj->num_nal = i;
+}
@@ -0,0 +1,48 @@
+#ifndef _H264_NAL_H
+#define _H264_NAL_H
+
+#include "basic_types.h"
+
+/*
+ * Annex B start code scanner and access unit indexer. The NAL table of an
+ * access unit is built once by the source and travels with the frame in
+ * exch_buf_t.priv, with priv_type PRIV_H264_AU, so the RTP packetizer and the
+ * MP4 muxer do not scan the frame again.
+ */
+
+#define H264_NAL_MAX			16		// NALs indexed per access unit
+
+#define H264_NAL_SLICE			1
+#define H264_NAL_IDR			5
+#define H264_NAL_SEI			6
+#define H264_NAL_SPS			7
+#define H264_NAL_PPS			8
+#define H264_NAL_AUD			9
+
+typedef struct _h264_nal{
+	u32			offset;			// NAL header, from the start of the access unit
+	u32			len;			// without the start code
+	u8			start_code_len;	// 3 or 4
+	u8			type;
+}h264_nal_t;
+
+typedef struct _h264_au{
+	const u8*	data;			// first start code
+	u32			len;			// whole access unit with start codes
+	int			num_nal;
+	int			key;			// has an IDR slice
+	int			ref;			// other frames refer to it, when 0 it can be dropped
+	h264_nal_t	nal[H264_NAL_MAX];
+}h264_au_t;
+
+struct rtp_h264_obj;
+
+// first 00 00 01 or 00 00 00 01 in [ptr, end), NULL if there is none
+const u8* h264_find_start_code(const u8* ptr, const u8* end, int* start_code_len);
+// index the access unit starting at or after buf; return the bytes from buf
+// to its end, which is where the next one starts, or 0 if there is none
+u32 h264_au_index(const u8* buf, const u8* end, h264_au_t* au);
+// fill the packetizer's NAL table, at most MAX_NUM_NAL_PER_FRM entries
+void h264_au_to_rtp(const h264_au_t* au, struct rtp_h264_obj* obj);
+
+#endif
@@ -0,0 +1,428 @@
+#include <platform/platform_stdlib.h>
+#include "mjpeg_dc.h"
+
+#define M_SOF0					0xc0
+#define M_SOF1					0xc1
+#define M_DHT					0xc4
+#define M_RST0					0xd0
+#define M_SOI					0xd8
+#define M_EOI					0xd9
+#define M_SOS					0xda
+#define M_DQT					0xdb
+#define M_DRI					0xdd
+
+#define DC_MAX					1023	// of a dequantized 8 bit DC
+
+const u8 mjpeg_std_dht[416] = {
+	0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x10, 0x00, 0x02,
+	0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7d, 0x01, 0x02,
+	0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+	0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33,
+	0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53,
+	0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73,
+	0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92,
+	0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9,
+	0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+	0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4,
+	0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+	0x01, 0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x11, 0x00, 0x02,
+	0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00, 0x01,
+	0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+	0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62,
+	0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a,
+	0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+	0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+	0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3,
+	0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+typedef struct _bits{
+	const u8*	p;
+	const u8*	end;
+	u32			acc;			// next bits from the MSB
+	int			n;
+	int			pad;			// zero bits made up at a marker or the end
+}bits_t;
+
+typedef struct _comp{
+	u8			id;
+	u8			h;
+	u8			v;
+	u8			tq;
+	u8			td;
+	u8			ta;
+	s16			pred;
+}comp_t;
+
+// to at least 25 bits; a marker or the end of data reads as zeros
+static void bits_fill(bits_t* b)
+{
+	u32 c;
+
+	while(b->n <= 24){
+		c = 0;
+		if(b->p < b->end && (*b->p != 0xff || (b->p + 1 < b->end && b->p[1] == 0))){
+			c = *b->p;
+			b->p += c == 0xff ? 2 : 1;
+		}else
+			b->pad += 8;
+		b->acc |= c << (24 - b->n);
+		b->n += 8;
+	}
+}
+
+static inline void bits_skip(bits_t* b, int s)
+{
+	if(b->n < s)
+		bits_fill(b);
+	b->acc <<= s;
+	b->n -= s;
+}
+
+static inline int bits_get(bits_t* b, int s)
+{
+	u32 v;
+
+	if(b->n < s)
+		bits_fill(b);
+	v = b->acc >> (32 - s);
+	b->acc <<= s;
+	b->n -= s;
+	return v;
+}
+
+static inline int huff_sym(bits_t* b, const mjpeg_huff_t* h)
+{
+	u32 look, code;
+	int l;
+
+	if(b->n < 16)
+		bits_fill(b);
+	look = b->acc >> 23;
+	l = h->look_len[look];
+	if(l == 0){
+		code = b->acc >> 16;
+		for(l = 10; l <= 16; l++){
+			look = code >> (16 - l);
+			if((s32)look <= h->maxcode[l]){
+				b->acc <<= l;
+				b->n -= l;
+				return h->vals[h->valoff[l] + look];
+			}
+		}
+		return -1;
+	}
+	b->acc <<= l;
+	b->n -= l;
+	return h->look_sym[look];
+}
+
+// canonical codes from the counts by length; return the values used or -1
+static int huff_build(mjpeg_huff_t* h, const u8* bits, const u8* vals)
+{
+	int l, i, j, n, k = 0, code = 0;
+
+	memset(h->look_len, 0, sizeof(h->look_len));
+	memset(h->look_skip, 0, sizeof(h->look_skip));
+	for(l = 1; l <= 16; l++){
+		n = bits[l - 1];
+		if(k + n > 256 || code + n > (1 << l))
+			return -1;
+		h->valoff[l] = k - code;
+		for(i = 0; i < n; i++, code++, k++){
+			if(l > 9)
+				continue;
+			for(j = code << (9 - l); j < (code + 1) << (9 - l); j++){
+				h->look_len[j] = l;
+				h->look_sym[j] = vals[k];
+				if(l + (vals[k] & 15) <= 9)
+					h->look_skip[j] = l + (vals[k] & 15);
+			}
+		}
+		h->maxcode[l] = n ? code - 1 : -1;
+		code <<= 1;
+	}
+	h->maxcode[17] = 0x7fffffff;
+	memcpy(h->vals, vals, k);
+	return k;
+}
+
+static int parse_dht(mjpeg_dc_t* d, const u8* p, int len, u8* defined)
+{
+	int tc, th, n, i;
+
+	while(len > 0){
+		if(len < 17)
+			return MJPEG_DC_ERR_FORMAT;
+		tc = p[0] >> 4;
+		th = p[0] & 15;
+		if(tc > 1 || th > 1)
+			return MJPEG_DC_ERR_UNSUPPORTED;
+		for(n = 0, i = 1; i <= 16; i++)
+			n += p[i];
+		if(len < 17 + n || huff_build(tc ? &d->ac[th] : &d->dc[th], p + 1, p + 17) < 0)
+			return MJPEG_DC_ERR_FORMAT;
+		*defined |= 1 << (tc * 2 + th);
+		d->std &= ~(1 << (tc * 2 + th));
+		p += 17 + n;
+		len -= 17 + n;
+	}
+	return 0;
+}
+
+static int parse_dqt(mjpeg_dc_t* d, const u8* p, int len)
+{
+	int pq, tq;
+
+	while(len > 0){
+		pq = p[0] >> 4;
+		tq = p[0] & 15;
+		if(tq > 3 || len < (pq ? 129 : 65))
+			return MJPEG_DC_ERR_FORMAT;
+		d->qt[tq] = pq ? (p[1] << 8) | p[2] : p[1];	// zigzag order, DC first
+		p += pq ? 129 : 65;
+		len -= pq ? 129 : 65;
+	}
+	return 0;
+}
+
+// tables the scan needs and the frame did not define, from Annex K
+static void std_tables(mjpeg_dc_t* d, int need)
+{
+	const u8* p = mjpeg_std_dht;
+	int i, j, n, bit;
+
+	for(i = 0; i < 4; i++){
+		bit = 1 << ((p[0] >> 4) * 2 + (p[0] & 15));
+		for(n = 0, j = 1; j <= 16; j++)
+			n += p[j];
+		if(need & ~d->std & bit){
+			huff_build((p[0] >> 4) ? &d->ac[p[0] & 15] : &d->dc[p[0] & 15], p + 1, p + 17);
+			d->std |= bit;
+		}
+		p += 17 + n;
+	}
+}
+
+// one block: the DC difference, then AC codes skipped to the end of block
+static inline int decode_block(bits_t* b, const mjpeg_huff_t* dc, const mjpeg_huff_t* ac, int* diff)
+{
+	int s, r, k;
+
+	s = huff_sym(b, dc);
+	if(s < 0 || s > 11)
+		return -1;
+	*diff = 0;
+	if(s){
+		r = bits_get(b, s);
+		*diff = r < (1 << (s - 1)) ? r - (1 << s) + 1 : r;
+	}
+	for(k = 1; k < 64; k++){
+		// most codes and their value fit the lookahead together
+		if(b->n < 16)
+			bits_fill(b);
+		r = b->acc >> 23;
+		if((s = ac->look_skip[r]) != 0){
+			b->acc <<= s;
+			b->n -= s;
+			s = ac->look_sym[r];
+		}else{
+			if((s = huff_sym(b, ac)) < 0)
+				return -1;
+			if(s & 15)
+				bits_skip(b, s & 15);
+		}
+		r = s >> 4;
+		if((s & 15) == 0 && r != 15)
+			break;
+		k += r;
+	}
+	return k > 64 ? -1 : 0;
+}
+
+// the luma blocks of a scan into the cells of map, bcols by brows of them
+// inside the frame
+static int decode_scan(mjpeg_dc_t* d, bits_t* b, comp_t** sc, int ns, const comp_t* luma, int restart,
+		int mcux, int mcuy, mjpeg_dc_map_t* map, int bcols, int brows)
+{
+	comp_t* c;
+	int mx, my, i, h, v, bx, by, diff, val, todo = restart, cl = map->cell_log2, q = d->qt[luma->tq];
+
+	for(my = 0; my < mcuy; my++){
+		for(mx = 0; mx < mcux; mx++){
+			if(restart && todo-- == 0){
+				// the bits left before RSTn are padding
+				if(b->pad > b->n)
+					return MJPEG_DC_ERR_DATA;
+				while(b->p + 1 < b->end && !(b->p[0] == 0xff && (b->p[1] & 0xf8) == M_RST0))
+					b->p++;
+				if(b->p + 1 >= b->end)
+					return MJPEG_DC_ERR_DATA;
+				b->p += 2;
+				b->acc = 0;
+				b->n = 0;
+				b->pad = 0;
+				for(i = 0; i < ns; i++)
+					sc[i]->pred = 0;
+				todo = restart - 1;
+			}
+			for(i = 0; i < ns; i++){
+				c = sc[i];
+				for(v = 0; v < (ns > 1 ? c->v : 1); v++){
+					for(h = 0; h < (ns > 1 ? c->h : 1); h++){
+						if(decode_block(b, &d->dc[c->td], &d->ac[c->ta], &diff) < 0)
+							return MJPEG_DC_ERR_DATA;
+						c->pred += diff;
+						if(c != luma)
+							continue;
+						bx = ns > 1 ? mx * c->h + h : mx;
+						by = ns > 1 ? my * c->v + v : my;
+						if(bx >= bcols || by >= brows)
+							continue;
+						val = c->pred * q;
+						val = val > DC_MAX ? DC_MAX : val < -DC_MAX - 1 ? -DC_MAX - 1 : val;
+						map->cell[(by >> cl) * map->cols + (bx >> cl)] += val;
+					}
+				}
+			}
+		}
+	}
+	return b->pad > b->n ? MJPEG_DC_ERR_DATA : 0;
+}
+
+int mjpeg_dc_map(mjpeg_dc_t* d, const u8* jpg, u32 len, mjpeg_dc_map_t* map)
+{
+	const u8 *p = jpg, *end = jpg + len, *seg;
+	comp_t comp[3], *sc[3];
+	bits_t b;
+	int marker, seglen, nf = 0, ns, i, j, hmax = 1, vmax = 1, restart = 0, width = 0, height = 0, ret;
+	int mcux, mcuy, bcols, brows, cells, cl = map->cell_log2;
+	u8 defined = 0, need;
+
+	if(len < 4 || p[0] != 0xff || p[1] != M_SOI)
+		return MJPEG_DC_ERR_FORMAT;
+	if(cl < 0 || cl > MJPEG_DC_CELL_LOG2_MAX)
+		return MJPEG_DC_ERR_UNSUPPORTED;
+	p += 2;
+	for(;;){
+		// entropy coded data of scans without luma is passed over here
+		while(p < end && *p != 0xff)
+			p++;
+		while(p < end && *p == 0xff)
+			p++;
+		if(p >= end)
+			return MJPEG_DC_ERR_FORMAT;
+		marker = *p++;
+		if(marker == 0 || marker == 0x01 || (marker & 0xf8) == M_RST0 || marker == M_SOI)
+			continue;
+		if(marker == M_EOI || end - p < 2)
+			return MJPEG_DC_ERR_FORMAT;
+		seglen = (p[0] << 8) | p[1];
+		if(seglen < 2 || seglen > end - p)
+			return MJPEG_DC_ERR_FORMAT;
+		seg = p + 2;
+		seglen -= 2;
+		p += seglen + 2;
+
+		switch(marker){
+		case M_SOF0:
+		case M_SOF1:
+			if(seglen < 6)
+				return MJPEG_DC_ERR_FORMAT;
+			if(seg[0] != 8)
+				return MJPEG_DC_ERR_UNSUPPORTED;
+			height = (seg[1] << 8) | seg[2];
+			width = (seg[3] << 8) | seg[4];
+			nf = seg[5];
+			if(nf < 1 || nf > 3)
+				return MJPEG_DC_ERR_UNSUPPORTED;
+			if(seglen < 6 + 3 * nf || width == 0 || height == 0)
+				return MJPEG_DC_ERR_FORMAT;
+			for(i = 0; i < nf; i++){
+				comp[i].id = seg[6 + 3 * i];
+				comp[i].h = seg[7 + 3 * i] >> 4;
+				comp[i].v = seg[7 + 3 * i] & 15;
+				comp[i].tq = seg[8 + 3 * i] & 3;
+				if(comp[i].h < 1 || comp[i].h > 4 || comp[i].v < 1 || comp[i].v > 4)
+					return MJPEG_DC_ERR_FORMAT;
+				hmax = comp[i].h > hmax ? comp[i].h : hmax;
+				vmax = comp[i].v > vmax ? comp[i].v : vmax;
+			}
+			break;
+		case M_DHT:
+			if((ret = parse_dht(d, seg, seglen, &defined)) < 0)
+				return ret;
+			break;
+		case M_DQT:
+			if((ret = parse_dqt(d, seg, seglen)) < 0)
+				return ret;
+			break;
+		case M_DRI:
+			if(seglen < 2)
+				return MJPEG_DC_ERR_FORMAT;
+			restart = (seg[0] << 8) | seg[1];
+			break;
+		case M_SOS:
+			if(nf == 0 || seglen < 1)
+				return MJPEG_DC_ERR_FORMAT;
+			ns = seg[0];
+			if(ns < 1 || ns > nf || seglen < 1 + 2 * ns + 3)
+				return MJPEG_DC_ERR_FORMAT;
+			need = 0;
+			for(i = 0; i < ns; i++){
+				for(j = 0; j < nf && comp[j].id != seg[1 + 2 * i]; j++)
+					;
+				if(j == nf)
+					return MJPEG_DC_ERR_FORMAT;
+				sc[i] = &comp[j];
+				sc[i]->td = seg[2 + 2 * i] >> 4;
+				sc[i]->ta = seg[2 + 2 * i] & 15;
+				sc[i]->pred = 0;
+				if(sc[i]->td > 1 || sc[i]->ta > 1)
+					return MJPEG_DC_ERR_UNSUPPORTED;
+				need |= (1 << sc[i]->td) | (4 << sc[i]->ta);
+			}
+			for(i = 0; i < ns && sc[i] != &comp[0]; i++)
+				;
+			if(i == ns)
+				break;		// chroma of a non-interleaved frame, luma comes later
+
+			// luma blocks in the frame, and MCUs in the scan
+			bcols = ((width * comp[0].h + hmax - 1) / hmax + 7) / 8;
+			brows = ((height * comp[0].v + vmax - 1) / vmax + 7) / 8;
+			if(ns == 1){
+				mcux = bcols;
+				mcuy = brows;
+			}else{
+				mcux = (width + 8 * hmax - 1) / (8 * hmax);
+				mcuy = (height + 8 * vmax - 1) / (8 * vmax);
+			}
+			map->width = width;
+			map->height = height;
+			map->cols = (bcols + (1 << cl) - 1) >> cl;
+			map->rows = (brows + (1 << cl) - 1) >> cl;
+			cells = map->cols * map->rows;
+			if(cells > map->max)
+				return MJPEG_DC_ERR_SIZE;
+			memset(map->cell, 0, cells * sizeof(s16));
+
+			std_tables(d, need & ~defined);
+			b.p = p;
+			b.end = end;
+			b.acc = 0;
+			b.n = 0;
+			b.pad = 0;
+			return decode_scan(d, &b, sc, ns, &comp[0], restart, mcux, mcuy, map, bcols, brows);
+		default:
+			if((marker & 0xf0) == 0xc0 && marker != 0xc8 && marker != 0xcc)
+				return MJPEG_DC_ERR_UNSUPPORTED;	// progressive, lossless, arithmetic
+			break;
+		}
+	}
+}
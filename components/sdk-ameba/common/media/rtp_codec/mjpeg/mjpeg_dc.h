@@ -0,0 +1,58 @@
+#ifndef _MJPEG_DC_H
+#define _MJPEG_DC_H
+
+#include "basic_types.h"
+
+/*
+ * Luma DC map of a baseline JPEG or MJPEG frame: the entropy coded data is
+ * Huffman decoded to find each block's DC coefficient, the AC coefficients
+ * are only skipped, and nothing is transformed. A block's dequantized DC is
+ * 8 * (mean - 128) of its pixels, so the map is the frame at 1/8 scale for
+ * what it costs to walk the bitstream once.
+ *
+ * Blocks are summed into square cells of 8 << cell_log2 pixels; cells on the
+ * right and bottom edge hold the blocks the frame has there. Frames without
+ * a DHT segment, as UVC cameras send them, use the tables of JPEG Annex K.
+ */
+
+#define MJPEG_DC_ERR_FORMAT			-1		// not a JPEG, or no scan
+#define MJPEG_DC_ERR_UNSUPPORTED	-2		// progressive, arithmetic, 12 bit
+#define MJPEG_DC_ERR_SIZE			-3		// more cells than the map holds
+#define MJPEG_DC_ERR_DATA			-4		// entropy coded data does not decode
+
+#define MJPEG_DC_CELL_LOG2_MAX		2
+
+typedef struct _mjpeg_huff{
+	u8			look_len[512];	// 9 bit lookahead: code length, 0 if longer
+	u8			look_sym[512];
+	u8			look_skip[512];	// code and its extra bits, 0 if longer
+	s32			maxcode[18];	// by length, -1 for none
+	s32			valoff[17];
+	u8			vals[256];
+}mjpeg_huff_t;
+
+typedef struct _mjpeg_dc{
+	mjpeg_huff_t	dc[2];
+	mjpeg_huff_t	ac[2];
+	u16			qt[4];			// DC entry of each quantization table
+	u8			std;			// tables holding Annex K ones, bit 2 * class + id
+}mjpeg_dc_t;
+
+typedef struct _mjpeg_dc_map{
+	int			cell_log2;		// in: 0 to MJPEG_DC_CELL_LOG2_MAX
+	s16*		cell;			// in: room for max cells, out: sums of block DC
+	u32			max;
+	u16			width;			// out: frame
+	u16			height;
+	u16			cols;			// cells
+	u16			rows;
+}mjpeg_dc_map_t;
+
+// DHT payload of the Annex K tables: DC luma, AC luma, DC chroma, AC chroma
+extern const u8 mjpeg_std_dht[416];
+
+// clear d before the first frame, it keeps tables between frames. Fill map
+// from the frame at jpg; return 0 or MJPEG_DC_ERR_*
+int mjpeg_dc_map(mjpeg_dc_t* d, const u8* jpg, u32 len, mjpeg_dc_map_t* map);
+
+#endif
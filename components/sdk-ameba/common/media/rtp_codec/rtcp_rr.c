@@ -0,0 +1,149 @@
+#include <platform/platform_stdlib.h>
+#include "rtcp_rr.h"
+
+#define RTCP_SR_INFO		20		// NTP and RTP timestamps, packet and octet counts
+
+#define RX_MAX_DROPOUT		3000
+#define RX_MAX_MISORDER		100
+
+static inline u32 get16(const u8* p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static inline u32 get32(const u8* p)
+{
+	return ((u32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline void put16(u8* p, u32 v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static inline void put32(u8* p, u32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+int rtcp_find_report(const u8* pkt, int len, u32 ssrc, rtcp_report_t* rb)
+{
+	const u8* b;
+	int i, rc, plen, off;
+
+	for(; len > 0; pkt += plen, len -= plen){
+		if(len < 4 || (pkt[0] >> 6) != 2)
+			return -1;
+		plen = (get16(pkt + 2) + 1) * 4;
+		if(plen > len)
+			return -1;
+		if(pkt[1] == RTCP_SR)
+			off = 8 + RTCP_SR_INFO;
+		else if(pkt[1] == RTCP_RR)
+			off = 8;
+		else
+			continue;
+
+		rc = pkt[0] & 0x1f;
+		for(i = 0; i < rc && off + 24 <= plen; i++, off += 24){
+			b = pkt + off;
+			if(get32(b) != ssrc)
+				continue;
+			rb->ssrc = ssrc;
+			rb->fraction_lost = b[4];
+			rb->lost = ((s32)get32(b + 4) << 8) >> 8;	// 24 bit signed
+			rb->ext_seq = get32(b + 8);
+			rb->jitter = get32(b + 12);
+			rb->lsr = get32(b + 16);
+			rb->dlsr = get32(b + 20);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void rtcp_rx_init(rtcp_rx_t* rx)
+{
+	memset(rx, 0, sizeof(rtcp_rx_t));
+}
+
+static void rtcp_rx_restart(rtcp_rx_t* rx, u32 ssrc, u16 seq)
+{
+	rx->ssrc = ssrc;
+	rx->started = 1;
+	rx->max_seq = seq;
+	rx->cycles = 0;
+	rx->base_seq = seq;
+	rx->received = 0;
+	rx->expected_prior = 0;
+	rx->received_prior = 0;
+}
+
+void rtcp_rx_update(rtcp_rx_t* rx, u32 ssrc, u16 seq, u32 ts, u32 arrival)
+{
+	u16 delta = seq - rx->max_seq;
+	s32 transit, d;
+
+	if(!rx->started || ssrc != rx->ssrc){
+		rtcp_rx_restart(rx, ssrc, seq);
+		rx->transit = arrival - ts;
+		rx->jitter = 0;
+	}else if(delta < RX_MAX_DROPOUT){
+		if(seq < rx->max_seq)
+			rx->cycles += 0x10000;
+		rx->max_seq = seq;
+	}else if(delta <= 0x10000 - RX_MAX_MISORDER){
+		// a jump too large to be loss, the sender restarted
+		rtcp_rx_restart(rx, ssrc, seq);
+	}
+	// else a duplicate or late packet, it is still counted as received
+	rx->received++;
+
+	// RFC 3550 A.8
+	transit = arrival - ts;
+	d = transit - rx->transit;
+	rx->transit = transit;
+	if(d < 0)
+		d = -d;
+	rx->jitter += d - ((rx->jitter + 8) >> 4);
+}
+
+int rtcp_rx_build_rr(rtcp_rx_t* rx, u32 own_ssrc, u8* buf, int size)
+{
+	u32 ext, expected, expected_interval, received_interval;
+	s32 lost, lost_interval;
+
+	if(!rx->started || size < RTCP_RR_LEN)
+		return -1;
+
+	ext = rx->cycles + rx->max_seq;
+	expected = ext - rx->base_seq + 1;
+	lost = expected - rx->received;
+	if(lost > 0x7fffff)
+		lost = 0x7fffff;
+	else if(lost < -0x800000)
+		lost = -0x800000;
+
+	expected_interval = expected - rx->expected_prior;
+	received_interval = rx->received - rx->received_prior;
+	rx->expected_prior = expected;
+	rx->received_prior = rx->received;
+	lost_interval = expected_interval - received_interval;
+
+	buf[0] = 0x80 | 1;		// V=2, one report block
+	buf[1] = RTCP_RR;
+	put16(buf + 2, RTCP_RR_LEN / 4 - 1);
+	put32(buf + 4, own_ssrc);
+	put32(buf + 8, rx->ssrc);
+	put32(buf + 12, lost & 0xffffff);
+	buf[12] = (expected_interval == 0 || lost_interval <= 0) ? 0 : (lost_interval << 8) / expected_interval;
+	put32(buf + 16, ext);
+	put32(buf + 20, rx->jitter >> 4);
+	put32(buf + 24, 0);		// no SR received
+	put32(buf + 28, 0);
+	return RTCP_RR_LEN;
+}
@@ -0,0 +1,49 @@
+#ifndef _RTCP_RR_H
+#define _RTCP_RR_H
+
+#include "basic_types.h"
+
+/*
+ * RTCP receiver reports (RFC 3550 6.4). A sender looks for the report block
+ * about its stream in the compound packets coming back, a receiver keeps
+ * the sequence and jitter state of appendix A and builds the report.
+ */
+
+#define RTCP_SR				200
+#define RTCP_RR				201
+#define RTCP_RR_LEN			32		// header, sender SSRC and one report block
+
+typedef struct _rtcp_report{
+	u32			ssrc;			// source the block is about
+	u8			fraction_lost;	// of 256, since the previous report
+	s32			lost;			// cumulative
+	u32			ext_seq;		// extended highest sequence number received
+	u32			jitter;			// interarrival jitter, timestamp units
+	u32			lsr;			// last SR, middle 32 bits of its NTP time
+	u32			dlsr;			// since that SR, 1/65536 s
+}rtcp_report_t;
+
+typedef struct _rtcp_rx{
+	u32			ssrc;			// of the source received
+	int			started;
+	u16			max_seq;
+	u32			cycles;			// sequence number wraps << 16
+	u32			base_seq;
+	u32			received;
+	u32			expected_prior;	// at the previous report
+	u32			received_prior;
+	s32			transit;		// of the previous packet
+	u32			jitter;			// timestamp units << 4
+}rtcp_rx_t;
+
+// the report block about ssrc in a compound packet: 1 if found, 0 if
+// there is none, -1 if the packet is malformed
+int rtcp_find_report(const u8* pkt, int len, u32 ssrc, rtcp_report_t* rb);
+
+void rtcp_rx_init(rtcp_rx_t* rx);
+// a packet of the stream arrived, arrival is the local clock in timestamp units
+void rtcp_rx_update(rtcp_rx_t* rx, u32 ssrc, u16 seq, u32 ts, u32 arrival);
+// RR from own_ssrc into buf, return its length or -1 if nothing was received
+int rtcp_rx_build_rr(rtcp_rx_t* rx, u32 own_ssrc, u8* buf, int size);
+
+#endif
@@ -0,0 +1,114 @@
+#include <platform/platform_stdlib.h>
+#include "rtp_fanout.h"
+
+void rtp_fanout_init(rtp_fanout_t* fo, rtp_fanout_send_t send, void* arg)
+{
+	memset(fo, 0, sizeof(rtp_fanout_t));
+	fo->send = send;
+	fo->arg = arg;
+}
+
+int rtp_fanout_add(rtp_fanout_t* fo, u32 addr, u16 port, u32 ssrc, u16 seq, int pinned)
+{
+	rtp_client_t* c;
+	int i;
+
+	for(i = 0; i < RTP_FANOUT_MAX_CLIENT; i++){
+		c = &fo->client[i];
+		if(c->state != RTP_CLIENT_FREE)
+			continue;
+		memset(c, 0, sizeof(rtp_client_t));
+		// a new viewer cannot decode before a key frame
+		c->state = RTP_CLIENT_WAIT_KEY;
+		c->pinned = pinned;
+		c->addr = addr;
+		c->port = port;
+		c->ssrc = ssrc;
+		c->seq = seq;
+		return i;
+	}
+	return -1;
+}
+
+void rtp_fanout_remove(rtp_fanout_t* fo, int id)
+{
+	if(id >= 0 && id < RTP_FANOUT_MAX_CLIENT)
+		fo->client[id].state = RTP_CLIENT_FREE;
+}
+
+int rtp_fanout_begin(rtp_fanout_t* fo, int key)
+{
+	rtp_client_t* c;
+	int i, n = 0;
+
+	for(i = 0; i < RTP_FANOUT_MAX_CLIENT; i++){
+		c = &fo->client[i];
+		c->failed = 0;
+		if(c->state == RTP_CLIENT_WAIT_KEY && key)
+			c->state = RTP_CLIENT_ACTIVE;
+		if(c->state == RTP_CLIENT_ACTIVE)
+			n++;
+	}
+	return n;
+}
+
+void rtp_fanout_end(rtp_fanout_t* fo)
+{
+	rtp_client_t* c;
+	int i;
+
+	for(i = 0; i < RTP_FANOUT_MAX_CLIENT; i++){
+		c = &fo->client[i];
+		if(c->state == RTP_CLIENT_FREE)
+			continue;
+		if(c->state == RTP_CLIENT_WAIT_KEY || c->failed)
+			c->dropped++;
+		if(!c->failed){
+			if(c->state == RTP_CLIENT_ACTIVE)
+				c->fail = 0;
+			continue;
+		}
+		c->state = RTP_CLIENT_WAIT_KEY;
+		if(++c->fail >= RTP_FANOUT_MAX_FAIL && !c->pinned){
+			c->state = RTP_CLIENT_FREE;
+			fo->removed++;
+		}
+	}
+}
+
+int rtp_fanout_sendv(void* arg, const rtp_iov_t* iov, int iovcnt)
+{
+	rtp_fanout_t* fo = (rtp_fanout_t*)arg;
+	rtp_iov_t v[RTP_PACK_IOV_MAX];
+	rtp_client_t* c;
+	u8* h = fo->hdr;
+	int i, n = 0;
+
+	// the payload slices are shared, the header is rewritten per client
+	memcpy(h, iov[0].base, iov[0].len);
+	v[0].base = h;
+	v[0].len = iov[0].len;
+	for(i = 1; i < iovcnt; i++)
+		v[i] = iov[i];
+
+	for(i = 0; i < RTP_FANOUT_MAX_CLIENT; i++){
+		c = &fo->client[i];
+		if(c->state != RTP_CLIENT_ACTIVE || c->failed)
+			continue;
+		h[2] = c->seq >> 8;
+		h[3] = c->seq;
+		h[8] = c->ssrc >> 24;
+		h[9] = c->ssrc >> 16;
+		h[10] = c->ssrc >> 8;
+		h[11] = c->ssrc;
+		// a failed packet takes its sequence number along, the gap shows the loss
+		c->seq++;
+		if(fo->send(fo->arg, c, v, iovcnt) < 0){
+			c->failed = 1;
+			continue;
+		}
+		c->packets++;
+		n++;
+	}
+	return n ? 0 : -1;
+}
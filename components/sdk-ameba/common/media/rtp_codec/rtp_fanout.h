@@ -0,0 +1,65 @@
+#ifndef _RTP_FANOUT_H
+#define _RTP_FANOUT_H
+
+#include "basic_types.h"
+#include "rtp_pack.h"
+
+/*
+ * Sends every packet of an rtp_pack_t to a set of clients, so a frame is
+ * packetized once however many viewers there are. Only the SSRC and the
+ * sequence number differ between clients, they are written into a copy of
+ * the RTP header per client. A multicast group is one more client.
+ *
+ * A client whose send fails is a slow consumer: the rest of the frame is
+ * dropped for it and it waits for the next key frame, one sequence number
+ * is skipped so the receiver sees the loss. After RTP_FANOUT_MAX_FAIL
+ * failed frames in a row it is removed, unless it is pinned.
+ */
+
+#define RTP_FANOUT_MAX_CLIENT	4
+#define RTP_FANOUT_MAX_FAIL		8
+
+#define RTP_CLIENT_FREE			0
+#define RTP_CLIENT_ACTIVE		1
+#define RTP_CLIENT_WAIT_KEY		2
+
+typedef struct _rtp_client{
+	u8			state;
+	u8			pinned;			// never removed for failing, the RTSP session's own client
+	u8			failed;			// a send failed in the current frame
+	u8			fail;			// frames in a row with a failed send
+	u32			addr;			// network order
+	u16			port;			// network order
+	u16			seq;			// of the next packet
+	u32			ssrc;
+	// statistics
+	u32			packets;
+	u32			dropped;		// frames not sent whole
+}rtp_client_t;
+
+struct _rtp_fanout;
+
+// send one datagram to c, return 0 or -1
+typedef int (*rtp_fanout_send_t)(void* arg, const rtp_client_t* c, const rtp_iov_t* iov, int iovcnt);
+
+typedef struct _rtp_fanout{
+	rtp_client_t	client[RTP_FANOUT_MAX_CLIENT];
+	rtp_fanout_send_t	send;
+	void*		arg;
+	u8			hdr[RTP_PACK_HDR_MAX];	// header of the client being sent to
+	u32			removed;				// slow consumers removed
+}rtp_fanout_t;
+
+void rtp_fanout_init(rtp_fanout_t* fo, rtp_fanout_send_t send, void* arg);
+// return the client id or -1 if all are in use
+int rtp_fanout_add(rtp_fanout_t* fo, u32 addr, u16 port, u32 ssrc, u16 seq, int pinned);
+void rtp_fanout_remove(rtp_fanout_t* fo, int id);
+// before packetizing a frame: waiting clients resume on a key frame.
+// Return the clients the frame goes to
+int rtp_fanout_begin(rtp_fanout_t* fo, int key);
+// after the frame, count failures and remove slow consumers
+void rtp_fanout_end(rtp_fanout_t* fo);
+// rtp_pack_send_t with arg = fo, 0 while at least one client takes the frame
+int rtp_fanout_sendv(void* arg, const rtp_iov_t* iov, int iovcnt);
+
+#endif
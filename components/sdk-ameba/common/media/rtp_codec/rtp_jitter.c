@@ -0,0 +1,353 @@
+#include <platform/platform_stdlib.h>
+#include "rtp_jitter.h"
+
+#define RTP_HDR_LEN			12
+
+static inline u32 get16(const u8* p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static inline u32 get32(const u8* p)
+{
+	return ((u32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// timestamp units to ms, signed
+static inline s32 jb_ms(rtp_jitter_t* jb, u32 ts)
+{
+	return (s32)((s64)(s32)ts * 1000 / (s32)jb->clock);
+}
+
+static inline rtp_jb_slot_t* jb_slot(rtp_jitter_t* jb, u16 seq)
+{
+	rtp_jb_slot_t* s = &jb->slot[seq & (jb->slots - 1)];
+
+	return (s->used && s->seq == seq) ? s : NULL;
+}
+
+// ms of audio from the play position to the end of the newest packet
+static s32 jb_level(rtp_jitter_t* jb)
+{
+	s32 level;
+
+	if(jb->count == 0)
+		return 0;
+	level = jb_ms(jb, jb->last_ts + jb->frame_ts - jb->head_ts);
+	return level < 0 ? 0 : level;
+}
+
+static void jb_flush(rtp_jitter_t* jb)
+{
+	int i;
+
+	for(i = 0; i < jb->slots; i++)
+		jb->slot[i].used = 0;
+	jb->count = 0;
+	jb->concealed = 0;
+	jb->late_run = 0;
+	jb->state = RTP_JB_IDLE;
+}
+
+void rtp_jitter_init(rtp_jitter_t* jb, rtp_jb_slot_t* slot, u8* mem, int slots, int size, u32 clock, u32 frame_ts, int scalable)
+{
+	int i;
+
+	memset(jb, 0, sizeof(rtp_jitter_t));
+	jb->slot = slot;
+	jb->slots = slots;
+	jb->size = size;
+	jb->clock = clock;
+	jb->frame_ts = frame_ts;
+	jb->scalable = scalable;
+	for(i = 0; i < slots; i++)
+		slot[i].pkt = mem + i * size;
+	rtp_jitter_reset(jb);
+}
+
+void rtp_jitter_reset(rtp_jitter_t* jb)
+{
+	jb_flush(jb);
+	memset(jb->hist, 0, sizeof(jb->hist));
+	jb->measured = 0;
+	jb->peak = 0;
+	jb->delay = 0;
+	jb->target = RTP_JB_INIT_DELAY;
+	rtcp_rx_init(&jb->rx);
+	memset(&jb->stats, 0, sizeof(rtp_jitter_stats_t));
+}
+
+static void jb_start(rtp_jitter_t* jb, u32 ssrc, u16 seq, u32 ts, u32 now_ms)
+{
+	jb->state = RTP_JB_BUFFERING;
+	jb->played = 0;
+	jb->ssrc = ssrc;
+	jb->head_seq = jb->last_seq = seq;
+	jb->head_ts = jb->last_ts = ts;
+	jb->ts0 = ts;
+	jb->min_prev = now_ms;
+	jb->window = 0;
+}
+
+// ms the packet is later than the earliest one of the last two windows
+static u32 jb_transit(rtp_jitter_t* jb, u32 ts, u32 now_ms)
+{
+	u32 transit = now_ms - (u32)jb_ms(jb, ts - jb->ts0), min;
+
+	if(jb->window == 0)
+		jb->min_cur = transit;
+	if((s32)(transit - jb->min_cur) < 0)
+		jb->min_cur = transit;
+	min = jb->min_cur;
+	if((s32)(jb->min_prev - min) < 0)
+		min = jb->min_prev;
+	if(++jb->window == RTP_JB_WINDOW){
+		jb->min_prev = jb->min_cur;
+		jb->window = 0;
+	}
+	return transit - min;
+}
+
+static void jb_estimate(rtp_jitter_t* jb, u32 rel, u32 now_ms)
+{
+	u32 bin = rel / RTP_JB_BIN_MS, total = 0, limit, cum = 0, frame_ms, max;
+	int i;
+
+	if(bin >= RTP_JB_BINS)
+		bin = RTP_JB_BINS - 1;
+	for(i = 0; i < RTP_JB_BINS; i++){
+		jb->hist[i] -= jb->hist[i] >> RTP_JB_FORGET;
+		total += jb->hist[i];
+	}
+	jb->hist[bin] += 65536 >> RTP_JB_FORGET;
+	total += 65536 >> RTP_JB_FORGET;
+
+	limit = (u64)total * RTP_JB_QUANTILE >> 8;
+	for(i = 0; i < RTP_JB_BINS - 1; i++){
+		cum += jb->hist[i];
+		if(cum >= limit)
+			break;
+	}
+
+	if(now_ms - jb->peak_ms >= 1000){
+		jb->peak -= jb->peak >> 3;
+		jb->peak_ms = now_ms;
+	}
+
+	jb->target = (i + 1) * RTP_JB_BIN_MS;
+	if(jb->measured < RTP_JB_LEARN){
+		jb->measured++;
+		if(jb->target < RTP_JB_INIT_DELAY)
+			jb->target = RTP_JB_INIT_DELAY;
+	}
+	if(jb->target < jb->peak)
+		jb->target = jb->peak;
+	frame_ms = jb_ms(jb, jb->frame_ts);
+	max = (jb->slots - 2) * frame_ms;
+	if(max > RTP_JB_MAX_DELAY)
+		max = RTP_JB_MAX_DELAY;
+	if(jb->target > max)
+		jb->target = max;
+	if(jb->target < RTP_JB_MIN_DELAY)
+		jb->target = RTP_JB_MIN_DELAY;
+}
+
+int rtp_jitter_put(rtp_jitter_t* jb, const u8* pkt, int len, u32 now_ms)
+{
+	rtp_jb_slot_t* s;
+	u32 ssrc, ts, rel, dts;
+	u16 seq;
+	s16 d;
+	int off;
+
+	if(len < RTP_HDR_LEN || len > jb->size || (pkt[0] >> 6) != 2)
+		return -1;
+	off = RTP_HDR_LEN + (pkt[0] & 0x0f) * 4;
+	if(pkt[0] & 0x10){
+		if(len < off + 4)
+			return -1;
+		off += 4 + get16(pkt + off + 2) * 4;
+	}
+	if(pkt[0] & 0x20)
+		len -= pkt[len - 1];
+	if(off >= len)
+		return -1;
+	seq = get16(pkt + 2);
+	ts = get32(pkt + 4);
+	ssrc = get32(pkt + 8);
+
+	if(jb->state != RTP_JB_IDLE && ssrc != jb->ssrc){
+		jb_flush(jb);
+		jb->stats.resets++;
+	}
+	if(jb->state == RTP_JB_IDLE)
+		jb_start(jb, ssrc, seq, ts, now_ms);
+
+	rtcp_rx_update(&jb->rx, ssrc, seq, ts, (u64)now_ms * jb->clock / 1000);
+	rel = jb_transit(jb, ts, now_ms);
+
+	d = seq - jb->head_seq;
+	if(d < 0 && !jb->played && (u16)(jb->last_seq - seq) < jb->slots){
+		// came before the first one, nothing has played yet
+		jb->head_seq = seq;
+		jb->head_ts = ts;
+		d = 0;
+	}
+	if(d < 0){
+		if(++jb->late_run < RTP_JB_LATE_RESET){
+			jb->stats.late++;
+			if(jb->peak < rel + RTP_JB_BIN_MS)
+				jb->peak = rel + RTP_JB_BIN_MS;
+			jb_estimate(jb, rel, now_ms);
+			return -1;
+		}
+		// the sender started over with lower numbers
+		jb_flush(jb);
+		jb->stats.resets++;
+		jb_start(jb, ssrc, seq, ts, now_ms);
+		d = 0;
+	}else if(d >= jb->slots){
+		// an outage longer than the buffer, or a restart
+		jb_flush(jb);
+		jb->stats.resets++;
+		jb_start(jb, ssrc, seq, ts, now_ms);
+		d = 0;
+	}
+	jb->late_run = 0;
+
+	// its turn is being concealed right now, a delay spike
+	if(d == 0 && jb->state == RTP_JB_PLAYING && jb->concealed && jb->peak < rel + RTP_JB_BIN_MS)
+		jb->peak = rel + RTP_JB_BIN_MS;
+	jb_estimate(jb, rel, now_ms);
+
+	s = &jb->slot[seq & (jb->slots - 1)];
+	if(s->used){
+		jb->stats.dup++;
+		return -1;
+	}
+	memcpy(s->pkt, pkt, len);
+	s->used = 1;
+	s->seq = seq;
+	s->ts = ts;
+	s->pt = pkt[1] & 0x7f;
+	s->offset = off;
+	s->len = len - off;
+	s->arrival = now_ms;
+	s->rel = rel > 0xffff ? 0xffff : rel;
+	jb->count++;
+	jb->stats.received++;
+
+	d = seq - jb->last_seq;
+	if(d > 0){
+		dts = ts - jb->last_ts;
+		if(d == 1 && dts && dts < jb->clock)
+			jb->frame_ts = dts;
+		jb->last_seq = seq;
+		jb->last_ts = ts;
+	}else if(d < 0)
+		jb->stats.reordered++;
+
+	return 0;
+}
+
+int rtp_jitter_get(rtp_jitter_t* jb, rtp_jb_frame_t* f, u32 now_ms)
+{
+	rtp_jb_slot_t* s;
+	s32 excess, frame_ms;
+
+	if(jb->state == RTP_JB_IDLE)
+		return RTP_JB_NONE;
+	if(jb->state == RTP_JB_BUFFERING){
+		if(jb->count == 0)
+			return RTP_JB_NONE;
+		// start from the oldest packet there is
+		while((s = jb_slot(jb, jb->head_seq)) == NULL){
+			jb->head_seq++;
+			jb->stats.lost++;
+		}
+		jb->head_ts = s->ts;
+		frame_ms = jb_ms(jb, jb->frame_ts);
+		if(jb_level(jb) - frame_ms < (s32)jb->target)
+			return RTP_JB_NONE;
+		jb->state = RTP_JB_PLAYING;
+		jb->played = 1;
+		jb->delay = (now_ms - s->arrival + s->rel) << 4;
+		jb->concealed = 0;
+	}
+
+	frame_ms = jb_ms(jb, jb->frame_ts);
+	s = jb_slot(jb, jb->head_seq);
+	if(s){
+		// how long it waited, plus how much later than the earliest it came:
+		// what a packet on time waits
+		jb->delay += (((s32)(now_ms - s->arrival + s->rel) << 4) - jb->delay) >> 4;
+		excess = (jb->delay >> 4) - (s32)jb->target;
+		if(excess > RTP_JB_DROP_DELAY && jb_slot(jb, jb->head_seq + 1)){
+			s->used = 0;
+			jb->count--;
+			jb->head_seq++;
+			jb->stats.dropped++;
+			jb->delay -= frame_ms << 4;
+			excess -= frame_ms;
+			s = jb_slot(jb, jb->head_seq);
+		}
+
+		f->data = s->pkt + s->offset;
+		f->len = s->len;
+		f->ts = s->ts;
+		f->seq = s->seq;
+		f->pt = s->pt;
+		f->adjust = 0;
+		if(jb->scalable){
+			if(excess > frame_ms)
+				f->adjust = -2;
+			else if(excess > frame_ms / 2)
+				f->adjust = -1;
+			else if(excess < 0)
+				f->adjust = 1;
+			if(f->adjust < 0)
+				jb->stats.slipped -= f->adjust;
+			else
+				jb->stats.stretched += f->adjust;
+		}
+
+		s->used = 0;
+		jb->count--;
+		jb->head_seq++;
+		jb->head_ts = s->ts + jb->frame_ts;
+		jb->concealed = 0;
+		jb->stats.delay = jb->delay >> 4;
+		if(jb->stats.delay_max < jb->stats.delay)
+			jb->stats.delay_max = jb->stats.delay;
+		return RTP_JB_PACKET;
+	}
+
+	// not there at its turn. With nothing buffered the play position waits
+	// for it, otherwise it is lost
+	if(jb->count == 0)
+		jb->stats.underflow++;
+	else{
+		jb->stats.lost++;
+		jb->head_seq++;
+		jb->head_ts += jb->frame_ts;
+	}
+	jb->concealed += frame_ms;
+	if(jb->concealed > RTP_JB_PLC_MAX){
+		jb->state = RTP_JB_BUFFERING;
+		return RTP_JB_NONE;
+	}
+	f->data = NULL;
+	f->len = jb->frame_ts;
+	f->ts = jb->head_ts;
+	f->seq = jb->head_seq;
+	f->pt = 0;
+	f->adjust = 0;
+	return RTP_JB_LOST;
+}
+
+void rtp_jitter_get_stats(rtp_jitter_t* jb, rtp_jitter_stats_t* stats)
+{
+	*stats = jb->stats;
+	stats->target = jb->target;
+	stats->jitter = (u64)(jb->rx.jitter >> 4) * 1000 / jb->clock;
+}
@@ -0,0 +1,129 @@
+#ifndef _RTP_JITTER_H
+#define _RTP_JITTER_H
+
+#include "basic_types.h"
+#include "rtcp_rr.h"
+
+/*
+ * Adaptive jitter buffer for an RTP audio stream. Packets are kept in slots
+ * by sequence number, so they play in order whatever order they came in.
+ * Playout is pulled by the consumer, one frame per rtp_jitter_get, at the
+ * rate the audio output plays.
+ *
+ * The target delay is a high quantile of how much later than the earliest
+ * one each packet arrives over the last seconds, raised at once by a packet
+ * that came too late and decaying back. What a packet on time would wait
+ * is measured as each one is taken; above the target the consumer is asked
+ * to play a frame a sample or two short, below it a sample long, which
+ * also takes up the drift between the sender's clock and the output's. Far
+ * above it whole frames are dropped.
+ *
+ * A frame that is not there in time is played as a loss to conceal. When
+ * nothing at all is buffered the play position waits, so the delay grows by
+ * the frame concealed. Not thread safe, the caller locks.
+ */
+
+#define RTP_JB_MIN_DELAY		10		// ms
+#define RTP_JB_MAX_DELAY		300
+#define RTP_JB_INIT_DELAY		60		// at least, until RTP_JB_LEARN packets are measured
+#define RTP_JB_LEARN			50
+#define RTP_JB_DROP_DELAY		60		// ms above the target to drop frames
+#define RTP_JB_PLC_MAX			200		// ms concealed before buffering again
+#define RTP_JB_QUANTILE			250		// of 256, 97.7%
+#define RTP_JB_BIN_MS			5
+#define RTP_JB_BINS				64		// delays of 0 to 315 ms
+#define RTP_JB_FORGET			7		// histogram weights decay by 1/128 per packet
+#define RTP_JB_WINDOW			128		// packets a minimum transit is kept
+#define RTP_JB_LATE_RESET		8		// late packets in a row from a restarted sender
+
+// rtp_jitter_get
+#define RTP_JB_NONE				0		// buffering, nothing to play
+#define RTP_JB_PACKET			1
+#define RTP_JB_LOST				2		// conceal one frame
+
+#define RTP_JB_IDLE				0
+#define RTP_JB_BUFFERING		1
+#define RTP_JB_PLAYING			2
+
+typedef struct _rtp_jb_slot{
+	u8			used;
+	u8			pt;
+	u16			seq;
+	u32			ts;
+	u16			offset;			// of the payload
+	u16			len;
+	u16			rel;			// ms later than the earliest packet
+	u32			arrival;		// ms
+	u8*			pkt;
+}rtp_jb_slot_t;
+
+typedef struct _rtp_jb_frame{
+	u8*			data;			// payload, until the next rtp_jitter_put
+	int			len;			// payload bytes, or clock units to conceal
+	u32			ts;
+	u16			seq;
+	u8			pt;
+	s8			adjust;			// samples to play more (+) or fewer (-)
+}rtp_jb_frame_t;
+
+typedef struct _rtp_jitter_stats{
+	u32			received;		// stored
+	u32			late;			// came after their turn to play
+	u32			lost;			// missing at their turn, concealed
+	u32			dup;
+	u32			reordered;		// came after a later one, still in time
+	u32			underflow;		// frames concealed with nothing buffered
+	u32			dropped;		// frames skipped to cut the delay
+	u32			slipped;		// samples asked to be played fewer
+	u32			stretched;		// samples asked to be played more
+	u32			resets;			// sender restarts, outages longer than the buffer
+	u32			delay;			// ms a packet on time waits in the buffer
+	u32			delay_max;
+	u32			target;			// ms
+	u32			jitter;			// ms, RFC 3550 interarrival jitter
+}rtp_jitter_stats_t;
+
+typedef struct _rtp_jitter{
+	rtp_jb_slot_t*	slot;
+	u16			slots;			// power of 2
+	u16			size;			// bytes per slot
+	u32			clock;			// RTP clock rate
+	u8			scalable;		// the consumer plays frames a sample short or long
+	u8			state;
+	u32			ssrc;
+	// play position
+	u16			head_seq;
+	u32			head_ts;
+	u16			count;
+	u16			last_seq;		// newest stored
+	u32			last_ts;
+	u32			frame_ts;		// duration of a packet
+	u32			concealed;		// ms concealed in a row
+	u8			late_run;
+	u8			played;			// since the stream started
+	// delay estimate
+	u32			ts0;			// timestamp of ms 0
+	u32			min_cur;		// smallest transit in this and the previous window
+	u32			min_prev;
+	u16			window;
+	u16			measured;		// packets, up to RTP_JB_LEARN
+	u32			hist[RTP_JB_BINS];	// of 65536 once full
+	u32			peak;			// ms
+	u32			peak_ms;		// last decay
+	s32			delay;			// ms << 4
+	u32			target;
+	rtcp_rx_t	rx;
+	rtp_jitter_stats_t	stats;
+}rtp_jitter_t;
+
+// mem is slots * size bytes of packet storage, slots a power of 2. frame_ts
+// is the packet duration until one is seen, in clock units
+void rtp_jitter_init(rtp_jitter_t* jb, rtp_jb_slot_t* slot, u8* mem, int slots, int size, u32 clock, u32 frame_ts, int scalable);
+void rtp_jitter_reset(rtp_jitter_t* jb);
+// a packet arrived at now_ms, return 0 if it was stored
+int rtp_jitter_put(rtp_jitter_t* jb, const u8* pkt, int len, u32 now_ms);
+// the next frame to play, taken at now_ms. Return RTP_JB_*
+int rtp_jitter_get(rtp_jitter_t* jb, rtp_jb_frame_t* f, u32 now_ms);
+void rtp_jitter_get_stats(rtp_jitter_t* jb, rtp_jitter_stats_t* stats);
+
+#endif
@@ -0,0 +1,260 @@
+#include <platform/platform_stdlib.h>
+#include "rtp_pack.h"
+
+#define RTP_HDR_LEN		12
+
+#define FU_A			28
+#define FU_S			0x80
+#define FU_E			0x40
+
+#define JPEG_SOF0		0xc0
+#define JPEG_SOF2		0xc2
+#define JPEG_SOI		0xd8
+#define JPEG_EOI		0xd9
+#define JPEG_SOS		0xda
+#define JPEG_DQT		0xdb
+#define JPEG_DRI		0xdd
+
+#define JPEG_Q_INBAND	255		// tables in the first packet of the frame
+#define JPEG_RESTART	64		// type flag, restart header follows
+
+static inline void put16(u8* p, u32 v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static inline void put32(u8* p, u32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+void rtp_pack_init(rtp_pack_t* pk, u8 pt, u32 ssrc, u16 seq, rtp_pack_send_t send, void* arg)
+{
+	memset(pk, 0, sizeof(rtp_pack_t));
+	pk->pt = pt;
+	pk->ssrc = ssrc;
+	pk->seq = seq;
+	pk->mtu = RTP_PACK_MTU;
+	pk->send = send;
+	pk->arg = arg;
+}
+
+// RTP header into pk->hdr, return where the payload header goes
+static u8* rtp_header(rtp_pack_t* pk, u32 ts, int marker)
+{
+	u8* h = pk->hdr;
+
+	h[0] = 0x80;	// V=2, no padding, extension or CSRC
+	h[1] = (marker ? 0x80 : 0) | (pk->pt & 0x7f);
+	put16(h + 2, pk->seq);
+	put32(h + 4, ts);
+	put32(h + 8, pk->ssrc);
+	return h + RTP_HDR_LEN;
+}
+
+// iov[0] is set to the hdr_len bytes of pk->hdr
+static int rtp_emit(rtp_pack_t* pk, rtp_iov_t* iov, int iovcnt, u32 hdr_len)
+{
+	u32 len = 0;
+	int i, ret;
+
+	iov[0].base = pk->hdr;
+	iov[0].len = hdr_len;
+	for(i = 0; i < iovcnt; i++)
+		len += iov[i].len;
+
+	ret = pk->send(pk->arg, iov, iovcnt);
+	// the sequence number moves on also for a lost packet
+	pk->seq++;
+	if(ret < 0)
+		return -1;
+	pk->packets++;
+	pk->bytes += len;
+	pk->hdr_bytes += hdr_len;
+	return 0;
+}
+
+int rtp_pack_h264(rtp_pack_t* pk, const h264_au_t* au, u32 ts, int last)
+{
+	rtp_iov_t iov[2];
+	const h264_nal_t* n;
+	const u8 *nal, *p;
+	u32 left, chunk, room = pk->mtu - RTP_HDR_LEN;
+	int i, end, count = 0;
+	u8* h;
+
+	for(i = 0; i < au->num_nal; i++){
+		n = &au->nal[i];
+		nal = au->data + n->offset;
+		end = last && i == au->num_nal - 1;
+
+		if(n->len <= room){
+			rtp_header(pk, ts, end);
+			iov[1].base = nal;
+			iov[1].len = n->len;
+			if(rtp_emit(pk, iov, 2, RTP_HDR_LEN) < 0)
+				return -1;
+			count++;
+			continue;
+		}
+
+		// FU-A, the NAL header is carried in the FU indicator and FU header
+		p = nal + 1;
+		left = n->len - 1;
+		while(left){
+			chunk = (left > room - 2) ? room - 2 : left;
+			h = rtp_header(pk, ts, end && chunk == left);
+			h[0] = (nal[0] & 0xe0) | FU_A;
+			h[1] = (p == nal + 1 ? FU_S : 0) | (chunk == left ? FU_E : 0) | (nal[0] & 0x1f);
+			iov[1].base = p;
+			iov[1].len = chunk;
+			if(rtp_emit(pk, iov, 2, RTP_HDR_LEN + 2) < 0)
+				return -1;
+			count++;
+			p += chunk;
+			left -= chunk;
+		}
+	}
+	return count;
+}
+
+int rtp_pack_jpeg(rtp_pack_t* pk, const u8* jpg, u32 len, u32 ts)
+{
+	rtp_iov_t iov[RTP_PACK_IOV_MAX];
+	const u8 *p = jpg, *end = jpg + len, *scan = NULL, *q;
+	const u8* qt[2] = {NULL, NULL};
+	u32 seg, dri = 0, width = 0, height = 0, type = 0, off, left, chunk, hlen;
+	int iovcnt, count = 0, sof = 0;
+	u8* h;
+
+	if(len < 4 || p[0] != 0xff || p[1] != JPEG_SOI)
+		return -1;
+
+	// headers up to the start of scan, the tables stay where they are
+	for(p += 2; scan == NULL; p += 2 + seg){
+		if(p + 4 > end || p[0] != 0xff)
+			return -1;
+		if(p[1] == 0xff){
+			seg = -1;	// fill byte, step over one
+			continue;
+		}
+		seg = (p[2] << 8) | p[3];
+		if(seg < 2 || p + 2 + seg > end)
+			return -1;
+
+		switch(p[1]){
+		case JPEG_DQT:
+			for(q = p + 4; q + 65 <= p + 2 + seg; q += 65){
+				if(q[0] >> 4)
+					return -1;	// 16 bit precision
+				if((q[0] & 0x0f) < 2)
+					qt[q[0] & 0x0f] = q + 1;
+			}
+			break;
+		case JPEG_SOF0:
+			// Y, Cb, Cr with 8 bit samples, chroma 1x1
+			if(seg < 17 || p[4] != 8 || p[9] != 3 || p[14] != 0x11 || p[17] != 0x11)
+				return -1;
+			height = (p[5] << 8) | p[6];
+			width = (p[7] << 8) | p[8];
+			if(p[11] == 0x21)
+				type = 0;	// 4:2:2
+			else if(p[11] == 0x22)
+				type = 1;	// 4:2:0
+			else
+				return -1;
+			sof = 1;
+			break;
+		case JPEG_SOF2:
+			return -1;
+		case JPEG_DRI:
+			dri = (p[4] << 8) | p[5];
+			break;
+		case JPEG_SOS:
+			scan = p + 2 + seg;
+			break;
+		}
+	}
+
+	if(!sof || qt[0] == NULL || qt[1] == NULL || width > 2040 || height > 2040)
+		return -1;
+	if(end - scan >= 2 && end[-2] == 0xff && end[-1] == JPEG_EOI)
+		end -= 2;
+	if(dri)
+		type |= JPEG_RESTART;
+
+	for(off = 0, left = end - scan; left; off += chunk, left -= chunk){
+		h = rtp_header(pk, ts, 0);
+		put32(h, off);	// type specific 0, 24 bit fragment offset
+		h[4] = type;
+		h[5] = JPEG_Q_INBAND;
+		h[6] = (width + 7) >> 3;
+		h[7] = (height + 7) >> 3;
+		hlen = RTP_HDR_LEN + 8;
+		if(dri){
+			// restart intervals are not aligned to packets
+			put16(pk->hdr + hlen, dri);
+			put16(pk->hdr + hlen + 2, 0xffff);
+			hlen += 4;
+		}
+		iovcnt = 1;
+		if(off == 0){
+			h = pk->hdr + hlen;
+			h[0] = 0;	// MBZ
+			h[1] = 0;	// 8 bit tables
+			put16(h + 2, 128);
+			hlen += 4;
+			iov[iovcnt].base = qt[0];
+			iov[iovcnt++].len = 64;
+			iov[iovcnt].base = qt[1];
+			iov[iovcnt++].len = 64;
+		}
+		chunk = pk->mtu - hlen - (off == 0 ? 128 : 0);
+		if(chunk >= left){
+			chunk = left;
+			pk->hdr[1] |= 0x80;		// marker on the last packet of the frame
+		}
+		iov[iovcnt].base = scan + off;
+		iov[iovcnt++].len = chunk;
+		if(rtp_emit(pk, iov, iovcnt, hlen) < 0)
+			return -1;
+		count++;
+	}
+	return count;
+}
+
+int rtp_pack_aac(rtp_pack_t* pk, const u8* frame, u32 len, u32 ts)
+{
+	rtp_iov_t iov[2];
+	u32 hlen, off, left, chunk, room = pk->mtu - RTP_HDR_LEN - 4;
+	int count = 0;
+	u8* h;
+
+	if(len >= 7 && frame[0] == 0xff && (frame[1] & 0xf6) == 0xf0){
+		hlen = (frame[1] & 0x01) ? 7 : 9;	// protection_absent
+		if(len < hlen)
+			return -1;
+		frame += hlen;
+		len -= hlen;
+	}
+	if(len == 0 || len > 0x1fff)
+		return -1;
+
+	// every fragment repeats the AU header with the size of the whole AU
+	for(off = 0, left = len; left; off += chunk, left -= chunk){
+		chunk = (left > room) ? room : left;
+		h = rtp_header(pk, ts, chunk == left);
+		put16(h, 16);				// AU-headers-length in bits
+		put16(h + 2, len << 3);		// AU-size 13 bits, AU-index 0
+		iov[1].base = frame + off;
+		iov[1].len = chunk;
+		if(rtp_emit(pk, iov, 2, RTP_HDR_LEN + 4) < 0)
+			return -1;
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,52 @@
+#ifndef _RTP_PACK_H
+#define _RTP_PACK_H
+
+#include "basic_types.h"
+#include "h264/h264_nal.h"
+
+/*
+ * RTP packetizer that never copies the frame: each datagram is handed to
+ * the send callback as a list of slices, the RTP and payload headers built
+ * here followed by pointers into the captured frame. The frame must stay
+ * unchanged until the call returns.
+ *
+ * H.264 is RFC 6184 packetization mode 1 (single NAL or FU-A), JPEG is
+ * RFC 2435 with the quantization tables sent in band (Q = 255) and AAC is
+ * RFC 3640 AAC-hbr, one AU per packet or fragmented.
+ */
+
+#define RTP_PACK_MTU			1400	// datagram bytes, RTP header included
+#define RTP_PACK_IOV_MAX		4
+#define RTP_PACK_HDR_MAX		(12 + 16)	// RTP + JPEG, restart and table headers
+
+typedef struct _rtp_iov{
+	const void*	base;
+	u32			len;
+}rtp_iov_t;
+
+// send one datagram, return 0 or -1
+typedef int (*rtp_pack_send_t)(void* arg, const rtp_iov_t* iov, int iovcnt);
+
+typedef struct _rtp_pack{
+	u8			pt;
+	u16			seq;			// of the next packet
+	u32			ssrc;
+	u32			mtu;
+	rtp_pack_send_t	send;
+	void*		arg;
+	u8			hdr[RTP_PACK_HDR_MAX];
+	// statistics
+	u32			packets;
+	u32			bytes;			// datagram bytes sent
+	u32			hdr_bytes;		// the part of it written here, the rest is referenced
+}rtp_pack_t;
+
+void rtp_pack_init(rtp_pack_t* pk, u8 pt, u32 ssrc, u16 seq, rtp_pack_send_t send, void* arg);
+// the NALs of au; marker on the last one if last is set. Return packets or -1
+int rtp_pack_h264(rtp_pack_t* pk, const h264_au_t* au, u32 ts, int last);
+// a baseline JFIF/JPEG frame, 4:2:0 or 4:2:2, 8 bit tables
+int rtp_pack_jpeg(rtp_pack_t* pk, const u8* jpg, u32 len, u32 ts);
+// one raw AAC frame, an ADTS header is skipped
+int rtp_pack_aac(rtp_pack_t* pk, const u8* frame, u32 len, u32 ts);
+
+#endif
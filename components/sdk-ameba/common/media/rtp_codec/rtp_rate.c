@@ -0,0 +1,93 @@
+#include <platform/platform_stdlib.h>
+#include "rtp_rate.h"
+
+void rtp_rate_init(rtp_rate_t* rc, u32 min_bitrate, u32 max_bitrate, u8 min_fps, u8 max_fps)
+{
+	memset(rc, 0, sizeof(rtp_rate_t));
+	rc->min_bitrate = min_bitrate;
+	rc->max_bitrate = max_bitrate;
+	rc->min_fps = min_fps;
+	rc->max_fps = max_fps;
+	rc->bitrate = max_bitrate;
+	rc->fps = max_fps;
+}
+
+// half the frame rate below a quarter of the top bitrate, a quarter below
+// an eighth; going back up takes a quarter more than that
+static u8 rtp_rate_fps(rtp_rate_t* rc)
+{
+	u32 b = rc->bitrate, m = rc->max_bitrate;
+	u8 fps = rc->max_fps;
+
+	if(b * 16 < m * (rc->fps < rc->max_fps ? 5 : 4))
+		fps = rc->max_fps / 2;
+	if(b * 32 < m * (rc->fps < rc->max_fps / 2 ? 5 : 4))
+		fps = rc->max_fps / 4;
+	if(fps < rc->min_fps)
+		fps = rc->min_fps;
+	return fps;
+}
+
+int rtp_rate_report(rtp_rate_t* rc, const rtcp_report_t* rb, u16 next_seq, u32 bytes, u32 clock, u32 now_ms)
+{
+	u32 bitrate = rc->bitrate, prev_delay = rc->delay, queued, sent, elapsed, cut, share;
+	int changed = 0, congested;
+	u8 fps;
+
+	rc->reports++;
+	rc->loss = rb->fraction_lost;
+	rc->jitter = clock ? (u32)((u64)rb->jitter * 1000 / clock) : 0;
+
+	// sent but not received yet when the report was made, over the send
+	// rate is how long they wait in front of the receiver
+	queued = (u16)(next_seq - 1 - rb->ext_seq);
+	if(queued >= 0x8000)
+		queued = 0;
+	elapsed = now_ms - rc->last_ms;
+	sent = (u16)(next_seq - rc->last_seq);
+	if(rc->started && sent && elapsed){
+		rc->delay = queued * elapsed / sent;
+		// packets the receiver got, at the size sent lately
+		rc->recv_rate = (u64)(rb->ext_seq - rc->last_ext_seq) * (bytes - rc->last_bytes) / sent * 8000 / elapsed;
+	}else{
+		rc->delay = 0;
+		rc->recv_rate = 0;
+	}
+	rc->started = 1;
+	rc->last_seq = next_seq;
+	rc->last_ext_seq = rb->ext_seq;
+	rc->last_bytes = bytes;
+	rc->last_ms = now_ms;
+
+	// a queue that is already draining after a cut is not cut again
+	congested = rc->loss > RTP_RATE_LOSS_HIGH || (rc->delay > RTP_RATE_DELAY_HIGH && rc->delay >= prev_delay);
+	if(congested){
+		cut = rc->loss / 2;
+		if(cut < RTP_RATE_CUT_MIN)
+			cut = RTP_RATE_CUT_MIN;
+		bitrate -= (u64)bitrate * cut >> 8;
+		share = (u64)rc->recv_rate * RTP_RATE_RECV_SHARE >> 8;
+		if(share && share < bitrate)
+			bitrate = share;
+		rc->cuts++;
+	}else if(rc->loss < RTP_RATE_LOSS_LOW && rc->delay < RTP_RATE_DELAY_LOW && rc->jitter < RTP_RATE_JITTER_MAX){
+		bitrate += (u64)bitrate * RTP_RATE_STEP >> 8;
+	}
+	rc->drop = congested;
+
+	if(bitrate < rc->min_bitrate)
+		bitrate = rc->min_bitrate;
+	if(bitrate > rc->max_bitrate)
+		bitrate = rc->max_bitrate;
+	if(bitrate != rc->bitrate){
+		rc->bitrate = bitrate;
+		changed |= RTP_RATE_BITRATE;
+	}
+
+	fps = rtp_rate_fps(rc);
+	if(fps != rc->fps){
+		rc->fps = fps;
+		changed |= RTP_RATE_FPS;
+	}
+	return changed;
+}
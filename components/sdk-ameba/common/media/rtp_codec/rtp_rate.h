@@ -0,0 +1,61 @@
+#ifndef _RTP_RATE_H
+#define _RTP_RATE_H
+
+#include "basic_types.h"
+#include "rtcp_rr.h"
+
+/*
+ * Sender rate control from RTCP receiver reports. Loss, or a queue growing
+ * in front of the receiver (the packets it has not seen yet when it makes
+ * the report), cuts the bitrate below what the receiver got over the last
+ * interval; clear reports raise it by a few percent. The frame rate follows
+ * the bitrate down so frames keep some quality, and while congested, frames
+ * that nothing refers to are dropped before they are sent.
+ */
+
+#define RTP_RATE_LOSS_HIGH		26		// of 256, 10%
+#define RTP_RATE_LOSS_LOW		5		// 2%
+#define RTP_RATE_DELAY_HIGH		200		// ms queued
+#define RTP_RATE_DELAY_LOW		100		// an I frame burst is about this much
+#define RTP_RATE_JITTER_MAX		40		// ms, no increase above
+#define RTP_RATE_CUT_MIN		38		// of 256, at least 15% less when congested
+#define RTP_RATE_RECV_SHARE		224		// of 256, 7/8 of the rate received
+#define RTP_RATE_STEP			20		// of 256, 8% more when clear
+
+// what rtp_rate_report changed
+#define RTP_RATE_BITRATE		0x01
+#define RTP_RATE_FPS			0x02
+
+typedef struct _rtp_rate{
+	u32			min_bitrate;	// bit/s
+	u32			max_bitrate;
+	u8			min_fps;
+	u8			max_fps;
+	// output
+	u32			bitrate;
+	u8			fps;
+	u8			drop;			// drop frames no other frame refers to
+	// last report
+	u8			loss;			// of 256
+	u32			delay;			// ms, estimated
+	u32			jitter;			// ms
+	u32			recv_rate;		// bit/s the receiver got since the previous report
+	// state
+	int			started;
+	u16			last_seq;		// next sequence number at the previous report
+	u32			last_ext_seq;
+	u32			last_bytes;
+	u32			last_ms;
+	// statistics
+	u32			reports;
+	u32			cuts;
+}rtp_rate_t;
+
+void rtp_rate_init(rtp_rate_t* rc, u32 min_bitrate, u32 max_bitrate, u8 min_fps, u8 max_fps);
+// a report block about the stream. next_seq is the sequence number the
+// next packet will get, bytes the datagram bytes sent so far, clock the RTP
+// clock rate and now_ms the local time. Return RTP_RATE_* for the outputs
+// that changed
+int rtp_rate_report(rtp_rate_t* rc, const rtcp_report_t* rb, u16 next_seq, u32 bytes, u32 clock, u32 now_ms);
+
+#endif
@@ -39,8 +39,15 @@ typedef signed     char    s8_t;
 typedef unsigned   short   u16_t;
 typedef signed     short   s16_t;
 typedef unsigned   int    u32_t;
+#if defined(__GNUC__) && defined(__LP64__)
+/* 64 bit hosts (os/freertos/freertos_sim): s32_t must stay 32 bits for the
+   TCP sequence number compares, pointers do not fit in u32_t */
+typedef signed     int     s32_t;
+typedef unsigned long mem_ptr_t;
+#else
 typedef signed     long    s32_t;
 typedef u32_t mem_ptr_t;
+#endif
 typedef int sys_prot_t;
 
 #define U16_F "d"
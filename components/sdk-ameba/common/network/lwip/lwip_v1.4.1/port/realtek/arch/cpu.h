@@ -32,6 +32,9 @@
 #ifndef __CPU_H__
 #define __CPU_H__
 
+/* the C library of a host build (os/freertos/freertos_sim) has its own */
+#ifndef BYTE_ORDER
 #define BYTE_ORDER LITTLE_ENDIAN
+#endif
 
 #endif /* __CPU_H__ */
@@ -51,6 +51,7 @@
 #include "lwip/tcpip.h"
 #include "lwip/icmp.h"
 #include "lwip/lwip_timers.h"
+#include "lwip/stats.h"
 #include "netif/etharp.h"
 #include "err.h"
 #include "ethernetif.h"
@@ -156,9 +157,15 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
 #else
                 if(1)
 #endif
+		{
+			LINK_STATS_INC(link.xmit);
 			return ERR_OK;
+		}
 		else
+		{
+			LINK_STATS_INC(link.drop);
 			return ERR_BUF;	// return a non-fatal error
+		}
 	}
 	return ERR_OK;
 }
@@ -175,9 +182,15 @@ static err_t low_level_output_mii(struct netif *netif, struct pbuf *p)
 	}
 	if (sg_len) {
 		 if(rltk_mii_send(sg_list, sg_len, p->tot_len) == 0)
+		{
+			LINK_STATS_INC(link.xmit);
 			return ERR_OK;
+		}
 		else
+		{
+			LINK_STATS_INC(link.drop);
 			return ERR_BUF;	// return a non-fatal error
+		}
 	}
 	return ERR_OK;
 }
@@ -222,6 +235,8 @@ void ethernetif_recv(struct netif *netif, int total_len)
 	// Allocate buffer to store received packet
 	p = pbuf_alloc(PBUF_RAW, total_len, PBUF_POOL);
 	if (p == NULL) {
+		LINK_STATS_INC(link.memerr);
+		LINK_STATS_INC(link.drop);
 		printf("\n\rCannot allocate pbuf to receive packet");
 		return;
 	}
@@ -239,9 +254,13 @@ void ethernetif_recv(struct netif *netif, int total_len)
 #elif CONFIG_INIC_HOST
 	rltk_inic_recv(sg_list, sg_len);
 #endif
+	LINK_STATS_INC(link.recv);
+
 	// Pass received packet to the interface
-	if (ERR_OK != netif->input(p, netif))
+	if (ERR_OK != netif->input(p, netif)) {
+		LINK_STATS_INC(link.drop);
 		pbuf_free(p);
+	}
 
 }
 
@@ -257,6 +276,8 @@ void ethernetif_mii_recv(struct netif *netif, int total_len)
 	// Allocate buffer to store received packet
 	p = pbuf_alloc(PBUF_RAW, total_len, PBUF_POOL);
 	if (p == NULL) {
+		LINK_STATS_INC(link.memerr);
+		LINK_STATS_INC(link.drop);
 		printf("\n\rCannot allocate pbuf to receive packet");
 		return;
 	}
@@ -268,9 +289,13 @@ void ethernetif_mii_recv(struct netif *netif, int total_len)
 	}
 	rltk_mii_recv(sg_list, sg_len);
 
+	LINK_STATS_INC(link.recv);
+
 	// Pass received packet to the interface
-	if (ERR_OK != netif->input(p, netif))
+	if (ERR_OK != netif->input(p, netif)) {
+		LINK_STATS_INC(link.drop);
 		pbuf_free(p);
+	}
 
 }
 /**
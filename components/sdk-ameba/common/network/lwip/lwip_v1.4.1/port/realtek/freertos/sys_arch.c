@@ -423,7 +423,7 @@ void sys_mutex_free(sys_mutex_t *mutex)
 /* Lock a mutex*/
 void sys_mutex_lock(sys_mutex_t *mutex)
 {
-	sys_arch_sem_wait(*mutex, 0);
+	while( xSemaphoreTake(*mutex, portMAX_DELAY) != pdTRUE){}
 }
 
 /*-----------------------------------------------------------------------------------*/
@@ -432,6 +432,21 @@ void sys_mutex_unlock(sys_mutex_t *mutex)
 {
 	xSemaphoreGive(*mutex);
 }
+
+/*-----------------------------------------------------------------------------------*/
+int sys_mutex_valid(sys_mutex_t *mutex)
+{
+  if (*mutex == NULL)
+    return 0;
+  else
+    return 1;
+}
+
+/*-----------------------------------------------------------------------------------*/
+void sys_mutex_set_invalid(sys_mutex_t *mutex)
+{
+  *mutex = NULL;
+}
 #endif /*LWIP_COMPAT_MUTEX*/
 
 /*-----------------------------------------------------------------------------------*/
@@ -469,7 +484,7 @@ int result;
 				   NULL);
 	   }
 #else		
-	   result = xTaskCreate( thread, ( signed portCHAR * ) name, stacksize, arg, prio, &CreatedTask );
+	   result = xTaskCreate( thread, ( const char * ) name, stacksize, arg, prio, &CreatedTask );
 #endif
 
 	   // For each task created, store the task handle (pid) in the timers array.
@@ -508,7 +523,7 @@ int result;
    if ( s_nextthread < SYS_THREAD_MAX )
    {
 	   vPortEnterCritical();
-       result = xTaskCreate( thread, ( signed portCHAR * ) name, stacksize, arg, prio, &CreatedTask );
+       result = xTaskCreate( thread, ( const char * ) name, stacksize, arg, prio, &CreatedTask );
 
 	   // For each task created, store the task handle (pid) in the timers array.
 	   // This scheme doesn't allow for threads to be deleted
@@ -83,6 +83,10 @@ struct lwip_sock {
   int err;
   /** counter of how many threads are waiting for this socket using select */
   int select_waiting;
+#if LWIP_SOCKET_POLL
+  /** bitmask of the poll sets watching this socket */
+  u8_t pollsets;
+#endif /* LWIP_SOCKET_POLL */
 };
 
 /** Description for a task waiting in select */
@@ -103,6 +107,37 @@ struct lwip_select_cb {
   sys_sem_t sem;
 };
 
+#if LWIP_SOCKET_POLL
+#if LWIP_SOCKET_POLL_SETS > 8
+#error "LWIP_SOCKET_POLL_SETS must fit into lwip_sock.pollsets"
+#endif
+#if NUM_SOCKETS > 255
+#error "lwip_pollset.ready stores socket indices as u8_t"
+#endif
+
+/** Description of a poll set created by lwip_poll_create */
+struct lwip_pollset {
+  /** 1 while the poll set is allocated */
+  u8_t used;
+  /** a task is blocked in lwip_poll_wait on this set */
+  u8_t waiting;
+  /** don't signal the semaphore twice for one wait */
+  u8_t sem_signalled;
+  /** requested events per socket (LWIP_POLLERR added), 0 if not watched */
+  u8_t interest[NUM_SOCKETS];
+  /** 1 while the socket is in the ready queue */
+  u8_t queued[NUM_SOCKETS];
+  /** FIFO of ready sockets, each socket is queued at most once */
+  u8_t ready[NUM_SOCKETS];
+  /** index of the first entry in ready */
+  u16_t head;
+  /** number of entries in ready */
+  u16_t count;
+  /** semaphore to wake up a task waiting in lwip_poll_wait */
+  sys_sem_t sem;
+};
+#endif /* LWIP_SOCKET_POLL */
+
 /** This struct is used to pass data to the set/getsockopt_internal
  * functions running in tcpip_thread context (only a void* is allowed) */
 struct lwip_setgetsockopt_data {
@@ -132,6 +167,10 @@ static struct lwip_select_cb *select_cb_list;
 /** This counter is increased from lwip_select when the list is chagned
     and checked in event_callback to see if it has changed. */
 static volatile int select_cb_ctr;
+#if LWIP_SOCKET_POLL
+/** The global array of poll sets */
+static struct lwip_pollset pollsets[LWIP_SOCKET_POLL_SETS];
+#endif /* LWIP_SOCKET_POLL */
 
 /** Table to quickly map an lwIP error (err_t) to a socket error
   * by using -err as an index */
@@ -176,6 +215,9 @@ static const int err_to_errno_table[] = {
 
 /* Forward delcaration of some functions */
 static void event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len);
+#if LWIP_SOCKET_POLL
+static void lwip_poll_notify(int s, struct lwip_sock *sock);
+#endif /* LWIP_SOCKET_POLL */
 static void lwip_getsockopt_internal(void *arg);
 static void lwip_setsockopt_internal(void *arg);
 
@@ -266,6 +308,9 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].errevent   = 0;
       sockets[i].err        = 0;
       sockets[i].select_waiting = 0;
+#if LWIP_SOCKET_POLL
+      sockets[i].pollsets   = 0;
+#endif /* LWIP_SOCKET_POLL */
       return i;
     }
     SYS_ARCH_UNPROTECT(lev);
@@ -283,6 +328,9 @@ static void
 free_socket(struct lwip_sock *sock, int is_tcp)
 {
   void *lastdata;
+#if LWIP_SOCKET_POLL
+  int i;
+#endif /* LWIP_SOCKET_POLL */
   SYS_ARCH_DECL_PROTECT(lev);
 
   lastdata         = sock->lastdata;
@@ -292,6 +340,16 @@ free_socket(struct lwip_sock *sock, int is_tcp)
 
   /* Protect socket array */
   SYS_ARCH_PROTECT(lev);
+#if LWIP_SOCKET_POLL
+  /* remove the socket from all poll sets, a queued entry is dropped by
+     lwip_poll_wait since the interest is 0 */
+  for (i = 0; i < LWIP_SOCKET_POLL_SETS; i++) {
+    if (sock->pollsets & (1 << i)) {
+      pollsets[i].interest[sock - sockets] = 0;
+    }
+  }
+  sock->pollsets   = 0;
+#endif /* LWIP_SOCKET_POLL */
   sock->conn       = NULL;
   SYS_ARCH_UNPROTECT(lev);
   /* don't use 'sock' after this line, as another task might have allocated it */
@@ -947,6 +1005,140 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   return (err == ERR_OK ? short_size : -1);
 }
 
+/**
+ * Send a datagram gathered from iovcnt slices without copying them: each
+ * slice becomes a PBUF_REF in one pbuf chain. The slices must stay valid
+ * and unchanged until the call returns; the driver copies the frame out
+ * and etharp copies it if the frame has to wait for ARP.
+ *
+ * A first slice of up to LWIP_IOV_COPY_MAX bytes (an RTP header, say) is
+ * copied into a PBUF_RAM with room for the protocol headers in front, so
+ * the chain takes no more pbufs than lwip_sendto() of one buffer.
+ *
+ * Only for UDP and RAW sockets.
+ */
+int
+lwip_sendtov(int s, const struct lwip_iovec *iov, int iovcnt, int flags,
+       const struct sockaddr *to, socklen_t tolen)
+{
+  struct lwip_sock *sock;
+  struct pbuf *p = NULL, *q;
+  err_t err = ERR_OK;
+  u32_t size = 0;
+  const struct sockaddr_in *to_in;
+  ip_addr_t remote_addr;
+  u16_t remote_port;
+  int i;
+#if !LWIP_TCPIP_CORE_LOCKING
+  struct netbuf buf;
+#endif
+
+  LWIP_UNUSED_ARG(flags);
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(sock->conn->type) != NETCONN_UDP &&
+      sock->conn->type != NETCONN_RAW) {
+    sock_set_errno(sock, err_to_errno(ERR_ARG));
+    return -1;
+  }
+
+  LWIP_ERROR("lwip_sendtov: invalid iovec", (iov != NULL) && (iovcnt > 0) &&
+             (iovcnt <= LWIP_IOV_MAX),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+  LWIP_ERROR("lwip_sendtov: invalid address", (((to == NULL) && (tolen == 0)) ||
+             ((tolen == sizeof(struct sockaddr_in)) &&
+             ((to->sa_family) == AF_INET) && ((((mem_ptr_t)to) % 4) == 0))),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+  to_in = (const struct sockaddr_in *)(void*)to;
+
+  for (i = 0; i < iovcnt; i++) {
+    if (iov[i].iov_len == 0) {
+      continue;
+    }
+    size += iov[i].iov_len;
+    if (size > 0xffff) {
+      err = ERR_VAL;
+      break;
+    }
+    if (p == NULL && iov[i].iov_len <= LWIP_IOV_COPY_MAX) {
+      q = pbuf_alloc(PBUF_TRANSPORT, iov[i].iov_len, PBUF_RAM);
+      if (q != NULL) {
+        MEMCPY(q->payload, iov[i].iov_base, iov[i].iov_len);
+      }
+    } else {
+      q = pbuf_alloc(PBUF_RAW, iov[i].iov_len, PBUF_REF);
+      if (q != NULL) {
+        q->payload = (void*)iov[i].iov_base;
+      }
+    }
+    if (q == NULL) {
+      err = ERR_MEM;
+      break;
+    }
+    if (p == NULL) {
+      p = q;
+    } else {
+      pbuf_cat(p, q);
+    }
+  }
+  if (err != ERR_OK || p == NULL) {
+    if (p != NULL) {
+      pbuf_free(p);
+    }
+    sock_set_errno(sock, err_to_errno(err != ERR_OK ? err : ERR_ARG));
+    return -1;
+  }
+
+  if (to_in != NULL) {
+    inet_addr_to_ipaddr(&remote_addr, &to_in->sin_addr);
+    remote_port = ntohs(to_in->sin_port);
+  } else {
+    ip_addr_set_any(&remote_addr);
+    remote_port = 0;
+  }
+
+#if LWIP_TCPIP_CORE_LOCKING
+  LOCK_TCPIP_CORE();
+  if (to_in == NULL) {
+    ip_addr_copy(remote_addr, sock->conn->pcb.ip->remote_ip);
+#if LWIP_UDP
+    if (NETCONNTYPE_GROUP(sock->conn->type) == NETCONN_UDP) {
+      remote_port = sock->conn->pcb.udp->remote_port;
+    }
+#endif /* LWIP_UDP */
+  }
+  if (sock->conn->type == NETCONN_RAW) {
+#if LWIP_RAW
+    err = sock->conn->last_err = raw_sendto(sock->conn->pcb.raw, p, &remote_addr);
+#else /* LWIP_RAW */
+    err = ERR_ARG;
+#endif /* LWIP_RAW */
+  } else {
+#if LWIP_UDP
+    err = sock->conn->last_err = udp_sendto(sock->conn->pcb.udp, p, &remote_addr, remote_port);
+#else /* LWIP_UDP */
+    err = ERR_ARG;
+#endif /* LWIP_UDP */
+  }
+  UNLOCK_TCPIP_CORE();
+  pbuf_free(p);
+#else /* LWIP_TCPIP_CORE_LOCKING */
+  memset(&buf, 0, sizeof(buf));
+  buf.p = buf.ptr = p;
+  ip_addr_copy(buf.addr, remote_addr);
+  netbuf_fromport(&buf) = remote_port;
+  err = netconn_send(sock->conn, &buf);
+  netbuf_free(&buf);
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+
+  sock_set_errno(sock, err_to_errno(err));
+  return (err == ERR_OK ? (int)size : -1);
+}
+
 int
 lwip_socket(int domain, int type, int protocol)
 {
@@ -1309,6 +1501,12 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
       break;
   }
 
+#if LWIP_SOCKET_POLL
+  if (sock->pollsets != 0) {
+    lwip_poll_notify(s, sock);
+  }
+#endif /* LWIP_SOCKET_POLL */
+
   if (sock->select_waiting == 0) {
     /* noone is waiting for this socket, no need to check select_cb_list */
     SYS_ARCH_UNPROTECT(lev);
@@ -1362,6 +1560,322 @@ again:
   SYS_ARCH_UNPROTECT(lev);
 }
 
+#if LWIP_SOCKET_POLL
+/**
+ * Current readiness of a socket as LWIP_POLL* flags, same conditions as
+ * lwip_selscan. Called with SYS_ARCH protected.
+ */
+static u8_t
+lwip_poll_revents(struct lwip_sock *sock)
+{
+  u8_t revents = 0;
+
+  if ((sock->lastdata != NULL) || (sock->rcvevent > 0)) {
+    revents |= LWIP_POLLIN;
+  }
+  if (sock->sendevent != 0) {
+    revents |= LWIP_POLLOUT;
+  }
+  if (sock->errevent != 0) {
+    revents |= LWIP_POLLERR;
+  }
+  return revents;
+}
+
+/**
+ * Put a socket on the ready queue of a poll set if it is ready for one of
+ * the requested events and not yet queued, and wake up the waiting task.
+ * Called with SYS_ARCH protected.
+ */
+static void
+lwip_poll_enqueue(struct lwip_pollset *ps, int s)
+{
+  if (ps->queued[s] || !(lwip_poll_revents(&sockets[s]) & ps->interest[s])) {
+    return;
+  }
+
+  ps->queued[s] = 1;
+  ps->ready[(ps->head + ps->count) % NUM_SOCKETS] = (u8_t)s;
+  ps->count++;
+
+  if (ps->waiting && !ps->sem_signalled) {
+    ps->sem_signalled = 1;
+    sys_sem_signal(&ps->sem);
+  }
+}
+
+/**
+ * Called from event_callback for a socket watched by at least one poll set.
+ * Called with SYS_ARCH protected.
+ */
+static void
+lwip_poll_notify(int s, struct lwip_sock *sock)
+{
+  int i;
+
+  for (i = 0; i < LWIP_SOCKET_POLL_SETS; i++) {
+    if (sock->pollsets & (1 << i)) {
+      lwip_poll_enqueue(&pollsets[i], s);
+    }
+  }
+}
+
+/**
+ * Map a poll set descriptor to the poll set.
+ *
+ * @param pfd descriptor returned by lwip_poll_create
+ * @return struct lwip_pollset or NULL if not allocated
+ */
+static struct lwip_pollset *
+get_pollset(int pfd)
+{
+  if ((pfd < 0) || (pfd >= LWIP_SOCKET_POLL_SETS) || !pollsets[pfd].used) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("get_pollset(%d): invalid\n", pfd));
+    set_errno(EBADF);
+    return NULL;
+  }
+  return &pollsets[pfd];
+}
+
+/**
+ * Create a poll set. Sockets are added with lwip_poll_ctl and the ready
+ * ones are fetched with lwip_poll_wait. Poll set descriptors are not socket
+ * descriptors and must be released with lwip_poll_close.
+ *
+ * @return poll set descriptor; -1 on error
+ */
+int
+lwip_poll_create(void)
+{
+  struct lwip_pollset *ps;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  for (i = 0; i < LWIP_SOCKET_POLL_SETS; i++) {
+    ps = &pollsets[i];
+    SYS_ARCH_PROTECT(lev);
+    if (!ps->used) {
+      ps->used = 1;
+      SYS_ARCH_UNPROTECT(lev);
+      /* no socket refers to this set yet, so no need to protect */
+      ps->waiting       = 0;
+      ps->sem_signalled = 0;
+      ps->head          = 0;
+      ps->count         = 0;
+      memset(ps->interest, 0, sizeof(ps->interest));
+      memset(ps->queued, 0, sizeof(ps->queued));
+      if (sys_sem_new(&ps->sem, 0) != ERR_OK) {
+        ps->used = 0;
+        set_errno(ENOMEM);
+        return -1;
+      }
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_poll_create() = %d\n", i));
+      return i;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+
+  set_errno(ENFILE);
+  return -1;
+}
+
+/**
+ * Release a poll set. Fails with EBUSY while a task is waiting on it.
+ */
+int
+lwip_poll_close(int pfd)
+{
+  struct lwip_pollset *ps;
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_poll_close(%d)\n", pfd));
+  ps = get_pollset(pfd);
+  if (!ps) {
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (ps->waiting) {
+    SYS_ARCH_UNPROTECT(lev);
+    set_errno(EBUSY);
+    return -1;
+  }
+  for (i = 0; i < NUM_SOCKETS; i++) {
+    sockets[i].pollsets &= ~(1 << pfd);
+  }
+  /* drop what is still queued, nothing can queue more now */
+  ps->head  = 0;
+  ps->count = 0;
+  memset(ps->interest, 0, sizeof(ps->interest));
+  memset(ps->queued, 0, sizeof(ps->queued));
+  /* a lwip_poll_wait that is about to block sees this and fails */
+  ps->used = 0;
+  SYS_ARCH_UNPROTECT(lev);
+
+  sys_sem_free(&ps->sem);
+  return 0;
+}
+
+/**
+ * Add, change or remove the events a poll set watches on a socket.
+ * LWIP_POLLERR is always watched. A socket that is already ready is queued
+ * immediately. Closing a socket removes it from all poll sets.
+ *
+ * @param pfd poll set descriptor
+ * @param op LWIP_POLL_CTL_ADD, LWIP_POLL_CTL_MOD or LWIP_POLL_CTL_DEL
+ * @param s socket
+ * @param events LWIP_POLLIN and/or LWIP_POLLOUT (ignored for DEL)
+ * @return 0 on success; -1 on error
+ */
+int
+lwip_poll_ctl(int pfd, int op, int s, u8_t events)
+{
+  struct lwip_pollset *ps;
+  struct lwip_sock *sock;
+  u8_t bit;
+  int err = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_poll_ctl(%d, %d, %d, 0x%x)\n", pfd, op, s, events));
+  ps = get_pollset(pfd);
+  if (!ps) {
+    return -1;
+  }
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  bit = (u8_t)(1 << pfd);
+  events = (events & (LWIP_POLLIN | LWIP_POLLOUT)) | LWIP_POLLERR;
+
+  SYS_ARCH_PROTECT(lev);
+  switch (op) {
+    case LWIP_POLL_CTL_ADD:
+      if (sock->pollsets & bit) {
+        err = EEXIST;
+        break;
+      }
+      sock->pollsets |= bit;
+      ps->interest[s] = events;
+      lwip_poll_enqueue(ps, s);
+      break;
+    case LWIP_POLL_CTL_MOD:
+      if (!(sock->pollsets & bit)) {
+        err = ENOENT;
+        break;
+      }
+      ps->interest[s] = events;
+      lwip_poll_enqueue(ps, s);
+      break;
+    case LWIP_POLL_CTL_DEL:
+      if (!(sock->pollsets & bit)) {
+        err = ENOENT;
+        break;
+      }
+      /* a queued entry is dropped by lwip_poll_wait */
+      sock->pollsets &= ~bit;
+      ps->interest[s] = 0;
+      break;
+    default:
+      err = EINVAL;
+      break;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (err != 0) {
+    sock_set_errno(sock, err);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Wait until sockets of a poll set are ready. Only the ready queue is
+ * visited, so the cost does not depend on the number of watched sockets.
+ * Readiness is level-triggered: a returned socket stays queued and is
+ * reported again by the next call as long as it is still ready.
+ *
+ * @param pfd poll set descriptor
+ * @param evs array receiving the ready sockets and their LWIP_POLL* events
+ * @param maxevents size of evs
+ * @param timeout in milliseconds, 0 to return immediately, < 0 to wait forever
+ * @return number of entries in evs, 0 on timeout; -1 on error
+ */
+int
+lwip_poll_wait(int pfd, struct lwip_poll_event *evs, int maxevents, int timeout)
+{
+  struct lwip_pollset *ps;
+  int nready = 0;
+  int todo, s;
+  u8_t revents;
+  u32_t waitres;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  ps = get_pollset(pfd);
+  if (!ps) {
+    return -1;
+  }
+  if ((evs == NULL) || (maxevents <= 0)) {
+    set_errno(EINVAL);
+    return -1;
+  }
+
+  for (;;) {
+    SYS_ARCH_PROTECT(lev);
+    /* entries requeued by this loop are not visited twice */
+    todo = ps->count;
+    while ((todo-- > 0) && (nready < maxevents)) {
+      s = ps->ready[ps->head];
+      ps->head = (ps->head + 1) % NUM_SOCKETS;
+      ps->count--;
+      ps->queued[s] = 0;
+
+      revents = lwip_poll_revents(&sockets[s]) & ps->interest[s];
+      if (revents != 0) {
+        evs[nready].fd     = s;
+        evs[nready].events = revents;
+        nready++;
+        /* requeue at the tail while it stays ready */
+        lwip_poll_enqueue(ps, s);
+      }
+    }
+
+    if ((nready > 0) || (timeout == 0)) {
+      SYS_ARCH_UNPROTECT(lev);
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_poll_wait(%d): nready=%d\n", pfd, nready));
+      return nready;
+    }
+    if (!ps->used) {
+      /* closed by another task */
+      SYS_ARCH_UNPROTECT(lev);
+      set_errno(EBADF);
+      return -1;
+    }
+
+    ps->waiting       = 1;
+    ps->sem_signalled = 0;
+    SYS_ARCH_UNPROTECT(lev);
+
+    waitres = sys_arch_sem_wait(&ps->sem, (timeout < 0) ? 0 : (u32_t)timeout);
+
+    SYS_ARCH_PROTECT(lev);
+    ps->waiting = 0;
+    SYS_ARCH_UNPROTECT(lev);
+
+    if (waitres == SYS_ARCH_TIMEOUT) {
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_poll_wait(%d): timeout expired\n", pfd));
+      return 0;
+    }
+    if (timeout > 0) {
+      /* one more non-blocking pass once the time is used up */
+      timeout = (waitres < (u32_t)timeout) ? (timeout - (int)waitres) : 0;
+    }
+  }
+}
+#endif /* LWIP_SOCKET_POLL */
+
 /**
  * Unimplemented: Close one end of a full-duplex connection.
  * Currently, the full connection is closed.
@@ -48,6 +48,7 @@
 #include "lwip/init.h"
 #include "netif/etharp.h"
 #include "netif/ppp_oe.h"
+#include "lwip/tcp_impl.h"
 
 #include "osdep_service.h"
 
@@ -56,12 +57,64 @@ static tcpip_init_done_fn tcpip_init_done;
 static void *tcpip_init_done_arg;
 static sys_mbox_t mbox;
 
+#if TCPIP_INPUT_BATCH
+/** Packets queued by tcpip_input() for the tcpip thread */
+static struct tcpip_msg *inpkt_head, *inpkt_tail;
+/** 1 while a drain message is on its way to the tcpip thread */
+static u8_t inpkt_posted;
+static void tcpip_inpkt_drain(void *arg);
+static struct tcpip_msg inpkt_drain_msg;
+#endif /* TCPIP_INPUT_BATCH */
+
 #if LWIP_TCPIP_CORE_LOCKING
 /** The global semaphore to lock the stack. */
 sys_mutex_t lock_tcpip_core;
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 
 
+#if TCPIP_INPUT_BATCH
+/**
+ * Process all packets queued by tcpip_input(). Runs in the tcpip thread,
+ * either for the drain message or after any other message while packets
+ * are waiting (the drain message may not have fit into the mbox).
+ *
+ * @param arg unused argument
+ */
+static void
+tcpip_inpkt_drain(void *arg)
+{
+  struct tcpip_msg *msg, *next;
+  SYS_ARCH_DECL_PROTECT(lev);
+  LWIP_UNUSED_ARG(arg);
+
+  SYS_ARCH_PROTECT(lev);
+  msg = inpkt_head;
+  inpkt_head = inpkt_tail = NULL;
+  inpkt_posted = 0;
+  SYS_ARCH_UNPROTECT(lev);
+
+#if LWIP_TCP
+  tcp_ack_defer = 1;
+#endif /* LWIP_TCP */
+  for (; msg != NULL; msg = next) {
+    next = msg->msg.inp.next;
+    LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: PACKET %p\n", (void *)msg));
+#if LWIP_ETHERNET
+    if (msg->msg.inp.netif->flags & (NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET)) {
+      ethernet_input(msg->msg.inp.p, msg->msg.inp.netif);
+    } else
+#endif /* LWIP_ETHERNET */
+    {
+      ip_input(msg->msg.inp.p, msg->msg.inp.netif);
+    }
+    memp_free(MEMP_TCPIP_MSG_INPKT, msg);
+  }
+#if LWIP_TCP
+  tcp_ack_flush();
+#endif /* LWIP_TCP */
+}
+#endif /* TCPIP_INPUT_BATCH */
+
 /**
  * The main lwIP thread. This thread has exclusive access to lwIP core functions
  * (unless access to them is not locked). Other threads communicate with this
@@ -148,6 +201,11 @@ tcpip_thread(void *arg)
       LWIP_ASSERT("tcpip_thread: invalid message", 0);
       break;
     }
+#if TCPIP_INPUT_BATCH
+    if (inpkt_head != NULL) {
+      tcpip_inpkt_drain(NULL);
+    }
+#endif /* TCPIP_INPUT_BATCH */
   }
 }
 
@@ -178,6 +236,10 @@ tcpip_input(struct pbuf *p, struct netif *inp)
   return ret;
 #else /* LWIP_TCPIP_CORE_LOCKING_INPUT */
   struct tcpip_msg *msg;
+#if TCPIP_INPUT_BATCH
+  u8_t post;
+  SYS_ARCH_DECL_PROTECT(lev);
+#endif /* TCPIP_INPUT_BATCH */
 
   if (!sys_mbox_valid(&mbox)) {
     return ERR_VAL;
@@ -190,11 +252,34 @@ tcpip_input(struct pbuf *p, struct netif *inp)
   msg->type = TCPIP_MSG_INPKT;
   msg->msg.inp.p = p;
   msg->msg.inp.netif = inp;
+#if TCPIP_INPUT_BATCH
+  msg->msg.inp.next = NULL;
+  SYS_ARCH_PROTECT(lev);
+  if (inpkt_tail != NULL) {
+    inpkt_tail->msg.inp.next = msg;
+  } else {
+    inpkt_head = msg;
+  }
+  inpkt_tail = msg;
+  post = !inpkt_posted;
+  inpkt_posted = 1;
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (post && (sys_mbox_trypost(&mbox, &inpkt_drain_msg) != ERR_OK)) {
+    /* The mbox is full, so the tcpip thread is busy and drains the queue
+       after its next message. Let the next packet try to post again. */
+    SYS_ARCH_PROTECT(lev);
+    inpkt_posted = 0;
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  return ERR_OK;
+#else /* TCPIP_INPUT_BATCH */
   if (sys_mbox_trypost(&mbox, msg) != ERR_OK) {
     memp_free(MEMP_TCPIP_MSG_INPKT, msg);
     return ERR_MEM;
   }
   return ERR_OK;
+#endif /* TCPIP_INPUT_BATCH */
 #endif /* LWIP_TCPIP_CORE_LOCKING_INPUT */
 }
 
@@ -472,6 +557,11 @@ tcpip_init(tcpip_init_done_fn initfunc, void *arg)
     LWIP_ASSERT("failed to create lock_tcpip_core", 0);
   }
 #endif /* LWIP_TCPIP_CORE_LOCKING */
+#if TCPIP_INPUT_BATCH
+  inpkt_drain_msg.type = TCPIP_MSG_CALLBACK_STATIC;
+  inpkt_drain_msg.msg.cb.function = tcpip_inpkt_drain;
+  inpkt_drain_msg.msg.cb.ctx = NULL;
+#endif /* TCPIP_INPUT_BATCH */
 #if CONFIG_USE_TCM_HEAP
 	sys_thread_new_tcm(TCPIP_THREAD_NAME, tcpip_thread, NULL, TCPIP_THREAD_STACKSIZE, TCPIP_THREAD_PRIO);
 #else
@@ -79,6 +79,7 @@
 #include "lwip/sys.h"
 #include "lwip/dhcp.h"
 #include "lwip/autoip.h"
+#include "lwip/igmp.h"
 #include "lwip/dns.h"
 #include "netif/etharp.h"
 
@@ -648,6 +649,27 @@ void dhcp_cleanup(struct netif *netif)
  */
 err_t
 dhcp_start(struct netif *netif)
+{
+  return dhcp_start_reboot(netif, NULL);
+}
+
+/**
+ * Start DHCP negotiation for a network interface that held a lease on
+ * 'addr' before, e.g. before a reset (INIT-REBOOT, RFC 2131 3.2).
+ *
+ * The client asks the server to confirm the address with a REQUEST
+ * instead of going through DISCOVER/OFFER. A NAK, or no answer within
+ * REBOOT_TRIES attempts, falls back to DISCOVER.
+ *
+ * @param netif The lwIP network interface
+ * @param addr The address of the previous lease, NULL or IP_ADDR_ANY to
+ *             start with DISCOVER like dhcp_start()
+ * @return lwIP error code
+ * - ERR_OK - No error
+ * - ERR_MEM - Out of memory
+ */
+err_t
+dhcp_start_reboot(struct netif *netif, ip_addr_t *addr)
 {
   struct dhcp *dhcp;
   err_t result = ERR_OK;
@@ -716,7 +738,12 @@ dhcp_start(struct netif *netif)
   LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE, ("dhcp_start(): starting DHCP configuration\n"));
   /* (re)start the DHCP negotiation */
   dhcp->seconds_elapsed = sys_now();  
-  result = dhcp_discover(netif);
+  if ((addr != NULL) && !ip_addr_isany(addr)) {
+    ip_addr_copy(dhcp->offered_ip_addr, *addr);
+    result = dhcp_reboot(netif);
+  } else {
+    result = dhcp_discover(netif);
+  }
   if (result != ERR_OK) {
     /* free resources allocated above */
     dhcp_stop(netif);
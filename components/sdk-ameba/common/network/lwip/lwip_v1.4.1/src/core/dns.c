@@ -176,6 +176,11 @@ static u16_t dns_txid;
 #define DNS_STATE_NEW               1
 #define DNS_STATE_ASKING            2
 #define DNS_STATE_DONE              3
+#define DNS_STATE_NEGATIVE          4
+
+/* DNS table entry flags */
+#define DNS_ENTRY_PREFETCHING       0x01 /* refresh query running, old address still served */
+#define DNS_ENTRY_PREFETCHED        0x02 /* refresh already started for this answer */
 
 #ifdef PACK_STRUCT_USE_INCLUDES
 #  include "arch/bpstruct.h"
@@ -231,6 +236,7 @@ struct dns_table_entry {
   u8_t  tmr;
   u8_t  retries;
   u8_t  seqno;
+  u8_t  flags;
 #if ((LWIP_DNS_SECURE & LWIP_DNS_SECURE_RAND_SRC_PORT) != 0)
   u8_t pcb_idx;
 #endif
@@ -296,6 +302,10 @@ static ip_addr_t              dns_servers[DNS_MAX_SERVERS];
 /** Contiguous buffer for processing responses */
 static u8_t                   dns_payload_buffer[LWIP_MEM_ALIGN_BUFFER(DNS_MSG_SIZE)];
 static u8_t*                  dns_payload;
+#if DNS_PINNED_HOSTS
+/** Host names registered with dns_pin */
+static const char*            dns_pinned[DNS_PINNED_HOSTS];
+#endif /* DNS_PINNED_HOSTS */
 
 #ifndef LWIP_DNS_STRICMP
 #define LWIP_DNS_STRICMP(str1, str2) dns_stricmp(str1, str2)
@@ -555,42 +565,125 @@ dns_local_addhost(const char *hostname, const ip_addr_t *addr)
  * for a hostname.
  *
  * @param name the hostname to look up
- * @return the hostname's IP address, as u32_t (instead of ip_addr_t to
- *         better check for failure: != IPADDR_NONE) or IPADDR_NONE if the hostname
- *         was not found in the cached dns_table.
+ * @param addr pointer to a ip_addr_t where to store the address if found
+ * @return ERR_OK if found, ERR_VAL if the hostname is negatively cached
+ *         (it does not exist) or ERR_ARG if it was not found in the cached
+ *         dns_table.
  */
-static u32_t
-dns_lookup(const char *name)
+static err_t
+dns_lookup(const char *name, ip_addr_t *addr)
 {
   u8_t i;
 #if DNS_LOCAL_HOSTLIST || defined(DNS_LOOKUP_LOCAL_EXTERN)
-  u32_t addr;
+  u32_t laddr;
 #endif /* DNS_LOCAL_HOSTLIST || defined(DNS_LOOKUP_LOCAL_EXTERN) */
 #if DNS_LOCAL_HOSTLIST
-  if ((addr = dns_lookup_local(name)) != IPADDR_NONE) {
-    return addr;
+  if ((laddr = dns_lookup_local(name)) != IPADDR_NONE) {
+    ip4_addr_set_u32(addr, laddr);
+    return ERR_OK;
   }
 #endif /* DNS_LOCAL_HOSTLIST */
 #ifdef DNS_LOOKUP_LOCAL_EXTERN
-  if((addr = DNS_LOOKUP_LOCAL_EXTERN(name)) != IPADDR_NONE) {
-    return addr;
+  if((laddr = DNS_LOOKUP_LOCAL_EXTERN(name)) != IPADDR_NONE) {
+    ip4_addr_set_u32(addr, laddr);
+    return ERR_OK;
   }
 #endif /* DNS_LOOKUP_LOCAL_EXTERN */
 
-  /* Walk through name list, return entry if found. If not, return NULL. */
+  /* Walk through name list, return entry if found. A completed entry being
+     refreshed is still valid. */
   for (i = 0; i < DNS_TABLE_SIZE; ++i) {
-    if ((dns_table[i].state == DNS_STATE_DONE) &&
+    if (((dns_table[i].state == DNS_STATE_DONE) ||
+         ((dns_table[i].flags & DNS_ENTRY_PREFETCHING) != 0)) &&
         (LWIP_DNS_STRICMP(name, dns_table[i].name) == 0)) {
       LWIP_DEBUGF(DNS_DEBUG, ("dns_lookup: \"%s\": found = ", name));
       ip_addr_debug_print(DNS_DEBUG, &(dns_table[i].ipaddr));
       LWIP_DEBUGF(DNS_DEBUG, ("\n"));
-      return ip4_addr_get_u32(&dns_table[i].ipaddr);
+      /* the least recently used entry is recycled first */
+      dns_table[i].seqno = dns_seqno++;
+      ip_addr_copy(*addr, dns_table[i].ipaddr);
+      return ERR_OK;
     }
+#if DNS_NEGATIVE_TTL
+    if ((dns_table[i].state == DNS_STATE_NEGATIVE) &&
+        (LWIP_DNS_STRICMP(name, dns_table[i].name) == 0)) {
+      LWIP_DEBUGF(DNS_DEBUG, ("dns_lookup: \"%s\": negative\n", name));
+      return ERR_VAL;
+    }
+#endif /* DNS_NEGATIVE_TTL */
   }
 
-  return IPADDR_NONE;
+  return ERR_ARG;
+}
+
+#if DNS_PINNED_HOSTS
+/**
+ * Check whether a hostname has been registered with dns_pin.
+ *
+ * @param name the hostname to check
+ * @return 1 if pinned, 0 if not
+ */
+static u8_t
+dns_is_pinned(const char *name)
+{
+  u8_t i;
+
+  for (i = 0; i < DNS_PINNED_HOSTS; i++) {
+    if ((dns_pinned[i] != NULL) && (LWIP_DNS_STRICMP(name, dns_pinned[i]) == 0)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Pin a hostname: its cached address is refreshed before the TTL expires
+ * and its entry is recycled last when the dns_table is full. The hostname
+ * is not resolved here, use dns_gethostbyname for that.
+ *
+ * @param hostname the hostname to pin, must stay valid until dns_unpin
+ * @return ERR_OK or ERR_MEM if DNS_PINNED_HOSTS hostnames are already pinned
+ */
+err_t
+dns_pin(const char *hostname)
+{
+  u8_t i, free_idx = DNS_PINNED_HOSTS;
+
+  for (i = 0; i < DNS_PINNED_HOSTS; i++) {
+    if (dns_pinned[i] == NULL) {
+      if (free_idx == DNS_PINNED_HOSTS) {
+        free_idx = i;
+      }
+    } else if (LWIP_DNS_STRICMP(hostname, dns_pinned[i]) == 0) {
+      return ERR_OK;
+    }
+  }
+  if (free_idx == DNS_PINNED_HOSTS) {
+    return ERR_MEM;
+  }
+  dns_pinned[free_idx] = hostname;
+  return ERR_OK;
 }
 
+/**
+ * Remove a hostname registered with dns_pin. Its cached address is kept
+ * until the TTL expires.
+ *
+ * @param hostname the hostname to unpin
+ */
+void
+dns_unpin(const char *hostname)
+{
+  u8_t i;
+
+  for (i = 0; i < DNS_PINNED_HOSTS; i++) {
+    if ((dns_pinned[i] != NULL) && (LWIP_DNS_STRICMP(hostname, dns_pinned[i]) == 0)) {
+      dns_pinned[i] = NULL;
+    }
+  }
+}
+#endif /* DNS_PINNED_HOSTS */
+
 /**
  * Compare the "dotted" name "query" with the encoded name "response"
  * to make sure an answer from the DNS server matches the current dns_table
@@ -934,6 +1027,12 @@ dns_check_entry(u8_t i)
             LWIP_DEBUGF(DNS_DEBUG, ("dns_check_entry: \"%s\": timeout\n", entry->name));
             /* call specified callback function if provided */
             dns_call_found(i, NULL);
+            if ((entry->flags & DNS_ENTRY_PREFETCHING) != 0) {
+              /* refresh failed: keep serving the old address until its TTL runs out */
+              entry->flags &= ~DNS_ENTRY_PREFETCHING;
+              entry->state = DNS_STATE_DONE;
+              break;
+            }
             /* flush this entry */
             entry->state = DNS_STATE_UNUSED;
             break;
@@ -952,12 +1051,34 @@ dns_check_entry(u8_t i)
       }
       break;
     case DNS_STATE_DONE:
+#if DNS_NEGATIVE_TTL
+    case DNS_STATE_NEGATIVE:
+#endif /* DNS_NEGATIVE_TTL */
       /* if the time to live is nul */
       if ((entry->ttl == 0) || (--entry->ttl == 0)) {
         LWIP_DEBUGF(DNS_DEBUG, ("dns_check_entry: \"%s\": flush\n", entry->name));
         /* flush this entry, there cannot be any related pending entries in this state */
         entry->state = DNS_STATE_UNUSED;
+        break;
+      }
+#if DNS_PINNED_HOSTS
+      /* refresh pinned hosts before the answer expires, the entry keeps
+         being served from dns_lookup while asking */
+      if ((entry->state == DNS_STATE_DONE) && (entry->ttl <= DNS_PREFETCH_TIME) &&
+          ((entry->flags & DNS_ENTRY_PREFETCHED) == 0) && dns_is_pinned(entry->name)) {
+#if ((LWIP_DNS_SECURE & LWIP_DNS_SECURE_RAND_SRC_PORT) != 0)
+        entry->pcb_idx = dns_alloc_pcb();
+        if (entry->pcb_idx >= DNS_MAX_SOURCE_PORTS) {
+          /* no UDP pcb now, try again next time */
+          break;
+        }
+#endif
+        LWIP_DEBUGF(DNS_DEBUG, ("dns_check_entry: \"%s\": prefetch\n", entry->name));
+        entry->flags |= DNS_ENTRY_PREFETCHING | DNS_ENTRY_PREFETCHED;
+        entry->state = DNS_STATE_NEW;
+        dns_check_entry(i);
       }
+#endif /* DNS_PINNED_HOSTS */
       break;
     case DNS_STATE_UNUSED:
       /* nothing to do */
@@ -1099,6 +1220,9 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
               entry->retries = 0;
               entry->state = DNS_STATE_ASKING;
               goto memerr; /* ignore this packet */
+            } else if (dns_err == DNS_FLAG2_ERR_NAME) {
+              /* the name does not exist */
+              goto negativeentry;
             } else {
               /* call callback to indicate error, clean up memory and return */
               goto responseerr;                        
@@ -1123,6 +1247,13 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
             LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": response = ", entry->name));
             ip_addr_debug_print(DNS_DEBUG, (&(entry->ipaddr)));
             LWIP_DEBUGF(DNS_DEBUG, ("\n"));
+            /* a new answer may be refreshed again */
+            entry->flags = 0;
+#if DNS_PINNED_HOSTS && defined(DNS_PINNED_UPDATE)
+            if (dns_is_pinned(entry->name)) {
+              DNS_PINNED_UPDATE(entry->name, &entry->ipaddr, entry->ttl);
+            }
+#endif /* DNS_PINNED_HOSTS && defined(DNS_PINNED_UPDATE) */
             /* call specified callback function if provided */
             dns_call_found(entry_idx, &entry->ipaddr);
             if (entry->ttl == 0) {
@@ -1139,9 +1270,9 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
           }
           --nanswers;
         }
-        LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": error in response\n", entry->name));
+        LWIP_DEBUGF(DNS_DEBUG, ("dns_recv: \"%s\": no A record in response\n", entry->name));
         /* call callback to indicate error, clean up memory and return */
-        goto responseerr;
+        goto negativeentry;
       }
     }
   }
@@ -1149,9 +1280,24 @@ dns_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t
   /* deallocate memory and return */
   goto memerr;
 
+negativeentry:
+#if DNS_NEGATIVE_TTL
+  /* call callback to indicate error and remember that the name has no address */
+  dns_call_found(entry_idx, NULL);
+  dns_table[entry_idx].state = DNS_STATE_NEGATIVE;
+  dns_table[entry_idx].ttl   = DNS_NEGATIVE_TTL;
+  dns_table[entry_idx].flags = 0;
+  goto memerr;
+#endif /* DNS_NEGATIVE_TTL */
 responseerr:
   /* ERROR: call specified callback function with NULL as name to indicate an error */
   dns_call_found(entry_idx, NULL);
+  if ((dns_table[entry_idx].flags & DNS_ENTRY_PREFETCHING) != 0) {
+    /* refresh failed: keep serving the old address until its TTL runs out */
+    dns_table[entry_idx].flags &= ~DNS_ENTRY_PREFETCHING;
+    dns_table[entry_idx].state = DNS_STATE_DONE;
+    goto memerr;
+  }
 flushentry:
   /* flush this entry */
   dns_table[entry_idx].state = DNS_STATE_UNUSED;
@@ -1162,6 +1308,129 @@ memerr:
   return;
 }
 
+/**
+ * Find a dns_table entry for a new hostname: an unused entry, or else the
+ * least recently used completed (or negative) one. Entries of pinned
+ * hostnames are only recycled if no other entry can be used.
+ *
+ * @return index of the entry or DNS_TABLE_SIZE if the table is full
+ */
+static u8_t
+dns_alloc_entry(void)
+{
+  u8_t i, age;
+  u8_t lseq = 0, lseqi = DNS_TABLE_SIZE;
+#if DNS_PINNED_HOSTS
+  u8_t pseq = 0, pseqi = DNS_TABLE_SIZE;
+#endif /* DNS_PINNED_HOSTS */
+  struct dns_table_entry *entry;
+
+  for (i = 0; i < DNS_TABLE_SIZE; ++i) {
+    entry = &dns_table[i];
+    /* is it an unused entry ? */
+    if (entry->state == DNS_STATE_UNUSED) {
+      return i;
+    }
+    /* check if this is the least recently used completed entry */
+    if ((entry->state == DNS_STATE_DONE) || (entry->state == DNS_STATE_NEGATIVE)) {
+      age = (u8_t)(dns_seqno - entry->seqno);
+#if DNS_PINNED_HOSTS
+      if (dns_is_pinned(entry->name)) {
+        if (age >= pseq) {
+          pseq = age;
+          pseqi = i;
+        }
+        continue;
+      }
+#endif /* DNS_PINNED_HOSTS */
+      if (age >= lseq) {
+        lseq = age;
+        lseqi = i;
+      }
+    }
+  }
+
+#if DNS_PINNED_HOSTS
+  if (lseqi == DNS_TABLE_SIZE) {
+    return pseqi;
+  }
+#endif /* DNS_PINNED_HOSTS */
+  return lseqi;
+}
+
+/**
+ * Add an address to the dns_table without asking a server, e.g. to restore
+ * answers saved by DNS_PINNED_UPDATE after a reboot. A pinned hostname added
+ * with a TTL <= DNS_PREFETCH_TIME is queried again on the next dns_tmr while
+ * this address is served.
+ *
+ * @param hostname the hostname
+ * @param addr IP address of the hostname
+ * @param ttl time to live in seconds (> 0)
+ * @return ERR_OK, ERR_INPROGRESS if a query for hostname is running, ERR_ARG
+ *         on invalid arguments or ERR_MEM if the table is full
+ */
+err_t
+dns_cache_add(const char *hostname, const ip_addr_t *addr, u32_t ttl)
+{
+  u8_t i;
+  size_t namelen;
+  struct dns_table_entry *entry;
+
+  if ((hostname == NULL) || (addr == NULL) || (ttl == 0)) {
+    return ERR_ARG;
+  }
+  namelen = strlen(hostname);
+  if ((namelen == 0) || (namelen >= DNS_MAX_NAME_LENGTH)) {
+    return ERR_ARG;
+  }
+
+  /* replace an entry for the same hostname */
+  for (i = 0; i < DNS_TABLE_SIZE; ++i) {
+    if ((dns_table[i].state != DNS_STATE_UNUSED) &&
+        (LWIP_DNS_STRICMP(hostname, dns_table[i].name) == 0)) {
+      if ((dns_table[i].state != DNS_STATE_DONE) && (dns_table[i].state != DNS_STATE_NEGATIVE)) {
+        return ERR_INPROGRESS;
+      }
+      break;
+    }
+  }
+  if (i == DNS_TABLE_SIZE) {
+    i = dns_alloc_entry();
+    if (i == DNS_TABLE_SIZE) {
+      return ERR_MEM;
+    }
+  }
+
+  LWIP_DEBUGF(DNS_DEBUG, ("dns_cache_add: \"%s\": use DNS entry %"U16_F"\n", hostname, (u16_t)(i)));
+  entry = &dns_table[i];
+  entry->state = DNS_STATE_DONE;
+  entry->seqno = dns_seqno++;
+  entry->flags = 0;
+  entry->ttl   = LWIP_MIN(ttl, DNS_MAX_TTL);
+  ip_addr_copy(entry->ipaddr, *addr);
+  MEMCPY(entry->name, hostname, namelen);
+  entry->name[namelen] = 0;
+  return ERR_OK;
+}
+
+/**
+ * Let every cached answer, positive or negative, expire on the next
+ * dns_tmr, e.g. after moving to another network. Queries in progress are
+ * not affected.
+ */
+void
+dns_reset_ttl(void)
+{
+  u8_t i;
+
+  for (i = 0; i < DNS_TABLE_SIZE; ++i) {
+    if ((dns_table[i].state == DNS_STATE_DONE) || (dns_table[i].state == DNS_STATE_NEGATIVE)) {
+      dns_table[i].ttl = 0;
+    }
+  }
+}
+
 /**
  * Queues a new hostname to resolve and sends out a DNS query for that hostname
  *
@@ -1176,7 +1445,6 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
             void *callback_arg)
 {
   u8_t i;
-  u8_t lseq, lseqi;
   struct dns_table_entry *entry = NULL;
   size_t namelen;
   struct dns_req_entry* req;
@@ -1202,36 +1470,14 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
   /* no duplicate entries found */
 #endif
 
-  /* search an unused entry, or the oldest one */
-  lseq = 0;
-  lseqi = DNS_TABLE_SIZE;
-  for (i = 0; i < DNS_TABLE_SIZE; ++i) {
-    entry = &dns_table[i];
-    /* is it an unused entry ? */
-    if (entry->state == DNS_STATE_UNUSED) {
-      break;
-    }
-    /* check if this is the oldest completed entry */
-    if (entry->state == DNS_STATE_DONE) {
-      if ((dns_seqno - entry->seqno) > lseq) {
-        lseq = dns_seqno - entry->seqno;
-        lseqi = i;
-      }
-    }
-  }
-
-  /* if we don't have found an unused entry, use the oldest completed one */
+  /* search an unused entry, or the least recently used one */
+  i = dns_alloc_entry();
   if (i == DNS_TABLE_SIZE) {
-    if ((lseqi >= DNS_TABLE_SIZE) || (dns_table[lseqi].state != DNS_STATE_DONE)) {
-      /* no entry can be used now, table is full */
-      LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": DNS entries table is full\n", name));
-      return ERR_MEM;
-    } else {
-      /* use the oldest completed one */
-      i = lseqi;
-      entry = &dns_table[i];
-    }
+    /* no entry can be used now, table is full */
+    LWIP_DEBUGF(DNS_DEBUG, ("dns_enqueue: \"%s\": DNS entries table is full\n", name));
+    return ERR_MEM;
   }
+  entry = &dns_table[i];
 
 #if ((LWIP_DNS_SECURE & LWIP_DNS_SECURE_NO_MULTIPLE_OUTSTANDING) != 0)
   /* find a free request entry */
@@ -1259,6 +1505,7 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
   /* fill the entry */
   entry->state = DNS_STATE_NEW;
   entry->seqno = dns_seqno;
+  entry->flags = 0;
   req->found = found;
   req->arg   = callback_arg;
   namelen = LWIP_MIN(hostnamelen, DNS_MAX_NAME_LENGTH-1);
@@ -1296,6 +1543,7 @@ dns_enqueue(const char *name, size_t hostnamelen, dns_found_callback found,
  * - ERR_INPROGRESS enqueue a request to be sent to the DNS server
  *   for resolution if no errors are present.
  * - ERR_ARG: dns client not initialized or invalid hostname
+ * - ERR_VAL: the hostname is known not to exist (DNS_NEGATIVE_TTL)
  *
  * @param hostname the hostname that is to be queried
  * @param addr pointer to a ip_addr_t where to store the address if it is already
@@ -1311,6 +1559,7 @@ dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback foun
 {
   u32_t ipaddr;
   size_t hostnamelen;
+  err_t err;
   /* not initialized or no valid server yet, or invalid addr pointer
    * or invalid hostname or invalid hostname length */
   if ((addr == NULL) ||
@@ -1338,15 +1587,17 @@ dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback foun
 
   /* host name already in octet notation? set ip addr and return ERR_OK */
   ipaddr = ipaddr_addr(hostname);
-  if (ipaddr == IPADDR_NONE) {
-    /* already have this address cached? */
-    ipaddr = dns_lookup(hostname);
-  }
   if (ipaddr != IPADDR_NONE) {
     ip4_addr_set_u32(addr, ipaddr);
     return ERR_OK;
   }
 
+  /* already have this address (or its absence) cached? */
+  err = dns_lookup(hostname, addr);
+  if (err != ERR_ARG) {
+    return err;
+  }
+
   /* queue query with specified callback */
   return dns_enqueue(hostname, hostnamelen, found, callback_arg);
 }
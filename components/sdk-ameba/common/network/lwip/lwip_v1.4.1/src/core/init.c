@@ -112,8 +112,20 @@
   #error "MEMP_NUM_REASSDATA > IP_REASS_MAX_PBUFS doesn't make sense since each struct ip_reassdata must hold 2 pbufs at least!"
 #endif
 #endif /* !MEMP_MEM_MALLOC */
-#if (LWIP_TCP && (TCP_WND > 0xffff))
-  #error "If you want to use TCP, TCP_WND must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
+#if (LWIP_TCP && !LWIP_WND_SCALE && (TCP_WND > 0xffff))
+  #error "If you want to use TCP, TCP_WND must fit in an u16_t, so, you have to reduce it in your lwipopts.h (or enable LWIP_WND_SCALE)"
+#endif
+#if (LWIP_TCP && LWIP_WND_SCALE && ((TCP_RCV_SCALE > 14) || (TCP_WND > (0xffffUL << TCP_RCV_SCALE))))
+  #error "If you want to use TCP window scaling, TCP_RCV_SCALE must be <= 14 and TCP_WND must fit in 0xffff << TCP_RCV_SCALE"
+#endif
+#if (LWIP_TCP && LWIP_TCP_SACK && !TCP_QUEUE_OOSEQ)
+  #error "LWIP_TCP_SACK needs TCP_QUEUE_OOSEQ to report out-of-sequence data to the peer"
+#endif
+#if (LWIP_TIMERS_WHEEL && ((LWIP_TIMERS_WHEEL_BITS * LWIP_TIMERS_WHEEL_LEVELS) > 30))
+  #error "LWIP_TIMERS_WHEEL_BITS * LWIP_TIMERS_WHEEL_LEVELS must not exceed 30, reduce it in your lwipopts.h"
+#endif
+#if (LWIP_TIMERS_WHEEL && (LWIP_TIMERS_HASH_SIZE & (LWIP_TIMERS_HASH_SIZE - 1)))
+  #error "LWIP_TIMERS_HASH_SIZE must be a power of 2"
 #endif
 #if (LWIP_TCP && (TCP_SND_QUEUELEN > 0xffff))
   #error "If you want to use TCP, TCP_SND_QUEUELEN must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
@@ -178,6 +190,15 @@
 #if LWIP_TCPIP_CORE_LOCKING_INPUT && !LWIP_TCPIP_CORE_LOCKING
   #error "When using LWIP_TCPIP_CORE_LOCKING_INPUT, LWIP_TCPIP_CORE_LOCKING must be enabled, too"
 #endif
+#if TCPIP_INPUT_BATCH && LWIP_TCPIP_CORE_LOCKING_INPUT
+  #error "TCPIP_INPUT_BATCH has no effect with LWIP_TCPIP_CORE_LOCKING_INPUT, disable one of them in your lwipopts.h"
+#endif
+#if MEMP_ELASTIC && (MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK)
+  #error "MEMP_ELASTIC works on the static pools only, disable MEMP_MEM_MALLOC and MEMP_OVERFLOW_CHECK in your lwipopts.h"
+#endif
+#if MEMP_ELASTIC && (!defined(MEMP_ELASTIC_ALLOC) || !defined(MEMP_ELASTIC_FREE))
+  #error "MEMP_ELASTIC needs MEMP_ELASTIC_ALLOC() and MEMP_ELASTIC_FREE() in your lwipopts.h"
+#endif
 #if LWIP_TCP && LWIP_NETIF_TX_SINGLE_PBUF && !TCP_OVERSIZE
   #error "LWIP_NETIF_TX_SINGLE_PBUF needs TCP_OVERSIZE enabled to create single-pbuf TCP packets"
 #endif
@@ -247,7 +247,9 @@ icmp_input(struct pbuf *p, struct netif *inp)
     break;
 #endif	
   default:
-NotSupport:  
+#if LWIP_MTU_ADJUST
+NotSupport:
+#endif
     LWIP_DEBUGF(ICMP_DEBUG, ("icmp_input: ICMP type %"S16_F" code %"S16_F" not supported.\n", 
                 (s16_t)type, (s16_t)code));
     ICMP_STATS_INC(icmp.proterr);
@@ -52,7 +52,7 @@
  * #define LWIP_CHKSUM <your_checksum_routine> 
  *
  * Or you can select from the implementations below by defining
- * LWIP_CHKSUM_ALGORITHM to 1, 2 or 3.
+ * LWIP_CHKSUM_ALGORITHM to 1, 2, 3 or 4.
  */
 
 #ifndef LWIP_CHKSUM
@@ -256,6 +256,98 @@ lwip_standard_chksum(void *dataptr, int len)
 }
 #endif
 
+#if (LWIP_CHKSUM_ALGORITHM == 4) || (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+/** Add both 16-bit halves of a 32-bit word to the sum. The sum cannot
+ * overflow for len < 64k, and the halves are in the same byte order as
+ * 16-bit loads (ARM: UXTAH + ADD with LSR). */
+#define CHKSUM_ADD_WORD(sum, w) do { \
+  (sum) += (w) & 0xffffUL; \
+  (sum) += (w) >> 16; \
+} while (0)
+#endif
+
+#if (LWIP_CHKSUM_ALGORITHM == 4) /* Alternative version #4 */
+/**
+ * Word-at-a-time checksum for 32-bit CPUs: after aligning to a word, the
+ * bulk is read 32 bytes per loop with word loads and no carry checks.
+ *
+ * @arg start of buffer to be checksummed. May be an odd byte address.
+ * @len number of bytes in the buffer to be checksummed (< 64k).
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+static u16_t
+lwip_standard_chksum(void *dataptr, int len)
+{
+  u8_t *pb = (u8_t *)dataptr;
+  u16_t *ps, t = 0;
+  u32_t *pl;
+  u32_t sum = 0, w0, w1, w2, w3;
+  /* starts at odd byte address? */
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  ps = (u16_t *)(void *)pb;
+
+  if (((mem_ptr_t)ps & 3) && len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  pl = (u32_t *)(void *)ps;
+
+  while (len > 31) {
+    w0 = pl[0]; w1 = pl[1]; w2 = pl[2]; w3 = pl[3];
+    CHKSUM_ADD_WORD(sum, w0);
+    CHKSUM_ADD_WORD(sum, w1);
+    CHKSUM_ADD_WORD(sum, w2);
+    CHKSUM_ADD_WORD(sum, w3);
+    w0 = pl[4]; w1 = pl[5]; w2 = pl[6]; w3 = pl[7];
+    CHKSUM_ADD_WORD(sum, w0);
+    CHKSUM_ADD_WORD(sum, w1);
+    CHKSUM_ADD_WORD(sum, w2);
+    CHKSUM_ADD_WORD(sum, w3);
+    pl += 8;
+    len -= 32;
+  }
+
+  while (len > 3) {
+    w0 = *pl++;
+    CHKSUM_ADD_WORD(sum, w0);
+    len -= 4;
+  }
+
+  ps = (u16_t *)pl;
+
+  /* 16-bit aligned word remaining? */
+  if (len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  /* dangling tail byte remaining? */
+  if (len > 0) {                /* include odd byte */
+    ((u8_t *)&t)[0] = *(u8_t *)ps;
+  }
+
+  sum += t;                     /* add end bytes */
+
+  /* Fold 32-bit sum to 16 bits
+     calling this twice is propably faster than if statements... */
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (odd) {
+    sum = SWAP_BYTES_IN_WORD(sum);
+  }
+
+  return (u16_t)sum;
+}
+#endif
+
 /* inet_chksum_pseudo:
  *
  * Calculates the pseudo Internet checksum used by TCP and UDP for a pbuf chain.
@@ -448,3 +540,103 @@ lwip_chksum_copy(void *dst, const void *src, u16_t len)
   return LWIP_CHKSUM(dst, len);
 }
 #endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 1) */
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) /* Version #2 */
+/** Copy and checksum in one pass, so the data is read only once (e.g. in
+ * tcp_write). Source and destination must have the same alignment in their
+ * lower bits for word (or at least halfword) access, otherwise this falls
+ * back to MEMCPY + LWIP_CHKSUM.
+ */
+u16_t
+lwip_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  const u8_t *sb = (const u8_t *)src;
+  u8_t *db = (u8_t *)dst;
+  const u16_t *ss;
+  u16_t *ds;
+  const u32_t *sl;
+  u32_t *dl;
+  u32_t sum = 0, w0, w1, w2, w3;
+  u16_t t = 0;
+  int n = len;
+  int odd = ((mem_ptr_t)db & 1);
+
+  if ((((mem_ptr_t)db ^ (mem_ptr_t)sb) & 1) != 0) {
+    /* no common alignment */
+    MEMCPY(dst, src, len);
+    return LWIP_CHKSUM(dst, len);
+  }
+
+  if (odd && n > 0) {
+    ((u8_t *)&t)[1] = *db++ = *sb++;
+    n--;
+  }
+
+  ss = (const u16_t *)(const void *)sb;
+  ds = (u16_t *)(void *)db;
+
+  if ((((mem_ptr_t)ds ^ (mem_ptr_t)ss) & 3) != 0) {
+    /* halfword aligned only */
+    while (n > 1) {
+      *ds = *ss;
+      sum += *ss++;
+      ds++;
+      n -= 2;
+    }
+  } else {
+    if (((mem_ptr_t)ds & 3) && n > 1) {
+      *ds = *ss;
+      sum += *ss++;
+      ds++;
+      n -= 2;
+    }
+
+    sl = (const u32_t *)(const void *)ss;
+    dl = (u32_t *)(void *)ds;
+
+    while (n > 15) {
+      w0 = sl[0]; w1 = sl[1]; w2 = sl[2]; w3 = sl[3];
+      dl[0] = w0; dl[1] = w1; dl[2] = w2; dl[3] = w3;
+      CHKSUM_ADD_WORD(sum, w0);
+      CHKSUM_ADD_WORD(sum, w1);
+      CHKSUM_ADD_WORD(sum, w2);
+      CHKSUM_ADD_WORD(sum, w3);
+      sl += 4;
+      dl += 4;
+      n -= 16;
+    }
+
+    while (n > 3) {
+      w0 = *sl++;
+      *dl++ = w0;
+      CHKSUM_ADD_WORD(sum, w0);
+      n -= 4;
+    }
+
+    ss = (const u16_t *)sl;
+    ds = (u16_t *)dl;
+
+    if (n > 1) {
+      *ds = *ss;
+      sum += *ss++;
+      ds++;
+      n -= 2;
+    }
+  }
+
+  if (n > 0) {
+    ((u8_t *)&t)[0] = *(u8_t *)ds = *(const u8_t *)ss;
+  }
+
+  sum += t;
+
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (odd) {
+    sum = SWAP_BYTES_IN_WORD(sum);
+  }
+
+  return (u16_t)sum;
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
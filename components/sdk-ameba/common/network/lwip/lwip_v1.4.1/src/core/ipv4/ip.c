@@ -125,7 +125,6 @@ struct netif *
 ip_route(ip_addr_t *dest)
 {
   struct netif *netif;
-  struct netif *last_netif = NULL;
 
 #ifdef LWIP_HOOK_IP4_ROUTE
   netif = LWIP_HOOK_IP4_ROUTE(dest);
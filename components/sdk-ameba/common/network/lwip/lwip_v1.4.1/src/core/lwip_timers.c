@@ -60,11 +60,61 @@
 #include "lwip/pbuf.h"
 
 
+#if LWIP_TIMERS_WHEEL
+/*
+ * Hierarchical timing wheel (Varghese & Lauck). Level 0 has one slot per
+ * millisecond, each higher level one slot per full turn of the level
+ * below. A timeout is linked into the lowest level that reaches its expiry
+ * time and moves down ("cascades") when the wheel gets to its slot, so
+ * adding and removing are O(1) and expiring costs O(levels) per timeout.
+ * A bitmap of the used slots lets the wheel skip idle time and tell the
+ * next deadline without walking any list. Timeouts beyond the span of the
+ * wheel (WHEEL_SPAN, 2^24 ms or ~4.66 h by default) wait in its farthest
+ * slot; expiry times are compared as signed, so timeouts must be shorter
+ * than 2^31 ms.
+ */
+#define WHEEL_SLOTS             (1 << LWIP_TIMERS_WHEEL_BITS)
+#define WHEEL_MASK              (WHEEL_SLOTS - 1)
+#define WHEEL_NUM_SLOTS         (WHEEL_SLOTS * LWIP_TIMERS_WHEEL_LEVELS)
+#define WHEEL_SHIFT(level)      ((level) * LWIP_TIMERS_WHEEL_BITS)
+#define WHEEL_SPAN              (1UL << WHEEL_SHIFT(LWIP_TIMERS_WHEEL_LEVELS))
+/** 'slot' of a timeout that is due and waiting for its handler to be called */
+#define WHEEL_SLOT_EXPIRED      0xFFFF
+/* Fibonacci hashing: the arguments are usually structs of one type, whose
+   addresses differ only in bits above their alignment */
+#define WHEEL_HASH(handler, arg) \
+  (((u32_t)((u32_t)((mem_ptr_t)(handler) ^ (mem_ptr_t)(arg)) * 0x9E3779B1UL) >> 16) & (LWIP_TIMERS_HASH_SIZE - 1))
+
+static struct sys_timeo *wheel[WHEEL_NUM_SLOTS];
+static u32_t wheel_map[(WHEEL_NUM_SLOTS + 31) / 32];
+static struct sys_timeo *wheel_expired;
+static struct sys_timeo *wheel_hash[LWIP_TIMERS_HASH_SIZE];
+/** Time of the next slot to process; everything before has been called */
+static u32_t wheel_now;
+static u16_t wheel_count;
+#else /* LWIP_TIMERS_WHEEL */
 /** The one and only timeout list */
 static struct sys_timeo *next_timeout;
 #if NO_SYS || CONFIG_DYNAMIC_TICKLESS
 static u32_t timeouts_last_time;
 #endif /* NO_SYS */
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+/** 1 from when the tcpip thread goes to sleep until it has taken the time
+    it slept off the list */
+static u8_t timeouts_sleeping;
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+#endif /* LWIP_TIMERS_WHEEL */
+
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+/** While the tcpip thread sleeps in sys_timeouts_mbox_fetch(): its mbox
+    (NULL once it has been woken), when it went to sleep and when it wakes
+    up by itself. Application tasks add timeouts under the core lock, and
+    one due earlier wakes it with timeouts_wakeup_msg. */
+static sys_mbox_t *timeouts_mbox;
+static u32_t timeouts_slept;
+static u32_t timeouts_wake;
+static struct tcpip_msg timeouts_wakeup_msg;
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
 
 #if LWIP_TCP
 /** global variable that shows if the tcp timer is currently scheduled or not */
@@ -203,6 +253,22 @@ igmp_timer(void *arg)
 }
 #endif /* LWIP_IGMP */
 
+#if MEMP_ELASTIC
+/**
+ * Timer callback function that calls memp_elastic_tmr() and reschedules itself.
+ *
+ * @param arg unused argument
+ */
+static void
+memp_elastic_timer(void *arg)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_DEBUGF(TIMERS_DEBUG, ("tcpip: memp_elastic_tmr()\n"));
+  memp_elastic_tmr();
+  sys_timeout(MEMP_ELASTIC_TMR_INTERVAL, memp_elastic_timer, NULL);
+}
+#endif /* MEMP_ELASTIC */
+
 #if LWIP_DNS
 /**
  * Timer callback function that calls dns_tmr() and reschedules itself.
@@ -219,9 +285,53 @@ dns_timer(void *arg)
 }
 #endif /* LWIP_DNS */
 
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+/** timeouts_wakeup_msg only has to get the tcpip thread out of its mbox */
+static void
+timeouts_wakeup_done(void *arg)
+{
+  LWIP_UNUSED_ARG(arg);
+}
+
+/**
+ * The tcpip thread is about to wait on 'mbox' for 'sleeptime' ms
+ * (SYS_TIMEOUTS_SLEEPTIME_INFINITE: until a message comes). Core locked.
+ */
+static void
+timeouts_sleep(sys_mbox_t *mbox, u32_t sleeptime)
+{
+  timeouts_slept = sys_now();
+  timeouts_wake = timeouts_slept + LWIP_MIN(sleeptime, 0x7FFFFFFFUL);
+  timeouts_mbox = mbox;
+}
+
+/**
+ * A timeout expiring at 'time' has been added. Core locked. If the tcpip
+ * thread sleeps past that, wake it up to pick the new deadline: an
+ * application task calling e.g. tcp_write() starts the TCP timer here.
+ */
+static void
+timeouts_wakeup(u32_t time)
+{
+  if ((timeouts_mbox != NULL) && ((s32_t)(time - timeouts_wake) < 0)) {
+    /* if the mbox is full, the tcpip thread wakes up anyway */
+    sys_mbox_trypost(timeouts_mbox, &timeouts_wakeup_msg);
+    timeouts_mbox = NULL;
+  }
+}
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+
 /** Initialize this module */
 void sys_timeouts_init(void)
 {
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+  timeouts_wakeup_msg.type = TCPIP_MSG_CALLBACK_STATIC;
+  timeouts_wakeup_msg.msg.cb.function = timeouts_wakeup_done;
+  timeouts_wakeup_msg.msg.cb.ctx = NULL;
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+#if LWIP_TIMERS_WHEEL
+  wheel_now = sys_now();
+#endif /* LWIP_TIMERS_WHEEL */
 #if IP_REASSEMBLY
   sys_timeout(IP_TMR_INTERVAL, ip_reass_timer, NULL);
 #endif /* IP_REASSEMBLY */
@@ -241,13 +351,416 @@ void sys_timeouts_init(void)
 #if LWIP_DNS
   sys_timeout(DNS_TMR_INTERVAL, dns_timer, NULL);
 #endif /* LWIP_DNS */
+#if MEMP_ELASTIC
+  sys_timeout(MEMP_ELASTIC_TMR_INTERVAL, memp_elastic_timer, NULL);
+#endif /* MEMP_ELASTIC */
 
-#if NO_SYS || CONFIG_DYNAMIC_TICKLESS
+#if !LWIP_TIMERS_WHEEL && (NO_SYS || CONFIG_DYNAMIC_TICKLESS)
   /* Initialise timestamp for sys_check_timeouts */
   timeouts_last_time = sys_now();
 #endif
 }
 
+#if LWIP_TIMERS_WHEEL
+
+/**
+ * Return the first used slot in [from, to), or 'to' if there is none.
+ */
+static u16_t
+wheel_find(u16_t from, u16_t to)
+{
+  u32_t bits;
+
+  while (from < to) {
+    bits = wheel_map[from >> 5] >> (from & 31);
+    if (bits == 0) {
+      from = (from | 31) + 1;
+      continue;
+    }
+    while ((bits & 1) == 0) {
+      bits >>= 1;
+      from++;
+    }
+    break;
+  }
+  return LWIP_MIN(from, to);
+}
+
+/**
+ * Link a timeout into the slot matching its expiry time.
+ */
+static void
+wheel_link(struct sys_timeo *t)
+{
+  u32_t delta = t->time - wheel_now;
+  u32_t expiry = t->time;
+  u16_t level, slot;
+
+  if ((s32_t)delta < 0) {
+    /* already due (the wheel has passed its slot): queue it for calling */
+    t->slot = WHEEL_SLOT_EXPIRED;
+    t->next = wheel_expired;
+    if (t->next != NULL) {
+      t->next->pprev = &t->next;
+    }
+    t->pprev = &wheel_expired;
+    wheel_expired = t;
+    return;
+  }
+  if (delta >= WHEEL_SPAN) {
+    /* beyond the wheel: park it in the farthest slot, it is relinked
+       from there with its real expiry time */
+    delta = WHEEL_SPAN - 1;
+    expiry = wheel_now + delta;
+  }
+  for (level = 0; level < LWIP_TIMERS_WHEEL_LEVELS - 1; level++) {
+    if (delta < (1UL << WHEEL_SHIFT(level + 1))) {
+      break;
+    }
+  }
+  slot = (u16_t)(level * WHEEL_SLOTS + ((expiry >> WHEEL_SHIFT(level)) & WHEEL_MASK));
+
+  t->slot = slot;
+  t->next = wheel[slot];
+  if (t->next != NULL) {
+    t->next->pprev = &t->next;
+  }
+  t->pprev = &wheel[slot];
+  wheel[slot] = t;
+  wheel_map[slot >> 5] |= 1UL << (slot & 31);
+}
+
+static void
+wheel_unlink(struct sys_timeo *t)
+{
+  *t->pprev = t->next;
+  if (t->next != NULL) {
+    t->next->pprev = t->pprev;
+  }
+  if ((t->slot != WHEEL_SLOT_EXPIRED) && (wheel[t->slot] == NULL)) {
+    wheel_map[t->slot >> 5] &= ~(1UL << (t->slot & 31));
+  }
+}
+
+static void
+wheel_hash_remove(struct sys_timeo *t)
+{
+  struct sys_timeo **pt = &wheel_hash[WHEEL_HASH(t->h, t->arg)];
+
+  while (*pt != t) {
+    LWIP_ASSERT("timeout not in its hash bucket", *pt != NULL);
+    pt = &(*pt)->hnext;
+  }
+  *pt = t->hnext;
+}
+
+/**
+ * Move the timeouts of the current slot of 'level' one level down.
+ *
+ * @return the index of that slot within its level
+ */
+static u16_t
+wheel_cascade(u16_t level)
+{
+  u16_t idx = (u16_t)((wheel_now >> WHEEL_SHIFT(level)) & WHEEL_MASK);
+  u16_t slot = (u16_t)(level * WHEEL_SLOTS + idx);
+  struct sys_timeo *t, *next;
+
+  t = wheel[slot];
+  wheel[slot] = NULL;
+  wheel_map[slot >> 5] &= ~(1UL << (slot & 31));
+  for (; t != NULL; t = next) {
+    next = t->next;
+    wheel_link(t);
+  }
+  return idx;
+}
+
+/**
+ * Call the handlers of all timeouts due up to and including 'now'.
+ */
+static void
+wheel_advance(u32_t now)
+{
+  struct sys_timeo *t;
+  sys_timeout_handler handler;
+  void *arg;
+  u16_t idx, level;
+  u32_t skip;
+
+  for (;;) {
+    while ((t = wheel_expired) != NULL) {
+      wheel_unlink(t);
+      wheel_hash_remove(t);
+      wheel_count--;
+      handler = t->h;
+      arg = t->arg;
+#if LWIP_DEBUG_TIMERNAMES
+      if (handler != NULL) {
+        LWIP_DEBUGF(TIMERS_DEBUG, ("sct calling h=%s arg=%p\n",
+          t->handler_name, arg));
+      }
+#endif /* LWIP_DEBUG_TIMERNAMES */
+      memp_free(MEMP_SYS_TIMEOUT, t);
+      if (handler != NULL) {
+        handler(arg);
+      }
+    }
+    if ((s32_t)(now - wheel_now) < 0) {
+      break;
+    }
+
+    idx = (u16_t)(wheel_now & WHEEL_MASK);
+    if (idx == 0) {
+      for (level = 1; level < LWIP_TIMERS_WHEEL_LEVELS; level++) {
+        if (wheel_cascade(level) != 0) {
+          break;
+        }
+      }
+    } else if (wheel[idx] == NULL) {
+      /* nothing due here: skip to the next used slot or the next cascade */
+      skip = wheel_find(idx, WHEEL_SLOTS) - idx;
+      wheel_now += LWIP_MIN(skip, now - wheel_now + 1);
+      continue;
+    }
+
+    /* Take the due timeouts off the wheel before calling them: handlers
+       may add new timeouts or remove pending ones. */
+    wheel_expired = wheel[idx];
+    if (wheel_expired != NULL) {
+      wheel[idx] = NULL;
+      wheel_map[idx >> 5] &= ~(1UL << (idx & 31));
+      wheel_expired->pprev = &wheel_expired;
+      for (t = wheel_expired; t != NULL; t = t->next) {
+        t->slot = WHEEL_SLOT_EXPIRED;
+      }
+    }
+    wheel_now++;
+  }
+}
+
+/**
+ * Create a one-shot timer (aka timeout). Timeouts are processed in the
+ * following cases:
+ * - while waiting for a message using sys_timeouts_mbox_fetch()
+ * - by calling sys_check_timeouts() (NO_SYS==1 only)
+ *
+ * @param msecs time in milliseconds after that the timer should expire
+ * @param handler callback function to call when msecs have elapsed
+ * @param arg argument to pass to the callback function
+ */
+#if LWIP_DEBUG_TIMERNAMES
+void
+sys_timeout_debug(u32_t msecs, sys_timeout_handler handler, void *arg, const char* handler_name)
+#else /* LWIP_DEBUG_TIMERNAMES */
+void
+sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
+#endif /* LWIP_DEBUG_TIMERNAMES */
+{
+  struct sys_timeo *timeout;
+  struct sys_timeo **bucket;
+
+  LWIP_ASSERT("sys_timeout: msecs < 2^31", msecs < 0x80000000UL);
+  timeout = (struct sys_timeo *)memp_malloc(MEMP_SYS_TIMEOUT);
+  if (timeout == NULL) {
+    LWIP_ASSERT("sys_timeout: timeout != NULL, pool MEMP_SYS_TIMEOUT is empty", timeout != NULL);
+    return;
+  }
+  timeout->h = handler;
+  timeout->arg = arg;
+  timeout->time = sys_now() + msecs;
+#if LWIP_DEBUG_TIMERNAMES
+  timeout->handler_name = handler_name;
+  LWIP_DEBUGF(TIMERS_DEBUG, ("sys_timeout: %p msecs=%"U32_F" handler=%s arg=%p\n",
+    (void *)timeout, msecs, handler_name, (void *)arg));
+#endif /* LWIP_DEBUG_TIMERNAMES */
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+  timeouts_wakeup(timeout->time);
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+
+  wheel_link(timeout);
+  bucket = &wheel_hash[WHEEL_HASH(handler, arg)];
+  timeout->hnext = *bucket;
+  *bucket = timeout;
+  wheel_count++;
+}
+
+/**
+ * Remove a matching timeout, even though it has not triggered yet.
+ *
+ * @note This function only works as expected if there is only one timeout
+ * calling 'handler' with 'arg' pending.
+ *
+ * @param handler callback function that would be called by the timeout
+ * @param arg callback argument that would be passed to handler
+*/
+void
+sys_untimeout(sys_timeout_handler handler, void *arg)
+{
+  struct sys_timeo *t;
+
+  for (t = wheel_hash[WHEEL_HASH(handler, arg)]; t != NULL; t = t->hnext) {
+    if ((t->h == handler) && (t->arg == arg)) {
+      wheel_unlink(t);
+      wheel_hash_remove(t);
+      wheel_count--;
+      memp_free(MEMP_SYS_TIMEOUT, t);
+      return;
+    }
+  }
+}
+
+/**
+ * Return the time in milliseconds until the wheel needs to run again:
+ * the next expiry, or the next cascade of timeouts that are further
+ * away. Meant for picking a sleep time, e.g. in tickless idle.
+ *
+ * @return milliseconds to wait, 0 if timeouts are due, or
+ *         SYS_TIMEOUTS_SLEEPTIME_INFINITE if there is no timeout
+ */
+u32_t
+sys_timeouts_sleeptime(void)
+{
+  u32_t next = WHEEL_SPAN, d, now;
+  u16_t level, base, pos, start, j;
+
+  if (wheel_count == 0) {
+    return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
+  }
+  if (wheel_expired != NULL) {
+    return 0;
+  }
+
+  for (level = 0; level < LWIP_TIMERS_WHEEL_LEVELS; level++) {
+    base = (u16_t)(level * WHEEL_SLOTS);
+    pos = (u16_t)((wheel_now >> WHEEL_SHIFT(level)) & WHEEL_MASK);
+    /* the slot at 'pos' is still ahead if the lower levels are at 0 */
+    start = pos;
+    if (wheel_now & ((1UL << WHEEL_SHIFT(level)) - 1)) {
+      start++;
+    }
+    j = wheel_find(base + start, base + WHEEL_SLOTS);
+    if (j < base + WHEEL_SLOTS) {
+      d = j - base - pos;
+    } else {
+      j = wheel_find(base, base + start);
+      if (j == base + start) {
+        continue;
+      }
+      d = WHEEL_SLOTS - pos + (j - base);
+    }
+    d = ((((wheel_now >> WHEEL_SHIFT(level)) + d) << WHEEL_SHIFT(level))) - wheel_now;
+    next = LWIP_MIN(next, d);
+  }
+
+  now = sys_now();
+  if ((s32_t)(wheel_now + next - now) <= 0) {
+    return 0;
+  }
+  return wheel_now + next - now;
+}
+
+#if NO_SYS
+
+/** Handle timeouts for NO_SYS==1 (i.e. without using
+ * tcpip_thread/sys_timeouts_mbox_fetch(). Uses sys_now() to call timeout
+ * handler functions when timeouts expire.
+ *
+ * Must be called periodically from your main loop.
+ */
+void
+sys_check_timeouts(void)
+{
+#if PBUF_POOL_FREE_OOSEQ
+  PBUF_CHECK_FREE_OOSEQ();
+#endif /* PBUF_POOL_FREE_OOSEQ */
+  wheel_advance(sys_now());
+}
+
+/** Set back the timestamp of the last call to sys_check_timeouts()
+ * This is necessary if sys_check_timeouts() hasn't been called for a long
+ * time (e.g. while saving energy) to prevent all timer functions of that
+ * period being called.
+ */
+void
+sys_restart_timeouts(void)
+{
+  struct sys_timeo *list = NULL, *t;
+  u32_t shift = sys_now() - wheel_now;
+  u16_t slot;
+
+  /* shift every pending timeout by the time that was skipped */
+  for (slot = 0; slot < WHEEL_NUM_SLOTS; slot++) {
+    while ((t = wheel[slot]) != NULL) {
+      wheel_unlink(t);
+      t->time += shift;
+      t->next = list;
+      list = t;
+    }
+  }
+  wheel_now += shift;
+  while ((t = list) != NULL) {
+    list = t->next;
+    wheel_link(t);
+  }
+}
+
+#else /* NO_SYS */
+
+/**
+ * Wait (forever) for a message to arrive in an mbox.
+ * While waiting, timeouts are processed.
+ *
+ * @param mbox the mbox to fetch the message from
+ * @param msg the place to store the message
+ */
+void
+sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
+{
+  u32_t sleeptime, waited;
+
+ again:
+  /* application tasks may add or remove timeouts under the core lock */
+  LOCK_TCPIP_CORE();
+  sleeptime = sys_timeouts_sleeptime();
+#if LWIP_TCPIP_CORE_LOCKING
+  if (sleeptime != 0) {
+    timeouts_sleep(mbox, sleeptime);
+  }
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+  UNLOCK_TCPIP_CORE();
+
+  if (sleeptime == SYS_TIMEOUTS_SLEEPTIME_INFINITE) {
+    waited = sys_arch_mbox_fetch(mbox, msg, 0);
+  } else if (sleeptime != 0) {
+    waited = sys_arch_mbox_fetch(mbox, msg, sleeptime);
+  } else {
+    waited = SYS_ARCH_TIMEOUT;
+  }
+
+  LOCK_TCPIP_CORE();
+#if LWIP_TCPIP_CORE_LOCKING
+  timeouts_mbox = NULL;
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+  if (waited == SYS_ARCH_TIMEOUT) {
+    /* Expiry times are absolute, so the time spent waiting for a message
+       needs no bookkeeping: just call whatever is due by now. */
+    wheel_advance(sys_now());
+  }
+  UNLOCK_TCPIP_CORE();
+
+  if (waited == SYS_ARCH_TIMEOUT) {
+    LWIP_TCPIP_THREAD_ALIVE();
+
+    /* We try again to fetch a message from the mbox. */
+    goto again;
+  }
+}
+
+#endif /* NO_SYS */
+
+#else /* LWIP_TIMERS_WHEEL */
+
 /**
  * Create a one-shot timer (aka timeout). Timeouts are processed in the
  * following cases:
@@ -273,6 +786,13 @@ sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
     LWIP_ASSERT("sys_timeout: timeout != NULL, pool MEMP_SYS_TIMEOUT is empty", timeout != NULL);
     return;
   }
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+  timeouts_wakeup(sys_now() + msecs);
+  if (timeouts_sleeping) {
+    /* the list counts from when the tcpip thread went to sleep */
+    msecs += sys_now() - timeouts_slept;
+  }
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
   timeout->next = NULL;
   timeout->h = handler;
   timeout->arg = arg;
@@ -422,21 +942,31 @@ sys_restart_timeouts(void)
 void
 sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
 {
-  u32_t time_needed;
+  u32_t time_needed, sleeptime;
   struct sys_timeo *tmptimeout;
   sys_timeout_handler handler;
   void *arg;
 
  again:
-  if (!next_timeout) {
+  /* application tasks may add or remove timeouts under the core lock */
+  LOCK_TCPIP_CORE();
+  tmptimeout = next_timeout;
+  sleeptime = (tmptimeout != NULL) ? tmptimeout->time : 0;
+#if LWIP_TCPIP_CORE_LOCKING
+  if ((tmptimeout == NULL) || (sleeptime > 0)) {
+    timeouts_sleep(mbox, (tmptimeout == NULL) ? 0xFFFFFFFFUL : sleeptime);
+    timeouts_sleeping = 1;
+  }
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+  UNLOCK_TCPIP_CORE();
+
+  if (tmptimeout == NULL) {
     time_needed = sys_arch_mbox_fetch(mbox, msg, 0);
+  } else if (sleeptime > 0) {
+    time_needed = sys_arch_mbox_fetch(mbox, msg, sleeptime);
   } else {
-    if (next_timeout->time > 0) {
-      time_needed = sys_arch_mbox_fetch(mbox, msg, next_timeout->time);
-    } else {
-      time_needed = SYS_ARCH_TIMEOUT;
-    }
-	
+    time_needed = SYS_ARCH_TIMEOUT;
+  }
 #if CONFIG_DYNAMIC_TICKLESS
     if (time_needed == SYS_ARCH_TIMEOUT) {
       /* If time == SYS_ARCH_TIMEOUT, a timeout occured before a message
@@ -446,6 +976,12 @@ sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
 	  u32_t now;
 	  u32_t diff;
 	  
+	/* application tasks may add or remove timeouts under the core lock */
+	LOCK_TCPIP_CORE();
+#if LWIP_TCPIP_CORE_LOCKING
+	timeouts_mbox = NULL;
+	timeouts_sleeping = 0;
+#endif /* LWIP_TCPIP_CORE_LOCKING */
 	now = sys_now();
     /* this cares for wraparounds */
     diff = now - timeouts_last_time;
@@ -469,13 +1005,12 @@ sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
 #endif /* LWIP_DEBUG_TIMERNAMES */
         memp_free(MEMP_SYS_TIMEOUT, tmptimeout);
         if (handler != NULL) {
-        	LOCK_TCPIP_CORE();
         	handler(arg);
-       	UNLOCK_TCPIP_CORE();
         }
       }
     /* repeat until all expired timers have been called */
     }while(had_one);
+	UNLOCK_TCPIP_CORE();
 	
       LWIP_TCPIP_THREAD_ALIVE();
 
@@ -484,11 +1019,19 @@ sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
     }
 
 #else
-    if (time_needed == SYS_ARCH_TIMEOUT) {
-      /* If time == SYS_ARCH_TIMEOUT, a timeout occured before a message
-         could be fetched. We should now call the timeout handler and
-         deallocate the memory allocated for the timeout. */
-      tmptimeout = next_timeout;
+  if (time_needed == SYS_ARCH_TIMEOUT) {
+    /* If time == SYS_ARCH_TIMEOUT, a timeout occured before a message
+       could be fetched. We should now call the timeout handler and
+       deallocate the memory allocated for the timeout.
+       For LWIP_TCPIP_CORE_LOCKING, lock the core before touching the
+       list: application tasks may add or remove timeouts meanwhile. */
+    LOCK_TCPIP_CORE();
+#if LWIP_TCPIP_CORE_LOCKING
+    timeouts_mbox = NULL;
+    timeouts_sleeping = 0;
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+    tmptimeout = next_timeout;
+    if (tmptimeout != NULL) {
       next_timeout = tmptimeout->next;
       handler = tmptimeout->h;
       arg = tmptimeout->arg;
@@ -500,33 +1043,40 @@ sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
 #endif /* LWIP_DEBUG_TIMERNAMES */
       memp_free(MEMP_SYS_TIMEOUT, tmptimeout);
       if (handler != NULL) {
-        /* For LWIP_TCPIP_CORE_LOCKING, lock the core before calling the
-           timeout handler function. */
-        LOCK_TCPIP_CORE();
         handler(arg);
-        UNLOCK_TCPIP_CORE();
       }
-      LWIP_TCPIP_THREAD_ALIVE();
-
-      /* We try again to fetch a message from the mbox. */
-      goto again;
     }
+    UNLOCK_TCPIP_CORE();
+    LWIP_TCPIP_THREAD_ALIVE();
+
+    /* We try again to fetch a message from the mbox. */
+    goto again;
+  }
 #endif
  else {
-      /* If time != SYS_ARCH_TIMEOUT, a message was received before the timeout
-         occured. The time variable is set to the number of
-         milliseconds we waited for the message. */
-      if (time_needed < next_timeout->time) {
-        next_timeout->time -= time_needed;
-      } else {
-        next_timeout->time = 0;
-      }
+    /* If time != SYS_ARCH_TIMEOUT, a message was received before the timeout
+       occured. The time variable is set to the number of
+       milliseconds we waited for the message. */
+    LOCK_TCPIP_CORE();
+#if LWIP_TCPIP_CORE_LOCKING
+    timeouts_mbox = NULL;
+    timeouts_sleeping = 0;
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+    if (next_timeout == NULL) {
+      /* none left, or none was added while waiting */
+    } else if (time_needed < next_timeout->time) {
+      next_timeout->time -= time_needed;
+    } else {
+      next_timeout->time = 0;
     }
+    UNLOCK_TCPIP_CORE();
   }
 }
 
 #endif /* NO_SYS */
 
+#endif /* LWIP_TIMERS_WHEEL */
+
 #else /* LWIP_TIMERS */
 /* Satisfy the TCP code which calls this function */
 void
@@ -59,6 +59,7 @@
 
 #include "lwip/def.h"
 #include "lwip/mem.h"
+#include "lwip/memp.h"
 #include "lwip/sys.h"
 #include "lwip/stats.h"
 #include "lwip/err.h"
@@ -319,6 +320,14 @@ mem_free(void *rmem)
   }
   LWIP_ASSERT("mem_free: sanity check alignment", (((mem_ptr_t)rmem) & (MEM_ALIGNMENT-1)) == 0);
 
+#if MEMP_ELASTIC
+  if ((u8_t *)rmem < (u8_t *)ram || (u8_t *)rmem >= (u8_t *)ram_end) {
+    /* borrowed by mem_malloc() while the heap was full */
+    memp_elastic_mem_free(rmem);
+    return;
+  }
+#endif /* MEMP_ELASTIC */
+
   LWIP_ASSERT("mem_free: legal memory", (u8_t *)rmem >= (u8_t *)ram &&
     (u8_t *)rmem < (u8_t *)ram_end);
 
@@ -387,6 +396,13 @@ mem_trim(void *rmem, mem_size_t newsize)
     return NULL;
   }
 
+#if MEMP_ELASTIC
+  if ((u8_t *)rmem < (u8_t *)ram || (u8_t *)rmem >= (u8_t *)ram_end) {
+    /* borrowed block, not shrunk */
+    return rmem;
+  }
+#endif /* MEMP_ELASTIC */
+
   LWIP_ASSERT("mem_trim: legal memory", (u8_t *)rmem >= (u8_t *)ram &&
    (u8_t *)rmem < (u8_t *)ram_end);
 
@@ -629,7 +645,11 @@ mem_malloc_adjust_lfree:
   MEM_STATS_INC(err);
   LWIP_MEM_ALLOC_UNPROTECT();
   sys_mutex_unlock(&mem_mutex);
+#if MEMP_ELASTIC
+  return memp_elastic_mem_malloc(size);
+#else /* MEMP_ELASTIC */
   return NULL;
+#endif /* MEMP_ELASTIC */
 }
 
 #endif /* MEM_USE_POOLS */
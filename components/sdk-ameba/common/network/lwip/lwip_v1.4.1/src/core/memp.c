@@ -174,6 +174,178 @@ static u8_t memp_memory[MEM_ALIGNMENT - 1
 
 #endif /* MEMP_SEPARATE_POOLS */
 
+#if MEMP_ELASTIC
+/** This array holds the number of elements each pool may borrow. */
+static const u16_t memp_elastic_max[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc)  MEMP_ELASTIC_MAX(name, num),
+#include "lwip/memp_std.h"
+};
+
+/** Number of elements each pool holds from the reserve (in use or kept) */
+static u16_t memp_elastic_num[MEMP_MAX];
+/** Freed borrowed elements of each pool, used when the pool is empty */
+static struct memp *memp_elastic_tab[MEMP_MAX];
+/** Set when a pool ran empty since the last memp_elastic_tmr() */
+static u8_t memp_elastic_busy[MEMP_MAX];
+/** Bytes held from the reserve by all pools and the heap */
+static u32_t memp_elastic_used;
+/** Bytes held from the reserve by the heap */
+static u32_t memp_elastic_mem_used;
+
+#define MEMP_ELASTIC_SIZE(type)  (MEMP_SIZE + memp_sizes[type])
+/* heap blocks from the reserve keep their size in front of the data */
+#define MEMP_ELASTIC_MEM_HDR     LWIP_MEM_ALIGN_SIZE(sizeof(u32_t))
+
+/**
+ * Check whether an element was borrowed, i.e. is not part of the
+ * static memory of its pool.
+ */
+static int
+memp_elastic_borrowed(memp_t type, struct memp *memp)
+{
+#if MEMP_SEPARATE_POOLS
+  u8_t *base = memp_bases[type];
+
+  return ((u8_t *)memp < base) ||
+         ((u8_t *)memp >= base + memp_num[type] * (MEMP_SIZE + memp_sizes[type]));
+#else /* MEMP_SEPARATE_POOLS */
+  LWIP_UNUSED_ARG(type);
+  return ((u8_t *)memp < memp_memory) ||
+         ((u8_t *)memp >= memp_memory + sizeof(memp_memory));
+#endif /* MEMP_SEPARATE_POOLS */
+}
+
+/**
+ * Allocate a new element for a pool from the reserve. The caller has
+ * already counted it in memp_elastic_num and memp_elastic_used.
+ */
+static void *
+memp_elastic_borrow(memp_t type)
+{
+  struct memp *memp;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  memp = (struct memp *)MEMP_ELASTIC_ALLOC(MEMP_ELASTIC_SIZE(type));
+
+  SYS_ARCH_PROTECT(old_level);
+  if (memp != NULL) {
+    MEMP_STATS_INC_USED(used, type);
+    LWIP_ASSERT("memp_elastic_borrow: memp properly aligned",
+                ((mem_ptr_t)memp % MEM_ALIGNMENT) == 0);
+    memp = (struct memp*)(void *)((u8_t*)memp + MEMP_SIZE);
+  } else {
+    LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: reserve exhausted for pool %s\n", memp_desc[type]));
+    memp_elastic_num[type]--;
+    memp_elastic_used -= MEMP_ELASTIC_SIZE(type);
+    MEMP_STATS_INC(err, type);
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+
+  return memp;
+}
+
+/**
+ * Give the freed borrowed elements of the pools that did not run empty
+ * since the last call back to the reserve. Called every
+ * MEMP_ELASTIC_TMR_INTERVAL milliseconds.
+ */
+void
+memp_elastic_tmr(void)
+{
+  struct memp *list, *next;
+  u16_t i, n;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  for (i = 0; i < MEMP_MAX; ++i) {
+    SYS_ARCH_PROTECT(old_level);
+    list = NULL;
+    if (!memp_elastic_busy[i]) {
+      list = memp_elastic_tab[i];
+      memp_elastic_tab[i] = NULL;
+    }
+    memp_elastic_busy[i] = 0;
+    SYS_ARCH_UNPROTECT(old_level);
+
+    for (n = 0; list != NULL; n++) {
+      next = list->next;
+      MEMP_ELASTIC_FREE(list);
+      list = next;
+    }
+
+    if (n > 0) {
+      SYS_ARCH_PROTECT(old_level);
+      memp_elastic_num[i] -= n;
+      memp_elastic_used -= (u32_t)n * MEMP_ELASTIC_SIZE(i);
+      SYS_ARCH_UNPROTECT(old_level);
+    }
+  }
+}
+
+/**
+ * Allocate a heap block from the reserve, used by mem_malloc() when the
+ * heap is full.
+ *
+ * @param size aligned size of the block
+ * @return the block or NULL if the heap's share of the reserve is used up
+ */
+void *
+memp_elastic_mem_malloc(mem_size_t size)
+{
+  u32_t total = MEMP_ELASTIC_MEM_HDR + size;
+  u8_t *p;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  if ((memp_elastic_mem_used + total > MEM_ELASTIC_MAX) ||
+      (memp_elastic_used + total > MEMP_ELASTIC_RESERVE)) {
+    SYS_ARCH_UNPROTECT(old_level);
+    return NULL;
+  }
+  memp_elastic_mem_used += total;
+  memp_elastic_used += total;
+  SYS_ARCH_UNPROTECT(old_level);
+
+  p = (u8_t *)MEMP_ELASTIC_ALLOC(total);
+  if (p == NULL) {
+    SYS_ARCH_PROTECT(old_level);
+    memp_elastic_mem_used -= total;
+    memp_elastic_used -= total;
+    SYS_ARCH_UNPROTECT(old_level);
+    return NULL;
+  }
+  *(u32_t *)(void *)p = total;
+  return p + MEMP_ELASTIC_MEM_HDR;
+}
+
+/**
+ * Give a heap block from memp_elastic_mem_malloc() back to the reserve.
+ */
+void
+memp_elastic_mem_free(void *rmem)
+{
+  u8_t *p = (u8_t *)rmem - MEMP_ELASTIC_MEM_HDR;
+  u32_t total = *(u32_t *)(void *)p;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  MEMP_ELASTIC_FREE(p);
+
+  SYS_ARCH_PROTECT(old_level);
+  memp_elastic_mem_used -= total;
+  memp_elastic_used -= total;
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+/**
+ * Bytes the pools and the heap hold from the reserve, in use or kept for
+ * the next burst.
+ */
+u32_t
+memp_elastic_held(void)
+{
+  return memp_elastic_used;
+}
+#endif /* MEMP_ELASTIC */
+
 #if MEMP_SANITY_CHECK
 /**
  * Check that memp-lists don't form a circle, using "Floyd's cycle-finding algorithm".
@@ -403,7 +575,26 @@ memp_malloc_fn(memp_t type, const char* file, const int line)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
   memp = memp_tab[type];
-  
+
+#if MEMP_ELASTIC
+  if (memp == NULL) {
+    memp_elastic_busy[type] = 1;
+    if (memp_elastic_tab[type] != NULL) {
+      /* reuse a borrowed element, through the (empty) pool list */
+      memp = memp_elastic_tab[type];
+      memp_elastic_tab[type] = memp->next;
+      memp->next = NULL;
+    } else if ((memp_elastic_num[type] < memp_elastic_max[type]) &&
+               (memp_elastic_used + MEMP_ELASTIC_SIZE(type) <= MEMP_ELASTIC_RESERVE)) {
+      memp_elastic_num[type]++;
+      memp_elastic_used += MEMP_ELASTIC_SIZE(type);
+      SYS_ARCH_UNPROTECT(old_level);
+      /* don't call the system allocator with interrupts disabled */
+      return memp_elastic_borrow(type);
+    }
+  }
+#endif /* MEMP_ELASTIC */
+
   if (memp != NULL) {
     memp_tab[type] = memp->next;
 #if MEMP_OVERFLOW_CHECK
@@ -457,8 +648,17 @@ memp_free(memp_t type, void *mem)
 
   MEMP_STATS_DEC(used, type); 
   
-  memp->next = memp_tab[type]; 
-  memp_tab[type] = memp;
+#if MEMP_ELASTIC
+  if (memp_elastic_borrowed(type, memp)) {
+    /* keep it for the next burst, memp_elastic_tmr() gives it back */
+    memp->next = memp_elastic_tab[type];
+    memp_elastic_tab[type] = memp;
+  } else
+#endif /* MEMP_ELASTIC */
+  {
+    memp->next = memp_tab[type];
+    memp_tab[type] = memp;
+  }
 
 #if MEMP_SANITY_CHECK
   LWIP_ASSERT("memp sanity", memp_sanity());
@@ -43,8 +43,12 @@
 #include "lwip/def.h"
 #include "lwip/stats.h"
 #include "lwip/mem.h"
+#include "lwip/sys.h"
 
 #include <string.h>
+#if LWIP_STATS_DUMP
+#include <stdio.h>
+#endif
 
 struct stats_ lwip_stats;
 
@@ -172,5 +176,254 @@ stats_display(void)
 }
 #endif /* LWIP_STATS_DISPLAY */
 
+#if LWIP_STATS_DUMP
+#define STATS_DUMP_LINE 128
+
+struct stats_dump_ctx {
+  stats_out_fn out;
+  void *arg;
+  u8_t json;
+  u8_t first;
+  char line[STATS_DUMP_LINE];
+};
+
+/* Emits the object key or text label for one group of counters */
+static void
+stats_dump_begin(struct stats_dump_ctx *ctx, const char *name)
+{
+  if (ctx->json) {
+    snprintf(ctx->line, STATS_DUMP_LINE, "%s\"%s\":{", ctx->first ? "" : ",", name);
+  } else {
+    snprintf(ctx->line, STATS_DUMP_LINE, "\r\n%-16s", name);
+  }
+  ctx->out(ctx->arg, ctx->line);
+  ctx->first = 0;
+}
+
+static void
+stats_dump_end(struct stats_dump_ctx *ctx)
+{
+  if (ctx->json) {
+    ctx->out(ctx->arg, "}");
+  }
+}
+
+static void
+stats_dump_u32(struct stats_dump_ctx *ctx, const char *name, u32_t val, u8_t first)
+{
+  if (ctx->json) {
+    snprintf(ctx->line, STATS_DUMP_LINE, "%s\"%s\":%"U32_F, first ? "" : ",", name, val);
+  } else {
+    snprintf(ctx->line, STATS_DUMP_LINE, " %s:%"U32_F, name, val);
+  }
+  ctx->out(ctx->arg, ctx->line);
+}
+
+static void
+stats_dump_proto(struct stats_dump_ctx *ctx, struct stats_proto *proto, const char *name)
+{
+  stats_dump_begin(ctx, name);
+  stats_dump_u32(ctx, "xmit", proto->xmit, 1);
+  stats_dump_u32(ctx, "recv", proto->recv, 0);
+  stats_dump_u32(ctx, "fw", proto->fw, 0);
+  stats_dump_u32(ctx, "drop", proto->drop, 0);
+  stats_dump_u32(ctx, "chkerr", proto->chkerr, 0);
+  stats_dump_u32(ctx, "lenerr", proto->lenerr, 0);
+  stats_dump_u32(ctx, "memerr", proto->memerr, 0);
+  stats_dump_u32(ctx, "rterr", proto->rterr, 0);
+  stats_dump_u32(ctx, "proterr", proto->proterr, 0);
+  stats_dump_u32(ctx, "opterr", proto->opterr, 0);
+  stats_dump_u32(ctx, "err", proto->err, 0);
+  stats_dump_end(ctx);
+}
+
+#if MEM_STATS || MEMP_STATS
+static void
+stats_dump_mem(struct stats_dump_ctx *ctx, struct stats_mem *mem, const char *name)
+{
+#if LWIP_STATS_HIST
+  int i;
+#endif /* LWIP_STATS_HIST */
+
+  stats_dump_begin(ctx, name);
+  stats_dump_u32(ctx, "avail", (u32_t)mem->avail, 1);
+  stats_dump_u32(ctx, "used", (u32_t)mem->used, 0);
+  stats_dump_u32(ctx, "max", (u32_t)mem->max, 0);
+  stats_dump_u32(ctx, "err", (u32_t)mem->err, 0);
+  stats_dump_u32(ctx, "illegal", (u32_t)mem->illegal, 0);
+#if LWIP_STATS_HIST
+  ctx->out(ctx->arg, ctx->json ? ",\"hist\":[" : " hist:");
+  for (i = 0; i < LWIP_STATS_HIST_BUCKETS; i++) {
+    snprintf(ctx->line, STATS_DUMP_LINE, "%s%"U32_F, i ? "," : "", (u32_t)mem->hist[i]);
+    ctx->out(ctx->arg, ctx->line);
+  }
+  if (ctx->json) {
+    ctx->out(ctx->arg, "]");
+  }
+#endif /* LWIP_STATS_HIST */
+  stats_dump_end(ctx);
+}
+#endif /* MEM_STATS || MEMP_STATS */
+
+#if SYS_STATS
+static void
+stats_dump_syselem(struct stats_dump_ctx *ctx, struct stats_syselem *elem, const char *name)
+{
+  stats_dump_begin(ctx, name);
+  stats_dump_u32(ctx, "used", (u32_t)elem->used, 1);
+  stats_dump_u32(ctx, "max", (u32_t)elem->max, 0);
+  stats_dump_u32(ctx, "err", (u32_t)elem->err, 0);
+  stats_dump_end(ctx);
+}
+#endif /* SYS_STATS */
+
+/**
+ * Write all enabled counters through 'out', either as one JSON object or
+ * as one text line per protocol, heap, pool and sys element.
+ *
+ * The counters are read without locking, so a dump taken under load may
+ * mix values from slightly different instants.
+ *
+ * @param out called for each formatted piece of the output
+ * @param arg passed to 'out'
+ * @param json 1 for JSON, 0 for text
+ */
+void
+stats_dump(stats_out_fn out, void *arg, u8_t json)
+{
+  struct stats_dump_ctx ctx;
+#if MEMP_STATS
+  static const char * const memp_names[] = {
+#define LWIP_MEMPOOL(name,num,size,desc) desc,
+#include "lwip/memp_std.h"
+  };
+  int i;
+#endif /* MEMP_STATS */
+
+  ctx.out = out;
+  ctx.arg = arg;
+  ctx.json = json;
+  ctx.first = 1;
+
+  if (json) {
+    out(arg, "{");
+  }
+#if LINK_STATS
+  stats_dump_proto(&ctx, &lwip_stats.link, "link");
+#endif
+#if ETHARP_STATS
+  stats_dump_proto(&ctx, &lwip_stats.etharp, "etharp");
+#endif
+#if IPFRAG_STATS
+  stats_dump_proto(&ctx, &lwip_stats.ip_frag, "ip_frag");
+#endif
+#if IP_STATS
+  stats_dump_proto(&ctx, &lwip_stats.ip, "ip");
+#endif
+#if ICMP_STATS
+  stats_dump_proto(&ctx, &lwip_stats.icmp, "icmp");
+#endif
+#if UDP_STATS
+  stats_dump_proto(&ctx, &lwip_stats.udp, "udp");
+#endif
+#if TCP_STATS
+  stats_dump_proto(&ctx, &lwip_stats.tcp, "tcp");
+#endif
+#if MEM_STATS
+  stats_dump_mem(&ctx, &lwip_stats.mem, "heap");
+#endif
+#if MEMP_STATS
+  if (json) {
+    out(arg, ctx.first ? "\"memp\":{" : ",\"memp\":{");
+    ctx.first = 1;
+  }
+  for (i = 0; i < MEMP_MAX; i++) {
+    stats_dump_mem(&ctx, &lwip_stats.memp[i], memp_names[i]);
+  }
+  if (json) {
+    out(arg, "}");
+  }
+  ctx.first = 0;
+#endif /* MEMP_STATS */
+#if SYS_STATS
+  stats_dump_syselem(&ctx, &lwip_stats.sys.sem, "sem");
+  stats_dump_syselem(&ctx, &lwip_stats.sys.mutex, "mutex");
+  stats_dump_syselem(&ctx, &lwip_stats.sys.mbox, "mbox");
+#endif /* SYS_STATS */
+  if (json) {
+    out(arg, "}");
+  }
+}
+
+#if MEM_STATS || MEMP_STATS
+static void
+stats_reset_mem(struct stats_mem *mem)
+{
+  mem->max = mem->used;
+  mem->err = 0;
+  mem->illegal = 0;
+#if LWIP_STATS_HIST
+  memset(mem->hist, 0, sizeof(mem->hist));
+#endif /* LWIP_STATS_HIST */
+}
+#endif /* MEM_STATS || MEMP_STATS */
+
+/**
+ * Clear the event counters and histograms and restart the peaks from the
+ * current levels. 'avail' and 'used' are state, not events, and are kept.
+ */
+void
+stats_reset(void)
+{
+#if MEMP_STATS
+  int i;
+#endif /* MEMP_STATS */
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+#if LINK_STATS
+  memset(&lwip_stats.link, 0, sizeof(lwip_stats.link));
+#endif
+#if ETHARP_STATS
+  memset(&lwip_stats.etharp, 0, sizeof(lwip_stats.etharp));
+#endif
+#if IPFRAG_STATS
+  memset(&lwip_stats.ip_frag, 0, sizeof(lwip_stats.ip_frag));
+#endif
+#if IP_STATS
+  memset(&lwip_stats.ip, 0, sizeof(lwip_stats.ip));
+#endif
+#if ICMP_STATS
+  memset(&lwip_stats.icmp, 0, sizeof(lwip_stats.icmp));
+#endif
+#if IGMP_STATS
+  memset(&lwip_stats.igmp, 0, sizeof(lwip_stats.igmp));
+#endif
+#if UDP_STATS
+  memset(&lwip_stats.udp, 0, sizeof(lwip_stats.udp));
+#endif
+#if TCP_STATS
+  memset(&lwip_stats.tcp, 0, sizeof(lwip_stats.tcp));
+#endif
+#if MEM_STATS
+  stats_reset_mem(&lwip_stats.mem);
+#endif
+#if MEMP_STATS
+  for (i = 0; i < MEMP_MAX; i++) {
+    stats_reset_mem(&lwip_stats.memp[i]);
+  }
+#endif /* MEMP_STATS */
+#if SYS_STATS
+  lwip_stats.sys.sem.max = lwip_stats.sys.sem.used;
+  lwip_stats.sys.sem.err = 0;
+  lwip_stats.sys.mutex.max = lwip_stats.sys.mutex.used;
+  lwip_stats.sys.mutex.err = 0;
+  lwip_stats.sys.mbox.max = lwip_stats.sys.mbox.used;
+  lwip_stats.sys.mbox.err = 0;
+#endif /* SYS_STATS */
+  SYS_ARCH_UNPROTECT(lev);
+}
+#endif /* LWIP_STATS_DUMP */
+
 #endif /* LWIP_STATS */
 
@@ -70,11 +70,18 @@ static u8_t recv_flags;
 static struct pbuf *recv_data;
 
 struct tcp_pcb *tcp_input_pcb;
+#if TCPIP_INPUT_BATCH
+u8_t tcp_ack_defer;
+#endif /* TCPIP_INPUT_BATCH */
 
 /* Forward declarations. */
 static err_t tcp_process(struct tcp_pcb *pcb);
 static void tcp_receive(struct tcp_pcb *pcb);
 static void tcp_parseopt(struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+static void tcp_sack_mark(struct tcp_pcb *pcb, u32_t left, u32_t right);
+static void tcp_sack_end_recovery(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK */
 
 static err_t tcp_listen_input(struct tcp_pcb_listen *pcb);
 static err_t tcp_timewait_input(struct tcp_pcb *pcb);
@@ -368,7 +375,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
           } else {
             /* correct rcv_wnd as the application won't call tcp_recved()
                for the FIN's seqno */
-            if (pcb->rcv_wnd != TCP_WND) {
+            if (pcb->rcv_wnd != TCP_WND_MAX(pcb)) {
               pcb->rcv_wnd++;
             }
             TCP_EVENT_CLOSED(pcb, err);
@@ -379,8 +386,16 @@ tcp_input(struct pbuf *p, struct netif *inp)
         }
 
         tcp_input_pcb = NULL;
-        /* Try to send something out. */
-        tcp_output(pcb);
+#if TCPIP_INPUT_BATCH
+        if (tcp_ack_defer && (pcb->unsent == NULL)) {
+          /* Nothing but an ACK to send: more segments of this burst may
+             follow, acknowledge them all at once in tcp_ack_flush(). */
+        } else
+#endif /* TCPIP_INPUT_BATCH */
+        {
+          /* Try to send something out. */
+          tcp_output(pcb);
+        }
 #if TCP_INPUT_DEBUG
 #if TCP_DEBUG
         tcp_debug_print_state(pcb->state);
@@ -424,6 +439,25 @@ dropped:
   pbuf_free(p);
 }
 
+#if TCPIP_INPUT_BATCH
+/**
+ * Send the ACKs that tcp_input() deferred while processing a batch of
+ * received packets. Called by the tcpip thread at the end of the batch.
+ */
+void
+tcp_ack_flush(void)
+{
+  struct tcp_pcb *pcb;
+
+  tcp_ack_defer = 0;
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    if (pcb->flags & TF_ACK_NOW) {
+      tcp_output(pcb);
+    }
+  }
+}
+#endif /* TCPIP_INPUT_BATCH */
+
 /**
  * Called by tcp_input() when a segment arrives for a listening
  * connection (from tcp_input()).
@@ -856,6 +890,10 @@ tcp_receive(struct tcp_pcb *pcb)
   u32_t right_wnd_edge;
   u16_t new_tot_len;
   int found_dupack = 0;
+#if LWIP_TCP_SACK
+  u8_t sack_partial = 0;
+  u8_t sack_gap = 0;
+#endif /* LWIP_TCP_SACK */
 #if TCP_OOSEQ_MAX_BYTES || TCP_OOSEQ_MAX_PBUFS
   u32_t ooseq_blen;
   u16_t ooseq_qlen;
@@ -869,12 +907,12 @@ tcp_receive(struct tcp_pcb *pcb)
     /* Update window. */
     if (TCP_SEQ_LT(pcb->snd_wl1, seqno) ||
        (pcb->snd_wl1 == seqno && TCP_SEQ_LT(pcb->snd_wl2, ackno)) ||
-       (pcb->snd_wl2 == ackno && tcphdr->wnd > pcb->snd_wnd)) {
-      pcb->snd_wnd = tcphdr->wnd;
+       (pcb->snd_wl2 == ackno && SND_WND_SCALE(pcb, tcphdr->wnd) > pcb->snd_wnd)) {
+      pcb->snd_wnd = SND_WND_SCALE(pcb, tcphdr->wnd);
       /* keep track of the biggest window announced by the remote host to calculate
          the maximum segment size */
-      if (pcb->snd_wnd_max < tcphdr->wnd) {
-        pcb->snd_wnd_max = tcphdr->wnd;
+      if (pcb->snd_wnd_max < pcb->snd_wnd) {
+        pcb->snd_wnd_max = pcb->snd_wnd;
       }
       pcb->snd_wl1 = seqno;
       pcb->snd_wl2 = ackno;
@@ -888,10 +926,10 @@ tcp_receive(struct tcp_pcb *pcb)
         /* stop persist timer */
           pcb->persist_backoff = 0;
       }
-      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"U16_F"\n", pcb->snd_wnd));
+      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"TCPWNDSIZE_F"\n", pcb->snd_wnd));
 #if TCP_WND_DEBUG
     } else {
-      if (pcb->snd_wnd != tcphdr->wnd) {
+      if (pcb->snd_wnd != SND_WND_SCALE(pcb, tcphdr->wnd)) {
         LWIP_DEBUGF(TCP_WND_DEBUG, 
                     ("tcp_receive: no window update lastack %"U32_F" ackno %"
                      U32_F" wl1 %"U32_F" seqno %"U32_F" wl2 %"U32_F"\n",
@@ -938,9 +976,16 @@ tcp_receive(struct tcp_pcb *pcb)
               if (pcb->dupacks > 3) {
                 /* Inflate the congestion window, but not if it means that
                    the value overflows. */
-                if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
+                if ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
                   pcb->cwnd += pcb->mss;
                 }
+#if LWIP_TCP_SACK
+                /* Each further dupack means another segment left the
+                   network: fill the next hole the peer reported. */
+                if ((pcb->flags & (TF_INFR | TF_SACK)) == (TF_INFR | TF_SACK)) {
+                  tcp_rexmit_sack(pcb);
+                }
+#endif /* LWIP_TCP_SACK */
               } else if (pcb->dupacks == 3) {
                 /* Do fast retransmit */
                 tcp_rexmit_fast(pcb);
@@ -961,7 +1006,19 @@ tcp_receive(struct tcp_pcb *pcb)
          in fast retransmit. Also reset the congestion window to the
          slow start threshold. */
       if (pcb->flags & TF_INFR) {
-        pcb->flags &= ~TF_INFR;
+#if LWIP_TCP_SACK
+        /* A partial ACK below the highest SACKed sequence number means
+           there are more holes to fill: stay in recovery (RFC 6675). */
+        if ((pcb->flags & TF_SACK) && TCP_SEQ_LT(ackno, pcb->sack_high)) {
+          sack_partial = 1;
+        } else
+#endif /* LWIP_TCP_SACK */
+        {
+          pcb->flags &= ~TF_INFR;
+#if LWIP_TCP_SACK
+          tcp_sack_end_recovery(pcb);
+#endif /* LWIP_TCP_SACK */
+        }
         pcb->cwnd = pcb->ssthresh;
       }
 
@@ -984,16 +1041,16 @@ tcp_receive(struct tcp_pcb *pcb)
          ssthresh). */
       if (pcb->state >= ESTABLISHED) {
         if (pcb->cwnd < pcb->ssthresh) {
-          if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
+          if ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
             pcb->cwnd += pcb->mss;
           }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"U16_F"\n", pcb->cwnd));
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         } else {
-          u16_t new_cwnd = (pcb->cwnd + pcb->mss * pcb->mss / pcb->cwnd);
+          tcpwnd_size_t new_cwnd = (pcb->cwnd + pcb->mss * pcb->mss / pcb->cwnd);
           if (new_cwnd > pcb->cwnd) {
             pcb->cwnd = new_cwnd;
           }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"U16_F"\n", pcb->cwnd));
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         }
       }
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: ACK for %"U32_F", unacked->seqno %"U32_F":%"U32_F"\n",
@@ -1041,6 +1098,12 @@ tcp_receive(struct tcp_pcb *pcb)
         pcb->rtime = 0;
 
       pcb->polltmr = 0;
+
+#if LWIP_TCP_SACK
+      if (sack_partial) {
+        tcp_rexmit_sack(pcb);
+      }
+#endif /* LWIP_TCP_SACK */
     } else {
       /* Fix bug bug #21582: out of sequence ACK, didn't really ack anything */
       pcb->acked = 0;
@@ -1230,7 +1293,7 @@ tcp_receive(struct tcp_pcb *pcb)
             TCPH_FLAGS_SET(inseg.tcphdr, TCPH_FLAGS(inseg.tcphdr) &~ TCP_FIN);
           }
           /* Adjust length of segment to fit in the window. */
-          inseg.len = pcb->rcv_wnd;
+          inseg.len = (u16_t)pcb->rcv_wnd;
           if (TCPH_FLAGS(inseg.tcphdr) & TCP_SYN) {
             inseg.len -= 1;
           }
@@ -1240,6 +1303,9 @@ tcp_receive(struct tcp_pcb *pcb)
                       (seqno + tcplen) == (pcb->rcv_nxt + pcb->rcv_wnd));
         }
 #if TCP_QUEUE_OOSEQ
+#if LWIP_TCP_SACK
+        sack_gap = (pcb->ooseq != NULL);
+#endif /* LWIP_TCP_SACK */
         /* Received in-sequence data, adjust ooseq data if:
            - FIN has been received or
            - inseq overlaps with ooseq */
@@ -1362,11 +1428,28 @@ tcp_receive(struct tcp_pcb *pcb)
 
 
         /* Acknowledge the segment(s). */
-        tcp_ack(pcb);
+#if LWIP_TCP_SACK
+        if ((pcb->flags & TF_SACK) && sack_gap) {
+          /* The segment filled a hole: ACK it at once (RFC 5681, 4.2)
+             instead of leaving the sender in recovery for the delayed
+             ACK timer. */
+          tcp_ack_now(pcb);
+        } else
+#endif /* LWIP_TCP_SACK */
+        {
+          tcp_ack(pcb);
+        }
 
       } else {
         /* We get here if the incoming segment is out-of-sequence. */
-        tcp_send_empty_ack(pcb);
+#if LWIP_TCP_SACK
+        /* With SACK the duplicate ACK is sent once the segment is on
+           ->ooseq, so that it can be reported in the first SACK block. */
+        if (!(pcb->flags & TF_SACK))
+#endif /* LWIP_TCP_SACK */
+        {
+          tcp_send_empty_ack(pcb);
+        }
 #if TCP_QUEUE_OOSEQ
         /* We queue the segment on the ->ooseq queue. */
         if (pcb->ooseq == NULL) {
@@ -1475,7 +1558,7 @@ tcp_receive(struct tcp_pcb *pcb)
                       TCPH_FLAGS_SET(next->next->tcphdr, TCPH_FLAGS(next->next->tcphdr) &~ TCP_FIN);
                     }
                     /* Adjust length of segment to fit in the window. */
-                    next->next->len = pcb->rcv_nxt + pcb->rcv_wnd - seqno;
+                    next->next->len = (u16_t)(pcb->rcv_nxt + pcb->rcv_wnd - seqno);
                     pbuf_realloc(next->next->p, next->next->len);
                     tcplen = TCP_TCPLEN(next->next);
                     LWIP_ASSERT("tcp_receive: segment not trimmed correctly to rcv_wnd\n",
@@ -1513,6 +1596,12 @@ tcp_receive(struct tcp_pcb *pcb)
           }
         }
 #endif /* TCP_OOSEQ_MAX_BYTES || TCP_OOSEQ_MAX_PBUFS */
+#if LWIP_TCP_SACK
+        if (pcb->flags & TF_SACK) {
+          pcb->rcv_sack_last = seqno;
+          tcp_send_empty_ack(pcb);
+        }
+#endif /* LWIP_TCP_SACK */
 #endif /* TCP_QUEUE_OOSEQ */
       }
     } else {
@@ -1534,7 +1623,7 @@ tcp_receive(struct tcp_pcb *pcb)
  * Parses the options contained in the incoming segment. 
  *
  * Called from tcp_listen_input() and tcp_process().
- * Currently, only the MSS option is supported!
+ * Supported are MSS, timestamps, window scale and SACK.
  *
  * @param pcb the tcp_pcb for which a segment arrived
  */
@@ -1600,6 +1689,67 @@ tcp_parseopt(struct tcp_pcb *pcb)
         c += 0x0A;
         break;
 #endif
+#if LWIP_WND_SCALE
+      case 0x03:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: WND_SCALE\n"));
+        if (opts[c + 1] != 0x03 || c + 0x03 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        /* Only valid on SYN, and both sides must send it (RFC 7323) */
+        if ((flags & TCP_SYN) && !(pcb->flags & TF_WND_SCALE)) {
+          pcb->snd_scale = opts[c + 2];
+          if (pcb->snd_scale > 14) {
+            pcb->snd_scale = 14;
+          }
+          pcb->rcv_scale = TCP_RCV_SCALE;
+          pcb->flags |= TF_WND_SCALE;
+          /* window scaling is enabled, we can use the full receive window */
+          LWIP_ASSERT("window not at default value", pcb->rcv_wnd == TCPWND16(TCP_WND));
+          LWIP_ASSERT("window not at default value", pcb->rcv_ann_wnd == TCPWND16(TCP_WND));
+          pcb->rcv_wnd = pcb->rcv_ann_wnd = TCP_WND;
+        }
+        /* Advance to next option */
+        c += 0x03;
+        break;
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+      case 0x04:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK_PERM\n"));
+        if (opts[c + 1] != 0x02 || c + 0x02 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        if (flags & TCP_SYN) {
+          pcb->flags |= TF_SACK;
+        }
+        /* Advance to next option */
+        c += 0x02;
+        break;
+      case 0x05:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK\n"));
+        if (opts[c + 1] < 0x0A || ((opts[c + 1] - 2) & 0x07) != 0 ||
+            c + opts[c + 1] > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return;
+        }
+        if ((pcb->flags & TF_SACK) && (flags & TCP_ACK)) {
+          u16_t b;
+          for (b = c + 2; b < c + opts[c + 1]; b += 8) {
+            u32_t left = ((u32_t)opts[b] << 24) | ((u32_t)opts[b + 1] << 16) |
+                         ((u32_t)opts[b + 2] << 8) | opts[b + 3];
+            u32_t right = ((u32_t)opts[b + 4] << 24) | ((u32_t)opts[b + 5] << 16) |
+                          ((u32_t)opts[b + 6] << 8) | opts[b + 7];
+            tcp_sack_mark(pcb, left, right);
+          }
+        }
+        /* Advance to next option */
+        c += opts[c + 1];
+        break;
+#endif /* LWIP_TCP_SACK */
       default:
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: other\n"));
         if (opts[c + 1] == 0) {
@@ -1616,4 +1766,66 @@ tcp_parseopt(struct tcp_pcb *pcb)
   }
 }
 
+#if LWIP_TCP_SACK
+/**
+ * Mark the segments on pcb->unacked that are completely covered by a
+ * SACK block reported by the peer, so that they are skipped during
+ * loss recovery.
+ *
+ * @param pcb the tcp_pcb the SACK block was received for
+ * @param left first sequence number of the block
+ * @param right sequence number following the last byte of the block
+ */
+static void
+tcp_sack_mark(struct tcp_pcb *pcb, u32_t left, u32_t right)
+{
+  struct tcp_seg *seg;
+  u32_t seqno;
+
+  if (TCP_SEQ_LEQ(right, left) || TCP_SEQ_GT(right, pcb->snd_nxt)) {
+    /* invalid or stale block */
+    return;
+  }
+  if (TCP_SEQ_LT(pcb->sack_high, pcb->lastack)) {
+    pcb->sack_high = pcb->lastack;
+  }
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    seqno = ntohl(seg->tcphdr->seqno);
+    if (TCP_SEQ_GT(seqno + TCP_TCPLEN(seg), right)) {
+      /* unacked is sorted, nothing further can be covered */
+      break;
+    }
+    if (TCP_SEQ_GEQ(seqno, left)) {
+      seg->flags |= TF_SEG_SACKED;
+    }
+  }
+
+  if (TCP_SEQ_GT(right, pcb->sack_high)) {
+    pcb->sack_high = right;
+  }
+  LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_mark: %"U32_F":%"U32_F" high %"U32_F"\n",
+                             left, right, pcb->sack_high));
+}
+
+/**
+ * Fast recovery is over: the segments retransmitted during it may be
+ * lost again and must be eligible for the next recovery.
+ *
+ * @param pcb the tcp_pcb that left fast recovery
+ */
+static void
+tcp_sack_end_recovery(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    seg->flags &= ~TF_SEG_SACK_REXMIT;
+  }
+  for (seg = pcb->unsent; seg != NULL; seg = seg->next) {
+    seg->flags &= ~TF_SEG_SACK_REXMIT;
+  }
+}
+#endif /* LWIP_TCP_SACK */
+
 #endif /* LWIP_TCP */
@@ -109,7 +109,7 @@ tcp_output_alloc_header(struct tcp_pcb *pcb, u16_t optlen, u16_t datalen,
     tcphdr->seqno = seqno_be;
     tcphdr->ackno = htonl(pcb->rcv_nxt);
     TCPH_HDRLEN_FLAGS_SET(tcphdr, (5 + optlen / 4), TCP_ACK);
-    tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+    tcphdr->wnd = htons(TCPWND16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
     tcphdr->chksum = 0;
     tcphdr->urgp = 0;
 
@@ -490,7 +490,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
 #endif /* TCP_CHECKSUM_ON_COPY */
   err_t err;
   /* don't allocate segments bigger than half the maximum window we ever received */
-  u16_t mss_local = LWIP_MIN(pcb->mss, pcb->snd_wnd_max/2);
+  u16_t mss_local = (u16_t)LWIP_MIN(pcb->mss, pcb->snd_wnd_max/2);
 
 #if LWIP_NETIF_TX_SINGLE_PBUF
   /* Always copy to try to create single pbufs for TX */
@@ -862,6 +862,19 @@ tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags)
 
   if (flags & TCP_SYN) {
     optflags = TF_SEG_OPTS_MSS;
+#if LWIP_WND_SCALE
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_WND_SCALE)) {
+      /* In a <SYN,ACK> (sent in state SYN_RCVD), the window scale option
+         may only be sent if we received one from the remote host. */
+      optflags |= TF_SEG_OPTS_WND_SCALE;
+    }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_SACK)) {
+      /* Same for SACK permitted */
+      optflags |= TF_SEG_OPTS_SACK_PERM;
+    }
+#endif /* LWIP_TCP_SACK */
   }
 #if LWIP_TCP_TIMESTAMPS
   if ((pcb->flags & TF_TIMESTAMP)) {
@@ -954,6 +967,47 @@ tcp_build_timestamp_option(struct tcp_pcb *pcb, u32_t *opts)
 }
 #endif
 
+#if LWIP_TCP_SACK
+/**
+ * Describe the data held on pcb->ooseq as SACK blocks (RFC 2018).
+ * Contiguous segments are merged into one block. The block holding the
+ * most recently queued segment comes first, the others follow in
+ * ascending order.
+ *
+ * @param pcb the tcp_pcb to report the out-of-sequence data of
+ * @param blocks receives left/right edge pairs in network byte order
+ * @param max_blocks number of pairs that fit into blocks
+ * @return number of blocks written
+ */
+static u8_t
+tcp_build_sack_blocks(struct tcp_pcb *pcb, u32_t *blocks, u8_t max_blocks)
+{
+  struct tcp_seg *seg;
+  u32_t left, right;
+  u8_t n = 0;
+  u8_t pass, latest;
+
+  for (pass = 0; pass < 2; pass++) {
+    seg = pcb->ooseq;
+    while (seg != NULL && n < max_blocks) {
+      /* ooseq headers have already been converted to host byte order */
+      left = seg->tcphdr->seqno;
+      right = left + TCP_TCPLEN(seg);
+      for (seg = seg->next; seg != NULL && seg->tcphdr->seqno == right; seg = seg->next) {
+        right += TCP_TCPLEN(seg);
+      }
+      latest = TCP_SEQ_GEQ(pcb->rcv_sack_last, left) && TCP_SEQ_LT(pcb->rcv_sack_last, right);
+      if (latest == (pass == 0)) {
+        blocks[2 * n] = htonl(left);
+        blocks[2 * n + 1] = htonl(right);
+        n++;
+      }
+    }
+  }
+  return n;
+}
+#endif /* LWIP_TCP_SACK */
+
 /** Send an ACK without data.
  *
  * @param pcb Protocol control block for the TCP connection to send the ACK
@@ -964,12 +1018,29 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   struct pbuf *p;
   struct tcp_hdr *tcphdr;
   u8_t optlen = 0;
+#if LWIP_TCP_SACK
+  /* no more than 4 blocks fit into the option space */
+  u32_t sack_blocks[2 * 4];
+  u8_t sack_num = 0;
+  u8_t sack_max = LWIP_MIN(LWIP_TCP_MAX_SACK_NUM, 4);
+#endif /* LWIP_TCP_SACK */
 
 #if LWIP_TCP_TIMESTAMPS
   if (pcb->flags & TF_TIMESTAMP) {
     optlen = LWIP_TCP_OPT_LENGTH(TF_SEG_OPTS_TS);
+#if LWIP_TCP_SACK
+    sack_max = LWIP_MIN(sack_max, 3);
+#endif /* LWIP_TCP_SACK */
   }
 #endif
+#if LWIP_TCP_SACK
+  if ((pcb->flags & TF_SACK) && (pcb->ooseq != NULL)) {
+    sack_num = tcp_build_sack_blocks(pcb, sack_blocks, sack_max);
+    if (sack_num > 0) {
+      optlen += 4 + 8 * sack_num;
+    }
+  }
+#endif /* LWIP_TCP_SACK */
 
   p = tcp_output_alloc_header(pcb, optlen, 0, htonl(pcb->snd_nxt));
   if (p == NULL) {
@@ -991,6 +1062,23 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   }
 #endif 
 
+#if LWIP_TCP_SACK
+  if (sack_num > 0) {
+    u32_t *opts = (u32_t *)(void *)(tcphdr + 1);
+    u8_t i;
+#if LWIP_TCP_TIMESTAMPS
+    if (pcb->flags & TF_TIMESTAMP) {
+      opts += 3;
+    }
+#endif
+    /* NOP, NOP, SACK, length */
+    *opts++ = htonl(0x01010500UL | (2 + 8 * sack_num));
+    for (i = 0; i < 2 * sack_num; i++) {
+      *opts++ = sack_blocks[i];
+    }
+  }
+#endif /* LWIP_TCP_SACK */
+
 #if CHECKSUM_GEN_TCP
   tcphdr->chksum = inet_chksum_pseudo(p, &(pcb->local_ip), &(pcb->remote_ip),
         IP_PROTO_TCP, p->tot_len);
@@ -1036,6 +1124,15 @@ tcp_output(struct tcp_pcb *pcb)
   }
 
   wnd = LWIP_MIN(pcb->snd_wnd, pcb->cwnd);
+#if LWIP_TCP_SACK
+  if ((pcb->flags & TF_SACK) && (pcb->dupacks > 0) && (pcb->dupacks < 3) &&
+      !(pcb->flags & TF_INFR)) {
+    /* Limited transmit (RFC 3042): each of the first two dupacks lets one
+       new segment out, so that a small window still gets the three
+       dupacks (and SACK blocks) that start fast recovery. */
+    wnd = LWIP_MIN(pcb->snd_wnd, pcb->cwnd + pcb->dupacks * pcb->mss);
+  }
+#endif /* LWIP_TCP_SACK */
 
   seg = pcb->unsent;
 
@@ -1065,13 +1162,13 @@ tcp_output(struct tcp_pcb *pcb)
 #endif /* TCP_OUTPUT_DEBUG */
 #if TCP_CWND_DEBUG
   if (seg == NULL) {
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F
-                                 ", cwnd %"U16_F", wnd %"U32_F
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F
+                                 ", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                                  ", seg == NULL, ack %"U32_F"\n",
                                  pcb->snd_wnd, pcb->cwnd, wnd, pcb->lastack));
   } else {
     LWIP_DEBUGF(TCP_CWND_DEBUG, 
-                ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F
+                ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                  ", effwnd %"U32_F", seq %"U32_F", ack %"U32_F"\n",
                  pcb->snd_wnd, pcb->cwnd, wnd,
                  ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len,
@@ -1095,7 +1192,7 @@ tcp_output(struct tcp_pcb *pcb)
       break;
     }
 #if TCP_CWND_DEBUG
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
                             pcb->snd_wnd, pcb->cwnd, wnd,
                             ntohl(seg->tcphdr->seqno) + seg->len -
                             pcb->lastack,
@@ -1180,7 +1277,16 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   seg->tcphdr->ackno = htonl(pcb->rcv_nxt);
 
   /* advertise our receive window size in this TCP segment */
-  seg->tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+#if LWIP_WND_SCALE
+  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
+    /* The Window field of a SYN segment (the only one carrying the
+       window scale option) is never scaled. */
+    seg->tcphdr->wnd = htons(TCPWND16(pcb->rcv_ann_wnd));
+  } else
+#endif /* LWIP_WND_SCALE */
+  {
+    seg->tcphdr->wnd = htons(TCPWND16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
+  }
 
   pcb->rcv_ann_right_edge = pcb->rcv_nxt + pcb->rcv_ann_wnd;
 
@@ -1197,6 +1303,18 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
     *opts = TCP_BUILD_MSS_OPTION(mss);
     opts += 1;
   }
+#if LWIP_WND_SCALE
+  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
+    *opts = TCP_BUILD_WND_SCALE_OPTION();
+    opts += 1;
+  }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+  if (seg->flags & TF_SEG_OPTS_SACK_PERM) {
+    *opts = TCP_BUILD_SACK_PERM_OPTION();
+    opts += 1;
+  }
+#endif /* LWIP_TCP_SACK */
 #if LWIP_TCP_TIMESTAMPS
   pcb->ts_lastacksent = pcb->rcv_nxt;
 
@@ -1332,7 +1450,7 @@ tcp_rst(u32_t seqno, u32_t ackno,
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
   TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN/4, TCP_RST | TCP_ACK);
-  tcphdr->wnd = PP_HTONS(TCP_WND);
+  tcphdr->wnd = PP_HTONS(TCPWND16(TCP_WND));
   tcphdr->chksum = 0;
   tcphdr->urgp = 0;
 
@@ -1364,6 +1482,15 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
     return;
   }
 
+#if LWIP_TCP_SACK
+  /* Forget the SACK scoreboard: the peer may have discarded the data it
+     reported (RFC 2018, section 8), so everything is resent. */
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    seg->flags &= ~(TF_SEG_SACKED | TF_SEG_SACK_REXMIT);
+  }
+  pcb->sack_high = pcb->lastack;
+#endif /* LWIP_TCP_SACK */
+
   /* Move all unacked segments to the head of the unsent queue */
   for (seg = pcb->unacked; seg->next != NULL; seg = seg->next);
   /* concatenate unsent queue after unacked queue */
@@ -1385,27 +1512,17 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
 }
 
 /**
- * Requeue the first unacked segment for retransmission
- *
- * Called by tcp_receive() for fast retramsmit.
+ * Insert a segment taken off the unacked queue into the unsent queue,
+ * keeping the unsent queue sorted.
  *
- * @param pcb the tcp_pcb for which to retransmit the first unacked segment
+ * @param pcb the tcp_pcb the segment belongs to
+ * @param seg the segment to retransmit
  */
-void
-tcp_rexmit(struct tcp_pcb *pcb)
+static void
+tcp_rexmit_requeue(struct tcp_pcb *pcb, struct tcp_seg *seg)
 {
-  struct tcp_seg *seg;
   struct tcp_seg **cur_seg;
 
-  if (pcb->unacked == NULL) {
-    return;
-  }
-
-  /* Move the first unacked segment to the unsent queue */
-  /* Keep the unsent queue sorted. */
-  seg = pcb->unacked;
-  pcb->unacked = seg->next;
-
   cur_seg = &(pcb->unsent);
   while (*cur_seg &&
     TCP_SEQ_LT(ntohl((*cur_seg)->tcphdr->seqno), ntohl(seg->tcphdr->seqno))) {
@@ -1419,6 +1536,31 @@ tcp_rexmit(struct tcp_pcb *pcb)
     pcb->unsent_oversize = 0;
   }
 #endif /* TCP_OVERSIZE */
+}
+
+/**
+ * Requeue the first unacked segment for retransmission
+ *
+ * Called by tcp_receive() for fast retramsmit.
+ *
+ * @param pcb the tcp_pcb for which to retransmit the first unacked segment
+ */
+void
+tcp_rexmit(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+
+  if (pcb->unacked == NULL) {
+    return;
+  }
+
+  /* Move the first unacked segment to the unsent queue */
+  seg = pcb->unacked;
+  pcb->unacked = seg->next;
+#if LWIP_TCP_SACK
+  seg->flags |= TF_SEG_SACK_REXMIT;
+#endif /* LWIP_TCP_SACK */
+  tcp_rexmit_requeue(pcb, seg);
 
   ++pcb->nrtx;
 
@@ -1431,6 +1573,46 @@ tcp_rexmit(struct tcp_pcb *pcb)
      and thus tcp_output directly returns. */
 }
 
+#if LWIP_TCP_SACK
+/**
+ * Requeue the first segment below the highest SACKed sequence number
+ * that the peer has not reported and that was not yet retransmitted
+ * during this recovery.
+ *
+ * Called by tcp_receive() for every further dupack or partial ACK while
+ * in fast recovery.
+ *
+ * @param pcb the tcp_pcb for which to fill the next hole
+ * @return 1 if a segment was requeued, 0 if there is no hole left
+ */
+u8_t
+tcp_rexmit_sack(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  struct tcp_seg **prev;
+
+  for (prev = &pcb->unacked; (seg = *prev) != NULL; prev = &seg->next) {
+    if (TCP_SEQ_GEQ(ntohl(seg->tcphdr->seqno), pcb->sack_high)) {
+      break;
+    }
+    if ((seg->flags & (TF_SEG_SACKED | TF_SEG_SACK_REXMIT)) == 0) {
+      LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_rexmit_sack: hole at %"U32_F" (high %"U32_F")\n",
+                                 ntohl(seg->tcphdr->seqno), pcb->sack_high));
+      *prev = seg->next;
+      seg->flags |= TF_SEG_SACK_REXMIT;
+      tcp_rexmit_requeue(pcb, seg);
+
+      /* Don't take any rtt measurements after retransmitting. */
+      pcb->rttest = 0;
+
+      snmp_inc_tcpretranssegs();
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* LWIP_TCP_SACK */
+
 
 /**
  * Handle retransmission after three dupacks received
@@ -1460,7 +1642,7 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
     /* The minimum value for ssthresh should be 2 MSS */
     if (pcb->ssthresh < 2*pcb->mss) {
       LWIP_DEBUGF(TCP_FR_DEBUG, 
-                  ("tcp_receive: The minimum value for ssthresh %"U16_F
+                  ("tcp_receive: The minimum value for ssthresh %"TCPWNDSIZE_F
                    " should be min 2 mss %"U16_F"...\n",
                    pcb->ssthresh, 2*pcb->mss));
       pcb->ssthresh = 2*pcb->mss;
@@ -1468,6 +1650,11 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
     
     pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
     pcb->flags |= TF_INFR;
+#if LWIP_TCP_SACK
+  } else if ((pcb->flags & (TF_INFR | TF_SACK)) == (TF_INFR | TF_SACK)) {
+    /* Still recovering from an earlier loss: fill the next hole */
+    tcp_rexmit_sack(pcb);
+#endif /* LWIP_TCP_SACK */
   } 
 }
 
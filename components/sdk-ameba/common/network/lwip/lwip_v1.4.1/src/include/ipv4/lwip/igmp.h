@@ -91,6 +91,7 @@ void   igmp_init(void);
 err_t  igmp_start(struct netif *netif);
 err_t  igmp_stop(struct netif *netif);
 void   igmp_report_groups(struct netif *netif);
+void   igmp_report_groups_leave(struct netif *netif);
 struct igmp_group *igmp_lookfor_group(struct netif *ifp, ip_addr_t *addr);
 void   igmp_input(struct pbuf *p, struct netif *inp, ip_addr_t *dest);
 err_t  igmp_joingroup(ip_addr_t *ifaddr, ip_addr_t *groupaddr);
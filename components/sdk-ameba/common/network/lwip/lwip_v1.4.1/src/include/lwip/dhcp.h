@@ -117,6 +117,8 @@ void dhcp_set_struct(struct netif *netif, struct dhcp *dhcp);
 void dhcp_cleanup(struct netif *netif);
 /** start DHCP configuration */
 err_t dhcp_start(struct netif *netif);
+/** start DHCP configuration by asking to keep a previous address (INIT-REBOOT) */
+err_t dhcp_start_reboot(struct netif *netif, ip_addr_t *addr);
 /** enforce early lease renewal (not needed normally)*/
 err_t dhcp_renew(struct netif *netif);
 /** release the DHCP lease, usually called before dhcp_stop()*/
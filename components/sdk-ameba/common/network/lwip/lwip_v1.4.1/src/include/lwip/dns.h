@@ -109,7 +109,13 @@ void           dns_setserver(u8_t numdns, ip_addr_t *dnsserver);
 ip_addr_t      dns_getserver(u8_t numdns);
 err_t          dns_gethostbyname(const char *hostname, ip_addr_t *addr,
                                  dns_found_callback found, void *callback_arg);
-void           dns_reset_ttl();
+void           dns_reset_ttl(void);
+err_t          dns_cache_add(const char *hostname, const ip_addr_t *addr, u32_t ttl);
+
+#if DNS_PINNED_HOSTS
+err_t          dns_pin(const char *hostname);
+void           dns_unpin(const char *hostname);
+#endif /* DNS_PINNED_HOSTS */
 
 #if DNS_LOCAL_HOSTLIST && DNS_LOCAL_HOSTLIST_IS_DYNAMIC
 int            dns_local_removehost(const char *hostname, const ip_addr_t *addr);
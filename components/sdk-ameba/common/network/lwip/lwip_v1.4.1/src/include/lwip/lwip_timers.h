@@ -69,6 +69,11 @@ struct sys_timeo {
   u32_t time;
   sys_timeout_handler h;
   void *arg;
+#if LWIP_TIMERS_WHEEL
+  struct sys_timeo **pprev; /* link pointing to this timeout in its wheel slot */
+  struct sys_timeo *hnext;  /* next timeout in the same (handler, arg) bucket */
+  u16_t slot;
+#endif /* LWIP_TIMERS_WHEEL */
 #if LWIP_DEBUG_TIMERNAMES
   const char* handler_name;
 #endif /* LWIP_DEBUG_TIMERNAMES */
@@ -92,6 +97,11 @@ void sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg);
 #endif /* LWIP_DEBUG_TIMERNAMES */
 
 void sys_untimeout(sys_timeout_handler handler, void *arg);
+#if LWIP_TIMERS_WHEEL
+/** Returned by sys_timeouts_sleeptime() when no timeout is pending */
+#define SYS_TIMEOUTS_SLEEPTIME_INFINITE 0xFFFFFFFF
+u32_t sys_timeouts_sleeptime(void);
+#endif /* LWIP_TIMERS_WHEEL */
 #if NO_SYS
 void sys_check_timeouts(void);
 void sys_restart_timeouts(void);
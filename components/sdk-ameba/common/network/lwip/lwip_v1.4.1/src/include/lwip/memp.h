@@ -34,6 +34,7 @@
 #define __LWIP_MEMP_H__
 
 #include "lwip/opt.h"
+#include "lwip/mem.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -107,6 +108,13 @@ void *memp_malloc(memp_t type);
 #endif
 void  memp_free(memp_t type, void *mem);
 
+#if MEMP_ELASTIC
+void  memp_elastic_tmr(void);
+void *memp_elastic_mem_malloc(mem_size_t size);
+void  memp_elastic_mem_free(void *rmem);
+u32_t memp_elastic_held(void);
+#endif /* MEMP_ELASTIC */
+
 #endif /* MEMP_MEM_MALLOC */
 
 #ifdef __cplusplus
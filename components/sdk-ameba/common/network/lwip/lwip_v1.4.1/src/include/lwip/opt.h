@@ -76,6 +76,43 @@
 #define NO_SYS_NO_TIMERS                0
 #endif
 
+/**
+ * LWIP_TIMERS_WHEEL==1: Keep the sys_timeout() timers in a hierarchical
+ * timing wheel instead of a sorted list, so that sys_timeout() and
+ * sys_untimeout() don't walk all pending timers. Timeouts due in the same
+ * millisecond are called in no particular order.
+ */
+#ifndef LWIP_TIMERS_WHEEL
+#define LWIP_TIMERS_WHEEL               0
+#endif
+
+/**
+ * LWIP_TIMERS_WHEEL_BITS: log2 of the number of slots per wheel level.
+ * LWIP_TIMERS_WHEEL_LEVELS: number of levels. The wheel spans
+ * 2^(BITS*LEVELS) milliseconds, 2^24 ms or about 4.66 hours with the
+ * defaults. A longer timeout waits in the farthest slot and is placed again
+ * from there, one extra cascade per turn of the wheel. As with the list,
+ * timeouts must be shorter than 2^31 ms (about 24.8 days).
+ */
+#ifndef LWIP_TIMERS_WHEEL_BITS
+#define LWIP_TIMERS_WHEEL_BITS          6
+#endif
+
+#ifndef LWIP_TIMERS_WHEEL_LEVELS
+#define LWIP_TIMERS_WHEEL_LEVELS        4
+#endif
+
+/**
+ * LWIP_TIMERS_HASH_SIZE: number of (handler, arg) hash buckets searched by
+ * sys_untimeout() when LWIP_TIMERS_WHEEL==1. Must be a power of 2.
+ * Cancelling and expiring a timeout walk its bucket, about
+ * MEMP_NUM_SYS_TIMEOUT / LWIP_TIMERS_HASH_SIZE entries: grow it with the
+ * number of timeouts kept pending.
+ */
+#ifndef LWIP_TIMERS_HASH_SIZE
+#define LWIP_TIMERS_HASH_SIZE           16
+#endif
+
 /**
  * MEMCPY: override this if you have a faster implementation at hand than the
  * one included in your C library
@@ -212,6 +249,54 @@
 #define LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT 0
 #endif
 
+/**
+ * MEMP_ELASTIC==1: When a memp pool is empty, borrow elements from a reserve
+ * allocated with MEMP_ELASTIC_ALLOC() instead of failing. Freed borrowed
+ * elements are kept for the next burst and given back by memp_elastic_tmr()
+ * once their pool did not need them for a whole MEMP_ELASTIC_TMR_INTERVAL.
+ * When the heap (mem.c) is full, mem_malloc() borrows from the same reserve.
+ * MEMP_ELASTIC_ALLOC(size) and MEMP_ELASTIC_FREE(ptr) must be defined and
+ * return MEM_ALIGNMENT aligned memory. Not for use with MEMP_MEM_MALLOC or
+ * MEMP_OVERFLOW_CHECK.
+ */
+#ifndef MEMP_ELASTIC
+#define MEMP_ELASTIC                    0
+#endif
+
+/**
+ * MEMP_ELASTIC_RESERVE: Maximum number of bytes the pools and the heap may
+ * hold from the reserve at the same time.
+ */
+#ifndef MEMP_ELASTIC_RESERVE
+#define MEMP_ELASTIC_RESERVE            (8*1024)
+#endif
+
+/**
+ * MEMP_ELASTIC_MAX(name, num): Maximum number of elements pool 'name' (with
+ * 'num' static elements) may borrow. Cap the pools that are filled from
+ * outside the stack (PBUF_POOL for RX) so that they cannot use up the
+ * reserve needed on the TX side, e.g.
+ * #define MEMP_ELASTIC_MAX(name, num) (MEMP_##name == MEMP_PBUF_POOL ? (num)/2 : (num))
+ */
+#ifndef MEMP_ELASTIC_MAX
+#define MEMP_ELASTIC_MAX(name, num)     (num)
+#endif
+
+/**
+ * MEM_ELASTIC_MAX: Maximum number of bytes the heap may borrow.
+ */
+#ifndef MEM_ELASTIC_MAX
+#define MEM_ELASTIC_MAX                 (MEM_SIZE / 2)
+#endif
+
+/**
+ * MEMP_ELASTIC_TMR_INTERVAL: Idle time in milliseconds after which a pool
+ * gives its freed borrowed elements back.
+ */
+#ifndef MEMP_ELASTIC_TMR_INTERVAL
+#define MEMP_ELASTIC_TMR_INTERVAL       1000
+#endif
+
 /*
    ------------------------------------------------
    ---------- Internal Memory Pool Sizes ----------
@@ -863,6 +948,31 @@
 #define DNS_LOCAL_HOSTLIST_IS_DYNAMIC   0
 #endif /* DNS_LOCAL_HOSTLIST_IS_DYNAMIC */
 
+/** DNS_NEGATIVE_TTL: Seconds a "name does not exist" or "no A record" answer
+ *  is cached, so that dns_gethostbyname fails at once instead of asking the
+ *  server again. 0 disables negative caching. */
+#ifndef DNS_NEGATIVE_TTL
+#define DNS_NEGATIVE_TTL                0
+#endif /* DNS_NEGATIVE_TTL */
+
+/** DNS_PINNED_HOSTS: Number of host names that can be pinned with dns_pin().
+ *  Cached answers for pinned hosts are refreshed DNS_PREFETCH_TIME seconds
+ *  before their TTL expires and are recycled last when the table is full.
+ *
+ *  Each new answer for a pinned host is passed to
+ *  #define DNS_PINNED_UPDATE(name, addr, ttl) my_store_function(name, addr, ttl)
+ *  if defined, e.g. to keep it across reboot and give it back with
+ *  dns_cache_add(). */
+#ifndef DNS_PINNED_HOSTS
+#define DNS_PINNED_HOSTS                0
+#endif /* DNS_PINNED_HOSTS */
+
+/** DNS_PREFETCH_TIME: Remaining TTL in seconds at which a pinned host is
+ *  queried again. The cached address is served until the new answer arrives. */
+#ifndef DNS_PREFETCH_TIME
+#define DNS_PREFETCH_TIME               30
+#endif /* DNS_PREFETCH_TIME */
+
 /*
    ---------------------------------
    ---------- UDP options ----------
@@ -1060,6 +1170,40 @@
 #define LWIP_TCP_TIMESTAMPS             0
 #endif
 
+/**
+ * LWIP_WND_SCALE==1: support the TCP window scale option (RFC 7323).
+ * TCP_RCV_SCALE is the shift count announced for our receive window
+ * (0..14); TCP_WND may exceed 0xffff only when it is > 0. With
+ * TCP_RCV_SCALE 0, windows larger than 64KB can still be used for sending.
+ */
+#ifndef LWIP_WND_SCALE
+#define LWIP_WND_SCALE                  0
+#endif
+
+#ifndef TCP_RCV_SCALE
+#define TCP_RCV_SCALE                   0
+#endif
+
+/**
+ * LWIP_TCP_SACK==1: support selective acknowledgements (RFC 2018). SACK
+ * blocks describing the ooseq queue are sent with duplicate ACKs, and SACK
+ * blocks received from the peer let fast recovery retransmit only the
+ * segments that are missing. With a peer that permits SACK the first two
+ * dupacks also send new data (limited transmit, RFC 3042), and data that
+ * fills a hole is ACKed at once. Needs TCP_QUEUE_OOSEQ.
+ */
+#ifndef LWIP_TCP_SACK
+#define LWIP_TCP_SACK                   0
+#endif
+
+/**
+ * LWIP_TCP_MAX_SACK_NUM: The maximum number of SACK blocks sent in one
+ * ACK. At most 4 fit into the TCP header, 3 when timestamps are used.
+ */
+#ifndef LWIP_TCP_MAX_SACK_NUM
+#define LWIP_TCP_MAX_SACK_NUM           4
+#endif
+
 /**
  * TCP_WND_UPDATE_THRESHOLD: difference in window to trigger an
  * explicit window update
@@ -1268,6 +1412,18 @@
 #define TCPIP_MBOX_SIZE                 0
 #endif
 
+/**
+ * TCPIP_INPUT_BATCH==1: tcpip_input() queues received packets and posts
+ * a message to the tcpip thread only when the queue was empty, so a burst
+ * of packets costs one mbox post and one wakeup. The thread processes the
+ * whole queue at once and sends the TCP ACKs that became due in the burst
+ * after the last packet of it. The queue is bounded by
+ * MEMP_NUM_TCPIP_MSG_INPKT instead of TCPIP_MBOX_SIZE.
+ */
+#ifndef TCPIP_INPUT_BATCH
+#define TCPIP_INPUT_BATCH               0
+#endif
+
 /**
  * SLIPIF_THREAD_NAME: The name assigned to the slipif_loop thread.
  */
@@ -1482,6 +1638,24 @@
 #define RECV_BUFSIZE_DEFAULT            INT_MAX
 #endif
 
+/**
+ * LWIP_SOCKET_POLL==1: Enable the lwip_poll_create()/lwip_poll_ctl()/
+ * lwip_poll_wait() interest-list API. Socket events queue ready sockets
+ * on each interested poll set, so a wait costs per ready socket instead of
+ * per watched socket as with select().
+ */
+#ifndef LWIP_SOCKET_POLL
+#define LWIP_SOCKET_POLL                0
+#endif
+
+/**
+ * LWIP_SOCKET_POLL_SETS: the number of poll sets that can exist at the same
+ * time (max. 8).
+ */
+#ifndef LWIP_SOCKET_POLL_SETS
+#define LWIP_SOCKET_POLL_SETS           2
+#endif
+
 /**
  * SO_REUSE==1: Enable SO_REUSEADDR option.
  */
@@ -1599,6 +1773,32 @@
 #define SYS_STATS                       (NO_SYS == 0)
 #endif
 
+/**
+ * LWIP_STATS_HIST==1: Keep a fill-level histogram for the heap and for each
+ * memp pool. Every successful allocation counts one hit in the bucket for
+ * the level it left the pool at, so the buckets show how often a pool runs
+ * close to exhaustion, not only the single peak kept in 'max'.
+ */
+#ifndef LWIP_STATS_HIST
+#define LWIP_STATS_HIST                 0
+#endif
+
+/**
+ * LWIP_STATS_HIST_BUCKETS: Number of equal-width fill-level buckets of
+ * LWIP_STATS_HIST.
+ */
+#ifndef LWIP_STATS_HIST_BUCKETS
+#define LWIP_STATS_HIST_BUCKETS         8
+#endif
+
+/**
+ * LWIP_STATS_DUMP==1: Compile in stats_dump() (text or JSON through a
+ * caller supplied output function) and stats_reset().
+ */
+#ifndef LWIP_STATS_DUMP
+#define LWIP_STATS_DUMP                 0
+#endif
+
 #else
 
 #define LINK_STATS                      0
@@ -1613,6 +1813,8 @@
 #define SYS_STATS                       0
 #define LWIP_STATS_DISPLAY              0
 #define ETHARP_STATS                    0 //Realtek add
+#define LWIP_STATS_HIST                 0
+#define LWIP_STATS_DUMP                 0
 
 #endif /* LWIP_STATS */
 
@@ -343,6 +343,45 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
 int lwip_ioctl(int s, long cmd, void *argp);
 int lwip_fcntl(int s, int cmd, int val);
 
+#ifndef LWIP_IOV_MAX
+#define LWIP_IOV_MAX    8
+#endif
+#ifndef LWIP_IOV_COPY_MAX
+#define LWIP_IOV_COPY_MAX 64
+#endif
+
+/** One slice of a datagram for lwip_sendtov(), sent in place */
+struct lwip_iovec {
+  const void *iov_base;
+  u16_t iov_len;
+};
+
+int lwip_sendtov(int s, const struct lwip_iovec *iov, int iovcnt, int flags,
+    const struct sockaddr *to, socklen_t tolen);
+
+#if LWIP_SOCKET_POLL
+/* Events for lwip_poll_ctl() and lwip_poll_wait() */
+#define LWIP_POLLIN     0x01
+#define LWIP_POLLOUT    0x04
+#define LWIP_POLLERR    0x08 /* always reported, need not be requested */
+
+/* Operations for lwip_poll_ctl() */
+#define LWIP_POLL_CTL_ADD   1
+#define LWIP_POLL_CTL_DEL   2
+#define LWIP_POLL_CTL_MOD   3
+
+/** One ready socket returned by lwip_poll_wait() */
+struct lwip_poll_event {
+  int fd;
+  u8_t events;
+};
+
+int lwip_poll_create(void);
+int lwip_poll_close(int pfd);
+int lwip_poll_ctl(int pfd, int op, int s, u8_t events);
+int lwip_poll_wait(int pfd, struct lwip_poll_event *evs, int maxevents, int timeout);
+#endif /* LWIP_SOCKET_POLL */
+
 #if LWIP_COMPAT_SOCKETS
 #define accept(a,b,c)         lwip_accept(a,b,c)
 #define bind(a,b,c)           lwip_bind(a,b,c)
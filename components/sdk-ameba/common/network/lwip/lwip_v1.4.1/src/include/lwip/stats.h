@@ -96,6 +96,9 @@ struct stats_mem {
   mem_size_t max;
   STAT_COUNTER err;
   STAT_COUNTER illegal;
+#if LWIP_STATS_HIST
+  STAT_COUNTER hist[LWIP_STATS_HIST_BUCKETS];
+#endif
 };
 
 struct stats_syselem {
@@ -157,6 +160,20 @@ void stats_init(void);
                                     lwip_stats.x.max = lwip_stats.x.used; \
                                 } \
                              } while(0)
+#if LWIP_STATS_HIST
+/* bucket of the fill level after an allocation, used > 0 here */
+#define STATS_HIST(x) do { if (lwip_stats.x.avail != 0) { \
+                             u32_t b_ = ((u32_t)lwip_stats.x.used * LWIP_STATS_HIST_BUCKETS - 1) / \
+                                        lwip_stats.x.avail; \
+                             if (b_ >= LWIP_STATS_HIST_BUCKETS) { \
+                               b_ = LWIP_STATS_HIST_BUCKETS - 1; \
+                             } \
+                             ++lwip_stats.x.hist[b_]; \
+                           } \
+                         } while(0)
+#else
+#define STATS_HIST(x)
+#endif
 #else /* LWIP_STATS */
 #define stats_init()
 #define STATS_INC(x)
@@ -231,7 +248,7 @@ void stats_init(void);
 #if MEM_STATS
 #define MEM_STATS_AVAIL(x, y) lwip_stats.mem.x = y
 #define MEM_STATS_INC(x) STATS_INC(mem.x)
-#define MEM_STATS_INC_USED(x, y) STATS_INC_USED(mem, y)
+#define MEM_STATS_INC_USED(x, y) do { STATS_INC_USED(mem, y); STATS_HIST(mem); } while(0)
 #define MEM_STATS_DEC_USED(x, y) lwip_stats.mem.x -= y
 #define MEM_STATS_DISPLAY() stats_display_mem(&lwip_stats.mem, "HEAP")
 #else
@@ -246,7 +263,7 @@ void stats_init(void);
 #define MEMP_STATS_AVAIL(x, i, y) lwip_stats.memp[i].x = y
 #define MEMP_STATS_INC(x, i) STATS_INC(memp[i].x)
 #define MEMP_STATS_DEC(x, i) STATS_DEC(memp[i].x)
-#define MEMP_STATS_INC_USED(x, i) STATS_INC_USED(memp[i], 1)
+#define MEMP_STATS_INC_USED(x, i) do { STATS_INC_USED(memp[i], 1); STATS_HIST(memp[i]); } while(0)
 #define MEMP_STATS_DISPLAY(i) stats_display_memp(&lwip_stats.memp[i], i)
 #else
 #define MEMP_STATS_AVAIL(x, i, y)
@@ -285,6 +302,14 @@ void stats_display_sys(struct stats_sys *sys);
 #define stats_display_sys(sys)
 #endif /* LWIP_STATS_DISPLAY */
 
+#if LWIP_STATS_DUMP
+/** Output function of stats_dump(), called with one NUL terminated piece at a time */
+typedef void (*stats_out_fn)(void *arg, const char *s);
+
+void stats_dump(stats_out_fn out, void *arg, u8_t json);
+void stats_reset(void);
+#endif /* LWIP_STATS_DUMP */
+
 #ifdef __cplusplus
 }
 #endif
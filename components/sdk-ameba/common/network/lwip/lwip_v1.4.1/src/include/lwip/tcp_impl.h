@@ -69,6 +69,9 @@ err_t            tcp_send_empty_ack(struct tcp_pcb *pcb);
 void             tcp_rexmit  (struct tcp_pcb *pcb);
 void             tcp_rexmit_rto  (struct tcp_pcb *pcb);
 void             tcp_rexmit_fast (struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+u8_t             tcp_rexmit_sack (struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK */
 u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 err_t            tcp_process_refused_data(struct tcp_pcb *pcb);
 
@@ -292,18 +295,34 @@ struct tcp_seg {
 #define TF_SEG_OPTS_TS          (u8_t)0x02U /* Include timestamp option. */
 #define TF_SEG_DATA_CHECKSUMMED (u8_t)0x04U /* ALL data (not the header) is
                                                checksummed into 'chksum' */
+#define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include window scale option. */
+#define TF_SEG_OPTS_SACK_PERM   (u8_t)0x10U /* Include SACK permitted option. */
+#define TF_SEG_SACKED           (u8_t)0x20U /* Covered by a SACK block of the peer. */
+#define TF_SEG_SACK_REXMIT      (u8_t)0x40U /* Retransmitted in SACK recovery. */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
 #define LWIP_TCP_OPT_LENGTH(flags)              \
   (flags & TF_SEG_OPTS_MSS ? 4  : 0) +          \
+  (flags & TF_SEG_OPTS_WND_SCALE ? 4 : 0) +     \
+  (flags & TF_SEG_OPTS_SACK_PERM ? 4 : 0) +     \
   (flags & TF_SEG_OPTS_TS  ? 12 : 0)
 
 /** This returns a TCP header option for MSS in an u32_t */
 #define TCP_BUILD_MSS_OPTION(mss) htonl(0x02040000 | ((mss) & 0xFFFF))
+/** NOP + window scale option with our shift count in an u32_t */
+#define TCP_BUILD_WND_SCALE_OPTION() PP_HTONL(0x01030300 | (TCP_RCV_SCALE & 0xFF))
+/** NOP, NOP + SACK permitted option in an u32_t */
+#define TCP_BUILD_SACK_PERM_OPTION() PP_HTONL(0x01010402)
 
 /* Global variables: */
 extern struct tcp_pcb *tcp_input_pcb;
+#if TCPIP_INPUT_BATCH
+/* Set while the tcpip thread processes a batch of received packets:
+   pure ACKs are left to tcp_ack_flush() at the end of the batch. */
+extern u8_t tcp_ack_defer;
+void tcp_ack_flush(void);
+#endif /* TCPIP_INPUT_BATCH */
 extern u32_t tcp_ticks;
 extern u8_t tcp_active_pcbs_changed;
 
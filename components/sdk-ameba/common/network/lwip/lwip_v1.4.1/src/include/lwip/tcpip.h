@@ -143,6 +143,9 @@ struct tcpip_msg {
     struct {
       struct pbuf *p;
       struct netif *netif;
+#if TCPIP_INPUT_BATCH
+      struct tcpip_msg *next;
+#endif /* TCPIP_INPUT_BATCH */
     } inp;
     struct {
       tcpip_callback_fn function;
@@ -855,9 +855,6 @@ etharp_rarp_input(struct netif *netif, struct eth_addr *ethaddr, struct pbuf *p)
 {
 	struct etharp_hdr *hdr;
 	struct eth_hdr *ethhdr;
-#if LWIP_AUTOIP
-  	const u8_t * ethdst_hwaddr;
-#endif /* LWIP_AUTOIP */
 
   	LWIP_ERROR("netif != NULL", (netif != NULL), return;);
 
@@ -0,0 +1,459 @@
+/*
+ * Host harness for the AES dispatcher (mbedtls-2.4.0/library/rtl_crypto_dispatch.c)
+ * against a mocked crypto engine.
+ *
+ * The hw_crypto_aes_* entries of rom_ssl_ram_map are defined here and run
+ * the software kernels on the key the engine was last given, taking
+ * ENGINE_US per call. The mock checks what the real engine needs: a key
+ * loaded, a 4-byte aligned IV, whole blocks, at most RTL_CRYPTO_FRAGMENT
+ * bytes per call and one caller at a time.
+ *
+ * Build from this directory:
+ *
+ *   gcc -O2 -pthread -Ihost -I../mbedtls-2.4.0/include \
+ *       -I../ssl_ram_map/rom -I../../../../soc/realtek/common/bsp -I../../../../os/os_dep/include \
+ *       -o crypto_harness crypto_harness.c ../mbedtls-2.4.0/library/aes.c \
+ *       ../mbedtls-2.4.0/library/rtl_crypto_dispatch.c ../mbedtls-2.4.0/library/rtl_sw_crypto.c
+ *
+ * It runs:
+ *
+ *   kat      SP800-38A F.2.1 CBC-AES128, on the engine and in software
+ *   split    CBC of the lengths in crypto_lens with 128, 192 and 256 bit
+ *            keys, encrypted and decrypted in place, against a block by
+ *            block reference: output, chained IV, the path taken and the
+ *            number of engine calls
+ *   batch    TASKS threads with TASKS / 2 keys encrypt and decrypt BATCH_LEN
+ *            bytes ROUNDS times each: the requests queued while the engine
+ *            is busy run in one batch and a key already loaded is not
+ *            loaded again
+ *
+ * and exits with 1 on a wrong result, on an engine misuse or if fewer than
+ * a quarter of the requests were batched.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "device_lock.h"
+
+#include "mbedtls/aes.h"
+#include "mbedtls/rtl_crypto_dispatch.h"
+
+#define ENGINE_US		200
+#define BIG_LEN			( 3 * RTL_CRYPTO_FRAGMENT + 48 )
+#define TASKS			4
+#define ROUNDS			20
+#define BATCH_LEN		1024
+
+static const size_t crypto_lens[] = { 16, 32, 48, 64, 80, 1024, RTL_CRYPTO_FRAGMENT, BIG_LEN };
+
+static const unsigned char kat_key[16] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const unsigned char kat_iv[16] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const unsigned char kat_plain[64] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+static const unsigned char kat_cipher[64] = {
+	0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+	0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+	0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+	0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+
+/*-----------------------------------------------------------*/
+/* Host glue: critical sections and the device locks */
+
+static pthread_mutex_t critical = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t device_mutex[ RT_DEV_LOCK_MAX ] = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER
+};
+
+void vCryptoHarnessEnterCritical( void )
+{
+	pthread_mutex_lock( &critical );
+}
+
+void vCryptoHarnessExitCritical( void )
+{
+	pthread_mutex_unlock( &critical );
+}
+
+void device_mutex_lock( RT_DEV_LOCK_E device )
+{
+	pthread_mutex_lock( &device_mutex[ device ] );
+}
+
+void device_mutex_unlock( RT_DEV_LOCK_E device )
+{
+	pthread_mutex_unlock( &device_mutex[ device ] );
+}
+
+/*-----------------------------------------------------------*/
+/* The engine: the key of the last init and what it has been asked */
+
+static mbedtls_aes_context engine_enc, engine_dec;
+static int engine_key_set;
+static int engine_users;
+static uint32_t engine_calls, engine_inits, engine_max_len, engine_errors;
+
+static unsigned char crypto_plain[ BIG_LEN ], crypto_ref[ BIG_LEN ], crypto_buf[ BIG_LEN ];
+static unsigned char task_buf[ TASKS ][ 2 ][ BATCH_LEN ];
+static int task_errors;
+
+static int engine_init( const u8 *key, const u32 keylen )
+{
+	if( ( keylen != 16 && keylen != 24 && keylen != 32 ) ||
+		mbedtls_aes_setkey_enc( &engine_enc, key, keylen * 8 ) != 0 ||
+		mbedtls_aes_setkey_dec( &engine_dec, key, keylen * 8 ) != 0 )
+	{
+		printf( "engine given a %u byte key\n", keylen );
+		__sync_fetch_and_add( &engine_errors, 1 );
+		return -1;
+	}
+	engine_key_set = 1;
+	engine_inits++;
+	return 0;
+}
+
+static int engine_run( int cbc, int decrypt, const u8 *message, const u32 msglen,
+	const u8 *iv, const u32 ivlen, u8 *result )
+{
+	unsigned char chain[ 16 ], block[ 16 ];
+	u32 i, j;
+
+	if( __sync_fetch_and_add( &engine_users, 1 ) != 0 )
+	{
+		printf( "engine entered by two tasks\n" );
+		__sync_fetch_and_add( &engine_errors, 1 );
+	}
+	if( !engine_key_set || msglen == 0 || msglen % 16 != 0 || msglen > RTL_CRYPTO_FRAGMENT ||
+		( cbc && ( ivlen != 16 || ( ( uintptr_t ) iv & 3 ) != 0 ) ) )
+	{
+		printf( "engine misused: key %d, %u bytes, iv %u bytes at %p\n",
+			engine_key_set, msglen, ivlen, ( void * ) iv );
+		__sync_fetch_and_add( &engine_errors, 1 );
+		__sync_fetch_and_sub( &engine_users, 1 );
+		return -1;
+	}
+
+	if( cbc )
+		memcpy( chain, iv, 16 );
+	for( i = 0; i < msglen; i += 16 )
+	{
+		memcpy( block, message + i, 16 );
+		if( decrypt )
+		{
+			mbedtls_aes_decrypt( &engine_dec, block, result + i );
+			if( cbc )
+			{
+				for( j = 0; j < 16; j++ )
+					result[ i + j ] ^= chain[ j ];
+				memcpy( chain, block, 16 );
+			}
+		}
+		else
+		{
+			if( cbc )
+				for( j = 0; j < 16; j++ )
+					block[ j ] ^= chain[ j ];
+			mbedtls_aes_encrypt( &engine_enc, block, result + i );
+			if( cbc )
+				memcpy( chain, result + i, 16 );
+		}
+	}
+
+	engine_calls++;
+	if( msglen > engine_max_len )
+		engine_max_len = msglen;
+
+	/* The engine is busy meanwhile, other requests queue up */
+	usleep( ENGINE_US );
+	__sync_fetch_and_sub( &engine_users, 1 );
+	return 0;
+}
+
+static int engine_ecb_decrypt( const u8 *message, const u32 msglen, const u8 *iv, const u32 ivlen, u8 *result )
+{
+	return engine_run( 0, 1, message, msglen, iv, ivlen, result );
+}
+
+static int engine_ecb_encrypt( const u8 *message, const u32 msglen, const u8 *iv, const u32 ivlen, u8 *result )
+{
+	return engine_run( 0, 0, message, msglen, iv, ivlen, result );
+}
+
+static int engine_cbc_decrypt( const u8 *message, const u32 msglen, const u8 *iv, const u32 ivlen, u8 *result )
+{
+	return engine_run( 1, 1, message, msglen, iv, ivlen, result );
+}
+
+static int engine_cbc_encrypt( const u8 *message, const u32 msglen, const u8 *iv, const u32 ivlen, u8 *result )
+{
+	return engine_run( 1, 0, message, msglen, iv, ivlen, result );
+}
+
+struct _rom_ssl_ram_map rom_ssl_ram_map = {
+	.hw_crypto_aes_ecb_init = engine_init,
+	.hw_crypto_aes_ecb_decrypt = engine_ecb_decrypt,
+	.hw_crypto_aes_ecb_encrypt = engine_ecb_encrypt,
+	.hw_crypto_aes_cbc_init = engine_init,
+	.hw_crypto_aes_cbc_decrypt = engine_cbc_decrypt,
+	.hw_crypto_aes_cbc_encrypt = engine_cbc_encrypt,
+	.use_hw_crypto_func = 1,
+};
+
+/*-----------------------------------------------------------*/
+
+/* CBC block by block on the software kernels */
+static void cbc_ref( mbedtls_aes_context *ctx, size_t len, unsigned char iv[ 16 ],
+	const unsigned char *in, unsigned char *out )
+{
+	size_t i;
+	int j;
+
+	for( i = 0; i < len; i += 16 )
+	{
+		for( j = 0; j < 16; j++ )
+			out[ i + j ] = in[ i + j ] ^ iv[ j ];
+		mbedtls_aes_encrypt( ctx, out + i, out + i );
+		memcpy( iv, out + i, 16 );
+	}
+}
+
+static void fill( unsigned char *buf, size_t len, uint32_t seed )
+{
+	size_t i;
+
+	for( i = 0; i < len; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		buf[ i ] = ( unsigned char ) ( seed >> 16 );
+	}
+}
+
+static int run_kat( void )
+{
+	mbedtls_aes_context enc, dec;
+	unsigned char iv[ 16 ], buf[ 64 ];
+	uint32_t hw;
+	int ret = 0;
+
+	for( hw = 0; hw < 2; hw++ )
+	{
+		rom_ssl_ram_map.use_hw_crypto_func = hw;
+		mbedtls_aes_init( &enc );
+		mbedtls_aes_init( &dec );
+		mbedtls_aes_setkey_enc( &enc, kat_key, 128 );
+		mbedtls_aes_setkey_dec( &dec, kat_key, 128 );
+
+		memcpy( iv, kat_iv, 16 );
+		mbedtls_aes_crypt_cbc( &enc, MBEDTLS_AES_ENCRYPT, sizeof( kat_plain ), iv, kat_plain, buf );
+		if( memcmp( buf, kat_cipher, sizeof( buf ) ) != 0 || memcmp( iv, kat_cipher + 48, 16 ) != 0 )
+		{
+			printf( "kat: %s encrypt wrong\n", hw ? "engine" : "software" );
+			ret = -1;
+		}
+		memcpy( iv, kat_iv, 16 );
+		mbedtls_aes_crypt_cbc( &dec, MBEDTLS_AES_DECRYPT, sizeof( buf ), iv, buf, buf );
+		if( memcmp( buf, kat_plain, sizeof( buf ) ) != 0 || memcmp( iv, kat_cipher + 48, 16 ) != 0 )
+		{
+			printf( "kat: %s decrypt wrong\n", hw ? "engine" : "software" );
+			ret = -1;
+		}
+
+		mbedtls_aes_free( &enc );
+		mbedtls_aes_free( &dec );
+	}
+	rom_ssl_ram_map.use_hw_crypto_func = 1;
+
+	if( ret == 0 )
+		printf( "kat: SP800-38A CBC-AES128 right on the engine and in software\n" );
+	return ret;
+}
+
+/* One length and key size: encrypt, then decrypt in place */
+static int run_split_one( unsigned int keybits, size_t len )
+{
+	mbedtls_aes_context enc, dec;
+	unsigned char key[ 32 ], iv[ 16 ], iv_ref[ 16 ], iv0[ 16 ];
+	rtl_crypto_dispatch_stats st;
+	uint32_t calls, frags = ( len + RTL_CRYPTO_FRAGMENT - 1 ) / RTL_CRYPTO_FRAGMENT;
+	int hw = len >= RTL_CRYPTO_HW_MIN_LEN, ret = 0;
+
+	fill( key, sizeof( key ), keybits );
+	fill( iv0, sizeof( iv0 ), len );
+	fill( crypto_plain, len, keybits + len );
+
+	mbedtls_aes_init( &enc );
+	mbedtls_aes_init( &dec );
+	mbedtls_aes_setkey_enc( &enc, key, keybits );
+	mbedtls_aes_setkey_dec( &dec, key, keybits );
+
+	memcpy( iv_ref, iv0, 16 );
+	cbc_ref( &enc, len, iv_ref, crypto_plain, crypto_ref );
+
+	rtl_crypto_dispatch_reset_stats();
+	calls = engine_calls;
+	memcpy( iv, iv0, 16 );
+	mbedtls_aes_crypt_cbc( &enc, MBEDTLS_AES_ENCRYPT, len, iv, crypto_plain, crypto_buf );
+	if( memcmp( crypto_buf, crypto_ref, len ) != 0 || memcmp( iv, iv_ref, 16 ) != 0 )
+	{
+		printf( "split: aes%u %u bytes encrypt wrong\n", keybits, ( unsigned ) len );
+		ret = -1;
+	}
+
+	memcpy( iv, iv0, 16 );
+	mbedtls_aes_crypt_cbc( &dec, MBEDTLS_AES_DECRYPT, len, iv, crypto_buf, crypto_buf );
+	if( memcmp( crypto_buf, crypto_plain, len ) != 0 || memcmp( iv, iv_ref, 16 ) != 0 )
+	{
+		printf( "split: aes%u %u bytes decrypt in place wrong\n", keybits, ( unsigned ) len );
+		ret = -1;
+	}
+
+	rtl_crypto_dispatch_get_stats( &st );
+	calls = engine_calls - calls;
+	if( st.hw_ops != ( hw ? 2 : 0 ) || st.sw_ops != ( hw ? 0 : 2 ) ||
+		st.hw_fragments != ( hw ? 2 * frags : 0 ) || calls != st.hw_fragments )
+	{
+		printf( "split: aes%u %u bytes: %u engine and %u software requests, %u fragments, %u engine calls\n",
+			keybits, ( unsigned ) len, st.hw_ops, st.sw_ops, st.hw_fragments, calls );
+		ret = -1;
+	}
+
+	mbedtls_aes_free( &enc );
+	mbedtls_aes_free( &dec );
+	return ret;
+}
+
+static int run_split( void )
+{
+	unsigned int keybits;
+	size_t i;
+	int ret = 0;
+
+	engine_max_len = 0;
+	for( keybits = 128; keybits <= 256; keybits += 64 )
+		for( i = 0; i < sizeof( crypto_lens ) / sizeof( crypto_lens[ 0 ] ); i++ )
+			if( run_split_one( keybits, crypto_lens[ i ] ) != 0 )
+				ret = -1;
+
+	if( engine_max_len != RTL_CRYPTO_FRAGMENT )
+	{
+		printf( "split: longest engine call %u bytes\n", engine_max_len );
+		ret = -1;
+	}
+	if( ret == 0 )
+		printf( "split: %u lengths up to %u bytes right with 128/192/256 bit keys, below %u in software, engine calls of at most %u bytes\n",
+			( unsigned ) ( sizeof( crypto_lens ) / sizeof( crypto_lens[ 0 ] ) ), BIG_LEN,
+			RTL_CRYPTO_HW_MIN_LEN, engine_max_len );
+	return ret;
+}
+
+static void *batch_task( void *param )
+{
+	int n = ( int ) ( intptr_t ) param, round;
+	unsigned char key[ 16 ], iv[ 16 ], iv_ref[ 16 ];
+	unsigned char *plain = task_buf[ n ][ 0 ], *buf = task_buf[ n ][ 1 ];
+	mbedtls_aes_context enc, dec;
+
+	/* Tasks 2k and 2k + 1 share a key */
+	fill( key, sizeof( key ), 1000 + n / 2 );
+	mbedtls_aes_init( &enc );
+	mbedtls_aes_init( &dec );
+	mbedtls_aes_setkey_enc( &enc, key, 128 );
+	mbedtls_aes_setkey_dec( &dec, key, 128 );
+
+	for( round = 0; round < ROUNDS; round++ )
+	{
+		fill( plain, BATCH_LEN, n * ROUNDS + round );
+		fill( iv, sizeof( iv ), round );
+
+		mbedtls_aes_crypt_cbc( &enc, MBEDTLS_AES_ENCRYPT, BATCH_LEN, iv, plain, buf );
+		fill( iv_ref, sizeof( iv_ref ), round );
+		cbc_ref( &enc, BATCH_LEN, iv_ref, plain, plain );
+		if( memcmp( buf, plain, BATCH_LEN ) != 0 || memcmp( iv, iv_ref, 16 ) != 0 )
+			__sync_fetch_and_add( &task_errors, 1 );
+
+		fill( plain, BATCH_LEN, n * ROUNDS + round );
+		fill( iv, sizeof( iv ), round );
+		mbedtls_aes_crypt_cbc( &dec, MBEDTLS_AES_DECRYPT, BATCH_LEN, iv, buf, buf );
+		if( memcmp( buf, plain, BATCH_LEN ) != 0 || memcmp( iv, iv_ref, 16 ) != 0 )
+			__sync_fetch_and_add( &task_errors, 1 );
+	}
+
+	mbedtls_aes_free( &enc );
+	mbedtls_aes_free( &dec );
+	return NULL;
+}
+
+static int run_batch( void )
+{
+	rtl_crypto_dispatch_stats st;
+	pthread_t tasks[ TASKS ];
+	uint32_t inits = engine_inits, requests = TASKS * ROUNDS * 2;
+	int i, ret = 0;
+
+	task_errors = 0;
+	rtl_crypto_dispatch_reset_stats();
+	for( i = 0; i < TASKS; i++ )
+		pthread_create( &tasks[ i ], NULL, batch_task, ( void * ) ( intptr_t ) i );
+	for( i = 0; i < TASKS; i++ )
+		pthread_join( tasks[ i ], NULL );
+	rtl_crypto_dispatch_get_stats( &st );
+	inits = engine_inits - inits;
+
+	if( task_errors != 0 )
+	{
+		printf( "batch: %d wrong results\n", task_errors );
+		ret = -1;
+	}
+	if( st.hw_ops != requests || st.sw_ops != 0 || st.key_loads != inits ||
+		st.key_loads + st.key_loads_saved != st.hw_ops )
+	{
+		printf( "batch: %u engine and %u software requests of %u, %u + %u key loads for %u engine inits\n",
+			st.hw_ops, st.sw_ops, requests, st.key_loads, st.key_loads_saved, inits );
+		ret = -1;
+	}
+	/* Each task queues while another one has the engine */
+	if( st.batched_ops < st.hw_ops / 4 )
+	{
+		printf( "batch: %u of %u requests batched\n", st.batched_ops, st.hw_ops );
+		ret = -1;
+	}
+
+	printf( "batch: %d tasks, %u engine requests in %u batches, %u run by another task, %u key loads and %u saved\n",
+		TASKS, st.hw_ops, st.batches, st.batched_ops, st.key_loads, st.key_loads_saved );
+	return ret;
+}
+
+int main( void )
+{
+	int ret = 0;
+
+	if( run_kat() != 0 )
+		ret = 1;
+	if( run_split() != 0 )
+		ret = 1;
+	if( run_batch() != 0 )
+		ret = 1;
+
+	if( engine_errors != 0 )
+	{
+		printf( "%u engine misuses\n", engine_errors );
+		ret = 1;
+	}
+	printf( "%s\n", ret ? "FAILED" : "passed" );
+	return ret;
+}
@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for FreeRTOS.h, just enough to build the AES dispatcher in
+ * crypto_harness.
+ */
+#ifndef CRYPTO_HARNESS_FREERTOS_H
+#define CRYPTO_HARNESS_FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#endif /* CRYPTO_HARNESS_FREERTOS_H */
@@ -0,0 +1,10 @@
+/*
+ * Host stand-in for hal_crypto.h. The engine is reached through
+ * rom_ssl_ram_map, which crypto_harness fills with a mock.
+ */
+#ifndef __HAL_CRYPTO_H__
+#define __HAL_CRYPTO_H__
+
+#include "basic_types.h"
+
+#endif /* __HAL_CRYPTO_H__ */
@@ -0,0 +1,11 @@
+/* Host stand-in for platform_stdlib.h, the C library of the PC. */
+#ifndef __PLATFORM_STDLIB_H__
+#define __PLATFORM_STDLIB_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+
+#endif /* __PLATFORM_STDLIB_H__ */
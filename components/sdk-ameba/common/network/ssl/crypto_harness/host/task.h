@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for task.h. The tasks of crypto_harness are threads, a
+ * critical section is one process-wide mutex.
+ */
+#ifndef CRYPTO_HARNESS_TASK_H
+#define CRYPTO_HARNESS_TASK_H
+
+#include <sched.h>
+
+void vCryptoHarnessEnterCritical( void );
+void vCryptoHarnessExitCritical( void );
+
+#define taskENTER_CRITICAL()			vCryptoHarnessEnterCritical()
+#define taskEXIT_CRITICAL()				vCryptoHarnessExitCritical()
+#define taskYIELD()						sched_yield()
+
+#endif /* CRYPTO_HARNESS_TASK_H */
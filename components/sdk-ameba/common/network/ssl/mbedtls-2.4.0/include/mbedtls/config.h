@@ -4,6 +4,23 @@
 #define RTL_HW_CRYPTO
 //#define SUPPORT_HW_SW_CRYPTO
 #define RTL_CRYPTO_FRAGMENT               15360 /* 15*1024 < 16000 */
+#define RTL_CRYPTO_DISPATCH               /* per-size HW/SW AES dispatch in library/rtl_crypto_dispatch.c */
+#define RTL_CRYPTO_HW_MIN_LEN             64    /* shorter AES requests stay in SW when dispatching */
+#define RTL_SW_CRYPTO_OPTIM               /* word-oriented SW AES/GHASH/SHA-256 in library/rtl_sw_crypto.c */
+
+#ifdef RTL_CRYPTO_DISPATCH
+#define SUPPORT_HW_SW_CRYPTO
+#endif
+
+#ifdef RTL_SW_CRYPTO_OPTIM
+/* AES runs in software only with SUPPORT_HW_SW_CRYPTO, on the engine otherwise */
+#if !defined(RTL_HW_CRYPTO) || defined(SUPPORT_HW_SW_CRYPTO)
+#define MBEDTLS_AES_ENCRYPT_ALT
+#define MBEDTLS_AES_DECRYPT_ALT
+#endif
+#define MBEDTLS_GCM_MULT_ALT
+#define MBEDTLS_SHA256_PROCESS_ALT
+#endif
 
 #if CONFIG_SSL_RSA
 #include "platform_stdlib.h"
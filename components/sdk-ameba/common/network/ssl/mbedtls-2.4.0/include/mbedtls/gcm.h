@@ -53,6 +53,16 @@ typedef struct {
 }
 mbedtls_gcm_context;
 
+#if defined(MBEDTLS_GCM_MULT_ALT)
+/**
+ * \brief           Multiply x by H in GF(2^128) using the HL/HH tables.
+ *                  Provided by the platform (e.g. library/rtl_sw_crypto.c)
+ *                  when MBEDTLS_GCM_MULT_ALT is defined.
+ */
+void mbedtls_gcm_mult_alt( mbedtls_gcm_context *ctx, const unsigned char x[16],
+                           unsigned char output[16] );
+#endif
+
 /**
  * \brief           Initialize GCM context (just makes references valid)
  *                  Makes the context ready for mbedtls_gcm_setkey() or
@@ -0,0 +1,91 @@
+/**
+ * \file rtl_crypto_dispatch.h
+ *
+ * \brief HW/SW dispatcher for AES operations on RTL8711B
+ *
+ *  All AES-ECB/CBC requests of mbedtls_aes_crypt_ecb()/mbedtls_aes_crypt_cbc()
+ *  are routed here when RTL_CRYPTO_DISPATCH is defined in config.h:
+ *
+ *  - operations shorter than RTL_CRYPTO_HW_MIN_LEN (single blocks from
+ *    CTR/CFB/GCM, short records) run on the software kernels, since the
+ *    engine lock and key load cost more than the computation;
+ *  - longer operations go to the crypto engine and are split into
+ *    RTL_CRYPTO_FRAGMENT sized pieces with the CBC IV chained across them;
+ *  - engine requests from several tasks (TLS contexts) are queued and the
+ *    task that owns the engine lock runs the whole queue, so lock hand-offs
+ *    and key loads are shared by the batch.
+ */
+#ifndef MBEDTLS_RTL_CRYPTO_DISPATCH_H
+#define MBEDTLS_RTL_CRYPTO_DISPATCH_H
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aes.h"
+
+#ifndef RTL_CRYPTO_HW_MIN_LEN
+#define RTL_CRYPTO_HW_MIN_LEN           64
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          Per-path counters of the dispatcher
+ */
+typedef struct
+{
+    uint32_t hw_ops;            /*!< requests run on the crypto engine      */
+    uint32_t hw_bytes;          /*!< bytes processed by the crypto engine   */
+    uint32_t hw_fragments;      /*!< engine calls (>= hw_ops when split)    */
+    uint32_t sw_ops;            /*!< requests run on the software kernels   */
+    uint32_t sw_bytes;          /*!< bytes processed in software            */
+    uint32_t batches;           /*!< queue drains by an engine lock owner   */
+    uint32_t batched_ops;       /*!< requests run on behalf of another task */
+    uint32_t key_loads;         /*!< engine key loads                       */
+    uint32_t key_loads_saved;   /*!< key loads skipped within a batch       */
+}
+rtl_crypto_dispatch_stats;
+
+/**
+ * \brief          AES-ECB on one block, HW or SW
+ *
+ * \return         0 if successful
+ */
+int rtl_crypto_dispatch_aes_ecb( mbedtls_aes_context *ctx, int mode,
+                                 const unsigned char input[16],
+                                 unsigned char output[16] );
+
+/**
+ * \brief          AES-CBC on a multiple of 16 bytes, HW or SW.
+ *                 iv is updated as in mbedtls_aes_crypt_cbc().
+ *
+ * \return         0 if successful
+ */
+int rtl_crypto_dispatch_aes_cbc( mbedtls_aes_context *ctx, int mode,
+                                 size_t length, unsigned char iv[16],
+                                 const unsigned char *input,
+                                 unsigned char *output );
+
+/**
+ * \brief          Copy the dispatcher counters
+ */
+void rtl_crypto_dispatch_get_stats( rtl_crypto_dispatch_stats *stats );
+
+/**
+ * \brief          Clear the dispatcher counters
+ */
+void rtl_crypto_dispatch_reset_stats( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* rtl_crypto_dispatch.h */
@@ -50,6 +50,9 @@
 #if defined(MBEDTLS_AESNI_C)
 #include "mbedtls/aesni.h"
 #endif
+#if defined(RTL_CRYPTO_DISPATCH)
+#include "mbedtls/rtl_crypto_dispatch.h"
+#endif
 
 #if defined(MBEDTLS_SELF_TEST)
 #if defined(MBEDTLS_PLATFORM_C)
@@ -504,11 +507,15 @@ int mbedtls_aes_setkey_enc( mbedtls_aes_context *ctx, const unsigned char *key,
         }
 
         memcpy(ctx->enc_key, key, (keybits / 8));
+#if !defined(RTL_CRYPTO_DISPATCH)
         return 0;
+#endif
     }
 #endif /* RTL_HW_CRYPTO */
 #ifdef SUPPORT_HW_SW_CRYPTO
+#if !defined(RTL_CRYPTO_DISPATCH)
     else
+#endif
     {
     unsigned int i;
     uint32_t *RK;
@@ -638,11 +645,15 @@ int mbedtls_aes_setkey_dec( mbedtls_aes_context *ctx, const unsigned char *key,
         }
 
         memcpy(ctx->dec_key, key, (keybits / 8));
+#if !defined(RTL_CRYPTO_DISPATCH)
         return 0;
+#endif
     }
 #endif /* RTL_HW_CRYPTO */
 #ifdef SUPPORT_HW_SW_CRYPTO
+#if !defined(RTL_CRYPTO_DISPATCH)
     else
+#endif
     {
     int i, j, ret;
     mbedtls_aes_context cty;
@@ -876,6 +887,9 @@ int mbedtls_aes_crypt_ecb( mbedtls_aes_context *ctx,
                     const unsigned char input[16],
                     unsigned char output[16] )
 {
+#if defined(RTL_CRYPTO_DISPATCH)
+    return( rtl_crypto_dispatch_aes_ecb( ctx, mode, input, output ) );
+#else
 #ifdef RTL_HW_CRYPTO
     if(rom_ssl_ram_map.use_hw_crypto_func)
     {
@@ -927,6 +941,7 @@ int mbedtls_aes_crypt_ecb( mbedtls_aes_context *ctx,
     return( 0 );
     }
 #endif /* SUPPORT_HW_SW_CRYPTO */
+#endif /* RTL_CRYPTO_DISPATCH */
 }
 
 #if defined(MBEDTLS_CIPHER_MODE_CBC)
@@ -940,6 +955,9 @@ int mbedtls_aes_crypt_cbc( mbedtls_aes_context *ctx,
                     const unsigned char *input,
                     unsigned char *output )
 {
+#if defined(RTL_CRYPTO_DISPATCH)
+    return( rtl_crypto_dispatch_aes_cbc( ctx, mode, length, iv, input, output ) );
+#else
 #ifdef RTL_HW_CRYPTO
     if(rom_ssl_ram_map.use_hw_crypto_func)
     {
@@ -1051,6 +1069,7 @@ int mbedtls_aes_crypt_cbc( mbedtls_aes_context *ctx,
     return( 0 );
     }
 #endif /* SUPPORT_HW_SW_CRYPTO */
+#endif /* RTL_CRYPTO_DISPATCH */
 }
 #endif /* MBEDTLS_CIPHER_MODE_CBC */
 
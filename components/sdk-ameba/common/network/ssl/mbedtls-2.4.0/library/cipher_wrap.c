@@ -118,7 +118,8 @@ static void ccm_ctx_free( void *ctx )
 static int aes_crypt_ecb_wrap( void *ctx, mbedtls_operation_t operation,
         const unsigned char *input, unsigned char *output )
 {
-#ifdef RTL_HW_CRYPTO
+#if defined(RTL_HW_CRYPTO) && !defined(RTL_CRYPTO_DISPATCH)
+    /* the dispatcher takes RT_DEV_LOCK_CRYPTO itself, per engine request */
     if(rom_ssl_ram_map.use_hw_crypto_func)
     {
         device_mutex_lock(RT_DEV_LOCK_CRYPTO);
@@ -134,7 +135,7 @@ static int aes_crypt_ecb_wrap( void *ctx, mbedtls_operation_t operation,
 static int aes_crypt_cbc_wrap( void *ctx, mbedtls_operation_t operation, size_t length,
         unsigned char *iv, const unsigned char *input, unsigned char *output )
 {
-#ifdef RTL_HW_CRYPTO
+#if defined(RTL_HW_CRYPTO) && !defined(RTL_CRYPTO_DISPATCH)
     if(rom_ssl_ram_map.use_hw_crypto_func)
     {
         device_mutex_lock(RT_DEV_LOCK_CRYPTO);
@@ -154,7 +155,7 @@ static int aes_crypt_cfb128_wrap( void *ctx, mbedtls_operation_t operation,
         size_t length, size_t *iv_off, unsigned char *iv,
         const unsigned char *input, unsigned char *output )
 {
-#ifdef RTL_HW_CRYPTO
+#if defined(RTL_HW_CRYPTO) && !defined(RTL_CRYPTO_DISPATCH)
     if(rom_ssl_ram_map.use_hw_crypto_func)
     {
         device_mutex_lock(RT_DEV_LOCK_CRYPTO);
@@ -174,7 +175,7 @@ static int aes_crypt_ctr_wrap( void *ctx, size_t length, size_t *nc_off,
         unsigned char *nonce_counter, unsigned char *stream_block,
         const unsigned char *input, unsigned char *output )
 {
-#ifdef RTL_HW_CRYPTO
+#if defined(RTL_HW_CRYPTO) && !defined(RTL_CRYPTO_DISPATCH)
     if(rom_ssl_ram_map.use_hw_crypto_func)
     {
         device_mutex_lock(RT_DEV_LOCK_CRYPTO);
@@ -190,6 +190,9 @@ int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
     return( 0 );
 }
 
+#if defined(MBEDTLS_GCM_MULT_ALT)
+#define gcm_mult mbedtls_gcm_mult_alt
+#else
 /*
  * Shoup's method for multiplication use this table with
  *      last4[x] = x times P^128
@@ -262,6 +265,7 @@ static void gcm_mult( mbedtls_gcm_context *ctx, const unsigned char x[16],
     PUT_UINT32_BE( zl >> 32, output, 8 );
     PUT_UINT32_BE( zl, output, 12 );
 }
+#endif /* MBEDTLS_GCM_MULT_ALT */
 
 int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
                 int mode,
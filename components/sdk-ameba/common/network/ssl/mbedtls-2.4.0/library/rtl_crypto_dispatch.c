@@ -0,0 +1,339 @@
+/*
+ *  HW/SW dispatcher for AES operations on RTL8711B
+ *
+ *  See include/mbedtls/rtl_crypto_dispatch.h for the dispatch policy.
+ *
+ *  Engine requests are put on a FIFO before the caller takes
+ *  RT_DEV_LOCK_CRYPTO. Whoever holds the lock drains the whole FIFO, so a
+ *  task that was queued behind another finds its request already done when
+ *  it gets the lock and only has to release it again. A request lives on
+ *  the stack of its caller, which cannot return before it has taken the
+ *  lock, i.e. before the draining task has finished with the request.
+ *  Giving the lock back does not hand it over, so the draining task yields
+ *  after a batch: otherwise it could take the lock again for its next
+ *  request before the tasks it served at the same priority get to return.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_AES_C) && defined(RTL_CRYPTO_DISPATCH)
+
+#if !defined(SUPPORT_HW_SW_CRYPTO)
+#error "RTL_CRYPTO_DISPATCH requires SUPPORT_HW_SW_CRYPTO"
+#endif
+
+#ifdef RTL_HW_CRYPTO
+#include <hal_crypto.h>
+#endif
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "mbedtls/aes.h"
+#include "mbedtls/rtl_crypto_dispatch.h"
+
+#include "device_lock.h"
+
+typedef struct rtl_crypto_req
+{
+    struct rtl_crypto_req *next;
+    mbedtls_aes_context *ctx;
+    int cbc;
+    int mode;
+    size_t length;
+    unsigned char *iv;
+    const unsigned char *input;
+    unsigned char *output;
+    volatile int done;
+}
+rtl_crypto_req;
+
+static rtl_crypto_dispatch_stats dispatch_stats;
+
+#ifdef RTL_HW_CRYPTO
+static rtl_crypto_req *req_head = NULL;
+static rtl_crypto_req *req_tail = NULL;
+
+/* Key currently loaded in the engine, only trusted within one batch */
+static uint32_t hw_key[8];
+static uint32_t hw_iv[4];
+static unsigned int hw_key_len;
+static int hw_key_kind = -1;
+
+static int dispatch_use_hw( size_t length )
+{
+    if( rom_ssl_ram_map.use_hw_crypto_func == 0 )
+        return( 0 );
+
+    return( length >= RTL_CRYPTO_HW_MIN_LEN );
+}
+
+static void hw_load_key( const rtl_crypto_req *req )
+{
+    mbedtls_aes_context *ctx = req->ctx;
+    unsigned int keylen = ( ctx->nr - 6 ) * 4;
+    const unsigned char *key = ( req->mode == MBEDTLS_AES_DECRYPT ) ? ctx->dec_key : ctx->enc_key;
+    int kind = ( req->cbc << 1 ) | ( req->mode == MBEDTLS_AES_DECRYPT );
+
+    if( kind == hw_key_kind && keylen == hw_key_len &&
+        memcmp( hw_key, key, keylen ) == 0 )
+    {
+        dispatch_stats.key_loads_saved++;
+        return;
+    }
+
+    memcpy( hw_key, key, keylen );
+
+    if( req->cbc )
+        rom_ssl_ram_map.hw_crypto_aes_cbc_init( (unsigned char *) hw_key, keylen );
+    else
+        rom_ssl_ram_map.hw_crypto_aes_ecb_init( (unsigned char *) hw_key, keylen );
+
+    hw_key_kind = kind;
+    hw_key_len = keylen;
+    dispatch_stats.key_loads++;
+}
+
+/* Called with RT_DEV_LOCK_CRYPTO held */
+static void hw_run( const rtl_crypto_req *req )
+{
+    const unsigned char *input = req->input;
+    unsigned char *output = req->output;
+    unsigned char *iv_aligned = (unsigned char *) hw_iv;
+    unsigned char iv_tmp[16];
+    size_t length_done = 0, frag;
+
+    hw_load_key( req );
+
+    dispatch_stats.hw_ops++;
+    dispatch_stats.hw_bytes += req->length;
+
+    if( !req->cbc )
+    {
+        if( req->mode == MBEDTLS_AES_DECRYPT )
+            rom_ssl_ram_map.hw_crypto_aes_ecb_decrypt( input, 16, NULL, 0, output );
+        else
+            rom_ssl_ram_map.hw_crypto_aes_ecb_encrypt( input, 16, NULL, 0, output );
+
+        dispatch_stats.hw_fragments++;
+        return;
+    }
+
+    memcpy( iv_aligned, req->iv, 16 );
+
+    while( length_done < req->length )
+    {
+        frag = req->length - length_done;
+        if( frag > RTL_CRYPTO_FRAGMENT )
+            frag = RTL_CRYPTO_FRAGMENT;
+
+        if( req->mode == MBEDTLS_AES_DECRYPT )
+        {
+            /* Next IV is the last ciphertext block, which may be overwritten in place */
+            memcpy( iv_tmp, input + length_done + frag - 16, 16 );
+            rom_ssl_ram_map.hw_crypto_aes_cbc_decrypt( input + length_done, frag, iv_aligned, 16, output + length_done );
+            memcpy( iv_aligned, iv_tmp, 16 );
+        }
+        else
+        {
+            rom_ssl_ram_map.hw_crypto_aes_cbc_encrypt( input + length_done, frag, iv_aligned, 16, output + length_done );
+            memcpy( iv_aligned, output + length_done + frag - 16, 16 );
+        }
+
+        length_done += frag;
+        dispatch_stats.hw_fragments++;
+    }
+
+    memcpy( req->iv, iv_aligned, 16 );
+}
+
+static int hw_submit( rtl_crypto_req *req )
+{
+    rtl_crypto_req *batch, *r;
+    int served = 0;
+
+    req->next = NULL;
+    req->done = 0;
+
+    taskENTER_CRITICAL();
+    if( req_tail != NULL )
+        req_tail->next = req;
+    else
+        req_head = req;
+    req_tail = req;
+    taskEXIT_CRITICAL();
+
+    device_mutex_lock( RT_DEV_LOCK_CRYPTO );
+
+    if( !req->done )
+    {
+        /* Other engine users may have changed the key since the last batch */
+        hw_key_kind = -1;
+        dispatch_stats.batches++;
+
+        for( ;; )
+        {
+            taskENTER_CRITICAL();
+            batch = req_head;
+            req_head = req_tail = NULL;
+            taskEXIT_CRITICAL();
+
+            if( batch == NULL )
+                break;
+
+            while( batch != NULL )
+            {
+                r = batch;
+                batch = r->next;
+
+                hw_run( r );
+
+                if( r != req )
+                {
+                    dispatch_stats.batched_ops++;
+                    served = 1;
+                }
+
+                r->done = 1;
+            }
+        }
+    }
+
+    device_mutex_unlock( RT_DEV_LOCK_CRYPTO );
+
+    if( served )
+        taskYIELD();
+
+    return( 0 );
+}
+#endif /* RTL_HW_CRYPTO */
+
+static void sw_count( size_t length )
+{
+    taskENTER_CRITICAL();
+    dispatch_stats.sw_ops++;
+    dispatch_stats.sw_bytes += length;
+    taskEXIT_CRITICAL();
+}
+
+int rtl_crypto_dispatch_aes_ecb( mbedtls_aes_context *ctx, int mode,
+                                 const unsigned char input[16],
+                                 unsigned char output[16] )
+{
+#ifdef RTL_HW_CRYPTO
+    if( dispatch_use_hw( 16 ) )
+    {
+        rtl_crypto_req req;
+
+        req.ctx = ctx;
+        req.cbc = 0;
+        req.mode = mode;
+        req.length = 16;
+        req.iv = NULL;
+        req.input = input;
+        req.output = output;
+
+        return( hw_submit( &req ) );
+    }
+#endif
+
+    if( mode == MBEDTLS_AES_ENCRYPT )
+        mbedtls_aes_encrypt( ctx, input, output );
+    else
+        mbedtls_aes_decrypt( ctx, input, output );
+
+    sw_count( 16 );
+
+    return( 0 );
+}
+
+int rtl_crypto_dispatch_aes_cbc( mbedtls_aes_context *ctx, int mode,
+                                 size_t length, unsigned char iv[16],
+                                 const unsigned char *input,
+                                 unsigned char *output )
+{
+    int i;
+    unsigned char temp[16];
+
+    if( length % 16 )
+        return( MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH );
+
+    if( length == 0 )
+        return( 0 );
+
+#ifdef RTL_HW_CRYPTO
+    if( dispatch_use_hw( length ) )
+    {
+        rtl_crypto_req req;
+
+        req.ctx = ctx;
+        req.cbc = 1;
+        req.mode = mode;
+        req.length = length;
+        req.iv = iv;
+        req.input = input;
+        req.output = output;
+
+        return( hw_submit( &req ) );
+    }
+#endif
+
+    sw_count( length );
+
+    if( mode == MBEDTLS_AES_DECRYPT )
+    {
+        while( length > 0 )
+        {
+            memcpy( temp, input, 16 );
+            mbedtls_aes_decrypt( ctx, input, output );
+
+            for( i = 0; i < 16; i++ )
+                output[i] = (unsigned char)( output[i] ^ iv[i] );
+
+            memcpy( iv, temp, 16 );
+
+            input  += 16;
+            output += 16;
+            length -= 16;
+        }
+    }
+    else
+    {
+        while( length > 0 )
+        {
+            for( i = 0; i < 16; i++ )
+                output[i] = (unsigned char)( input[i] ^ iv[i] );
+
+            mbedtls_aes_encrypt( ctx, output, output );
+            memcpy( iv, output, 16 );
+
+            input  += 16;
+            output += 16;
+            length -= 16;
+        }
+    }
+
+    return( 0 );
+}
+
+void rtl_crypto_dispatch_get_stats( rtl_crypto_dispatch_stats *stats )
+{
+    taskENTER_CRITICAL();
+    memcpy( stats, &dispatch_stats, sizeof( rtl_crypto_dispatch_stats ) );
+    taskEXIT_CRITICAL();
+}
+
+void rtl_crypto_dispatch_reset_stats( void )
+{
+    taskENTER_CRITICAL();
+    memset( &dispatch_stats, 0, sizeof( rtl_crypto_dispatch_stats ) );
+    taskEXIT_CRITICAL();
+}
+
+#endif /* MBEDTLS_AES_C && RTL_CRYPTO_DISPATCH */
@@ -0,0 +1,471 @@
+/*
+ *  Word-oriented software AES / GHASH / SHA-256 kernels for RTL8711B
+ *
+ *  These replace the stock byte-oriented C behind the mbed TLS
+ *  per-function _ALT hooks when RTL_SW_CRYPTO_OPTIM is set in config.h:
+ *
+ *  - MBEDTLS_AES_ENCRYPT_ALT / MBEDTLS_AES_DECRYPT_ALT:
+ *    T-table AES with a single forward and a single reverse table kept in
+ *    SRAM (the other three tables are byte rotations, which are free on
+ *    Cortex-M). Avoids flash wait states of MBEDTLS_AES_ROM_TABLES on XIP
+ *    and costs 2.5KB of RAM. This comes on top of the tables of aes.c,
+ *    which are all kept: its key schedules still use FSb, RT0..RT3 and
+ *    RCON, and the unused FT0..FT3 and RSb stay unless the linker drops
+ *    them.
+ *  - MBEDTLS_GCM_MULT_ALT:
+ *    Shoup 4-bit GHASH using the existing HL/HH table, computed in 32-bit
+ *    words so no 64-bit shifts are emitted on Cortex-M.
+ *  - MBEDTLS_SHA256_PROCESS_ALT:
+ *    fully unrolled compression with a rolling 16-word message schedule and
+ *    word loads (byte-reversed) when the block is 4-byte aligned.
+ *
+ *  Results are bit-exact with aes.c / gcm.c / sha256.c.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#ifdef RTL_HW_CRYPTO
+#include <hal_crypto.h>
+#endif
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(IMAGE2_RAM_TEXT_SECTION)
+#define SW_CRYPTO_RAM_TEXT      IMAGE2_RAM_TEXT_SECTION
+#else
+#define SW_CRYPTO_RAM_TEXT
+#endif
+
+#if defined(__REV)
+#define SW_CRYPTO_BSWAP32(x)    __REV(x)
+#else
+#define SW_CRYPTO_BSWAP32(x)    ( ( (x) >> 24 ) | ( ( (x) >> 8 ) & 0x0000FF00 ) | \
+                                  ( ( (x) << 8 ) & 0x00FF0000 ) | ( (x) << 24 ) )
+#endif
+
+#define ROR32(x,n)  ( ( (uint32_t) (x) >> (n) ) | ( (uint32_t) (x) << ( 32 - (n) ) ) )
+
+/*
+ * AES
+ */
+#if defined(MBEDTLS_AES_C) && \
+    ( defined(MBEDTLS_AES_ENCRYPT_ALT) || defined(MBEDTLS_AES_DECRYPT_ALT) )
+
+#include "mbedtls/aes.h"
+
+/* Loads/stores of the little-endian AES state; word access when aligned */
+#define AES_LOAD32(b,i)                                                     \
+    ( ( ( (uintptr_t) (b) & 3 ) == 0 ) ? *(const uint32_t *) ( (b) + (i) ) :  \
+      ( (uint32_t) (b)[(i)    ]       | ( (uint32_t) (b)[(i) + 1] <<  8 ) |  \
+      ( (uint32_t) (b)[(i) + 2] << 16 ) | ( (uint32_t) (b)[(i) + 3] << 24 ) ) )
+
+#define AES_STORE32(n,b,i)                                  \
+do {                                                        \
+    (b)[(i)    ] = (unsigned char) ( (n)       );           \
+    (b)[(i) + 1] = (unsigned char) ( (n) >>  8 );           \
+    (b)[(i) + 2] = (unsigned char) ( (n) >> 16 );           \
+    (b)[(i) + 3] = (unsigned char) ( (n) >> 24 );           \
+} while( 0 )
+
+/*
+ * RAM tables, generated on first use. Only the column-0 T-tables are kept;
+ * FT1..FT3 (RT1..RT3) are FT0 (RT0) rotated left by 8, 16 and 24 bits.
+ */
+static unsigned char sw_FSb[256];
+static unsigned char sw_RSb[256];
+static uint32_t sw_FT0[256];
+static uint32_t sw_RT0[256];
+static volatile int sw_aes_tables_done = 0;
+
+#define XTIME(x) ( ( (x) << 1 ) ^ ( ( (x) & 0x80 ) ? 0x1B : 0x00 ) )
+#define MUL(x,y) ( ( (x) && (y) ) ? pow[(log[(x)] + log[(y)]) % 255] : 0 )
+
+static void sw_aes_gen_tables( void )
+{
+    int i, x, y, z;
+    int pow[256];
+    int log[256];
+
+    for( i = 0, x = 1; i < 256; i++ )
+    {
+        pow[i] = x;
+        log[x] = i;
+        x = ( x ^ XTIME( x ) ) & 0xFF;
+    }
+
+    sw_FSb[0x00] = 0x63;
+    sw_RSb[0x63] = 0x00;
+
+    for( i = 1; i < 256; i++ )
+    {
+        x = pow[255 - log[i]];
+
+        y  = x; y = ( ( y << 1 ) | ( y >> 7 ) ) & 0xFF;
+        x ^= y; y = ( ( y << 1 ) | ( y >> 7 ) ) & 0xFF;
+        x ^= y; y = ( ( y << 1 ) | ( y >> 7 ) ) & 0xFF;
+        x ^= y; y = ( ( y << 1 ) | ( y >> 7 ) ) & 0xFF;
+        x ^= y ^ 0x63;
+
+        sw_FSb[i] = (unsigned char) x;
+        sw_RSb[x] = (unsigned char) i;
+    }
+
+    for( i = 0; i < 256; i++ )
+    {
+        x = sw_FSb[i];
+        y = XTIME( x ) & 0xFF;
+        z = ( y ^ x ) & 0xFF;
+
+        sw_FT0[i] = ( (uint32_t) y       ) ^
+                    ( (uint32_t) x <<  8 ) ^
+                    ( (uint32_t) x << 16 ) ^
+                    ( (uint32_t) z << 24 );
+
+        x = sw_RSb[i];
+
+        sw_RT0[i] = ( (uint32_t) MUL( 0x0E, x )       ) ^
+                    ( (uint32_t) MUL( 0x09, x ) <<  8 ) ^
+                    ( (uint32_t) MUL( 0x0D, x ) << 16 ) ^
+                    ( (uint32_t) MUL( 0x0B, x ) << 24 );
+    }
+
+    sw_aes_tables_done = 1;
+}
+
+#undef XTIME
+#undef MUL
+
+/* T[b] rotated into column n: FTn[b] == ROR32( FT0[b], 32 - 8n ) */
+#define TE(T,y,n)   ( (n) == 0 ? T[ (y) & 0xFF ] : ROR32( T[ ( (y) >> ( 8 * (n) ) ) & 0xFF ], 32 - 8 * (n) ) )
+
+#define SW_FROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)                                              \
+do {                                                                                    \
+    X0 = RK[0] ^ TE(FT,Y0,0) ^ TE(FT,Y1,1) ^ TE(FT,Y2,2) ^ TE(FT,Y3,3);                 \
+    X1 = RK[1] ^ TE(FT,Y1,0) ^ TE(FT,Y2,1) ^ TE(FT,Y3,2) ^ TE(FT,Y0,3);                 \
+    X2 = RK[2] ^ TE(FT,Y2,0) ^ TE(FT,Y3,1) ^ TE(FT,Y0,2) ^ TE(FT,Y1,3);                 \
+    X3 = RK[3] ^ TE(FT,Y3,0) ^ TE(FT,Y0,1) ^ TE(FT,Y1,2) ^ TE(FT,Y2,3);                 \
+    RK += 4;                                                                            \
+} while( 0 )
+
+#define SW_RROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)                                              \
+do {                                                                                    \
+    X0 = RK[0] ^ TE(RT,Y0,0) ^ TE(RT,Y3,1) ^ TE(RT,Y2,2) ^ TE(RT,Y1,3);                 \
+    X1 = RK[1] ^ TE(RT,Y1,0) ^ TE(RT,Y0,1) ^ TE(RT,Y3,2) ^ TE(RT,Y2,3);                 \
+    X2 = RK[2] ^ TE(RT,Y2,0) ^ TE(RT,Y1,1) ^ TE(RT,Y0,2) ^ TE(RT,Y3,3);                 \
+    X3 = RK[3] ^ TE(RT,Y3,0) ^ TE(RT,Y2,1) ^ TE(RT,Y1,2) ^ TE(RT,Y0,3);                 \
+    RK += 4;                                                                            \
+} while( 0 )
+
+#define SB(S,a,b,c,d)                                                   \
+    ( ( (uint32_t) S[ ( (a)       ) & 0xFF ]       ) ^                  \
+      ( (uint32_t) S[ ( (b) >>  8 ) & 0xFF ] <<  8 ) ^                  \
+      ( (uint32_t) S[ ( (c) >> 16 ) & 0xFF ] << 16 ) ^                  \
+      ( (uint32_t) S[ ( (d) >> 24 ) & 0xFF ] << 24 ) )
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT)
+SW_CRYPTO_RAM_TEXT
+void mbedtls_aes_encrypt( mbedtls_aes_context *ctx,
+                          const unsigned char input[16],
+                          unsigned char output[16] )
+{
+    const uint32_t *RK = ctx->rk;
+    const uint32_t *FT = sw_FT0;
+    uint32_t X0, X1, X2, X3, Y0, Y1, Y2, Y3;
+
+    if( sw_aes_tables_done == 0 )
+        sw_aes_gen_tables();
+
+    X0 = AES_LOAD32( input,  0 ) ^ RK[0];
+    X1 = AES_LOAD32( input,  4 ) ^ RK[1];
+    X2 = AES_LOAD32( input,  8 ) ^ RK[2];
+    X3 = AES_LOAD32( input, 12 ) ^ RK[3];
+    RK += 4;
+
+    /* 9 full rounds are common to all key sizes */
+    SW_FROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_FROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    SW_FROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_FROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    SW_FROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_FROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    SW_FROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_FROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+
+    if( ctx->nr > 10 )
+    {
+        SW_FROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+        SW_FROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    }
+
+    if( ctx->nr > 12 )
+    {
+        SW_FROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+        SW_FROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    }
+
+    SW_FROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+
+    X0 = RK[0] ^ SB( sw_FSb, Y0, Y1, Y2, Y3 );
+    X1 = RK[1] ^ SB( sw_FSb, Y1, Y2, Y3, Y0 );
+    X2 = RK[2] ^ SB( sw_FSb, Y2, Y3, Y0, Y1 );
+    X3 = RK[3] ^ SB( sw_FSb, Y3, Y0, Y1, Y2 );
+
+    AES_STORE32( X0, output,  0 );
+    AES_STORE32( X1, output,  4 );
+    AES_STORE32( X2, output,  8 );
+    AES_STORE32( X3, output, 12 );
+}
+#endif /* MBEDTLS_AES_ENCRYPT_ALT */
+
+#if defined(MBEDTLS_AES_DECRYPT_ALT)
+SW_CRYPTO_RAM_TEXT
+void mbedtls_aes_decrypt( mbedtls_aes_context *ctx,
+                          const unsigned char input[16],
+                          unsigned char output[16] )
+{
+    const uint32_t *RK = ctx->rk;
+    const uint32_t *RT = sw_RT0;
+    uint32_t X0, X1, X2, X3, Y0, Y1, Y2, Y3;
+
+    if( sw_aes_tables_done == 0 )
+        sw_aes_gen_tables();
+
+    X0 = AES_LOAD32( input,  0 ) ^ RK[0];
+    X1 = AES_LOAD32( input,  4 ) ^ RK[1];
+    X2 = AES_LOAD32( input,  8 ) ^ RK[2];
+    X3 = AES_LOAD32( input, 12 ) ^ RK[3];
+    RK += 4;
+
+    SW_RROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_RROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    SW_RROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_RROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    SW_RROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_RROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    SW_RROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+    SW_RROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+
+    if( ctx->nr > 10 )
+    {
+        SW_RROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+        SW_RROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    }
+
+    if( ctx->nr > 12 )
+    {
+        SW_RROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+        SW_RROUND( X0, X1, X2, X3, Y0, Y1, Y2, Y3 );
+    }
+
+    SW_RROUND( Y0, Y1, Y2, Y3, X0, X1, X2, X3 );
+
+    X0 = RK[0] ^ SB( sw_RSb, Y0, Y3, Y2, Y1 );
+    X1 = RK[1] ^ SB( sw_RSb, Y1, Y0, Y3, Y2 );
+    X2 = RK[2] ^ SB( sw_RSb, Y2, Y1, Y0, Y3 );
+    X3 = RK[3] ^ SB( sw_RSb, Y3, Y2, Y1, Y0 );
+
+    AES_STORE32( X0, output,  0 );
+    AES_STORE32( X1, output,  4 );
+    AES_STORE32( X2, output,  8 );
+    AES_STORE32( X3, output, 12 );
+}
+#endif /* MBEDTLS_AES_DECRYPT_ALT */
+
+#endif /* MBEDTLS_AES_C && (MBEDTLS_AES_ENCRYPT_ALT || MBEDTLS_AES_DECRYPT_ALT) */
+
+/*
+ * GHASH
+ */
+#if defined(MBEDTLS_GCM_C) && defined(MBEDTLS_GCM_MULT_ALT)
+
+#include "mbedtls/gcm.h"
+
+/* last4[x] = x times P^128, pre-shifted into the top word of Z */
+static const uint32_t sw_last4[16] =
+{
+    0x00000000, 0x1c200000, 0x38400000, 0x24600000,
+    0x70800000, 0x6ca00000, 0x48c00000, 0x54e00000,
+    0xe1000000, 0xfd200000, 0xd9400000, 0xc5600000,
+    0x91800000, 0x8da00000, 0xa9c00000, 0xb5e00000
+};
+
+/* Z = (Z >> 4) ^ reduction ^ H[n], Z held as four big-endian words z0..z3 */
+#define GHASH_STEP(n)                                           \
+do {                                                            \
+    rem = z3 & 0xf;                                             \
+    z3 = ( z2 << 28 ) | ( z3 >> 4 );                            \
+    z2 = ( z1 << 28 ) | ( z2 >> 4 );                            \
+    z1 = ( z0 << 28 ) | ( z1 >> 4 );                            \
+    z0 = ( z0 >> 4 ) ^ sw_last4[rem];                           \
+    z0 ^= (uint32_t) ( ctx->HH[(n)] >> 32 );                    \
+    z1 ^= (uint32_t) ( ctx->HH[(n)] );                          \
+    z2 ^= (uint32_t) ( ctx->HL[(n)] >> 32 );                    \
+    z3 ^= (uint32_t) ( ctx->HL[(n)] );                          \
+} while( 0 )
+
+SW_CRYPTO_RAM_TEXT
+void mbedtls_gcm_mult_alt( mbedtls_gcm_context *ctx, const unsigned char x[16],
+                           unsigned char output[16] )
+{
+    int i;
+    unsigned char lo;
+    uint32_t z0, z1, z2, z3, rem;
+
+    lo = x[15] & 0xf;
+
+    z0 = (uint32_t) ( ctx->HH[lo] >> 32 );
+    z1 = (uint32_t) ( ctx->HH[lo] );
+    z2 = (uint32_t) ( ctx->HL[lo] >> 32 );
+    z3 = (uint32_t) ( ctx->HL[lo] );
+
+    GHASH_STEP( x[15] >> 4 );
+
+    for( i = 14; i >= 0; i-- )
+    {
+        GHASH_STEP( x[i] & 0xf );
+        GHASH_STEP( x[i] >> 4 );
+    }
+
+    output[ 0] = (unsigned char) ( z0 >> 24 );
+    output[ 1] = (unsigned char) ( z0 >> 16 );
+    output[ 2] = (unsigned char) ( z0 >>  8 );
+    output[ 3] = (unsigned char) ( z0       );
+    output[ 4] = (unsigned char) ( z1 >> 24 );
+    output[ 5] = (unsigned char) ( z1 >> 16 );
+    output[ 6] = (unsigned char) ( z1 >>  8 );
+    output[ 7] = (unsigned char) ( z1       );
+    output[ 8] = (unsigned char) ( z2 >> 24 );
+    output[ 9] = (unsigned char) ( z2 >> 16 );
+    output[10] = (unsigned char) ( z2 >>  8 );
+    output[11] = (unsigned char) ( z2       );
+    output[12] = (unsigned char) ( z3 >> 24 );
+    output[13] = (unsigned char) ( z3 >> 16 );
+    output[14] = (unsigned char) ( z3 >>  8 );
+    output[15] = (unsigned char) ( z3       );
+}
+
+#undef GHASH_STEP
+
+#endif /* MBEDTLS_GCM_C && MBEDTLS_GCM_MULT_ALT */
+
+/*
+ * SHA-256
+ */
+#if defined(MBEDTLS_SHA256_C) && defined(MBEDTLS_SHA256_PROCESS_ALT)
+
+#include "mbedtls/sha256.h"
+
+static const uint32_t sw_K256[64] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+#define S0(x) ( ROR32(x, 7) ^ ROR32(x,18) ^ ( (x) >>  3 ) )
+#define S1(x) ( ROR32(x,17) ^ ROR32(x,19) ^ ( (x) >> 10 ) )
+
+#define S2(x) ( ROR32(x, 2) ^ ROR32(x,13) ^ ROR32(x,22) )
+#define S3(x) ( ROR32(x, 6) ^ ROR32(x,11) ^ ROR32(x,25) )
+
+#define F0(x,y,z) ( ( (x) & (y) ) | ( (z) & ( (x) | (y) ) ) )
+#define F1(x,y,z) ( (z) ^ ( (x) & ( (y) ^ (z) ) ) )
+
+/* Rolling 16-word message schedule: W[t & 15] holds W[t] */
+#define W16(t)  W[(t) & 15]
+#define R(t)    ( W16(t) += S1( W16((t) -  2) ) + W16((t) - 7) + S0( W16((t) - 15) ) )
+
+#define P(a,b,c,d,e,f,g,h,x,t)                              \
+do {                                                        \
+    temp1 = h + S3(e) + F1(e,f,g) + sw_K256[t] + (x);       \
+    temp2 = S2(a) + F0(a,b,c);                              \
+    d += temp1; h = temp1 + temp2;                          \
+} while( 0 )
+
+#define P8(t,X)                                             \
+do {                                                        \
+    P( A, B, C, D, E, F, G, H, X((t) + 0), (t) + 0 );       \
+    P( H, A, B, C, D, E, F, G, X((t) + 1), (t) + 1 );       \
+    P( G, H, A, B, C, D, E, F, X((t) + 2), (t) + 2 );       \
+    P( F, G, H, A, B, C, D, E, X((t) + 3), (t) + 3 );       \
+    P( E, F, G, H, A, B, C, D, X((t) + 4), (t) + 4 );       \
+    P( D, E, F, G, H, A, B, C, X((t) + 5), (t) + 5 );       \
+    P( C, D, E, F, G, H, A, B, X((t) + 6), (t) + 6 );       \
+    P( B, C, D, E, F, G, H, A, X((t) + 7), (t) + 7 );       \
+} while( 0 )
+
+SW_CRYPTO_RAM_TEXT
+void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[64] )
+{
+    uint32_t temp1, temp2, W[16];
+    uint32_t A, B, C, D, E, F, G, H;
+    unsigned int i;
+
+    if( ( (uintptr_t) data & 3 ) == 0 )
+    {
+        const uint32_t *p = (const uint32_t *) data;
+
+        for( i = 0; i < 16; i++ )
+            W[i] = SW_CRYPTO_BSWAP32( p[i] );
+    }
+    else
+    {
+        for( i = 0; i < 16; i++ )
+        {
+            W[i] = ( (uint32_t) data[4 * i    ] << 24 ) |
+                   ( (uint32_t) data[4 * i + 1] << 16 ) |
+                   ( (uint32_t) data[4 * i + 2] <<  8 ) |
+                   ( (uint32_t) data[4 * i + 3]       );
+        }
+    }
+
+    A = ctx->state[0]; B = ctx->state[1];
+    C = ctx->state[2]; D = ctx->state[3];
+    E = ctx->state[4]; F = ctx->state[5];
+    G = ctx->state[6]; H = ctx->state[7];
+
+    P8(  0, W16 );
+    P8(  8, W16 );
+    P8( 16, R );
+    P8( 24, R );
+    P8( 32, R );
+    P8( 40, R );
+    P8( 48, R );
+    P8( 56, R );
+
+    ctx->state[0] += A; ctx->state[1] += B;
+    ctx->state[2] += C; ctx->state[3] += D;
+    ctx->state[4] += E; ctx->state[5] += F;
+    ctx->state[6] += G; ctx->state[7] += H;
+}
+
+#undef S0
+#undef S1
+#undef S2
+#undef S3
+#undef F0
+#undef F1
+#undef W16
+#undef R
+#undef P
+#undef P8
+
+#endif /* MBEDTLS_SHA256_C && MBEDTLS_SHA256_PROCESS_ALT */
@@ -19,6 +19,11 @@
 #define DEFAULT_REPORT_INTERVAL 0xffffffff
 #define DEFAULT_UDP_TOS_VALUE   96 // BE=96
 
+#if CONFIG_WLAN
+/* In the WLAN driver library, no header of the tree declares it */
+extern int wext_set_tos_value(const char *ifname, uint8_t *tos_value);
+#endif
+
 struct iperf_data_t{
 	uint64_t total_size;
 	uint64_t bandwidth;
@@ -103,7 +108,7 @@ int tcp_client_func(struct iperf_data_t iperf_data)
 	memset(&ser_addr, 0, sizeof(ser_addr));
 	ser_addr.sin_family = AF_INET;
 	ser_addr.sin_port = htons(iperf_data.port);
-	ser_addr.sin_addr.s_addr = inet_addr(iperf_data.server_ip);
+	ser_addr.sin_addr.s_addr = inet_addr((char *)iperf_data.server_ip);
 
 	printf("\n\r%s: Server IP=%s, port=%d", __func__,iperf_data.server_ip, iperf_data.port);
 	printf("\n\r%s: Create socket fd = %d", __func__,iperf_data.client_fd);
@@ -208,7 +213,7 @@ Exit2:
 int tcp_server_func(struct iperf_data_t iperf_data)
 {
 	struct sockaddr_in   ser_addr , client_addr;
-	int                  addrlen = sizeof(struct sockaddr_in);
+	socklen_t            addrlen = sizeof(struct sockaddr_in);
 	int                  n = 1;
 	int                  recv_size=0;
 	uint64_t             total_size=0,report_size=0;
@@ -251,7 +256,6 @@ int tcp_server_func(struct iperf_data_t iperf_data)
 	}
 	printf("\n\r%s: Listen port %d",__func__,iperf_data.port);
 
-Restart:
 	if( (iperf_data.client_fd = accept(iperf_data.server_fd, (struct sockaddr*)&client_addr, &addrlen)) < 0){
 		printf("\n\r[ERROR] %s: Accept TCP client socket error!",__func__);
 		goto Exit2;
@@ -275,7 +279,7 @@ Restart:
 				if(xTaskCreate(tcp_client_handler, "tcp_client_handler", BSD_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1 + PRIORITIE_OFFSET, &g_tcp_client_task) != pdPASS)
 					printf("\n\rTCP ERROR: Create TCP client task failed.");
 				else{
-					strncpy(tcp_client_data.server_ip, inet_ntoa(client_addr.sin_addr), (strlen(inet_ntoa(client_addr.sin_addr))) );
+					strncpy((char *)tcp_client_data.server_ip, inet_ntoa(client_addr.sin_addr), sizeof(tcp_client_data.server_ip) - 1);
 					tcp_client_data.port = ntohl(client_hdr.mPort);
 					tcp_client_data.buf_size = CLIENT_BUF_SIZE;
 					tcp_client_data.report_interval = DEFAULT_REPORT_INTERVAL;
@@ -285,6 +289,7 @@ Restart:
 	}
 
 	start_time = xTaskGetTickCount();
+	end_time = start_time;
 	report_start_time = start_time;
 	while (!g_tcp_terminate) {
 		recv_size = recv(iperf_data.client_fd, tcp_server_buffer, iperf_data.buf_size, 0);  //MSG_DONTWAIT   MSG_WAITALL
@@ -331,7 +336,7 @@ int udp_client_func(struct iperf_data_t iperf_data)
 {
 	struct sockaddr_in  ser_addr;
 	int                 i=0;
-	int                 addrlen = sizeof(struct sockaddr_in);
+	socklen_t           addrlen = sizeof(struct sockaddr_in);
 	uint32_t            start_time, end_time, bandwidth_time,report_start_time;
 	uint64_t            total_size=0, bandwidth_size=0, report_size=0;
 	struct iperf_udp_client_hdr client_hdr;
@@ -356,7 +361,7 @@ int udp_client_func(struct iperf_data_t iperf_data)
 	memset(&ser_addr, 0, sizeof(ser_addr));
 	ser_addr.sin_family = AF_INET;
 	ser_addr.sin_port = htons(iperf_data.port);
-	ser_addr.sin_addr.s_addr = inet_addr(iperf_data.server_ip);
+	ser_addr.sin_addr.s_addr = inet_addr((char *)iperf_data.server_ip);
 
 	printf("\n\r%s: Server IP=%s, port=%d", __func__,iperf_data.server_ip, iperf_data.port);
 	printf("\n\r%s: Create socket fd = %d", __func__,iperf_data.client_fd);
@@ -440,7 +445,6 @@ int udp_client_func(struct iperf_data_t iperf_data)
 	}
 	printf("\n\r%s: [END] Totally send %d KBytes in %d ms, %d Kbits/sec",__func__, (uint32_t)(total_size/KB),(uint32_t)(end_time-start_time),((uint32_t)(total_size*8)/(end_time - start_time)));
 
-Exit1:
 	close(iperf_data.client_fd);
 Exit2:
 	printf("\n\r%s: Close client socket",__func__);
@@ -454,7 +458,7 @@ Exit2:
 int udp_server_func(struct iperf_data_t iperf_data)
 {
 	struct sockaddr_in   ser_addr , client_addr;
-	int                  addrlen = sizeof(struct sockaddr_in);
+	socklen_t            addrlen = sizeof(struct sockaddr_in);
 	int                  n = 1;
 	uint32_t             start_time, report_start_time, end_time;
 	int                  recv_size=0;
@@ -517,7 +521,7 @@ int udp_server_func(struct iperf_data_t iperf_data)
 				if(xTaskCreate(udp_client_handler, "udp_client_handler", BSD_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1 + PRIORITIE_OFFSET, &g_udp_client_task) != pdPASS)
 					printf("\r\nUDP ERROR: Create UDP client task failed.");
 				else{
-					strncpy(udp_client_data.server_ip, inet_ntoa(client_addr.sin_addr), (strlen(inet_ntoa(client_addr.sin_addr))) );
+					strncpy((char *)udp_client_data.server_ip, inet_ntoa(client_addr.sin_addr), sizeof(udp_client_data.server_ip) - 1);
 					udp_client_data.port = ntohl(client_hdr.mPort);
 					udp_client_data.bandwidth = ntohl(client_hdr.mWinband);
 					udp_client_data.buf_size = CLIENT_BUF_SIZE;
@@ -602,7 +606,7 @@ static void tcp_client_handler(void *param)
 	tcp_client_func(tcp_client_data);
 
 #if defined(INCLUDE_uxTaskGetStackHighWaterMark) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
-	printf("\n\rMin available stack size of %s = %d * %d bytes\n\r", __FUNCTION__, uxTaskGetStackHighWaterMark(NULL), sizeof(portBASE_TYPE));
+	printf("\n\rMin available stack size of %s = %d * %d bytes\n\r", __FUNCTION__, (int)uxTaskGetStackHighWaterMark(NULL), (int)sizeof(portBASE_TYPE));
 #endif
 	printf("\n\rTCP: TCP client stopped!");
 
@@ -618,7 +622,7 @@ static void tcp_server_handler(void *param)
 	tcp_server_func(tcp_server_data);
 
 #if defined(INCLUDE_uxTaskGetStackHighWaterMark) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
-	printf("\n\rMin available stack size of %s = %d * %d bytes\n\r", __FUNCTION__, uxTaskGetStackHighWaterMark(NULL), sizeof(portBASE_TYPE));
+	printf("\n\rMin available stack size of %s = %d * %d bytes\n\r", __FUNCTION__, (int)uxTaskGetStackHighWaterMark(NULL), (int)sizeof(portBASE_TYPE));
 #endif
 	printf("\n\rTCP: TCP server stopped!");
 	g_tcp_server_task = NULL;
@@ -633,7 +637,7 @@ static void udp_client_handler(void *param)
 	udp_client_func(udp_client_data);
 
 #if defined(INCLUDE_uxTaskGetStackHighWaterMark) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
-	printf("\n\rMin available stack size of %s = %d * %d bytes", __FUNCTION__, uxTaskGetStackHighWaterMark(NULL), sizeof(portBASE_TYPE));
+	printf("\n\rMin available stack size of %s = %d * %d bytes", __FUNCTION__, (int)uxTaskGetStackHighWaterMark(NULL), (int)sizeof(portBASE_TYPE));
 #endif
 
 	printf("\n\rUDP: UDP client stopped!");
@@ -650,7 +654,7 @@ static void udp_server_handler(void *param)
 	udp_server_func(udp_server_data);
 
 #if defined(INCLUDE_uxTaskGetStackHighWaterMark) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
-	printf("\n\rMin available stack size of %s = %d * %d bytes", __FUNCTION__, uxTaskGetStackHighWaterMark(NULL), sizeof(portBASE_TYPE));
+	printf("\n\rMin available stack size of %s = %d * %d bytes", __FUNCTION__, (int)uxTaskGetStackHighWaterMark(NULL), (int)sizeof(portBASE_TYPE));
 #endif
 
 	printf("\n\rUDP: UDP server stopped!");
@@ -713,6 +717,8 @@ void cmd_tcp(int argc, char **argv)
 				}else{
 					memset(&tcp_server_data,0,sizeof(struct iperf_data_t));
 					tcp_server_data.start = 1;
+					// only the server starts, the client's flag may be left from an earlier -c
+					tcp_client_data.start = 0;
 					argv_count++;
 				}
 			}
@@ -753,7 +759,9 @@ void cmd_tcp(int argc, char **argv)
 						goto Exit;
 					memset(&tcp_client_data,0,sizeof(struct iperf_data_t));
 					tcp_client_data.start = 1;
-					strncpy(tcp_client_data.server_ip, argv[2], (strlen(argv[2])>16)?16:strlen(argv[2]));
+					// only the client starts and takes the options, the server's flag may be left from an earlier -s
+					tcp_server_data.start = 0;
+					strncpy((char *)tcp_client_data.server_ip, argv[2], sizeof(tcp_client_data.server_ip) - 1);
 					argv_count+=2;
 				}
 			}
@@ -903,6 +911,8 @@ void cmd_udp(int argc, char **argv)
 				}else{
 					memset(&udp_server_data,0,sizeof(struct iperf_data_t));
 					udp_server_data.start = 1;
+					// only the server starts, the client's flag may be left from an earlier -c
+					udp_client_data.start = 0;
 					argv_count++;
 				}
 			}
@@ -940,7 +950,9 @@ void cmd_udp(int argc, char **argv)
 						goto Exit;
 					memset(&udp_client_data,0,sizeof(struct iperf_data_t));
 					udp_client_data.start = 1;
-					strncpy(udp_client_data.server_ip, argv[2], (strlen(argv[2])>16)?16:strlen(argv[2]));
+					// only the client starts and takes the options, the server's flag may be left from an earlier -s
+					udp_server_data.start = 0;
+					strncpy((char *)udp_client_data.server_ip, argv[2], sizeof(udp_client_data.server_ip) - 1);
 					argv_count+=2;
 				}
 			}
@@ -0,0 +1,73 @@
+/*
+ * FreeRTOSConfig.h of the host simulator. Matches main/inc/FreeRTOSConfig.h
+ * where it matters for benchmarks (tick rate, priorities, heap, stack
+ * checks), the Cortex-M, tickless and trace ring settings are left out.
+ */
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define configUSE_PREEMPTION			1
+#define configUSE_IDLE_HOOK				1	/* calls vPortSimIdle() */
+#define configUSE_TICK_HOOK				0
+#define configCPU_CLOCK_HZ				( 125000000UL )
+#define configTICK_RATE_HZ				( ( uint32_t ) 1000 )
+#define configMINIMAL_STACK_SIZE		( ( unsigned short ) 512 )
+/* All benchmarks in one run, stacks of 8 byte words, and the tasks that stay
+   such as the reconnect task of fast_connect.c */
+#ifndef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 128 * 1024 ) )
+#endif
+#define configMAX_TASK_NAME_LEN			( 10 )
+#define configUSE_TRACE_FACILITY		1
+#define configUSE_16_BIT_TICKS			0
+#define configIDLE_SHOULD_YIELD			0
+#define configUSE_CO_ROUTINES 			0
+#define configUSE_MUTEXES				1
+#define configUSE_TIMERS                1
+
+#define configMAX_PRIORITIES			( 11 )
+#define PRIORITIE_OFFSET				( 4 )
+
+#define configUSE_COUNTING_SEMAPHORES 	1
+#define configUSE_ALTERNATIVE_API 		0
+#define configCHECK_FOR_STACK_OVERFLOW	2
+#define configUSE_RECURSIVE_MUTEXES		1
+#define configUSE_MALLOC_FAILED_HOOK	0
+#define configQUEUE_REGISTRY_SIZE		0
+#define configGENERATE_RUN_TIME_STATS	0
+
+/* TLSF heap (heap_tlsf.c), as on the target */
+#define configUSE_TLSF_HEAP				1
+
+#define configTIMER_TASK_PRIORITY       ( 1 )
+#define configTIMER_QUEUE_LENGTH        ( 10 )
+#define configTIMER_TASK_STACK_DEPTH    ( 512 )
+
+/* portSIM_VIRTUAL_TIME or portSIM_REAL_TIME, see portable/GCC/POSIX/port.c */
+#define configSIM_TIME_MODE				portSIM_VIRTUAL_TIME
+
+#define INCLUDE_vTaskPrioritySet		1
+#define INCLUDE_uxTaskPriorityGet		1
+#define INCLUDE_vTaskDelete				1
+#define INCLUDE_vTaskCleanUpResources	0
+#define INCLUDE_vTaskSuspend			1
+#define INCLUDE_vTaskDelayUntil			1
+#define INCLUDE_vTaskDelay				1
+#define INCLUDE_pcTaskGetTaskName       1
+#define INCLUDE_xTimerPendFunctionCall 	1
+#define INCLUDE_xTaskGetSchedulerState	1
+#define INCLUDE_xTaskGetCurrentTaskHandle	1
+#define INCLUDE_uxTaskGetStackHighWaterMark	1
+
+/* Counts the switches to the task given to sim_task_watch(), see sim.h
+   (uxTaskNumber is taken by heap_tlsf.c) */
+extern void vSimTaskSwitchedIn( void *pxTCB );
+#define traceTASK_SWITCHED_IN()	vSimTaskSwitchedIn( pxCurrentTCB )
+
+extern void vAssertCalled( const char *pcFile, int iLine );
+#define configASSERT( x )	if( ( x ) == 0 ) vAssertCalled( __FILE__, __LINE__ )
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,10 @@
+/* Simulator build options, stands in for the WLAN driver autoconf.h */
+#ifndef WLANCONFIG_H
+#define WLANCONFIG_H
+
+#include "platform_opts.h"
+
+#define CONFIG_USE_TCM_HEAP		0
+#define NET_IF_NUM				2
+
+#endif /* WLANCONFIG_H */
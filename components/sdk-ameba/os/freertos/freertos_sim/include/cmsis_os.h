@@ -0,0 +1,13 @@
+/* Stands in for the CMSIS-RTOS header the media framework includes, only
+ * the kernel and the C library are needed from it. */
+#ifndef _CMSIS_OS_H
+#define _CMSIS_OS_H
+
+#include <platform/platform_stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#endif /* _CMSIS_OS_H */
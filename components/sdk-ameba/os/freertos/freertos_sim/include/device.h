@@ -0,0 +1,12 @@
+/* Stands in for the mbed target device.h: the flash object of flash_api.h,
+ * whose functions sim_bench_wlan.c provides over a RAM sector. */
+#ifndef MBED_DEVICE_H
+#define MBED_DEVICE_H
+
+#include <stdint.h>
+
+struct flash_s {
+	int unused;
+};
+
+#endif /* MBED_DEVICE_H */
@@ -0,0 +1,8 @@
+/* Stands in for soc/realtek/8711b/fwlib/include/hal_crypto.h: the engine is
+ * reached through rom_ssl_ram_map, where sim_bench_crypto.c switches it off. */
+#ifndef __HAL_CRYPTO_H__
+#define __HAL_CRYPTO_H__
+
+#include "basic_types.h"
+
+#endif /* __HAL_CRYPTO_H__ */
@@ -0,0 +1,15 @@
+/* Stands in for the IntoYun SDK iot_export.h for main/src, which only needs
+ * bool and the log macros from it. The logs are dropped. */
+#ifndef __IOT_EXPORT_H__
+#define __IOT_EXPORT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MOLMC_LOGE(tag, ...)	((void) (tag))
+#define MOLMC_LOGW(tag, ...)	((void) (tag))
+#define MOLMC_LOGI(tag, ...)	((void) (tag))
+#define MOLMC_LOGD(tag, ...)	((void) (tag))
+
+#endif /* __IOT_EXPORT_H__ */
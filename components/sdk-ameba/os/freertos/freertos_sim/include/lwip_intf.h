@@ -0,0 +1,22 @@
+/*
+ * Interface between ethernetif.c and the WLAN driver, stands in for the
+ * driver's lwip_intf.h. sim_netif.c implements it over a simulated wire or a
+ * TAP device.
+ */
+#ifndef __LWIP_INTF_H__
+#define __LWIP_INTF_H__
+
+#include "ethernetif.h"
+
+int rltk_wlan_send(int idx, struct eth_drv_sg *sg_list, int sg_len, int total_len);
+void rltk_wlan_recv(int idx, struct eth_drv_sg *sg_list, int sg_len);
+unsigned char rltk_wlan_running(unsigned char idx);
+
+/* Ethernet over MII, not simulated */
+int rltk_mii_send(struct eth_drv_sg *sg_list, int sg_len, int total_len);
+void rltk_mii_recv(struct eth_drv_sg *sg_list, int sg_len);
+
+int netif_get_idx(struct netif *pnetif);
+unsigned char *netif_get_hwaddr(int idx_wlan);
+
+#endif /* __LWIP_INTF_H__ */
@@ -0,0 +1,9 @@
+/* Stands in for common/api/platform/platform_stdlib.h in the check build of
+ * the media modules: the host C library and, as on the 8195A, diag.h. */
+#ifndef __MEDIA_PLATFORM_STDLIB_H__
+#define __MEDIA_PLATFORM_STDLIB_H__
+
+#include "../../platform/platform_stdlib.h"
+#include "diag.h"
+
+#endif /* __MEDIA_PLATFORM_STDLIB_H__ */
@@ -0,0 +1,8 @@
+/* Stands in for the UVC driver uvcvideo.h, which needs the Linux kernel
+ * headers. The media modules take only the error numbers through it. */
+#ifndef _USB_VIDEO_H_
+#define _USB_VIDEO_H_
+
+#include "usb_errno.h"
+
+#endif /* _USB_VIDEO_H_ */
@@ -0,0 +1,6 @@
+/* Stands in for the V4L2 videodev2.h, which needs the Linux kernel headers.
+ * The media modules only use the UVC calls of uvc_intf.h. */
+#ifndef __LINUX_VIDEODEV2_H
+#define __LINUX_VIDEODEV2_H
+
+#endif /* __LINUX_VIDEODEV2_H */
@@ -0,0 +1,11 @@
+/* Stands in for os/os_dep/include/osdep_service.h, the lwIP core only needs
+ * the kernel headers from it. */
+#ifndef __OSDEP_SERVICE_H_
+#define __OSDEP_SERVICE_H_
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#endif /* __OSDEP_SERVICE_H_ */
@@ -0,0 +1,21 @@
+/* Host C library for the simulator, stands in for common/api/platform/platform_stdlib.h */
+#ifndef __PLATFORM_STDLIB_H__
+#define __PLATFORM_STDLIB_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#define rtl_printf		printf
+#define rtl_sprintf		sprintf
+#define rtl_snprintf	snprintf
+
+/* From basic_types.h, which the target gets through diag.h */
+#ifndef _WEAK
+#define _WEAK			__attribute__ ((weak))
+#endif
+
+#endif /* __PLATFORM_STDLIB_H__ */
@@ -0,0 +1,51 @@
+/* Simulator platform options, stands in for main/inc/platform_opts.h */
+#ifndef __PLATFORM_OPTS_H__
+#define __PLATFORM_OPTS_H__
+
+#define CONFIG_PLATFORM_SIM		1
+
+#define CONFIG_LWIP_LAYER		1
+#define CONFIG_WLAN				1
+
+/* The host C library has its own struct timeval */
+#define LWIP_TIMEVAL_PRIVATE	0
+
+/* Room for the 32 sockets of the poll bench next to the other benches */
+#define MEMP_NUM_NETCONN		40
+#define MEMP_NUM_UDP_PCB		40
+
+/* 8 segments of window instead of the shipped 4, so that a loss gets the
+   three dupacks of fast recovery and SACK, see the tcploss bench. The heap
+   holds TCP_SND_BUF: 8 segments of 1460 bytes with their headers and pbufs
+   take about 12.4KB. The pbuf pool holds TCP_WND in 500 byte pbufs, and
+   the segment pool TCP_SND_QUEUELEN. */
+#ifndef TCP_WND
+#define TCP_WND					(8*TCP_MSS)
+#endif
+#ifndef TCP_SND_BUF
+#define TCP_SND_BUF				(8*TCP_MSS)
+#endif
+#ifndef MEM_SIZE
+#define MEM_SIZE				(13*1024)
+#endif
+#ifndef PBUF_POOL_SIZE
+#define PBUF_POOL_SIZE			28
+#endif
+#ifndef MEMP_NUM_TCP_SEG
+#define MEMP_NUM_TCP_SEG		32
+#endif
+
+/* The flash sector of main/src/fast_connect.c, see sim_bench_wlan.c */
+#define FAST_RECONNECT_DATA		(0x80000 - 0x1000)
+#define FLASH_SECTOR_SIZE		0x1000
+
+/* Both ends of the simulated wire are in one stack, see sim_netif.c */
+struct ip_addr;
+struct netif *sim_ip4_route(struct ip_addr *dest);
+#define LWIP_HOOK_IP4_ROUTE(dest)	sim_ip4_route(dest)
+
+/* New answers of pinned hosts go to the dns bench, see sim_bench_dns.c */
+void sim_dns_pinned_update(const char *name, const struct ip_addr *addr, unsigned int ttl);
+#define DNS_PINNED_UPDATE(name, addr, ttl)	sim_dns_pinned_update(name, addr, ttl)
+
+#endif /* __PLATFORM_OPTS_H__ */
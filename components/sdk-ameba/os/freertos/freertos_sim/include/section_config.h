@@ -0,0 +1,8 @@
+/* Stands in for soc/realtek/common/bsp/section_config.h, the host has one
+ * memory and needs no placement. */
+#ifndef _SECTION_CONFIG_H_
+#define _SECTION_CONFIG_H_
+
+#define SDRAM_DATA_SECTION
+
+#endif /* _SECTION_CONFIG_H_ */
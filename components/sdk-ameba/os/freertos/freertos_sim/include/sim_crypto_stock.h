@@ -0,0 +1,13 @@
+/* The mbed TLS configuration without the library/rtl_sw_crypto.c kernels,
+ * for make VARIANT=stockcrypto. */
+#ifndef SIM_CRYPTO_STOCK_H
+#define SIM_CRYPTO_STOCK_H
+
+#include "mbedtls/config.h"
+
+#undef MBEDTLS_AES_ENCRYPT_ALT
+#undef MBEDTLS_AES_DECRYPT_ALT
+#undef MBEDTLS_GCM_MULT_ALT
+#undef MBEDTLS_SHA256_PROCESS_ALT
+
+#endif /* SIM_CRYPTO_STOCK_H */
@@ -0,0 +1,5 @@
+/* No TCM on the host, stands in for os/os_dep/include/tcm_heap.h */
+#ifndef STRUCT_HEAP_H
+#define STRUCT_HEAP_H
+
+#endif /* STRUCT_HEAP_H */
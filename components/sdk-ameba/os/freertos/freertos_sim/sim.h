@@ -0,0 +1,99 @@
+/*
+ * Host simulator: the simulated WLAN link (sim_netif.c) and the benchmarks
+ * (sim_bench*.c).
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdint.h>
+
+#include "lwip/netif.h"
+#include "lwip/lwip_timers.h"
+
+/* netif 0 is 10.0.0.1, netif 1 is 10.0.0.2, linked by the simulated wire.
+   With a TAP device only netif 0 exists and the host is 10.0.0.2. */
+#define SIM_IP(last)		(0x0a000000UL | (last))
+
+typedef struct {
+	uint32_t latency;		/* ticks from send to delivery */
+	uint32_t rate;			/* bytes per tick, 0 = unlimited */
+	uint32_t loss;			/* frames dropped per 10000 */
+	uint32_t seed;			/* loss pattern */
+} sim_wire_config;
+
+typedef struct {
+	uint32_t tx_frames;
+	uint32_t tx_bytes;
+	uint32_t rx_frames;
+	uint32_t lost;			/* dropped by the loss pattern */
+	uint32_t overflow;		/* dropped because the wire queue was full */
+	uint32_t tcp_rexmit;	/* TCP segments resent below the highest seqno sent */
+} sim_wire_stats;
+
+extern struct netif xnetif[];
+
+/* Before vTaskStartScheduler(): sets up lwIP and the interfaces. tap is the
+   name of a TAP device to bind netif 0 to, or NULL for the simulated wire. */
+int sim_netif_init(const sim_wire_config *config, const char *tap);
+void sim_netif_get_stats(int idx, sim_wire_stats *stats);
+void sim_netif_reset_stats(void);
+/* Change the wire rate of both directions, return the previous one. Frames
+   already queued keep their delivery tick. */
+uint32_t sim_netif_set_rate(uint32_t rate);
+/* Change the latency of both directions, return the previous one */
+uint32_t sim_netif_set_latency(uint32_t latency);
+/* Change the loss rate of both directions and restart the loss pattern from
+   seed (0 = the configured one), return the previous rate */
+uint32_t sim_netif_set_loss(uint32_t loss, uint32_t seed);
+
+/* The board's iperf, tcptest.c, sending size ("512K", "4M") from 10.0.0.1
+   to 10.0.0.2: the ticks until both tcptest tasks stopped, or -1 */
+int sim_iperf_run(const char *name, const char *size);
+
+/* sim_timers_other.c: the timeout implementation lwIP is not built with (the
+   sorted list, or the wheel with VARIANT=nowheel), for up to
+   SIM_TIMERS_OTHER_NUM timeouts. Started once, driven from one task. */
+#define SIM_TIMERS_OTHER_NUM	256
+void other_sys_timeouts_start(void);
+void other_sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg);
+void other_sys_untimeout(sys_timeout_handler handler, void *arg);
+void other_sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg);
+
+/* Benchmarks, each returns 0 on success */
+int sim_bench_sched(void);
+int sim_bench_heap(void);
+int sim_bench_tcp(void);
+int sim_bench_tcploss(void);
+int sim_bench_udp(void);
+int sim_bench_chksum(void);
+int sim_bench_iperf(void);
+int sim_bench_rx(void);
+int sim_bench_lock(void);
+int sim_bench_timers(void);
+int sim_bench_dns(void);
+int sim_bench_wlan(void);
+int sim_bench_crypto(void);
+int sim_bench_pools(void);
+int sim_bench_mmf(void);
+int sim_bench_g711(void);
+int sim_bench_h264(void);
+int sim_bench_rtp(void);
+int sim_bench_fanout(void);
+int sim_bench_rate(void);
+int sim_bench_jitter(void);
+int sim_bench_fmp4(void);
+int sim_bench_mp3(void);
+int sim_bench_tl(void);
+int sim_bench_poll(void);
+void sim_bench_tap_servers(void);
+
+uint64_t sim_host_ns(void);
+
+/* Count the times the scheduler switches to task, i.e. its wakeups (NULL
+   stops), and return the count so far */
+void sim_task_watch(void *task);
+uint32_t sim_task_switches(void);
+/* Count of all task switches so far */
+uint32_t sim_switches(void);
+
+#endif /* __SIM_H__ */
@@ -0,0 +1,463 @@
+/*
+ * Benchmarks for the host simulator.
+ *
+ * Each benchmark prints one line per result: the simulated time in ticks,
+ * which is reproducible in virtual time, and the host time spent, which
+ * measures the code itself (only comparable between runs on the same host).
+ */
+
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "lwip/sockets.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+
+#include "sim.h"
+
+#define BENCH_TASK_PRIO		(tskIDLE_PRIORITY + 2)
+#define BENCH_TIMEOUT		(60 * configTICK_RATE_HZ)
+
+#define SCHED_ROUND_TRIPS	20000
+
+#define HEAP_SLOTS			64
+#define HEAP_OPS			200000
+
+#define TCP_PORT			5001
+#define TCP_BYTES			(2 * 1024 * 1024)
+#define TCP_CHUNK			(4 * 1460)
+#define TCP_LOSS_BYTES		(512 * 1024)
+#define TCP_LOSS_SIZE		"512K"
+#define TCP_SETTLE			(3 * MEMP_ELASTIC_TMR_INTERVAL)
+#define TCP_POOL_OPS		20000
+#define TCP_POOL_RUNS		5
+
+#define UDP_PORT			7
+#define UDP_PINGS			1000
+#define UDP_SIZE			64
+#define UDP_TIMEOUT_MS		100
+
+static SemaphoreHandle_t done_sem;
+
+uint64_t sim_host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_begin(void)
+{
+	if (done_sem == NULL)
+		done_sem = xSemaphoreCreateBinary();
+}
+
+static int bench_wait(const char *name)
+{
+	if (xSemaphoreTake(done_sem, BENCH_TIMEOUT) != pdTRUE) {
+		printf("%-6s timed out\n", name);
+		return -1;
+	}
+	return 0;
+}
+
+static void print_wire(const char *name)
+{
+	sim_wire_stats s0, s1;
+
+	sim_netif_get_stats(0, &s0);
+	sim_netif_get_stats(1, &s1);
+	printf("%-6s wire 0->1 %u frames %u bytes lost %u overflow %u, 1->0 %u frames %u bytes lost %u overflow %u\n",
+		name, s0.tx_frames, s0.tx_bytes, s0.lost, s0.overflow, s1.tx_frames, s1.tx_bytes, s1.lost, s1.overflow);
+	if (s0.tcp_rexmit || s1.tcp_rexmit)
+		printf("%-6s TCP segments resent 0->1 %u, 1->0 %u\n", name, s0.tcp_rexmit, s1.tcp_rexmit);
+}
+
+/*
+ * Scheduler: queue ping-pong between two tasks, two context switches and
+ * four queue operations per round trip.
+ */
+static QueueHandle_t ping_q, pong_q;
+
+static void pong_task(void *param)
+{
+	uint32_t v;
+
+	(void) param;
+
+	for (;;) {
+		xQueueReceive(ping_q, &v, portMAX_DELAY);
+		if (v == 0)
+			break;
+		xQueueSend(pong_q, &v, portMAX_DELAY);
+	}
+
+	xSemaphoreGive(done_sem);
+	vTaskDelete(NULL);
+}
+
+int sim_bench_sched(void)
+{
+	uint32_t i, v;
+	uint64_t ns;
+	TickType_t ticks;
+
+	bench_begin();
+	ping_q = xQueueCreate(1, sizeof(uint32_t));
+	pong_q = xQueueCreate(1, sizeof(uint32_t));
+	xTaskCreate(pong_task, (const char *) "pong", 512, NULL, BENCH_TASK_PRIO, NULL);
+
+	ticks = xTaskGetTickCount();
+	ns = sim_host_ns();
+	for (i = 1; i <= SCHED_ROUND_TRIPS; i++) {
+		xQueueSend(ping_q, &i, portMAX_DELAY);
+		xQueueReceive(pong_q, &v, portMAX_DELAY);
+		configASSERT(v == i);
+	}
+	ns = sim_host_ns() - ns;
+	ticks = xTaskGetTickCount() - ticks;
+
+	v = 0;
+	xQueueSend(ping_q, &v, portMAX_DELAY);
+	if (bench_wait("sched") < 0)
+		return -1;
+
+	vQueueDelete(ping_q);
+	vQueueDelete(pong_q);
+
+	printf("sched  %u round trips in %u ticks, host %.0f ns per round trip\n",
+		SCHED_ROUND_TRIPS, (unsigned) ticks, (double) ns / SCHED_ROUND_TRIPS);
+
+	return 0;
+}
+
+/*
+ * Heap: random malloc/free churn over a fixed number of slots, mostly small
+ * blocks with an occasional 4 KB buffer, then the fragmentation it left.
+ */
+int sim_bench_heap(void)
+{
+	void *slot[HEAP_SLOTS] = { NULL };
+	uint32_t rnd = 12345, i, n, size, failed = 0;
+	uint64_t ns;
+	HeapStats_t before, churn, after;
+
+	vPortGetHeapStats(&before);
+
+	ns = sim_host_ns();
+	for (i = 0; i < HEAP_OPS; i++) {
+		rnd = rnd * 1103515245 + 12345;
+		n = (rnd >> 8) % HEAP_SLOTS;
+		if (slot[n]) {
+			vPortFree(slot[n]);
+			slot[n] = NULL;
+		} else {
+			size = ((rnd >> 20) & 0x3f) == 0 ? 4096 : 16 + ((rnd >> 16) % 1009);
+			slot[n] = pvPortMalloc(size);
+			if (slot[n] == NULL)
+				failed++;
+		}
+	}
+	ns = sim_host_ns() - ns;
+
+	vPortGetHeapStats(&churn);
+
+	for (n = 0; n < HEAP_SLOTS; n++)
+		vPortFree(slot[n]);
+
+	vPortGetHeapStats(&after);
+
+	printf("heap   %u ops, %u failed, host %.0f ns per op\n", HEAP_OPS, failed, (double) ns / HEAP_OPS);
+	printf("heap   after churn: %u free in %u blocks, largest %u\n",
+		(unsigned) churn.xFreeBytes, (unsigned) churn.xFreeBlocks, (unsigned) churn.xLargestFreeBlock);
+	printf("heap   after free: %u free (%u before) in %u blocks, largest %u, minimum ever free %u\n",
+		(unsigned) after.xFreeBytes, (unsigned) before.xFreeBytes, (unsigned) after.xFreeBlocks,
+		(unsigned) after.xLargestFreeBlock, (unsigned) after.xMinimumEverFreeBytes);
+
+	return (after.xFreeBytes == before.xFreeBytes) ? 0 : -1;
+}
+
+/*
+ * TCP: bulk transfer from 10.0.0.1 to a sink on 10.0.0.2 over the wire.
+ */
+static uint32_t tcp_received;
+static TickType_t tcp_done_tick;
+static TaskHandle_t tcp_sink;
+
+static void tcp_sink_task(void *param)
+{
+	static char buf[TCP_CHUNK];
+	struct sockaddr_in addr;
+	int s, c, n;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(TCP_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+	listen(s, 1);
+
+	for (;;) {
+		c = accept(s, NULL, NULL);
+		if (c < 0)
+			break;
+
+		tcp_received = 0;
+		while ((n = recv(c, buf, sizeof(buf), 0)) > 0)
+			tcp_received += n;
+		tcp_done_tick = xTaskGetTickCount();
+		close(c);
+
+		if (done_sem)
+			xSemaphoreGive(done_sem);
+	}
+
+	close(s);
+	vTaskDelete(NULL);
+}
+
+/* Send bytes to the sink, return the ticks until it has received them all */
+static int tcp_transfer(const char *name, uint32_t bytes)
+{
+	static char buf[TCP_CHUNK];
+	struct sockaddr_in addr;
+	uint32_t sent = 0;
+	TickType_t start;
+	int s, n;
+
+	bench_begin();
+	if (tcp_sink == NULL)
+		xTaskCreate(tcp_sink_task, (const char *) "tcp_sink", 1024, NULL, BENCH_TASK_PRIO, &tcp_sink);
+
+	memset(buf, 0x5a, sizeof(buf));
+	sim_netif_reset_stats();
+
+	start = xTaskGetTickCount();
+
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(TCP_PORT);
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+	if (connect(s, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		printf("%-6s connect failed\n", name);
+		close(s);
+		return -1;
+	}
+
+	while (sent < bytes) {
+		n = send(s, buf, bytes - sent < sizeof(buf) ? bytes - sent : sizeof(buf), 0);
+		if (n <= 0)
+			break;
+		sent += n;
+	}
+	close(s);
+
+	if (bench_wait(name) < 0 || tcp_received != bytes)
+		return -1;
+
+	return tcp_done_tick - start ? tcp_done_tick - start : 1;
+}
+
+/* Best host ns for an alloc/free pair of the RX pbuf and TCP segment pools,
+   where LWIP_STATS counts and keeps its histogram on the data path */
+static double tcp_pool_ns(memp_t type)
+{
+	uint64_t ns, best = UINT64_MAX;
+	void *p;
+	int i, run;
+
+	for (run = 0; run < TCP_POOL_RUNS; run++) {
+		ns = sim_host_ns();
+		for (i = 0; i < TCP_POOL_OPS; i++) {
+			if (type == MEMP_PBUF_POOL) {
+				p = pbuf_alloc(PBUF_RAW, TCP_MSS, PBUF_POOL);
+				pbuf_free((struct pbuf *) p);
+			} else {
+				p = memp_malloc(type);
+				memp_free(type, p);
+			}
+		}
+		ns = sim_host_ns() - ns;
+		if (ns < best)
+			best = ns;
+	}
+
+	return (double) best / TCP_POOL_OPS;
+}
+
+int sim_bench_tcp(void)
+{
+	uint64_t ns = sim_host_ns();
+	int ticks;
+
+	ticks = tcp_transfer("tcp", TCP_BYTES);
+	ns = sim_host_ns() - ns;
+	if (ticks < 0)
+		return -1;
+
+	printf("tcp    %u bytes in %u ticks (%.0f KB/s), host %.1f ms (%.1f ns per byte)\n",
+		TCP_BYTES, ticks, (double) TCP_BYTES * configTICK_RATE_HZ / 1024 / ticks,
+		(double) ns / 1e6, (double) ns / TCP_BYTES);
+	print_wire("tcp");
+	printf("tcp    pool alloc/free: pbuf %.1f ns, segment %.1f ns, stats %s\n",
+		tcp_pool_ns(MEMP_PBUF_POOL), tcp_pool_ns(MEMP_TCP_SEG), LWIP_STATS ? "on" : "off");
+
+	return 0;
+}
+
+/*
+ * TCP under loss: the board's iperf, tcptest.c, sending TCP_LOSS_SIZE at
+ * 0 to 5% frame loss in both directions, over TCP_LOSS_SEEDS loss patterns
+ * each since a single retransmission timeout costs more than the rest of a
+ * transfer. A loss that does not get three duplicate ACKs, or a lost
+ * retransmission, waits for the timeout; with SACK the holes after the
+ * first are resent in the same recovery.
+ */
+#define TCP_LOSS_SEEDS		4
+
+static const uint32_t tcp_loss[] = { 0, 50, 100, 200, 300, 500 };
+
+int sim_bench_tcploss(void)
+{
+	sim_wire_stats s0, s1;
+	uint32_t old, seed, ticks, min, max, lost, frames, resent;
+	unsigned i;
+	int t, ret = 0;
+
+	for (i = 0; i < sizeof(tcp_loss) / sizeof(tcp_loss[0]); i++) {
+		ticks = lost = frames = resent = max = 0;
+		min = UINT32_MAX;
+		for (seed = 1; seed <= TCP_LOSS_SEEDS; seed++) {
+			/* the pools give back what the last transfer borrowed */
+			vTaskDelay(TCP_SETTLE);
+			old = sim_netif_set_loss(tcp_loss[i], seed);
+			sim_netif_reset_stats();
+			t = sim_iperf_run("tcploss", TCP_LOSS_SIZE);
+			sim_netif_set_loss(old, 0);
+			if (t < 0)
+				break;
+
+			sim_netif_get_stats(0, &s0);
+			sim_netif_get_stats(1, &s1);
+			ticks += t;
+			min = (uint32_t) t < min ? (uint32_t) t : min;
+			max = (uint32_t) t > max ? (uint32_t) t : max;
+			lost += s0.lost + s1.lost;
+			frames += s0.tx_frames + s0.lost + s1.tx_frames + s1.lost;
+			resent += s0.tcp_rexmit;
+		}
+		if (seed <= TCP_LOSS_SEEDS) {
+			printf("tcploss loss %u.%02u%% failed\n", tcp_loss[i] / 100, tcp_loss[i] % 100);
+			ret = -1;
+			continue;
+		}
+
+		printf("tcploss loss %u.%02u%%: %4.0f KB/s (%4.0f to %4.0f), lost %3u/%u frames, resent %3u segments\n",
+			tcp_loss[i] / 100, tcp_loss[i] % 100,
+			(double) TCP_LOSS_BYTES * TCP_LOSS_SEEDS * configTICK_RATE_HZ / 1024 / ticks,
+			(double) TCP_LOSS_BYTES * configTICK_RATE_HZ / 1024 / max,
+			(double) TCP_LOSS_BYTES * configTICK_RATE_HZ / 1024 / min,
+			lost, frames, resent);
+	}
+	vTaskDelay(TCP_SETTLE);
+
+	return ret;
+}
+
+/*
+ * UDP: request/response latency against an echo server on 10.0.0.2.
+ */
+static void udp_echo_task(void *param)
+{
+	char buf[UDP_SIZE];
+	struct sockaddr_in addr;
+	socklen_t len;
+	int s, n;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(UDP_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+
+	for (;;) {
+		len = sizeof(addr);
+		n = recvfrom(s, buf, sizeof(buf), 0, (struct sockaddr *) &addr, &len);
+		if (n > 0)
+			sendto(s, buf, n, 0, (struct sockaddr *) &addr, len);
+	}
+}
+
+int sim_bench_udp(void)
+{
+	char buf[UDP_SIZE];
+	struct sockaddr_in addr;
+	uint32_t i, seq, lost = 0, max_ticks = 0, total_ticks = 0;
+	uint64_t ns;
+	TickType_t t;
+	int s, timeout = UDP_TIMEOUT_MS;
+
+	xTaskCreate(udp_echo_task, (const char *) "udp_echo", 512, NULL, BENCH_TASK_PRIO, NULL);
+	sim_netif_reset_stats();
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(UDP_PORT);
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+
+	memset(buf, 0, sizeof(buf));
+	ns = sim_host_ns();
+	for (i = 0; i < UDP_PINGS; i++) {
+		memcpy(buf, &i, sizeof(i));
+		t = xTaskGetTickCount();
+		sendto(s, buf, sizeof(buf), 0, (struct sockaddr *) &addr, sizeof(addr));
+
+		/* Drop late answers to earlier pings */
+		seq = i - 1;
+		do {
+			if (recv(s, buf, sizeof(buf), 0) <= 0) {
+				lost++;
+				break;
+			}
+			memcpy(&seq, buf, sizeof(seq));
+		} while (seq != i);
+
+		t = xTaskGetTickCount() - t;
+		if (seq == i) {
+			total_ticks += t;
+			if (t > max_ticks)
+				max_ticks = t;
+		}
+	}
+	ns = sim_host_ns() - ns;
+	close(s);
+
+	printf("udp    %u pings, %u lost, rtt avg %.2f max %u ticks, host %.0f ns per ping\n",
+		UDP_PINGS, lost, (double) total_ticks / (UDP_PINGS - lost ? UDP_PINGS - lost : 1), max_ticks,
+		(double) ns / UDP_PINGS);
+	print_wire("udp");
+
+	return 0;
+}
+
+/* With a TAP device: TCP sink on port 5001 and UDP echo on port 7 for host tools */
+void sim_bench_tap_servers(void)
+{
+	xTaskCreate(tcp_sink_task, (const char *) "tcp_sink", 1024, NULL, BENCH_TASK_PRIO, NULL);
+	xTaskCreate(udp_echo_task, (const char *) "udp_echo", 512, NULL, BENCH_TASK_PRIO, NULL);
+}
@@ -0,0 +1,148 @@
+/*
+ * Internet checksum over TCP segment sizes, 64 to 1460 bytes:
+ *
+ *   sum        inet_chksum(), i.e. LWIP_CHKSUM_ALGORITHM
+ *   copy+sum   MEMCPY then inet_chksum(), what tcp_write() and udp do
+ *              without LWIP_CHECKSUM_ON_COPY
+ *   fused      lwip_chksum_copy(), the copy that sums on the way
+ *              (LWIP_CHKSUM_COPY_ALGORITHM 2)
+ *
+ * Host ns per call, the best of CHKSUM_RUNS. Both are first checked against
+ * a byte-pair reference at every length up to CHKSUM_MAX and every source
+ * and destination alignment.
+ *
+ * make VARIANT=stockchksum builds the same with the stock lwIP checksum
+ * (version #2, no checksum on copy).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/inet_chksum.h"
+
+#include "sim.h"
+
+#define CHKSUM_MAX			1500
+#define CHKSUM_ALIGN		8
+#define CHKSUM_BYTES		(2 * 1024 * 1024)	/* summed per size and run */
+#define CHKSUM_RUNS			5
+
+static const int chksum_sizes[] = { 64, 128, 256, 512, 1024, 1460 };
+
+static uint8_t src[CHKSUM_MAX + CHKSUM_ALIGN], dst[CHKSUM_MAX + CHKSUM_ALIGN];
+static volatile uint32_t chksum_sink;
+
+/* The non-inverted Internet sum one 16 bit word at a time, as the words
+   are laid out in memory */
+static u16_t chksum_ref(const uint8_t *p, int len)
+{
+	uint32_t acc = 0;
+	u16_t w;
+	int i;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		memcpy(&w, p + i, 2);
+		acc += w;
+	}
+	if (len & 1) {
+		w = 0;
+		memcpy(&w, p + len - 1, 1);
+		acc += w;
+	}
+	while (acc >> 16)
+		acc = (acc & 0xffff) + (acc >> 16);
+
+	return (u16_t) acc;
+}
+
+static int chksum_check(void)
+{
+	int s, len;
+#if LWIP_CHKSUM_COPY_ALGORITHM
+	int d;
+#endif
+
+	for (s = 0; s < CHKSUM_ALIGN; s++) {
+		for (len = 0; len <= CHKSUM_MAX; len++) {
+			if (inet_chksum(src + s, len) != (u16_t) ~chksum_ref(src + s, len)) {
+				printf("chksum sum wrong, offset %d length %d\n", s, len);
+				return -1;
+			}
+#if LWIP_CHKSUM_COPY_ALGORITHM
+			for (d = 0; d < CHKSUM_ALIGN; d += 3) {
+				memset(dst, 0xa5, sizeof(dst));
+				if (lwip_chksum_copy(dst + d, src + s, len) != chksum_ref(src + s, len) ||
+						memcmp(dst + d, src + s, len) != 0 || dst[d + len] != 0xa5) {
+					printf("chksum fused copy wrong, offsets %d/%d length %d\n", s, d, len);
+					return -1;
+				}
+			}
+#endif
+		}
+	}
+
+	return 0;
+}
+
+/* Best host ns per call: 0 sum, 1 copy+sum, 2 fused */
+static double chksum_ns(int how, int size)
+{
+	uint64_t ns, best = UINT64_MAX;
+	uint32_t acc = 0;
+	int i, n = CHKSUM_BYTES / size, run;
+
+	for (run = 0; run < CHKSUM_RUNS; run++) {
+		ns = sim_host_ns();
+		for (i = 0; i < n; i++) {
+			if (how == 0) {
+				acc += inet_chksum(src, size);
+			} else if (how == 1) {
+				MEMCPY(dst, src, size);
+				acc += inet_chksum(dst, size);
+#if LWIP_CHKSUM_COPY_ALGORITHM
+			} else {
+				acc += lwip_chksum_copy(dst, src, size);
+#endif
+			}
+		}
+		ns = sim_host_ns() - ns;
+		if (ns < best)
+			best = ns;
+	}
+	chksum_sink += acc;
+
+	return (double) best / n;
+}
+
+int sim_bench_chksum(void)
+{
+	unsigned i;
+
+	srand(1);
+	for (i = 0; i < sizeof(src); i++)
+		src[i] = rand();
+
+	if (chksum_check() != 0)
+		return -1;
+
+	for (i = 0; i < sizeof(chksum_sizes) / sizeof(chksum_sizes[0]); i++) {
+		int size = chksum_sizes[i];
+		double sum = chksum_ns(0, size), copy = chksum_ns(1, size);
+
+#if LWIP_CHKSUM_COPY_ALGORITHM
+		double fused = chksum_ns(2, size);
+
+		printf("chksum %4d bytes: sum %6.1f ns (%.3f ns/byte), copy+sum %6.1f ns, fused %6.1f ns, algorithm %d\n",
+			size, sum, sum / size, copy, fused, LWIP_CHKSUM_ALGORITHM);
+#else
+		printf("chksum %4d bytes: sum %6.1f ns (%.3f ns/byte), copy+sum %6.1f ns, fused -, algorithm %d\n",
+			size, sum, sum / size, copy, LWIP_CHKSUM_ALGORITHM);
+#endif
+	}
+
+	return 0;
+}
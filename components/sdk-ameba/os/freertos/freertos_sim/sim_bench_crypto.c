@@ -0,0 +1,226 @@
+/*
+ * The software AES and SHA-256 kernels of mbedtls-2.4.0/library/rtl_sw_crypto.c
+ * alone, with the crypto engine switched off in rom_ssl_ram_map:
+ *
+ *   kat      SP800-38A F.2.1 CBC-AES128, encrypted and decrypted
+ *   speed    AES-128 and AES-256 block encryption, AES-128 decryption and
+ *            SHA-256 of a million 'a' fed from an aligned and an unaligned
+ *            buffer. Host ns and TSC cycles per byte, the best of
+ *            CRYPTO_RUNS.
+ *
+ * The benchmark fails on a wrong ciphertext or digest.
+ *
+ * make VARIANT=stockcrypto builds the same with the stock mbed TLS AES and
+ * SHA-256 instead of library/rtl_sw_crypto.c. The mbed TLS configuration
+ * has no GCM, so GHASH is not measured.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CRYPTO_CYCLES()			__rdtsc()
+#else
+#define CRYPTO_CYCLES()			0
+#endif
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
+
+#include "sim.h"
+
+#define CRYPTO_SPEED_BYTES		(1000 * 1000)
+#define CRYPTO_SPEED_CHUNK		1000
+#define CRYPTO_RUNS				5
+
+static const unsigned char kat_key[16] = {
+	0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const unsigned char kat_iv[16] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const unsigned char kat_plain[64] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+	0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+	0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+	0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+static const unsigned char kat_cipher[64] = {
+	0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+	0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+	0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+	0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+
+/* SHA-256 of CRYPTO_SPEED_BYTES 'a', FIPS 180-2 B.3 */
+static const unsigned char sha_million_a[32] = {
+	0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+	0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0
+};
+
+static unsigned char crypto_buf[CRYPTO_SPEED_CHUNK + 1];
+
+/* No engine: every request takes the software path */
+struct _rom_ssl_ram_map rom_ssl_ram_map = {
+	.use_hw_crypto_func = 0,
+};
+
+static void crypto_fill(unsigned char *buf, size_t len, uint32_t seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (unsigned char) (seed >> 16);
+	}
+}
+
+static int crypto_kat(void)
+{
+	mbedtls_aes_context enc, dec;
+	unsigned char iv[16], buf[64];
+	int ret = 0;
+
+	mbedtls_aes_init(&enc);
+	mbedtls_aes_init(&dec);
+	mbedtls_aes_setkey_enc(&enc, kat_key, 128);
+	mbedtls_aes_setkey_dec(&dec, kat_key, 128);
+
+	memcpy(iv, kat_iv, 16);
+	mbedtls_aes_crypt_cbc(&enc, MBEDTLS_AES_ENCRYPT, sizeof(kat_plain), iv, kat_plain, buf);
+	if (memcmp(buf, kat_cipher, sizeof(buf)) != 0) {
+		printf("crypto kat: encrypt wrong\n");
+		ret = -1;
+	}
+	memcpy(iv, kat_iv, 16);
+	mbedtls_aes_crypt_cbc(&dec, MBEDTLS_AES_DECRYPT, sizeof(buf), iv, buf, buf);
+	if (memcmp(buf, kat_plain, sizeof(buf)) != 0) {
+		printf("crypto kat: decrypt wrong\n");
+		ret = -1;
+	}
+
+	mbedtls_aes_free(&enc);
+	mbedtls_aes_free(&dec);
+	return ret;
+}
+
+typedef struct {
+	uint64_t ns;
+	uint64_t cycles;
+} crypto_time;
+
+static void crypto_best(crypto_time *best, uint64_t ns, uint64_t cycles)
+{
+	if (best->ns == 0 || ns < best->ns) {
+		best->ns = ns;
+		best->cycles = cycles;
+	}
+}
+
+static void crypto_print(const char *what, const char *impl, const crypto_time *t)
+{
+	printf("crypto speed %-12s %6.2f ns/byte, %6.2f cycles/byte, %s\n", what,
+		(double) t->ns / CRYPTO_SPEED_BYTES, (double) t->cycles / CRYPTO_SPEED_BYTES, impl);
+}
+
+/* Best time of CRYPTO_SPEED_BYTES through one block kernel */
+static void crypto_speed_aes(const char *what, unsigned int keybits, int mode)
+{
+	mbedtls_aes_context ctx;
+	unsigned char key[32], block[16];
+	crypto_time best = { 0, 0 };
+	uint64_t ns, cycles;
+	int i, run;
+
+	crypto_fill(key, sizeof(key), keybits);
+	crypto_fill(block, sizeof(block), mode);
+	mbedtls_aes_init(&ctx);
+	if (mode == MBEDTLS_AES_ENCRYPT)
+		mbedtls_aes_setkey_enc(&ctx, key, keybits);
+	else
+		mbedtls_aes_setkey_dec(&ctx, key, keybits);
+
+	for (run = 0; run < CRYPTO_RUNS; run++) {
+		ns = sim_host_ns();
+		cycles = CRYPTO_CYCLES();
+		for (i = 0; i < CRYPTO_SPEED_BYTES / 16; i++) {
+			if (mode == MBEDTLS_AES_ENCRYPT)
+				mbedtls_aes_encrypt(&ctx, block, block);
+			else
+				mbedtls_aes_decrypt(&ctx, block, block);
+		}
+		cycles = CRYPTO_CYCLES() - cycles;
+		ns = sim_host_ns() - ns;
+		crypto_best(&best, ns, cycles);
+	}
+	mbedtls_aes_free(&ctx);
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT)
+	crypto_print(what, "rtl_sw_crypto", &best);
+#else
+	crypto_print(what, "stock", &best);
+#endif
+}
+
+/* SHA-256 of a million 'a' at offset in crypto_buf, 0 if right */
+static int crypto_speed_sha256(const char *what, size_t offset)
+{
+	mbedtls_sha256_context ctx;
+	unsigned char digest[32];
+	crypto_time best = { 0, 0 };
+	uint64_t ns, cycles;
+	int i, run, ret = 0;
+
+	memset(crypto_buf, 'a', CRYPTO_SPEED_CHUNK + offset);
+
+	for (run = 0; run < CRYPTO_RUNS; run++) {
+		ns = sim_host_ns();
+		cycles = CRYPTO_CYCLES();
+		mbedtls_sha256_init(&ctx);
+		mbedtls_sha256_starts(&ctx, 0);
+		for (i = 0; i < CRYPTO_SPEED_BYTES / CRYPTO_SPEED_CHUNK; i++)
+			mbedtls_sha256_update(&ctx, crypto_buf + offset, CRYPTO_SPEED_CHUNK);
+		mbedtls_sha256_finish(&ctx, digest);
+		mbedtls_sha256_free(&ctx);
+		cycles = CRYPTO_CYCLES() - cycles;
+		ns = sim_host_ns() - ns;
+		crypto_best(&best, ns, cycles);
+
+		if (memcmp(digest, sha_million_a, sizeof(digest)) != 0) {
+			printf("crypto speed %s: digest wrong\n", what);
+			ret = -1;
+		}
+	}
+
+#if defined(MBEDTLS_SHA256_PROCESS_ALT)
+	crypto_print(what, "rtl_sw_crypto", &best);
+#else
+	crypto_print(what, "stock", &best);
+#endif
+	return ret;
+}
+
+static int crypto_speed(void)
+{
+	int ret = 0;
+
+	crypto_speed_aes("aes128 enc", 128, MBEDTLS_AES_ENCRYPT);
+	crypto_speed_aes("aes128 dec", 128, MBEDTLS_AES_DECRYPT);
+	crypto_speed_aes("aes256 enc", 256, MBEDTLS_AES_ENCRYPT);
+	if (crypto_speed_sha256("sha256", 0) != 0)
+		ret = -1;
+	if (crypto_speed_sha256("sha256 +1", 1) != 0)
+		ret = -1;
+	return ret;
+}
+
+int sim_bench_crypto(void)
+{
+	if (crypto_kat() != 0)
+		return -1;
+	return crypto_speed();
+}
@@ -0,0 +1,348 @@
+/*
+ * The lwIP DNS cache against a stand-in server on 10.0.0.2:53 that answers
+ * every A query with 10.0.0.2 and DNS_TTL after DNS_DELAY ticks, like a
+ * resolver upstream of the access point, and names starting with "nx" with
+ * NXDOMAIN. A reconnect resolves the cloud and the NTP host and connects to
+ * the cloud address; for each way of running:
+ *
+ *   plain    DNS_RECONNECTS reconnects DNS_GAP ticks apart, nothing pinned:
+ *            every reconnect after an answer expired waits for the server
+ *   pinned   the same with both hosts pinned: they are refreshed before
+ *            they expire and no reconnect waits
+ *   boot     DNS_BOOTS boots, i.e. an empty cache and one reconnect
+ *   restore  the same with the answers DNS_PINNED_UPDATE saved given back
+ *            with dns_cache_add() at boot, as a port that keeps them in flash
+ *            would: the old address is used while it is refreshed
+ *
+ * and prints the server queries, the lookups that waited for one, and the
+ * connect latency from the first lookup to the connection. A failed lookup
+ * is then repeated within DNS_NEGATIVE_TTL, the second must not ask again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/sockets.h"
+#include "lwip/api.h"
+#include "lwip/tcpip.h"
+#include "lwip/dns.h"
+
+#include "sim.h"
+
+#define DNS_PORT			53
+#define DNS_CLOUD_PORT		5060
+#define DNS_TTL				300		/* seconds */
+#define DNS_DELAY			30		/* ticks the server takes to answer */
+#define DNS_RECONNECTS		12
+#define DNS_GAP				(100 * configTICK_RATE_HZ)
+#define DNS_BOOTS			5
+#define DNS_TIMEOUT_MS		5000
+#define DNS_PRIO			(tskIDLE_PRIORITY + 2)
+
+static const char dns_cloud[] = "cloud.example.com";
+static const char dns_ntp[] = "ntp.example.com";
+static const char *const dns_hosts[] = { dns_cloud, dns_ntp };
+
+#define DNS_HOSTS			(sizeof(dns_hosts) / sizeof(dns_hosts[0]))
+
+static SemaphoreHandle_t dns_sem, dns_done;
+static volatile uint32_t dns_queries;
+static ip_addr_t dns_saved[DNS_HOSTS];		/* the "flash" of DNS_PINNED_UPDATE */
+static uint32_t dns_saves;
+
+/* DNS_PINNED_UPDATE of the simulator, see include/platform_opts.h */
+void sim_dns_pinned_update(const char *name, const struct ip_addr *addr, unsigned int ttl)
+{
+	unsigned i;
+
+	(void) ttl;
+
+	for (i = 0; i < DNS_HOSTS; i++) {
+		if (strcmp(name, dns_hosts[i]) == 0) {
+			dns_saved[i] = *addr;
+			dns_saves++;
+		}
+	}
+}
+
+/* The stand-in: one question per query, a short datagram stops it */
+static void dns_server_task(void *param)
+{
+	uint8_t buf[512];
+	struct sockaddr_in addr;
+	socklen_t len;
+	uint32_t ip = htonl(SIM_IP(2)), ttl = htonl(DNS_TTL);
+	int s, n, q;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(DNS_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+
+	for (;;) {
+		len = sizeof(addr);
+		n = recvfrom(s, buf, sizeof(buf), 0, (struct sockaddr *) &addr, &len);
+		if (n < 17)
+			break;
+		dns_queries++;
+
+		/* skip the question name, then type and class */
+		for (q = 12; q < n && buf[q] != 0; q += buf[q] + 1)
+			;
+		q += 5;
+		if (q > n)
+			continue;
+
+		buf[2] = 0x81;						/* response, recursion desired */
+		if (buf[13] == 'n' && buf[14] == 'x') {
+			buf[3] = 0x83;					/* recursion available, NXDOMAIN */
+			buf[7] = 0;
+		} else {
+			buf[3] = 0x80;
+			buf[7] = 1;						/* one answer */
+			memcpy(buf + q, "\xc0\x0c\x00\x01\x00\x01", 6);
+			memcpy(buf + q + 6, &ttl, 4);
+			memcpy(buf + q + 10, "\x00\x04", 2);
+			memcpy(buf + q + 12, &ip, 4);
+			q += 16;
+		}
+		buf[6] = buf[8] = buf[9] = buf[10] = buf[11] = 0;
+		vTaskDelay(DNS_DELAY);
+		sendto(s, buf, q, 0, (struct sockaddr *) &addr, len);
+	}
+
+	close(s);
+	xSemaphoreGive(dns_done);
+	vTaskDelete(NULL);
+}
+
+/* The cloud: accepts and closes, until a connection with dns_stop set */
+static volatile int dns_stop;
+
+static void dns_cloud_task(void *param)
+{
+	struct sockaddr_in addr;
+	int s, c;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(DNS_CLOUD_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+	listen(s, 2);
+	xSemaphoreGive(dns_sem);
+
+	while (!dns_stop && (c = accept(s, NULL, NULL)) >= 0)
+		close(c);
+
+	close(s);
+	xSemaphoreGive(dns_done);
+	vTaskDelete(NULL);
+}
+
+/* dns_* calls in the tcpip thread */
+typedef struct {
+	int op;
+	int pin;
+} dns_call_t;
+
+enum { DNS_SETUP, DNS_PIN, DNS_FLUSH, DNS_RESTORE };
+
+static void dns_call_fn(void *arg)
+{
+	dns_call_t *call = (dns_call_t *) arg;
+	ip_addr_t server;
+	unsigned i;
+
+	switch (call->op) {
+	case DNS_SETUP:
+		ip4_addr_set_u32(&server, htonl(SIM_IP(2)));
+		dns_setserver(0, &server);
+		break;
+	case DNS_PIN:
+		for (i = 0; i < DNS_HOSTS; i++) {
+			if (call->pin)
+				dns_pin(dns_hosts[i]);
+			else
+				dns_unpin(dns_hosts[i]);
+		}
+		break;
+	case DNS_FLUSH:
+		dns_reset_ttl();
+		break;
+	case DNS_RESTORE:
+		for (i = 0; i < DNS_HOSTS; i++) {
+			if (!ip_addr_isany(&dns_saved[i]))
+				dns_cache_add(dns_hosts[i], &dns_saved[i], DNS_PREFETCH_TIME);
+		}
+		break;
+	}
+	xSemaphoreGive(dns_sem);
+}
+
+static void dns_call(int op, int pin)
+{
+	dns_call_t call = { op, pin };
+
+	tcpip_callback(dns_call_fn, &call);
+	xSemaphoreTake(dns_sem, portMAX_DELAY);
+}
+
+/* An empty cache: the answers expire on the next dns_tmr */
+static void dns_flush(void)
+{
+	dns_call(DNS_FLUSH, 0);
+	vTaskDelay(DNS_TMR_INTERVAL / portTICK_RATE_MS + 1);
+}
+
+typedef struct {
+	uint32_t reconnects;
+	uint32_t waited;		/* lookups that waited for the server */
+	uint32_t lat_total;
+	uint32_t lat_max;
+} dns_result_t;
+
+/* Resolve both hosts and connect to the cloud */
+static int dns_reconnect(dns_result_t *r)
+{
+	struct sockaddr_in addr;
+	ip_addr_t ip, cloud;
+	TickType_t start = xTaskGetTickCount(), t;
+	unsigned i;
+	int s, ret;
+
+	for (i = 0; i < DNS_HOSTS; i++) {
+		t = xTaskGetTickCount();
+		if (netconn_gethostbyname(dns_hosts[i], &ip) != ERR_OK) {
+			printf("dns    %s not resolved\n", dns_hosts[i]);
+			return -1;
+		}
+		if (xTaskGetTickCount() != t)
+			r->waited++;
+		if (i == 0)
+			cloud = ip;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(DNS_CLOUD_PORT);
+	addr.sin_addr.s_addr = ip4_addr_get_u32(&cloud);
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	ret = connect(s, (struct sockaddr *) &addr, sizeof(addr));
+	close(s);
+	if (ret < 0) {
+		printf("dns    connect failed\n");
+		return -1;
+	}
+
+	t = xTaskGetTickCount() - start;
+	r->reconnects++;
+	r->lat_total += t;
+	if (t > r->lat_max)
+		r->lat_max = t;
+	return 0;
+}
+
+/* Fails if more than 'waits' lookups waited for the server */
+static int dns_run(const char *what, int pin, int boots, int restore, uint32_t waits)
+{
+	dns_result_t r;
+	uint32_t queries, saves = dns_saves;
+	int i, n = boots ? DNS_BOOTS : DNS_RECONNECTS, ret = 0;
+
+	memset(&r, 0, sizeof(r));
+	dns_call(DNS_PIN, pin);
+	queries = dns_queries;
+
+	for (i = 0; i < n && ret == 0; i++) {
+		if (boots || i == 0) {
+			dns_flush();
+			if (restore)
+				dns_call(DNS_RESTORE, 0);
+		}
+		ret = dns_reconnect(&r);
+		vTaskDelay(DNS_GAP);
+	}
+	dns_call(DNS_PIN, 0);
+	if (ret != 0)
+		return ret;
+
+	printf("dns    %-7s %2u %-10s: %2u queries, %2u lookups waited, connect avg %5.1f max %3u ticks, %u answers saved\n",
+		what, r.reconnects, boots ? "boots" : "reconnects", dns_queries - queries, r.waited,
+		(double) r.lat_total / r.reconnects, r.lat_max, dns_saves - saves);
+	return (r.waited <= waits) ? 0 : -1;
+}
+
+/* A failed lookup repeated within DNS_NEGATIVE_TTL */
+static int dns_negative(void)
+{
+	ip_addr_t ip;
+	uint32_t queries = dns_queries;
+	err_t first, second;
+
+	first = netconn_gethostbyname("nx.example.com", &ip);
+	second = netconn_gethostbyname("nx.example.com", &ip);
+	printf("dns    nxdomain twice: %u queries, negative ttl %u s\n",
+		dns_queries - queries, DNS_NEGATIVE_TTL);
+
+	return (first != ERR_OK && second != ERR_OK &&
+		dns_queries - queries == (DNS_NEGATIVE_TTL ? 1 : 2)) ? 0 : -1;
+}
+
+int sim_bench_dns(void)
+{
+	struct sockaddr_in addr;
+	dns_result_t r;
+	int s, ret = 0;
+
+	if (dns_sem == NULL) {
+		dns_sem = xSemaphoreCreateBinary();
+		dns_done = xSemaphoreCreateCounting(2, 0);
+	}
+
+	dns_stop = 0;
+	xTaskCreate(dns_cloud_task, (const char *) "dns_cloud", 512, NULL, DNS_PRIO, NULL);
+	xSemaphoreTake(dns_sem, portMAX_DELAY);
+	xTaskCreate(dns_server_task, (const char *) "dns_server", 1024, NULL, DNS_PRIO, NULL);
+	dns_call(DNS_SETUP, 0);
+	memset(dns_saved, 0, sizeof(dns_saved));
+
+	/* every boot without restore waits for both hosts, pinned reconnects
+	   and restored boots only the first time */
+	if (dns_run("plain", 0, 0, 0, DNS_RECONNECTS * DNS_HOSTS) != 0 ||
+			dns_run("pinned", 1, 0, 0, DNS_HOSTS) != 0 ||
+			dns_run("boot", 1, 1, 0, DNS_BOOTS * DNS_HOSTS) != 0 ||
+			dns_run("restore", 1, 1, 1, 0) != 0 ||
+			dns_negative() != 0)
+		ret = -1;
+
+	/* stop the server and the cloud */
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(DNS_PORT);
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	sendto(s, "", 1, 0, (struct sockaddr *) &addr, sizeof(addr));
+	close(s);
+	dns_stop = 1;
+	memset(&r, 0, sizeof(r));
+	dns_reconnect(&r);
+	if (xSemaphoreTake(dns_done, DNS_TIMEOUT_MS / portTICK_RATE_MS) != pdTRUE ||
+			xSemaphoreTake(dns_done, DNS_TIMEOUT_MS / portTICK_RATE_MS) != pdTRUE) {
+		printf("dns    servers did not stop\n");
+		ret = -1;
+	}
+
+	return ret;
+}
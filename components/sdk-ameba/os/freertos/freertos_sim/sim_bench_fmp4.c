@@ -0,0 +1,531 @@
+/*
+ * Fragmented MP4 recording through FatFs onto a RAM disk formatted like an
+ * SD card (FAT16, 32 KB clusters), 60 s of 30 fps H.264 with 16 kHz AAC:
+ *
+ *   chunks   each frame goes to f_write as it comes, f_sync every 2 s, the
+ *            way the sink hands frames to the library
+ *   fmp4     fmp4_mux, 1 s fragments written in 32 KB blocks, growing the
+ *            file as FatFs needs
+ *   prealloc the same with the file grown 4 MB at a time
+ *
+ * The disk counts commands and sectors, and prices them like a card: 1 ms
+ * per write command and 10 MB/s, 0.2 ms per read command and 20 MB/s.
+ *
+ * Then power cuts: the recording is repeated with the disk dropping every
+ * write after the Nth, the one in flight half written. After remounting,
+ * fmp4_mux_recover must leave a file that parses to the end and holds all
+ * but the last few seconds before the cut.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ff.h"
+#include "fatfs_ext/inc/ff_driver.h"
+#include "fmp4_mux.h"
+
+#include "sim.h"
+
+#define FS_SECTORS			(160 * 2048)	/* 160 MB */
+#define FS_CLUSTER			64				/* sectors, 32 KB */
+#define FS_ROOT_ENTRIES		512
+#define FS_FAT_SECTORS		21
+
+#define REC_SECONDS			60
+#define REC_FPS				30
+#define REC_GOP				30
+#define REC_RATE			16000
+#define REC_FRAGMENT_MS		1000
+#define REC_SYNC_MS			2000
+#define REC_BUF_SIZE		(224 * 1024)	/* h264_buffer in the sink */
+#define REC_CUTS			8
+
+/* SD card cost model, us */
+#define SD_WRITE_CMD_US		1000
+#define SD_WRITE_SECTOR_US	51
+#define SD_READ_CMD_US		200
+#define SD_READ_SECTOR_US	26
+
+typedef struct {
+	uint32_t writes;
+	uint32_t write_sectors;
+	uint32_t reads;
+	uint32_t read_sectors;
+} disk_stats;
+
+static uint8_t *ram;
+static disk_stats dst;
+static uint32_t cut_after;			/* write commands, 0 = never */
+static uint32_t cut_ms;				/* media time when it happened */
+static uint32_t now_ms;
+
+static FATFS fs;
+static FIL fil;
+static fmp4_mux_t mux;
+static uint8_t rec_buf[REC_BUF_SIZE] __attribute__((aligned(32)));
+static uint8_t frame[64 * 1024];
+static uint32_t rec_seed;
+
+/* the file read back */
+static uint8_t *file;
+static uint32_t file_len;
+
+static DSTATUS ram_initialize(void)
+{
+	return 0;
+}
+
+static DSTATUS ram_status(void)
+{
+	return 0;
+}
+
+static DRESULT ram_read(BYTE *buff, DWORD sector, UINT count)
+{
+	if (sector + count > FS_SECTORS)
+		return RES_PARERR;
+	memcpy(buff, ram + sector * 512, count * 512);
+	dst.reads++;
+	dst.read_sectors += count;
+	return RES_OK;
+}
+
+static DRESULT ram_write(const BYTE *buff, DWORD sector, UINT count)
+{
+	if (sector + count > FS_SECTORS)
+		return RES_PARERR;
+	dst.writes++;
+	dst.write_sectors += count;
+	if (cut_after && dst.writes >= cut_after) {
+		/* the power went during this one: half of it made it */
+		if (dst.writes == cut_after) {
+			memcpy(ram + sector * 512, buff, (count + 1) / 2 * 512);
+			cut_ms = now_ms;
+		}
+		return RES_OK;
+	}
+	memcpy(ram + sector * 512, buff, count * 512);
+	return RES_OK;
+}
+
+static DRESULT ram_ioctl(BYTE cmd, void *buff)
+{
+	switch (cmd) {
+	case CTRL_SYNC:
+		return RES_OK;
+	case GET_SECTOR_COUNT:
+		*(DWORD *) buff = FS_SECTORS;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD *) buff = 512;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD *) buff = FS_CLUSTER;
+		return RES_OK;
+	}
+	return RES_PARERR;
+}
+
+static ll_diskio_drv ram_disk = {
+	.disk_initialize = ram_initialize,
+	.disk_status = ram_status,
+	.disk_read = ram_read,
+	.disk_write = ram_write,
+	.disk_ioctl = ram_ioctl,
+	.TAG = (unsigned char *) "RAM",
+};
+
+static void le16(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void le32(uint8_t *p, uint32_t v)
+{
+	le16(p, v);
+	le16(p + 2, v >> 16);
+}
+
+static uint32_t be32(const uint8_t *p)
+{
+	return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* a FAT16 volume without a partition table; the data area keeps whatever
+   the last run left there, like a card that was written before */
+static void ram_format(void)
+{
+	uint8_t *b = ram;
+	uint32_t fat = 1, i;
+
+	memset(ram, 0, (1 + 2 * FS_FAT_SECTORS + FS_ROOT_ENTRIES * 32 / 512) * 512);
+	b[0] = 0xeb;
+	b[1] = 0x3c;
+	b[2] = 0x90;
+	memcpy(b + 3, "MSDOS5.0", 8);
+	le16(b + 11, 512);
+	b[13] = FS_CLUSTER;
+	le16(b + 14, 1);
+	b[16] = 2;
+	le16(b + 17, FS_ROOT_ENTRIES);
+	b[21] = 0xf8;
+	le16(b + 22, FS_FAT_SECTORS);
+	le16(b + 24, 63);
+	le16(b + 26, 255);
+	le32(b + 32, FS_SECTORS);
+	b[36] = 0x80;
+	b[38] = 0x29;
+	memcpy(b + 43, "NO NAME    FAT16   ", 19);
+	b[510] = 0x55;
+	b[511] = 0xaa;
+	for (i = 0; i < 2; i++, fat += FS_FAT_SECTORS)
+		le32(ram + fat * 512, 0xfffffff8);
+}
+
+static uint32_t rec_rand(void)
+{
+	rec_seed = rec_seed * 1103515245 + 12345;
+	return rec_seed >> 8;
+}
+
+/* random payload without 00 00, so no start code appears inside a NAL */
+static uint8_t *put_nal(uint8_t *p, uint8_t hdr, uint32_t len)
+{
+	uint32_t i;
+
+	memcpy(p, "\0\0\0\1", 4);
+	p[4] = hdr;
+	for (i = 1; i < len; i++)
+		p[4 + i] = (rec_rand() & 0xff) | 1;
+	return p + 4 + len;
+}
+
+static uint32_t make_video(int k)
+{
+	static const uint8_t sps[] = {0x67, 0x42, 0xc0, 0x1f, 0x95, 0xa0, 0x14, 0x01, 0x6e, 0x40};
+	static const uint8_t pps[] = {0x68, 0xce, 0x3c, 0x80};
+	uint8_t *p = frame;
+
+	if (k % REC_GOP == 0) {
+		memcpy(p, "\0\0\0\1", 4);
+		memcpy(p + 4, sps, sizeof(sps));
+		p += 4 + sizeof(sps);
+		memcpy(p, "\0\0\0\1", 4);
+		memcpy(p + 4, pps, sizeof(pps));
+		p += 4 + sizeof(pps);
+		p = put_nal(p, 0x65, 30000 + rec_rand() % 20000);
+	} else
+		p = put_nal(p, 0x41, 2000 + rec_rand() % 4000);
+	return p - frame;
+}
+
+static uint32_t make_audio(void)
+{
+	uint32_t len = 7 + 220 + rec_rand() % 60, i;
+
+	memset(frame, 0, 7);
+	frame[0] = 0xff;
+	frame[1] = 0xf1;	/* no CRC */
+	for (i = 7; i < len; i++)
+		frame[i] = rec_rand();
+	return len;
+}
+
+typedef int (*rec_sink)(int video, const uint8_t *data, uint32_t len, uint32_t ts);
+
+/* the stream in time order, 64 ms per AAC frame */
+static void record(rec_sink sink)
+{
+	int k = 0, j = 0, video;
+	uint32_t len, t;
+
+	while (k < REC_SECONDS * REC_FPS) {
+		video = (uint64_t) k * 1000 * REC_RATE <= (uint64_t) j * 1024 * 1000 * REC_FPS;
+		if (video) {
+			now_ms = k * 1000 / REC_FPS;
+			len = make_video(k);
+			t = k * (90000 / REC_FPS);
+			k++;
+		} else {
+			now_ms = (uint64_t) j * 1024 * 1000 / REC_RATE;
+			len = make_audio();
+			t = j * 1024;
+			j++;
+		}
+		sink(video, frame, len, t);
+	}
+}
+
+static uint32_t chunk_sync;
+
+static int chunks_sink(int video, const uint8_t *data, uint32_t len, uint32_t ts)
+{
+	UINT bw;
+
+	f_write(&fil, data, len, &bw);
+	if (now_ms - chunk_sync >= REC_SYNC_MS) {
+		f_sync(&fil);
+		chunk_sync = now_ms;
+	}
+	return 0;
+}
+
+static int fmp4_sink(int video, const uint8_t *data, uint32_t len, uint32_t ts)
+{
+	return video ? fmp4_mux_video(&mux, data, len, ts) : fmp4_mux_audio(&mux, data, len);
+}
+
+static int mount(void)
+{
+	f_mount(NULL, "0:", 1);
+	return f_mount(&fs, "0:", 1);
+}
+
+static int record_fmp4(uint32_t prealloc, fmp4_stats_t *st)
+{
+	fmp4_config_t cfg = {
+		.width = 1280,
+		.height = 720,
+		.frame_rate = REC_FPS,
+		.sample_rate = REC_RATE,
+		.channels = 1,
+		.fragment_ms = REC_FRAGMENT_MS,
+		.write_block = 32 * 1024,
+		.prealloc = prealloc,
+		.sync_ms = REC_SYNC_MS,
+	};
+	int ret;
+
+	if (f_open(&fil, "0:rec.mp4", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+		return -1;
+	if (fmp4_mux_open(&mux, &fil, &cfg, rec_buf, sizeof(rec_buf)) != FR_OK)
+		return -1;
+	record(fmp4_sink);
+	ret = fmp4_mux_close(&mux);
+	fmp4_mux_get_stats(&mux, st);
+	f_close(&fil);
+	return ret;
+}
+
+static int read_file(const char *name)
+{
+	UINT br;
+
+	if (f_open(&fil, name, FA_READ) != FR_OK)
+		return -1;
+	file_len = f_size(&fil);
+	free(file);
+	file = malloc(file_len + 1);
+	if (f_read(&fil, file, file_len, &br) != FR_OK || br != file_len) {
+		f_close(&fil);
+		return -1;
+	}
+	f_close(&fil);
+	return 0;
+}
+
+/* walk the file independently of fmp4_mux_recover: fragments numbered from
+   1, decode times that continue, sample sizes that fill the mdat, video
+   samples made of whole NALs and starting a key frame with an IDR slice.
+   Return ms of video, or -1 */
+static int verify(uint32_t *fragments)
+{
+	uint32_t pos = 0, size, seq = 1, vsamples = 0, asamples = 0, n, i, j, flags, count, entry;
+	uint32_t traf_end, moof, mdat_len, off, sum, s, dur, ssize, sflags, o, data_off;
+	uint64_t vtime = 0, atime = 0, tfdt;
+	int track, header = 0;
+	const uint8_t *b;
+
+	*fragments = 0;
+	while (pos + 8 <= file_len) {
+		size = be32(file + pos);
+		if (size < 8 || pos + size > file_len)
+			return -1;
+		if (memcmp(file + pos + 4, "moof", 4)) {
+			if (memcmp(file + pos + 4, "moov", 4) == 0)
+				header = 1;
+			else if (memcmp(file + pos + 4, "ftyp", 4))
+				return -1;
+			pos += size;
+			continue;
+		}
+		moof = pos;
+		if (!header || be32(file + pos + 20) != seq)
+			return -1;
+		if (pos + size + 8 > file_len || memcmp(file + pos + size + 4, "mdat", 4))
+			return -1;
+		mdat_len = be32(file + pos + size) - 8;
+		sum = 0;
+		for (off = pos + 8 + 16; off < pos + size; off += be32(file + off)) {
+			traf_end = off + be32(file + off);
+			track = 0;
+			tfdt = 0;
+			for (o = off + 8; o < traf_end; o += be32(file + o)) {
+				b = file + o;
+				if (memcmp(b + 4, "tfhd", 4) == 0)
+					track = be32(b + 12);
+				else if (memcmp(b + 4, "tfdt", 4) == 0)
+					tfdt = ((uint64_t) be32(b + 12) << 32) | be32(b + 16);
+				else if (memcmp(b + 4, "trun", 4) == 0) {
+					flags = be32(b + 8) & 0xffffff;
+					count = be32(b + 12);
+					data_off = be32(b + 16);
+					entry = track == FMP4_VIDEO_TRACK ? 12 : 4;
+					if (tfdt != (track == FMP4_VIDEO_TRACK ? vtime : atime))
+						return -1;
+					s = moof + data_off;
+					for (i = 0; i < count; i++) {
+						dur = track == FMP4_VIDEO_TRACK ? be32(b + 20 + i * entry) : 1024;
+						ssize = be32(b + 20 + i * entry + (entry == 12 ? 4 : 0));
+						if (track == FMP4_VIDEO_TRACK) {
+							sflags = be32(b + 20 + i * entry + 8);
+							/* whole NALs, a key sample starts with its IDR */
+							for (j = 0; j < ssize; j += 4 + n) {
+								n = be32(file + s + j);
+								if (j == 0 && !(sflags & 0x00010000) && (file[s + 4] & 0x1f) != 5)
+									return -1;
+							}
+							if (j != ssize)
+								return -1;
+							vtime += dur;
+							vsamples++;
+						} else {
+							atime += dur;
+							asamples++;
+						}
+						s += ssize;
+						sum += ssize;
+					}
+					(void) flags;
+				}
+			}
+		}
+		if (sum != mdat_len)
+			return -1;
+		pos += size + 8 + mdat_len;
+		seq++;
+		(*fragments)++;
+	}
+	if (pos != file_len)
+		return -1;
+	return vtime / 90;
+}
+
+static uint32_t model_ms(const disk_stats *d)
+{
+	return ((uint64_t) d->writes * SD_WRITE_CMD_US + (uint64_t) d->write_sectors * SD_WRITE_SECTOR_US +
+		(uint64_t) d->reads * SD_READ_CMD_US + (uint64_t) d->read_sectors * SD_READ_SECTOR_US) / 1000;
+}
+
+static void report(const char *name, uint32_t bytes, uint64_t ns)
+{
+	uint32_t ms = model_ms(&dst);
+
+	printf("fmp4   %-8s %7u KB, %5u write cmds (%6u sectors) %4u read cmds, card %5u ms = %5u KB/s, host %u ns per KB\n",
+		name, bytes / 1024, dst.writes, dst.write_sectors, dst.reads, ms, ms ? (unsigned) ((uint64_t) bytes * 1000 / 1024 / ms) : 0,
+		(unsigned) (ns / (bytes / 1024 + 1)));
+}
+
+int sim_bench_fmp4(void)
+{
+	fmp4_stats_t st;
+	uint64_t t0;
+	uint32_t frags, total_writes, worst = 0, kept_frags;
+	int fail = 0, ms = -1, i, kept;
+
+	ram = calloc(FS_SECTORS, 512);
+	if (ram == NULL || FATFS_RegisterDiskDriver(&ram_disk) != 0)
+		return -1;
+	ram_format();
+	if (mount() != FR_OK) {
+		printf("fmp4   mount failed\n");
+		return -1;
+	}
+
+	/* the old way */
+	rec_seed = 1;
+	memset(&dst, 0, sizeof(dst));
+	chunk_sync = 0;
+	t0 = sim_host_ns();
+	if (f_open(&fil, "0:rec.264", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+		return -1;
+	record(chunks_sink);
+	f_close(&fil);
+	report("chunks", f_size(&fil), sim_host_ns() - t0);
+	f_unlink("0:rec.264");
+
+	/* fragments, without and with preallocation */
+	for (i = 0; i < 2; i++) {
+		rec_seed = 1;
+		memset(&dst, 0, sizeof(dst));
+		t0 = sim_host_ns();
+		if (record_fmp4(i ? 4 * 1024 * 1024 : 0, &st) != FR_OK)
+			fail = 1;
+		report(i ? "prealloc" : "fmp4", st.bytes, sim_host_ns() - t0);
+		if (read_file("0:rec.mp4") < 0 || (ms = verify(&frags)) < 0) {
+			printf("fmp4   %s file does not parse\n", i ? "prealloc" : "fmp4");
+			fail = 1;
+			continue;
+		}
+		printf("fmp4   %-8s %u fragments, %u ms of video, %u video %u audio samples, %u dropped, %u f_write %u f_sync\n",
+			i ? "prealloc" : "fmp4", frags, ms, st.video, st.audio, st.dropped, st.writes, st.syncs);
+		if (ms < REC_SECONDS * 1000 - 100 || st.dropped)
+			fail = 1;
+	}
+	total_writes = dst.writes;
+
+	/* a cleanly closed file is left alone */
+	if (f_open(&fil, "0:rec.mp4", FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK)
+		return -1;
+	kept = fmp4_mux_recover(&fil);
+	f_close(&fil);
+	if (kept != (int) frags || read_file("0:rec.mp4") < 0 || verify(&kept_frags) != ms) {
+		printf("fmp4   recovery changed a complete file\n");
+		fail = 1;
+	}
+
+	/* power cuts */
+	for (i = 1; i <= REC_CUTS; i++) {
+		ram_format();
+		mount();
+		rec_seed = 100 + i;
+		memset(&dst, 0, sizeof(dst));
+		cut_after = total_writes * i / (REC_CUTS + 1);
+		cut_ms = 0;
+		record_fmp4(4 * 1024 * 1024, &st);
+		cut_after = 0;
+
+		mount();
+		if (f_open(&fil, "0:rec.mp4", FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK) {
+			printf("fmp4   cut %u: no file\n", (unsigned) i);
+			fail = 1;
+			continue;
+		}
+		kept = fmp4_mux_recover(&fil);
+		f_close(&fil);
+		ms = -1;
+		if (kept >= 0 && read_file("0:rec.mp4") == 0)
+			ms = verify(&kept_frags);
+		printf("fmp4   cut at %5u ms: %2d fragments kept, %5d ms of video, lost %4d ms\n",
+			(unsigned) cut_ms, kept, ms, (int) cut_ms - ms);
+		if (ms < 0 || kept != (int) kept_frags || (int) cut_ms - ms > 3 * REC_FRAGMENT_MS) {
+			fail = 1;
+			continue;
+		}
+		if (worst < cut_ms - ms)
+			worst = cut_ms - ms;
+	}
+	printf("fmp4   power cuts: at most %u ms lost\n", (unsigned) worst);
+
+	f_mount(NULL, "0:", 1);
+	FATFS_UnRegisterDiskDriver(ram_disk.drv_num);
+	free(file);
+	file = NULL;
+	free(ram);
+	return fail ? -1 : 0;
+}
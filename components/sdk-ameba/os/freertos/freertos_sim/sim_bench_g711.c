@@ -0,0 +1,251 @@
+/*
+ * G.711 playback benchmark: the I2S sink path before (G711_decoder(),
+ * mono2stereo(), the play ring and the copy into the DMA page) against
+ * g711_pcm_decode() writing the page directly, and the resamplers.
+ *
+ * G711_decoder() and mono2stereo() are only shipped in lib_codec.a for the
+ * target, the references below are the CCITT decoder that library is built
+ * from and the same channel duplication. Each kernel result must match the
+ * reference computed sample by sample from the decoded input.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "g711_pcm.h"
+
+#include "sim.h"
+
+#define G711_IN_RATE		8000
+#define G711_SAMPLES		(G711_IN_RATE * 4)	/* input per law and rate */
+#define G711_PAGE_FRAMES	160					/* 640 byte DMA page */
+#define G711_RING_SIZE		512
+#define G711_BLOCK			160					/* input per sink handle call */
+#define G711_REPEAT			50
+
+static uint8_t g711_in[G711_SAMPLES];
+static int16_t g711_ref_pcm[G711_SAMPLES];
+static uint32_t g711_ref[G711_SAMPLES * 6 + G711_PAGE_FRAMES];
+static uint32_t g711_out[G711_SAMPLES * 6 + G711_PAGE_FRAMES];
+static uint8_t g711_ring[G711_RING_SIZE];
+
+static int16_t ref_ulaw(uint8_t u)
+{
+	int t;
+
+	u = ~u;
+	t = ((u & 0x0f) << 3) + 0x84;
+	t <<= (u & 0x70) >> 4;
+	return (u & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+static int16_t ref_alaw(uint8_t a)
+{
+	int t, seg;
+
+	a ^= 0x55;
+	t = (a & 0x0f) << 4;
+	seg = (a & 0x70) >> 4;
+	if (seg == 0)
+		t += 8;
+	else
+		t = (t + 0x108) << (seg - 1);
+	return (a & 0x80) ? t : -t;
+}
+
+static void ref_decoder(const uint8_t *src, int16_t *dst, int law, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		dst[i] = law == I2S_MODE_G711A ? ref_alaw(src[i]) : ref_ulaw(src[i]);
+}
+
+static void ref_mono2stereo(const uint8_t *src, uint8_t *dst, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i += 2) {
+		dst[2 * i] = dst[2 * i + 2] = src[i];
+		dst[2 * i + 1] = dst[2 * i + 3] = src[i + 1];
+	}
+}
+
+static uint32_t ref_stereo(int32_t y)
+{
+	return ((uint32_t) y & 0xffff) | ((uint32_t) y << 16);
+}
+
+/* The sink before: decode, duplicate into the play ring, move the ring tail
+   back, and copy each full page out as the tx irq did. */
+static uint32_t old_path(int law, uint32_t *out)
+{
+	static int16_t dec[G711_BLOCK];
+	static uint8_t chl[640 * 4];
+	uint8_t *cache = chl, *play = chl;
+	uint32_t i, cached = 0, pages = 0;
+
+	for (i = 0; i + G711_BLOCK <= G711_SAMPLES; i += G711_BLOCK) {
+		ref_decoder(g711_in + i, dec, law, G711_BLOCK);
+		ref_mono2stereo((uint8_t *) dec, cache, G711_BLOCK * 2);
+		cache += G711_BLOCK * 4;
+		cached += G711_BLOCK * 4;
+		if (cache >= chl + 640 * 3) {
+			memcpy(chl, chl + 640 * 3, cache - (chl + 640 * 3));
+			cache -= 640 * 3;
+		}
+		for (; cached >= 640; cached -= 640) {
+			memcpy(out + pages * G711_PAGE_FRAMES, play, 640);
+			pages++;
+			play += 640;
+			if (play >= chl + 640 * 3)
+				play = chl;
+		}
+	}
+	return pages * G711_PAGE_FRAMES;
+}
+
+/* The sink now: copy the coded bytes into the ring, decode each page from
+   the ring straight into the page. */
+static uint32_t new_path(g711_pcm_t *pcm, uint32_t *out, uint32_t max)
+{
+	uint32_t head = 0, tail = 0, in = 0, frames = 0, n, part;
+
+	for (;;) {
+		while (in < G711_SAMPLES && G711_RING_SIZE - (tail - head) >= G711_BLOCK) {
+			n = G711_SAMPLES - in < G711_BLOCK ? G711_SAMPLES - in : G711_BLOCK;
+			part = G711_RING_SIZE - (tail & (G711_RING_SIZE - 1));
+			if (part > n)
+				part = n;
+			memcpy(g711_ring + (tail & (G711_RING_SIZE - 1)), g711_in + in, part);
+			memcpy(g711_ring, g711_in + in + part, n - part);
+			tail += n;
+			in += n;
+		}
+		if (frames + G711_PAGE_FRAMES > max || tail - head < g711_pcm_need(pcm, G711_PAGE_FRAMES))
+			break;
+		head += g711_pcm_decode(pcm, g711_ring, G711_RING_SIZE - 1, head, out + frames, G711_PAGE_FRAMES);
+		frames += G711_PAGE_FRAMES;
+	}
+	return frames;
+}
+
+/* Reference resamplers, one output at a time from the whole decoded input */
+static uint32_t ref_linear(uint32_t out_rate, uint32_t frames)
+{
+	uint32_t step = (uint32_t)(((uint64_t) G711_IN_RATE << 16) / out_rate);
+	uint32_t i, c, w;
+	uint64_t f;
+	int32_t s0, s1;
+
+	for (i = 0; i < frames; i++) {
+		f = (uint64_t) i * step;
+		c = f >> 16;
+		w = (f & 0xffff) >> 2;
+		s1 = c >= 1 ? g711_ref_pcm[c - 1] : 0;
+		s0 = c >= 2 ? g711_ref_pcm[c - 2] : 0;
+		g711_ref[i] = ref_stereo((s0 * (int32_t)(16384 - w) + s1 * (int32_t) w) >> 14);
+	}
+	return frames;
+}
+
+static uint32_t ref_polyphase(const uint32_t *fir, uint32_t up, uint32_t frames)
+{
+	uint32_t i, n, p, k;
+	int32_t y, x, h;
+
+	for (i = 0; i < frames; i++) {
+		n = i / up;
+		p = i % up;
+		y = 1 << 14;
+		for (k = 0; k < G711_PCM_TAPS; k++) {
+			h = (int16_t)(fir[p * G711_PCM_TAPS / 2 + k / 2] >> (k & 1 ? 16 : 0));
+			x = n >= k ? g711_ref_pcm[n - k] : 0;
+			y += h * x;
+		}
+		y >>= 15;
+		y = y > 32767 ? 32767 : y < -32768 ? -32768 : y;
+		g711_ref[i] = ref_stereo(y);
+	}
+	return frames;
+}
+
+static int g711_run(int law, uint32_t out_rate, int resample)
+{
+	g711_pcm_t pcm;
+	uint32_t frames, ref_frames, i, r, diff = 0;
+	uint64_t ns, old_ns = 0;
+	const char *kind;
+
+	g711_pcm_init(&pcm, law, G711_IN_RATE, out_rate, resample);
+	kind = pcm.up == 1 ? "copy" : pcm.up == 0 ? "linear" : "polyphase";
+
+	ref_decoder(g711_in, g711_ref_pcm, law, G711_SAMPLES);
+	frames = new_path(&pcm, g711_out, (uint64_t) G711_SAMPLES * out_rate / G711_IN_RATE - G711_PAGE_FRAMES);
+
+	if (pcm.up == 1) {
+		ref_frames = old_path(law, g711_ref);
+		if (ref_frames < frames)
+			frames = ref_frames;
+	} else if (pcm.up == 0)
+		ref_linear(out_rate, frames);
+	else
+		ref_polyphase(pcm.fir, pcm.up, frames);
+
+	for (i = 0; i < frames; i++)
+		diff += g711_out[i] != g711_ref[i];
+
+	ns = sim_host_ns();
+	for (r = 0; r < G711_REPEAT; r++) {
+		g711_pcm_init(&pcm, law, G711_IN_RATE, out_rate, resample);
+		new_path(&pcm, g711_out, frames);
+	}
+	ns = sim_host_ns() - ns;
+
+	if (pcm.up == 1) {
+		old_ns = sim_host_ns();
+		for (r = 0; r < G711_REPEAT; r++)
+			old_path(law, g711_ref);
+		old_ns = sim_host_ns() - old_ns;
+	}
+
+	printf("g711   %s %5u Hz %-9s %u frames, %u differ, %.1f M frames/s",
+		law == I2S_MODE_G711A ? "alaw" : "ulaw", out_rate, kind, frames, diff,
+		(double) frames * G711_REPEAT * 1e3 / ns);
+	if (old_ns)
+		printf(" (decode + mono2stereo + copy %.1f M frames/s)", (double) frames * G711_REPEAT * 1e3 / old_ns);
+	printf("\n");
+
+	return diff ? -1 : 0;
+}
+
+int sim_bench_g711(void)
+{
+	static const struct {
+		uint32_t rate;
+		int resample;
+	} runs[] = {
+		{ 8000, G711_PCM_LINEAR },
+		{ 16000, G711_PCM_POLYPHASE },
+		{ 48000, G711_PCM_POLYPHASE },
+		{ 44100, G711_PCM_LINEAR },
+		{ 48000, G711_PCM_LINEAR },
+	};
+	uint32_t i, seed = 1;
+	int ret = 0;
+
+	for (i = 0; i < G711_SAMPLES; i++) {
+		seed = seed * 1103515245 + 12345;
+		g711_in[i] = seed >> 16;
+	}
+
+	for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+		ret |= g711_run(I2S_MODE_G711U, runs[i].rate, runs[i].resample);
+		ret |= g711_run(I2S_MODE_G711A, runs[i].rate, runs[i].resample);
+	}
+
+	return ret;
+}
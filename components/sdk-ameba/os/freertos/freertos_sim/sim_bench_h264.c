@@ -0,0 +1,163 @@
+/*
+ * H.264 Annex B scanning over the file source's sample_h264.h: the bytewise
+ * seek_to_next() the source used, h264_find_start_code() and indexing
+ * whole access units with h264_au_index().
+ *
+ * Both scanners must find the same NALs, also in a random buffer with start
+ * codes at every alignment.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "h264/h264_nal.h"
+#include "sample_h264.h"
+
+#include "sim.h"
+
+#define H264_REPEAT			200
+#define H264_FUZZ_SIZE		65536
+#define H264_MAX_NALS		4096
+
+static const u8 *old_nal[H264_MAX_NALS];
+static const u8 *new_nal[H264_MAX_NALS];
+static u8 fuzz[H264_FUZZ_SIZE];
+
+/* mmf_source_h264_file.c before */
+static unsigned char *seek_to_next(unsigned char *ptr, unsigned char *ptr_end)
+{
+	ptr += 3;
+
+	while (ptr < ptr_end) {
+		if (ptr[0] == 0 && ptr[1] == 0) {
+			if (ptr[2] == 0 && ptr[3] == 1)
+				return ptr;
+			else if (ptr[2] == 1)
+				return ptr;
+		}
+		ptr++;
+	}
+
+	return NULL;
+}
+
+static int scan_old(const u8 *buf, uint32_t len, const u8 **out)
+{
+	unsigned char *p = (unsigned char *) buf;
+	int n = 0;
+
+	/* the sample starts with a start code, seek_to_next() skips it */
+	out[n++] = p;
+	while ((p = seek_to_next(p, (unsigned char *) buf + len - 1)) != NULL && n < H264_MAX_NALS)
+		out[n++] = p;
+	return n;
+}
+
+static int scan_new(const u8 *buf, uint32_t len, const u8 **out)
+{
+	const u8 *p = buf, *end = buf + len;
+	int n = 0, sc;
+
+	while ((p = h264_find_start_code(p, end, &sc)) != NULL && n < H264_MAX_NALS) {
+		out[n++] = p;
+		p += sc;
+	}
+	return n;
+}
+
+/* every 00 00 01 bytewise, from the leading zero of a 00 00 00 01 that does
+   not overlap the code before */
+static int scan_ref(const u8 *buf, uint32_t len, const u8 **out)
+{
+	uint32_t i, base = 0;
+	int n = 0;
+
+	for (i = 0; i + 3 <= len && n < H264_MAX_NALS; i++) {
+		if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1) {
+			out[n++] = (i > base && buf[i - 1] == 0) ? buf + i - 1 : buf + i;
+			base = i + 3;
+			i += 2;
+		}
+	}
+	return n;
+}
+
+static int h264_fuzz(void)
+{
+	uint32_t i, seed = 7, off;
+	int n_ref, n_new, fail = 0;
+
+	for (i = 0; i < H264_FUZZ_SIZE; i++) {
+		seed = seed * 1103515245 + 12345;
+		fuzz[i] = (seed >> 16) & 0x3 ? seed >> 24 : 0;
+	}
+	for (off = 0; off + 8 < H264_FUZZ_SIZE; off += 61 + (off & 7)) {
+		fuzz[off] = 0;
+		fuzz[off + 1] = 0;
+		fuzz[off + 2] = 1;
+		fuzz[off + 3] = 0x41;
+	}
+
+	for (off = 0; off < 8; off++) {
+		n_ref = scan_ref(fuzz + off, H264_FUZZ_SIZE - 2 * off, old_nal);
+		n_new = scan_new(fuzz + off, H264_FUZZ_SIZE - 2 * off, new_nal);
+		if (n_ref != n_new || memcmp(old_nal, new_nal, n_ref * sizeof(old_nal[0])) != 0)
+			fail++;
+	}
+	return fail;
+}
+
+int sim_bench_h264(void)
+{
+	const u8 *sample = h264_sample, *end = h264_sample + h264_sample_len, *p;
+	h264_au_t au;
+	uint32_t r, len, aus = 0, keys = 0, nals = 0, max_nals = 0;
+	uint64_t old_ns, new_ns, au_ns;
+	int n_old, n_new, i, fail;
+
+	n_old = scan_old(sample, h264_sample_len, old_nal);
+	n_new = scan_new(sample, h264_sample_len, new_nal);
+	fail = n_old != n_new || memcmp(old_nal, new_nal, n_old * sizeof(old_nal[0])) != 0;
+
+	old_ns = sim_host_ns();
+	for (r = 0; r < H264_REPEAT; r++)
+		scan_old(sample, h264_sample_len, old_nal);
+	old_ns = sim_host_ns() - old_ns;
+
+	new_ns = sim_host_ns();
+	for (r = 0; r < H264_REPEAT; r++)
+		scan_new(sample, h264_sample_len, new_nal);
+	new_ns = sim_host_ns() - new_ns;
+
+	for (p = sample; (len = h264_au_index(p, end, &au)) != 0; p += len) {
+		aus++;
+		keys += au.key;
+		nals += au.num_nal;
+		if (au.num_nal > max_nals)
+			max_nals = au.num_nal;
+		for (i = 0; i < au.num_nal; i++)
+			fail |= au.data[au.nal[i].offset - au.nal[i].start_code_len] != 0;
+	}
+	fail |= nals != (uint32_t) n_new;
+
+	au_ns = sim_host_ns();
+	for (r = 0; r < H264_REPEAT; r++) {
+		for (p = sample; (len = h264_au_index(p, end, &au)) != 0; p += len)
+			;
+	}
+	au_ns = sim_host_ns() - au_ns;
+
+	fail += h264_fuzz();
+
+	printf("h264   %u bytes, %d NALs, %u access units (%u key, up to %u NALs)%s\n",
+		h264_sample_len, n_new, aus, keys, max_nals, fail ? ", MISMATCH" : "");
+	printf("h264   seek_to_next %.0f MB/s, h264_find_start_code %.0f MB/s, h264_au_index %.0f MB/s\n",
+		(double) h264_sample_len * H264_REPEAT * 1e3 / old_ns,
+		(double) h264_sample_len * H264_REPEAT * 1e3 / new_ns,
+		(double) h264_sample_len * H264_REPEAT * 1e3 / au_ns);
+
+	return fail ? -1 : 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * The board's iperf command, common/utilities/tcptest.c, over the wire:
+ * "tcp -s -p 5002" serves on 10.0.0.2 and "tcp -c 10.0.0.2 -p 5002 -n 4M"
+ * sends from 10.0.0.1, until both tcptest tasks have stopped. tcptest
+ * prints its own report; the line here adds the host time per byte, where
+ * the checksum options of lwipopts.h show. Port 5001, tcptest's default,
+ * is the tcp bench's sink. The tcploss bench runs its transfers through
+ * sim_iperf_run() too.
+ *
+ * make VARIANT=stockchksum builds the same with the stock lwIP checksum.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sim.h"
+
+#define IPERF_BYTES			(4 * 1024 * 1024)
+#define IPERF_TIMEOUT		(60 * configTICK_RATE_HZ)
+
+extern xTaskHandle g_tcp_server_task;
+extern xTaskHandle g_tcp_client_task;
+void cmd_tcp(int argc, char **argv);
+
+/* tcptest's -S (TOS of the UDP client) goes to the WLAN driver */
+int wext_set_tos_value(const char *ifname, uint8_t *tos_value)
+{
+	(void) ifname;
+	(void) tos_value;
+	return 0;
+}
+
+/* One tcptest transfer of size ("512K", "4M"), return the ticks until both
+   tcptest tasks have stopped or -1 */
+int sim_iperf_run(const char *name, const char *size)
+{
+	char *server[] = { "tcp", "-s", "-p", "5002" };
+	char *client[] = { "tcp", "-c", "10.0.0.2", "-p", "5002", "-n", (char *) size };
+	TickType_t start = xTaskGetTickCount();
+
+	cmd_tcp(sizeof(server) / sizeof(server[0]), server);
+	cmd_tcp(sizeof(client) / sizeof(client[0]), client);
+
+	while ((g_tcp_server_task || g_tcp_client_task) && xTaskGetTickCount() - start < IPERF_TIMEOUT)
+		vTaskDelay(1);
+	printf("\n");
+
+	if (g_tcp_server_task || g_tcp_client_task) {
+		printf("%-6s timed out\n", name);
+		return -1;
+	}
+
+	return xTaskGetTickCount() - start;
+}
+
+int sim_bench_iperf(void)
+{
+	sim_wire_stats stats;
+	uint64_t ns;
+	int ticks;
+
+	sim_netif_reset_stats();
+	ns = sim_host_ns();
+	ticks = sim_iperf_run("iperf", "4M");
+	ns = sim_host_ns() - ns;
+	if (ticks < 0)
+		return -1;
+
+	sim_netif_get_stats(0, &stats);
+	printf("iperf  %u KB in %u ticks, %u frames sent, host %.1f ns/byte\n",
+		IPERF_BYTES / 1024, (unsigned) ticks, (unsigned) stats.tx_frames, (double) ns / IPERF_BYTES);
+
+	return 0;
+}
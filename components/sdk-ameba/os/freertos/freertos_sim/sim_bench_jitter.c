@@ -0,0 +1,424 @@
+/*
+ * RTP audio jitter buffer: 20 ms u-law frames replayed in virtual time
+ * through a modelled network into a player that pulls at exactly 8 kHz,
+ * like the I2S sink asking for more when its ring runs low.
+ *
+ *   fifo   what mmf_source_rtp did before: packets play in the order they
+ *          come, from a queue of 4 behind the socket's 6, and the player
+ *          waits for three of them when it runs dry
+ *   jb     rtp_jitter with g711_plc concealing losses and taking up drift
+ *
+ * Glitches are the ms that do not play the right audio: silence, frames
+ * concealed, skipped, dropped or played out of order. Latency is from the
+ * send time to when the frame starts playing. The scenarios:
+ *
+ *   clean   0-5 ms of jitter
+ *   wifi    0-20 ms, 5% delayed up to 120 ms more, 2% lost
+ *   stalls  0-10 ms and every 5 s nothing for 300 ms, then all at once
+ *   fast    0-10 ms, the sender's clock 1000 ppm fast
+ *   slow    0-10 ms, 1000 ppm slow
+ *
+ * Before that, the concealment alone: 5% of the frames of a voiced signal
+ * are lost and replaced by g711_plc or by silence.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "g711_pcm.h"
+#include "g711_plc.h"
+#include "rtp_jitter.h"
+
+#include "sim.h"
+
+#define JB_CLOCK			8000
+#define JB_FRAME			160			/* samples, 20 ms */
+#define JB_FRAME_MS			20
+#define JB_HDR				12
+#define JB_PKT				(JB_HDR + JB_FRAME)
+#define JB_SLOTS			16
+#define JB_RUN_MS			60000
+#define JB_PKTS				(JB_RUN_MS / JB_FRAME_MS)
+#define JB_SIGNAL			(JB_CLOCK * 8)	/* looped */
+#define JB_RING				(2 * JB_FRAME)	/* the player asks below this */
+#define JB_FIFO_QUEUE		4			/* cache_queue */
+#define JB_FIFO_MBOX		6			/* DEFAULT_UDP_RECVMBOX_SIZE */
+#define JB_FIFO_START		3			/* frames the old handle waited for */
+#define JB_BASE_MS			5			/* network delay without jitter */
+#define JB_SSRC				0x6a697474
+
+typedef struct {
+	const char *name;
+	int jitter;			/* ms, uniform */
+	int tail;			/* packets per 1000 delayed more */
+	int tail_ms;		/* up to */
+	int loss;			/* per 1000 */
+	int stall_every;	/* ms */
+	int stall_ms;
+	int ppm;			/* sender clock fast */
+} jb_scenario;
+
+static const jb_scenario scenarios[] = {
+	{ "clean",	5,	0,	0,		0,	0,		0,		0 },
+	{ "wifi",	20,	50,	120,	20,	0,		0,		0 },
+	{ "stalls",	10,	0,	0,		0,	5000,	300,	0 },
+	{ "fast",	10,	0,	0,		0,	0,		0,		1000 },
+	{ "slow",	10,	0,	0,		0,	0,		0,		-1000 },
+};
+
+#define JB_SCENARIOS		(sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+	uint32_t send_ms[JB_PKTS];
+	uint32_t arrive_ms[JB_PKTS];
+	uint16_t order[JB_PKTS];	/* by arrival */
+	int count;					/* not lost */
+} jb_trace;
+
+typedef struct {
+	uint32_t glitch_ms;
+	uint32_t silence_ms;
+	uint32_t concealed;
+	uint32_t skipped;			/* fifo: sequence numbers jumped over */
+	uint32_t misordered;
+	uint32_t played;
+	uint16_t lat[JB_PKTS];
+	uint32_t lat_first;			/* mean from 5 s to 10 s */
+	uint32_t lat_last;			/* and over the last 5 s */
+	uint32_t n_first;
+	uint32_t n_last;
+	uint64_t ns;
+	rtp_jitter_stats_t st;		/* jb: after the last packet */
+} jb_result;
+
+static uint8_t jb_signal[JB_SIGNAL];
+static jb_trace trace;
+static jb_result res_fifo, res_jb;
+static uint8_t jb_mem[JB_SLOTS * JB_PKT];
+static rtp_jb_slot_t jb_slot[JB_SLOTS];
+static rtp_jitter_t jb;
+static g711_plc_t plc;
+
+static uint32_t jb_seed;
+
+static uint32_t jb_rand(void)
+{
+	jb_seed = jb_seed * 1103515245 + 12345;
+	return (jb_seed >> 8) & 0xffffff;
+}
+
+static uint8_t ref_linear2ulaw(int pcm)
+{
+	static const int seg_end[8] = { 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff, 0x1fff };
+	int mask, seg;
+
+	pcm >>= 2;
+	if (pcm < 0) {
+		pcm = -pcm;
+		mask = 0x7f;
+	} else
+		mask = 0xff;
+	if (pcm > 8159)
+		pcm = 8159;
+	pcm += 0x21;
+	for (seg = 0; seg < 8 && pcm > seg_end[seg]; seg++)
+		;
+	if (seg >= 8)
+		return 0x7f ^ mask;
+	return ((seg << 4) | ((pcm >> (seg + 1)) & 0x0f)) ^ mask;
+}
+
+/* voiced speech, roughly: a pulse train with a gliding pitch through two
+   formant resonators, in syllables of 200 ms with 50 ms pauses. The
+   pitch glides between 160 and 100 Hz and back over 2 s, as a voice does */
+static void make_signal(void)
+{
+	double y1 = 0, y2 = 0, z1 = 0, z2 = 0, x, y, z, env;
+	int i, next = 0, period, t;
+
+	for (i = 0; i < JB_SIGNAL; i++) {
+		t = i % 2000;
+		period = i % 16000 < 8000 ? 50 + i % 16000 * 30 / 8000 : 80 - (i % 16000 - 8000) * 30 / 8000;
+		x = 0;
+		if (i >= next) {
+			x = 3000;
+			next = i + period;
+		}
+		y = x + 1.79233 * y1 - 0.9409 * y2;	/* 500 Hz */
+		y2 = y1;
+		y1 = y;
+		z = y + 0.72710 * z1 - 0.9025 * z2;	/* 1500 Hz */
+		z2 = z1;
+		z1 = z;
+		env = t < 1600 ? (t < 200 ? t / 200.0 : (t > 1400 ? (1600 - t) / 200.0 : 1)) : 0;
+		jb_signal[i] = ref_linear2ulaw((int) (z * env * 0.25));
+	}
+}
+
+/* 5% of the frames lost, the error energy left in them against the signal's */
+static int plc_quality(void)
+{
+	uint8_t out[JB_FRAME];
+	uint64_t sig = 0, err = 0;
+	uint64_t t0, ns = 0;
+	int f, i, n = 0, d;
+
+	g711_plc_init(&plc, I2S_MODE_G711U);
+	jb_seed = 0x504c43;
+	for (f = 0; f < JB_SIGNAL / JB_FRAME; f++) {
+		if (f > 0 && jb_rand() % 20 == 0) {
+			t0 = sim_host_ns();
+			g711_plc_conceal(&plc, out, JB_FRAME);
+			ns += sim_host_ns() - t0;
+			n++;
+			for (i = 0; i < JB_FRAME; i++) {
+				d = g711_ulaw2linear(jb_signal[f * JB_FRAME + i]);
+				sig += (int64_t) d * d;
+				d -= g711_ulaw2linear(out[i]);
+				err += (int64_t) d * d;
+			}
+		} else {
+			memcpy(out, jb_signal + f * JB_FRAME, JB_FRAME);
+			g711_plc_good(&plc, out, JB_FRAME);
+		}
+	}
+	printf("jitter plc     %d frames lost, error %u%% of their energy (silence 100%%), %u ns per frame\n",
+		n, (unsigned) (err * 100 / sig), (unsigned) (ns / n));
+	return err < sig ? 0 : -1;
+}
+
+static void make_trace(const jb_scenario *sc)
+{
+	uint32_t arrive, stall;
+	int k, i, n = 0;
+
+	for (k = 0; k < JB_PKTS; k++) {
+		trace.send_ms[k] = (uint64_t) k * JB_FRAME_MS * 1000000 / (1000000 + sc->ppm);
+		arrive = trace.send_ms[k] + JB_BASE_MS + jb_rand() % (sc->jitter + 1);
+		if (sc->tail && jb_rand() % 1000 < (uint32_t) sc->tail)
+			arrive += jb_rand() % (sc->tail_ms + 1);
+		if (sc->stall_every) {
+			stall = trace.send_ms[k] / sc->stall_every * sc->stall_every + sc->stall_every - sc->stall_ms;
+			if (trace.send_ms[k] >= stall && arrive < stall + sc->stall_ms + JB_BASE_MS)
+				arrive = stall + sc->stall_ms + JB_BASE_MS;
+		}
+		trace.arrive_ms[k] = arrive;
+		if (sc->loss && jb_rand() % 1000 < (uint32_t) sc->loss)
+			continue;
+		/* insert by arrival */
+		for (i = n; i > 0 && trace.arrive_ms[trace.order[i - 1]] > arrive; i--)
+			trace.order[i] = trace.order[i - 1];
+		trace.order[i] = k;
+		n++;
+	}
+	trace.count = n;
+}
+
+static void make_packet(uint8_t *pkt, int k)
+{
+	uint32_t ts = k * JB_FRAME;
+
+	pkt[0] = 0x80;
+	pkt[1] = 0;		/* PCMU */
+	pkt[2] = k >> 8;
+	pkt[3] = k;
+	pkt[4] = ts >> 24;
+	pkt[5] = ts >> 16;
+	pkt[6] = ts >> 8;
+	pkt[7] = ts;
+	pkt[8] = (uint8_t) (JB_SSRC >> 24);
+	pkt[9] = (uint8_t) (JB_SSRC >> 16);
+	pkt[10] = (uint8_t) (JB_SSRC >> 8);
+	pkt[11] = (uint8_t) JB_SSRC;
+	memcpy(pkt + JB_HDR, jb_signal + ts % JB_SIGNAL, JB_FRAME);
+}
+
+static int cmp_u16(const void *a, const void *b)
+{
+	return *(const uint16_t *) a - *(const uint16_t *) b;
+}
+
+static unsigned pct(const uint16_t *v, int n, int p)
+{
+	return n ? v[(n - 1) * p / 100] : 0;
+}
+
+/* a frame of seq k starts playing after the ring queued in front of it */
+static void played(jb_result *r, int k, uint32_t now, int ring)
+{
+	uint32_t lat = now + ring * 1000 / JB_CLOCK - trace.send_ms[k];
+
+	if (now >= JB_RUN_MS)
+		return;
+	r->lat[r->played++] = lat;
+	if (now >= 5000 && now < 10000) {
+		r->lat_first += lat;
+		r->n_first++;
+	}
+	if (now >= JB_RUN_MS - 5000) {
+		r->lat_last += lat;
+		r->n_last++;
+	}
+}
+
+static void finish(jb_result *r)
+{
+	r->lat_first /= r->n_first ? r->n_first : 1;
+	r->lat_last /= r->n_last ? r->n_last : 1;
+}
+
+static void fifo_run(jb_result *r)
+{
+	static uint16_t q[JB_FIFO_QUEUE + JB_FIFO_MBOX];
+	int head = 0, n = 0, next = 0, ring = 0, started = 0, last = -1, k;
+	uint32_t now;
+
+	memset(r, 0, sizeof(*r));
+	for (now = 0; now < JB_RUN_MS + 1000; now++) {
+		while (next < trace.count && trace.arrive_ms[trace.order[next]] <= now) {
+			if (n < JB_FIFO_QUEUE + JB_FIFO_MBOX)
+				q[(head + n++) % (JB_FIFO_QUEUE + JB_FIFO_MBOX)] = trace.order[next];
+			next++;
+		}
+		if (ring >= JB_CLOCK / 1000)
+			ring -= JB_CLOCK / 1000;
+		else {
+			ring = 0;
+			if (started && now < JB_RUN_MS)
+				r->silence_ms++;
+		}
+		while (ring < JB_RING && n >= JB_FIFO_START) {
+			k = q[head];
+			head = (head + 1) % (JB_FIFO_QUEUE + JB_FIFO_MBOX);
+			n--;
+			if (k < last)
+				r->misordered++;
+			else if (k > last + 1 && started)
+				r->skipped += k - last - 1;
+			if (k > last)
+				last = k;
+			played(r, k, now, ring);
+			ring += JB_FRAME;
+			started = 1;
+		}
+	}
+	finish(r);
+	r->glitch_ms = r->silence_ms + (r->misordered + r->skipped) * JB_FRAME_MS;
+}
+
+static void jb_replay(jb_result *r)
+{
+	uint8_t pkt[JB_PKT], out[JB_FRAME + 2];
+	rtp_jb_frame_t f;
+	int next = 0, ring = 0, started = 0, last = -1, ret, len = 0, k;
+	uint32_t now;
+	uint64_t t0;
+
+	memset(r, 0, sizeof(*r));
+	rtp_jitter_init(&jb, jb_slot, jb_mem, JB_SLOTS, JB_PKT, JB_CLOCK, JB_FRAME, 1);
+	g711_plc_init(&plc, I2S_MODE_G711U);
+	for (now = 0; now < JB_RUN_MS + 1000; now++) {
+		while (next < trace.count && trace.arrive_ms[trace.order[next]] <= now) {
+			k = trace.order[next++];
+			make_packet(pkt, k);
+			t0 = sim_host_ns();
+			rtp_jitter_put(&jb, pkt, JB_PKT, now);
+			r->ns += sim_host_ns() - t0;
+		}
+		if (ring >= JB_CLOCK / 1000)
+			ring -= JB_CLOCK / 1000;
+		else {
+			ring = 0;
+			if (started && now < JB_RUN_MS)
+				r->silence_ms++;
+		}
+		while (ring < JB_RING) {
+			t0 = sim_host_ns();
+			ret = rtp_jitter_get(&jb, &f, now);
+			if (ret == RTP_JB_PACKET) {
+				memcpy(out, f.data, f.len);
+				len = g711_plc_adjust(&plc, out, f.len, f.adjust);
+				g711_plc_good(&plc, out, len);
+			} else if (ret == RTP_JB_LOST) {
+				len = f.len;
+				g711_plc_conceal(&plc, out, len);
+			}
+			r->ns += sim_host_ns() - t0;
+			if (ret == RTP_JB_NONE)
+				break;
+			/* past the last packet */
+			if (f.seq >= JB_PKTS && ret == RTP_JB_LOST)
+				break;
+			if (ret == RTP_JB_PACKET) {
+				k = f.seq;
+				if (k <= last)
+					r->misordered++;
+				last = k;
+				played(r, k, now, ring);
+				if (k == JB_PKTS - 1)
+					rtp_jitter_get_stats(&jb, &r->st);
+			} else
+				r->concealed++;
+			ring += len;
+			started = 1;
+		}
+	}
+	finish(r);
+	r->glitch_ms = r->silence_ms + (r->concealed + r->st.dropped + r->misordered) * JB_FRAME_MS;
+}
+
+static int run_scenario(const jb_scenario *sc, int idx)
+{
+	rtp_jitter_stats_t *st = &res_jb.st;
+	int fail = 0;
+
+	jb_seed = 0x1000 + idx;
+	make_trace(sc);
+	fifo_run(&res_fifo);
+	jb_replay(&res_jb);
+
+	qsort(res_fifo.lat, res_fifo.played, sizeof(uint16_t), cmp_u16);
+	qsort(res_jb.lat, res_jb.played, sizeof(uint16_t), cmp_u16);
+	printf("jitter %-7s fifo latency p50 %3u p95 %3u ms, first/last 5 s %3u/%3u, glitches %5u ms: silence %u, "
+		"%u skipped, %u out of order\n",
+		sc->name, pct(res_fifo.lat, res_fifo.played, 50), pct(res_fifo.lat, res_fifo.played, 95),
+		res_fifo.lat_first, res_fifo.lat_last, res_fifo.glitch_ms, res_fifo.silence_ms,
+		res_fifo.skipped, res_fifo.misordered);
+	printf("jitter %-7s jb   latency p50 %3u p95 %3u ms, first/last 5 s %3u/%3u, glitches %5u ms: silence %u, "
+		"%u concealed (%u lost, %u late, %u underflow), %u dropped\n",
+		sc->name, pct(res_jb.lat, res_jb.played, 50), pct(res_jb.lat, res_jb.played, 95),
+		res_jb.lat_first, res_jb.lat_last, res_jb.glitch_ms, res_jb.silence_ms,
+		res_jb.concealed, st->lost, st->late, st->underflow, st->dropped);
+	printf("jitter %-7s jb   target %u ms, delay %u max %u ms, jitter %u ms, %u reordered, samples %u slipped %u stretched, "
+		"%u ns per packet\n",
+		sc->name, st->target, st->delay, st->delay_max, st->jitter, st->reordered, st->slipped, st->stretched,
+		(unsigned) (res_jb.ns / JB_PKTS));
+
+	/* in order, never worse than the queue, and the delay does not run away
+	   with drift. Stalls raise the target on purpose, but not past its limit */
+	if (res_jb.misordered)
+		fail = 1;
+	if (res_jb.glitch_ms > res_fifo.glitch_ms && res_jb.glitch_ms > 100)
+		fail = 1;
+	if (sc->stall_every == 0 && res_jb.lat_last > res_jb.lat_first + 2 * JB_FRAME_MS)
+		fail = 1;
+	if (st->delay_max > RTP_JB_MAX_DELAY + RTP_JB_DROP_DELAY)
+		fail = 1;
+	return fail;
+}
+
+int sim_bench_jitter(void)
+{
+	int i, fail = 0;
+
+	make_signal();
+	if (plc_quality() != 0)
+		fail = 1;
+	for (i = 0; i < JB_SCENARIOS; i++)
+		fail |= run_scenario(&scenarios[i], i);
+	return fail ? -1 : 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * The tcpip core lock: request/response between 10.0.0.1 and servers on
+ * 10.0.0.2, LOCK_COUNT transactions of LOCK_SIZE bytes each way over TCP
+ * (TCP_NODELAY) and UDP, with no wire latency and rate limit, so that the
+ * time is that of the stack and the tasks. For each:
+ *
+ *   latency   ticks from sending the request to having the response
+ *   wakeups   switches to the tcpip thread per transaction
+ *   switches  task switches per transaction, all tasks
+ *   host      host time per transaction
+ *
+ * With LWIP_TCPIP_CORE_LOCKING the socket calls run in the calling task,
+ * without it each one is a message to the tcpip thread and back. With no
+ * latency a frame reaches the peer while its sender still holds the core
+ * lock, so the tcpip thread wakes twice for it: once for the frame and
+ * once when the lock is released.
+ *
+ * Then a timeout of LOCK_TMO ticks added from this task: under the core
+ * lock with sys_timeout(), or with tcpip_timeout() without it. The tcpip
+ * thread sleeps until its next timer meanwhile, so it has to be woken for
+ * the new one; the benchmark fails if it fires late.
+ *
+ * make VARIANT=nocorelock builds the same without LWIP_TCPIP_CORE_LOCKING.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+#include "lwip/lwip_timers.h"
+
+#include "sim.h"
+
+#define LOCK_TCP_PORT		5050
+#define LOCK_UDP_PORT		5051
+#define LOCK_COUNT			2000
+#define LOCK_SIZE			64
+#define LOCK_TIMEOUT_MS		1000
+#define LOCK_TMO			10
+#define LOCK_TMO_TRIES		50
+#define LOCK_TMO_GAP		37		/* ticks between tries, off the timer periods */
+#define LOCK_PRIO			(tskIDLE_PRIORITY + 2)
+
+static SemaphoreHandle_t lock_sem, lock_done;
+static volatile TickType_t lock_fired;
+
+static int lock_recv_all(int s, char *buf, int len)
+{
+	int n, got = 0;
+
+	while (got < len) {
+		n = recv(s, buf + got, len - got, 0);
+		if (n <= 0)
+			return -1;
+		got += n;
+	}
+	return got;
+}
+
+static void lock_tcp_server_task(void *param)
+{
+	char buf[LOCK_SIZE];
+	struct sockaddr_in addr;
+	int s, c, on = 1;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(LOCK_TCP_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+	listen(s, 1);
+
+	c = accept(s, NULL, NULL);
+	if (c >= 0) {
+		setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		while (lock_recv_all(c, buf, sizeof(buf)) > 0)
+			send(c, buf, sizeof(buf), 0);
+		close(c);
+	}
+
+	close(s);
+	xSemaphoreGive(lock_done);
+	vTaskDelete(NULL);
+}
+
+static void lock_udp_server_task(void *param)
+{
+	char buf[LOCK_SIZE];
+	struct sockaddr_in addr;
+	socklen_t len;
+	int s, n;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(LOCK_UDP_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+
+	/* a short datagram ends it */
+	for (;;) {
+		len = sizeof(addr);
+		n = recvfrom(s, buf, sizeof(buf), 0, (struct sockaddr *) &addr, &len);
+		if (n != LOCK_SIZE)
+			break;
+		sendto(s, buf, n, 0, (struct sockaddr *) &addr, len);
+	}
+
+	close(s);
+	xSemaphoreGive(lock_done);
+	vTaskDelete(NULL);
+}
+
+/* The servers serve one client and close their sockets, the poll bench
+   needs all of them */
+
+/* In the tcpip thread: count its wakeups */
+static void lock_watch(void *arg)
+{
+	(void) arg;
+
+	sim_task_watch(xTaskGetCurrentTaskHandle());
+	xSemaphoreGive(lock_sem);
+}
+
+static int lock_rr(int tcp)
+{
+	char buf[LOCK_SIZE];
+	struct sockaddr_in addr;
+	uint32_t i, wakeups, switches, t, total = 0, max = 0;
+	int s, on = 1, timeout = LOCK_TIMEOUT_MS, ret = 0;
+	uint64_t ns;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+	if (tcp) {
+		addr.sin_port = htons(LOCK_TCP_PORT);
+		s = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(s, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+			printf("lock   tcp connect failed\n");
+			close(s);
+			return -1;
+		}
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	} else {
+		addr.sin_port = htons(LOCK_UDP_PORT);
+		s = socket(AF_INET, SOCK_DGRAM, 0);
+		connect(s, (struct sockaddr *) &addr, sizeof(addr));
+	}
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	memset(buf, 0x5a, sizeof(buf));
+
+	wakeups = sim_task_switches();
+	switches = sim_switches();
+	ns = sim_host_ns();
+	for (i = 0; i < LOCK_COUNT; i++) {
+		t = xTaskGetTickCount();
+		if (send(s, buf, sizeof(buf), 0) != sizeof(buf) || lock_recv_all(s, buf, sizeof(buf)) < 0) {
+			printf("lock   %s transaction %u failed\n", tcp ? "tcp" : "udp", i);
+			ret = -1;
+			break;
+		}
+		t = xTaskGetTickCount() - t;
+		total += t;
+		if (t > max)
+			max = t;
+	}
+	ns = sim_host_ns() - ns;
+	switches = sim_switches() - switches;
+	wakeups = sim_task_switches() - wakeups;
+	if (!tcp)
+		send(s, buf, 1, 0);
+	close(s);
+	if (xSemaphoreTake(lock_done, LOCK_TIMEOUT_MS / portTICK_RATE_MS) != pdTRUE) {
+		printf("lock   %s server did not stop\n", tcp ? "tcp" : "udp");
+		ret = -1;
+	}
+
+	if (ret == 0)
+		printf("lock   %s rr: latency avg %.2f max %u ticks, %.2f tcpip wakeups and %.2f switches per transaction, host %.0f ns, core locking %s\n",
+			tcp ? "tcp" : "udp", (double) total / LOCK_COUNT, max, (double) wakeups / LOCK_COUNT,
+			(double) switches / LOCK_COUNT, (double) ns / LOCK_COUNT, LWIP_TCPIP_CORE_LOCKING ? "on" : "off");
+	return ret;
+}
+
+static void lock_tmo(void *arg)
+{
+	(void) arg;
+
+	lock_fired = xTaskGetTickCount();
+	xSemaphoreGive(lock_sem);
+}
+
+/* Ticks until a LOCK_TMO timeout added by this task fires, worst of the tries */
+static int lock_timeout(void)
+{
+	uint32_t i, t, total = 0, max = 0;
+	TickType_t start;
+
+	for (i = 0; i < LOCK_TMO_TRIES; i++) {
+		vTaskDelay(LOCK_TMO_GAP);
+		start = xTaskGetTickCount();
+#if LWIP_TCPIP_CORE_LOCKING
+		LOCK_TCPIP_CORE();
+		sys_timeout(LOCK_TMO, lock_tmo, NULL);
+		UNLOCK_TCPIP_CORE();
+#else /* LWIP_TCPIP_CORE_LOCKING */
+		tcpip_timeout(LOCK_TMO, lock_tmo, NULL);
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+		if (xSemaphoreTake(lock_sem, 10 * configTICK_RATE_HZ) != pdTRUE) {
+			printf("lock   timeout never fired\n");
+			return -1;
+		}
+		t = lock_fired - start;
+		total += t;
+		if (t > max)
+			max = t;
+	}
+
+	printf("lock   %u ms timeout from a task: fired after avg %.2f max %u ticks\n",
+		LOCK_TMO, (double) total / LOCK_TMO_TRIES, max);
+	return (max <= LOCK_TMO + 1) ? 0 : -1;
+}
+
+int sim_bench_lock(void)
+{
+	uint32_t rate, latency;
+	int ret = 0;
+
+	if (lock_sem == NULL) {
+		lock_sem = xSemaphoreCreateBinary();
+		lock_done = xSemaphoreCreateBinary();
+	}
+	xTaskCreate(lock_tcp_server_task, (const char *) "lock_tcp", 1024, NULL, LOCK_PRIO, NULL);
+	xTaskCreate(lock_udp_server_task, (const char *) "lock_udp", 512, NULL, LOCK_PRIO, NULL);
+
+	tcpip_callback(lock_watch, NULL);
+	xSemaphoreTake(lock_sem, portMAX_DELAY);
+	rate = sim_netif_set_rate(0);
+	latency = sim_netif_set_latency(0);
+
+	if (lock_rr(1) != 0)
+		ret = -1;
+	if (lock_rr(0) != 0)
+		ret = -1;
+
+	sim_netif_set_rate(rate);
+	sim_netif_set_latency(latency);
+	sim_task_watch(NULL);
+
+	if (lock_timeout() != 0)
+		ret = -1;
+
+	return ret;
+}
@@ -0,0 +1,261 @@
+/*
+ * MMF source to sink benchmark.
+ *
+ * Each stream is a source stage that fills exch_buf_t, a sink stage that
+ * hands the frame to a sender task (the RTP task for rtsp2, the I2S irq for
+ * the i2s sink) and waits until it is sent, and the sender. Two pipelines:
+ *
+ *   poll   the old way: stages look at an xQueue and sleep a tick when it
+ *          is empty, the sink sleeps a tick at a time until the frame is sent
+ *   pipe   mmf_pipe/mmf_stage, the sink blocks on a semaphore from the sender
+ *
+ * Paced streams measure source to sent latency and wakeups, unpaced streams
+ * the frame rate.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include "mmf_pipe.h"
+
+#include "sim.h"
+
+#define MMF_STREAMS			2
+#define MMF_FRAMES			500		/* per stream */
+#define MMF_PERIOD			10		/* ticks between paced frames */
+#define MMF_BUFS			3		/* exch_buf_t circulating per stream */
+#define MMF_FRAME_SIZE		1024
+#define MMF_PRIO			(tskIDLE_PRIORITY + 2)
+#define MMF_SENDER_PRIO		(tskIDLE_PRIORITY + 1)	/* the RTP task runs below the stages */
+
+typedef struct {
+	int pipe;				/* pipe or poll */
+	int paced;
+	TickType_t next;		/* source: due tick of the next frame */
+	uint32_t made;
+	volatile uint32_t sent;
+	volatile int sent_flag;
+	uint32_t wakeups;		/* sink and poll loop passes that found nothing */
+	uint32_t lat_total;
+	uint32_t lat_max;
+	QueueHandle_t job;		/* sink -> sender */
+	SemaphoreHandle_t sent_sem;
+	uint8_t data[MMF_FRAME_SIZE];
+} mmf_stream;
+
+static mmf_stream streams[MMF_STREAMS];
+static SemaphoreHandle_t mmf_done;
+static volatile int poll_state;
+
+static int src_handle(void *ctx, void *b)
+{
+	mmf_stream *st = (mmf_stream *) ctx;
+	exch_buf_t *exbuf = (exch_buf_t *) b;
+
+	if (exbuf->state == STAT_READY)
+		return 0;
+	if (st->made == MMF_FRAMES)
+		return -EAGAIN;
+
+	if (st->paced)
+		vTaskDelayUntil(&st->next, MMF_PERIOD);
+
+	exbuf->data = st->data;
+	exbuf->len = MMF_FRAME_SIZE;
+	exbuf->index = st->made++;
+	exbuf->timestamp = xTaskGetTickCount();
+	exbuf->codec_fmt = FMT_V_H264;
+	exbuf->state = STAT_READY;
+	return 0;
+}
+
+static int sink_handle(void *ctx, void *b)
+{
+	mmf_stream *st = (mmf_stream *) ctx;
+	exch_buf_t *exbuf = (exch_buf_t *) b;
+	uint32_t lat;
+
+	if (exbuf->state != STAT_READY)
+		return -EAGAIN;
+
+	st->sent_flag = 0;
+	xQueueSend(st->job, &exbuf, portMAX_DELAY);
+
+	if (st->pipe) {
+		xSemaphoreTake(st->sent_sem, portMAX_DELAY);
+	} else {
+		while (!st->sent_flag) {
+			vTaskDelay(1);
+			st->wakeups++;
+		}
+	}
+
+	lat = xTaskGetTickCount() - exbuf->timestamp;
+	st->lat_total += lat;
+	if (lat > st->lat_max)
+		st->lat_max = lat;
+
+	exbuf->state = STAT_USED;
+	if (++st->sent == MMF_FRAMES)
+		xSemaphoreGive(mmf_done);
+	return 0;
+}
+
+static void sender_task(void *param)
+{
+	mmf_stream *st = (mmf_stream *) param;
+	exch_buf_t *exbuf;
+	volatile uint32_t sum = 0;
+	uint32_t i;
+
+	for (;;) {
+		xQueueReceive(st->job, &exbuf, portMAX_DELAY);
+		for (i = 0; i < exbuf->len; i += 64)
+			sum += exbuf->data[i];
+		if (st->pipe)
+			xSemaphoreGive(st->sent_sem);
+		else
+			st->sent_flag = 1;
+	}
+}
+
+/* The polling stage loop the pipe replaces */
+typedef struct {
+	int (*handle)(void *, void *);
+	mmf_stream *st;
+	QueueHandle_t in, out;
+} poll_stage;
+
+static void poll_stage_task(void *param)
+{
+	poll_stage *ps = (poll_stage *) param;
+	exch_buf_t exbuf;
+
+	while (poll_state == S_RUN) {
+		if (xQueueReceive(ps->in, &exbuf, 0) != pdTRUE) {
+			ps->st->wakeups++;
+			vTaskDelay(1);
+			continue;
+		}
+		while (ps->handle(ps->st, &exbuf) == -EAGAIN && ps->handle == src_handle && poll_state == S_RUN)
+			vTaskDelay(1);
+		xQueueSend(ps->out, &exbuf, portMAX_DELAY);
+	}
+
+	xSemaphoreGive(mmf_done);
+	vTaskDelete(NULL);
+}
+
+static void mmf_run(int pipe, int paced)
+{
+	static poll_stage ps[MMF_STREAMS][2];
+	mmf_pipe_t *src2sink[MMF_STREAMS], *sink2src[MMF_STREAMS];
+	mmf_stage_t *stage[MMF_STREAMS][2];
+	QueueHandle_t q_src2sink[MMF_STREAMS], q_sink2src[MMF_STREAMS];
+	TaskHandle_t sender[MMF_STREAMS];
+	exch_buf_t exbuf;
+	mmf_pipe_stats_t ps_stats;
+	uint32_t wakeups = 0, lat_total = 0, lat_max = 0, drops = 0, i, j;
+	TickType_t start;
+	uint64_t ns;
+
+	memset(&exbuf, 0, sizeof(exbuf));
+	exbuf.type = MFT_DATA;
+	exbuf.state = STAT_INIT;
+
+	start = xTaskGetTickCount();
+	ns = sim_host_ns();
+	poll_state = S_RUN;
+
+	for (i = 0; i < MMF_STREAMS; i++) {
+		mmf_stream *st = &streams[i];
+
+		memset(st, 0, sizeof(mmf_stream));
+		st->pipe = pipe;
+		st->paced = paced;
+		st->next = start;
+		st->job = xQueueCreate(1, sizeof(exch_buf_t *));
+		st->sent_sem = xSemaphoreCreateBinary();
+		xTaskCreate(sender_task, (const char *) "sender", 512, st, MMF_SENDER_PRIO, &sender[i]);
+
+		if (pipe) {
+			src2sink[i] = mmf_pipe_create(MMF_BUFS, MMF_PIPE_BLOCK);
+			sink2src[i] = mmf_pipe_create(MMF_BUFS, MMF_PIPE_BLOCK);
+			for (j = 0; j < MMF_BUFS; j++)
+				mmf_pipe_put(sink2src[i], &exbuf, 0);
+			stage[i][0] = mmf_stage_open(MMF_STAGE_SOURCE, src_handle, st, sink2src[i], src2sink[i], "src", 512, MMF_PRIO);
+			stage[i][1] = mmf_stage_open(MMF_STAGE_SINK, sink_handle, st, src2sink[i], sink2src[i], "sink", 512, MMF_PRIO);
+		} else {
+			q_src2sink[i] = xQueueCreate(MMF_BUFS, sizeof(exch_buf_t));
+			q_sink2src[i] = xQueueCreate(MMF_BUFS, sizeof(exch_buf_t));
+			for (j = 0; j < MMF_BUFS; j++)
+				xQueueSend(q_sink2src[i], &exbuf, 0);
+			ps[i][0] = (poll_stage) { src_handle, st, q_sink2src[i], q_src2sink[i] };
+			ps[i][1] = (poll_stage) { sink_handle, st, q_src2sink[i], q_sink2src[i] };
+			xTaskCreate(poll_stage_task, (const char *) "src", 512, &ps[i][0], MMF_PRIO, NULL);
+			xTaskCreate(poll_stage_task, (const char *) "sink", 512, &ps[i][1], MMF_PRIO, NULL);
+		}
+	}
+
+	for (i = 0; i < MMF_STREAMS; i++)
+		xSemaphoreTake(mmf_done, portMAX_DELAY);
+	ns = sim_host_ns() - ns;
+	start = xTaskGetTickCount() - start;
+
+	for (i = 0; i < MMF_STREAMS; i++) {
+		if (pipe) {
+			mmf_pipe_get_stats(src2sink[i], &ps_stats);
+			drops += ps_stats.drop;
+			mmf_stage_close(stage[i][0]);
+			mmf_stage_close(stage[i][1]);
+			mmf_pipe_delete(src2sink[i]);
+			mmf_pipe_delete(sink2src[i]);
+		}
+		wakeups += streams[i].wakeups;
+		lat_total += streams[i].lat_total;
+		if (streams[i].lat_max > lat_max)
+			lat_max = streams[i].lat_max;
+	}
+
+	if (!pipe) {
+		poll_state = S_STOP;
+		for (i = 0; i < 2 * MMF_STREAMS; i++)
+			xSemaphoreTake(mmf_done, portMAX_DELAY);
+		for (i = 0; i < MMF_STREAMS; i++) {
+			vQueueDelete(q_src2sink[i]);
+			vQueueDelete(q_sink2src[i]);
+		}
+	}
+
+	for (i = 0; i < MMF_STREAMS; i++) {
+		vTaskDelete(sender[i]);
+		vQueueDelete(streams[i].job);
+		vSemaphoreDelete(streams[i].sent_sem);
+	}
+	/* the idle task frees the stacks of the deleted tasks before the next run */
+	vTaskDelay(1);
+
+	printf("mmf    %-4s %-7s %u frames in %u ticks (%.0f fps), latency avg %.2f max %u ticks, %u idle wakeups, %u drops, host %.0f ns per frame\n",
+		pipe ? "pipe" : "poll", paced ? "paced" : "unpaced", MMF_STREAMS * MMF_FRAMES, (unsigned) start,
+		(double) MMF_STREAMS * MMF_FRAMES * configTICK_RATE_HZ / (start ? start : 1),
+		(double) lat_total / (MMF_STREAMS * MMF_FRAMES), lat_max, wakeups, drops,
+		(double) ns / (MMF_STREAMS * MMF_FRAMES));
+}
+
+int sim_bench_mmf(void)
+{
+	if (mmf_done == NULL)
+		mmf_done = xSemaphoreCreateCounting(2 * MMF_STREAMS, 0);
+
+	mmf_run(0, 1);
+	mmf_run(1, 1);
+	mmf_run(0, 0);
+	mmf_run(1, 0);
+
+	return 0;
+}
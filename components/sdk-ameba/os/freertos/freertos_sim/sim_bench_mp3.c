@@ -0,0 +1,371 @@
+/*
+ * MP3 synthesis benchmark: mp3_synth, the fixed-point alias reduction,
+ * IMDCT and polyphase filterbank, against a reference decoder that follows
+ * the ISO 11172-3 formulas in double (the direct IMDCT sums and the 64 x 32
+ * matrixing into a 1024 sample V).
+ *
+ * The decoder in lib_codec.a is only shipped for the target, so the input
+ * comes from a double encoder here: the analysis filterbank, MDCT with
+ * block switching around transients and the alias butterflies, run on a
+ * synthetic stereo signal. The reference has to give the source back, which
+ * checks the encoder and the reference; then the fixed-point output is
+ * compared with the reference's, once with the short blocks as coded and
+ * once decoded as mixed blocks.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "mp3_synth.h"
+
+#include "sim.h"
+
+#define MP3B_RATE			44100
+#define MP3B_GRANULES		160
+#define MP3B_SAMPLES		(MP3B_GRANULES * MP3_SYNTH_GRANULE)
+#define MP3B_DELAY			(MP3_SYNTH_GRANULE + 481)	/* the overlap and the filterbank */
+#define MP3B_TRANSIENT		40							/* granules between attacks */
+#define MP3B_REPEAT			5
+
+static double mp3b_src[2][MP3B_SAMPLES];
+static int32_t mp3b_xr[2][MP3B_GRANULES][MP3_SYNTH_GRANULE];
+static uint8_t mp3b_type[MP3B_GRANULES];
+static int16_t mp3b_ref[MP3B_SAMPLES * 2];
+static int16_t mp3b_out[MP3B_SAMPLES * 2];
+static mp3_synth_t mp3b_synth;
+
+/* reference decoder and encoder state */
+static double ref_overlap[2][32][18];
+static double ref_v[2][1024];
+static double cos_long[18][36], cos_short[6][12], win_long[4][36], win_short[12];
+static double mat_n[64][32], mat_m[32][64], win_d[512];
+static double aa_cs[8], aa_ca[8];
+
+static void mp3b_tables(void)
+{
+	static const double c[8] = { -0.6, -0.535, -0.33, -0.185, -0.095, -0.041, -0.0142, -0.0037 };
+	int i, k;
+
+	for (k = 0; k < 18; k++)
+		for (i = 0; i < 36; i++)
+			cos_long[k][i] = cos(M_PI / 72 * (2 * i + 19) * (2 * k + 1));
+	for (k = 0; k < 6; k++)
+		for (i = 0; i < 12; i++)
+			cos_short[k][i] = cos(M_PI / 24 * (2 * i + 7) * (2 * k + 1));
+	for (i = 0; i < 36; i++) {
+		win_long[0][i] = sin(M_PI / 36 * (i + 0.5));
+		win_long[1][i] = i < 18 ? win_long[0][i] : i < 24 ? 1 : i < 30 ? sin(M_PI / 12 * (i - 18 + 0.5)) : 0;
+		win_long[3][i] = i < 6 ? 0 : i < 12 ? sin(M_PI / 12 * (i - 6 + 0.5)) : i < 18 ? 1 : win_long[0][i];
+	}
+	for (i = 0; i < 12; i++)
+		win_short[i] = sin(M_PI / 12 * (i + 0.5));
+	for (i = 0; i < 64; i++)
+		for (k = 0; k < 32; k++) {
+			mat_n[i][k] = cos((16 + i) * (2 * k + 1) * M_PI / 64);
+			mat_m[k][i] = cos((2 * k + 1) * (i - 16) * M_PI / 64);
+		}
+	for (i = 0; i < 512; i++)
+		win_d[i] = mp3_synth_window[i] / 16384.0;
+	for (i = 0; i < 8; i++) {
+		aa_cs[i] = 1 / sqrt(1 + c[i] * c[i]);
+		aa_ca[i] = c[i] / sqrt(1 + c[i] * c[i]);
+	}
+}
+
+/* Chirps and a little noise, an attack every MP3B_TRANSIENT granules, and a
+   stretch loud enough to clip */
+static void mp3b_signal(void)
+{
+	double p0 = 0, p1 = 0, p2 = 0, f, env, gain;
+	uint32_t seed = 1, i, n;
+	int ch;
+
+	for (i = 0; i < MP3B_SAMPLES; i++) {
+		f = 200 + 6000.0 * i / MP3B_SAMPLES;
+		p0 += 2 * M_PI * f / MP3B_RATE;
+		p1 += 2 * M_PI * (f * 2.5 + 300) / MP3B_RATE;
+		p2 += 2 * M_PI * 440 / MP3B_RATE;
+		n = i % (MP3B_TRANSIENT * MP3_SYNTH_GRANULE);
+		n -= (MP3B_TRANSIENT / 2) * MP3_SYNTH_GRANULE + 300;
+		env = (int32_t) n >= 0 ? 0.6 * exp(-(double) n / 300) : 0;
+		gain = i / MP3_SYNTH_GRANULE >= 100 && i / MP3_SYNTH_GRANULE < 110 ? 2.4 : 1;
+		for (ch = 0; ch < 2; ch++) {
+			seed = seed * 1103515245 + 12345;
+			mp3b_src[ch][i] = gain * (0.25 * sin(ch ? p1 : p0) + 0.2 * sin(p2 + ch) +
+				((int32_t)(seed >> 8) / 8388608.0 - 0.5) * (0.04 + 2 * env));
+		}
+	}
+}
+
+/* ISO analysis filterbank: 32 input samples to one subband sample each */
+static void mp3b_analysis(double *x, const double *in, double *s)
+{
+	double y[64];
+	int i, j, k;
+
+	memmove(x + 32, x, 480 * sizeof(double));
+	for (i = 0; i < 32; i++)
+		x[31 - i] = in[i];
+	for (i = 0; i < 64; i++) {
+		y[i] = 0;
+		for (j = 0; j < 8; j++)
+			y[i] += win_d[i + 64 * j] / 32 * x[i + 64 * j];
+	}
+	for (k = 0; k < 32; k++) {
+		s[k] = 0;
+		for (i = 0; i < 64; i++)
+			s[k] += mat_m[k][i] * y[i];
+	}
+}
+
+/* Granule g covers the subband samples of g - 1 and g: start, two short and a
+   stop block around each attack */
+static void mp3b_encode(void)
+{
+	static double x[512], prev[18][32], cur[18][32];
+	double z[36], spec[576], a, b, v;
+	int ch, g, ts, sb, i, k, w, bt;
+
+	for (g = 0; g < MP3B_GRANULES; g++) {
+		k = g % MP3B_TRANSIENT - MP3B_TRANSIENT / 2;
+		mp3b_type[g] = k == -1 ? 1 : k == 0 || k == 1 ? 2 : k == 2 ? 3 : 0;
+	}
+
+	for (ch = 0; ch < 2; ch++) {
+		memset(x, 0, sizeof(x));
+		memset(prev, 0, sizeof(prev));
+		for (g = 0; g < MP3B_GRANULES; g++) {
+			bt = mp3b_type[g];
+			for (ts = 0; ts < 18; ts++) {
+				mp3b_analysis(x, mp3b_src[ch] + g * MP3_SYNTH_GRANULE + ts * 32, cur[ts]);
+				for (sb = 1; sb < 32; sb += 2)
+					if (ts & 1)
+						cur[ts][sb] = -cur[ts][sb];
+			}
+			for (sb = 0; sb < 32; sb++) {
+				for (i = 0; i < 18; i++) {
+					z[i] = prev[i][sb];
+					z[18 + i] = cur[i][sb];
+				}
+				if (bt == 2) {
+					for (w = 0; w < 3; w++)
+						for (k = 0; k < 6; k++) {
+							v = 0;
+							for (i = 0; i < 12; i++)
+								v += win_short[i] * z[6 + 6 * w + i] * cos_short[k][i];
+							spec[sb * 18 + 3 * k + w] = v / 3;
+						}
+				} else {
+					for (k = 0; k < 18; k++) {
+						v = 0;
+						for (i = 0; i < 36; i++)
+							v += win_long[bt][i] * z[i] * cos_long[k][i];
+						spec[sb * 18 + k] = v / 9;
+					}
+				}
+			}
+			if (bt != 2)
+				for (sb = 1; sb < 32; sb++)
+					for (i = 0; i < 8; i++) {
+						a = spec[sb * 18 - 1 - i];
+						b = spec[sb * 18 + i];
+						spec[sb * 18 - 1 - i] = a * aa_cs[i] + b * aa_ca[i];
+						spec[sb * 18 + i] = b * aa_cs[i] - a * aa_ca[i];
+					}
+			for (i = 0; i < 576; i++)
+				mp3b_xr[ch][g][i] = (int32_t) lrint(spec[i] * (1 << MP3_SYNTH_FRAC));
+			memcpy(prev, cur, sizeof(cur));
+		}
+	}
+}
+
+static int16_t mp3b_pcm(double y)
+{
+	y = floor(y * 32768 + 0.5);
+	return y > 32767 ? 32767 : y < -32768 ? -32768 : (int16_t) y;
+}
+
+/* The standard's decoder, one granule of one channel */
+static void ref_granule(int ch, const int32_t *xq, int bt, int mixed, int16_t *pcm)
+{
+	double x[576], y[36], s[18][32], a, b, v;
+	double *ov, *vb = ref_v[ch];
+	int sb, i, k, w, t, sbt;
+
+	for (i = 0; i < 576; i++)
+		x[i] = xq[i] / (double)(1 << MP3_SYNTH_FRAC);
+	for (sb = 1; sb < (bt != 2 ? 32 : mixed ? 2 : 1); sb++)
+		for (i = 0; i < 8; i++) {
+			a = x[sb * 18 - 1 - i];
+			b = x[sb * 18 + i];
+			x[sb * 18 - 1 - i] = a * aa_cs[i] - b * aa_ca[i];
+			x[sb * 18 + i] = b * aa_cs[i] + a * aa_ca[i];
+		}
+
+	for (sb = 0; sb < 32; sb++) {
+		sbt = mixed && sb < 2 ? 0 : bt;
+		memset(y, 0, sizeof(y));
+		if (sbt == 2) {
+			for (w = 0; w < 3; w++)
+				for (i = 0; i < 12; i++) {
+					v = 0;
+					for (k = 0; k < 6; k++)
+						v += x[sb * 18 + 3 * k + w] * cos_short[k][i];
+					y[6 + 6 * w + i] += v * win_short[i];
+				}
+		} else {
+			for (i = 0; i < 36; i++) {
+				v = 0;
+				for (k = 0; k < 18; k++)
+					v += x[sb * 18 + k] * cos_long[k][i];
+				y[i] = v * win_long[sbt][i];
+			}
+		}
+		ov = ref_overlap[ch][sb];
+		for (i = 0; i < 18; i++) {
+			s[i][sb] = y[i] + ov[i];
+			ov[i] = y[18 + i];
+			if (sb & i & 1)
+				s[i][sb] = -s[i][sb];
+		}
+	}
+
+	for (t = 0; t < 18; t++) {
+		memmove(vb + 64, vb, 960 * sizeof(double));
+		for (i = 0; i < 64; i++) {
+			v = 0;
+			for (k = 0; k < 32; k++)
+				v += mat_n[i][k] * s[t][k];
+			vb[i] = v;
+		}
+		for (k = 0; k < 32; k++) {
+			v = 0;
+			for (i = 0; i < 8; i++)
+				v += vb[128 * i + k] * win_d[64 * i + k] + vb[128 * i + 96 + k] * win_d[64 * i + 32 + k];
+			pcm[(t * 32 + k) * 2] = mp3b_pcm(v);
+		}
+	}
+}
+
+static void mp3b_ref_run(int mixed)
+{
+	int ch, g, bt;
+
+	memset(ref_overlap, 0, sizeof(ref_overlap));
+	memset(ref_v, 0, sizeof(ref_v));
+	for (g = 0; g < MP3B_GRANULES; g++)
+		for (ch = 0; ch < 2; ch++) {
+			bt = mp3b_type[g];
+			ref_granule(ch, mp3b_xr[ch][g], bt, mixed && bt == 2, mp3b_ref + g * MP3_SYNTH_GRANULE * 2 + ch);
+		}
+}
+
+/* the whole stream through mp3_synth, hybrid and filterbank timed apart */
+static void mp3b_fix_run(int mixed, uint64_t *hybrid_ns, uint64_t *poly_ns)
+{
+	static int32_t xr[MP3_SYNTH_GRANULE];
+	uint64_t t0, t1, t2;
+	int ch, g, bt;
+
+	mp3_synth_init(&mp3b_synth);
+	for (g = 0; g < MP3B_GRANULES; g++)
+		for (ch = 0; ch < 2; ch++) {
+			bt = mp3b_type[g];
+			memcpy(xr, mp3b_xr[ch][g], sizeof(xr));
+			t0 = sim_host_ns();
+			mp3_synth_hybrid(&mp3b_synth, ch, xr, bt, mixed && bt == 2);
+			t1 = sim_host_ns();
+			mp3_synth_polyphase(&mp3b_synth, ch, mp3b_out + g * MP3_SYNTH_GRANULE * 2 + ch, 2);
+			t2 = sim_host_ns();
+			*hybrid_ns += t1 - t0;
+			*poly_ns += t2 - t1;
+		}
+}
+
+/* PSNR of the fixed-point output against the reference's */
+static double mp3b_psnr(uint32_t *max_diff)
+{
+	double err = 0;
+	uint32_t i, d;
+
+	*max_diff = 0;
+	for (i = 0; i < MP3B_SAMPLES * 2; i++) {
+		d = abs(mp3b_out[i] - mp3b_ref[i]);
+		err += (double) d * d;
+		if (*max_diff < d)
+			*max_diff = d;
+	}
+	if (err == 0)
+		return 999;
+	return 10 * log10(32767.0 * 32767.0 * MP3B_SAMPLES * 2 / err);
+}
+
+/* SNR of the reference against the source, where the source does not clip */
+static double mp3b_recon_snr(void)
+{
+	double sig = 0, err = 0, s, e;
+	uint32_t i;
+	int ch;
+
+	for (ch = 0; ch < 2; ch++)
+		for (i = MP3B_DELAY + MP3_SYNTH_GRANULE; i < MP3B_SAMPLES; i++) {
+			s = mp3b_src[ch][i - MP3B_DELAY];
+			if (fabs(s) >= 32767.0 / 32768)
+				continue;
+			e = mp3b_ref[i * 2 + ch] / 32768.0 - s;
+			sig += s * s;
+			err += e * e;
+		}
+	return 10 * log10(sig / err);
+}
+
+int sim_bench_mp3(void)
+{
+	uint64_t ref_ns, hybrid_ns = 0, poly_ns = 0, ns;
+	double audio_ns = (double) MP3B_SAMPLES * 1e9 / MP3B_RATE, snr, psnr[2];
+	uint32_t max_diff[2], r;
+	int mixed, ret = 0;
+
+	mp3b_tables();
+	mp3b_signal();
+	mp3b_encode();
+
+	for (mixed = 0; mixed < 2; mixed++) {
+		ref_ns = sim_host_ns();
+		mp3b_ref_run(mixed);
+		ref_ns = sim_host_ns() - ref_ns;
+		if (!mixed) {
+			snr = mp3b_recon_snr();
+			printf("mp3    reference gives the source back at %.1f dB, %.0f ns per frame\n",
+				snr, (double) ref_ns / (MP3B_GRANULES / 2));
+			if (snr < 70)
+				ret = -1;
+		}
+
+		if (!mixed)
+			for (r = 0; r < MP3B_REPEAT; r++)
+				mp3b_fix_run(mixed, &hybrid_ns, &poly_ns);
+		else {
+			ns = 0;
+			mp3b_fix_run(mixed, &ns, &ns);
+		}
+		psnr[mixed] = mp3b_psnr(&max_diff[mixed]);
+		if (psnr[mixed] < 90 || max_diff[mixed] > 2)
+			ret = -1;
+	}
+
+	/* a frame is two granules of both channels, 1152 stereo samples */
+	ns = (hybrid_ns + poly_ns) / MP3B_REPEAT;
+	printf("mp3    fixed point %.0f ns per frame (hybrid %.0f, filterbank %.0f), real-time factor %.5f\n",
+		(double) ns / (MP3B_GRANULES / 2), (double) hybrid_ns / MP3B_REPEAT / (MP3B_GRANULES / 2),
+		(double) poly_ns / MP3B_REPEAT / (MP3B_GRANULES / 2), ns / audio_ns);
+	printf("mp3    PSNR against the reference %.1f dB, max %u LSB; as mixed blocks %.1f dB, max %u LSB\n",
+		psnr[0], max_diff[0], psnr[1], max_diff[1]);
+
+	return ret;
+}
@@ -0,0 +1,217 @@
+/*
+ * Readiness of one socket among many: 1 to 32 UDP sockets on 10.0.0.2 and
+ * one datagram per round to the next of them. Once it has arrived the wait
+ * that finds it and the recv are timed, for
+ *
+ *   select   lwip_select over all the sockets, then the scan of the set
+ *   poll     lwip_poll_wait on a poll set watching all the sockets
+ *
+ * lwip_select checks every socket of the set on each call, lwip_poll_wait
+ * only takes the sockets event_callback queued, so its cost should stay the
+ * same from 1 to 32 sockets.
+ *
+ * Then a poll set is closed while another task waits on it, which must fail
+ * until the wait is over (with EBUSY, where sockets.c sets errno).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/sockets.h"
+
+#include "sim.h"
+
+#define POLL_PORT			5030
+#define POLL_MAX			32
+#define POLL_ROUNDS			500
+#define POLL_SIZE			32
+#define POLL_SETTLE			10		/* ticks until a datagram is queued */
+#define POLL_WAIT_MS		1000
+#define POLL_BUSY_MS		50
+#define POLL_PRIO			(tskIDLE_PRIORITY + 2)
+
+static const int poll_counts[] = { 1, 4, 8, 16, 32 };
+
+static int rx[POLL_MAX];
+static struct sockaddr_in rx_addr[POLL_MAX];
+static SemaphoreHandle_t poll_done;
+static int poll_waited;
+
+static int poll_open(int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		rx[i] = socket(AF_INET, SOCK_DGRAM, 0);
+		if (rx[i] < 0)
+			break;
+		memset(&rx_addr[i], 0, sizeof(rx_addr[i]));
+		rx_addr[i].sin_family = AF_INET;
+		rx_addr[i].sin_port = htons(POLL_PORT + i);
+		rx_addr[i].sin_addr.s_addr = htonl(INADDR_ANY);
+		if (bind(rx[i], (struct sockaddr *) &rx_addr[i], sizeof(rx_addr[i])) < 0) {
+			close(rx[i]);
+			break;
+		}
+		rx_addr[i].sin_addr.s_addr = htonl(SIM_IP(2));
+	}
+	if (i < n) {
+		while (i-- > 0)
+			close(rx[i]);
+		return -1;
+	}
+	return 0;
+}
+
+static void poll_close_all(int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		close(rx[i]);
+}
+
+/* host ns per round of the select loop, -1 if it found the wrong socket */
+static double poll_select(int tx, int n)
+{
+	char buf[POLL_SIZE];
+	fd_set rs;
+	struct timeval tv;
+	uint64_t ns = 0, t;
+	int i, k, fd, maxfd = 0, found;
+
+	for (i = 0; i < n; i++) {
+		if (rx[i] > maxfd)
+			maxfd = rx[i];
+	}
+	memset(buf, 0, sizeof(buf));
+
+	for (i = 0; i < POLL_ROUNDS; i++) {
+		k = i % n;
+		sendto(tx, buf, sizeof(buf), 0, (struct sockaddr *) &rx_addr[k], sizeof(rx_addr[k]));
+		vTaskDelay(POLL_SETTLE);
+
+		t = sim_host_ns();
+		FD_ZERO(&rs);
+		for (fd = 0; fd < n; fd++)
+			FD_SET(rx[fd], &rs);
+		tv.tv_sec = POLL_WAIT_MS / 1000;
+		tv.tv_usec = 0;
+		found = -1;
+		if (select(maxfd + 1, &rs, NULL, NULL, &tv) == 1) {
+			for (fd = 0; fd < n; fd++) {
+				if (FD_ISSET(rx[fd], &rs)) {
+					found = fd;
+					recv(rx[fd], buf, sizeof(buf), 0);
+					break;
+				}
+			}
+		}
+		ns += sim_host_ns() - t;
+
+		if (found != k)
+			return -1;
+	}
+	return (double) ns / POLL_ROUNDS;
+}
+
+static double poll_wait(int tx, int n)
+{
+	char buf[POLL_SIZE];
+	struct lwip_poll_event ev[POLL_MAX];
+	uint64_t ns = 0, t;
+	int i, k, pfd, ok = 1;
+
+	pfd = lwip_poll_create();
+	if (pfd < 0)
+		return -1;
+	for (i = 0; i < n; i++)
+		lwip_poll_ctl(pfd, LWIP_POLL_CTL_ADD, rx[i], LWIP_POLLIN);
+	memset(buf, 0, sizeof(buf));
+
+	for (i = 0; i < POLL_ROUNDS && ok; i++) {
+		k = i % n;
+		sendto(tx, buf, sizeof(buf), 0, (struct sockaddr *) &rx_addr[k], sizeof(rx_addr[k]));
+		vTaskDelay(POLL_SETTLE);
+
+		t = sim_host_ns();
+		if (lwip_poll_wait(pfd, ev, POLL_MAX, POLL_WAIT_MS) != 1 || ev[0].fd != rx[k])
+			ok = 0;
+		else
+			recv(ev[0].fd, buf, sizeof(buf), 0);
+		ns += sim_host_ns() - t;
+	}
+	lwip_poll_close(pfd);
+
+	return ok ? (double) ns / POLL_ROUNDS : -1;
+}
+
+static void poll_waiter_task(void *param)
+{
+	struct lwip_poll_event ev;
+
+	poll_waited = lwip_poll_wait((int)(intptr_t) param, &ev, 1, POLL_BUSY_MS);
+	xSemaphoreGive(poll_done);
+	vTaskDelete(NULL);
+}
+
+/* 0 if a poll set with a waiter cannot be closed and can be once it returns */
+static int poll_busy(void)
+{
+	int pfd, busy, closed;
+
+	pfd = lwip_poll_create();
+	if (pfd < 0)
+		return -1;
+	lwip_poll_ctl(pfd, LWIP_POLL_CTL_ADD, rx[0], LWIP_POLLIN);
+
+	/* the waiter has the higher priority, so it blocks before close */
+	xTaskCreate(poll_waiter_task, (const char *) "poll_wait", 512, (void *)(intptr_t) pfd, POLL_PRIO, NULL);
+	busy = lwip_poll_close(pfd);
+	xSemaphoreTake(poll_done, portMAX_DELAY);
+	closed = lwip_poll_close(pfd);
+
+	printf("poll   close while waiting: %d, wait returned %d, close after: %d\n",
+		busy, poll_waited, closed);
+
+	return (busy == -1 && poll_waited == 0 && closed == 0) ? 0 : -1;
+}
+
+int sim_bench_poll(void)
+{
+	unsigned c;
+	int tx, n, ret = 0;
+	double sel, pol;
+
+	if (poll_done == NULL)
+		poll_done = xSemaphoreCreateBinary();
+
+	tx = socket(AF_INET, SOCK_DGRAM, 0);
+	if (tx < 0 || poll_open(POLL_MAX) < 0) {
+		printf("poll   no sockets\n");
+		if (tx >= 0)
+			close(tx);
+		return -1;
+	}
+
+	for (c = 0; c < sizeof(poll_counts) / sizeof(poll_counts[0]); c++) {
+		n = poll_counts[c];
+		sel = poll_select(tx, n);
+		pol = poll_wait(tx, n);
+		printf("poll   %2d sockets: select %.0f ns, poll_wait %.0f ns per ready socket\n", n, sel, pol);
+		if (sel < 0 || pol < 0)
+			ret = -1;
+	}
+
+	if (poll_busy() < 0)
+		ret = -1;
+
+	poll_close_all(POLL_MAX);
+	close(tx);
+
+	return ret;
+}
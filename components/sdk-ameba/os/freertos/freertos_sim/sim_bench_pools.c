@@ -0,0 +1,186 @@
+/*
+ * lwIP pools under bursts: a random workload against the real memp.c and
+ * mem.c, next to the running stack.
+ *
+ *   rx    WLAN receive bursts, 3 PBUF_POOL buffers per 1500 byte frame,
+ *         held until the application has read them
+ *   tx    application write bursts, a TCP segment and its MSS sized heap
+ *         pbuf per segment, held until they are acknowledged
+ *
+ * Bursts come in POOLS_BUSY_TICKS phases separated by POOLS_IDLE_TICKS of
+ * quiet, in which MEMP_ELASTIC pools give back what they borrowed. For each
+ * kind the allocations that failed are counted. Peak RAM is the static
+ * memory of the three pools (PBUF_POOL, TCP_SEG, the heap) plus the most
+ * the pools held from the reserve at once; held is what they still held
+ * after the last quiet phase.
+ *
+ * make VARIANT=noelastic builds the same sizes without the reserve,
+ * make VARIANT=fixedbig static pools about as large as sizes + reserve.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/memp.h"
+#include "lwip/mem.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp_impl.h"
+
+#include "sim.h"
+
+#define POOLS_ROUNDS		4
+#define POOLS_BUSY_TICKS	2000
+#define POOLS_IDLE_TICKS	(3 * MEMP_ELASTIC_TMR_INTERVAL)
+#define POOLS_ITEMS			256		/* held allocations */
+
+#define POOLS_RX_PBUFS		3		/* PBUF_POOL buffers per frame */
+#define POOLS_RX_EVERY		8		/* ticks between bursts, on average */
+#define POOLS_RX_BURST		6		/* frames, at most */
+#define POOLS_RX_HOLD		8		/* ticks, at most */
+#define POOLS_TX_EVERY		20
+#define POOLS_TX_BURST		6		/* segments, at most */
+#define POOLS_TX_HOLD		15
+#define POOLS_TX_SIZE		(TCP_MSS + 54)
+
+#if MEMP_ELASTIC
+#define POOLS_HELD()		memp_elastic_held()
+#else
+#define POOLS_HELD()		0
+#endif
+
+#define POOLS_STATIC		(PBUF_POOL_SIZE * (LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf)) + LWIP_MEM_ALIGN_SIZE(PBUF_POOL_BUFSIZE)) + \
+							 MEMP_NUM_TCP_SEG * LWIP_MEM_ALIGN_SIZE(sizeof(struct tcp_seg)) + MEM_SIZE)
+
+typedef struct {
+	void *ptr;
+	void *heap;				/* tx: the segment's pbuf */
+	int rx;
+	TickType_t due;
+} pools_item;
+
+typedef struct {
+	uint32_t tries;
+	uint32_t drops;
+} pools_count;
+
+static pools_item items[POOLS_ITEMS];
+static uint32_t pools_rnd = 4321;
+
+static uint32_t pools_random(uint32_t n)
+{
+	pools_rnd = pools_rnd * 1103515245 + 12345;
+	return (pools_rnd >> 16) % n;
+}
+
+static pools_item *pools_slot(void)
+{
+	int i;
+
+	for (i = 0; i < POOLS_ITEMS; i++) {
+		if (items[i].ptr == NULL)
+			return &items[i];
+	}
+	return NULL;
+}
+
+static void pools_release(pools_item *it)
+{
+	if (it->rx) {
+		memp_free(MEMP_PBUF_POOL, it->ptr);
+	} else {
+		mem_free(it->heap);
+		memp_free(MEMP_TCP_SEG, it->ptr);
+	}
+	it->ptr = NULL;
+}
+
+static void pools_rx_frame(pools_count *c, TickType_t due)
+{
+	pools_item *it;
+	int i;
+
+	c->tries++;
+	for (i = 0; i < POOLS_RX_PBUFS; i++) {
+		it = pools_slot();
+		if (it == NULL || (it->ptr = memp_malloc(MEMP_PBUF_POOL)) == NULL) {
+			c->drops++;
+			break;
+		}
+		it->rx = 1;
+		it->due = due;
+	}
+}
+
+static void pools_tx_segment(pools_count *seg, pools_count *heap, TickType_t due)
+{
+	pools_item *it = pools_slot();
+
+	if (it == NULL)
+		return;
+	seg->tries++;
+	it->ptr = memp_malloc(MEMP_TCP_SEG);
+	if (it->ptr == NULL) {
+		seg->drops++;
+		return;
+	}
+	heap->tries++;
+	it->heap = mem_malloc(POOLS_TX_SIZE);
+	if (it->heap == NULL) {
+		heap->drops++;
+		memp_free(MEMP_TCP_SEG, it->ptr);
+		it->ptr = NULL;
+		return;
+	}
+	it->rx = 0;
+	it->due = due;
+}
+
+int sim_bench_pools(void)
+{
+	pools_count rx = { 0, 0 }, seg = { 0, 0 }, heap = { 0, 0 };
+	uint32_t peak = 0, held;
+	TickType_t t, end;
+	uint32_t round, n;
+	int i;
+
+	memset(items, 0, sizeof(items));
+	vTaskDelay(POOLS_IDLE_TICKS);
+
+	for (round = 0; round < POOLS_ROUNDS; round++) {
+		end = xTaskGetTickCount() + POOLS_BUSY_TICKS;
+		while ((t = xTaskGetTickCount()) != end) {
+			for (i = 0; i < POOLS_ITEMS; i++) {
+				if (items[i].ptr && (int32_t)(t - items[i].due) >= 0)
+					pools_release(&items[i]);
+			}
+			if (pools_random(POOLS_RX_EVERY) == 0) {
+				for (n = 1 + pools_random(POOLS_RX_BURST); n > 0; n--)
+					pools_rx_frame(&rx, t + 1 + pools_random(POOLS_RX_HOLD));
+			}
+			if (pools_random(POOLS_TX_EVERY) == 0) {
+				for (n = 1 + pools_random(POOLS_TX_BURST); n > 0; n--)
+					pools_tx_segment(&seg, &heap, t + 1 + pools_random(POOLS_TX_HOLD));
+			}
+			held = POOLS_HELD();
+			if (held > peak)
+				peak = held;
+			vTaskDelay(1);
+		}
+		for (i = 0; i < POOLS_ITEMS; i++) {
+			if (items[i].ptr)
+				pools_release(&items[i]);
+		}
+		vTaskDelay(POOLS_IDLE_TICKS);
+	}
+
+	printf("pools  rx %u/%u frames dropped (%.2f%%), tx %u/%u segments, %u/%u heap pbufs dropped, elastic %s\n",
+		rx.drops, rx.tries, 100.0 * rx.drops / (rx.tries ? rx.tries : 1),
+		seg.drops, seg.tries, heap.drops, heap.tries, MEMP_ELASTIC ? "on" : "off");
+	printf("pools  peak RAM %u bytes (%u static, %u borrowed), %u held when idle\n",
+		(unsigned)(POOLS_STATIC + peak), (unsigned) POOLS_STATIC, peak, (unsigned) POOLS_HELD());
+
+	return 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * RTCP driven rate control over a congested wire. A modelled H.264 encoder
+ * on 10.0.0.1 sends 30 fps at up to 4 Mbit/s, an I frame every second and
+ * every other P frame not used for reference. The receiver on 10.0.0.2
+ * measures each frame from capture to its last packet and sends a receiver
+ * report every RATE_RR_MS, back to the port the stream comes from to save
+ * a UDP PCB. The wire carries 8 Mbit/s, then 2 Mbit/s from
+ * 2 s to 8 s, then 8 Mbit/s again. The first second at 2 Mbit/s is when
+ * the controller catches up, the rest is how it holds.
+ *
+ *   fixed      reports are ignored, the queue in front of the receiver
+ *              grows until the wire drops frames
+ *   adaptive   rtp_rate from the reports sets bitrate and frame rate and
+ *              drops non-reference frames while congested
+ *
+ * Latency is in virtual ticks (ms), so it is the same on every run.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/sockets.h"
+
+#include "rtp_pack.h"
+#include "rtcp_rr.h"
+#include "rtp_rate.h"
+#include "h264/h264_nal.h"
+
+#include "sim.h"
+
+#define RATE_PORT			5020
+#define RATE_PT				96
+#define RATE_PRIO			(configMAX_PRIORITIES - 1)
+#define RATE_RUN_MS			12000
+#define RATE_CONGESTED_MS	2000
+#define RATE_STEADY_MS		3000
+#define RATE_RECOVERED_MS	8000
+#define RATE_LINK_FAST		1000	/* bytes per tick, 8 Mbit/s */
+#define RATE_LINK_SLOW		250		/* 2 Mbit/s */
+#define RATE_MAX_BITRATE	4000000
+#define RATE_MIN_BITRATE	250000
+#define RATE_MAX_FPS		30
+#define RATE_MIN_FPS		5
+#define RATE_RR_MS			500
+#define RATE_CLOCK			90000
+#define RATE_MAX_FRAME		(RATE_MAX_BITRATE / 8 * 4 / (RATE_MIN_FPS + 3) + 64)
+#define RATE_PHASES			4
+#define RATE_PHASE_STEADY	2
+#define RATE_MAX_FRAMES		(RATE_RUN_MS * RATE_MAX_FPS / 1000 + 1)
+
+typedef struct {
+	int s;
+	struct sockaddr_in to;
+} rate_sender;
+
+/* frame latencies of the run by phase, filled in by the receiver */
+typedef struct {
+	uint32_t ssrc;
+	uint32_t lat[RATE_PHASES][RATE_MAX_FRAMES];
+	uint32_t frames[RATE_PHASES];
+	uint32_t reports;
+} rate_rx_stats;
+
+static rate_rx_stats rx_stats;
+static uint8_t frame[RATE_MAX_FRAME];
+static TaskHandle_t rate_rx;
+static TickType_t run_start;		/* RTP timestamps count from here */
+
+static int rate_phase(uint32_t ms)
+{
+	return ms < RATE_CONGESTED_MS ? 0 : ms < RATE_STEADY_MS ? 1 : ms < RATE_RECOVERED_MS ? 2 : 3;
+}
+
+static void rate_rx_task(void *param)
+{
+	struct sockaddr_in addr, from;
+	socklen_t from_len;
+	uint8_t pkt[RTP_PACK_MTU], rr[RTCP_RR_LEN];
+	rtcp_rx_t rx;
+	uint32_t ssrc, ts, now, capture, last_rr = 0, cur_ts = 0;
+	uint16_t seq, last_seq = 0;
+	int s, n, broken = 0, phase;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(RATE_PORT);
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+	rtcp_rx_init(&rx);
+
+	for (;;) {
+		from_len = sizeof(from);
+		n = recvfrom(s, pkt, sizeof(pkt), 0, (struct sockaddr *) &from, &from_len);
+		if (n <= 12 || (pkt[0] & 0xc0) != 0x80 || (pkt[1] & 0x7f) != RATE_PT)
+			continue;
+		now = xTaskGetTickCount();
+		seq = (pkt[2] << 8) | pkt[3];
+		ts = ((uint32_t) pkt[4] << 24) | (pkt[5] << 16) | (pkt[6] << 8) | pkt[7];
+		ssrc = ((uint32_t) pkt[8] << 24) | (pkt[9] << 16) | (pkt[10] << 8) | pkt[11];
+
+		if (ssrc != rx.ssrc || !rx.started) {
+			/* a new run */
+			rtcp_rx_init(&rx);
+			memset(rx_stats.frames, 0, sizeof(rx_stats.frames));
+			rx_stats.reports = 0;
+			rx_stats.ssrc = ssrc;
+			last_rr = now;
+			cur_ts = ts - 1;
+			last_seq = seq - 1;
+		}
+		rtcp_rx_update(&rx, ssrc, seq, ts, now * (RATE_CLOCK / configTICK_RATE_HZ));
+
+		/* a frame with a gap before or inside it is not decodable */
+		if (ts != cur_ts) {
+			cur_ts = ts;
+			broken = 0;
+		}
+		if (seq != (uint16_t)(last_seq + 1))
+			broken = 1;
+		last_seq = seq;
+
+		if ((pkt[1] & 0x80) && !broken) {
+			capture = ts / (RATE_CLOCK / configTICK_RATE_HZ);
+			phase = rate_phase(capture);
+			if (rx_stats.frames[phase] < RATE_MAX_FRAMES)
+				rx_stats.lat[phase][rx_stats.frames[phase]++] = now - run_start - capture;
+		}
+
+		if (now - last_rr >= RATE_RR_MS) {
+			n = rtcp_rx_build_rr(&rx, 0x5252, rr, sizeof(rr));
+			if (n > 0 && sendto(s, rr, n, 0, (struct sockaddr *) &from, sizeof(from)) == n)
+				rx_stats.reports++;
+			last_rr = now;
+		}
+	}
+}
+
+static int rate_send(void *arg, const rtp_iov_t *iov, int iovcnt)
+{
+	rate_sender *tx = (rate_sender *) arg;
+	struct lwip_iovec v[RTP_PACK_IOV_MAX];
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		v[i].iov_base = iov[i].base;
+		v[i].iov_len = iov[i].len;
+	}
+	return lwip_sendtov(tx->s, v, iovcnt, 0, (struct sockaddr *) &tx->to, sizeof(tx->to)) < 0 ? -1 : 0;
+}
+
+static uint32_t put_nal(uint8_t *p, uint8_t hdr, uint32_t len)
+{
+	p[0] = 0;
+	p[1] = 0;
+	p[2] = 0;
+	p[3] = 1;
+	p[4] = hdr;
+	memset(p + 5, 0x88, len - 1);	/* no start code inside */
+	return 4 + len;
+}
+
+/* frame n of the GOP at bitrate and fps: I is four P frames, odd P frames
+   are not referenced */
+static uint32_t make_frame(uint32_t n, uint32_t bitrate, uint32_t fps)
+{
+	uint32_t p = bitrate / 8 / (fps + 3), len;
+
+	if (p < 64)
+		p = 64;
+	if (n == 0) {
+		len = put_nal(frame, 0x67, 12);
+		len += put_nal(frame + len, 0x68, 4);
+		return len + put_nal(frame + len, 0x65, 4 * p);
+	}
+	return put_nal(frame, (n & 1) ? 0x01 : 0x41, p);
+}
+
+static uint32_t pct(uint32_t *v, uint32_t n, uint32_t p)
+{
+	return n ? v[(n - 1) * p / 100] : 0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* return the p95 latency of the steady congested phase, or ~0 if frames
+   were lost in it */
+static uint32_t rate_run(int adaptive, uint32_t ssrc)
+{
+	static const char *phase_name[RATE_PHASES] = { "8 Mbit/s", "2 Mbit/s onset", "2 Mbit/s", "8 Mbit/s" };
+	uint32_t sent[RATE_PHASES] = { 0 }, skipped = 0, bitrate = RATE_MAX_BITRATE, fps = RATE_MAX_FPS;
+	uint32_t now, start, n = 0, len, link, p95 = 0;
+	rate_sender tx;
+	rtp_pack_t pk;
+	rtp_rate_t rc;
+	rtcp_report_t rb;
+	h264_au_t au;
+	TickType_t wake;
+	uint8_t buf[64];
+	int i, got, phase;
+
+	tx.s = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&tx.to, 0, sizeof(tx.to));
+	tx.to.sin_family = AF_INET;
+	tx.to.sin_port = htons(RATE_PORT);
+	tx.to.sin_addr.s_addr = htonl(SIM_IP(2));
+
+	rtp_pack_init(&pk, RATE_PT, ssrc, 0, rate_send, &tx);
+	rtp_rate_init(&rc, RATE_MIN_BITRATE, RATE_MAX_BITRATE, RATE_MIN_FPS, RATE_MAX_FPS);
+	link = sim_netif_set_rate(RATE_LINK_FAST);
+
+	run_start = start = wake = xTaskGetTickCount();
+	for (now = 0; now < RATE_RUN_MS; now = xTaskGetTickCount() - start) {
+		if (now >= RATE_CONGESTED_MS && now < RATE_RECOVERED_MS)
+			sim_netif_set_rate(RATE_LINK_SLOW);
+		else
+			sim_netif_set_rate(RATE_LINK_FAST);
+
+		while ((got = recv(tx.s, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+			if (!adaptive || rtcp_find_report(buf, got, ssrc, &rb) != 1)
+				continue;
+			if (rtp_rate_report(&rc, &rb, pk.seq, pk.bytes, RATE_CLOCK, now)) {
+				bitrate = rc.bitrate;
+				fps = rc.fps;
+			}
+		}
+
+		/* a GOP is a second */
+		len = make_frame(n % fps, bitrate, fps);
+		n++;
+		h264_au_index(frame, frame + len, &au);
+		phase = rate_phase(now);
+		if (adaptive && rc.drop && !au.ref)
+			skipped++;
+		else if (rtp_pack_h264(&pk, &au, now * (RATE_CLOCK / configTICK_RATE_HZ), 1) >= 0)
+			sent[phase]++;
+
+		vTaskDelayUntil(&wake, configTICK_RATE_HZ / fps);
+	}
+	/* let the queue drain */
+	vTaskDelay(2000);
+	sim_netif_set_rate(link);
+	close(tx.s);
+
+	for (i = 0; i < RATE_PHASES; i++) {
+		qsort(rx_stats.lat[i], rx_stats.frames[i], sizeof(uint32_t), cmp_u32);
+		printf("rate   %-8s %-14s %3u of %3u frames, latency p50 %4u p95 %4u max %4u ms\n",
+			adaptive ? "adaptive" : "fixed", phase_name[i], rx_stats.frames[i], sent[i],
+			pct(rx_stats.lat[i], rx_stats.frames[i], 50), pct(rx_stats.lat[i], rx_stats.frames[i], 95),
+			pct(rx_stats.lat[i], rx_stats.frames[i], 100));
+		if (i == RATE_PHASE_STEADY)
+			p95 = (rx_stats.frames[i] < sent[i]) ? ~0u : pct(rx_stats.lat[i], rx_stats.frames[i], 95);
+	}
+	if (adaptive)
+		printf("rate   adaptive: %u reports, %u cuts, %u frames dropped, ends at %u kbit/s %u fps\n",
+			rx_stats.reports, rc.cuts, skipped, rc.bitrate / 1000, rc.fps);
+	return p95;
+}
+
+/* resolve ARP both ways before the first frame */
+static void rate_warm_up(void)
+{
+	struct sockaddr_in to;
+	int s = socket(AF_INET, SOCK_DGRAM, 0);
+
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_port = htons(RATE_PORT);
+	to.sin_addr.s_addr = htonl(SIM_IP(2));
+	sendto(s, "", 1, 0, (struct sockaddr *) &to, sizeof(to));
+	vTaskDelay(configTICK_RATE_HZ / 2);
+	close(s);
+}
+
+int sim_bench_rate(void)
+{
+	uint32_t fixed, adaptive;
+
+	if (rate_rx == NULL) {
+		xTaskCreate(rate_rx_task, (const char *) "rate_rx", 1024, NULL, RATE_PRIO, &rate_rx);
+		rate_warm_up();
+	}
+
+	fixed = rate_run(0, 0x1111);
+	adaptive = rate_run(1, 0x2222);
+
+	/* the adaptive stream loses nothing and stays well below the wire queue */
+	return (adaptive != ~0u && adaptive * 4 < fixed) ? 0 : -1;
+}
@@ -0,0 +1,593 @@
+/*
+ * RTP H.264 over UDP from 10.0.0.1 to a receiver on 10.0.0.2, 720p sized
+ * access units (a 48 KB IDR frame, then 9 KB P frames, about 2 Mbit/s at
+ * 30 fps), packetized by rtp_pack_h264() and sent two ways:
+ *
+ *   copy   header and payload copied into one buffer per packet, sendto()
+ *          (what the rtsp library does)
+ *   iov    lwip_sendtov() with the RTP/FU headers and slices of the frame
+ *
+ * The receiver reassembles the NALs and compares them with the frame. Host
+ * time is only taken around the sends, so packets/s is the packetizer and
+ * the stack down to the driver, which copies every frame in both cases. The
+ * fastest GOP counts, the host threads of the port make single ones noisy.
+ *
+ * The JPEG and AAC packetizers are checked without the network.
+ *
+ * fanout: the same stream to 1 to 4 viewers on 10.0.0.2, either packetized
+ * for each viewer with copies (one rtsp context per viewer) or once with
+ * rtp_fanout. The viewers share a port and are told apart by SSRC, UDP PCBs
+ * are scarce. The host time per frame over the viewer count is the cost of
+ * an added viewer. Slow consumer handling is checked without the network.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/sockets.h"
+
+#include "rtp_pack.h"
+#include "rtp_fanout.h"
+
+#include "sim.h"
+
+#define RTP_PORT			5004
+#define RTP_FRAMES			300
+#define RTP_GOP				30
+#define RTP_KEY_SIZE		48000
+#define RTP_P_SIZE			9000
+#define RTP_PT				96
+#define RTP_PRIO			(configMAX_PRIORITIES - 2)	/* drains the socket as packets arrive */
+#define RTP_TIMEOUT			(configTICK_RATE_HZ / 2)
+
+#define FAN_PORT			5010
+#define FAN_VIEWERS			4
+#define FAN_FRAMES			90
+#define FAN_SSRC(v)			(0x1000 + (v))
+/* above the tcpip thread: lwIP has two netbufs, datagrams queued on the
+   socket would use them up during SPS/PPS bursts */
+#define FAN_PRIO			(configMAX_PRIORITIES - 1)
+
+typedef struct {
+	int s;
+	struct sockaddr_in to;
+	uint32_t copied;		/* bytes memcpy'd by the send callback */
+	uint8_t buf[RTP_PACK_MTU];
+} rtp_sender;
+
+static uint8_t key_au[RTP_KEY_SIZE + 64];
+static uint8_t p_au[RTP_P_SIZE + 64];
+static uint32_t key_len, p_len;
+
+/* receiver: NAL payloads of the current frame back to back */
+static uint8_t rx_nals[RTP_KEY_SIZE + 64];
+static uint32_t rx_len, rx_num_nal, rx_packets, rx_seq_err;
+static uint16_t rx_seq;
+static int rx_started;
+static SemaphoreHandle_t rx_frame;
+
+static uint32_t rtp_rand(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 16;
+}
+
+/* Annex B NAL with a 4 byte start code, no zero bytes in the payload */
+static uint32_t put_nal(uint8_t *p, uint8_t hdr, uint32_t len, uint32_t *seed)
+{
+	uint32_t i;
+
+	p[0] = 0;
+	p[1] = 0;
+	p[2] = 0;
+	p[3] = 1;
+	p[4] = hdr;
+	p[5] = 0x88;		/* first_mb_in_slice 0 for slices */
+	for (i = 2; i < len; i++)
+		p[4 + i] = 1 + rtp_rand(seed) % 255;
+	return 4 + len;
+}
+
+static void make_frames(void)
+{
+	uint32_t seed = 3;
+
+	key_len = put_nal(key_au, 0x67, 12, &seed);			/* SPS */
+	key_len += put_nal(key_au + key_len, 0x68, 4, &seed);	/* PPS */
+	key_len += put_nal(key_au + key_len, 0x65, RTP_KEY_SIZE, &seed);
+	p_len = put_nal(p_au, 0x41, RTP_P_SIZE, &seed);
+}
+
+static void rtp_rx_task(void *param)
+{
+	struct sockaddr_in addr;
+	uint8_t pkt[RTP_PACK_MTU];
+	uint16_t seq;
+	int s, n;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(RTP_PORT);
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+
+	for (;;) {
+		n = recv(s, pkt, sizeof(pkt), 0);
+		if (n <= 12 || (pkt[0] & 0xc0) != 0x80 || (pkt[1] & 0x7f) != RTP_PT)
+			continue;
+		rx_packets++;
+		seq = (pkt[2] << 8) | pkt[3];
+		if (rx_started && seq != (uint16_t)(rx_seq + 1))
+			rx_seq_err++;
+		rx_seq = seq;
+		rx_started = 1;
+
+		if ((pkt[12] & 0x1f) == 28) {
+			/* FU-A: rebuild the NAL header on the start fragment */
+			if (pkt[13] & 0x80) {
+				rx_nals[rx_len++] = (pkt[12] & 0xe0) | (pkt[13] & 0x1f);
+				rx_num_nal++;
+			}
+			if (rx_len + n - 14 <= sizeof(rx_nals)) {
+				memcpy(rx_nals + rx_len, pkt + 14, n - 14);
+				rx_len += n - 14;
+			}
+		} else if (rx_len + n - 12 <= sizeof(rx_nals)) {
+			memcpy(rx_nals + rx_len, pkt + 12, n - 12);
+			rx_len += n - 12;
+			rx_num_nal++;
+		}
+
+		if (pkt[1] & 0x80)
+			xSemaphoreGive(rx_frame);
+	}
+}
+
+static int send_copy(void *arg, const rtp_iov_t *iov, int iovcnt)
+{
+	rtp_sender *tx = (rtp_sender *) arg;
+	uint32_t len = 0;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		memcpy(tx->buf + len, iov[i].base, iov[i].len);
+		len += iov[i].len;
+	}
+	tx->copied += len;
+	return sendto(tx->s, tx->buf, len, 0, (struct sockaddr *) &tx->to, sizeof(tx->to)) < 0 ? -1 : 0;
+}
+
+static int send_iov(void *arg, const rtp_iov_t *iov, int iovcnt)
+{
+	rtp_sender *tx = (rtp_sender *) arg;
+	struct lwip_iovec v[RTP_PACK_IOV_MAX];
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		v[i].iov_base = iov[i].base;
+		v[i].iov_len = iov[i].len;
+	}
+	return lwip_sendtov(tx->s, v, iovcnt, 0, (struct sockaddr *) &tx->to, sizeof(tx->to)) < 0 ? -1 : 0;
+}
+
+/* the frame's NALs without start codes, as the receiver rebuilds them */
+static int rx_matches(const h264_au_t *au)
+{
+	uint32_t i, off = 0;
+
+	if (rx_num_nal != (uint32_t) au->num_nal)
+		return 0;
+	for (i = 0; i < (uint32_t) au->num_nal; i++) {
+		if (off + au->nal[i].len > rx_len ||
+			memcmp(rx_nals + off, au->data + au->nal[i].offset, au->nal[i].len) != 0)
+			return 0;
+		off += au->nal[i].len;
+	}
+	return off == rx_len;
+}
+
+static int rtp_run(const char *name, rtp_pack_send_t send)
+{
+	rtp_sender tx;
+	rtp_pack_t pk;
+	h264_au_t key, p;
+	const h264_au_t *au;
+	uint32_t i, bad = 0, lost = 0, gop_packets = 0;
+	uint64_t ns = 0, best = ~0ULL, t;
+	TickType_t start;
+
+	memset(&tx, 0, sizeof(tx));
+	tx.s = socket(AF_INET, SOCK_DGRAM, 0);
+	tx.to.sin_family = AF_INET;
+	tx.to.sin_port = htons(RTP_PORT);
+	tx.to.sin_addr.s_addr = htonl(SIM_IP(2));
+
+	h264_au_index(key_au, key_au + key_len, &key);
+	h264_au_index(p_au, p_au + p_len, &p);
+
+	rtp_pack_init(&pk, RTP_PT, 0x12345678, 0, send, &tx);
+	rx_started = 0;
+	rx_packets = 0;
+	rx_seq_err = 0;
+	xSemaphoreTake(rx_frame, 0);
+	sim_netif_reset_stats();
+
+	start = xTaskGetTickCount();
+	for (i = 0; i < RTP_FRAMES; i++) {
+		if (i % RTP_GOP == 0) {
+			if (i && ns < best)
+				best = ns;
+			ns = 0;
+		}
+		au = (i % RTP_GOP == 0) ? &key : &p;
+		rx_len = 0;
+		rx_num_nal = 0;
+
+		t = sim_host_ns();
+		if (rtp_pack_h264(&pk, au, i * 3000, 1) < 0)
+			bad++;
+		ns += sim_host_ns() - t;
+
+		if (xSemaphoreTake(rx_frame, RTP_TIMEOUT) != pdTRUE) {
+			lost++;
+			continue;
+		}
+		if (!rx_matches(au))
+			bad++;
+	}
+	close(tx.s);
+	if (ns < best)
+		best = ns;
+	gop_packets = pk.packets / (RTP_FRAMES / RTP_GOP);
+
+	printf("rtp    %-4s %u frames in %u ticks, %u packets (%u received, %u out of order), %u lost, %u bad\n",
+		name, RTP_FRAMES, (unsigned)(xTaskGetTickCount() - start), pk.packets, rx_packets, rx_seq_err, lost, bad);
+	printf("rtp    %-4s %.0f packets/s, %.0f ns per packet, %u bytes per frame, %u copied per frame\n",
+		name, gop_packets * 1e9 / (best ? best : 1), (double) best / (gop_packets ? gop_packets : 1),
+		pk.bytes / RTP_FRAMES, (pk.hdr_bytes + tx.copied) / RTP_FRAMES);
+
+	return (bad || lost || rx_seq_err || rx_packets != pk.packets) ? -1 : 0;
+}
+
+/*
+ * JPEG: SOI, DQT with both tables, SOF0 4:2:0 1280x720, DRI, SOS, scan, EOI.
+ */
+typedef struct {
+	uint8_t out[8192];
+	uint32_t len;
+	uint32_t packets;
+	uint32_t markers;
+	uint8_t last[64];		/* payload header of the last packet */
+} rtp_capture;
+
+static int send_capture(void *arg, const rtp_iov_t *iov, int iovcnt)
+{
+	rtp_capture *c = (rtp_capture *) arg;
+	uint32_t hlen = iov[0].len;
+	int i;
+
+	memcpy(c->last, iov[0].base, hlen);
+	c->markers += (c->last[1] & 0x80) != 0;
+	c->packets++;
+	for (i = 1; i < iovcnt; i++) {
+		memcpy(c->out + c->len, iov[i].base, iov[i].len);
+		c->len += iov[i].len;
+	}
+	return 0;
+}
+
+static int check_jpeg_aac(void)
+{
+	static uint8_t jpg[4096], aac[1800];
+	static rtp_capture c;
+	rtp_pack_t pk;
+	uint32_t n = 0, i, scan, seed = 9, scan_len = 3000, aac_len = 1600;
+	int fail = 0;
+
+	jpg[n++] = 0xff; jpg[n++] = 0xd8;
+	jpg[n++] = 0xff; jpg[n++] = 0xdb; jpg[n++] = 0; jpg[n++] = 2 + 2 * 65;
+	for (i = 0; i < 2; i++) {
+		jpg[n++] = i;
+		memset(jpg + n, 16 + i, 64);
+		n += 64;
+	}
+	jpg[n++] = 0xff; jpg[n++] = 0xc0; jpg[n++] = 0; jpg[n++] = 17; jpg[n++] = 8;
+	jpg[n++] = 720 >> 8; jpg[n++] = 720 & 0xff; jpg[n++] = 1280 >> 8; jpg[n++] = 1280 & 0xff;
+	jpg[n++] = 3;
+	jpg[n++] = 1; jpg[n++] = 0x22; jpg[n++] = 0;
+	jpg[n++] = 2; jpg[n++] = 0x11; jpg[n++] = 1;
+	jpg[n++] = 3; jpg[n++] = 0x11; jpg[n++] = 1;
+	jpg[n++] = 0xff; jpg[n++] = 0xdd; jpg[n++] = 0; jpg[n++] = 4; jpg[n++] = 0; jpg[n++] = 80;
+	jpg[n++] = 0xff; jpg[n++] = 0xda; jpg[n++] = 0; jpg[n++] = 12;
+	memset(jpg + n, 0, 10);
+	n += 10;
+	scan = n;
+	for (i = 0; i < scan_len; i++)
+		jpg[n++] = rtp_rand(&seed);
+	jpg[n++] = 0xff; jpg[n++] = 0xd9;
+
+	memset(&c, 0, sizeof(c));
+	rtp_pack_init(&pk, 26, 1, 0, send_capture, &c);
+	fail |= rtp_pack_jpeg(&pk, jpg, n, 0) != 3;
+	/* tables, then the scan without EOI */
+	fail |= c.len != 128 + scan_len || c.out[0] != 16 || c.out[64] != 17 ||
+		memcmp(c.out + 128, jpg + scan, scan_len) != 0;
+	/* type 1 + restart, 160x90 blocks, offset of the last fragment */
+	fail |= c.markers != 1 || c.last[16] != 65 || c.last[17] != 255 || c.last[18] != 160 || c.last[19] != 90;
+	fail |= ((c.last[13] << 16) | (c.last[14] << 8) | c.last[15]) != (RTP_PACK_MTU - 28 - 128) + (RTP_PACK_MTU - 24);
+
+	/* AAC: ADTS header skipped, two fragments with the whole AU size */
+	aac[0] = 0xff; aac[1] = 0xf1;
+	for (i = 7; i < aac_len + 7; i++)
+		aac[i] = rtp_rand(&seed);
+	memset(&c, 0, sizeof(c));
+	rtp_pack_init(&pk, 97, 1, 0, send_capture, &c);
+	fail |= rtp_pack_aac(&pk, aac, aac_len + 7, 0) != 2;
+	fail |= c.len != aac_len || memcmp(c.out, aac + 7, aac_len) != 0 || c.markers != 1;
+	fail |= c.last[12] != 0 || c.last[13] != 16 || ((c.last[14] << 5) | (c.last[15] >> 3)) != aac_len;
+
+	printf("rtp    jpeg and aac packetizers %s\n", fail ? "MISMATCH" : "ok");
+	return fail;
+}
+
+/* resolve ARP before the first frame, etharp would hold it back and then
+   hand the whole burst to the receiver at once */
+static void rtp_warm_up(void)
+{
+	struct sockaddr_in to;
+	int s = socket(AF_INET, SOCK_DGRAM, 0);
+
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_port = htons(RTP_PORT);
+	to.sin_addr.s_addr = htonl(SIM_IP(2));
+	sendto(s, "", 1, 0, (struct sockaddr *) &to, sizeof(to));
+	vTaskDelay(RTP_TIMEOUT);
+	close(s);
+}
+
+int sim_bench_rtp(void)
+{
+	int fail = 0;
+
+	make_frames();
+	if (rx_frame == NULL) {
+		rx_frame = xSemaphoreCreateBinary();
+		xTaskCreate(rtp_rx_task, (const char *) "rtp_rx", 1024, NULL, RTP_PRIO, NULL);
+	}
+
+	rtp_warm_up();
+	fail |= rtp_run("copy", send_copy);
+	fail |= rtp_run("iov", send_iov);
+	fail |= check_jpeg_aac();
+
+	return fail ? -1 : 0;
+}
+
+/*
+ * Fan-out
+ */
+typedef struct {
+	uint32_t packets;
+	uint32_t seq_err;
+	uint16_t seq;
+	int started;
+} fan_viewer;
+
+static fan_viewer viewers[FAN_VIEWERS];
+static uint32_t fan_ssrc_err;
+static SemaphoreHandle_t fan_frame;
+
+static void fan_rx_task(void *param)
+{
+	fan_viewer *vw;
+	struct sockaddr_in addr;
+	uint8_t pkt[RTP_PACK_MTU];
+	uint32_t ssrc;
+	uint16_t seq;
+	int s, n;
+
+	(void) param;
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(FAN_PORT);
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+
+	for (;;) {
+		n = recv(s, pkt, sizeof(pkt), 0);
+		if (n <= 12 || (pkt[0] & 0xc0) != 0x80)
+			continue;
+		ssrc = ((uint32_t) pkt[8] << 24) | (pkt[9] << 16) | (pkt[10] << 8) | pkt[11];
+		if (ssrc - FAN_SSRC(0) >= FAN_VIEWERS) {
+			fan_ssrc_err++;
+			continue;
+		}
+		vw = &viewers[ssrc - FAN_SSRC(0)];
+		vw->packets++;
+		seq = (pkt[2] << 8) | pkt[3];
+		if (vw->started && seq != (uint16_t)(vw->seq + 1))
+			vw->seq_err++;
+		vw->seq = seq;
+		vw->started = 1;
+		if (pkt[1] & 0x80)
+			xSemaphoreGive(fan_frame);
+	}
+}
+
+static int fan_send(void *arg, const rtp_client_t *c, const rtp_iov_t *iov, int iovcnt)
+{
+	rtp_sender *tx = (rtp_sender *) arg;
+
+	tx->to.sin_addr.s_addr = c->addr;
+	tx->to.sin_port = c->port;
+	return send_iov(tx, iov, iovcnt);
+}
+
+/* host ns per frame, the fastest GOP */
+static uint64_t fan_run(int fanout, int nv, uint32_t *packets, int *fail)
+{
+	static rtp_sender tx[FAN_VIEWERS];
+	static rtp_pack_t pk[FAN_VIEWERS];
+	static rtp_fanout_t fo;
+	h264_au_t key, p;
+	const h264_au_t *au;
+	uint64_t ns = 0, best = ~0ULL, t;
+	uint32_t i, sent = 0;
+	int v, got, sock;
+
+	h264_au_index(key_au, key_au + key_len, &key);
+	h264_au_index(p_au, p_au + p_len, &p);
+
+	/* one socket for all viewers, UDP PCBs are scarce */
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	for (v = 0; v < nv; v++) {
+		memset(&tx[v], 0, sizeof(tx[v]));
+		tx[v].s = sock;
+		tx[v].to.sin_family = AF_INET;
+		tx[v].to.sin_port = htons(FAN_PORT);
+		tx[v].to.sin_addr.s_addr = htonl(SIM_IP(2));
+		rtp_pack_init(&pk[v], RTP_PT, FAN_SSRC(v), 0, send_copy, &tx[v]);
+		viewers[v].packets = 0;
+		viewers[v].seq_err = 0;
+		viewers[v].started = 0;
+	}
+	fan_ssrc_err = 0;
+	rtp_fanout_init(&fo, fan_send, &tx[0]);
+	for (v = 0; v < nv; v++)
+		rtp_fanout_add(&fo, htonl(SIM_IP(2)), htons(FAN_PORT), FAN_SSRC(v), 0, 0);
+	if (fanout)
+		rtp_pack_init(&pk[0], RTP_PT, 0, 0, rtp_fanout_sendv, &fo);
+	while (xSemaphoreTake(fan_frame, 0) == pdTRUE)
+		;
+
+	for (i = 0; i < FAN_FRAMES; i++) {
+		if (i % RTP_GOP == 0) {
+			if (i && ns < best)
+				best = ns;
+			ns = 0;
+		}
+		au = (i % RTP_GOP == 0) ? &key : &p;
+
+		t = sim_host_ns();
+		if (fanout) {
+			rtp_fanout_begin(&fo, au->key);
+			*fail |= rtp_pack_h264(&pk[0], au, i * 3000, 1) < 0;
+			rtp_fanout_end(&fo);
+		} else {
+			for (v = 0; v < nv; v++)
+				*fail |= rtp_pack_h264(&pk[v], au, i * 3000, 1) < 0;
+		}
+		ns += sim_host_ns() - t;
+
+		for (got = 0; got < nv; got++) {
+			if (xSemaphoreTake(fan_frame, RTP_TIMEOUT) != pdTRUE) {
+				*fail = 1;
+				break;
+			}
+		}
+	}
+	if (ns < best)
+		best = ns;
+
+	close(sock);
+	for (v = 0; v < nv; v++) {
+		sent += fanout ? fo.client[v].packets : pk[v].packets;
+		*fail |= viewers[v].seq_err || fan_ssrc_err;
+		*fail |= viewers[v].packets != (fanout ? fo.client[v].packets : pk[v].packets);
+	}
+	*packets = sent / FAN_FRAMES;
+	return best / RTP_GOP;
+}
+
+/* client 1 fails in frames 3 and 4, client 2 always, client 0 is pinned
+   and fails from frame 12 on; a key frame every other frame */
+static int fan_fail_mask(uint32_t frame)
+{
+	return ((frame == 3 || frame == 4) ? 2 : 0) | 4 | (frame >= 12 ? 1 : 0);
+}
+
+static uint32_t fan_frame_no;
+
+static int fan_send_fail(void *arg, const rtp_client_t *c, const rtp_iov_t *iov, int iovcnt)
+{
+	rtp_fanout_t *fo = (rtp_fanout_t *) arg;
+
+	(void) iov;
+	(void) iovcnt;
+	return (fan_fail_mask(fan_frame_no) & (1 << (c - fo->client))) ? -1 : 0;
+}
+
+static int check_slow_consumer(void)
+{
+	static rtp_fanout_t fo;
+	rtp_pack_t pk;
+	h264_au_t key, p;
+	int fail = 0;
+
+	h264_au_index(key_au, key_au + key_len, &key);
+	h264_au_index(p_au, p_au + p_len, &p);
+
+	rtp_fanout_init(&fo, fan_send_fail, &fo);
+	rtp_fanout_add(&fo, 0, 0, 1, 0, 1);
+	rtp_fanout_add(&fo, 0, 0, 2, 0, 0);
+	rtp_fanout_add(&fo, 0, 0, 3, 0, 0);
+	rtp_fanout_add(&fo, 0, 0, 4, 0, 0);
+	rtp_pack_init(&pk, RTP_PT, 0, 0, rtp_fanout_sendv, &fo);
+
+	for (fan_frame_no = 0; fan_frame_no < 40; fan_frame_no++) {
+		rtp_fanout_begin(&fo, (fan_frame_no & 1) == 0);
+		rtp_pack_h264(&pk, (fan_frame_no & 1) == 0 ? &key : &p, 0, 1);
+		rtp_fanout_end(&fo);
+	}
+
+	/* 1: frames 3 and 4 lost, back at the key frame 6 */
+	fail |= fo.client[1].state != RTP_CLIENT_ACTIVE || fo.client[1].dropped != 3;
+	/* 2: removed after RTP_FANOUT_MAX_FAIL failed key frames */
+	fail |= fo.client[2].state != RTP_CLIENT_FREE || fo.removed != 1;
+	/* 0: pinned, kept waiting */
+	fail |= fo.client[0].state != RTP_CLIENT_WAIT_KEY || fo.client[0].dropped != 40 - 12;
+	/* 3: every packet; 1 skipped a sequence number in each failed frame */
+	fail |= fo.client[3].dropped != 0 || fo.client[3].packets != pk.packets;
+	fail |= fo.client[1].seq != fo.client[1].packets + 2;
+
+	printf("fanout slow consumers %s\n", fail ? "MISMATCH" : "ok");
+	return fail;
+}
+
+int sim_bench_fanout(void)
+{
+	uint64_t ns[2][FAN_VIEWERS + 1];
+	uint32_t packets;
+	int mode, nv, fail = 0;
+
+	make_frames();
+	if (fan_frame == NULL) {
+		fan_frame = xSemaphoreCreateCounting(FAN_VIEWERS * 4, 0);
+		xTaskCreate(fan_rx_task, (const char *) "fan_rx", 1024, NULL, FAN_PRIO, NULL);
+		rtp_warm_up();
+	}
+
+	for (nv = 1; nv <= FAN_VIEWERS; nv++) {
+		for (mode = 0; mode < 2; mode++) {
+			ns[mode][nv] = fan_run(mode, nv, &packets, &fail);
+			printf("fanout %-8s %u viewers, %u packets per frame, %.1f us per frame\n",
+				mode ? "once" : "separate", nv, packets, ns[mode][nv] / 1e3);
+		}
+	}
+	printf("fanout per added viewer: separate %.1f us, once %.1f us per frame\n",
+		(double)(ns[0][FAN_VIEWERS] - ns[0][1]) / (FAN_VIEWERS - 1) / 1e3,
+		(double)(ns[1][FAN_VIEWERS] - ns[1][1]) / (FAN_VIEWERS - 1) / 1e3);
+
+	fail |= check_slow_consumer();
+	return fail ? -1 : 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Received packets into the tcpip thread: bursts of 1 to 16 UDP datagrams
+ * sent back to back from 10.0.0.1 arrive in the same tick, and the WLAN
+ * receive task, which runs above the tcpip thread as the driver does, hands
+ * them to tcpip_input() one after the other. A raw UDP pcb on 10.0.0.2
+ * counts them in the tcpip thread. For each burst size:
+ *
+ *   wakeups   switches to the tcpip thread per packet received
+ *   lost      packets that did not reach the pcb, i.e. did not fit into
+ *             the mbox (TCPIP_MBOX_SIZE) without TCPIP_INPUT_BATCH
+ *   host      host time per packet received, sender and receiver
+ *
+ * The next burst is sent once the last one is in (or RX_SETTLE ticks
+ * later when some were lost), so the sender never holds the core lock
+ * when the tcpip thread wakes up.
+ *
+ * make VARIANT=nobatch builds the same without TCPIP_INPUT_BATCH.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+
+#include "sim.h"
+
+#define RX_PORT				5040
+#define RX_PACKETS			2400	/* per burst size */
+#define RX_SIZE				512
+#define RX_SETTLE			10		/* ticks until a burst is in */
+
+static const int rx_bursts[] = { 1, 4, 8, 16 };
+
+static struct udp_pcb *rx_pcb;
+static volatile uint32_t rx_count, rx_until;
+static SemaphoreHandle_t rx_sem, rx_burst;
+
+static void rx_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	(void) arg;
+	(void) pcb;
+	(void) addr;
+	(void) port;
+
+	if (++rx_count == rx_until)
+		xSemaphoreGive(rx_burst);
+	pbuf_free(p);
+}
+
+/* In the tcpip thread: count its wakeups and open the pcb */
+static void rx_open(void *arg)
+{
+	(void) arg;
+
+	sim_task_watch(xTaskGetCurrentTaskHandle());
+	rx_pcb = udp_new();
+	if (rx_pcb) {
+		udp_bind(rx_pcb, &xnetif[1].ip_addr, RX_PORT);
+		udp_recv(rx_pcb, rx_recv, NULL);
+	}
+	xSemaphoreGive(rx_sem);
+}
+
+static void rx_close(void *arg)
+{
+	(void) arg;
+
+	udp_remove(rx_pcb);
+	rx_pcb = NULL;
+	sim_task_watch(NULL);
+	xSemaphoreGive(rx_sem);
+}
+
+int sim_bench_rx(void)
+{
+	static char buf[RX_SIZE];
+	struct sockaddr_in addr;
+	uint32_t rate, wakeups, i, j;
+	uint64_t ns;
+	unsigned b;
+	int s, ret = 0;
+
+	if (rx_sem == NULL) {
+		rx_sem = xSemaphoreCreateBinary();
+		rx_burst = xSemaphoreCreateBinary();
+	}
+
+	s = socket(AF_INET, SOCK_DGRAM, 0);
+	if (s < 0)
+		return -1;
+	tcpip_callback(rx_open, NULL);
+	xSemaphoreTake(rx_sem, portMAX_DELAY);
+	if (rx_pcb == NULL) {
+		close(s);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(RX_PORT);
+	addr.sin_addr.s_addr = htonl(SIM_IP(2));
+	memset(buf, 0x5a, sizeof(buf));
+
+	/* a burst is on the wire in the tick it is sent */
+	rate = sim_netif_set_rate(0);
+	sendto(s, buf, sizeof(buf), 0, (struct sockaddr *) &addr, sizeof(addr));
+	vTaskDelay(RX_SETTLE);
+
+	for (b = 0; b < sizeof(rx_bursts) / sizeof(rx_bursts[0]); b++) {
+		rx_count = rx_until = 0;
+		wakeups = sim_task_switches();
+		ns = sim_host_ns();
+		for (i = 0; i < RX_PACKETS; i += rx_bursts[b]) {
+			rx_until = rx_count + rx_bursts[b];
+			for (j = 0; j < (uint32_t) rx_bursts[b]; j++)
+				sendto(s, buf, sizeof(buf), 0, (struct sockaddr *) &addr, sizeof(addr));
+			xSemaphoreTake(rx_burst, RX_SETTLE);
+		}
+		ns = sim_host_ns() - ns;
+		wakeups = sim_task_switches() - wakeups;
+
+		if (rx_count == 0) {
+			printf("rx     burst %2d: nothing received\n", rx_bursts[b]);
+			ret = -1;
+			continue;
+		}
+		printf("rx     burst %2d: %.3f wakeups per packet, %4u/%u lost, host %.0f ns per packet, batch %s\n",
+			rx_bursts[b], (double) wakeups / rx_count, RX_PACKETS - rx_count, RX_PACKETS,
+			(double) ns / rx_count, TCPIP_INPUT_BATCH ? "on" : "off");
+	}
+
+	sim_netif_set_rate(rate);
+	tcpip_callback(rx_close, NULL);
+	xSemaphoreTake(rx_sem, portMAX_DELAY);
+	close(s);
+
+	return ret;
+}
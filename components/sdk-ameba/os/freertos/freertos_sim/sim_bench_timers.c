@@ -0,0 +1,517 @@
+/*
+ * lwIP timeouts, sys_timeout() and sys_untimeout(), with TIMERS_NUM of them
+ * pending. All calls are made in the tcpip thread through tcpip_callback().
+ *
+ * First a check of whatever implementation is built against a model kept
+ * here, the expiry time and armed state of every timeout:
+ *
+ *   churn   TIMERS_ROUNDS rounds of TIMERS_OPS random adds, cancels and
+ *           re-arms of timeouts up to TIMERS_MAX_MS away (some due at once),
+ *           with a few ticks between the rounds; a quarter of the timeouts
+ *           re-arm themselves from their handler
+ *   long    timeouts around and beyond the span of the wheel, 2^24 ms
+ *           (about 4.66 hours) with the defaults
+ *
+ * A timeout that fires early, more than TIMERS_LATE ticks late, twice or
+ * after being cancelled, or never, fails the benchmark.
+ *
+ * Then the wheel and the sorted list in lockstep, the one lwIP is built with
+ * in the tcpip thread and the other (sim_timers_other.c) in a task of its
+ * own: TIMERS_STEP_ROUNDS rounds of the same seeded adds, cancels and
+ * re-arms up to TIMERS_STEP_MAX_MS away go to both, some of TIMERS_STEP_NUM timeouts re-arm themselves
+ * from their handler. Both must call the same handlers on the same ticks,
+ * as often; within a tick the wheel calls them in no particular order, so
+ * the calls of one tick compare as a set.
+ *
+ * Then host ns per add, re-arm (cancel and add) and cancel with TIMERS_NUM
+ * timeouts pending, due up to a minute away. The Makefile sizes the pool
+ * and the cancel hash of the wheel (LWIP_TIMERS_HASH_SIZE) for them.
+ *
+ * make VARIANT=nowheel builds the same with the sorted list.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/tcpip.h"
+#include "lwip/lwip_timers.h"
+
+#include "sim.h"
+
+#define TIMERS_NUM			4000
+#define TIMERS_ROUNDS		200
+#define TIMERS_OPS			200		/* per round */
+#define TIMERS_MAX_MS		5000
+#define TIMERS_TIME_MS		60000	/* timing: timeouts due up to this far */
+#define TIMERS_LATE			1
+#define TIMERS_SPAN			(1UL << (LWIP_TIMERS_WHEEL_BITS * LWIP_TIMERS_WHEEL_LEVELS))
+#define TIMERS_STEP_NUM		SIM_TIMERS_OTHER_NUM
+#define TIMERS_STEP_ROUNDS	500
+#define TIMERS_STEP_OPS		16		/* per round */
+#define TIMERS_STEP_MAX_MS	500
+#define TIMERS_STEP_LOG		32768	/* handler calls kept per implementation */
+#define TIMERS_STEP_CANCEL	0xFFFFFFFFUL
+
+#if LWIP_TIMERS_WHEEL
+#define TIMERS_BUILT		"wheel"
+#define TIMERS_OTHER		"list"
+#else
+#define TIMERS_BUILT		"list"
+#define TIMERS_OTHER		"wheel"
+#endif
+
+typedef struct {
+	u32_t due;
+	u8_t armed;
+	u8_t rearm;				/* re-arms itself when it fires */
+} timers_ctx;
+
+static timers_ctx ctxs[TIMERS_NUM];
+static SemaphoreHandle_t timers_sem;
+static int timers_churning;
+static uint32_t timers_armed, timers_fired, timers_early, timers_late, timers_spurious, timers_late_max;
+static uint64_t timers_ns[3];
+
+static void timers_fire(void *arg);
+
+static void timers_arm(timers_ctx *c, u32_t ms)
+{
+	c->due = sys_now() + ms;
+	c->armed = 1;
+	timers_armed++;
+	sys_timeout(ms, timers_fire, c);
+}
+
+static void timers_cancel(timers_ctx *c)
+{
+	sys_untimeout(timers_fire, c);
+	c->armed = 0;
+	timers_armed--;
+}
+
+/* Mostly spread up to TIMERS_MAX_MS, some due at once or on the next tick */
+static u32_t timers_delay(void)
+{
+	switch (rand() % 16) {
+	case 0:
+		return 0;
+	case 1:
+		return 1;
+	default:
+		return rand() % TIMERS_MAX_MS;
+	}
+}
+
+static void timers_fire(void *arg)
+{
+	timers_ctx *c = (timers_ctx *) arg;
+	u32_t now = sys_now();
+
+	if (!c->armed) {
+		timers_spurious++;
+		return;
+	}
+	c->armed = 0;
+	timers_armed--;
+	timers_fired++;
+	if ((s32_t)(now - c->due) < 0)
+		timers_early++;
+	else if (now - c->due > TIMERS_LATE)
+		timers_late++;
+	if ((s32_t)(now - c->due) > (s32_t) timers_late_max)
+		timers_late_max = now - c->due;
+
+	if (c->rearm && timers_churning)
+		timers_arm(c, timers_delay());
+}
+
+static void timers_churn(void *arg)
+{
+	timers_ctx *c;
+	int i;
+
+	(void) arg;
+
+	for (i = 0; i < TIMERS_OPS; i++) {
+		c = &ctxs[rand() % TIMERS_NUM];
+		if (c->armed) {
+			timers_cancel(c);
+			if (rand() & 1)
+				continue;
+		}
+		timers_arm(c, timers_delay());
+	}
+	xSemaphoreGive(timers_sem);
+}
+
+static void timers_stop(void *arg)
+{
+	(void) arg;
+
+	timers_churning = 0;
+	xSemaphoreGive(timers_sem);
+}
+
+static const u32_t timers_long_ms[] = {
+	TIMERS_SPAN / 2, TIMERS_SPAN - 1, TIMERS_SPAN, TIMERS_SPAN + 1, TIMERS_SPAN + 123457
+};
+
+#define TIMERS_LONG			(sizeof(timers_long_ms) / sizeof(timers_long_ms[0]))
+
+static void timers_long(void *arg)
+{
+	unsigned i;
+
+	(void) arg;
+
+	for (i = 0; i < TIMERS_LONG; i++)
+		timers_arm(&ctxs[i], timers_long_ms[i]);
+	xSemaphoreGive(timers_sem);
+}
+
+static u32_t timers_delays[TIMERS_NUM];
+static u16_t timers_order[3][TIMERS_NUM];
+
+/* Host ns of adding, re-arming and cancelling all of them, each in its own
+   random order */
+static void timers_time(void *arg)
+{
+	uint64_t ns;
+	int i;
+
+	(void) arg;
+
+	ns = sim_host_ns();
+	for (i = 0; i < TIMERS_NUM; i++)
+		timers_arm(&ctxs[timers_order[0][i]], timers_delays[i]);
+	timers_ns[0] = sim_host_ns() - ns;
+
+	ns = sim_host_ns();
+	for (i = 0; i < TIMERS_NUM; i++) {
+		timers_cancel(&ctxs[timers_order[1][i]]);
+		timers_arm(&ctxs[timers_order[1][i]], timers_delays[TIMERS_NUM - 1 - i]);
+	}
+	timers_ns[1] = sim_host_ns() - ns;
+
+	ns = sim_host_ns();
+	for (i = 0; i < TIMERS_NUM; i++)
+		timers_cancel(&ctxs[timers_order[2][i]]);
+	timers_ns[2] = sim_host_ns() - ns;
+
+	xSemaphoreGive(timers_sem);
+}
+
+static void timers_call(tcpip_callback_fn fn, void *arg)
+{
+	tcpip_callback(fn, arg);
+	xSemaphoreTake(timers_sem, portMAX_DELAY);
+}
+
+typedef struct {
+	u32_t tick;
+	u32_t idx;
+} timers_event;
+
+typedef struct timers_side timers_side;
+
+typedef struct {
+	timers_side *side;
+	u16_t idx;
+	u16_t fired;
+	u8_t armed;
+} timers_step_ctx;
+
+/* One implementation in the lockstep check and what its handlers saw */
+struct timers_side {
+	void (*timeout)(u32_t msecs, sys_timeout_handler handler, void *arg);
+	void (*untimeout)(sys_timeout_handler handler, void *arg);
+	timers_step_ctx ctxs[TIMERS_STEP_NUM];
+	timers_event log[TIMERS_STEP_LOG];
+	u32_t calls;
+	int stepping;
+};
+
+typedef struct {
+	tcpip_callback_fn fn;
+	void *arg;
+} timers_msg;
+
+static timers_side timers_built, timers_other;
+static struct {
+	u16_t idx;
+	u32_t ms;				/* or TIMERS_STEP_CANCEL */
+} timers_trace[TIMERS_STEP_OPS];
+static u32_t timers_step_rearm[TIMERS_STEP_NUM];
+static sys_mbox_t timers_other_mbox;
+static timers_msg timers_other_msg;
+
+static void timers_step_fire(void *arg);
+
+static void timers_built_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
+{
+	sys_timeout(msecs, handler, arg);
+}
+
+static void timers_step_arm(timers_step_ctx *c, u32_t ms)
+{
+	c->armed = 1;
+	c->side->timeout(ms, timers_step_fire, c);
+}
+
+/* Every fourth re-arms itself from a table, the delay only depending on
+   the timeout and how often it fired */
+static void timers_step_fire(void *arg)
+{
+	timers_step_ctx *c = (timers_step_ctx *) arg;
+	timers_side *s = c->side;
+
+	if (s->calls < TIMERS_STEP_LOG) {
+		s->log[s->calls].tick = sys_now();
+		s->log[s->calls].idx = c->idx;
+	}
+	s->calls++;
+	c->armed = 0;
+	c->fired++;
+	if ((c->idx & 3) == 0 && s->stepping)
+		timers_step_arm(c, timers_step_rearm[(c->idx + c->fired) % TIMERS_STEP_NUM]);
+}
+
+/* One round of timers_trace on one side */
+static void timers_step(void *arg)
+{
+	timers_side *s = (timers_side *) arg;
+	timers_step_ctx *c;
+	int i;
+
+	for (i = 0; i < TIMERS_STEP_OPS; i++) {
+		c = &s->ctxs[timers_trace[i].idx];
+		if (c->armed) {
+			s->untimeout(timers_step_fire, c);
+			c->armed = 0;
+		}
+		if (timers_trace[i].ms != TIMERS_STEP_CANCEL)
+			timers_step_arm(c, timers_trace[i].ms);
+	}
+	xSemaphoreGive(timers_sem);
+}
+
+static void timers_step_stop(void *arg)
+{
+	((timers_side *) arg)->stepping = 0;
+	xSemaphoreGive(timers_sem);
+}
+
+/* The tcpip thread of the other implementation: timeouts and timers_msg */
+static void timers_other_thread(void *arg)
+{
+	timers_msg *msg;
+
+	(void) arg;
+
+	for (;;) {
+		other_sys_timeouts_mbox_fetch(&timers_other_mbox, (void **) &msg);
+		msg->fn(msg->arg);
+	}
+}
+
+static void timers_other_call(tcpip_callback_fn fn, void *arg)
+{
+	timers_other_msg.fn = fn;
+	timers_other_msg.arg = arg;
+	sys_mbox_post(&timers_other_mbox, &timers_other_msg);
+	xSemaphoreTake(timers_sem, portMAX_DELAY);
+}
+
+/* The rounds go to both on even ticks and put timeouts due at once or on
+   odd ones: a round never meets a timeout due on its own tick, which either
+   side could call before or after the round. */
+static void timers_step_both(tcpip_callback_fn fn)
+{
+	vTaskDelay(xTaskGetTickCount() & 1);
+	timers_call(fn, &timers_built);
+	timers_other_call(fn, &timers_other);
+}
+
+static void timers_step_init(timers_side *s)
+{
+	int i;
+
+	memset(s, 0, sizeof(*s));
+	for (i = 0; i < TIMERS_STEP_NUM; i++) {
+		s->ctxs[i].side = s;
+		s->ctxs[i].idx = (u16_t) i;
+	}
+	s->stepping = 1;
+}
+
+static int timers_event_cmp(const void *a, const void *b)
+{
+	const timers_event *x = (const timers_event *) a, *y = (const timers_event *) b;
+
+	if (x->tick != y->tick)
+		return (s32_t)(x->tick - y->tick) < 0 ? -1 : 1;
+	return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+static u32_t timers_step_pending(const timers_side *s)
+{
+	u32_t n = 0;
+	int i;
+
+	for (i = 0; i < TIMERS_STEP_NUM; i++)
+		n += s->ctxs[i].armed;
+	return n;
+}
+
+static int timers_lockstep(void)
+{
+	TickType_t start;
+	u32_t n, i;
+	int round, ret = 0;
+
+	if (timers_other_mbox == NULL) {
+		sys_mbox_new(&timers_other_mbox, 4);
+		other_sys_timeouts_start();
+		sys_thread_new("timers_other", timers_other_thread, NULL, TCPIP_THREAD_STACKSIZE, TCPIP_THREAD_PRIO);
+	}
+	timers_step_init(&timers_built);
+	timers_step_init(&timers_other);
+	timers_built.timeout = timers_built_timeout;
+	timers_built.untimeout = sys_untimeout;
+	timers_other.timeout = other_sys_timeout;
+	timers_other.untimeout = other_sys_untimeout;
+	for (i = 0; i < TIMERS_STEP_NUM; i++)
+		timers_step_rearm[i] = (rand() % TIMERS_STEP_MAX_MS) & ~1UL;
+
+	start = xTaskGetTickCount();
+	for (round = 0; round < TIMERS_STEP_ROUNDS; round++) {
+		for (i = 0; i < TIMERS_STEP_OPS; i++) {
+			timers_trace[i].idx = (u16_t)(rand() % TIMERS_STEP_NUM);
+			if (rand() % 4 == 0)
+				timers_trace[i].ms = TIMERS_STEP_CANCEL;
+			else if (rand() % 16 == 0)
+				timers_trace[i].ms = 0;
+			else
+				timers_trace[i].ms = (rand() % TIMERS_STEP_MAX_MS) | 1;
+		}
+		timers_step_both(timers_step);
+		vTaskDelay(1 + rand() % 20);
+	}
+	timers_step_both(timers_step_stop);
+	vTaskDelay(TIMERS_STEP_MAX_MS + 1);
+
+	printf("timers lockstep %u rounds over %u ticks: %s %u calls, %s %u calls, %u and %u pending\n",
+		TIMERS_STEP_ROUNDS, (unsigned)(xTaskGetTickCount() - start), TIMERS_BUILT, timers_built.calls,
+		TIMERS_OTHER, timers_other.calls, timers_step_pending(&timers_built), timers_step_pending(&timers_other));
+	if (timers_built.calls > TIMERS_STEP_LOG || timers_other.calls > TIMERS_STEP_LOG) {
+		printf("timers lockstep: more than %u calls\n", TIMERS_STEP_LOG);
+		return -1;
+	}
+	if (timers_step_pending(&timers_built) != 0 || timers_step_pending(&timers_other) != 0)
+		ret = -1;
+
+	n = LWIP_MIN(timers_built.calls, timers_other.calls);
+	qsort(timers_built.log, timers_built.calls, sizeof(timers_event), timers_event_cmp);
+	qsort(timers_other.log, timers_other.calls, sizeof(timers_event), timers_event_cmp);
+	for (i = 0; i < n; i++) {
+		if (timers_built.log[i].tick != timers_other.log[i].tick ||
+			timers_built.log[i].idx != timers_other.log[i].idx)
+			break;
+	}
+	if (i < n) {
+		printf("timers lockstep: call %u differs, %s timeout %u on tick %u, %s timeout %u on tick %u\n",
+			i, TIMERS_BUILT, timers_built.log[i].idx, timers_built.log[i].tick,
+			TIMERS_OTHER, timers_other.log[i].idx, timers_other.log[i].tick);
+		ret = -1;
+	} else if (timers_built.calls != timers_other.calls) {
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wait until all of them are due and report what the model saw */
+static int timers_check(const char *what, u32_t wait, u32_t armed)
+{
+	TickType_t start = xTaskGetTickCount();
+
+	vTaskDelay(wait + TIMERS_LATE + 1);
+	printf("timers %-5s %u timeouts over %u ticks: %u fired, latest %u ticks after its time, "
+		"%u early, %u late, %u spurious, %u missed\n",
+		what, armed, (unsigned)(xTaskGetTickCount() - start), timers_fired, timers_late_max,
+		timers_early, timers_late, timers_spurious, timers_armed);
+
+	return (timers_fired == armed && timers_early == 0 && timers_late == 0 &&
+		timers_spurious == 0 && timers_armed == 0) ? 0 : -1;
+}
+
+static void timers_reset(void)
+{
+	memset(ctxs, 0, sizeof(ctxs));
+	timers_armed = timers_fired = timers_early = timers_late = timers_spurious = timers_late_max = 0;
+}
+
+int sim_bench_timers(void)
+{
+	uint32_t armed;
+	int i, j, k, ret = 0;
+
+	if (timers_sem == NULL)
+		timers_sem = xSemaphoreCreateBinary();
+	srand(1);
+
+	timers_reset();
+	for (i = 0; i < TIMERS_NUM; i += 4)
+		ctxs[i].rearm = 1;
+	timers_churning = 1;
+	for (i = 0; i < TIMERS_ROUNDS; i++) {
+		timers_call(timers_churn, NULL);
+		vTaskDelay(1 + rand() % 20);
+	}
+	timers_call(timers_stop, NULL);
+	/* what has fired and what is still pending must all fire, the
+	   cancelled ones never */
+	armed = timers_fired + timers_armed;
+	if (timers_check("churn", TIMERS_MAX_MS, armed) != 0)
+		ret = -1;
+
+	timers_reset();
+	timers_call(timers_long, NULL);
+	if (timers_check("long", timers_long_ms[TIMERS_LONG - 1], TIMERS_LONG) != 0)
+		ret = -1;
+
+	if (timers_lockstep() != 0)
+		ret = -1;
+
+	timers_reset();
+	for (i = 0; i < TIMERS_NUM; i++) {
+		timers_delays[i] = 1 + rand() % TIMERS_TIME_MS;
+		for (k = 0; k < 3; k++)
+			timers_order[k][i] = i;
+	}
+	for (k = 0; k < 3; k++) {
+		for (i = TIMERS_NUM - 1; i > 0; i--) {
+			u16_t t = timers_order[k][i];
+
+			j = rand() % (i + 1);
+			timers_order[k][i] = timers_order[k][j];
+			timers_order[k][j] = t;
+		}
+	}
+	timers_call(timers_time, NULL);
+#if LWIP_TIMERS_WHEEL
+	printf("timers %u pending: add %.0f ns, re-arm %.0f ns, cancel %.0f ns, wheel, %u hash buckets\n",
+		TIMERS_NUM, (double) timers_ns[0] / TIMERS_NUM, (double) timers_ns[1] / TIMERS_NUM,
+		(double) timers_ns[2] / TIMERS_NUM, LWIP_TIMERS_HASH_SIZE);
+#else
+	printf("timers %u pending: add %.0f ns, re-arm %.0f ns, cancel %.0f ns, list\n",
+		TIMERS_NUM, (double) timers_ns[0] / TIMERS_NUM, (double) timers_ns[1] / TIMERS_NUM,
+		(double) timers_ns[2] / TIMERS_NUM);
+#endif
+
+	return ret;
+}
@@ -0,0 +1,922 @@
+/*
+ * Time-lapse recording of a fixed camera, 30 minutes at one 640x480 MJPEG
+ * frame every 2 s, through FatFs onto the SD card RAM disk of the fmp4
+ * benchmark:
+ *
+ *   files    every frame in a file of its own, the volume mounted for each,
+ *            as the time-lapse example did
+ *   all      tl_mux storing every frame, 32 KB writes and the index
+ *   tl       tl_mux storing the frames where the scene changed
+ *
+ * The sequence is recorded once by a baseline encoder here, 4:2:2 with the
+ * Annex K tables like a UVC camera: a street with buildings under light
+ * that brightens through the half hour, sensor noise, people and cars going
+ * past and a car that parks for a while. Every frame whose scene differs from
+ * the one before (something in view moved, came or went) must be stored.
+ *
+ * The DC map is checked against the DC values the encoder wrote, and timed.
+ * The tl files are read back through the index, records are looked up by
+ * time, and power cuts are replayed as in the fmp4 benchmark: after
+ * tl_mux_recover the index must hold the frames stored until the last sync.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ff.h"
+#include "fatfs_ext/inc/ff_driver.h"
+#include "tl_mux.h"
+#include "sample_jpeg.h"
+
+#include "sim.h"
+
+#define FS_SECTORS			(160 * 2048)	/* 160 MB */
+#define FS_CLUSTER			64				/* sectors, 32 KB */
+#define FS_ROOT_ENTRIES		512
+#define FS_FAT_SECTORS		21
+
+#define TLB_W				640
+#define TLB_H				480
+#define TLB_FRAMES			900
+#define TLB_INTERVAL_MS		2000
+#define TLB_QUALITY			75
+#define TLB_NOISE			2.0				/* luma levels, rms */
+#define TLB_SYNC_MS			10000
+#define TLB_CUTS			6
+
+#define TLB_YBLOCKS			((TLB_W / 8) * (TLB_H / 8))
+#define TLB_CBLOCKS			((TLB_W / 16) * (TLB_H / 8))
+
+/* SD card cost model, us */
+#define SD_WRITE_CMD_US		1000
+#define SD_WRITE_SECTOR_US	51
+#define SD_READ_CMD_US		200
+#define SD_READ_SECTOR_US	26
+
+typedef struct {
+	uint32_t writes;
+	uint32_t write_sectors;
+	uint32_t reads;
+	uint32_t read_sectors;
+} disk_stats;
+
+/* something crossing the scene: a person or a car, from frame start on */
+typedef struct {
+	int start;
+	int frames;
+	int x0;
+	int speed;		/* pixels per frame, 0 parked */
+	int y;
+	int w;
+	int h;
+	int car;
+} tlb_object;
+
+static const tlb_object objects[] = {
+	{  40, 12,  -48,  64, 250,  48,  96, 0 },
+	{ 130,  5, -128, 180, 330, 128,  64, 1 },
+	{ 210, 14,  660, -52, 240,  48,  96, 0 },
+	{ 300,  4,  660, -210, 340, 128,  64, 1 },
+	{ 380, 160, 200,   0, 330, 128,  64, 1 },	/* parks for 5 minutes */
+	{ 450, 11,  -48,  70, 260,  48,  96, 0 },
+	{ 600, 10,  660, -80, 250,  48,  96, 0 },
+	{ 700,  5, -128, 170, 335, 128,  64, 1 },
+	{ 820, 16,  -48,  45, 245,  48,  96, 0 },
+};
+
+#define TLB_OBJECTS			(sizeof(objects) / sizeof(objects[0]))
+
+static const uint8_t zigzag[64] = {
+	0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+/* Annex K, quality 50, natural order */
+static const uint8_t std_qt[2][64] = {
+	{
+		16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+		14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+		18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+		49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+	}, {
+		17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+		24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+	},
+};
+
+typedef struct {
+	uint16_t code[256];
+	uint8_t len[256];
+} tlb_huff;
+
+static uint8_t *ram;
+static disk_stats dst;
+static uint32_t cut_after;			/* write commands, 0 = never */
+static uint32_t cut_ms;
+static uint32_t now_ms;
+
+static FATFS fs;
+static FIL fil;
+static FIL idx;
+static tl_mux_t mux;
+static uint8_t tl_buf[48 * 1024] __attribute__((aligned(32)));
+static mjpeg_dc_t dc;
+static int16_t cells[TLB_YBLOCKS];
+
+/* the recording */
+static uint8_t *seq;
+static uint32_t seq_off[TLB_FRAMES + 1];
+static uint32_t seq_hash[TLB_FRAMES];
+static uint8_t seq_changed[TLB_FRAMES];
+static uint8_t seq_stored[TLB_FRAMES];
+static int missed;
+static int16_t seq_dc[TLB_YBLOCKS];	/* of frame 0, dequantized */
+
+/* encoder */
+static float cosm[8][8];
+static float bg[TLB_YBLOCKS + 2 * TLB_CBLOCKS][64];
+static uint8_t qt[2][64];
+static float qr[2][64];		/* 1 / qt */
+static tlb_huff hdc[2], hac[2];
+static uint32_t tlb_seed;
+static uint8_t *out;
+static uint32_t acc;
+static int acc_n;
+
+static uint8_t *frame_buf;
+
+/* the index read back */
+static tl_index_t recs[TLB_FRAMES];
+static int rec_num;
+static tl_index_t full[TLB_FRAMES];		/* of the run without a cut */
+static int full_num;
+
+static DSTATUS ram_initialize(void)
+{
+	return 0;
+}
+
+static DSTATUS ram_status(void)
+{
+	return 0;
+}
+
+static DRESULT ram_read(BYTE *buff, DWORD sector, UINT count)
+{
+	if (sector + count > FS_SECTORS)
+		return RES_PARERR;
+	memcpy(buff, ram + sector * 512, count * 512);
+	dst.reads++;
+	dst.read_sectors += count;
+	return RES_OK;
+}
+
+static DRESULT ram_write(const BYTE *buff, DWORD sector, UINT count)
+{
+	if (sector + count > FS_SECTORS)
+		return RES_PARERR;
+	dst.writes++;
+	dst.write_sectors += count;
+	if (cut_after && dst.writes >= cut_after) {
+		/* the power went during this one: half of it made it */
+		if (dst.writes == cut_after) {
+			memcpy(ram + sector * 512, buff, (count + 1) / 2 * 512);
+			cut_ms = now_ms;
+		}
+		return RES_OK;
+	}
+	memcpy(ram + sector * 512, buff, count * 512);
+	return RES_OK;
+}
+
+static DRESULT ram_ioctl(BYTE cmd, void *buff)
+{
+	switch (cmd) {
+	case CTRL_SYNC:
+		return RES_OK;
+	case GET_SECTOR_COUNT:
+		*(DWORD *) buff = FS_SECTORS;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD *) buff = 512;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD *) buff = FS_CLUSTER;
+		return RES_OK;
+	}
+	return RES_PARERR;
+}
+
+static ll_diskio_drv ram_disk = {
+	.disk_initialize = ram_initialize,
+	.disk_status = ram_status,
+	.disk_read = ram_read,
+	.disk_write = ram_write,
+	.disk_ioctl = ram_ioctl,
+	.TAG = (unsigned char *) "RAM",
+};
+
+static void le16(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void le32(uint8_t *p, uint32_t v)
+{
+	le16(p, v);
+	le16(p + 2, v >> 16);
+}
+
+/* a FAT16 volume without a partition table */
+static void ram_format(void)
+{
+	uint8_t *b = ram;
+	uint32_t fat = 1, i;
+
+	memset(ram, 0, (1 + 2 * FS_FAT_SECTORS + FS_ROOT_ENTRIES * 32 / 512) * 512);
+	b[0] = 0xeb;
+	b[1] = 0x3c;
+	b[2] = 0x90;
+	memcpy(b + 3, "MSDOS5.0", 8);
+	le16(b + 11, 512);
+	b[13] = FS_CLUSTER;
+	le16(b + 14, 1);
+	b[16] = 2;
+	le16(b + 17, FS_ROOT_ENTRIES);
+	b[21] = 0xf8;
+	le16(b + 22, FS_FAT_SECTORS);
+	le16(b + 24, 63);
+	le16(b + 26, 255);
+	le32(b + 32, FS_SECTORS);
+	b[36] = 0x80;
+	b[38] = 0x29;
+	memcpy(b + 43, "NO NAME    FAT16   ", 19);
+	b[510] = 0x55;
+	b[511] = 0xaa;
+	for (i = 0; i < 2; i++, fat += FS_FAT_SECTORS)
+		le32(ram + fat * 512, 0xfffffff8);
+}
+
+static int mount(void)
+{
+	f_mount(NULL, "0:", 1);
+	return f_mount(&fs, "0:", 1);
+}
+
+static uint32_t tlb_rand(void)
+{
+	tlb_seed = tlb_seed * 1103515245 + 12345;
+	return tlb_seed >> 8;
+}
+
+static uint32_t hash(int x, int y)
+{
+	uint32_t h = x * 374761393u + y * 668265263u;
+
+	h = (h ^ (h >> 13)) * 1274126177u;
+	return h ^ (h >> 16);
+}
+
+static uint32_t fnv(const uint8_t *p, uint32_t n)
+{
+	uint32_t h = 2166136261u;
+
+	while (n--)
+		h = (h ^ *p++) * 16777619u;
+	return h;
+}
+
+/* the street: sky, two rows of facades with windows, the road */
+static int scene_y(int x, int y)
+{
+	int v;
+
+	if (y < 120)
+		return 200 - y / 3 + (hash(x >> 5, y >> 5) & 7);
+	if (y < 320) {
+		v = ((x / 80 + y / 100) & 1) ? 150 : 105;
+		if (x % 80 > 20 && x % 80 < 56 && y % 50 > 18 && y % 50 < 42)
+			v = 45;
+		return v + (hash(x, y) & 15);
+	}
+	return 85 + ((y - 320) >> 3) + (hash(x >> 1, y >> 1) & 31);
+}
+
+static int scene_c(int x, int y, int cr)
+{
+	if (y < 120)
+		return cr ? 118 : 150;
+	if (y < 320)
+		return ((x / 80 + y / 100) & 1) ? (cr ? 150 : 112) : (cr ? 132 : 120);
+	return 128;
+}
+
+/* people and cars with windows; -1 outside */
+static int object_px(const tlb_object *o, int xr, int yr, int comp)
+{
+	if (xr < 0 || yr < 0 || xr >= o->w || yr >= o->h)
+		return -1;
+	if (o->car) {
+		if (comp)
+			return comp == 2 ? 180 : 100;
+		return yr < o->h / 3 && xr > 12 && xr < o->w - 12 ? 215 : 40 + (xr & 8);
+	}
+	/* face, a dark coat, jeans */
+	if (comp)
+		return yr < 16 ? (comp == 2 ? 150 : 110) : (comp == 2 ? 120 : 150);
+	return yr < 16 ? 170 : yr < 56 ? 35 + (xr & 4) : 70;
+}
+
+/* where object o is in frame k, or 0 when it is not */
+static int object_at(const tlb_object *o, int k, int *x)
+{
+	*x = o->x0 + (k - o->start) * o->speed;
+	if (k < o->start || k >= o->start + o->frames)
+		return 0;
+	return *x + o->w > 0 && *x < TLB_W;
+}
+
+static void fdct(const float *px, float *coef)
+{
+	float t[64], s;
+	int u, v, x;
+
+	for (v = 0; v < 8; v++)
+		for (u = 0; u < 8; u++) {
+			for (s = 0, x = 0; x < 8; x++)
+				s += cosm[u][x] * px[v * 8 + x];
+			t[v * 8 + u] = s;
+		}
+	for (u = 0; u < 8; u++)
+		for (v = 0; v < 8; v++) {
+			for (s = 0, x = 0; x < 8; x++)
+				s += cosm[v][x] * t[x * 8 + u];
+			coef[v * 8 + u] = s;
+		}
+}
+
+/* the block at bx, by of a component, level shifted, with the objects of
+   frame k on it when there are */
+static void block_px(int comp, int bx, int by, int k, float gain, float *px)
+{
+	const tlb_object *o;
+	int i, j, x, y, ox, v, c;
+	unsigned n;
+
+	for (j = 0; j < 8; j++)
+		for (i = 0; i < 8; i++) {
+			x = comp ? (bx * 8 + i) * 2 : bx * 8 + i;
+			y = by * 8 + j;
+			v = comp ? scene_c(x, y, comp == 2) : scene_y(x, y);
+			for (n = 0; n < TLB_OBJECTS; n++) {
+				o = &objects[n];
+				if (object_at(o, k, &ox) && (c = object_px(o, x - ox, y - o->y, comp)) >= 0)
+					v = c;
+			}
+			px[j * 8 + i] = comp ? v - 128 : (v - 128) * gain;
+		}
+}
+
+static int object_on(int comp, int bx, int by, int k)
+{
+	const tlb_object *o;
+	int x0 = comp ? bx * 16 : bx * 8, w = comp ? 16 : 8, y0 = by * 8, ox;
+	unsigned n;
+
+	for (n = 0; n < TLB_OBJECTS; n++) {
+		o = &objects[n];
+		if (object_at(o, k, &ox) && ox < x0 + w && ox + o->w > x0 && o->y < y0 + 8 && o->y + o->h > y0)
+			return 1;
+	}
+	return 0;
+}
+
+static void huff_codes(tlb_huff *h, const uint8_t *p)
+{
+	int l, i, k = 0, code = 0;
+
+	for (l = 1; l <= 16; l++) {
+		for (i = 0; i < p[l - 1]; i++, k++, code++) {
+			h->code[p[16 + k]] = code;
+			h->len[p[16 + k]] = l;
+		}
+		code <<= 1;
+	}
+}
+
+static void put_bits(uint32_t v, int n)
+{
+	uint8_t b;
+
+	acc = (acc << n) | (v & ((1u << n) - 1));
+	acc_n += n;
+	while (acc_n >= 8) {
+		b = acc >> (acc_n - 8);
+		*out++ = b;
+		if (b == 0xff)
+			*out++ = 0;
+		acc_n -= 8;
+	}
+}
+
+static int nbits(int v)
+{
+	int n = 0;
+
+	if (v < 0)
+		v = -v;
+	while (v) {
+		n++;
+		v >>= 1;
+	}
+	return n;
+}
+
+static void put_value(int v, int s)
+{
+	if (s)
+		put_bits(v < 0 ? v - 1 : v, s);
+}
+
+/* quantize and code one block; return its quantized DC */
+static int encode_block(const float *coef, int t, int *pred)
+{
+	int zz[64], k, r = 0, s, d;
+	float c;
+
+	for (k = 0; k < 64; k++) {
+		c = coef[zigzag[k]] * qr[t][k];
+		zz[k] = c < 0 ? (int) (c - 0.5f) : (int) (c + 0.5f);
+	}
+	d = zz[0] - *pred;
+	*pred = zz[0];
+	s = nbits(d);
+	put_bits(hdc[t].code[s], hdc[t].len[s]);
+	put_value(d, s);
+	for (k = 1; k < 64; k++) {
+		if (zz[k] == 0) {
+			r++;
+			continue;
+		}
+		for (; r > 15; r -= 16)
+			put_bits(hac[t].code[0xf0], hac[t].len[0xf0]);
+		s = nbits(zz[k]);
+		put_bits(hac[t].code[(r << 4) | s], hac[t].len[(r << 4) | s]);
+		put_value(zz[k], s);
+		r = 0;
+	}
+	if (r)
+		put_bits(hac[t].code[0], hac[t].len[0]);
+	return zz[0];
+}
+
+static uint8_t *put_marker(uint8_t *p, int marker, int len)
+{
+	*p++ = 0xff;
+	*p++ = marker;
+	*p++ = len >> 8;
+	*p++ = len;
+	return p;
+}
+
+static void encoder_init(void)
+{
+	const uint8_t *p = mjpeg_std_dht;
+	int u, x, t, k, q;
+
+	for (u = 0; u < 8; u++)
+		for (x = 0; x < 8; x++)
+			cosm[u][x] = (u ? 0.5 : 0.5 / sqrt(2)) * cos((2 * x + 1) * u * M_PI / 16);
+	for (t = 0; t < 2; t++)
+		for (k = 0; k < 64; k++) {
+			q = (std_qt[t][zigzag[k]] * (200 - 2 * TLB_QUALITY) + 50) / 100;
+			qt[t][k] = q < 1 ? 1 : q;
+			qr[t][k] = 1.0f / qt[t][k];
+		}
+	/* DC luma, AC luma, DC chroma, AC chroma */
+	huff_codes(&hdc[0], p + 1);
+	p += 17 + 12;
+	huff_codes(&hac[0], p + 1);
+	p += 17 + 162;
+	huff_codes(&hdc[1], p + 1);
+	p += 17 + 12;
+	huff_codes(&hac[1], p + 1);
+}
+
+/* the background without objects, at gain 1 */
+static void background(void)
+{
+	float px[64];
+	int bx, by, c, n = 0;
+
+	for (c = 0; c < 3; c++)
+		for (by = 0; by < TLB_H / 8; by++)
+			for (bx = 0; bx < (c ? TLB_W / 16 : TLB_W / 8); bx++) {
+				block_px(c, bx, by, -1, 1.0f, px);
+				fdct(px, bg[n++]);
+			}
+}
+
+/* sensor noise on the lowest frequencies; it is below the quantizer higher up */
+static void noise(float *coef)
+{
+	int k, n;
+
+	for (k = 0; k < 6; k++) {
+		n = (int) (tlb_rand() & 0xff) + (tlb_rand() & 0xff) + (tlb_rand() & 0xff) - 383;
+		coef[zigzag[k]] += n * (float) (TLB_NOISE / 128.0);
+	}
+}
+
+static uint32_t encode_frame(int k, uint8_t *dst_buf)
+{
+	static const uint8_t sof[] = { 8, TLB_H >> 8, TLB_H & 0xff, TLB_W >> 8, TLB_W & 0xff, 3,
+		1, 0x21, 0, 2, 0x11, 1, 3, 0x11, 1 };
+	static const uint8_t sos[] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+	float gain, px[64], coef[64];
+	int pred[3] = { 0, 0, 0 }, mx, my, c, bx, i, t, q;
+	uint8_t *p = dst_buf;
+
+	/* dawn: the light comes up by a fifth through the recording, and the
+	   exposure wavers a little */
+	gain = 0.9f + 0.2f * k / TLB_FRAMES + ((int) (tlb_rand() & 0xff) - 128) / 40000.0f;
+
+	*p++ = 0xff;
+	*p++ = 0xd8;
+	p = put_marker(p, 0xdb, 2 + 2 * 65);
+	for (t = 0; t < 2; t++) {
+		*p++ = t;
+		memcpy(p, qt[t], 64);
+		p += 64;
+	}
+	p = put_marker(p, 0xc0, 2 + sizeof(sof));
+	memcpy(p, sof, sizeof(sof));
+	p += sizeof(sof);
+	p = put_marker(p, 0xc4, 2 + sizeof(mjpeg_std_dht));
+	memcpy(p, mjpeg_std_dht, sizeof(mjpeg_std_dht));
+	p += sizeof(mjpeg_std_dht);
+	p = put_marker(p, 0xda, 2 + sizeof(sos));
+	memcpy(p, sos, sizeof(sos));
+	p += sizeof(sos);
+
+	out = p;
+	acc = 0;
+	acc_n = 0;
+	for (my = 0; my < TLB_H / 8; my++)
+		for (mx = 0; mx < TLB_W / 16; mx++)
+			for (c = 0; c < 4; c++) {
+				/* Y Y Cb Cr */
+				bx = c < 2 ? mx * 2 + c : mx;
+				t = c >= 2;
+				if (object_on(c < 2 ? 0 : c - 1, bx, my, k)) {
+					block_px(c < 2 ? 0 : c - 1, bx, my, k, gain, px);
+					fdct(px, coef);
+				} else if (c < 2) {
+					for (i = 0; i < 64; i++)
+						coef[i] = bg[my * (TLB_W / 8) + bx][i] * gain;
+				} else
+					memcpy(coef, bg[TLB_YBLOCKS + (c - 2) * TLB_CBLOCKS + my * (TLB_W / 16) + bx], sizeof(coef));
+				noise(coef);
+				q = encode_block(coef, t, &pred[c < 2 ? 0 : c - 1]);
+				if (c < 2 && k == 0) {
+					q *= qt[0][0];
+					seq_dc[my * (TLB_W / 8) + bx] = q > 1023 ? 1023 : q < -1024 ? -1024 : q;
+				}
+			}
+	put_bits(0x7f, 7);		/* pad with ones */
+	p = out;
+	*p++ = 0xff;
+	*p++ = 0xd9;
+	return p - dst_buf;
+}
+
+/* object o is in view in frame k, more than a sliver of it at the edge */
+static int object_seen(const tlb_object *o, int k, int *x)
+{
+	int l, r;
+
+	if (!object_at(o, k, x))
+		return 0;
+	l = *x < 0 ? 0 : *x;
+	r = *x + o->w > TLB_W ? TLB_W : *x + o->w;
+	return r - l >= 24;
+}
+
+/* the scene of frame k differs from that of k - 1 */
+static int scene_changed(int k)
+{
+	const tlb_object *o;
+	int a, b, xa, xb;
+	unsigned n;
+
+	for (n = 0; n < TLB_OBJECTS; n++) {
+		o = &objects[n];
+		a = object_seen(o, k, &xa);
+		b = object_seen(o, k - 1, &xb);
+		if (a != b || (a && xa != xb))
+			return 1;
+	}
+	return 0;
+}
+
+static int record_sequence(void)
+{
+	uint32_t len, total = 0;
+	int k;
+
+	encoder_init();
+	background();
+	seq = malloc(TLB_FRAMES * 128 * 1024);
+	if (seq == NULL)
+		return -1;
+	tlb_seed = 7;
+	for (k = 0; k < TLB_FRAMES; k++) {
+		seq_off[k] = total;
+		len = encode_frame(k, seq + total);
+		seq_hash[k] = fnv(seq + total, len);
+		seq_changed[k] = k && scene_changed(k);
+		total += len;
+	}
+	seq_off[k] = total;
+	return 0;
+}
+
+static uint32_t model_ms(const disk_stats *d)
+{
+	return ((uint64_t) d->writes * SD_WRITE_CMD_US + (uint64_t) d->write_sectors * SD_WRITE_SECTOR_US +
+		(uint64_t) d->reads * SD_READ_CMD_US + (uint64_t) d->read_sectors * SD_READ_SECTOR_US) / 1000;
+}
+
+static void report(const char *name, uint32_t bytes)
+{
+	printf("tl     %-6s %6u KB, %5u write cmds (%6u sectors) %5u read cmds (%5u sectors), card %6u ms\n",
+		name, bytes / 1024, dst.writes, dst.write_sectors, dst.reads, dst.read_sectors, model_ms(&dst));
+}
+
+/* the way the example stored frames */
+static int record_files(uint32_t *bytes)
+{
+	char name[32];
+	UINT bw;
+	int k;
+
+	*bytes = 0;
+	if (f_mkdir("0:img") != FR_OK)
+		return -1;
+	for (k = 0; k < TLB_FRAMES; k++) {
+		if (mount() != FR_OK)
+			return -1;
+		sprintf(name, "0:img/img%d.jpeg", k);
+		if (f_open(&fil, name, FA_OPEN_ALWAYS | FA_READ | FA_WRITE) != FR_OK)
+			return -1;
+		f_lseek(&fil, f_size(&fil));
+		if (f_write(&fil, seq + seq_off[k], seq_off[k + 1] - seq_off[k], &bw) != FR_OK)
+			return -1;
+		*bytes += bw;
+		f_close(&fil);
+	}
+	return 0;
+}
+
+static int record_tl(int permille, tl_stats_t *st)
+{
+	tl_config_t cfg = {
+		.width = TLB_W,
+		.height = TLB_H,
+		.cell_log2 = 1,
+		.level = 8,
+		.permille = permille,
+		.max_gap_ms = 60000,
+		.write_block = 32 * 1024,
+		.sync_ms = TLB_SYNC_MS,
+	};
+	int k, ret;
+
+	missed = 0;
+	if (f_open(&fil, "0:tl.mjp", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK ||
+			f_open(&idx, "0:tl.idx", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+		return -1;
+	if (tl_mux_open(&mux, &fil, &idx, &cfg, tl_buf, sizeof(tl_buf)) != FR_OK)
+		return -1;
+	for (k = 0; k < TLB_FRAMES; k++) {
+		now_ms = k * TLB_INTERVAL_MS;
+		if (tl_mux_frame(&mux, seq + seq_off[k], seq_off[k + 1] - seq_off[k], now_ms) != FR_OK)
+			break;
+		seq_stored[k] = mux.stored;
+		if (seq_changed[k] && !mux.stored) {
+			printf("tl     frame %d changed and was not stored (%d permille)\n", k, mux.changed);
+			missed++;
+		}
+	}
+	ret = tl_mux_close(&mux);
+	tl_mux_get_stats(&mux, st);
+	f_close(&fil);
+	f_close(&idx);
+	return ret;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* the index against the recording: every record a frame of it, in order and
+   back to back in the data file. Fill recs and return their number, or -1 */
+static int verify(void)
+{
+	tl_index_t *rec;
+	UINT br;
+	uint32_t end = 0, n, i;
+
+	rec_num = 0;
+	if (f_open(&fil, "0:tl.mjp", FA_READ) != FR_OK || f_open(&idx, "0:tl.idx", FA_READ) != FR_OK)
+		return -1;
+	n = (f_size(&idx) - TL_INDEX_HEADER) / TL_INDEX_RECORD;
+	for (i = 0; i < n; i++) {
+		rec = &recs[i];
+		if (f_lseek(&idx, TL_INDEX_HEADER + i * TL_INDEX_RECORD) != FR_OK ||
+				f_read(&idx, frame_buf, TL_INDEX_RECORD, &br) != FR_OK || br != TL_INDEX_RECORD)
+			break;
+		rec->offset = get32(frame_buf);
+		rec->size = get32(frame_buf + 4);
+		rec->time_ms = get32(frame_buf + 8);
+		rec->frame = get32(frame_buf + 12);
+		if (rec->offset != end || rec->frame >= TLB_FRAMES || (i && rec->frame <= rec[-1].frame) ||
+				rec->time_ms != rec->frame * TLB_INTERVAL_MS || rec->size != seq_off[rec->frame + 1] - seq_off[rec->frame])
+			break;
+		if (f_lseek(&fil, rec->offset) != FR_OK || f_read(&fil, frame_buf, rec->size, &br) != FR_OK ||
+				br != rec->size || fnv(frame_buf, rec->size) != seq_hash[rec->frame])
+			break;
+		end += rec->size;
+	}
+	rec_num = i;
+	if (i != n || end != f_size(&fil))
+		n = -1;
+	f_close(&fil);
+	f_close(&idx);
+	return n;
+}
+
+/* tl_index_seek against a search of recs */
+static int check_seek(void)
+{
+	tl_index_t rec;
+	uint32_t t;
+	int i, n, expect, ret = 0;
+
+	if (f_open(&idx, "0:tl.idx", FA_READ) != FR_OK)
+		return -1;
+	for (i = 0; i < 1000; i++) {
+		t = tlb_rand() % (TLB_FRAMES * TLB_INTERVAL_MS + 5000);
+		for (expect = 0; expect + 1 < rec_num && recs[expect + 1].time_ms <= t; expect++)
+			;
+		n = tl_index_seek(&idx, t, &rec);
+		if (n != expect || memcmp(&rec, &recs[expect], sizeof(rec))) {
+			ret = -1;
+			break;
+		}
+	}
+	f_close(&idx);
+	return ret;
+}
+
+int sim_bench_tl(void)
+{
+	static const struct { const uint8_t *jpg; unsigned *len; } samples[] = {
+		{ PIC_320x240_1, &PIC_LEN_1 },
+		{ PIC_320x240_2, &PIC_LEN_2 },
+	};
+	mjpeg_dc_map_t map = { 0, cells, TLB_YBLOCKS };
+	tl_stats_t st;
+	uint64_t t0, ns;
+	uint32_t bytes, quiet = 0, quiet_skipped = 0, files_ms, writes;
+	int fail = 0, i, k, n, kept, lost, worst = 0;
+
+	frame_buf = malloc(128 * 1024);
+	t0 = sim_host_ns();
+	if (frame_buf == NULL || record_sequence() < 0)
+		return -1;
+	printf("tl     recorded %u frames %ux%u 4:2:2 in %u ms, %u KB per frame\n", TLB_FRAMES, TLB_W, TLB_H,
+		(unsigned) ((sim_host_ns() - t0) / 1000000), seq_off[TLB_FRAMES] / TLB_FRAMES / 1024);
+
+	/* the map is the encoder's DC values, and parses the camera samples */
+	if (mjpeg_dc_map(&dc, seq, seq_off[1], &map) != 0 || map.cols != TLB_W / 8 || map.rows != TLB_H / 8 ||
+			memcmp(cells, seq_dc, sizeof(seq_dc))) {
+		printf("tl     DC map differs from the encoder's\n");
+		fail = 1;
+	}
+	for (i = 0; i < 2; i++) {
+		n = mjpeg_dc_map(&dc, samples[i].jpg, *samples[i].len, &map);
+		if (n || map.width != 320 || map.height != 240 || map.cols != 40 || map.rows != 30) {
+			printf("tl     sample %d: %d\n", i + 1, n);
+			fail = 1;
+		}
+	}
+	map.cell_log2 = 1;
+	t0 = sim_host_ns();
+	for (k = 0; k < TLB_FRAMES; k++)
+		mjpeg_dc_map(&dc, seq + seq_off[k], seq_off[k + 1] - seq_off[k], &map);
+	ns = sim_host_ns() - t0;
+	printf("tl     DC map %u us per frame, %u MB/s\n", (unsigned) (ns / TLB_FRAMES / 1000),
+		(unsigned) ((uint64_t) seq_off[TLB_FRAMES] * 1000 / (ns + 1)));
+
+	ram = calloc(FS_SECTORS, 512);
+	if (ram == NULL || FATFS_RegisterDiskDriver(&ram_disk) != 0)
+		return -1;
+
+	/* a file per frame */
+	ram_format();
+	mount();
+	memset(&dst, 0, sizeof(dst));
+	if (record_files(&bytes) < 0) {
+		printf("tl     files failed\n");
+		fail = 1;
+	}
+	report("files", bytes);
+	files_ms = model_ms(&dst);
+
+	/* every frame, then the changed ones */
+	for (i = 0; i < 2; i++) {
+		ram_format();
+		mount();
+		memset(&dst, 0, sizeof(dst));
+		memset(&st, 0, sizeof(st));
+		t0 = sim_host_ns();
+		if (record_tl(i ? 10 : 0, &st) != FR_OK || st.unparsed || missed)
+			fail = 1;
+		ns = sim_host_ns() - t0;
+		report(i ? "tl" : "all", st.bytes);
+		n = verify();
+		printf("tl     %-6s %u stored %u skipped, %u f_write %u f_sync, %d records, host %u us per frame\n",
+			i ? "tl" : "all", st.stored, st.skipped, st.writes, st.syncs, n, (unsigned) (ns / TLB_FRAMES / 1000));
+		if (n != (int) st.stored)
+			fail = 1;
+	}
+	for (k = 1; k < TLB_FRAMES; k++)
+		if (!seq_changed[k]) {
+			quiet++;
+			quiet_skipped += !seq_stored[k];
+		}
+	printf("tl     stored %u KB of %u (%u%%), card time %u%% of files; %u of %u unchanged frames skipped\n",
+		st.bytes / 1024, st.in_bytes / 1024, (unsigned) ((uint64_t) st.bytes * 100 / st.in_bytes),
+		model_ms(&dst) * 100 / files_ms, quiet_skipped, quiet);
+	if (check_seek() < 0) {
+		printf("tl     index seek failed\n");
+		fail = 1;
+	}
+	memcpy(full, recs, sizeof(full));
+	full_num = rec_num;
+
+	/* power cuts: the records left are the first of the full run, and only
+	   frames stored since the last sync but one are missing */
+	writes = dst.writes;
+	for (i = 1; i <= TLB_CUTS; i++) {
+		ram_format();
+		mount();
+		memset(&dst, 0, sizeof(dst));
+		cut_after = writes * i / (TLB_CUTS + 1);
+		cut_ms = 0;
+		record_tl(10, &st);
+		cut_after = 0;
+
+		mount();
+		if (f_open(&fil, "0:tl.mjp", FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK ||
+				f_open(&idx, "0:tl.idx", FA_OPEN_EXISTING | FA_READ | FA_WRITE) != FR_OK) {
+			printf("tl     cut %d: no files\n", i);
+			fail = 1;
+			continue;
+		}
+		kept = tl_mux_recover(&fil, &idx);
+		f_close(&fil);
+		f_close(&idx);
+		n = verify();
+		for (lost = 0, k = kept; k < full_num && full[k].time_ms <= cut_ms; k++)
+			lost++;
+		printf("tl     cut at %7u ms: %3d records kept, %d stored frames lost\n", (unsigned) cut_ms, kept, lost);
+		if (kept < 0 || n != kept || memcmp(recs, full, kept * sizeof(tl_index_t)) ||
+				lost > TLB_SYNC_MS / TLB_INTERVAL_MS + 2) {
+			fail = 1;
+			continue;
+		}
+		if (worst < lost)
+			worst = lost;
+	}
+	printf("tl     power cuts: at most %d stored frames lost\n", worst);
+
+	f_mount(NULL, "0:", 1);
+	FATFS_UnRegisterDiskDriver(ram_disk.drv_num);
+	free(ram);
+	free(seq);
+	free(frame_buf);
+	return fail ? -1 : 0;
+}
@@ -0,0 +1,368 @@
+/*
+ * The reconnect path of main/src/fast_connect.c against a mocked WLAN
+ * driver, DHCP client and flash: the driver calls it makes, LwIP_DHCP(),
+ * LwIP_DHCP_Reboot() and the flash_api.h calls are defined here. The access
+ * point answers after WLAN_SCAN ticks for a full scan, WLAN_ASSOC for a join
+ * and WLAN_PBKDF2 more when the PMK has to be derived; the DHCP server after
+ * WLAN_REBOOT ticks for INIT-REBOOT and WLAN_DISCOVER for DISCOVER, with a
+ * WLAN_LEASE second lease renewed at half of it while the link is up. For
+ * each case the link drops as in user_main.c, fastConnectLinkDown() from
+ * WIFI_EVENT_DISCONNECT, and the reconnect task brings it back:
+ *
+ *   cold     the access point is off at power on: the first connect fails
+ *            and the reconnect task gets the address once it is back
+ *   boot     the first connect after another power on, nothing in flash
+ *   short    down after a minute: the cached BSSID and channel, INIT-REBOOT
+ *   renewed  down after more than the lease, renewed meanwhile: INIT-REBOOT
+ *   moved    the access point changed channel: a full scan, but no PMK
+ *            derivation and INIT-REBOOT
+ *   expired  the access point is off for longer than the lease: DISCOVER
+ *            without asking for the old address first
+ *
+ * The benchmark fails if a case makes other calls than these, if the
+ * flash sector is erased when the profile has not changed, or if the
+ * passphrase is in it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "iot_export.h"
+#include "flash_api.h"
+#include "device_lock.h"
+#include "lwip_netconf.h"
+#include "lwip/dhcp.h"
+#include <wifi/wifi_conf.h>
+#include <wlan_fast_connect/example_wlan_fast_connect.h>
+#include "fast_connect.h"
+
+#include "sim.h"
+
+#define WLAN_SCAN			2000
+#define WLAN_ASSOC			150
+#define WLAN_PBKDF2			3000
+#define WLAN_REBOOT			100
+#define WLAN_DISCOVER		1500
+#define WLAN_LEASE			600		/* seconds */
+#define WLAN_TIMEOUT		(3 * WLAN_LEASE * configTICK_RATE_HZ)
+
+static const char wlan_ssid[] = "sim";
+static const char wlan_password[] = "simsimsim";
+static const unsigned char wlan_bssid[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0xa0 };
+
+extern struct netif xnetif[NET_IF_NUM];
+
+/* The driver's PMK cache, see example_wlan_fast_connect.h */
+unsigned char psk_essid[NET_IF_NUM][NDIS_802_11_LENGTH_SSID + 4];
+unsigned char psk_passphrase[NET_IF_NUM][IW_PASSPHRASE_MAX_SIZE + 1];
+unsigned char wpa_global_PSK[NET_IF_NUM][A_SHA_DIGEST_LEN * 2];
+
+typedef struct {
+	uint32_t scans;
+	uint32_t cached;		/* joins of the BSSID on the one channel scanned */
+	uint32_t pbkdf2;
+	uint32_t reboots;
+	uint32_t naks;
+	uint32_t discovers;
+	uint32_t ips;
+	uint32_t erases;
+} wlan_counts;
+
+static wlan_counts wlan;
+static volatile int wlan_ap_up = 1;
+static uint8_t wlan_ap_channel = 6;
+static uint8_t wlan_pscan_channel;		/* 0: all of them */
+static struct dhcp wlan_dhcp;			/* stays DHCP_OFF for the lwIP timers */
+static TickType_t wlan_ack;
+static uint32_t wlan_leased;
+static uint8_t wlan_flash[FLASH_SECTOR_SIZE];
+
+/* The PMK of the access point, as the driver would derive it */
+static void wlan_pmk(unsigned char *pmk)
+{
+	int i;
+
+	for (i = 0; i < A_SHA_DIGEST_LEN * 2; i++)
+		pmk[i] = wlan_password[i % (sizeof(wlan_password) - 1)] ^ i;
+}
+
+/* Authenticate and associate, the PMK derived unless preset for the same
+   SSID and passphrase */
+static int wlan_join(const char *ssid, const char *password)
+{
+	unsigned char pmk[A_SHA_DIGEST_LEN * 2];
+
+	wlan_pmk(pmk);
+	vTaskDelay(WLAN_ASSOC);
+	if (strcmp(ssid, wlan_ssid) != 0 || strcmp(password, wlan_password) != 0)
+		return RTW_ERROR;
+	if (strcmp((char *) psk_essid[0], ssid) != 0 || strcmp((char *) psk_passphrase[0], password) != 0 ||
+			memcmp(wpa_global_PSK[0], pmk, sizeof(pmk)) != 0) {
+		wlan.pbkdf2++;
+		vTaskDelay(WLAN_PBKDF2);
+		strcpy((char *) psk_essid[0], ssid);
+		strcpy((char *) psk_passphrase[0], password);
+		memcpy(wpa_global_PSK[0], pmk, sizeof(pmk));
+	}
+	return RTW_SUCCESS;
+}
+
+int wifi_set_pscan_chan(__u8 *channel_list, __u8 *pscan_config, __u8 length)
+{
+	(void) pscan_config;
+
+	wlan_pscan_channel = (length == 1) ? channel_list[0] : 0;
+	return 0;
+}
+
+int wifi_connect_bssid(unsigned char bssid[ETH_ALEN], char *ssid, rtw_security_t security_type, char *password,
+	int bssid_len, int ssid_len, int password_len, int key_id, void *semaphore)
+{
+	uint8_t channel = wlan_pscan_channel;
+
+	wlan_pscan_channel = 0;
+	if (!wlan_ap_up || (channel != 0 && channel != wlan_ap_channel) || memcmp(bssid, wlan_bssid, ETH_ALEN) != 0) {
+		vTaskDelay(WLAN_ASSOC);
+		return RTW_ERROR;
+	}
+	wlan.cached++;
+	return wlan_join(ssid, password);
+}
+
+int wifi_connect(char *ssid, rtw_security_t security_type, char *password, int ssid_len, int password_len,
+	int key_id, void *semaphore)
+{
+	int up = wlan_ap_up;
+
+	wlan.scans++;
+	vTaskDelay(WLAN_SCAN);
+	if (!up)
+		return RTW_ERROR;
+	return wlan_join(ssid, password);
+}
+
+int wifi_get_setting(const char *ifname, rtw_wifi_setting_t *pSetting)
+{
+	(void) ifname;
+
+	memset(pSetting, 0, sizeof(*pSetting));
+	pSetting->channel = wlan_ap_channel;
+	return 0;
+}
+
+int wifi_get_ap_bssid(unsigned char *bssid)
+{
+	memcpy(bssid, wlan_bssid, ETH_ALEN);
+	return 0;
+}
+
+/* The server leases the address the netif already has */
+static uint8_t wlan_ack_lease(void)
+{
+	wlan_ack = xTaskGetTickCount();
+	wlan_leased = xnetif[0].ip_addr.addr;
+	wlan_dhcp.offered_t0_lease = WLAN_LEASE;
+	wlan_dhcp.lease_used = 0;
+	wlan.ips++;
+	return DHCP_ADDRESS_ASSIGNED;
+}
+
+uint8_t LwIP_DHCP(uint8_t idx, uint8_t dhcp_state)
+{
+	(void) idx;
+	(void) dhcp_state;
+
+	wlan.discovers++;
+	vTaskDelay(WLAN_DISCOVER);
+	return wlan_ack_lease();
+}
+
+uint8_t LwIP_DHCP_Reboot(uint8_t idx, uint32_t addr)
+{
+	wlan.reboots++;
+	vTaskDelay(WLAN_REBOOT);
+	if (addr == wlan_leased && xTaskGetTickCount() - wlan_ack < WLAN_LEASE * configTICK_RATE_HZ)
+		return wlan_ack_lease();
+	wlan.naks++;
+	return LwIP_DHCP(idx, DHCP_START);
+}
+
+void flash_erase_sector(flash_t *obj, uint32_t address)
+{
+	(void) obj;
+
+	if (address == FAST_RECONNECT_DATA) {
+		memset(wlan_flash, 0xff, sizeof(wlan_flash));
+		wlan.erases++;
+	}
+}
+
+int flash_stream_read(flash_t *obj, uint32_t address, uint32_t len, uint8_t *data)
+{
+	(void) obj;
+
+	memcpy(data, wlan_flash + (address - FAST_RECONNECT_DATA), len);
+	return 1;
+}
+
+/* NOR flash: a write only clears bits */
+int flash_stream_write(flash_t *obj, uint32_t address, uint32_t len, uint8_t *data)
+{
+	uint32_t i;
+
+	(void) obj;
+
+	for (i = 0; i < len; i++)
+		wlan_flash[address - FAST_RECONNECT_DATA + i] &= data[i];
+	return 1;
+}
+
+void device_mutex_lock(RT_DEV_LOCK_E device)
+{
+	(void) device;
+}
+
+void device_mutex_unlock(RT_DEV_LOCK_E device)
+{
+	(void) device;
+}
+
+/* What the driver and lwIP do when the link drops after 'up' ticks: the
+   client renewed at half the lease meanwhile and DHCP stopped, leaving
+   lease_used at the minutes since the last ACK. With 'off' the access point
+   goes away with it. */
+static void wlan_link_down(TickType_t up, int off)
+{
+	TickType_t now;
+
+	vTaskDelay(up);
+	now = xTaskGetTickCount();
+	while (now - wlan_ack >= WLAN_LEASE / 2 * configTICK_RATE_HZ)
+		wlan_ack += WLAN_LEASE / 2 * configTICK_RATE_HZ;
+	wlan_dhcp.lease_used = (now - wlan_ack) / (DHCP_COARSE_TIMER_SECS * configTICK_RATE_HZ);
+	if (off)
+		wlan_ap_up = 0;
+	fastConnectLinkDown();
+}
+
+static int wlan_check(const char *what, const wlan_counts *before, uint32_t ticks, const wlan_counts *expect)
+{
+	wlan_counts got = wlan;
+
+	got.scans -= before->scans;
+	got.cached -= before->cached;
+	got.pbkdf2 -= before->pbkdf2;
+	got.reboots -= before->reboots;
+	got.naks -= before->naks;
+	got.discovers -= before->discovers;
+	got.ips -= before->ips;
+	got.erases -= before->erases;
+
+	printf("wlan   %-7s IP after %5u ticks: %u scans, %u cached joins, %u PMK derived, %u INIT-REBOOT, "
+		"%u NAK, %u DISCOVER, %u flash erases\n",
+		what, (unsigned) ticks, got.scans, got.cached, got.pbkdf2, got.reboots, got.naks, got.discovers,
+		got.erases);
+
+	return memcmp(&got, expect, sizeof(got)) == 0 ? 0 : -1;
+}
+
+/* The profile keeps the PMK, not the passphrase */
+static int wlan_flash_check(void)
+{
+	size_t len = strlen(wlan_password), i;
+
+	for (i = 0; i + len <= sizeof(wlan_flash); i++) {
+		if (memcmp(wlan_flash + i, wlan_password, len) == 0) {
+			printf("wlan   passphrase in flash\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Power on: the driver's PMK cache and the flash sector empty */
+static void wlan_power_on(void)
+{
+	memset(psk_essid, 0, sizeof(psk_essid));
+	memset(psk_passphrase, 0, sizeof(psk_passphrase));
+	memset(wpa_global_PSK, 0, sizeof(wpa_global_PSK));
+	fastConnectErase();
+}
+
+/* Wait for the reconnect task to get an address */
+static int wlan_reconnect(const char *what, TickType_t start, const wlan_counts *before, const wlan_counts *expect)
+{
+	while (wlan.ips == before->ips && xTaskGetTickCount() - start < WLAN_TIMEOUT)
+		vTaskDelay(10);
+	if (wlan.ips == before->ips) {
+		printf("wlan   %s: no reconnect\n", what);
+		return -1;
+	}
+	return wlan_check(what, before, xTaskGetTickCount() - start, expect);
+}
+
+int sim_bench_wlan(void)
+{
+	static const wlan_counts boot = { 1, 0, 1, 0, 0, 1, 1, 1 };
+	static const wlan_counts reboot = { 0, 1, 0, 1, 0, 0, 1, 0 };
+	static const wlan_counts moved = { 1, 0, 0, 1, 0, 0, 1, 1 };
+	static const wlan_counts expired = { 0, 1, 0, 0, 0, 1, 1, 0 };
+	wlan_counts before;
+	TickType_t start;
+	int ret = 0;
+
+	memset(&wlan_dhcp, 0, sizeof(wlan_dhcp));
+	xnetif[0].dhcp = &wlan_dhcp;
+	wlan_power_on();
+
+	wlan_ap_up = 0;
+	if (fastConnectWifi(wlan_ssid, wlan_password, RTW_SECURITY_WPA2_AES_PSK) == 0) {
+		printf("wlan   cold: connected with the access point off\n");
+		ret = -1;
+	}
+	vTaskDelay(60 * configTICK_RATE_HZ);
+	/* as for expired, only the wait for the try after it is back counts */
+	before = wlan;
+	wlan_ap_up = 1;
+	if (wlan_reconnect("cold", xTaskGetTickCount(), &before, &boot) != 0)
+		ret = -1;
+
+	wlan_power_on();
+	before = wlan;
+	start = xTaskGetTickCount();
+	if (fastConnectWifi(wlan_ssid, wlan_password, RTW_SECURITY_WPA2_AES_PSK) != 0 ||
+			wlan_check("boot", &before, xTaskGetTickCount() - start, &boot) != 0)
+		ret = -1;
+
+	before = wlan;
+	wlan_link_down(60 * configTICK_RATE_HZ, 0);
+	if (wlan_reconnect("short", xTaskGetTickCount(), &before, &reboot) != 0)
+		ret = -1;
+
+	before = wlan;
+	wlan_link_down(WLAN_LEASE * 5 / 3 * configTICK_RATE_HZ, 0);
+	if (wlan_reconnect("renewed", xTaskGetTickCount(), &before, &reboot) != 0)
+		ret = -1;
+
+	before = wlan;
+	wlan_ap_channel = 11;
+	wlan_link_down(60 * configTICK_RATE_HZ, 0);
+	if (wlan_reconnect("moved", xTaskGetTickCount(), &before, &moved) != 0)
+		ret = -1;
+
+	wlan_link_down(60 * configTICK_RATE_HZ, 1);
+	vTaskDelay((WLAN_LEASE + 60) * configTICK_RATE_HZ);
+	/* the tries while it was off do not count, the wait for the next one does */
+	before = wlan;
+	wlan_ap_up = 1;
+	if (wlan_reconnect("expired", xTaskGetTickCount(), &before, &expired) != 0)
+		ret = -1;
+	if (wlan_flash_check() != 0)
+		ret = -1;
+
+	xnetif[0].dhcp = NULL;
+	return ret;
+}
@@ -0,0 +1,211 @@
+/*
+ * Host simulator: FreeRTOS on the POSIX port, the TLSF heap and lwIP with the
+ * Realtek sys_arch and ethernetif, for benchmarks that do not need a board.
+ *
+ *   freertos_sim [options] [sched] [heap] [tcp] [tcploss] [udp] [chksum] [iperf] [rx] [lock] [timers] [dns] [wlan]
+ *                [crypto] [pools] [mmf] [g711] [h264] [rtp] [fanout] [rate] [jitter] [fmp4] [mp3] [tl] [poll]
+ *
+ *   --real          tick from the wall clock instead of virtual time
+ *   --tap NAME      bridge netif 0 (10.0.0.1) to a TAP device and serve
+ *                   TCP port 5001 (sink) and UDP port 7 (echo) until killed
+ *   --latency T     wire latency in ticks (default 2)
+ *   --rate B        wire rate in bytes per tick, 0 = unlimited (default 2500)
+ *   --loss N        frames lost per 10000 (default 0)
+ *   --seed S        loss pattern (default 1)
+ *   --repeat N      run the benchmarks N times, to average host times
+ *
+ * Without benchmark names all of them run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sim.h"
+
+typedef struct {
+	const char *name;
+	int (*run)(void);
+} sim_bench;
+
+static const sim_bench benches[] = {
+	{ "sched",	sim_bench_sched },
+	{ "heap",	sim_bench_heap },
+	{ "tcp",	sim_bench_tcp },
+	{ "tcploss",	sim_bench_tcploss },
+	{ "udp",	sim_bench_udp },
+	{ "chksum",	sim_bench_chksum },
+	{ "iperf",	sim_bench_iperf },
+	{ "rx",		sim_bench_rx },
+	{ "lock",	sim_bench_lock },
+	{ "timers",	sim_bench_timers },
+	{ "dns",		sim_bench_dns },
+	{ "wlan",		sim_bench_wlan },
+	{ "crypto",	sim_bench_crypto },
+	{ "pools",	sim_bench_pools },
+	{ "mmf",	sim_bench_mmf },
+	{ "g711",	sim_bench_g711 },
+	{ "h264",	sim_bench_h264 },
+	{ "rtp",	sim_bench_rtp },
+	{ "fanout",	sim_bench_fanout },
+	{ "rate",	sim_bench_rate },
+	{ "jitter",	sim_bench_jitter },
+	{ "fmp4",	sim_bench_fmp4 },
+	{ "mp3",	sim_bench_mp3 },
+	{ "tl",		sim_bench_tl },
+	{ "poll",	sim_bench_poll },
+};
+
+#define BENCH_NUM	(sizeof(benches) / sizeof(benches[0]))
+
+static sim_wire_config wire = { 2, 2500, 0, 1 };
+static int selected[BENCH_NUM];
+static unsigned repeat = 1;
+static void *watched_task;
+static volatile uint32_t watched_switches;
+static volatile uint32_t all_switches;
+static int failures;
+
+void vApplicationIdleHook(void)
+{
+	vPortSimIdle();
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+	(void) pxTask;
+
+	printf("stack overflow in %s\n", pcTaskName);
+	abort();
+}
+
+void vSimTaskSwitchedIn(void *tcb)
+{
+	static void *last;
+
+	if (tcb != last) {
+		all_switches++;
+		if (tcb == watched_task)
+			watched_switches++;
+	}
+	last = tcb;
+}
+
+void sim_task_watch(void *task)
+{
+	watched_task = task;
+	watched_switches = 0;
+}
+
+uint32_t sim_task_switches(void)
+{
+	return watched_switches;
+}
+
+uint32_t sim_switches(void)
+{
+	return all_switches;
+}
+
+void vAssertCalled(const char *file, int line)
+{
+	printf("assert %s:%d\n", file, line);
+	abort();
+}
+
+static void bench_task(void *param)
+{
+	unsigned i, r;
+	TickType_t start = xTaskGetTickCount();
+	uint64_t ns = sim_host_ns();
+
+	(void) param;
+
+	printf("%s time, wire latency %u ticks, rate %u bytes per tick, loss %u/10000, seed %u\n",
+		xPortSimGetTimeMode() == portSIM_VIRTUAL_TIME ? "virtual" : "real",
+		wire.latency, wire.rate, wire.loss, wire.seed);
+
+	for (r = 0; r < repeat; r++) {
+		for (i = 0; i < BENCH_NUM; i++) {
+			if (selected[i] && benches[i].run() != 0) {
+				printf("%-6s FAILED\n", benches[i].name);
+				failures++;
+			}
+		}
+	}
+
+	printf("done in %u ticks, host %.1f ms\n",
+		(unsigned)(xTaskGetTickCount() - start), (double)(sim_host_ns() - ns) / 1e6);
+
+	vTaskEndScheduler();
+}
+
+static void usage(const char *prog)
+{
+	unsigned i;
+
+	printf("usage: %s [--real] [--tap NAME] [--latency T] [--rate B] [--loss N] [--seed S] [--repeat N] [bench...]\n", prog);
+	printf("benchmarks:");
+	for (i = 0; i < BENCH_NUM; i++)
+		printf(" %s", benches[i].name);
+	printf("\n");
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *tap = NULL;
+	int i, any = 0;
+	unsigned j;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--real") == 0)
+			vPortSimSetTimeMode(portSIM_REAL_TIME);
+		else if (strcmp(argv[i], "--tap") == 0 && i + 1 < argc)
+			tap = argv[++i];
+		else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc)
+			wire.latency = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			wire.rate = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc)
+			wire.loss = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			wire.seed = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			repeat = strtoul(argv[++i], NULL, 0);
+		else {
+			for (j = 0; j < BENCH_NUM; j++) {
+				if (strcmp(argv[i], benches[j].name) == 0)
+					break;
+			}
+			if (j == BENCH_NUM)
+				usage(argv[0]);
+			selected[j] = 1;
+			any = 1;
+		}
+	}
+
+	if (!any) {
+		for (j = 0; j < BENCH_NUM; j++)
+			selected[j] = 1;
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (sim_netif_init(&wire, tap) < 0)
+		return 1;
+
+	if (tap) {
+		printf("netif 0 is 10.0.0.1 on %s, TCP sink on port 5001, UDP echo on port 7\n", tap);
+		sim_bench_tap_servers();
+	}
+	else
+		xTaskCreate(bench_task, (const char *) "bench", 1024, NULL, tskIDLE_PRIORITY + 1, NULL);
+
+	vTaskStartScheduler();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,468 @@
+/*
+ * Simulated WLAN link for the host simulator.
+ *
+ * Implements the driver side of ethernetif.c (rltk_wlan_send/recv) over a
+ * wire between netif 0 and netif 1 of the same lwIP stack. Each direction is
+ * a ring of frames with a delivery tick, worked off by its own "wlan rx"
+ * task that calls ethernetif_recv() like the driver's rx thread does.
+ * Latency, rate and loss are in ticks, so in virtual time a transfer takes
+ * the same number of ticks on every run.
+ *
+ * With a TAP device netif 0 is bridged to the host instead: frames sent by
+ * netif 0 are written to the device, a host thread reads the device and
+ * raises a simulated interrupt for each frame.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "lwip/tcpip.h"
+#include "lwip/netif.h"
+#include "lwip/ip_addr.h"
+#include "netif/etharp.h"
+#include "ethernetif.h"
+#include "lwip_intf.h"
+#include "autoconf.h"
+
+#include "sim.h"
+
+#define SIM_WIRE_FRAMES		256		/* a key frame burst to four viewers */
+#define SIM_RX_TASK_PRIO	(configMAX_PRIORITIES - 1)
+
+typedef struct {
+	uint32_t due;
+	uint32_t len;
+	uint8_t data[MAX_ETH_MSG];
+} sim_frame;
+
+/* wire[i] carries the frames sent by netif i to its peer */
+typedef struct {
+	sim_frame frames[SIM_WIRE_FRAMES];
+	uint32_t head;
+	uint32_t count;
+	uint64_t busy_until;	/* in bytes at rate bytes per tick */
+	uint32_t tcp_ports;		/* TCP connection tcp_high belongs to */
+	uint32_t tcp_high;		/* end of the highest segment it sent */
+	SemaphoreHandle_t sem;
+	sim_wire_stats stats;
+} sim_wire;
+
+struct netif xnetif[NET_IF_NUM];
+
+static sim_wire wire[2];
+static sim_wire_config wire_config;
+static uint32_t loss_state;
+static int tap_fd = -1;
+static int netif_count;
+
+/* Frame handed to rltk_wlan_recv() by the rx task */
+static const sim_frame *rx_frame;
+
+static int peer(int idx)
+{
+	return idx ^ 1;
+}
+
+/* xorshift32, the loss pattern only depends on the seed and the frame order */
+static int lose_frame(void)
+{
+	if (wire_config.loss == 0)
+		return 0;
+
+	loss_state ^= loss_state << 13;
+	loss_state ^= loss_state >> 17;
+	loss_state ^= loss_state << 5;
+
+	return (loss_state % 10000) < wire_config.loss;
+}
+
+/*
+ * Count the TCP segments that start below the highest sequence number sent
+ * on this wire so far. Only the latest connection is followed, which is
+ * enough for one transfer at a time.
+ */
+static void wire_track_tcp(sim_wire *w, const uint8_t *frame, uint32_t len)
+{
+	const uint8_t *ip = frame + 14, *tcp;
+	uint32_t ihl, ports, seq, data;
+
+	if (len < 14 + 20 + 20 || frame[12] != 0x08 || frame[13] != 0x00 || ip[9] != 6)
+		return;
+	ihl = (ip[0] & 0x0f) * 4;
+	tcp = ip + ihl;
+	data = ((ip[2] << 8) | ip[3]) - ihl - (tcp[12] >> 4) * 4;
+	if ((int32_t) data <= 0)
+		return;
+
+	ports = (tcp[0] << 24) | (tcp[1] << 16) | (tcp[2] << 8) | tcp[3];
+	seq = (tcp[4] << 24) | (tcp[5] << 16) | (tcp[6] << 8) | tcp[7];
+	if (ports != w->tcp_ports) {
+		w->tcp_ports = ports;
+		w->tcp_high = seq;
+	}
+	if ((int32_t)(seq - w->tcp_high) < 0)
+		w->stats.tcp_rexmit++;
+	else
+		w->tcp_high = seq + data;
+}
+
+/* Called with interrupts masked */
+static sim_frame *wire_reserve(sim_wire *w, uint32_t len)
+{
+	sim_frame *f;
+	uint64_t start, now = xTaskGetTickCount();
+
+	if (w->count == SIM_WIRE_FRAMES) {
+		w->stats.overflow++;
+		return NULL;
+	}
+
+	f = &w->frames[(w->head + w->count) % SIM_WIRE_FRAMES];
+	f->len = len;
+
+	if (wire_config.rate) {
+		start = now * wire_config.rate;
+		if (start < w->busy_until)
+			start = w->busy_until;
+		w->busy_until = start + len;
+		f->due = (uint32_t)((w->busy_until + wire_config.rate - 1) / wire_config.rate) + wire_config.latency;
+	} else {
+		f->due = (uint32_t) now + wire_config.latency;
+	}
+
+	w->count++;
+	w->stats.tx_frames++;
+	w->stats.tx_bytes += len;
+
+	return f;
+}
+
+static void wire_rx_task(void *param)
+{
+	int idx = (int)(intptr_t) param;	/* wire, delivers to peer(idx) */
+	sim_wire *w = &wire[idx];
+	sim_frame *f;
+	TickType_t now;
+
+	for (;;) {
+		taskENTER_CRITICAL();
+		f = w->count ? &w->frames[w->head] : NULL;
+		taskEXIT_CRITICAL();
+
+		if (f == NULL) {
+			xSemaphoreTake(w->sem, portMAX_DELAY);
+			continue;
+		}
+
+		now = xTaskGetTickCount();
+		if ((int32_t)(f->due - now) > 0) {
+			vTaskDelay(f->due - now);
+			continue;
+		}
+
+		/* The slot stays reserved until the frame has been copied */
+		rx_frame = f;
+		ethernetif_recv(&xnetif[peer(idx)], f->len);
+		rx_frame = NULL;
+
+		taskENTER_CRITICAL();
+		w->head = (w->head + 1) % SIM_WIRE_FRAMES;
+		w->count--;
+		w->stats.rx_frames++;
+		taskEXIT_CRITICAL();
+	}
+}
+
+static void gather(uint8_t *dst, struct eth_drv_sg *sg_list, int sg_len, int total_len)
+{
+	int i, n;
+
+	for (i = 0; i < sg_len && total_len > 0; i++) {
+		n = (int) sg_list[i].len < total_len ? (int) sg_list[i].len : total_len;
+		memcpy(dst, (void *)(uintptr_t) sg_list[i].buf, n);
+		dst += n;
+		total_len -= n;
+	}
+}
+
+int rltk_wlan_send(int idx, struct eth_drv_sg *sg_list, int sg_len, int total_len)
+{
+	uint8_t buf[MAX_ETH_MSG];
+	sim_frame *f = NULL;
+
+	if (idx < 0 || idx >= netif_count || total_len > MAX_ETH_MSG)
+		return -1;
+
+	if (idx == 0 && tap_fd >= 0) {
+		gather(buf, sg_list, sg_len, total_len);
+		if (write(tap_fd, buf, total_len) != total_len)
+			return -1;
+		wire[0].stats.tx_frames++;
+		wire[0].stats.tx_bytes += total_len;
+		return 0;
+	}
+
+	gather(buf, sg_list, sg_len, total_len);
+
+	taskENTER_CRITICAL();
+	wire_track_tcp(&wire[idx], buf, total_len);
+	if (lose_frame()) {
+		/* Lost on the air, the sender does not know */
+		wire[idx].stats.lost++;
+	} else {
+		f = wire_reserve(&wire[idx], total_len);
+		if (f)
+			memcpy(f->data, buf, total_len);
+	}
+	taskEXIT_CRITICAL();
+
+	if (f)
+		xSemaphoreGive(wire[idx].sem);
+
+	return 0;
+}
+
+void rltk_wlan_recv(int idx, struct eth_drv_sg *sg_list, int sg_len)
+{
+	const uint8_t *src;
+	uint32_t left;
+	int i, n;
+
+	(void) idx;
+
+	if (rx_frame == NULL)
+		return;
+
+	src = rx_frame->data;
+	left = rx_frame->len;
+	for (i = 0; i < sg_len && left > 0; i++) {
+		n = sg_list[i].len < left ? sg_list[i].len : left;
+		memcpy((void *)(uintptr_t) sg_list[i].buf, src, n);
+		src += n;
+		left -= n;
+	}
+}
+
+unsigned char rltk_wlan_running(unsigned char idx)
+{
+	return idx < netif_count;
+}
+
+int netif_get_idx(struct netif *pnetif)
+{
+	int idx = pnetif - xnetif;
+
+	return (idx >= 0 && idx < NET_IF_NUM) ? idx : -1;
+}
+
+unsigned char *netif_get_hwaddr(int idx_wlan)
+{
+	return xnetif[idx_wlan].hwaddr;
+}
+
+/* Ethernet over MII is not simulated */
+int rltk_mii_send(struct eth_drv_sg *sg_list, int sg_len, int total_len)
+{
+	return -1;
+}
+
+void rltk_mii_recv(struct eth_drv_sg *sg_list, int sg_len)
+{
+}
+
+/*
+ * Both ends of the wire live in one stack, so plain lwIP routing would send
+ * a packet for the peer's address out of the peer itself. Route it out of the
+ * other end of the wire instead (LWIP_HOOK_IP4_ROUTE, see platform_opts.h).
+ */
+struct netif *sim_ip4_route(ip_addr_t *dest)
+{
+	int i;
+
+	if (netif_count < 2)
+		return NULL;
+
+	for (i = 0; i < netif_count; i++) {
+		if (ip_addr_cmp(dest, &xnetif[i].ip_addr))
+			return &xnetif[peer(i)];
+	}
+
+	return NULL;
+}
+
+/*
+ * TAP bridge
+ */
+static uint8_t tap_buf[MAX_ETH_MSG];
+static int tap_len;
+
+static void tap_interrupt(void *arg)
+{
+	sim_frame *f;
+	BaseType_t woken = pdFALSE;
+
+	(void) arg;
+
+	/* Host frames arrive on wire 1, which delivers to netif 0 */
+	f = wire_reserve(&wire[1], tap_len);
+	if (f) {
+		memcpy(f->data, tap_buf, tap_len);
+		xSemaphoreGiveFromISR(wire[1].sem, &woken);
+	}
+	portYIELD_FROM_ISR(woken);
+}
+
+static void *tap_reader(void *arg)
+{
+	int len;
+
+	(void) arg;
+
+	for (;;) {
+		len = read(tap_fd, tap_buf, sizeof(tap_buf));
+		if (len <= 0)
+			break;
+		tap_len = len;
+		vPortSimInterrupt(tap_interrupt, NULL);
+	}
+
+	return NULL;
+}
+
+static int tap_open(const char *name)
+{
+	struct ifreq ifr;
+	pthread_t thread;
+
+	tap_fd = open("/dev/net/tun", O_RDWR);
+	if (tap_fd < 0) {
+		perror("/dev/net/tun");
+		return -1;
+	}
+
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+	if (ioctl(tap_fd, TUNSETIFF, &ifr) < 0) {
+		perror("TUNSETIFF");
+		close(tap_fd);
+		tap_fd = -1;
+		return -1;
+	}
+
+	pthread_create(&thread, NULL, tap_reader, NULL);
+	pthread_detach(thread);
+
+	return 0;
+}
+
+int sim_netif_init(const sim_wire_config *config, const char *tap)
+{
+	struct ip_addr ipaddr, netmask, gw;
+	int i;
+
+	wire_config = *config;
+	loss_state = config->seed ? config->seed : 1;
+
+	if (tap) {
+		/* Host threads raise interrupts, time has to be real */
+		vPortSimSetTimeMode(portSIM_REAL_TIME);
+		if (tap_open(tap) < 0)
+			return -1;
+		netif_count = 1;
+	} else {
+		netif_count = 2;
+	}
+
+	tcpip_init(NULL, NULL);
+
+	for (i = 0; i < 2; i++) {
+		wire[i].sem = xSemaphoreCreateCounting(SIM_WIRE_FRAMES, 0);
+		xTaskCreate(wire_rx_task, (const char *) "wlan_rx", 512, (void *)(intptr_t) i, SIM_RX_TASK_PRIO, NULL);
+	}
+
+	for (i = 0; i < netif_count; i++) {
+		xnetif[i].name[0] = 'r';
+		xnetif[i].name[1] = '0' + i;
+		xnetif[i].hwaddr[0] = 0x02;
+		xnetif[i].hwaddr[5] = 0x01 + i;
+
+		ip4_addr_set_u32(&ipaddr, htonl(SIM_IP(1 + i)));
+		ip4_addr_set_u32(&netmask, htonl(0xffffff00UL));
+		ip4_addr_set_u32(&gw, htonl(SIM_IP(254)));
+
+		netif_add(&xnetif[i], &ipaddr, &netmask, &gw, NULL, ethernetif_init, tcpip_input);
+		netif_set_up(&xnetif[i]);
+	}
+	netif_set_default(&xnetif[0]);
+
+	return 0;
+}
+
+void sim_netif_get_stats(int idx, sim_wire_stats *stats)
+{
+	taskENTER_CRITICAL();
+	*stats = wire[idx].stats;
+	taskEXIT_CRITICAL();
+}
+
+void sim_netif_reset_stats(void)
+{
+	taskENTER_CRITICAL();
+	memset(&wire[0].stats, 0, sizeof(sim_wire_stats));
+	memset(&wire[1].stats, 0, sizeof(sim_wire_stats));
+	taskEXIT_CRITICAL();
+}
+
+uint32_t sim_netif_set_rate(uint32_t rate)
+{
+	uint32_t old;
+	int i;
+
+	taskENTER_CRITICAL();
+	old = wire_config.rate;
+	wire_config.rate = rate;
+	/* busy_until counts bytes at the old rate */
+	for (i = 0; i < 2; i++)
+		wire[i].busy_until = old ? wire[i].busy_until * rate / old : 0;
+	taskEXIT_CRITICAL();
+
+	return old;
+}
+
+uint32_t sim_netif_set_latency(uint32_t latency)
+{
+	uint32_t old;
+
+	taskENTER_CRITICAL();
+	old = wire_config.latency;
+	wire_config.latency = latency;
+	taskEXIT_CRITICAL();
+
+	return old;
+}
+
+uint32_t sim_netif_set_loss(uint32_t loss, uint32_t seed)
+{
+	uint32_t old;
+
+	if (seed == 0)
+		seed = wire_config.seed ? wire_config.seed : 1;
+
+	taskENTER_CRITICAL();
+	old = wire_config.loss;
+	wire_config.loss = loss;
+	loss_state = seed;
+	taskEXIT_CRITICAL();
+
+	return old;
+}
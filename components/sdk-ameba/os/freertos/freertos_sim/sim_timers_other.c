@@ -0,0 +1,66 @@
+/*
+ * The timeout implementation lwIP is not built with, for the lockstep check
+ * of sim_bench_timers.c: lwip_timers.c once more with LWIP_TIMERS_WHEEL
+ * flipped (the sorted list, or the wheel with VARIANT=nowheel) and what it
+ * defines renamed to other_. struct sys_timeo differs between the two, so
+ * its timeouts come from a pool of their own instead of MEMP_SYS_TIMEOUT.
+ */
+
+#define sys_timeouts_init			other_sys_timeouts_init
+#define sys_timeout					other_sys_timeout
+#define sys_timeout_debug			other_sys_timeout_debug
+#define sys_untimeout				other_sys_untimeout
+#define sys_timeouts_sleeptime		other_sys_timeouts_sleeptime
+#define sys_timeouts_mbox_fetch		other_sys_timeouts_mbox_fetch
+#define tcp_timer_needed			other_tcp_timer_needed
+#define memp_malloc					other_memp_malloc
+#define memp_free					other_memp_free
+
+#include "lwip/opt.h"
+
+#if LWIP_TIMERS_WHEEL
+#undef LWIP_TIMERS_WHEEL
+#define LWIP_TIMERS_WHEEL			0
+#else
+#undef LWIP_TIMERS_WHEEL
+#define LWIP_TIMERS_WHEEL			1
+#endif
+
+#include "lwip_timers.c"
+
+#include "sim.h"
+
+static struct sys_timeo other_pool[SIM_TIMERS_OTHER_NUM];
+static struct sys_timeo *other_free;
+
+void *other_memp_malloc(memp_t type)
+{
+	struct sys_timeo *t = other_free;
+
+	LWIP_UNUSED_ARG(type);
+	if (t != NULL)
+		other_free = t->next;
+	return t;
+}
+
+void other_memp_free(memp_t type, void *mem)
+{
+	struct sys_timeo *t = (struct sys_timeo *) mem;
+
+	LWIP_UNUSED_ARG(type);
+	t->next = other_free;
+	other_free = t;
+}
+
+/* Unlike sys_timeouts_init(), starts none of the stack's timers */
+void other_sys_timeouts_start(void)
+{
+	int i;
+
+	other_free = NULL;
+	for (i = 0; i < SIM_TIMERS_OTHER_NUM; i++)
+		other_memp_free(MEMP_SYS_TIMEOUT, &other_pool[i]);
+#if LWIP_TIMERS_WHEEL
+	wheel_now = sys_now();
+#endif
+}
@@ -0,0 +1,220 @@
+/* FreeRTOS includes */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#if defined(CONFIG_PLATFORM_8711B)
+#include "ameba_soc.h"
+#endif
+#include "freertos_trace.h"
+
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+#if configUSE_TRACE_RING && (configUSE_TRACE_FACILITY != 1)
+#error "configUSE_TRACE_RING needs configUSE_TRACE_FACILITY for the TCB numbers"
+#endif
+
+#if configUSE_TRACE_RING && (configTRACE_RING_SIZE & (configTRACE_RING_SIZE - 1))
+#error "configTRACE_RING_SIZE must be a power of 2"
+#endif
+
+/*
+ * Run time stats clock: the 32768Hz SYSTIMER (TIM0) keeps counting through
+ * tickless sleep, so idle time spent sleeping is still charged to the idle
+ * task. It is ~30 times finer than the tick, and 100 * 100 * (one stats
+ * period of 1000 ticks) still fits in the 32 bit arithmetic of
+ * vTaskGetRunTimeStats().
+ */
+uint32_t ulTraceRunTimeCounter(void)
+{
+	return SYSTIMER_TickGet();
+}
+
+#if configUSE_TRACE_RING
+
+#define TRACE_DUMP_PER_LINE		8
+#define TRACE_IRQ_NUM			64
+
+static trace_event_t trace_ring[configTRACE_RING_SIZE];
+static volatile uint32_t trace_head = 0;	/* events ever reserved */
+static volatile uint32_t trace_enabled = 0;
+
+void vTraceRecord(uint8_t type, uint8_t task, uint16_t arg)
+{
+	uint32_t idx, ts;
+	trace_event_t *ev;
+
+	if(!trace_enabled)
+		return;
+
+	/* Exception entry and return clear the exclusive monitor, so a
+	   preempted reservation retries with a fresh timestamp and slot order
+	   stays time order. */
+	do {
+		ts = DWT->CYCCNT;
+		idx = __LDREXW((uint32_t *)&trace_head);
+	} while(__STREXW(idx + 1, (uint32_t *)&trace_head));
+
+	ev = &trace_ring[idx & (configTRACE_RING_SIZE - 1)];
+	ev->timestamp = ts;
+	ev->type = type;
+	ev->task = task;
+	ev->arg = arg;
+}
+
+/*
+ * Peripheral ISRs are dispatched by ROM through UserIrqFunTable. While
+ * tracing, every registered entry is replaced by trace_irq_hook(), which
+ * finds its IRQ number in IPSR. Handlers registered after vTraceStart() are
+ * not traced until the next start. SysTick and PendSV are not in the table;
+ * their work shows up as READY and SWITCH_IN events.
+ */
+static IRQ_FUN trace_irq_orig[TRACE_IRQ_NUM];
+
+static u32 trace_irq_hook(void *Data)
+{
+	uint32_t irq = __get_IPSR() - 16;
+	u32 ret;
+
+	if(irq >= TRACE_IRQ_NUM || trace_irq_orig[irq] == NULL)
+		return 0;
+
+	vTraceRecord(TRACE_EV_ISR_ENTER, 0, (uint16_t)irq);
+	ret = trace_irq_orig[irq](Data);
+	vTraceRecord(TRACE_EV_ISR_EXIT, 0, (uint16_t)irq);
+
+	return ret;
+}
+
+static void trace_irq_hook_install(int install)
+{
+	int i;
+
+	for(i = 0; i < TRACE_IRQ_NUM; i++) {
+		if(install) {
+			if(UserIrqFunTable[i] == NULL || UserIrqFunTable[i] == trace_irq_hook)
+				continue;
+			/* the original must be visible before the hook can run */
+			trace_irq_orig[i] = UserIrqFunTable[i];
+			__DSB();
+			UserIrqFunTable[i] = trace_irq_hook;
+		}
+		else if(UserIrqFunTable[i] == trace_irq_hook) {
+			/* trace_irq_orig[] stays valid for a hook that is still running */
+			UserIrqFunTable[i] = trace_irq_orig[i];
+		}
+	}
+}
+#endif /* configUSE_TRACE_RING */
+
+/* portCONFIGURE_TIMER_FOR_RUN_TIME_STATS(), called from vTaskStartScheduler() */
+void vTraceInit(void)
+{
+#if configUSE_TRACE_RING
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+#if configUSE_TRACE_RING
+void vTraceStart(void)
+{
+	trace_irq_hook_install(1);
+	trace_enabled = 1;
+}
+
+void vTraceStop(void)
+{
+	trace_enabled = 0;
+	trace_irq_hook_install(0);
+}
+
+void vTraceClear(void)
+{
+	uint32_t enabled = trace_enabled;
+
+	trace_enabled = 0;
+	trace_head = 0;
+	trace_enabled = enabled;
+}
+
+void vTraceGetStatus(uint32_t *pulEnabled, uint32_t *pulEvents, uint32_t *pulLost)
+{
+	uint32_t head = trace_head;
+
+	*pulEnabled = trace_enabled;
+	*pulEvents = (head > configTRACE_RING_SIZE) ? configTRACE_RING_SIZE : head;
+	*pulLost = head - *pulEvents;
+}
+
+static void trace_dump_tasks(void)
+{
+	TaskStatus_t *pxTaskStatusArray;
+	UBaseType_t uxArraySize, x;
+	uint32_t ulTotalTime;
+
+	/* e.g. from vApplicationStackOverflowHook(), inside the context switch */
+	if(__get_IPSR() != 0) {
+		printf("#ERR no task list in handler mode\n\r");
+		return;
+	}
+
+	uxArraySize = uxTaskGetNumberOfTasks();
+	pxTaskStatusArray = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
+	if(pxTaskStatusArray == NULL) {
+		printf("#ERR no memory for task list\n\r");
+		return;
+	}
+
+	uxArraySize = uxTaskGetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalTime);
+	printf("#RUNTIME %u %u\n\r", (unsigned int)ulTotalTime, (unsigned int)TRACE_RUN_TIME_HZ);
+	for(x = 0; x < uxArraySize; x++) {
+		/* number, priority, free stack bytes at worst, run time, name */
+		printf("#TASK %u %u %u %u %s\n\r",
+			(unsigned int)(pxTaskStatusArray[x].xTaskNumber & 0xff),
+			(unsigned int)pxTaskStatusArray[x].uxCurrentPriority,
+			(unsigned int)(pxTaskStatusArray[x].usStackHighWaterMark * sizeof(StackType_t)),
+			(unsigned int)pxTaskStatusArray[x].ulRunTimeCounter,
+			pxTaskStatusArray[x].pcTaskName);
+	}
+
+	vPortFree(pxTaskStatusArray);
+}
+
+/*
+ * Print the ring on the log UART, between "#FRTRACE" and "#END" lines:
+ *   #FRTRACE <version> <cpu hz> <events> <lost>
+ *   #RUNTIME <total run time> <run time hz>
+ *   #TASK <number> <priority> <stack high-water bytes> <run time> <name>
+ *   #EV <hex of up to 8 little-endian trace_event_t>
+ * Recording is paused while dumping.
+ */
+void vTraceDump(void)
+{
+	uint32_t enabled = trace_enabled;
+	uint32_t head, count, i, j;
+	const uint8_t *p;
+
+	trace_enabled = 0;
+
+	head = trace_head;
+	count = (head > configTRACE_RING_SIZE) ? configTRACE_RING_SIZE : head;
+
+	printf("\n\r#FRTRACE 1 %u %u %u\n\r", (unsigned int)SystemCoreClock, (unsigned int)count, (unsigned int)(head - count));
+	trace_dump_tasks();
+
+	for(i = 0; i < count; i += TRACE_DUMP_PER_LINE) {
+		printf("#EV ");
+		for(j = i; j < count && j < i + TRACE_DUMP_PER_LINE; j++) {
+			p = (const uint8_t *)&trace_ring[(head - count + j) & (configTRACE_RING_SIZE - 1)];
+			printf("%02x%02x%02x%02x%02x%02x%02x%02x", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]);
+		}
+		printf("\n\r");
+	}
+	printf("#END\n\r");
+
+	trace_enabled = enabled;
+}
+#endif /* configUSE_TRACE_RING */
+
+#endif /* configGENERATE_RUN_TIME_STATS */
@@ -0,0 +1,74 @@
+#ifndef _FREERTOS_TRACE_H_
+#define _FREERTOS_TRACE_H_
+
+/*
+ * Run time stats clock and binary trace ring for FreeRTOS.
+ *
+ * This header is included at the end of FreeRTOSConfig.h, so it must only
+ * depend on <stdint.h>. The trace hooks below expand inside tasks.c and
+ * queue.c, where pxCurrentTCB and the queue handles are visible.
+ *
+ * Each event is 8 bytes. Writers reserve a slot with LDREX/STREX, so task,
+ * ISR and scheduler contexts can record without a critical section. The
+ * ring overwrites its oldest events; vTraceDump() stops recording while it
+ * prints the ring as hex lines on the log UART, which
+ * freertos_trace_decode.py turns into per-task CPU usage, latency
+ * histograms and stack high-water marks.
+ */
+
+#include <stdint.h>
+
+#ifndef configUSE_TRACE_RING
+#define configUSE_TRACE_RING			0
+#endif
+
+/* Number of events, must be a power of 2 */
+#ifndef configTRACE_RING_SIZE
+#define configTRACE_RING_SIZE			512
+#endif
+
+/* Frequency of the run time stats clock (SYSTIMER, TIM0) */
+#define TRACE_RUN_TIME_HZ				32768
+
+/* Event types, keep in sync with freertos_trace_decode.py */
+#define TRACE_EV_SWITCH_IN				1	/* task: task switched in */
+#define TRACE_EV_READY					2	/* task: task moved to a ready list */
+#define TRACE_EV_QUEUE_RX_BLOCK			3	/* arg: queue id, running task blocks on receive */
+#define TRACE_EV_QUEUE_TX_BLOCK			4	/* arg: queue id, running task blocks on send */
+#define TRACE_EV_DELAY					5	/* running task blocks in vTaskDelay(Until) */
+#define TRACE_EV_ISR_ENTER				6	/* arg: IRQ number */
+#define TRACE_EV_ISR_EXIT				7	/* arg: IRQ number */
+#define TRACE_EV_SLEEP					8	/* arg: ticks skipped by tickless idle */
+
+typedef struct {
+	uint32_t	timestamp;	/* CPU cycles (DWT CYCCNT), stops in sleep */
+	uint8_t		type;
+	uint8_t		task;		/* low 8 bits of the TCB number */
+	uint16_t	arg;
+} trace_event_t;
+
+void vTraceInit(void);
+uint32_t ulTraceRunTimeCounter(void);
+
+#if configUSE_TRACE_RING
+void vTraceRecord(uint8_t type, uint8_t task, uint16_t arg);
+void vTraceStart(void);
+void vTraceStop(void);
+void vTraceClear(void);
+void vTraceDump(void);
+void vTraceGetStatus(uint32_t *pulEnabled, uint32_t *pulEvents, uint32_t *pulLost);
+
+/* Queue handles are heap pointers, word aligned */
+#define TRACE_QUEUE_ID(pxQueue)			((uint16_t)((uint32_t)(pxQueue) >> 2))
+
+#define traceTASK_SWITCHED_IN()					vTraceRecord(TRACE_EV_SWITCH_IN, (uint8_t)pxCurrentTCB->uxTCBNumber, 0)
+/* prvAddTaskToReadyList() does not put a ';' after this hook */
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB)	vTraceRecord(TRACE_EV_READY, (uint8_t)(pxTCB)->uxTCBNumber, 0);
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)	vTraceRecord(TRACE_EV_QUEUE_RX_BLOCK, 0, TRACE_QUEUE_ID(pxQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)	vTraceRecord(TRACE_EV_QUEUE_TX_BLOCK, 0, TRACE_QUEUE_ID(pxQueue))
+#define traceTASK_DELAY()						vTraceRecord(TRACE_EV_DELAY, 0, 0)
+#define traceTASK_DELAY_UNTIL()					vTraceRecord(TRACE_EV_DELAY, 0, 0)
+#define traceINCREASE_TICK_COUNT(x)				vTraceRecord(TRACE_EV_SLEEP, 0, (uint16_t)((x) > 0xffff ? 0xffff : (x)))
+#endif
+
+#endif //_FREERTOS_TRACE_H_
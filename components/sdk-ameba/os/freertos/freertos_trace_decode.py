@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""Decode a FreeRTOS trace ring dump (ATST=dump, or the stack overflow hook).
+
+The ring is built with configUSE_TRACE_RING 1 in FreeRTOSConfig.h, off by
+default.
+
+Usage: freertos_trace_decode.py [--tick-hz 1000] [log file]
+
+Reads the UART log (stdin if no file is given), takes the last block between
+"#FRTRACE" and "#END", and prints:
+  - per-task CPU usage inside the trace window, the kernel run time share
+    since boot and the stack high-water mark,
+  - per-IRQ count and time,
+  - histograms of scheduling latency (ready -> running), queue blocking time
+    (blocked -> ready) per queue and ISR duration.
+
+The event layout and types must match freertos_trace.h.
+"""
+
+import argparse
+import struct
+import sys
+from collections import defaultdict
+
+EV_SWITCH_IN = 1
+EV_READY = 2
+EV_QUEUE_RX_BLOCK = 3
+EV_QUEUE_TX_BLOCK = 4
+EV_DELAY = 5
+EV_ISR_ENTER = 6
+EV_ISR_EXIT = 7
+EV_SLEEP = 8
+
+EVENT = struct.Struct('<IBBH')
+
+
+class Histogram(object):
+    """Power of 2 buckets in microseconds"""
+
+    BUCKETS = 18
+
+    def __init__(self):
+        self.counts = [0] * self.BUCKETS
+        self.total = 0.0
+        self.max = 0.0
+        self.n = 0
+
+    def add(self, us):
+        b = 0
+        while b < self.BUCKETS - 1 and us >= (1 << b):
+            b += 1
+        self.counts[b] += 1
+        self.total += us
+        self.max = max(self.max, us)
+        self.n += 1
+
+    def show(self, title):
+        print('  %s: n=%d avg=%.1fus max=%.1fus' % (title, self.n, self.total / self.n, self.max))
+        for b, c in enumerate(self.counts):
+            if not c:
+                continue
+            lo = 0 if b == 0 else 1 << (b - 1)
+            hi = '' if b == self.BUCKETS - 1 else '%d' % (1 << b)
+            bar = '#' * max(1, c * 40 // self.n)
+            print('    %7d-%-7s us %7d %s' % (lo, hi, c, bar))
+
+
+def read_dump(lines):
+    dump = None
+    for line in lines:
+        pos = line.find('#')
+        if pos < 0:
+            continue
+        fields = line[pos:].strip().split(None, 5)
+        tag = fields[0]
+        if tag == '#FRTRACE':
+            dump = {'hz': int(fields[2]), 'lost': int(fields[4]), 'tasks': {},
+                    'runtime': (0, 1), 'events': bytearray(), 'done': False}
+        elif dump is None or dump['done']:
+            continue
+        elif tag == '#RUNTIME':
+            dump['runtime'] = (int(fields[1]), int(fields[2]))
+        elif tag == '#TASK':
+            name = fields[5] if len(fields) > 5 else '?'
+            dump['tasks'][int(fields[1])] = {'prio': int(fields[2]), 'hwm': int(fields[3]),
+                                             'runtime': int(fields[4]), 'name': name}
+        elif tag == '#EV' and len(fields) > 1:
+            dump['events'] += bytearray.fromhex(fields[1])
+        elif tag == '#END':
+            dump['done'] = True
+    if dump is None or not dump['done']:
+        sys.exit('no complete #FRTRACE ... #END block found')
+    return dump
+
+
+def decode(dump, tick_hz):
+    us_per_cycle = 1e6 / dump['hz']
+    task_time = defaultdict(float)
+    switches = defaultdict(int)
+    irq_time = defaultdict(float)
+    irq_count = defaultdict(int)
+    sleep_time = defaultdict(float)
+    sched_lat = Histogram()
+    isr_len = Histogram()
+    queue_block = defaultdict(Histogram)
+    ready_at = {}
+    blocked = {}
+    isr_stack = []
+    current = None
+
+    now = 0.0
+    last_ts = None
+    for (ts, typ, task, arg) in EVENT.iter_unpack(bytes(dump['events'])):
+        # CYCCNT wraps every 2^32 cycles and stops in sleep, SLEEP adds the skipped ticks
+        if last_ts is not None:
+            dt = ((ts - last_ts) & 0xffffffff) * us_per_cycle
+            if isr_stack:
+                irq_time[isr_stack[-1][0]] += dt
+            elif current is not None:
+                task_time[current] += dt
+            now += dt
+        last_ts = ts
+
+        if typ == EV_SWITCH_IN:
+            current = task
+            switches[task] += 1
+            if task in ready_at:
+                sched_lat.add(now - ready_at.pop(task))
+        elif typ == EV_READY:
+            ready_at[task] = now
+            if task in blocked:
+                what, since = blocked.pop(task)
+                if what is not None:
+                    queue_block[what].add(now - since)
+        elif typ in (EV_QUEUE_RX_BLOCK, EV_QUEUE_TX_BLOCK) and current is not None:
+            what = '%s q%05x' % ('rx' if typ == EV_QUEUE_RX_BLOCK else 'tx', arg << 2)
+            blocked[current] = (what, now)
+        elif typ == EV_DELAY and current is not None:
+            blocked[current] = (None, now)
+        elif typ == EV_ISR_ENTER:
+            isr_stack.append((arg, now))
+            irq_count[arg] += 1
+        elif typ == EV_ISR_EXIT:
+            if isr_stack and isr_stack[-1][0] == arg:
+                isr_len.add(now - isr_stack.pop()[1])
+        elif typ == EV_SLEEP:
+            slept = arg * 1e6 / tick_hz
+            if current is not None:
+                sleep_time[current] += slept
+            now += slept
+
+    window = max(now, 1e-9)
+    return {'window': window, 'task_time': task_time, 'switches': switches,
+            'irq_time': irq_time, 'irq_count': irq_count, 'sleep_time': sleep_time,
+            'sched_lat': sched_lat, 'isr_len': isr_len, 'queue_block': queue_block}
+
+
+def report(dump, r):
+    tasks = dump['tasks']
+    total, rt_hz = dump['runtime']
+    window = r['window']
+    nevents = len(dump['events']) // EVENT.size
+
+    print('trace: %d events, %d lost, %.1f ms, cpu %d Hz' % (nevents, dump['lost'], window / 1000, dump['hz']))
+    print('')
+    print('%-3s %-12s %4s %8s %8s %8s %8s %6s' % ('#', 'task', 'prio', 'trace%', 'sleep%', 'boot%', 'stack', 'sw'))
+    numbers = sorted(set(tasks) | set(r['task_time']),
+                     key=lambda n: -(r['task_time'].get(n, 0) + r['sleep_time'].get(n, 0)))
+    for n in numbers:
+        t = tasks.get(n, {'name': '?', 'prio': -1, 'hwm': -1, 'runtime': 0})
+        print('%-3d %-12s %4d %7.1f%% %7.1f%% %7.1f%% %8d %6d' % (
+            n, t['name'], t['prio'],
+            100.0 * r['task_time'].get(n, 0) / window,
+            100.0 * r['sleep_time'].get(n, 0) / window,
+            100.0 * t['runtime'] / total if total else 0.0,
+            t['hwm'], r['switches'].get(n, 0)))
+    print('(stack = fewest free bytes ever seen, boot%% = kernel run time since boot at %d Hz)' % rt_hz)
+
+    if r['irq_count']:
+        print('')
+        print('%-5s %8s %8s' % ('irq', 'count', 'time%'))
+        for irq in sorted(r['irq_count']):
+            print('%-5d %8d %7.2f%%' % (irq, r['irq_count'][irq], 100.0 * r['irq_time'][irq] / window))
+
+    print('')
+    if r['sched_lat'].n:
+        r['sched_lat'].show('scheduling latency (ready -> running)')
+    if r['isr_len'].n:
+        r['isr_len'].show('ISR duration')
+    for what in sorted(r['queue_block']):
+        r['queue_block'][what].show('blocked on %s' % what)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('log', nargs='?', help='UART log, stdin if omitted')
+    parser.add_argument('--tick-hz', type=int, default=1000, help='configTICK_RATE_HZ')
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, 'r', errors='replace') as f:
+            dump = read_dump(f)
+    else:
+        dump = read_dump(sys.stdin)
+    report(dump, decode(dump, args.tick_hz))
+
+
+if __name__ == '__main__':
+    main()
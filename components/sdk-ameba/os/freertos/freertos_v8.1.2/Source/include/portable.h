@@ -393,6 +393,37 @@ void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 
+#if( configUSE_TLSF_HEAP == 1 )
+	/* Used by heap_tlsf.c. */
+	typedef struct xHEAP_STATS
+	{
+		size_t xTotalBytes;				/*<< Bytes in all heap regions. */
+		size_t xFreeBytes;
+		size_t xMinimumEverFreeBytes;
+		size_t xLargestFreeBlock;		/*<< Largest single allocation that can succeed now. */
+		size_t xFreeBlocks;
+		uint32_t ulAllocs;
+		uint32_t ulFrees;
+		uint32_t ulFailures;
+	} HeapStats_t;
+
+	size_t xPortGetLargestFreeBlockSize( void ) PRIVILEGED_FUNCTION;
+	void vPortGetHeapStats( HeapStats_t *pxHeapStats ) PRIVILEGED_FUNCTION;
+
+	/* Bytes currently allocated by a task, NULL for the calling task. */
+	size_t xPortGetTaskHeapBytes( void *xTask ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Separate TLSF heaps in a caller supplied buffer (TCM for example).  The
+	 * control structure is placed at the start of the buffer.  These functions
+	 * do not lock, the caller must serialise access to a heap.
+	 */
+	void *pvPortTlsfCreate( void *pvMemory, size_t xBytes ) PRIVILEGED_FUNCTION;
+	void *pvPortTlsfMalloc( void *pvHeap, size_t xWantedSize ) PRIVILEGED_FUNCTION;
+	void vPortTlsfFree( void *pvHeap, void *pv ) PRIVILEGED_FUNCTION;
+	size_t xPortTlsfGetFreeSize( void *pvHeap ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
@@ -0,0 +1,469 @@
+/*
+ * FreeRTOS port for Linux/POSIX hosts.
+ *
+ * Every task runs on its own pthread, but only the thread of pxCurrentTCB is
+ * let run: a context switch wakes the next thread and parks the current one
+ * on its condition variable. The simulator lock stands for the interrupt
+ * mask: critical sections take it, and so does every "interrupt", which is a
+ * host thread calling vPortSimInterrupt() (the tick thread, a TAP reader).
+ * A yield requested inside a critical section or by an interrupt is carried
+ * out when the running task leaves its critical section or makes its next
+ * kernel call, there is no asynchronous preemption of plain C code.
+ *
+ * Two time modes:
+ *
+ *   portSIM_REAL_TIME     a thread ticks at configTICK_RATE_HZ of wall time,
+ *                         the idle task sleeps until the next interrupt.
+ *   portSIM_VIRTUAL_TIME  no tick thread, the idle task advances the tick by
+ *                         one on every pass. Code takes no simulated time, a
+ *                         task only sees time pass while everything else is
+ *                         blocked, and as long as no host thread raises
+ *                         interrupts every run is identical.
+ *
+ * The idle hook of the application must call vPortSimIdle().
+ *
+ * The task threads run on stacks mapped below 4GB: like the static data of a
+ * -no-pie binary, buffers on them can pass through the 32 bit pointer fields
+ * of the Realtek code (struct eth_drv_sg for example).
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#ifndef configSIM_TIME_MODE
+	#define configSIM_TIME_MODE		portSIM_VIRTUAL_TIME
+#endif
+
+/* Host stack of each task thread, the FreeRTOS stack only holds the
+thread state pointer and the overflow check pattern. */
+#ifndef configSIM_THREAD_STACK_SIZE
+	#define configSIM_THREAD_STACK_SIZE	( 256 * 1024 )
+#endif
+
+typedef struct SIM_THREAD
+{
+	pthread_t xThread;
+	pthread_cond_t xCond;
+	void *pvStack;
+	TaskFunction_t pxCode;
+	void *pvParameters;
+	volatile BaseType_t xResume;	/*<< Set by the task switching to this one. */
+	volatile BaseType_t xExit;		/*<< Set when the TCB is freed. */
+	struct SIM_THREAD *pxNextZombie;
+} SimThread_t;
+
+extern void * volatile pxCurrentTCB;
+
+static pthread_mutex_t xSimMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t xIrqOwner;
+static UBaseType_t uxIrqDepth = 0;
+
+/* Signalled on every interrupt, for the idle task in real time mode. */
+static pthread_cond_t xIrqCond = PTHREAD_COND_INITIALIZER;
+static uint32_t ulIrqCount = 0;
+
+/* Signalled by vPortEndScheduler() for the thread blocked in
+xPortStartScheduler(). */
+static pthread_cond_t xEndCond = PTHREAD_COND_INITIALIZER;
+static volatile BaseType_t xSchedulerEnded = pdFALSE;
+
+static volatile BaseType_t xSwitchPending = pdFALSE;
+static BaseType_t xTimeMode = configSIM_TIME_MODE;
+static BaseType_t xStarted = pdFALSE;
+static pthread_t xTickThread;
+
+static __thread SimThread_t *pxThisThread = NULL;
+
+/* Threads of deleted tasks, their stacks can only be unmapped once they have
+exited. */
+static SimThread_t *pxZombies = NULL;
+
+/*-----------------------------------------------------------*/
+
+static void prvLock( void )
+{
+	if( ( uxIrqDepth > 0 ) && pthread_equal( xIrqOwner, pthread_self() ) )
+	{
+		uxIrqDepth++;
+		return;
+	}
+
+	pthread_mutex_lock( &xSimMutex );
+	xIrqOwner = pthread_self();
+	uxIrqDepth = 1;
+}
+
+static BaseType_t prvUnlock( void )
+{
+	configASSERT( ( uxIrqDepth > 0 ) && pthread_equal( xIrqOwner, pthread_self() ) );
+
+	if( --uxIrqDepth == 0 )
+	{
+		pthread_mutex_unlock( &xSimMutex );
+		return pdTRUE;
+	}
+
+	return pdFALSE;
+}
+
+static BaseType_t prvLockHeld( void )
+{
+	return ( uxIrqDepth > 0 ) && pthread_equal( xIrqOwner, pthread_self() );
+}
+
+/* Wait on a condition with the lock held, whatever its depth. */
+static void prvCondWait( pthread_cond_t *pxCond )
+{
+UBaseType_t uxDepth = uxIrqDepth;
+
+	uxIrqDepth = 0;
+	pthread_cond_wait( pxCond, &xSimMutex );
+	xIrqOwner = pthread_self();
+	uxIrqDepth = uxDepth;
+}
+/*-----------------------------------------------------------*/
+
+static SimThread_t *prvThreadOf( void *pxTCB )
+{
+	/* The first member of the TCB is pxTopOfStack, which points at the
+	thread state pointer (see pxPortInitialiseStack()). */
+	return ( SimThread_t * ) **( StackType_t ** ) pxTCB;
+}
+
+/* Called with the lock held, returns once this thread is the running task. */
+static void prvWaitForTurn( SimThread_t *pxThread )
+{
+	while( ( pxThread->xResume == pdFALSE ) && ( pxThread->xExit == pdFALSE ) )
+	{
+		prvCondWait( &pxThread->xCond );
+	}
+
+	if( pxThread->xExit != pdFALSE )
+	{
+		pxThread->pxNextZombie = pxZombies;
+		pxZombies = pxThread;
+		uxIrqDepth = 0;
+		pthread_mutex_unlock( &xSimMutex );
+		pthread_exit( NULL );
+	}
+
+	pxThread->xResume = pdFALSE;
+}
+
+/* Run the scheduler and hand the CPU to the selected task. Called by the
+running task outside any critical section. */
+static void prvSwitch( void )
+{
+SimThread_t *pxNext;
+
+	prvLock();
+
+	while( xSwitchPending != pdFALSE )
+	{
+		xSwitchPending = pdFALSE;
+		vTaskSwitchContext();
+	}
+
+	pxNext = prvThreadOf( pxCurrentTCB );
+	if( pxNext != pxThisThread )
+	{
+		pxNext->xResume = pdTRUE;
+		pthread_cond_signal( &pxNext->xCond );
+		prvWaitForTurn( pxThisThread );
+	}
+
+	prvUnlock();
+}
+
+static void prvSwitchIfPending( void )
+{
+	if( ( xSwitchPending != pdFALSE ) && ( pxThisThread != NULL ) && ( xStarted != pdFALSE ) && ( prvLockHeld() == pdFALSE ) )
+	{
+		prvSwitch();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void *prvTaskThread( void *pvArg )
+{
+SimThread_t *pxThread = ( SimThread_t * ) pvArg;
+
+	pxThisThread = pxThread;
+
+	prvLock();
+	prvWaitForTurn( pxThread );
+	prvUnlock();
+
+	pxThread->pxCode( pxThread->pvParameters );
+
+	/* Tasks must not return, behave as if they deleted themselves. */
+	vTaskDelete( NULL );
+
+	return NULL;
+}
+
+static void prvReapZombies( void )
+{
+SimThread_t *pxThread;
+
+	prvLock();
+	while( pxZombies != NULL )
+	{
+		pxThread = pxZombies;
+		pxZombies = pxThread->pxNextZombie;
+
+		pthread_join( pxThread->xThread, NULL );
+		munmap( pxThread->pvStack, configSIM_THREAD_STACK_SIZE );
+		pthread_cond_destroy( &pxThread->xCond );
+		free( pxThread );
+	}
+	prvUnlock();
+}
+
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+SimThread_t *pxThread;
+pthread_attr_t xAttr;
+
+	prvReapZombies();
+
+	pxThread = ( SimThread_t * ) calloc( 1, sizeof( SimThread_t ) );
+	configASSERT( pxThread );
+
+	pxThread->pvStack = mmap( NULL, configSIM_THREAD_STACK_SIZE, PROT_READ | PROT_WRITE,
+							  MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_32BIT, -1, 0 );
+	configASSERT( pxThread->pvStack != MAP_FAILED );
+
+	pxThread->pxCode = pxCode;
+	pxThread->pvParameters = pvParameters;
+	pthread_cond_init( &pxThread->xCond, NULL );
+
+	pthread_attr_init( &xAttr );
+	pthread_attr_setstack( &xAttr, pxThread->pvStack, configSIM_THREAD_STACK_SIZE );
+	if( pthread_create( &pxThread->xThread, &xAttr, prvTaskThread, pxThread ) != 0 )
+	{
+		configASSERT( 0 );
+	}
+	pthread_attr_destroy( &xAttr );
+
+	*pxTopOfStack = ( StackType_t ) pxThread;
+
+	return pxTopOfStack;
+}
+
+void vPortCleanUpTCB( void *pxTCB )
+{
+SimThread_t *pxThread = prvThreadOf( pxTCB );
+
+	/* The thread is parked in prvWaitForTurn(), it frees its own state. */
+	prvLock();
+	pxThread->xExit = pdTRUE;
+	pthread_cond_signal( &pxThread->xCond );
+	prvUnlock();
+}
+/*-----------------------------------------------------------*/
+
+static void prvTickInterrupt( void *pvArg )
+{
+	( void ) pvArg;
+
+	if( xTaskIncrementTick() != pdFALSE )
+	{
+		xSwitchPending = pdTRUE;
+	}
+}
+
+static void *prvTickThread( void *pvArg )
+{
+struct timespec xNext;
+const long lPeriod = 1000000000L / configTICK_RATE_HZ;
+
+	( void ) pvArg;
+
+	clock_gettime( CLOCK_MONOTONIC, &xNext );
+	while( xSchedulerEnded == pdFALSE )
+	{
+		xNext.tv_nsec += lPeriod;
+		if( xNext.tv_nsec >= 1000000000L )
+		{
+			xNext.tv_nsec -= 1000000000L;
+			xNext.tv_sec++;
+		}
+
+		while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &xNext, NULL ) == EINTR );
+
+		vPortSimInterrupt( prvTickInterrupt, NULL );
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortStartScheduler( void )
+{
+SimThread_t *pxFirst;
+
+	/* vTaskStartScheduler() has masked interrupts. */
+	prvLock();
+	xStarted = pdTRUE;
+
+	if( xTimeMode == portSIM_REAL_TIME )
+	{
+		pthread_create( &xTickThread, NULL, prvTickThread, NULL );
+	}
+
+	pxFirst = prvThreadOf( pxCurrentTCB );
+	pxFirst->xResume = pdTRUE;
+	pthread_cond_signal( &pxFirst->xCond );
+
+	while( xSchedulerEnded == pdFALSE )
+	{
+		prvCondWait( &xEndCond );
+	}
+
+	uxIrqDepth = 0;
+	pthread_mutex_unlock( &xSimMutex );
+
+	if( xTimeMode == portSIM_REAL_TIME )
+	{
+		pthread_join( xTickThread, NULL );
+	}
+
+	return 0;
+}
+
+void vPortEndScheduler( void )
+{
+	/* Called by a task with interrupts masked. The task threads are left
+	parked, the process is expected to exit once vTaskStartScheduler()
+	returns. */
+	prvLock();
+	xSchedulerEnded = pdTRUE;
+	pthread_cond_signal( &xEndCond );
+
+	if( pxThisThread != NULL )
+	{
+		for( ;; )
+		{
+			prvCondWait( &pxThisThread->xCond );
+		}
+	}
+
+	prvUnlock();
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+	xSwitchPending = pdTRUE;
+	prvSwitchIfPending();
+}
+
+void vPortYieldFromISR( void )
+{
+	xSwitchPending = pdTRUE;
+}
+
+void vPortEnterCritical( void )
+{
+	prvLock();
+}
+
+void vPortExitCritical( void )
+{
+	if( prvUnlock() != pdFALSE )
+	{
+		prvSwitchIfPending();
+	}
+}
+
+uint32_t ulPortSetInterruptMask( void )
+{
+	prvLock();
+	return 0;
+}
+
+void vPortClearInterruptMask( uint32_t ulNewMaskValue )
+{
+	( void ) ulNewMaskValue;
+
+	if( prvUnlock() != pdFALSE )
+	{
+		prvSwitchIfPending();
+	}
+}
+
+void vPortDisableInterrupts( void )
+{
+	if( prvLockHeld() == pdFALSE )
+	{
+		prvLock();
+	}
+}
+
+void vPortEnableInterrupts( void )
+{
+	if( prvLockHeld() != pdFALSE )
+	{
+		uxIrqDepth = 1;
+		prvUnlock();
+		prvSwitchIfPending();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortSimSetTimeMode( BaseType_t xMode )
+{
+	configASSERT( xStarted == pdFALSE );
+	xTimeMode = xMode;
+}
+
+BaseType_t xPortSimGetTimeMode( void )
+{
+	return xTimeMode;
+}
+
+void vPortSimInterrupt( void ( *pvHandler )( void * ), void *pvArg )
+{
+	prvLock();
+	pvHandler( pvArg );
+	ulIrqCount++;
+	pthread_cond_broadcast( &xIrqCond );
+	prvUnlock();
+
+	/* Only does something when a task raised the interrupt itself. */
+	prvSwitchIfPending();
+}
+
+void vPortSimIdle( void )
+{
+uint32_t ulSeen;
+
+	if( xTimeMode == portSIM_VIRTUAL_TIME )
+	{
+		/* Nothing else can run, let the next tick happen now. */
+		vPortSimInterrupt( prvTickInterrupt, NULL );
+	}
+	else
+	{
+		/* Sleep until the tick thread or another interrupt wakes a task. */
+		prvLock();
+		ulSeen = ulIrqCount;
+		while( ( ulIrqCount == ulSeen ) && ( xSwitchPending == pdFALSE ) )
+		{
+			prvCondWait( &xIrqCond );
+		}
+		prvUnlock();
+	}
+
+	prvSwitchIfPending();
+}
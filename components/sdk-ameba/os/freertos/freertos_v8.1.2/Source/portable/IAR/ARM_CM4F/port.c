@@ -643,6 +643,9 @@ void vApplicationStackOverflowHook( xTaskHandle pxTask, signed char *pcTaskName
 	configCHECK_FOR_STACK_OVERFLOW != 0 */
 
 	printf("\n\r[%s] STACK OVERFLOW - TaskName(%s)\n\r", __FUNCTION__, pcTaskName);
+#if configUSE_TRACE_RING
+	vTraceDump();
+#endif
 	for( ;; );
 }
 
@@ -196,6 +196,12 @@ HeapRegion_t xHeapRegions[] =
 	{ 0, 0},	// RDP reserved, will be corrected in pvPortMalloc()
 	{ NULL, 0 } 					// Terminates the array.
 };
+#elif (defined HEAP_REPLAY_HOST) || (defined CONFIG_PLATFORM_SIM)
+HeapRegion_t xHeapRegions[] =
+{
+	{ ucHeap, sizeof(ucHeap) },
+	{ NULL, 0 }
+};
 #else
 #error NOT SUPPORT CHIP
 #endif
@@ -0,0 +1,827 @@
+/*
+ * pvPortMalloc() on a TLSF (two-level segregated fit) allocator, a drop-in
+ * replacement for heap_5.c with the same heap regions.
+ *
+ * Free blocks are kept in segregated lists: the first level splits sizes by
+ * power of 2, the second level splits each power of 2 into
+ * tlsfSL_INDEX_COUNT linear ranges. Two bitmaps find a non-empty list that
+ * is large enough with a couple of CLZ instructions, so malloc and free run
+ * in bounded time whatever the heap looks like, and a request is served from
+ * the smallest class that fits instead of splitting the first big block in
+ * address order. Freed blocks are merged with both physical neighbours at
+ * once through the boundary tags.
+ *
+ * Block layout, 8 bytes of header like heap_5.c:
+ *
+ *   pxPrevPhys   only valid while the previous block is free
+ *   xSize        payload bytes | heap owner << 24 | PREV_FREE | FREE
+ *   payload      free blocks keep their list links here
+ *
+ * Every region ends with a zero sized used block, so no block is merged
+ * across regions.
+ *
+ * Each allocation is charged to the task that made it (see
+ * xPortGetTaskHeapBytes()). The owner slot of a task is cached in its
+ * uxTaskNumber, so configUSE_TRACE_FACILITY must be 1 and nothing else may
+ * use vTaskSetTaskNumber().
+ *
+ * The same allocator runs the TCM heap of tcm_heap.c, through the
+ * pvPortTlsf*() functions which leave locking to the caller.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "platform_opts.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if ( configUSE_TLSF_HEAP != 1 )
+	#error Define configUSE_TLSF_HEAP as 1 in FreeRTOSConfig.h when building heap_tlsf.c
+#endif
+
+#if ( configUSE_TRACE_FACILITY != 1 )
+	#error heap_tlsf.c keeps heap owners in uxTaskNumber, set configUSE_TRACE_FACILITY to 1
+#endif
+
+#if ( portBYTE_ALIGNMENT != 8 )
+	#error heap_tlsf.c is written for 8 byte alignment
+#endif
+
+/* Largest block is 2^configTLSF_FL_INDEX_MAX bytes, at most 2^24 because of
+the owner bits in xSize. */
+#ifndef configTLSF_FL_INDEX_MAX
+	#if defined CONFIG_PLATFORM_8195A
+		#define configTLSF_FL_INDEX_MAX		22
+	#else
+		#define configTLSF_FL_INDEX_MAX		18
+	#endif
+#endif
+
+#if ( configTLSF_FL_INDEX_MAX > 24 )
+	#error configTLSF_FL_INDEX_MAX must not exceed 24
+#endif
+
+/* Number of tasks whose heap usage is tracked, slot 0 collects the rest. */
+#ifndef configHEAP_OWNER_SLOTS
+	#define configHEAP_OWNER_SLOTS			32
+#endif
+
+#if ( configHEAP_OWNER_SLOTS > 256 )
+	#error configHEAP_OWNER_SLOTS must fit in 8 bits
+#endif
+
+/* Print every allocation and free as "#M <ptr> <size> <owner>" / "#F <ptr>"
+for the host replay tool in os/freertos/heap_replay. Very slow. */
+#ifndef configHEAP_TRACE
+	#define configHEAP_TRACE				0
+#endif
+
+#define tlsfALIGN_SIZE_LOG2		3
+#define tlsfALIGN_SIZE			( ( size_t ) 1 << tlsfALIGN_SIZE_LOG2 )
+#define tlsfSL_INDEX_COUNT_LOG2	4
+#define tlsfSL_INDEX_COUNT		( 1 << tlsfSL_INDEX_COUNT_LOG2 )
+#define tlsfFL_INDEX_SHIFT		( tlsfSL_INDEX_COUNT_LOG2 + tlsfALIGN_SIZE_LOG2 )
+#define tlsfFL_INDEX_COUNT		( configTLSF_FL_INDEX_MAX - tlsfFL_INDEX_SHIFT + 1 )
+#define tlsfSMALL_BLOCK_SIZE	( ( size_t ) 1 << tlsfFL_INDEX_SHIFT )
+
+#define tlsfBLOCK_FREE			( ( size_t ) 0x1 )
+#define tlsfPREV_FREE			( ( size_t ) 0x2 )
+#define tlsfSIZE_MASK			( ( size_t ) 0x00fffff8UL )
+#define tlsfOWNER_SHIFT			24
+
+#define tlsfHEADER_SIZE			( 2 * sizeof( size_t ) )
+#define tlsfMIN_BLOCK_SIZE		( 2 * sizeof( void * ) )
+#define tlsfMAX_BLOCK_SIZE		( ( ( size_t ) 1 << configTLSF_FL_INDEX_MAX ) - tlsfALIGN_SIZE )
+
+#define tlsfBLOCK_SIZE( pxBlock )	( ( pxBlock )->xSize & tlsfSIZE_MASK )
+#define tlsfBLOCK_OWNER( pxBlock )	( ( pxBlock )->xSize >> tlsfOWNER_SHIFT )
+#define tlsfBLOCK_TO_PTR( pxBlock )	( ( void * ) ( ( ( uint8_t * ) ( pxBlock ) ) + tlsfHEADER_SIZE ) )
+#define tlsfPTR_TO_BLOCK( pv )		( ( TlsfBlock_t * ) ( ( ( uint8_t * ) ( pv ) ) - tlsfHEADER_SIZE ) )
+#define tlsfNEXT_PHYS( pxBlock )	( ( TlsfBlock_t * ) ( ( ( uint8_t * ) ( pxBlock ) ) + tlsfHEADER_SIZE + tlsfBLOCK_SIZE( pxBlock ) ) )
+
+typedef struct A_TLSF_BLOCK
+{
+	struct A_TLSF_BLOCK *pxPrevPhys;	/*<< Previous block in memory, valid only while it is free. */
+	size_t xSize;						/*<< Payload size, owner and flags. */
+	struct A_TLSF_BLOCK *pxNextFree;	/*<< Free list links, only in free blocks. */
+	struct A_TLSF_BLOCK *pxPrevFree;
+} TlsfBlock_t;
+
+typedef struct A_TLSF_CONTROL
+{
+	uint32_t ulFlBitmap;
+	uint32_t ulSlBitmap[ tlsfFL_INDEX_COUNT ];
+	TlsfBlock_t *pxBlocks[ tlsfFL_INDEX_COUNT ][ tlsfSL_INDEX_COUNT ];
+	size_t xTotalBytes;
+	size_t xFreeBytes;
+	size_t xMinimumEverFreeBytes;
+	size_t xFreeBlocks;
+	uint32_t ulAllocs;
+	uint32_t ulFrees;
+	uint32_t ulFailures;
+} TlsfControl_t;
+
+typedef struct A_HEAP_OWNER
+{
+	TaskHandle_t xTask;
+	size_t xBytes;
+	size_t xPeakBytes;
+} HeapOwner_t;
+
+/*-----------------------------------------------------------*/
+
+static TlsfControl_t xTlsf;
+static BaseType_t xHeapInitialised = pdFALSE;
+
+/* Slot 0 is charged for allocations made outside a task or when all slots
+are taken. */
+static HeapOwner_t xHeapOwners[ configHEAP_OWNER_SLOTS ];
+
+/* Realtek test code start */
+//TODO: remove section when combine BD and BF
+#if ((defined CONFIG_PLATFORM_8195A) || (defined CONFIG_PLATFORM_8711B))
+#include "section_config.h"
+SRAM_BF_DATA_SECTION
+#endif
+static unsigned char ucHeap[ configTOTAL_HEAP_SIZE ];
+
+#if (defined CONFIG_PLATFORM_8195A)
+HeapRegion_t xHeapRegions[] =
+{
+	{ (uint8_t*)0x10002300, 0x3D00 },	// Image1 recycle heap
+	{ ucHeap, sizeof(ucHeap) }, 		// Defines a block from ucHeap
+#if 0
+	{ (uint8_t*)0x301b5000, 300*1024 }, // SDRAM heap
+#endif
+	{ NULL, 0 } 							// Terminates the array.
+};
+#elif (defined CONFIG_PLATFORM_8711B)
+#include "rtl8710b_boot.h"
+extern BOOT_EXPORT_SYMB_TABLE boot_export_symbol;
+HeapRegion_t xHeapRegions[] =
+{
+	{ 0, 0},	// Image1 reserved ,length will be corrected in pvPortMalloc()
+	{ ucHeap, sizeof(ucHeap) }, 	// Defines a block from ucHeap
+	{ 0, 0},	// RDP reserved, will be corrected in pvPortMalloc()
+	{ NULL, 0 } 					// Terminates the array.
+};
+#elif (defined HEAP_REPLAY_HOST) || (defined CONFIG_PLATFORM_SIM)
+HeapRegion_t xHeapRegions[] =
+{
+	{ ucHeap, sizeof(ucHeap) },
+	{ NULL, 0 }
+};
+#else
+#error NOT SUPPORT CHIP
+#endif
+/* Realtek test code end */
+
+/*-----------------------------------------------------------*/
+
+/* Index of the most significant set bit, -1 for 0. */
+static int prvFls( uint32_t ulWord )
+{
+#if defined( __ICCARM__ )
+	return 31 - ( int ) __CLZ( ulWord );
+#elif defined( __GNUC__ )
+	return ( ulWord != 0 ) ? 31 - __builtin_clz( ulWord ) : -1;
+#else
+int iBit = -1;
+
+	while( ulWord != 0 )
+	{
+		ulWord >>= 1;
+		iBit++;
+	}
+	return iBit;
+#endif
+}
+
+/* Index of the least significant set bit, -1 for 0. */
+static int prvFfs( uint32_t ulWord )
+{
+	return prvFls( ulWord & ( ~ulWord + 1 ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMappingInsert( size_t xSize, int *piFl, int *piSl )
+{
+int iFl, iSl;
+
+	if( xSize < tlsfSMALL_BLOCK_SIZE )
+	{
+		/* Small sizes are spread linearly over the first level 0 lists. */
+		iFl = 0;
+		iSl = ( int ) ( xSize / ( tlsfSMALL_BLOCK_SIZE / tlsfSL_INDEX_COUNT ) );
+	}
+	else
+	{
+		iFl = prvFls( ( uint32_t ) xSize );
+		iSl = ( int ) ( xSize >> ( iFl - tlsfSL_INDEX_COUNT_LOG2 ) ) ^ ( 1 << tlsfSL_INDEX_COUNT_LOG2 );
+		iFl -= ( tlsfFL_INDEX_SHIFT - 1 );
+	}
+
+	*piFl = iFl;
+	*piSl = iSl;
+}
+
+/* Like prvMappingInsert(), but rounded up to the next list so that any block
+found there is large enough. */
+static void prvMappingSearch( size_t xSize, int *piFl, int *piSl )
+{
+	if( xSize >= tlsfSMALL_BLOCK_SIZE )
+	{
+		xSize += ( ( size_t ) 1 << ( prvFls( ( uint32_t ) xSize ) - tlsfSL_INDEX_COUNT_LOG2 ) ) - 1;
+	}
+
+	prvMappingInsert( xSize, piFl, piSl );
+}
+
+static TlsfBlock_t *prvSearchSuitableBlock( TlsfControl_t *pxControl, int *piFl, int *piSl )
+{
+int iFl = *piFl, iSl;
+uint32_t ulSlMap, ulFlMap;
+
+	/* First look for a list in the same power of 2, then in larger ones. */
+	ulSlMap = pxControl->ulSlBitmap[ iFl ] & ( ~( uint32_t ) 0 << *piSl );
+	if( ulSlMap == 0 )
+	{
+		ulFlMap = ( iFl + 1 < 32 ) ? ( pxControl->ulFlBitmap & ( ~( uint32_t ) 0 << ( iFl + 1 ) ) ) : 0;
+		if( ulFlMap == 0 )
+		{
+			return NULL;
+		}
+
+		iFl = prvFfs( ulFlMap );
+		ulSlMap = pxControl->ulSlBitmap[ iFl ];
+	}
+
+	iSl = prvFfs( ulSlMap );
+	*piFl = iFl;
+	*piSl = iSl;
+
+	return pxControl->pxBlocks[ iFl ][ iSl ];
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock )
+{
+int iFl, iSl;
+TlsfBlock_t *pxHead;
+
+	prvMappingInsert( tlsfBLOCK_SIZE( pxBlock ), &iFl, &iSl );
+
+	pxHead = pxControl->pxBlocks[ iFl ][ iSl ];
+	pxBlock->pxNextFree = pxHead;
+	pxBlock->pxPrevFree = NULL;
+	if( pxHead != NULL )
+	{
+		pxHead->pxPrevFree = pxBlock;
+	}
+	pxControl->pxBlocks[ iFl ][ iSl ] = pxBlock;
+
+	pxControl->ulFlBitmap |= ( 1UL << iFl );
+	pxControl->ulSlBitmap[ iFl ] |= ( 1UL << iSl );
+
+	pxControl->xFreeBytes += tlsfBLOCK_SIZE( pxBlock );
+	pxControl->xFreeBlocks++;
+}
+
+static void prvRemoveFreeBlock( TlsfControl_t *pxControl, TlsfBlock_t *pxBlock )
+{
+int iFl, iSl;
+
+	prvMappingInsert( tlsfBLOCK_SIZE( pxBlock ), &iFl, &iSl );
+
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock->pxPrevFree;
+	}
+
+	if( pxBlock->pxPrevFree != NULL )
+	{
+		pxBlock->pxPrevFree->pxNextFree = pxBlock->pxNextFree;
+	}
+	else
+	{
+		pxControl->pxBlocks[ iFl ][ iSl ] = pxBlock->pxNextFree;
+		if( pxBlock->pxNextFree == NULL )
+		{
+			pxControl->ulSlBitmap[ iFl ] &= ~( 1UL << iSl );
+			if( pxControl->ulSlBitmap[ iFl ] == 0 )
+			{
+				pxControl->ulFlBitmap &= ~( 1UL << iFl );
+			}
+		}
+	}
+
+	pxControl->xFreeBytes -= tlsfBLOCK_SIZE( pxBlock );
+	pxControl->xFreeBlocks--;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddRegion( TlsfControl_t *pxControl, uint8_t *pucStart, size_t xBytes )
+{
+portPOINTER_SIZE_TYPE uxAddress, uxEnd;
+size_t xPayload;
+TlsfBlock_t *pxBlock, *pxSentinel;
+
+	uxAddress = ( ( portPOINTER_SIZE_TYPE ) pucStart + portBYTE_ALIGNMENT_MASK ) & ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK );
+	uxEnd = ( ( portPOINTER_SIZE_TYPE ) pucStart + xBytes ) & ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK );
+
+	if( ( uxEnd <= uxAddress ) || ( ( uxEnd - uxAddress ) < ( 2 * tlsfHEADER_SIZE + tlsfMIN_BLOCK_SIZE ) ) )
+	{
+		return;
+	}
+
+	/* One free block followed by the zero sized sentinel. */
+	xPayload = ( uxEnd - uxAddress ) - 2 * tlsfHEADER_SIZE;
+	if( xPayload > tlsfMAX_BLOCK_SIZE )
+	{
+		xPayload = tlsfMAX_BLOCK_SIZE;
+	}
+
+	pxBlock = ( TlsfBlock_t * ) uxAddress;
+	pxBlock->pxPrevPhys = NULL;
+	pxBlock->xSize = xPayload | tlsfBLOCK_FREE;
+
+	pxSentinel = tlsfNEXT_PHYS( pxBlock );
+	pxSentinel->pxPrevPhys = pxBlock;
+	pxSentinel->xSize = tlsfPREV_FREE;
+
+	prvInsertFreeBlock( pxControl, pxBlock );
+	pxControl->xTotalBytes += xPayload;
+	pxControl->xMinimumEverFreeBytes = pxControl->xFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+/* Owner slot of the calling task, claimed on its first allocation. */
+static size_t prvOwnerSlot( void )
+{
+TaskHandle_t xTask;
+UBaseType_t uxSlot, uxFree = 0;
+
+	if( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+	{
+		return 0;
+	}
+
+	xTask = xTaskGetCurrentTaskHandle();
+	uxSlot = uxTaskGetTaskNumber( xTask );
+	if( ( uxSlot > 0 ) && ( uxSlot < configHEAP_OWNER_SLOTS ) && ( xHeapOwners[ uxSlot ].xTask == xTask ) )
+	{
+		return uxSlot;
+	}
+
+	/* A slot without outstanding bytes can be taken over: the task it
+	belonged to finds out on its next allocation and claims another one.
+	Prefer slots that were never used. */
+	for( uxSlot = 1; uxSlot < configHEAP_OWNER_SLOTS; uxSlot++ )
+	{
+		if( xHeapOwners[ uxSlot ].xBytes == 0 )
+		{
+			if( xHeapOwners[ uxSlot ].xTask == NULL )
+			{
+				uxFree = uxSlot;
+				break;
+			}
+			if( uxFree == 0 )
+			{
+				uxFree = uxSlot;
+			}
+		}
+	}
+
+	if( uxFree != 0 )
+	{
+		xHeapOwners[ uxFree ].xTask = xTask;
+		xHeapOwners[ uxFree ].xPeakBytes = 0;
+		vTaskSetTaskNumber( xTask, uxFree );
+	}
+
+	return uxFree;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvTlsfMalloc( TlsfControl_t *pxControl, size_t xWantedSize )
+{
+TlsfBlock_t *pxBlock, *pxRemain;
+size_t xSize, xOwner;
+int iFl, iSl;
+
+	if( ( xWantedSize == 0 ) || ( xWantedSize > tlsfMAX_BLOCK_SIZE ) )
+	{
+		pxControl->ulFailures++;
+		return NULL;
+	}
+
+	xSize = ( xWantedSize + tlsfALIGN_SIZE - 1 ) & ~( tlsfALIGN_SIZE - 1 );
+	if( xSize < tlsfMIN_BLOCK_SIZE )
+	{
+		xSize = tlsfMIN_BLOCK_SIZE;
+	}
+
+	prvMappingSearch( xSize, &iFl, &iSl );
+	pxBlock = NULL;
+	if( iFl < tlsfFL_INDEX_COUNT )
+	{
+		pxBlock = prvSearchSuitableBlock( pxControl, &iFl, &iSl );
+	}
+
+	if( pxBlock == NULL )
+	{
+		pxControl->ulFailures++;
+		return NULL;
+	}
+
+	prvRemoveFreeBlock( pxControl, pxBlock );
+
+	if( tlsfBLOCK_SIZE( pxBlock ) >= xSize + tlsfHEADER_SIZE + tlsfMIN_BLOCK_SIZE )
+	{
+		/* Give the tail back as a free block. */
+		pxRemain = ( TlsfBlock_t * ) ( ( uint8_t * ) tlsfBLOCK_TO_PTR( pxBlock ) + xSize );
+		pxRemain->xSize = ( tlsfBLOCK_SIZE( pxBlock ) - xSize - tlsfHEADER_SIZE ) | tlsfBLOCK_FREE;
+		pxBlock->xSize = xSize | ( pxBlock->xSize & tlsfPREV_FREE );
+		tlsfNEXT_PHYS( pxRemain )->pxPrevPhys = pxRemain;
+		prvInsertFreeBlock( pxControl, pxRemain );
+	}
+	else
+	{
+		tlsfNEXT_PHYS( pxBlock )->xSize &= ~tlsfPREV_FREE;
+		pxBlock->xSize &= ~tlsfBLOCK_FREE;
+	}
+
+	xOwner = prvOwnerSlot();
+	pxBlock->xSize |= xOwner << tlsfOWNER_SHIFT;
+	xHeapOwners[ xOwner ].xBytes += tlsfBLOCK_SIZE( pxBlock );
+	if( xHeapOwners[ xOwner ].xBytes > xHeapOwners[ xOwner ].xPeakBytes )
+	{
+		xHeapOwners[ xOwner ].xPeakBytes = xHeapOwners[ xOwner ].xBytes;
+	}
+
+	pxControl->ulAllocs++;
+	if( pxControl->xFreeBytes < pxControl->xMinimumEverFreeBytes )
+	{
+		pxControl->xMinimumEverFreeBytes = pxControl->xFreeBytes;
+	}
+
+	return tlsfBLOCK_TO_PTR( pxBlock );
+}
+
+static size_t prvTlsfFree( TlsfControl_t *pxControl, void *pv )
+{
+TlsfBlock_t *pxBlock = tlsfPTR_TO_BLOCK( pv ), *pxNeighbour;
+size_t xSize = tlsfBLOCK_SIZE( pxBlock );
+
+	/* Check the block is actually allocated. */
+	configASSERT( ( pxBlock->xSize & tlsfBLOCK_FREE ) == 0 );
+	if( ( pxBlock->xSize & tlsfBLOCK_FREE ) != 0 )
+	{
+		return 0;
+	}
+
+	xHeapOwners[ tlsfBLOCK_OWNER( pxBlock ) ].xBytes -= xSize;
+	pxBlock->xSize = ( pxBlock->xSize & ( tlsfSIZE_MASK | tlsfPREV_FREE ) ) | tlsfBLOCK_FREE;
+	pxControl->ulFrees++;
+
+	if( ( pxBlock->xSize & tlsfPREV_FREE ) != 0 )
+	{
+		pxNeighbour = pxBlock->pxPrevPhys;
+		prvRemoveFreeBlock( pxControl, pxNeighbour );
+		pxNeighbour->xSize += tlsfBLOCK_SIZE( pxBlock ) + tlsfHEADER_SIZE;
+		pxBlock = pxNeighbour;
+	}
+
+	pxNeighbour = tlsfNEXT_PHYS( pxBlock );
+	if( ( pxNeighbour->xSize & tlsfBLOCK_FREE ) != 0 )
+	{
+		prvRemoveFreeBlock( pxControl, pxNeighbour );
+		pxBlock->xSize += tlsfBLOCK_SIZE( pxNeighbour ) + tlsfHEADER_SIZE;
+	}
+
+	pxNeighbour = tlsfNEXT_PHYS( pxBlock );
+	pxNeighbour->pxPrevPhys = pxBlock;
+	pxNeighbour->xSize |= tlsfPREV_FREE;
+
+	prvInsertFreeBlock( pxControl, pxBlock );
+
+	return xSize;
+}
+
+static size_t prvLargestFreeBlock( TlsfControl_t *pxControl )
+{
+TlsfBlock_t *pxBlock;
+size_t xLargest = 0;
+int iFl, iSl;
+
+	/* All blocks in the highest non-empty list are larger than any other
+	free block, only that list has to be walked. */
+	if( pxControl->ulFlBitmap == 0 )
+	{
+		return 0;
+	}
+
+	iFl = prvFls( pxControl->ulFlBitmap );
+	iSl = prvFls( pxControl->ulSlBitmap[ iFl ] );
+	for( pxBlock = pxControl->pxBlocks[ iFl ][ iSl ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+	{
+		if( tlsfBLOCK_SIZE( pxBlock ) > xLargest )
+		{
+			xLargest = tlsfBLOCK_SIZE( pxBlock );
+		}
+	}
+
+	return xLargest;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+void *pvReturn;
+
+	/* Realtek test code start */
+	if( xHeapInitialised == pdFALSE )
+	{
+#if (defined CONFIG_PLATFORM_8711B)
+		xHeapRegions[ 0 ].xSizeInBytes = (uint32_t)((uint8_t*)0x10005000 - (uint8_t*)boot_export_symbol.boot_ram_end);
+		xHeapRegions[ 0 ].pucStartAddress = (uint8_t*)boot_export_symbol.boot_ram_end;
+
+		if(!IsRDPenabled()){
+			xHeapRegions[ 2 ].xSizeInBytes = 0x1000;
+			xHeapRegions[ 2 ].pucStartAddress = (uint8_t*)0x1003f000;
+		}else{
+			xHeapRegions[ 2 ].xSizeInBytes = 0;
+			xHeapRegions[ 2 ].pucStartAddress = NULL;
+		}
+#endif
+		vPortDefineHeapRegions( xHeapRegions );
+	}
+	/* Realtek test code end */
+
+	vTaskSuspendAll();
+	{
+		pvReturn = prvTlsfMalloc( &xTlsf, xWantedSize );
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configHEAP_TRACE == 1 )
+	{
+		printf( "#M %p %u %u\n", pvReturn, ( unsigned int ) xWantedSize,
+			( pvReturn != NULL ) ? ( unsigned int ) tlsfBLOCK_OWNER( tlsfPTR_TO_BLOCK( pvReturn ) ) : 0 );
+	}
+	#endif
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void __vPortFree( void *pv )
+{
+size_t xSize;
+
+	if( pv != NULL )
+	{
+		vTaskSuspendAll();
+		{
+			xSize = prvTlsfFree( &xTlsf, pv );
+			traceFREE( pv, xSize );
+			( void ) xSize;
+		}
+		( void ) xTaskResumeAll();
+
+		#if( configHEAP_TRACE == 1 )
+		{
+			printf( "#F %p\n", pv );
+		}
+		#endif
+	}
+}
+
+/*-----------------------------------------------------------*/
+/* Add by Alfa 2015/02/04 -----------------------------------*/
+static void (*ext_free)( void *p ) = NULL;
+static uint32_t ext_upper = 0;
+static uint32_t ext_lower = 0;
+void vPortSetExtFree( void (*free)( void *p ), uint32_t upper, uint32_t lower )
+{
+	ext_free = free;
+	ext_upper = upper;
+	ext_lower = lower;
+}
+
+void vPortFree( void *pv )
+{
+	if( ((portPOINTER_SIZE_TYPE)pv >= ext_lower) && ((portPOINTER_SIZE_TYPE)pv < ext_upper) ){
+		// use external free function
+		if( ext_free )	ext_free( pv );
+	}else
+		__vPortFree( pv );
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions )
+{
+const HeapRegion_t *pxHeapRegion;
+
+	/* Can only call once! */
+	configASSERT( xHeapInitialised == pdFALSE );
+
+	for( pxHeapRegion = pxHeapRegions; pxHeapRegion->xSizeInBytes > 0; pxHeapRegion++ )
+	{
+		prvAddRegion( &xTlsf, pxHeapRegion->pucStartAddress, pxHeapRegion->xSizeInBytes );
+	}
+
+	/* Check something was actually defined before it is accessed. */
+	configASSERT( xTlsf.xTotalBytes );
+
+	xHeapInitialised = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xTlsf.xFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xTlsf.xMinimumEverFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetLargestFreeBlockSize( void )
+{
+size_t xLargest;
+
+	vTaskSuspendAll();
+	{
+		xLargest = prvLargestFreeBlock( &xTlsf );
+	}
+	( void ) xTaskResumeAll();
+
+	return xLargest;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+	vTaskSuspendAll();
+	{
+		pxHeapStats->xTotalBytes = xTlsf.xTotalBytes;
+		pxHeapStats->xFreeBytes = xTlsf.xFreeBytes;
+		pxHeapStats->xMinimumEverFreeBytes = xTlsf.xMinimumEverFreeBytes;
+		pxHeapStats->xLargestFreeBlock = prvLargestFreeBlock( &xTlsf );
+		pxHeapStats->xFreeBlocks = xTlsf.xFreeBlocks;
+		pxHeapStats->ulAllocs = xTlsf.ulAllocs;
+		pxHeapStats->ulFrees = xTlsf.ulFrees;
+		pxHeapStats->ulFailures = xTlsf.ulFailures;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetTaskHeapBytes( void *xTask )
+{
+UBaseType_t uxSlot;
+
+	if( xTask == NULL )
+	{
+		xTask = xTaskGetCurrentTaskHandle();
+	}
+
+	uxSlot = uxTaskGetTaskNumber( ( TaskHandle_t ) xTask );
+	if( ( uxSlot > 0 ) && ( uxSlot < configHEAP_OWNER_SLOTS ) && ( xHeapOwners[ uxSlot ].xTask == xTask ) )
+	{
+		return xHeapOwners[ uxSlot ].xBytes;
+	}
+
+	return 0;
+}
+/*-----------------------------------------------------------*/
+
+/*
+	Dump heap statistics and usage per task
+*/
+void dump_mem_block_list()
+{
+HeapStats_t xStats;
+UBaseType_t uxSlot;
+
+	vPortGetHeapStats( &xStats );
+
+	printf("\n===============================>Heap:\n");
+	printf("total %u, free %u, min ever free %u\n", ( unsigned int ) xStats.xTotalBytes, ( unsigned int ) xStats.xFreeBytes,
+		( unsigned int ) xStats.xMinimumEverFreeBytes);
+	printf("largest free %u in %u free blocks, fragmentation %u%%\n", ( unsigned int ) xStats.xLargestFreeBlock, ( unsigned int ) xStats.xFreeBlocks,
+		( xStats.xFreeBytes != 0 ) ? ( unsigned int ) ( 100 - ( xStats.xLargestFreeBlock * 100 ) / xStats.xFreeBytes ) : 0);
+	printf("allocs %u, frees %u, failures %u\n", xStats.ulAllocs, xStats.ulFrees, xStats.ulFailures);
+
+	for( uxSlot = 0; uxSlot < configHEAP_OWNER_SLOTS; uxSlot++ )
+	{
+		if( ( xHeapOwners[ uxSlot ].xBytes == 0 ) && ( xHeapOwners[ uxSlot ].xPeakBytes == 0 ) )
+		{
+			continue;
+		}
+
+		/* The name is only meaningful while the task holds memory or runs. */
+		printf("[%d] %-10s %u bytes, peak %u\n", ( int ) uxSlot,
+			( xHeapOwners[ uxSlot ].xTask != NULL ) ? pcTaskGetTaskName( xHeapOwners[ uxSlot ].xTask ) : "-",
+			( unsigned int ) xHeapOwners[ uxSlot ].xBytes, ( unsigned int ) xHeapOwners[ uxSlot ].xPeakBytes);
+	}
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortTlsfCreate( void *pvMemory, size_t xBytes )
+{
+TlsfControl_t *pxControl;
+portPOINTER_SIZE_TYPE uxAddress;
+
+	uxAddress = ( ( portPOINTER_SIZE_TYPE ) pvMemory + portBYTE_ALIGNMENT_MASK ) & ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK );
+	if( xBytes < ( uxAddress - ( portPOINTER_SIZE_TYPE ) pvMemory ) + sizeof( TlsfControl_t ) )
+	{
+		return NULL;
+	}
+	xBytes -= ( uxAddress - ( portPOINTER_SIZE_TYPE ) pvMemory ) + sizeof( TlsfControl_t );
+
+	pxControl = ( TlsfControl_t * ) uxAddress;
+	memset( pxControl, 0, sizeof( TlsfControl_t ) );
+	prvAddRegion( pxControl, ( uint8_t * ) ( pxControl + 1 ), xBytes );
+
+	return ( pxControl->xTotalBytes != 0 ) ? pxControl : NULL;
+}
+
+void *pvPortTlsfMalloc( void *pvHeap, size_t xWantedSize )
+{
+	return prvTlsfMalloc( ( TlsfControl_t * ) pvHeap, xWantedSize );
+}
+
+void vPortTlsfFree( void *pvHeap, void *pv )
+{
+	if( pv != NULL )
+	{
+		( void ) prvTlsfFree( ( TlsfControl_t * ) pvHeap, pv );
+	}
+}
+
+size_t xPortTlsfGetFreeSize( void *pvHeap )
+{
+	return ( ( TlsfControl_t * ) pvHeap )->xFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+void* pvPortReAlloc( void *pv,  size_t xWantedSize )
+{
+	if( ((portPOINTER_SIZE_TYPE)pv >= ext_lower) && ((portPOINTER_SIZE_TYPE)pv < ext_upper) ){
+		if( ext_free )  ext_free( pv );
+		pv = NULL;
+	}
+
+	if( pv )
+	{
+		if( !xWantedSize )
+		{
+			vPortFree( pv );
+			return NULL;
+		}
+
+		void *newArea = pvPortMalloc( xWantedSize );
+		if( newArea )
+		{
+			size_t oldSize = tlsfBLOCK_SIZE( tlsfPTR_TO_BLOCK( pv ) );
+			size_t copySize = ( oldSize < xWantedSize ) ? oldSize : xWantedSize;
+			memcpy( newArea, pv, copySize );
+			__vPortFree( pv );
+			return newArea;
+		}
+	}
+	else if( xWantedSize )
+		return pvPortMalloc( xWantedSize );
+	else
+		return NULL;
+
+	return NULL;
+}
@@ -666,6 +666,7 @@ TCB_t * pxNewTCB;
 			{
 				/* Add a counter into the TCB for tracing only. */
 				pxNewTCB->uxTCBNumber = uxTaskNumber;
+				pxNewTCB->uxTaskNumber = 0U;
 			}
 			#endif /* configUSE_TRACE_FACILITY */
 			traceTASK_CREATE( pxNewTCB );
@@ -0,0 +1,562 @@
+/*
+ * Host replay benchmark for the FreeRTOS heaps (heap_5.c, heap_tlsf.c).
+ *
+ * Runs an allocation trace or a synthetic workload against the real heap
+ * source on the PC and reports failures, fragmentation and time per call.
+ *
+ * Build from this directory, once per heap:
+ *
+ *   gcc -O2 -no-pie -fno-pie -Wno-pointer-to-int-cast -Ihost -DHEAP_REPLAY_TLSF \
+ *       -o heap_replay_tlsf heap_replay.c ../freertos_v8.1.2/Source/portable/MemMang/heap_tlsf.c
+ *   gcc -O2 -no-pie -fno-pie -Wno-pointer-to-int-cast -Ihost \
+ *       -o heap_replay_heap5 heap_replay.c ../freertos_v8.1.2/Source/portable/MemMang/heap_5.c
+ *
+ * The heaps do their address arithmetic in uint32_t like on the device, so
+ * the binary must not be position independent (heap below 4GB).
+ *
+ * Usage:
+ *
+ *   heap_replay [-s seed] [-n operations] [trace.log]
+ *
+ * Without a file a synthetic mix of the Wi-Fi application is replayed: pbuf
+ * churn in tcpip, cJSON documents, TLS sessions with their 16K record buffers
+ * and long lived application objects, each from its own task. A trace is a
+ * UART log of a build with configHEAP_TRACE 1 in heap_tlsf.c:
+ *
+ *   #M <ptr> <size> <owner>
+ *   #F <ptr>
+ *
+ * Allocations that failed on the device (ptr 0) are replayed and released
+ * again right away.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if defined HEAP_REPLAY_TLSF
+#define HEAP_NAME		"heap_tlsf"
+extern size_t xPortGetLargestFreeBlockSize( void );
+extern void vPortGetHeapStats( HeapStats_t *pxHeapStats );
+extern size_t xPortGetTaskHeapBytes( void *xTask );
+#else
+#define HEAP_NAME		"heap_5"
+#endif
+
+#define MAX_TASKS		64
+#define LIVE_SLOTS		( 1 << 16 )
+#define FAILED_KEY		( ~0ULL )
+
+/*-----------------------------------------------------------*/
+/* Tasks, one per owner of the trace */
+
+typedef struct
+{
+	char name[ 16 ];
+	UBaseType_t number;
+	size_t bytes;			/* requested bytes currently allocated */
+	size_t peak;
+} replay_task_t;
+
+static replay_task_t tasks[ MAX_TASKS ];
+static int task_count;
+static replay_task_t *current;
+
+void vTaskSuspendAll( void ) { }
+BaseType_t xTaskResumeAll( void ) { return pdFALSE; }
+BaseType_t xTaskGetSchedulerState( void ) { return taskSCHEDULER_RUNNING; }
+TaskHandle_t xTaskGetCurrentTaskHandle( void ) { return current; }
+UBaseType_t uxTaskGetTaskNumber( TaskHandle_t xTask ) { return ( ( replay_task_t * ) xTask )->number; }
+void vTaskSetTaskNumber( TaskHandle_t xTask, const UBaseType_t uxHandle ) { ( ( replay_task_t * ) xTask )->number = uxHandle; }
+char *pcTaskGetTaskName( TaskHandle_t xTaskToQuery ) { return ( ( replay_task_t * ) xTaskToQuery )->name; }
+
+static replay_task_t *task_get( const char *name )
+{
+	int i;
+
+	for( i = 0; i < task_count; i++ )
+	{
+		if( strcmp( tasks[ i ].name, name ) == 0 )
+			return &tasks[ i ];
+	}
+
+	if( task_count == MAX_TASKS )
+		return &tasks[ 0 ];
+
+	snprintf( tasks[ task_count ].name, sizeof( tasks[ task_count ].name ), "%s", name );
+	return &tasks[ task_count++ ];
+}
+
+/*-----------------------------------------------------------*/
+/* Live allocations, keyed by the trace pointer or a synthetic id */
+
+typedef struct
+{
+	uint64_t key;
+	void *ptr;
+	size_t size;
+	replay_task_t *task;
+} live_t;
+
+static live_t live[ LIVE_SLOTS ];
+
+static uint32_t live_hash( uint64_t key )
+{
+	return ( uint32_t ) ( ( key * 0x9e3779b97f4a7c15ULL ) >> 48 ) & ( LIVE_SLOTS - 1 );
+}
+
+/* Linear probing, key 0 marks an empty slot */
+static live_t *live_find( uint64_t key, int insert )
+{
+	uint32_t h = live_hash( key );
+
+	for( ;; )
+	{
+		live_t *l = &live[ h ];
+
+		if( l->key == key )
+			return l;
+		if( l->key == 0 )
+			return insert ? l : NULL;
+		h = ( h + 1 ) & ( LIVE_SLOTS - 1 );
+	}
+}
+
+/* Delete by moving later entries of the probe chain back into the hole */
+static void live_remove( live_t *l )
+{
+	uint32_t hole = ( uint32_t ) ( l - live ), h = hole;
+
+	for( ;; )
+	{
+		uint32_t home;
+
+		h = ( h + 1 ) & ( LIVE_SLOTS - 1 );
+		if( live[ h ].key == 0 )
+			break;
+
+		home = live_hash( live[ h ].key );
+		if( ( ( h - home ) & ( LIVE_SLOTS - 1 ) ) >= ( ( h - hole ) & ( LIVE_SLOTS - 1 ) ) )
+		{
+			live[ hole ] = live[ h ];
+			hole = h;
+		}
+	}
+
+	live[ hole ].key = 0;
+	live[ hole ].ptr = NULL;
+}
+
+/*-----------------------------------------------------------*/
+/* Measurements */
+
+static struct
+{
+	unsigned long mallocs, frees, failures, frag_failures, unknown_frees;
+	uint64_t malloc_ns, free_ns, malloc_max_ns, free_max_ns;
+	unsigned long malloc_hist[ 40 ], free_hist[ 40 ];	/* power of 2 ns buckets */
+	size_t min_free;
+} st;
+
+static void hist_add( unsigned long *hist, uint64_t ns )
+{
+	int b = 0;
+
+	while( b < 39 && ns >= ( 1ULL << b ) )
+		b++;
+	hist[ b ]++;
+}
+
+/* Upper bound of the bucket holding the given fraction of the calls */
+static uint64_t hist_percentile( const unsigned long *hist, unsigned long n, double fraction )
+{
+	unsigned long sum = 0;
+	int b;
+
+	for( b = 0; b < 40; b++ )
+	{
+		sum += hist[ b ];
+		if( sum >= n * fraction )
+			break;
+	}
+
+	return 1ULL << b;
+}
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( uint64_t ) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void replay_malloc( replay_task_t *task, uint64_t key, size_t size )
+{
+	size_t free_before = xPortGetFreeHeapSize();
+	uint64_t t0, dt;
+	void *p;
+	live_t *l;
+
+	current = task;
+	t0 = now_ns();
+	p = pvPortMalloc( size );
+	dt = now_ns() - t0;
+
+	st.mallocs++;
+	st.malloc_ns += dt;
+	if( dt > st.malloc_max_ns )
+		st.malloc_max_ns = dt;
+	hist_add( st.malloc_hist, dt );
+
+	if( p == NULL )
+	{
+		st.failures++;
+		if( free_before >= size )
+			st.frag_failures++;
+		return;
+	}
+
+	if( xPortGetFreeHeapSize() < st.min_free )
+		st.min_free = xPortGetFreeHeapSize();
+
+	/* A key that is still live was freed on the device without a trace line */
+	l = live_find( key, 0 );
+	if( l == NULL )
+		l = live_find( key, 1 );
+	else
+		l->task->bytes -= l->size;
+
+	l->key = key;
+	l->ptr = p;
+	l->size = size;
+	l->task = task;
+	memset( p, 0xa5, size );
+
+	task->bytes += size;
+	if( task->bytes > task->peak )
+		task->peak = task->bytes;
+}
+
+static void replay_free( uint64_t key )
+{
+	uint64_t t0, dt;
+	live_t *l = live_find( key, 0 );
+
+	if( l == NULL )
+	{
+		st.unknown_frees++;
+		return;
+	}
+
+	current = l->task;
+	t0 = now_ns();
+	vPortFree( l->ptr );
+	dt = now_ns() - t0;
+
+	st.frees++;
+	st.free_ns += dt;
+	if( dt > st.free_max_ns )
+		st.free_max_ns = dt;
+	hist_add( st.free_hist, dt );
+
+	l->task->bytes -= l->size;
+	live_remove( l );
+}
+
+/*-----------------------------------------------------------*/
+/* Trace input */
+
+static void replay_trace( FILE *f )
+{
+	char line[ 256 ], name[ 16 ];
+	unsigned long long ptr;
+	unsigned int size, owner;
+	char *p;
+
+	while( fgets( line, sizeof( line ), f ) != NULL )
+	{
+		if( ( p = strstr( line, "#M " ) ) != NULL )
+		{
+			if( sscanf( p + 3, "%llx %u %u", &ptr, &size, &owner ) != 3 )
+				continue;
+			snprintf( name, sizeof( name ), "owner%u", owner );
+			replay_malloc( task_get( name ), ptr != 0 ? ptr : FAILED_KEY, size );
+			/* Failed on the device, nobody frees it there */
+			if( ptr == 0 )
+				replay_free( FAILED_KEY );
+		}
+		else if( ( p = strstr( line, "#F " ) ) != NULL )
+		{
+			if( sscanf( p + 3, "%llx", &ptr ) == 1 )
+				replay_free( ptr );
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+/* Synthetic workload */
+
+static uint32_t rnd_state;
+
+static uint32_t rnd( void )
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+	return rnd_state;
+}
+
+static uint32_t rnd_range( uint32_t lo, uint32_t hi )
+{
+	return lo + rnd() % ( hi - lo + 1 );
+}
+
+#define PBUF_RING		24
+#define JSON_DOCS		3
+#define JSON_NODES		64
+#define TLS_OBJECTS		48
+#define APP_OBJECTS		40
+
+static uint64_t next_key = 1;
+
+typedef struct
+{
+	uint64_t keys[ JSON_NODES + 1 ];
+	int count;
+} json_doc_t;
+
+static void free_keys( uint64_t *keys, int count )
+{
+	int i;
+
+	/* Mostly in allocation order with some shuffling, as cJSON_Delete() does */
+	for( i = 0; i < count; i++ )
+	{
+		int j = i + ( int ) ( rnd() % ( uint32_t ) ( count - i < 4 ? count - i : 4 ) );
+		uint64_t k = keys[ j ];
+
+		keys[ j ] = keys[ i ];
+		keys[ i ] = k;
+		replay_free( k );
+	}
+}
+
+static void replay_synthetic( unsigned long operations )
+{
+	replay_task_t *tcpip = task_get( "tcpip" ), *json = task_get( "cloud" );
+	replay_task_t *tls = task_get( "tls" ), *app = task_get( "app" );
+	uint64_t pbufs[ PBUF_RING ] = { 0 }, tls_keys[ TLS_OBJECTS + 2 ], app_keys[ APP_OBJECTS ] = { 0 };
+	json_doc_t docs[ JSON_DOCS ];
+	int pbuf_head = 0, doc_head = 0, tls_count = 0, tls_steps = 0, i;
+
+	memset( docs, 0, sizeof( docs ) );
+
+	while( st.mallocs + st.frees < operations )
+	{
+		uint32_t r = rnd() % 100;
+
+		if( r < 45 )
+		{
+			/* Rx/Tx pbufs, a full frame or a small ack, freed in FIFO order */
+			if( pbufs[ pbuf_head ] != 0 )
+				replay_free( pbufs[ pbuf_head ] );
+			pbufs[ pbuf_head ] = next_key++;
+			replay_malloc( tcpip, pbufs[ pbuf_head ], ( rnd() & 3 ) ? 1600 : rnd_range( 64, 200 ) );
+			pbuf_head = ( pbuf_head + 1 ) % PBUF_RING;
+		}
+		else if( r < 70 )
+		{
+			/* Parse or print a cJSON document, kept alive for a while */
+			json_doc_t *doc = &docs[ doc_head ];
+			int nodes = ( int ) rnd_range( 8, JSON_NODES );
+
+			free_keys( doc->keys, doc->count );
+			doc->count = 0;
+			for( i = 0; i < nodes; i++ )
+			{
+				doc->keys[ doc->count ] = next_key++;
+				replay_malloc( json, doc->keys[ doc->count++ ], rnd_range( 16, 96 ) );
+			}
+			doc->keys[ doc->count ] = next_key++;
+			replay_malloc( json, doc->keys[ doc->count++ ], rnd_range( 256, 1500 ) );
+			doc_head = ( doc_head + 1 ) % JSON_DOCS;
+		}
+		else if( r < 80 )
+		{
+			/* TLS session: record buffers, handshake objects and bignum temporaries */
+			if( tls_count == 0 )
+			{
+				tls_keys[ tls_count ] = next_key++;
+				replay_malloc( tls, tls_keys[ tls_count++ ], 16717 );
+				tls_keys[ tls_count ] = next_key++;
+				replay_malloc( tls, tls_keys[ tls_count++ ], 16717 );
+				tls_steps = ( int ) rnd_range( 20, 200 );
+			}
+			else if( tls_count < TLS_OBJECTS + 2 && ( rnd() & 1 ) )
+			{
+				tls_keys[ tls_count ] = next_key++;
+				replay_malloc( tls, tls_keys[ tls_count++ ], ( rnd() & 7 ) ? rnd_range( 24, 600 ) : rnd_range( 1000, 3000 ) );
+			}
+			else
+			{
+				uint64_t tmp = next_key++;
+
+				replay_malloc( tls, tmp, rnd_range( 64, 512 ) );
+				replay_free( tmp );
+			}
+
+			if( --tls_steps <= 0 )
+			{
+				free_keys( tls_keys, tls_count );
+				tls_count = 0;
+			}
+		}
+		else
+		{
+			/* Long lived application objects, replaced at random */
+			i = ( int ) ( rnd() % APP_OBJECTS );
+			if( app_keys[ i ] != 0 )
+				replay_free( app_keys[ i ] );
+			app_keys[ i ] = next_key++;
+			replay_malloc( app, app_keys[ i ], rnd_range( 8, 512 ) );
+		}
+	}
+}
+
+/*-----------------------------------------------------------*/
+
+/* Largest allocation that succeeds now, the same probe for every heap */
+static size_t probe_largest( void )
+{
+	size_t lo = 0, hi = xPortGetFreeHeapSize();
+	void *p;
+
+	current = &tasks[ 0 ];
+	while( lo < hi )
+	{
+		size_t mid = ( lo + hi + 1 ) / 2;
+
+		p = pvPortMalloc( mid );
+		if( p != NULL )
+		{
+			vPortFree( p );
+			lo = mid;
+		}
+		else
+		{
+			hi = mid - 1;
+		}
+	}
+
+	return lo;
+}
+
+static void report( void )
+{
+	size_t free_bytes = xPortGetFreeHeapSize(), largest;
+	int i;
+
+	printf( "%s, %u bytes\n", HEAP_NAME, ( unsigned int ) configTOTAL_HEAP_SIZE );
+	printf( "  mallocs %lu, frees %lu, failures %lu (%lu with enough free bytes)",
+		st.mallocs, st.frees, st.failures, st.frag_failures );
+	/* Synthetic frees of allocations that failed land here too */
+	if( st.unknown_frees > st.failures )
+		printf( ", %lu frees of unknown pointers", st.unknown_frees );
+	printf( "\n" );
+	/* The maximum includes host preemption, the 99.9% bound is the better worst case */
+	printf( "  malloc avg %.0f ns, 99.9%% < %llu ns, max %llu ns\n",
+		st.mallocs ? ( double ) st.malloc_ns / st.mallocs : 0.0,
+		( unsigned long long ) hist_percentile( st.malloc_hist, st.mallocs, 0.999 ), ( unsigned long long ) st.malloc_max_ns );
+	printf( "  free   avg %.0f ns, 99.9%% < %llu ns, max %llu ns\n",
+		st.frees ? ( double ) st.free_ns / st.frees : 0.0,
+		( unsigned long long ) hist_percentile( st.free_hist, st.frees, 0.999 ), ( unsigned long long ) st.free_max_ns );
+	printf( "  free now %u, min free %u (heap says %u)\n", ( unsigned int ) free_bytes,
+		( unsigned int ) st.min_free, ( unsigned int ) xPortGetMinimumEverFreeHeapSize() );
+
+#if defined HEAP_REPLAY_TLSF
+	{
+		HeapStats_t hs;
+
+		vPortGetHeapStats( &hs );
+		printf( "  largest free block %u in %u free blocks, fragmentation %u%%\n",
+			( unsigned int ) hs.xLargestFreeBlock, ( unsigned int ) hs.xFreeBlocks,
+			hs.xFreeBytes ? ( unsigned int ) ( 100 - hs.xLargestFreeBlock * 100 / hs.xFreeBytes ) : 0 );
+	}
+#endif
+
+	largest = probe_largest();
+	printf( "  largest allocation possible %u\n", ( unsigned int ) largest );
+
+	printf( "  %-10s %10s %10s", "task", "bytes", "peak" );
+#if defined HEAP_REPLAY_TLSF
+	printf( " %10s", "heap says" );
+#endif
+	printf( "\n" );
+	for( i = 0; i < task_count; i++ )
+	{
+		printf( "  %-10s %10u %10u", tasks[ i ].name, ( unsigned int ) tasks[ i ].bytes, ( unsigned int ) tasks[ i ].peak );
+#if defined HEAP_REPLAY_TLSF
+		/* The heap charges rounded block sizes, never less than was asked for */
+		printf( " %10u", ( unsigned int ) xPortGetTaskHeapBytes( &tasks[ i ] ) );
+		if( xPortGetTaskHeapBytes( &tasks[ i ] ) < tasks[ i ].bytes )
+			printf( "  MISMATCH" );
+#endif
+		printf( "\n" );
+	}
+}
+
+int main( int argc, char **argv )
+{
+	unsigned long operations = 1000000;
+	const char *path = NULL;
+	FILE *f;
+	int i;
+
+	rnd_state = 1;
+	for( i = 1; i < argc; i++ )
+	{
+		if( strcmp( argv[ i ], "-s" ) == 0 && i + 1 < argc )
+			rnd_state = ( uint32_t ) strtoul( argv[ ++i ], NULL, 0 ) | 1;
+		else if( strcmp( argv[ i ], "-n" ) == 0 && i + 1 < argc )
+			operations = strtoul( argv[ ++i ], NULL, 0 );
+		else if( argv[ i ][ 0 ] != '-' )
+			path = argv[ i ];
+		else
+		{
+			fprintf( stderr, "usage: %s [-s seed] [-n operations] [trace.log]\n", argv[ 0 ] );
+			return 2;
+		}
+	}
+
+	/* Allocations outside any task of the trace */
+	task_get( "-" );
+
+	/* Let the heap set itself up before timing starts */
+	current = &tasks[ 0 ];
+	vPortFree( pvPortMalloc( 8 ) );
+	st.min_free = xPortGetFreeHeapSize();
+
+	if( path != NULL )
+	{
+		if( ( f = fopen( path, "r" ) ) == NULL )
+		{
+			perror( path );
+			return 1;
+		}
+		replay_trace( f );
+		fclose( f );
+	}
+	else
+	{
+		replay_synthetic( operations );
+	}
+
+	report();
+
+	return 0;
+}
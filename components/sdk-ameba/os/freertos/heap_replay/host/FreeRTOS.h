@@ -0,0 +1,62 @@
+/*
+ * Host stand-in for FreeRTOS.h, just enough to build heap_5.c and
+ * heap_tlsf.c in heap_replay.
+ */
+#ifndef HEAP_REPLAY_FREERTOS_H
+#define HEAP_REPLAY_FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+
+#ifndef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 100 * 1024 ) )
+#endif
+
+#define configUSE_TLSF_HEAP				1
+#define configUSE_TRACE_FACILITY		1
+#define configUSE_MALLOC_FAILED_HOOK	0
+#define configHEAP_TRACE				0
+
+#define portBYTE_ALIGNMENT				8
+#define portBYTE_ALIGNMENT_MASK			( 0x0007 )
+#define portPOINTER_SIZE_TYPE			uintptr_t
+
+#define configASSERT( x )				assert( x )
+#define traceMALLOC( pvAddress, uiSize )
+#define traceFREE( pvAddress, uiSize )
+#define mtCOVERAGE_TEST_MARKER()
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void * TaskHandle_t;
+
+#define pdFALSE							( ( BaseType_t ) 0 )
+#define pdTRUE							( ( BaseType_t ) 1 )
+
+typedef struct HeapRegion
+{
+	uint8_t *pucStartAddress;
+	size_t xSizeInBytes;
+} HeapRegion_t;
+
+typedef struct xHEAP_STATS
+{
+	size_t xTotalBytes;
+	size_t xFreeBytes;
+	size_t xMinimumEverFreeBytes;
+	size_t xLargestFreeBlock;
+	size_t xFreeBlocks;
+	uint32_t ulAllocs;
+	uint32_t ulFrees;
+	uint32_t ulFailures;
+} HeapStats_t;
+
+void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions );
+void *pvPortMalloc( size_t xSize );
+void vPortFree( void *pv );
+size_t xPortGetFreeHeapSize( void );
+size_t xPortGetMinimumEverFreeHeapSize( void );
+
+#endif /* HEAP_REPLAY_FREERTOS_H */
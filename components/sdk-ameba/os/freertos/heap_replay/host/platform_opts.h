@@ -0,0 +1,9 @@
+/* Host stand-in for platform_opts.h, selects the host heap region. */
+#ifndef HEAP_REPLAY_PLATFORM_OPTS_H
+#define HEAP_REPLAY_PLATFORM_OPTS_H
+
+#ifndef HEAP_REPLAY_HOST
+#define HEAP_REPLAY_HOST
+#endif
+
+#endif /* HEAP_REPLAY_PLATFORM_OPTS_H */
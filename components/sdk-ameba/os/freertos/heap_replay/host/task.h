@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for task.h. heap_replay plays every task of the trace, the
+ * current one is set before each call into the heap.
+ */
+#ifndef HEAP_REPLAY_TASK_H
+#define HEAP_REPLAY_TASK_H
+
+#define taskSCHEDULER_NOT_STARTED		( ( BaseType_t ) 1 )
+#define taskSCHEDULER_RUNNING			( ( BaseType_t ) 2 )
+
+void vTaskSuspendAll( void );
+BaseType_t xTaskResumeAll( void );
+BaseType_t xTaskGetSchedulerState( void );
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+UBaseType_t uxTaskGetTaskNumber( TaskHandle_t xTask );
+void vTaskSetTaskNumber( TaskHandle_t xTask, const UBaseType_t uxHandle );
+char *pcTaskGetTaskName( TaskHandle_t xTaskToQuery );
+
+#endif /* HEAP_REPLAY_TASK_H */
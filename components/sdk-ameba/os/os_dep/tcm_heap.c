@@ -4,6 +4,9 @@
 #include <string.h>    // memset()
 
 #include <osdep_service.h>
+#if PLATFORM_FREERTOS
+#include "FreeRTOS.h"	// configUSE_TLSF_HEAP
+#endif
 
 //#define _DEBUG
 
@@ -30,6 +33,84 @@ static	_lock	tcm_lock;
 
 extern void vPortSetExtFree( void (*free)( void *p ), uint32_t upper, uint32_t lower );
 
+#if defined(configUSE_TLSF_HEAP) && (configUSE_TLSF_HEAP == 1)
+/* Same TLSF allocator as the FreeRTOS heap (heap_tlsf.c): bounded time and
+ * good fit instead of the first fit walk of the free list below. */
+static void *tcm_tlsf;
+
+void tcm_heap_init(void)
+{
+	tcm_tlsf = pvPortTlsfCreate(&tcm_heap, sizeof(tcm_heap));
+
+	g_heap_inited = 1;
+	rtw_spinlock_init(&tcm_lock);
+
+#if PLATFORM_FREERTOS
+	// let RTOS know how to free memory if using as task stack
+	vPortSetExtFree(tcm_heap_free, 0x20000000, 0x1fff0000);
+#endif
+}
+
+void tcm_heap_dump(void)
+{
+	printf("---TLSF heap, free %d--\n\r", (int)xPortTlsfGetFreeSize(tcm_tlsf));
+}
+
+void *tcm_heap_allocmem(int size)
+{
+	void *mem;
+	_irqL 	irqL;
+
+	rtw_enter_critical(&tcm_lock, &irqL);
+
+	if(!g_heap_inited)	tcm_heap_init();
+
+	/* Handle allocations of 0 bytes */
+	if (size <= 0)
+		size = sizeof(MemChunk);
+
+	mem = pvPortTlsfMalloc(tcm_tlsf, size);
+#ifdef _DEBUG
+	if (mem)
+		memset(mem, ALLOC_FILL_CODE, size);
+#endif
+
+	rtw_exit_critical(&tcm_lock, &irqL);
+	return mem;
+}
+
+/* TLSF keeps the block size itself, size is only used for debug fill */
+void tcm_heap_freemem(void *mem, int size)
+{
+	_irqL 	irqL;
+
+	rtw_enter_critical(&tcm_lock, &irqL);
+
+	if(!g_heap_inited)	tcm_heap_init();
+
+#ifdef _DEBUG
+	memset(mem, FREE_FILL_CODE, size);
+#endif
+	vPortTlsfFree(tcm_tlsf, mem);
+
+	rtw_exit_critical(&tcm_lock, &irqL);
+}
+
+int tcm_heap_freeSpace(void)
+{
+	int free_mem;
+	_irqL 	irqL;
+
+	rtw_enter_critical(&tcm_lock, &irqL);
+
+	if(!g_heap_inited)	tcm_heap_init();
+
+	free_mem = (int)xPortTlsfGetFreeSize(tcm_tlsf);
+
+	rtw_exit_critical(&tcm_lock, &irqL);
+	return free_mem;
+}
+#else
 void tcm_heap_init(void)
 {
 	//#ifdef _DEBUG
@@ -235,6 +316,7 @@ int tcm_heap_freeSpace(void)
 	rtw_exit_critical(&tcm_lock, &irqL);
 	return free_mem;
 }
+#endif
 
 
 /**
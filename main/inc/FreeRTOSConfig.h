@@ -116,13 +116,26 @@ extern uint32_t SystemCoreClock;
 #define configCHECK_FOR_STACK_OVERFLOW	2
 #define configUSE_RECURSIVE_MUTEXES		1
 #define configQUEUE_REGISTRY_SIZE		0
-#define configGENERATE_RUN_TIME_STATS	0
+#define configGENERATE_RUN_TIME_STATS	1
 #if configGENERATE_RUN_TIME_STATS
-#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() //( ulHighFrequencyTimerTicks = 0UL )
-#define portGET_RUN_TIME_COUNTER_VALUE() xTickCount //ulHighFrequencyTimerTicks
+/* 32768Hz SYSTIMER, see freertos_trace.c */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() vTraceInit()
+#define portGET_RUN_TIME_COUNTER_VALUE() ulTraceRunTimeCounter()
 #undef	configUSE_TRACE_FACILITY
 #define configUSE_TRACE_FACILITY			1
 #define portCONFIGURE_STATS_PEROID_VALUE	1000 //unit Ticks
+
+/* Trace ring of context switches, ISRs and queue blocking (ATST), 8 bytes per
+   event. Off by default, the ring is configTRACE_RING_SIZE * 8 bytes of RAM. */
+#define configUSE_TRACE_RING			0
+#define configTRACE_RING_SIZE			512
+#endif
+
+/* TLSF heap (heap_tlsf.c) with per-task accounting, owners are kept in uxTaskNumber */
+#define configUSE_TLSF_HEAP				1
+#if configUSE_TLSF_HEAP
+#undef	configUSE_TRACE_FACILITY
+#define configUSE_TRACE_FACILITY			1
 #endif
 
 #define configTIMER_TASK_PRIORITY       ( 1 )
@@ -203,5 +216,9 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 
 //#define RTK_MODE_TIMER
 
+#if (__IASMARM__ != 1)
+#include "freertos_trace.h"
+#endif
+
 
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2013-2018 Molmc Group. All rights reserved.
+ * License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef FAST_CONNECT_H_
+#define FAST_CONNECT_H_
+
+#include "wifi_constants.h"
+
+/* 连网各阶段时间点, 用于统计上电到云端连接的耗时 */
+typedef enum {
+    FAST_CONNECT_MARK_START = 0,
+    FAST_CONNECT_MARK_ASSOCIATED,
+    FAST_CONNECT_MARK_IP,
+    FAST_CONNECT_MARK_CLOUD,
+    FAST_CONNECT_MARK_MAX
+} fast_connect_mark_t;
+
+/*
+ * 连接路由器并获取IP. 若flash中保存了同一网络的BSSID/信道/PMK, 则直接在该信道
+ * 连接该BSSID并跳过PMK计算, DHCP先用INIT-REBOOT确认上次租到的地址.
+ * 任一步失败都退回普通的扫描连接和DHCP DISCOVER. flash中只保存PMK和密码的哈希,
+ * 不保存密码明文. 第一次调用时创建重连任务, 失败时由它在后台退避重试.
+ * 返回0表示已获取IP.
+ */
+int fastConnectWifi(const char *ssid, const char *password, rtw_security_t security);
+
+/*
+ * 在WIFI_EVENT_DISCONNECT回调中调用, 不阻塞: 重连任务用上次的网络参数调用
+ * fastConnectWifi, 同一次上电内租约未过期时先用INIT-REBOOT, 失败后退避重试.
+ */
+void fastConnectLinkDown(void);
+void fastConnectMark(fast_connect_mark_t mark);
+void fastConnectErase(void);
+
+/*
+ * 固定一个域名(如云平台, NTP服务器)的DNS解析结果: lwIP在TTL到期前后台重新查询,
+ * 查询期间继续使用旧地址; 新的结果随快速连接信息保存到flash, 重新上电后先用
+ * 保存的地址, 同时后台刷新. host须一直有效(如字符串常量). 获取IP后调用.
+ * 返回0表示成功.
+ */
+int fastConnectPinHost(const char *host);
+
+#endif
+
@@ -55,6 +55,12 @@
 #define FAST_RECONNECT_DATA 	(0x80000 - 0x1000)
 #define FLASH_SECTOR_SIZE       0x1000
 
+/* lwIP hands each new DNS answer of a host pinned with fastConnectPinHost()
+   to fast_connect.c, which keeps it in FAST_RECONNECT_DATA */
+struct ip_addr;
+void fastConnectDnsUpdate(const char *name, const struct ip_addr *addr, unsigned int ttl);
+#define DNS_PINNED_UPDATE(name, addr, ttl)	fastConnectDnsUpdate(name, addr, ttl)
+
 #define CONFIG_ENABLE_RDP		0
 
 /**
@@ -37,5 +37,10 @@
 //软件版本号，为设备当前软件的版本号。该版本号将上送至服务器。
 #define SOFTWARE_VERSION_DEF                     "1.0.0"
 
+//云平台和NTP服务器域名
+//须与IntoYun SDK实际连接的服务器一致, 其DNS解析结果会被固定在缓存中并保存到flash.
+#define CLOUD_HOST_DEF                           "iot.intoyun.com"
+#define NTP_HOST_DEF                             "pool.ntp.org"
+
 #endif
 
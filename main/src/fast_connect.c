@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2013-2018 Molmc Group. All rights reserved.
+ * License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stddef.h>
+#include <ctype.h>
+#include "iot_export.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "flash_api.h"
+#include "device_lock.h"
+#include "lwip_netconf.h"
+#include "lwip/dhcp.h"
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+#include <wifi/wifi_conf.h>
+#include <wlan_fast_connect/example_wlan_fast_connect.h>
+#include "fast_connect.h"
+
+#if CONFIG_EXAMPLE_WLAN_FAST_CONNECT
+#error "fast_connect uses FAST_RECONNECT_DATA, disable CONFIG_EXAMPLE_WLAN_FAST_CONNECT"
+#endif
+
+const static char *TAG = "user:fastconn";
+
+#define FAST_CONNECT_MAGIC      0x4643ACE3     //记录格式变化时修改
+#define FAST_CONNECT_DNS_NUM    DNS_PINNED_HOSTS
+#define FAST_CONNECT_RETRY_MIN  (1 * configTICK_RATE_HZ)     //重连失败后的等待, 每次加倍
+#define FAST_CONNECT_RETRY_MAX  (32 * configTICK_RATE_HZ)
+
+//固定域名的DNS解析结果
+typedef struct {
+    uint32_t nameHash;      //0表示空
+    uint32_t ip;            //网络字节序
+} fast_connect_dns_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t security;
+    uint8_t  ssid[NDIS_802_11_LENGTH_SSID + 4];
+    uint32_t passHash;      //不保存密码明文, 只用来判断密码是否变化
+    uint8_t  pmk[A_SHA_DIGEST_LEN * 2];
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint32_t ip;            //网络字节序
+    uint32_t leaseSecs;
+    fast_connect_dns_t dns[FAST_CONNECT_DNS_NUM];
+    uint32_t checksum;
+} fast_connect_record_t;
+
+extern struct netif xnetif[NET_IF_NUM];
+
+static fast_connect_record_t fastRecord;
+static uint32_t markTicks[FAST_CONNECT_MARK_MAX];
+static uint32_t leaseTick = 0;   //本次上电获得租约的时刻, 0表示未知
+static fast_connect_dns_t dnsRecord[FAST_CONNECT_DNS_NUM];  //tcpip线程更新, 随记录保存
+static bool dnsLoaded = false;
+static volatile bool dnsDirty = false;
+static uint8_t dnsNext = 0;
+//断线重连任务, 第一次连接成功后创建
+static xSemaphoreHandle reconnectSema = NULL;
+static char reconnectSsid[33];
+static char reconnectPassword[65];
+static rtw_security_t reconnectSecurity;
+static volatile bool reconnecting = false;
+static volatile uint32_t downTick;
+
+static uint32_t fastConnectChecksum(const fast_connect_record_t *record)
+{
+    const uint8_t *p = (const uint8_t *)record;
+    uint32_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < offsetof(fast_connect_record_t, checksum); i++) {
+        sum = (sum << 1 | sum >> 31) ^ p[i];
+    }
+    return sum;
+}
+
+static uint32_t fastConnectPassHash(const char *password)
+{
+    uint32_t hash = 2166136261UL;
+
+    for (; *password; password++) {
+        hash = (hash ^ (uint8_t)*password) * 16777619UL;
+    }
+    return hash;
+}
+
+static bool fastConnectLoad(fast_connect_record_t *record)
+{
+    flash_t flash;
+
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    flash_stream_read(&flash, FAST_RECONNECT_DATA, sizeof(fast_connect_record_t), (uint8_t *)record);
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    if (record->magic != FAST_CONNECT_MAGIC || record->checksum != fastConnectChecksum(record)) {
+        return false;
+    }
+    return true;
+}
+
+static void fastConnectSave(fast_connect_record_t *record)
+{
+    flash_t flash;
+    fast_connect_record_t old;
+
+    record->magic = FAST_CONNECT_MAGIC;
+    record->checksum = fastConnectChecksum(record);
+
+    //内容不变不写flash, 避免每次上电都擦一次扇区
+    if (fastConnectLoad(&old) && !memcmp(&old, record, sizeof(fast_connect_record_t))) {
+        return;
+    }
+
+    MOLMC_LOGI(TAG, "save profile, channel %d", record->channel);
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    flash_erase_sector(&flash, FAST_RECONNECT_DATA);
+    flash_stream_write(&flash, FAST_RECONNECT_DATA, sizeof(fast_connect_record_t), (uint8_t *)record);
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+}
+
+//flash中的记录是否属于当前要连接的网络
+static bool fastConnectMatch(const fast_connect_record_t *record, const char *ssid, const char *password, rtw_security_t security)
+{
+    if (record->security != (uint32_t)security) {
+        return false;
+    }
+    if (strncmp((const char *)record->ssid, ssid, sizeof(record->ssid))) {
+        return false;
+    }
+    if (record->passHash != fastConnectPassHash(password)) {
+        return false;
+    }
+    return true;
+}
+
+static int fastConnectAssociate(bool cached, const char *ssid, const char *password, rtw_security_t security)
+{
+    uint8_t pscanConfig = PSCAN_ENABLE | PSCAN_FAST_SURVEY;
+    uint8_t channel;
+
+    if (cached) {
+        //预置PMK, 驱动发现ssid/密码一致时跳过PBKDF2计算
+        memcpy(psk_essid[0], fastRecord.ssid, sizeof(psk_essid[0]));
+        memset(psk_passphrase[0], 0, sizeof(psk_passphrase[0]));
+        strncpy((char *)psk_passphrase[0], password, sizeof(psk_passphrase[0]) - 1);
+        memcpy(wpa_global_PSK[0], fastRecord.pmk, sizeof(wpa_global_PSK[0]));
+
+        //只扫描上次的信道, 并直接连接上次的AP
+        channel = fastRecord.channel;
+        if (wifi_set_pscan_chan(&channel, &pscanConfig, 1) == 0 &&
+            wifi_connect_bssid(fastRecord.bssid, (char *)ssid, security, (char *)password,
+                ETH_ALEN, strlen(ssid), strlen(password), -1, NULL) == RTW_SUCCESS) {
+            return 0;
+        }
+        MOLMC_LOGW(TAG, "cached BSSID/channel failed, full scan");
+    }
+
+    if (wifi_connect((char *)ssid, security, (char *)password, strlen(ssid), strlen(password), -1, NULL) == RTW_SUCCESS) {
+        return 0;
+    }
+    return -1;
+}
+
+//域名不区分大小写
+static uint32_t fastConnectNameHash(const char *name)
+{
+    uint32_t hash = 2166136261UL;
+
+    for (; *name; name++) {
+        hash = (hash ^ (uint8_t)tolower((uint8_t)*name)) * 16777619UL;
+    }
+    return hash ? hash : 1;
+}
+
+//上电后第一次使用时从flash读出保存的DNS解析结果
+static void fastConnectDnsLoad(void)
+{
+    fast_connect_record_t record;
+
+    if (dnsLoaded) {
+        return;
+    }
+    dnsLoaded = true;
+    if (fastConnectLoad(&record)) {
+        memcpy(dnsRecord, record.dns, sizeof(dnsRecord));
+    }
+}
+
+static void fastConnectDnsCopy(fast_connect_record_t *record)
+{
+    taskENTER_CRITICAL();
+    memcpy(record->dns, dnsRecord, sizeof(record->dns));
+    dnsDirty = false;
+    taskEXIT_CRITICAL();
+}
+
+/* DNS_PINNED_UPDATE: 在tcpip线程中收到固定域名的新解析结果. 这里只更新内存,
+   写flash要擦扇区, 留到连上云端或下次更新连接信息时在用户任务中进行.
+   没有实时时钟, 重新上电后无法知道剩余TTL, 因此不保存TTL */
+void fastConnectDnsUpdate(const char *name, const ip_addr_t *addr, u32_t ttl)
+{
+    uint32_t hash = fastConnectNameHash(name);
+    int i, slot = -1;
+
+    (void)ttl;
+    for (i = 0; i < FAST_CONNECT_DNS_NUM; i++) {
+        if (dnsRecord[i].nameHash == hash) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 && dnsRecord[i].nameHash == 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        slot = dnsNext++ % FAST_CONNECT_DNS_NUM;
+    }
+    if (dnsRecord[slot].nameHash == hash && dnsRecord[slot].ip == addr->addr) {
+        return;
+    }
+    dnsRecord[slot].nameHash = hash;
+    dnsRecord[slot].ip = addr->addr;
+    dnsDirty = true;
+}
+
+//dns_pin()和dns_cache_add()只能在tcpip线程中调用
+static void fastConnectPinHostCallback(void *arg)
+{
+    const char *host = (const char *)arg;
+    uint32_t hash = fastConnectNameHash(host);
+    ip_addr_t addr;
+    int i;
+
+    if (dns_pin(host) != ERR_OK) {
+        MOLMC_LOGE(TAG, "pin %s failed", host);
+        return;
+    }
+    for (i = 0; i < FAST_CONNECT_DNS_NUM; i++) {
+        if (dnsRecord[i].nameHash == hash && dnsRecord[i].ip != 0) {
+            /* 不知道断电了多久: 先用上次的地址连接, TTL给DNS_PREFETCH_TIME,
+               下一次dns_tmr就在后台重新查询, 查到之前一直用这个地址 */
+            addr.addr = dnsRecord[i].ip;
+            dns_cache_add(host, &addr, DNS_PREFETCH_TIME);
+            break;
+        }
+    }
+}
+
+static void fastConnectUpdate(const char *ssid, const char *password, rtw_security_t security)
+{
+    rtw_wifi_setting_t setting;
+    struct netif *pnetif = &xnetif[0];
+
+    if (wifi_get_setting(WLAN0_NAME, &setting) < 0) {
+        return;
+    }
+
+    memset(&fastRecord, 0, sizeof(fastRecord));
+    fastConnectDnsCopy(&fastRecord);
+    fastRecord.security = security;
+    strncpy((char *)fastRecord.ssid, ssid, sizeof(fastRecord.ssid) - 1);
+    fastRecord.passHash = fastConnectPassHash(password);
+    memcpy(fastRecord.pmk, wpa_global_PSK[0], sizeof(fastRecord.pmk));
+    wifi_get_ap_bssid(fastRecord.bssid);
+    fastRecord.channel = setting.channel;
+    fastRecord.ip = pnetif->ip_addr.addr;
+    if (pnetif->dhcp != NULL) {
+        fastRecord.leaseSecs = pnetif->dhcp->offered_t0_lease;
+    }
+    fastConnectSave(&fastRecord);
+}
+
+/* 断线后DHCP已停止(DHCP_OFF), lease_used停在断线时距上次ACK的分钟数.
+   会话中的续租都会更新它, 由此得到最后一次ACK的时刻, 多算一分钟 */
+static void fastConnectLeaseAtDown(void)
+{
+    struct dhcp *dhcp = xnetif[0].dhcp;
+
+    if (dhcp == NULL || dhcp->offered_t0_lease == 0) {
+        return;
+    }
+    leaseTick = downTick - (uint32_t)(dhcp->lease_used + 1) * DHCP_COARSE_TIMER_SECS * configTICK_RATE_HZ;
+    fastRecord.leaseSecs = dhcp->offered_t0_lease;
+}
+
+static void fastConnectReconnectTask(void *param)
+{
+    uint32_t delay;
+
+    for (;;) {
+        xSemaphoreTake(reconnectSema, portMAX_DELAY);
+        MOLMC_LOGI(TAG, "link down, reconnect");
+        fastConnectLeaseAtDown();
+        delay = FAST_CONNECT_RETRY_MIN;
+        while (fastConnectWifi(reconnectSsid, reconnectPassword, reconnectSecurity) < 0) {
+            vTaskDelay(delay);
+            if (delay < FAST_CONNECT_RETRY_MAX) {
+                delay *= 2;
+            }
+        }
+        reconnecting = false;
+    }
+}
+
+static void fastConnectReconnectInit(const char *ssid, const char *password, rtw_security_t security)
+{
+    if (reconnectSema != NULL) {
+        return;
+    }
+    strncpy(reconnectSsid, ssid, sizeof(reconnectSsid) - 1);
+    strncpy(reconnectPassword, password, sizeof(reconnectPassword) - 1);
+    reconnectSecurity = security;
+    reconnectSema = xSemaphoreCreateBinary();
+    if (xTaskCreate(fastConnectReconnectTask, "fastconn", 1024, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        MOLMC_LOGE(TAG, "create reconnect task failed");
+    }
+}
+
+int fastConnectWifi(const char *ssid, const char *password, rtw_security_t security)
+{
+    bool cached;
+    uint8_t dhcpState;
+
+    fastConnectMark(FAST_CONNECT_MARK_START);
+
+    fastConnectDnsLoad();
+    //第一次连接就失败时也由重连任务重试
+    fastConnectReconnectInit(ssid, password, security);
+    cached = fastConnectLoad(&fastRecord) && fastConnectMatch(&fastRecord, ssid, password, security);
+    if (fastConnectAssociate(cached, ssid, password, security) < 0) {
+        MOLMC_LOGE(TAG, "connect %s failed", ssid);
+        fastConnectLinkDown();
+        return -1;
+    }
+    fastConnectMark(FAST_CONNECT_MARK_ASSOCIATED);
+
+    /* 没有实时时钟, 只能在同一次上电内判断租约是否过期(leaseTick为最后一次
+       ACK的时刻, 断线时由fastConnectLeaseAtDown更新); 冷启动时由服务器对
+       INIT-REBOOT回复ACK或NAK */
+    if (cached && leaseTick != 0 && fastRecord.leaseSecs != 0xffffffff &&
+        (xTaskGetTickCount() - leaseTick) / configTICK_RATE_HZ >= fastRecord.leaseSecs) {
+        cached = false;
+    }
+
+    if (cached && fastRecord.ip != 0) {
+        dhcpState = LwIP_DHCP_Reboot(0, fastRecord.ip);
+    } else {
+        dhcpState = LwIP_DHCP(0, DHCP_START);
+    }
+    if (dhcpState != DHCP_ADDRESS_ASSIGNED) {
+        MOLMC_LOGE(TAG, "dhcp failed");
+        fastConnectLinkDown();
+        return -1;
+    }
+    leaseTick = xTaskGetTickCount();
+    fastConnectMark(FAST_CONNECT_MARK_IP);
+
+    fastConnectUpdate(ssid, password, security);
+    return 0;
+}
+
+void fastConnectLinkDown(void)
+{
+    if (reconnectSema == NULL || reconnecting) {
+        return;
+    }
+    reconnecting = true;
+    downTick = xTaskGetTickCount();
+    xSemaphoreGive(reconnectSema);
+}
+
+void fastConnectMark(fast_connect_mark_t mark)
+{
+    if (mark >= FAST_CONNECT_MARK_MAX) {
+        return;
+    }
+
+    markTicks[mark] = xTaskGetTickCount();
+    //连上云端时保存期间收到的DNS解析结果, 连接信息不变时不重写flash
+    if (mark == FAST_CONNECT_MARK_CLOUD && dnsDirty && fastRecord.magic == FAST_CONNECT_MAGIC) {
+        fastConnectDnsCopy(&fastRecord);
+        fastConnectSave(&fastRecord);
+    }
+    if (mark == FAST_CONNECT_MARK_CLOUD && markTicks[FAST_CONNECT_MARK_START] != 0) {
+        MOLMC_LOGI(TAG, "associated %dms, ip %dms, cloud %dms",
+            (int)((markTicks[FAST_CONNECT_MARK_ASSOCIATED] - markTicks[FAST_CONNECT_MARK_START]) * portTICK_RATE_MS),
+            (int)((markTicks[FAST_CONNECT_MARK_IP] - markTicks[FAST_CONNECT_MARK_START]) * portTICK_RATE_MS),
+            (int)((markTicks[FAST_CONNECT_MARK_CLOUD] - markTicks[FAST_CONNECT_MARK_START]) * portTICK_RATE_MS));
+        markTicks[FAST_CONNECT_MARK_START] = 0;
+    }
+}
+
+int fastConnectPinHost(const char *host)
+{
+    fastConnectDnsLoad();
+    return tcpip_callback(fastConnectPinHostCallback, (void *)host) == ERR_OK ? 0 : -1;
+}
+
+void fastConnectErase(void)
+{
+    flash_t flash;
+
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    flash_erase_sector(&flash, FAST_RECONNECT_DATA);
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+    memset(&fastRecord, 0, sizeof(fastRecord));
+}
@@ -19,6 +19,7 @@
 #include "iot_export.h"
 #include "project_config.h"
 #include "ota_update.h"
+#include "fast_connect.h"
 #include "device.h"
 #include "gpio_api.h"   // mbed
 #include "analogin_api.h"
@@ -78,6 +79,7 @@ void eventProcess(int event, int param, uint8_t *data, uint32_t datalen)
                 break;
             case ep_cloud_status_connected:       //模组已连接平台
                 MOLMC_LOGI(TAG, "event cloud connect server");
+                fastConnectMark(FAST_CONNECT_MARK_CLOUD);
                 break;
             default:
                 break;
@@ -97,6 +99,9 @@ void userInit(void)
     Cloud.defineDatapointNumber(DPID_DOUBLE_ILLUMINATION, DP_PERMISSION_UP_ONLY, 0, 10000, 1, 0); //光照强度
 
     /*************此处修改和添加用户初始化代码**************/
+    //重连和重新上电时不必等待云平台和NTP服务器的DNS查询
+    fastConnectPinHost(CLOUD_HOST_DEF);
+    fastConnectPinHost(NTP_HOST_DEF);
     Cloud.connect();
     timerID = timerGetId();
 
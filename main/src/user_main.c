@@ -20,6 +20,7 @@
 #include "device.h"
 #include "wifi_constants.h"
 #include "lwip_netconf.h"
+#include "fast_connect.h"
 
 //#define CONFIG_WIFI_SSID      "TP-LINK_3816"
 #define CONFIG_WIFI_SSID      "MOLMC_HUAWEI"
@@ -44,6 +45,7 @@ static void on_wifi_disconnect( char* buf, int buf_len, int flags, void* userdat
 {
     printf("disconnect\n");
     Network.setState(IOTX_NETWORK_STATE_DISCONNECTED);
+    fastConnectLinkDown();
 }
 
 static void intoyun_iot_task(void *param)
@@ -56,10 +58,7 @@ static void intoyun_iot_task(void *param)
 	wifi_reg_event_handler(WIFI_EVENT_CONNECT, on_wifi_connect, NULL);
 	wifi_reg_event_handler(WIFI_EVENT_DISCONNECT, on_wifi_disconnect, NULL);
    
-    if(wifi_connect(CONFIG_WIFI_SSID, RTW_SECURITY_WPA2_AES_PSK, \
-            CONFIG_WIFI_PASSWORD, strlen(CONFIG_WIFI_SSID), strlen(CONFIG_WIFI_PASSWORD), -1, NULL) == RTW_SUCCESS) {
-        LwIP_DHCP(0, DHCP_START);
-    }
+    fastConnectWifi(CONFIG_WIFI_SSID, CONFIG_WIFI_PASSWORD, RTW_SECURITY_WPA2_AES_PSK);
 
     userMain();
 }
@@ -74,6 +73,7 @@ int main(void)
     Log.setLogLevel("*", MOLMC_LOG_VERBOSE);
     Log.setLogLevel("user:project", MOLMC_LOG_VERBOSE);
     Log.setLogLevel("user:ota", MOLMC_LOG_VERBOSE);
+    Log.setLogLevel("user:fastconn", MOLMC_LOG_VERBOSE);
 
 	if(xTaskCreate(intoyun_iot_task, (char const *)"intoyun_iot_task", 4096 * 2, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS){
 		printf("\n\r[%s] Create update task failed", __FUNCTION__);